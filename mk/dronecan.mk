@@ -22,6 +22,8 @@ MCU_COMMON_SRC += \
             io/dronecan/dronecan_nodes.c \
             io/dronecan/dronecan_esc.c \
             io/dronecan/dronecan_dna.c \
+            io/dronecan/dronecan_route.c \
+            io/dronecan/dronecan_frames.c \
             dronecan/libcanard/canard.c
 
 SIZE_OPTIMISED_SRC += \
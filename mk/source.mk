@@ -17,12 +17,14 @@ PG_SRC = \
             pg/dyn_notch.c \
             pg/flash.c \
             pg/flight_plan.c \
+            pg/geofence.c \
             pg/gimbal.c \
             pg/gps.c \
             pg/gps_lap_timer.c \
             pg/gps_rescue_multirotor.c \
             pg/gps_rescue_wing.c \
             pg/gyrodev.c \
+            pg/mavlink_offboard.c \
             pg/max7456.c \
             pg/mco.c \
             pg/motor.c \
@@ -101,6 +103,7 @@ COMMON_SRC = \
             drivers/bus_quadspi.c \
             drivers/buttons.c \
             drivers/camera_control.c \
+            drivers/can/can_filter.c \
             drivers/display.c \
             drivers/display_canvas.c \
             drivers/dma.c \
@@ -173,18 +176,22 @@ COMMON_SRC = \
             flight/failsafe.c \
             flight/flight_plan_capture.c \
             flight/flight_plan_nav.c \
+            flight/geofence.c \
+            flight/mission_store.c \
             flight/gps_rescue_multirotor.c \
             flight/gps_rescue_wing.c \
             flight/imu.c \
             flight/mixer.c \
             flight/mixer_init.c \
             flight/mixer_tricopter.c \
+            flight/nav_path.c \
             flight/nav_trail.c \
             flight/pid.c \
             flight/pid_init.c \
             flight/position.c \
             flight/position_estimator.c \
             flight/position_filter.c \
+            flight/position_ekf.c \
             flight/position_nav.c \
             flight/pos_hold_multirotor.c \
             flight/pos_hold_wing.c \
@@ -199,6 +206,7 @@ COMMON_SRC = \
             rx/msp.c \
             rx/pwm.c \
             rx/frsky_crc.c \
+            rx/rc_latency.c \
             rx/rc_stats.c \
             rx/rx.c \
             rx/rx_bind.c \
@@ -287,6 +295,7 @@ COMMON_SRC = \
             sensors/opticalflow.c \
             telemetry/telemetry.c \
             telemetry/crsf.c \
+            telemetry/crsf_scheduler.c \
             telemetry/ghst.c \
             telemetry/srxl.c \
             telemetry/frsky_hub.c \
@@ -296,6 +305,8 @@ COMMON_SRC = \
             telemetry/ltm.c \
             telemetry/mavlink.c \
             telemetry/mavlink_mission.c \
+            telemetry/mavlink_offboard.c \
+            telemetry/mavlink_scheduler.c \
             telemetry/msp_shared.c \
             telemetry/ibus.c \
             telemetry/ibus_shared.c \
@@ -482,6 +493,7 @@ SPEED_OPTIMISED_SRC += \
             flight/pid.c \
             flight/rpm_filter.c \
             rx/ibus.c \
+            rx/rc_latency.c \
             rx/rc_stats.c \
             rx/rx.c \
             rx/rx_spi.c \
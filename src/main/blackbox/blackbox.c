@@ -85,6 +85,7 @@
 #include "pg/pos_hold.h"
 #include "pg/rx.h"
 
+#include "rx/rc_latency.h"
 #include "rx/rx.h"
 
 #include "sensors/acceleration.h"
@@ -242,6 +243,10 @@ static const blackboxDeltaFieldDefinition_t blackboxMainFields[] = {
     {"surfaceRaw",   -1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_8SVB), CONDITION(RANGEFINDER)},
 #endif
     {"rssi",       -1, UNSIGNED, .Ipredict = PREDICT(0),       .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_8SVB), CONDITION(RSSI)},
+#ifdef USE_RC_LATENCY_STATS
+    /* stick to motor latency of the last RC frame in us, only changes when a new frame reaches the motors */
+    {"rcLatency",  -1, UNSIGNED, .Ipredict = PREDICT(0),       .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(RC_COMMANDS)},
+#endif
 
     /* Gyros and accelerometers base their P-predictions on the average of the previous 2 frames to reduce noise impact */
     {"gyroADC",     0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(GYRO)},
@@ -393,6 +398,9 @@ typedef struct blackboxMainState_s {
     int32_t surfaceRaw;
 #endif
     uint16_t rssi;
+#ifdef USE_RC_LATENCY_STATS
+    uint32_t rcLatency;
+#endif
 } blackboxMainState_t;
 
 typedef struct blackboxGpsState_s {
@@ -739,6 +747,12 @@ static void writeIntraframe(void)
         blackboxWriteUnsignedVB(blackboxCurrent->rssi);
     }
 
+#ifdef USE_RC_LATENCY_STATS
+    if (testBlackboxCondition(CONDITION(RC_COMMANDS))) {
+        blackboxWriteUnsignedVB(blackboxCurrent->rcLatency);
+    }
+#endif
+
     if (testBlackboxCondition(CONDITION(GYRO))) {
         blackboxWriteSigned16VBArray(blackboxCurrent->gyroADC, XYZ_AXIS_COUNT);
     }
@@ -924,6 +938,12 @@ static void writeInterframe(void)
 
     blackboxWriteTag8_8SVB(deltas, optionalFieldCount);
 
+#ifdef USE_RC_LATENCY_STATS
+    if (testBlackboxCondition(CONDITION(RC_COMMANDS))) {
+        blackboxWriteSignedVB((int32_t)(blackboxCurrent->rcLatency - blackboxLast->rcLatency));
+    }
+#endif
+
     //Since gyros, accs and motors are noisy, base their predictions on the average of the history:
     if (testBlackboxCondition(CONDITION(GYRO))) {
         blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
@@ -1321,6 +1341,10 @@ static void loadMainState(timeUs_t currentTimeUs)
 
     blackboxCurrent->rssi = getRssi();
 
+#ifdef USE_RC_LATENCY_STATS
+    blackboxCurrent->rcLatency = rcLatencyGetStats(RC_LATENCY_TOTAL)->lastUs;
+#endif
+
 #ifdef USE_SERVOS
     for (unsigned i = 0; i < ARRAYLEN(blackboxCurrent->servo); i++) {
         blackboxCurrent->servo[i] = servo[i];
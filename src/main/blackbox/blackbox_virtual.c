@@ -31,6 +31,7 @@
 #define LOGFILE_PREFIX "LOG"
 #define LOGFILE_SUFFIX "BFL"
 #define NAME_BUFFER_LENGTH 13   //file name template: LOG00001.BFL, 13 = 12 symbols + \0
+#define PREFIXED_NAME_BUFFER_LENGTH (NAME_BUFFER_LENGTH + 16)  // SITL instances prefix it, e.g. sitl3_LOG00001.BFL
 
 static FILE *blackboxVirtualFile = NULL;
 static int32_t largestLogFileNumber = 0;
@@ -42,14 +43,22 @@ bool blackboxVirtualOpen(void)
         return false; // Failed to open directory
     }
 
+    const char *instancePrefix = sitlInstanceFilePrefix();
+    const size_t instancePrefixLength = strlen(instancePrefix);
+
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
-        if (strlen(entry->d_name) == NAME_BUFFER_LENGTH - 1
-            && strncmp(entry->d_name, LOGFILE_PREFIX, strlen(LOGFILE_PREFIX)) == 0
-            && strncmp(entry->d_name + 9, LOGFILE_SUFFIX, strlen(LOGFILE_SUFFIX)) == 0) {
+        // other instances' logs share the directory but not the numbering
+        if (strlen(entry->d_name) == instancePrefixLength + NAME_BUFFER_LENGTH - 1
+            && strncmp(entry->d_name, instancePrefix, instancePrefixLength) == 0) {
+            const char *name = entry->d_name + instancePrefixLength;
+            if (strncmp(name, LOGFILE_PREFIX, strlen(LOGFILE_PREFIX)) != 0
+                || strncmp(name + 9, LOGFILE_SUFFIX, strlen(LOGFILE_SUFFIX)) != 0) {
+                continue;
+            }
 
             char logSequenceNumberString[6];
-            memcpy(logSequenceNumberString, entry->d_name + 3, 5);
+            memcpy(logSequenceNumberString, name + 3, 5);
             logSequenceNumberString[5] = '\0';
             largestLogFileNumber = MAX((int32_t)atoi(logSequenceNumberString), largestLogFileNumber);
         }
@@ -87,8 +96,8 @@ bool blackboxVirtualBeginLog(void)
     if (blackboxVirtualFile != NULL) {
         return false;
     }
-    char filename[NAME_BUFFER_LENGTH];
-    snprintf(filename, NAME_BUFFER_LENGTH, "%s%05u.%s", LOGFILE_PREFIX, (largestLogFileNumber + 1) % 100000, LOGFILE_SUFFIX);
+    char filename[PREFIXED_NAME_BUFFER_LENGTH];
+    snprintf(filename, sizeof(filename), "%s%s%05u.%s", sitlInstanceFilePrefix(), LOGFILE_PREFIX, (largestLogFileNumber + 1) % 100000, LOGFILE_SUFFIX);
     blackboxVirtualFile = fopen(filename, "w");
     if (blackboxVirtualFile != NULL) {
         largestLogFileNumber++;
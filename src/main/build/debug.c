@@ -129,4 +129,8 @@ const char * const debugModeNames[DEBUG_COUNT] = {
     [DEBUG_AUTOPILOT_PID] = "AUTOPILOT_PID",
     [DEBUG_AUTOPILOT_STOP] = "AUTOPILOT_STOP",
     [DEBUG_PITOT] = "PITOT",
+    [DEBUG_SERIAL_RX_DMA] = "SERIAL_RX_DMA",
+    [DEBUG_RC_LATENCY] = "RC_LATENCY",
+    [DEBUG_POSITION_EKF] = "POSITION_EKF",
+    [DEBUG_OSD_ELEMENT_TIME] = "OSD_ELEMENT_TIME",
 };
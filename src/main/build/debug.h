@@ -132,6 +132,10 @@ typedef enum {
     DEBUG_POSITION_NAV,
     DEBUG_AUTOPILOT_STOP,
     DEBUG_PITOT,
+    DEBUG_SERIAL_RX_DMA,
+    DEBUG_RC_LATENCY,
+    DEBUG_POSITION_EKF,
+    DEBUG_OSD_ELEMENT_TIME,
     DEBUG_COUNT
 } debugType_e;
 
@@ -106,15 +106,19 @@ bool cliMode = false;
 
 #include "flight/failsafe.h"
 #include "flight/flight_plan_nav.h"
+#include "flight/geofence.h"
+#include "flight/mission_store.h"
 #include "flight/imu.h"
 #include "flight/mixer.h"
 #include "flight/pid.h"
 #include "flight/position.h"
+#include "flight/position_estimator.h"
 #include "flight/servos.h"
 
 #include "io/asyncfatfs/asyncfatfs.h"
 #include "io/beeper.h"
 #include "io/dronecan/dronecan.h"
+#include "io/dronecan/dronecan_esc.h"
 #include "io/dronecan/dronecan_msg.h"
 #include "io/dronecan/dronecan_nodes.h"
 #include "io/flashfs.h"
@@ -144,6 +148,7 @@ bool cliMode = false;
 #include "pg/can.h"
 #include "pg/dronecan.h"
 #include "pg/flight_plan.h"
+#include "pg/geofence.h"
 #include "pg/gyrodev.h"
 #include "pg/max7456.h"
 #include "pg/mco.h"
@@ -164,6 +169,7 @@ bool cliMode = false;
 #include "pg/usb.h"
 #include "pg/vtx_table.h"
 
+#include "rx/rc_latency.h"
 #include "rx/rx_bind.h"
 #include "rx/rx_spi.h"
 
@@ -180,6 +186,8 @@ bool cliMode = false;
 #include "sensors/sensors.h"
 
 #include "telemetry/frsky_hub.h"
+#include "telemetry/mavlink.h"
+#include "telemetry/mavlink_offboard.h"
 #include "telemetry/telemetry.h"
 
 #include "cli.h"
@@ -1746,9 +1754,10 @@ RAM_CODE static void cliSerialPassthrough(const char *cmdName, char *cmdline)
 
             // If this port has a rx callback associated we need to remove it now.
             // Otherwise no data will be pushed in the serial port buffer!
-            if (cfg->port->rxCallback) {
+            if (cfg->port->rxCallback || cfg->port->rxFrameCallback) {
                 cliPrintLinef("Port%d: Callback removed", portIndex);
                 cfg->port->rxCallback = NULL;
+                cfg->port->rxFrameCallback = NULL;
             }
         }
     }
@@ -2885,8 +2894,10 @@ RAM_CODE static void cliWaypoint(const char *cmdName, char *cmdline)
         };
         const flightPlanNavState_e state = flightPlanNavGetState();
         cliPrintLinef("  state: %s", (state < ARRAYLEN(stateNames)) ? stateNames[state] : "UNKNOWN");
-        const uint8_t currentDisplay = (config->waypointCount == 0) ? 0 : flightPlanNavGetCurrentIndex() + 1;
-        cliPrintLinef("  current waypoint: %u/%u", currentDisplay, config->waypointCount);
+        // the executor flies the stored mission, which is not the PG one with mission_storage = FLASH
+        const uint16_t missionCount = missionStoreGetCount();
+        const uint16_t currentDisplay = (missionCount == 0) ? 0 : flightPlanNavGetCurrentIndex() + 1;
+        cliPrintLinef("  current waypoint: %u/%u", currentDisplay, missionCount);
 
         const float distanceM = flightPlanNavGetDistanceToWaypointM();
         if (distanceM >= 0.0f) {
@@ -3105,6 +3116,166 @@ RAM_CODE static void cliWaypoint(const char *cmdName, char *cmdline)
     );
 }
 
+static const char * const geofenceTypeNames[] = {
+    "POLY_IN", "POLY_OUT", "CIRCLE_IN", "CIRCLE_OUT", "RETURN"
+};
+STATIC_ASSERT(GEOFENCE_ITEM_TYPE_COUNT == ARRAYLEN(geofenceTypeNames), geofenceTypeNames_array_length_mismatch);
+
+static void printGeofenceItem(dumpFlags_t dumpMask, bool equalsDefault, const geofenceItem_t *item, bool asDefault)
+{
+    const char *format = "geofence add %s %s %s %u";
+    char latBuffer[16];
+    char lonBuffer[16];
+    formatDecimalCoordinate(item->latitude, latBuffer);
+    formatDecimalCoordinate(item->longitude, lonBuffer);
+    const char *typeName = (item->type < ARRAYLEN(geofenceTypeNames)) ? geofenceTypeNames[item->type] : "UNKNOWN";
+
+    if (asDefault) {
+        cliDefaultPrintLinef(dumpMask, equalsDefault, format, typeName, latBuffer, lonBuffer, item->param);
+    } else {
+        cliDumpPrintLinef(dumpMask, equalsDefault, format, typeName, latBuffer, lonBuffer, item->param);
+    }
+}
+
+static void printGeofence(dumpFlags_t dumpMask, const geofenceConfig_t *geofenceConfig, const geofenceConfig_t *defaultGeofenceConfig, const char *headingStr)
+{
+    headingStr = cliPrintSectionHeading(dumpMask, false, headingStr);
+
+    bool equalsDefaultAll = false;
+    if (defaultGeofenceConfig && geofenceConfig->itemCount == defaultGeofenceConfig->itemCount) {
+        equalsDefaultAll = !memcmp(geofenceConfig->items, defaultGeofenceConfig->items, geofenceConfig->itemCount * sizeof(geofenceItem_t));
+    }
+
+    // items are appended, so replaying starts from an empty fence
+    cliDumpPrintLinef(dumpMask, equalsDefaultAll, "geofence clear");
+
+    for (uint32_t i = 0; i < geofenceConfig->itemCount; i++) {
+        const geofenceItem_t *item = &geofenceConfig->items[i];
+        bool equalsDefault = false;
+        if (defaultGeofenceConfig && i < defaultGeofenceConfig->itemCount) {
+            const geofenceItem_t *defaultItem = &defaultGeofenceConfig->items[i];
+            equalsDefault = !memcmp(item, defaultItem, sizeof(*item));
+            headingStr = cliPrintSectionHeading(dumpMask, !equalsDefault, headingStr);
+            printGeofenceItem(dumpMask, equalsDefault, defaultItem, true);
+        }
+        printGeofenceItem(dumpMask, equalsDefault, item, false);
+    }
+}
+
+static void cliGeofence(const char *cmdName, char *cmdline)
+{
+    geofenceConfig_t *config = geofenceConfigMutable();
+
+    if (config->itemCount > MAX_GEOFENCE_ITEMS) {
+        config->itemCount = 0;
+        cliPrintErrorLinef(cmdName, "GEOFENCE ITEM COUNT CORRUPTED, CLEARED");
+    }
+
+    if (isEmpty(cmdline) || strcasecmp(cmdline, "list") == 0) {
+        printGeofence(DUMP_MASTER, geofenceConfig(), NULL, NULL);
+        return;
+    }
+
+    enum { OP = 0, TYPE, LAT, LON, PARAM, MAX_ARGS };
+    char *args[MAX_ARGS] = { NULL };
+    int argCount = 0;
+    char *saveptr;
+    for (char *tok = strtok_r(cmdline, " ", &saveptr); tok; tok = strtok_r(NULL, " ", &saveptr)) {
+        if (argCount == MAX_ARGS) {
+            cliShowInvalidArgumentCountError(cmdName);
+            return;
+        }
+        args[argCount++] = tok;
+    }
+    if (argCount == 0) {
+        cliShowInvalidArgumentCountError(cmdName);
+        return;
+    }
+
+    if (strcasecmp(args[OP], "clear") == 0) {
+        config->itemCount = 0;
+        geofenceInvalidate();
+        cliPrintLine("Geofence cleared");
+        return;
+    }
+
+    if (strcasecmp(args[OP], "status") == 0) {
+        const bool valid = geofenceItemsValid(config->items, config->itemCount);
+        cliPrintLinef("Geofence items: %u%s", config->itemCount, valid ? "" : " (INVALID, NOT ENFORCED)");
+        const float distanceCm = geofenceDistanceToBoundaryCm(&positionEstimatorGetEstimate()->position);
+        if (distanceCm >= 0.0f) {
+            cliPrintLinef("  distance to boundary: %um", (unsigned)lrintf(distanceCm * 0.01f));
+        }
+        return;
+    }
+
+    if (strcasecmp(args[OP], "remove") == 0) {
+        if (argCount != 2) {
+            cliShowInvalidArgumentCountError(cmdName);
+            return;
+        }
+        char *endptr;
+        const long index = strtol(args[1], &endptr, 10);
+        if (*endptr != '\0' || index < 0 || index >= config->itemCount) {
+            cliShowArgumentRangeError(cmdName, "index", 0, MAX(config->itemCount, 1) - 1);
+            return;
+        }
+        for (int i = index; i < config->itemCount - 1; i++) {
+            config->items[i] = config->items[i + 1];
+        }
+        config->itemCount--;
+        geofenceInvalidate();
+        cliPrintLinef("Geofence item %ld removed, %d items remaining", index, config->itemCount);
+        return;
+    }
+
+    if (strcasecmp(args[OP], "add") != 0) {
+        cliPrintErrorLinef(cmdName, "INVALID OPERATION. USE: list, status, add, remove, clear");
+        return;
+    }
+    if (argCount != MAX_ARGS) {
+        cliShowInvalidArgumentCountError(cmdName);
+        return;
+    }
+    if (config->itemCount >= MAX_GEOFENCE_ITEMS) {
+        cliPrintErrorLinef(cmdName, "GEOFENCE LIST FULL");
+        return;
+    }
+
+    geofenceItem_t item;
+    item.type = GEOFENCE_ITEM_TYPE_COUNT;
+    for (uint8_t i = 0; i < ARRAYLEN(geofenceTypeNames); i++) {
+        if (strcasecmp(args[TYPE], geofenceTypeNames[i]) == 0) {
+            item.type = i;
+            break;
+        }
+    }
+    if (item.type == GEOFENCE_ITEM_TYPE_COUNT) {
+        cliPrintErrorLinef(cmdName, "INVALID TYPE. USE: POLY_IN, POLY_OUT, CIRCLE_IN, CIRCLE_OUT, RETURN");
+        return;
+    }
+    if (!parseDecimalCoordinate(args[LAT], &item.latitude) || item.latitude < -900000000 || item.latitude > 900000000) {
+        cliPrintErrorLinef(cmdName, "INVALID LATITUDE. USE: -90.0000000 to 90.0000000");
+        return;
+    }
+    if (!parseDecimalCoordinate(args[LON], &item.longitude) || item.longitude < -1800000000 || item.longitude > 1800000000) {
+        cliPrintErrorLinef(cmdName, "INVALID LONGITUDE. USE: -180.0000000 to 180.0000000");
+        return;
+    }
+    char *endptr;
+    const long param = strtol(args[PARAM], &endptr, 10);
+    if (*endptr != '\0' || param < 0 || param > UINT16_MAX) {
+        // vertex count of the polygon, or circle radius in metres
+        cliShowArgumentRangeError(cmdName, "param", 0, UINT16_MAX);
+        return;
+    }
+    item.param = param;
+
+    config->items[config->itemCount++] = item;
+    geofenceInvalidate();
+    printGeofenceItem(DUMP_MASTER, false, &item, false);
+}
+
 #endif // ENABLE_FLIGHT_PLAN
 
 #ifdef USE_SDCARD
@@ -6212,6 +6383,22 @@ RAM_CODE static void cliStatus(const char *cmdName, char *cmdline)
         if (dronecanIsInitialised()) {
             cliPrintLinef("DroneCAN: node %d, device %d", dronecanConfig()->node_id, dronecanConfig()->device);
 
+            dronecanRxStats_t rxStats;
+            dronecanGetRxStats(&rxStats);
+            cliPrintLinef("  RX: %d filters, ring peak %d/%d, overflows %u",
+                          rxStats.filters, rxStats.ringPeak, rxStats.ringSize, (unsigned)rxStats.ringOverflows);
+
+#if ENABLE_DRONECAN_ESC
+            if (isMotorProtocolDronecan()) {
+                dronecanEscStats_t escStats;
+                dronecanEscGetStats(&escStats);
+                cliPrintLinef("  ESC: %u direct, %u queued, %u dropped, status latency %uus avg %uus max %uus",
+                              (unsigned)escStats.directTransfers, (unsigned)escStats.queuedTransfers,
+                              (unsigned)escStats.droppedTransfers, (unsigned)escStats.latencyLastUs,
+                              (unsigned)escStats.latencyAvgUs, (unsigned)escStats.latencyMaxUs);
+            }
+#endif
+
             static const char * const nodeHealthNames[] = { "OK", "WARNING", "ERROR", "CRITICAL" };
             static const char * const nodeModeNames[] = { "OPERATIONAL", "INITIALISING", "MAINTENANCE", "UPDATING", "?", "?", "?", "OFFLINE" };
             for (uint8_t i = 0; i < dronecanNodesCount(); i++) {
@@ -6247,6 +6434,37 @@ RAM_CODE static void cliStatus(const char *cmdName, char *cmdline)
     }
 #endif
 
+#if defined(USE_TELEMETRY_MAVLINK)
+    uint32_t mavlinkBudget;
+    uint32_t mavlinkLinkRate;
+    if (mavlinkTelemetryGetBudget(&mavlinkBudget, &mavlinkLinkRate)) {
+        cliPrintLinef("MAVLink: budget %u/%u B/s", (unsigned)mavlinkBudget, (unsigned)mavlinkLinkRate);
+        uint32_t messageId;
+        uint16_t requestedDeciHz;
+        uint16_t achievedDeciHz;
+        for (uint8_t i = 0; mavlinkTelemetryGetStreamRate(i, &messageId, &requestedDeciHz, &achievedDeciHz); i++) {
+            if (requestedDeciHz) {
+                cliPrintLinef("  msg %u: %u.%u/%u.%u Hz", (unsigned)messageId,
+                              achievedDeciHz / 10, achievedDeciHz % 10, requestedDeciHz / 10, requestedDeciHz % 10);
+            }
+        }
+    }
+#endif
+
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    if (mavlinkOffboardIsEnabled()) {
+        mavlinkOffboardStatus_t offboard;
+        mavlinkOffboardGetStatus(&offboard);
+        cliPrintLinef("MAVLink offboard: att %u Hz, pos %u Hz, dropped %u, setpoints %u/%u",
+                      offboard.attitudeRateHz, offboard.positionRateHz, (unsigned)offboard.droppedSamples,
+                      (unsigned)offboard.setpointsAccepted, (unsigned)(offboard.setpointsAccepted + offboard.setpointsRejected));
+        if (offboard.timesyncValid) {
+            cliPrintLinef("  timesync: offset %d ms, rtt %u us",
+                          (int)(offboard.timesyncOffsetNs / 1000000), (unsigned)offboard.timesyncRttUs);
+        }
+    }
+#endif
+
 #if defined(USE_OSD)
     osdDisplayPortDevice_e displayPortDeviceType;
     displayPort_t *osdDisplayPort = osdGetDisplayPort(&displayPortDeviceType);
@@ -6375,6 +6593,12 @@ RAM_CODE static void cliTasks(const char *cmdName, char *cmdline)
         uint32_t checkFuncAvgLoad10 = timeSinceTasksUs ? (uint32_t)((checkFuncTotalSinceUs * 1000.0f) / timeSinceTasksUs) : 0;
         cliPrintLinef("Check Functions (RX, ...) %11d %7d %12d.%1d%% %9d", checkFuncInfo.maxExecutionTimeUs, checkFuncInfo.averageExecutionTimeUs,
                       checkFuncAvgLoad10 / 10, checkFuncAvgLoad10 %10, checkFuncInfo.totalExecutionTimeUs / 1000);
+#ifdef USE_LED_STRIP
+        ws2811UpdateStats_t ledUpdateStats;
+        ws2811GetUpdateStats(&ledUpdateStats);
+        cliPrintLinef("LED strip update %20d %7d   pixels %d sent %d skipped %d", ledUpdateStats.maxUpdateUs, ledUpdateStats.lastUpdateUs,
+                      ledUpdateStats.pixelsWritten, ledUpdateStats.framesSent, ledUpdateStats.framesSkipped);
+#endif
         cliPrintLinef("Total %52d.%1d%%", averageLoadSum/10, averageLoadSum%10);
         if (debugMode == DEBUG_SCHEDULER_DETERMINISM) {
             extern int32_t schedLoopStartCycles, taskGuardCycles;
@@ -6721,6 +6945,45 @@ RAM_CODE static void cliRcSmoothing(const char *cmdName, char *cmdline)
 }
 #endif // USE_RC_SMOOTHING_FILTER
 
+#ifdef USE_RC_LATENCY_STATS
+static void cliRcLatency(const char *cmdName, char *cmdline)
+{
+    if (strcasecmp(cmdline, "reset") == 0) {
+        rcLatencyReset();
+        cliPrintLine("RC latency statistics reset");
+        return;
+    } else if (!isEmpty(cmdline)) {
+        cliShowParseError(cmdName);
+        return;
+    }
+
+    cliPrintLine("     Stage    Count    Avg    Min    Max   Last  (us)");
+    for (int stage = 0; stage < RC_LATENCY_STAGE_COUNT; stage++) {
+        const rcLatencyStats_t *stats = rcLatencyGetStats(stage);
+        cliPrintLinef("%10s %8u %6u %6u %6u %6u", rcLatencyGetStageName(stage), stats->count,
+            rcLatencyGetAverageUs(stage), stats->minUs, stats->maxUs, stats->lastUs);
+    }
+
+    cliPrintLinefeed();
+    cliPrint("Bucket (<us)");
+    for (int stage = 0; stage < RC_LATENCY_STAGE_COUNT; stage++) {
+        cliPrintf(" %10s", rcLatencyGetStageName(stage));
+    }
+    cliPrintLinefeed();
+    for (int bucket = 0; bucket < RC_LATENCY_BUCKET_COUNT; bucket++) {
+        if (bucket < RC_LATENCY_BUCKET_COUNT - 1) {
+            cliPrintf("%12u", RC_LATENCY_BUCKET_BASE_US << bucket);
+        } else {
+            cliPrint("        more");
+        }
+        for (int stage = 0; stage < RC_LATENCY_STAGE_COUNT; stage++) {
+            cliPrintf(" %10u", rcLatencyGetStats(stage)->bucket[bucket]);
+        }
+        cliPrintLinefeed();
+    }
+}
+#endif // USE_RC_LATENCY_STATS
+
 #if defined(USE_RESOURCE_MGMT)
 
 #define RESOURCE_VALUE_MAX_INDEX(x) ((x) == 0 ? 1 : (x))
@@ -8147,6 +8410,7 @@ static void printConfig(const char *cmdName, char *cmdline, bool doDiff)
 
 #if ENABLE_FLIGHT_PLAN
             printWaypoint(dumpMask, &flightPlanConfig_Copy, flightPlanConfig(), "waypoint");
+            printGeofence(dumpMask, &geofenceConfig_Copy, geofenceConfig(), "geofence");
 #endif
         }
 
@@ -8371,6 +8635,9 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("flash_scan", "scan flash device for errors", NULL, cliFlashVerify),
     CLI_COMMAND_DEF("flash_write", NULL, "<address> <message>", cliFlashWrite),
 #endif
+#endif
+#if ENABLE_FLIGHT_PLAN
+    CLI_COMMAND_DEF("geofence", "configure geofence zones", "list | status | add <type> <lat.ddddddd> <lon.ddddddd> <vertices|radius> | remove <idx> | clear", cliGeofence),
 #endif
     CLI_COMMAND_DEF("get", "get variable value", "[name]", cliGet),
 #ifdef USE_GPS
@@ -8413,6 +8680,9 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("battery_profile", "change battery profile", "[<index>]", cliBatteryProfile),
     CLI_COMMAND_DEF("profile", "change profile", "[<index>]", cliProfile),
     CLI_COMMAND_DEF("rateprofile", "change rate profile", "[<index>]", cliRateProfile),
+#ifdef USE_RC_LATENCY_STATS
+    CLI_COMMAND_DEF("rc_latency", "show stick to motor latency statistics", "[reset]", cliRcLatency),
+#endif
 #ifdef USE_RC_SMOOTHING_FILTER
     CLI_COMMAND_DEF("rc_smoothing_info", "show rc_smoothing operational settings", NULL, cliRcSmoothing),
 #endif // USE_RC_SMOOTHING_FILTER
@@ -94,7 +94,10 @@
 #include "pg/displayport_profiles.h"
 #include "pg/dyn_notch.h"
 #include "pg/flash.h"
+#include "pg/flight_plan.h"
+#include "pg/geofence.h"
 #include "pg/gimbal.h"
+#include "pg/mavlink_offboard.h"
 #include "pg/gyrodev.h"
 #include "pg/max7456.h"
 #include "pg/mco.h"
@@ -220,6 +223,16 @@ static const char * const lookupTableApRxLossPolicy[] = {
 static const char * const lookupTableApGeofenceAction[] = {
     "LAND", "RTH"
 };
+
+static const char * const lookupTableApNavPathMode[] = {
+    "CARROT", "SMOOTH"
+};
+#endif
+
+#ifdef USE_MISSION_STORE
+static const char * const lookupTableMissionStorage[] = {
+    "PG", "FLASH"
+};
 #endif
 
 #ifdef USE_SERVOS
@@ -597,6 +610,10 @@ const lookupTableEntry_t lookupTables[] = {
     LOOKUP_TABLE_ENTRY(lookupTableApYawMode),
     LOOKUP_TABLE_ENTRY(lookupTableApRxLossPolicy),
     LOOKUP_TABLE_ENTRY(lookupTableApGeofenceAction),
+    LOOKUP_TABLE_ENTRY(lookupTableApNavPathMode),
+#endif
+#ifdef USE_MISSION_STORE
+    LOOKUP_TABLE_ENTRY(lookupTableMissionStorage),
 #endif
 #ifdef USE_GPS_RESCUE
     LOOKUP_TABLE_ENTRY(lookupTableRescueSanityType),
@@ -1448,6 +1465,10 @@ const clivalue_t valueTable[] = {
     { "mavlink_extra2_rate", VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 50 }, PG_TELEMETRY_CONFIG, offsetof(telemetryConfig_t, mavlink_extra2_rate) },
     { "mavlink_extra3_rate", VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 50 }, PG_TELEMETRY_CONFIG, offsetof(telemetryConfig_t, mavlink_extra3_rate) },
 #endif
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    { "mavlink_offboard_att_rate", VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 10, 250 }, PG_MAVLINK_OFFBOARD_CONFIG, offsetof(mavlinkOffboardConfig_t, offboard_attitude_rate_hz) },
+    { "mavlink_offboard_pos_rate", VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 10, TASK_ALTITUDE_RATE_HZ }, PG_MAVLINK_OFFBOARD_CONFIG, offsetof(mavlinkOffboardConfig_t, offboard_position_rate_hz) },
+#endif
 #ifdef USE_TELEMETRY_SENSORS_DISABLED_DETAILS
     { "telemetry_disabled_voltage",         VAR_UINT32  | MASTER_VALUE | MODE_BITSET, .config.bitpos = LOG2(SENSOR_VOLTAGE),         PG_TELEMETRY_CONFIG, offsetof(telemetryConfig_t, disabledSensors)},
     { "telemetry_disabled_current",         VAR_UINT32  | MASTER_VALUE | MODE_BITSET, .config.bitpos = LOG2(SENSOR_CURRENT),         PG_TELEMETRY_CONFIG, offsetof(telemetryConfig_t, disabledSensors)},
@@ -2011,6 +2032,11 @@ const clivalue_t valueTable[] = {
     { PARAM_NAME_ALTITUDE_LPF,          VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 10, 5000 }, PG_POSITION, offsetof(positionConfig_t, altitude_lpf) },
     { "rangefinder_max_range_cm",       VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 50, 1000 }, PG_POSITION, offsetof(positionConfig_t, rangefinder_max_range_cm) },
     { PARAM_NAME_ALTITUDE_D_LPF,        VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 10, 5000 }, PG_POSITION, offsetof(positionConfig_t, altitude_d_lpf) },
+    { "gps_delay_ms",                   VAR_UINT8  | MASTER_VALUE, .config.minmaxUnsigned = { 0, POSITION_MAX_MEASUREMENT_DELAY_MS }, PG_POSITION, offsetof(positionConfig_t, gps_delay_ms) },
+    { "opticalflow_delay_ms",           VAR_UINT8  | MASTER_VALUE, .config.minmaxUnsigned = { 0, POSITION_MAX_MEASUREMENT_DELAY_MS }, PG_POSITION, offsetof(positionConfig_t, opticalflow_delay_ms) },
+#ifdef USE_POSITION_EKF
+    { "position_ekf",                   VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON }, PG_POSITION, offsetof(positionConfig_t, position_ekf) },
+#endif
 
 // PG_AUTOPILOT
 #ifndef USE_WING
@@ -2055,6 +2081,9 @@ const clivalue_t valueTable[] = {
     { PARAM_NAME_AP_NAV_CARROT_LEAD_TIME,    VAR_UINT8  | MASTER_VALUE, .config.minmaxUnsigned = { 2, 40 },      PG_AUTOPILOT, offsetof(autopilotConfig_t, navCarrotLeadTime) },
     { PARAM_NAME_AP_NAV_CARROT_LEAD_MAX,     VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 600, 6000 },  PG_AUTOPILOT, offsetof(autopilotConfig_t, navCarrotLeadMax) },
     { PARAM_NAME_AP_NAV_PRETURN_DIST,        VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 500, 5000 },  PG_AUTOPILOT, offsetof(autopilotConfig_t, navPreturnDist) },
+    { PARAM_NAME_AP_NAV_PATH_MODE,           VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_AP_NAV_PATH_MODE }, PG_AUTOPILOT, offsetof(autopilotConfig_t, navPathMode) },
+    { PARAM_NAME_AP_NAV_LATERAL_ACCEL,       VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 50, 1500 },   PG_AUTOPILOT, offsetof(autopilotConfig_t, navLateralAccel) },
+    { PARAM_NAME_AP_NAV_JERK,                VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 50, 5000 },   PG_AUTOPILOT, offsetof(autopilotConfig_t, navJerk) },
 
     // Phase 5: Velocity buildup
     { PARAM_NAME_AP_VELOCITY_BUILDUP_MAX_PITCH, VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 20 },   PG_AUTOPILOT, offsetof(autopilotConfig_t, velocityBuildupMaxPitch) },
@@ -2088,6 +2117,10 @@ const clivalue_t valueTable[] = {
     { PARAM_NAME_AP_RX_LOSS_POLICY,          VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_AP_RX_LOSS_POLICY }, PG_AUTOPILOT, offsetof(autopilotConfig_t, rxLossPolicy) },
     { PARAM_NAME_AP_MAX_DISTANCE_FROM_HOME,  VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 10000 }, PG_AUTOPILOT, offsetof(autopilotConfig_t, maxDistanceFromHomeM) },
     { PARAM_NAME_AP_GEOFENCE_ACTION,         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_AP_GEOFENCE_ACTION }, PG_AUTOPILOT, offsetof(autopilotConfig_t, geofenceAction) },
+    { PARAM_NAME_GEOFENCE_LOOKAHEAD,         VAR_UINT8  | MASTER_VALUE, .config.minmaxUnsigned = { 0, 100 }, PG_GEOFENCE_CONFIG, offsetof(geofenceConfig_t, lookaheadDs) },
+#ifdef USE_MISSION_STORE
+    { PARAM_NAME_MISSION_STORAGE,            VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_MISSION_STORAGE }, PG_FLIGHT_PLAN_CONFIG, offsetof(flightPlanConfig_t, missionStorage) },
+#endif
 #endif // ENABLE_FLIGHT_PLAN
 #endif // !USE_WING
 
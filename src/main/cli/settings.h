@@ -38,6 +38,10 @@ typedef enum {
     TABLE_AP_YAW_MODE,
     TABLE_AP_RX_LOSS_POLICY,
     TABLE_AP_GEOFENCE_ACTION,
+    TABLE_AP_NAV_PATH_MODE,
+#endif
+#ifdef USE_MISSION_STORE
+    TABLE_MISSION_STORAGE,
 #endif
 #ifdef USE_GPS_RESCUE
     TABLE_GPS_RESCUE_SANITY_CHECK,
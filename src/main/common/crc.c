@@ -26,17 +26,85 @@
 
 #include "streambuf.h"
 
+// One lookup per byte instead of eight shift and conditional xor steps, for
+// the polynomials on the protocol hot paths: CRSF, GHST and MSPv2 frames, and
+// the config and SRXL checksums. Other polynomials use crc8_calc().
+static const uint16_t crc16_ccitt_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+static const uint8_t crc8_dvb_s2_table[256] = {
+    0x00, 0xd5, 0x7f, 0xaa, 0xfe, 0x2b, 0x81, 0x54, 0x29, 0xfc, 0x56, 0x83, 0xd7, 0x02, 0xa8, 0x7d,
+    0x52, 0x87, 0x2d, 0xf8, 0xac, 0x79, 0xd3, 0x06, 0x7b, 0xae, 0x04, 0xd1, 0x85, 0x50, 0xfa, 0x2f,
+    0xa4, 0x71, 0xdb, 0x0e, 0x5a, 0x8f, 0x25, 0xf0, 0x8d, 0x58, 0xf2, 0x27, 0x73, 0xa6, 0x0c, 0xd9,
+    0xf6, 0x23, 0x89, 0x5c, 0x08, 0xdd, 0x77, 0xa2, 0xdf, 0x0a, 0xa0, 0x75, 0x21, 0xf4, 0x5e, 0x8b,
+    0x9d, 0x48, 0xe2, 0x37, 0x63, 0xb6, 0x1c, 0xc9, 0xb4, 0x61, 0xcb, 0x1e, 0x4a, 0x9f, 0x35, 0xe0,
+    0xcf, 0x1a, 0xb0, 0x65, 0x31, 0xe4, 0x4e, 0x9b, 0xe6, 0x33, 0x99, 0x4c, 0x18, 0xcd, 0x67, 0xb2,
+    0x39, 0xec, 0x46, 0x93, 0xc7, 0x12, 0xb8, 0x6d, 0x10, 0xc5, 0x6f, 0xba, 0xee, 0x3b, 0x91, 0x44,
+    0x6b, 0xbe, 0x14, 0xc1, 0x95, 0x40, 0xea, 0x3f, 0x42, 0x97, 0x3d, 0xe8, 0xbc, 0x69, 0xc3, 0x16,
+    0xef, 0x3a, 0x90, 0x45, 0x11, 0xc4, 0x6e, 0xbb, 0xc6, 0x13, 0xb9, 0x6c, 0x38, 0xed, 0x47, 0x92,
+    0xbd, 0x68, 0xc2, 0x17, 0x43, 0x96, 0x3c, 0xe9, 0x94, 0x41, 0xeb, 0x3e, 0x6a, 0xbf, 0x15, 0xc0,
+    0x4b, 0x9e, 0x34, 0xe1, 0xb5, 0x60, 0xca, 0x1f, 0x62, 0xb7, 0x1d, 0xc8, 0x9c, 0x49, 0xe3, 0x36,
+    0x19, 0xcc, 0x66, 0xb3, 0xe7, 0x32, 0x98, 0x4d, 0x30, 0xe5, 0x4f, 0x9a, 0xce, 0x1b, 0xb1, 0x64,
+    0x72, 0xa7, 0x0d, 0xd8, 0x8c, 0x59, 0xf3, 0x26, 0x5b, 0x8e, 0x24, 0xf1, 0xa5, 0x70, 0xda, 0x0f,
+    0x20, 0xf5, 0x5f, 0x8a, 0xde, 0x0b, 0xa1, 0x74, 0x09, 0xdc, 0x76, 0xa3, 0xf7, 0x22, 0x88, 0x5d,
+    0xd6, 0x03, 0xa9, 0x7c, 0x28, 0xfd, 0x57, 0x82, 0xff, 0x2a, 0x80, 0x55, 0x01, 0xd4, 0x7e, 0xab,
+    0x84, 0x51, 0xfb, 0x2e, 0x7a, 0xaf, 0x05, 0xd0, 0xad, 0x78, 0xd2, 0x07, 0x53, 0x86, 0x2c, 0xf9,
+};
+
+static const uint8_t crc8_poly_0xba_table[256] = {
+    0x00, 0xba, 0xce, 0x74, 0x26, 0x9c, 0xe8, 0x52, 0x4c, 0xf6, 0x82, 0x38, 0x6a, 0xd0, 0xa4, 0x1e,
+    0x98, 0x22, 0x56, 0xec, 0xbe, 0x04, 0x70, 0xca, 0xd4, 0x6e, 0x1a, 0xa0, 0xf2, 0x48, 0x3c, 0x86,
+    0x8a, 0x30, 0x44, 0xfe, 0xac, 0x16, 0x62, 0xd8, 0xc6, 0x7c, 0x08, 0xb2, 0xe0, 0x5a, 0x2e, 0x94,
+    0x12, 0xa8, 0xdc, 0x66, 0x34, 0x8e, 0xfa, 0x40, 0x5e, 0xe4, 0x90, 0x2a, 0x78, 0xc2, 0xb6, 0x0c,
+    0xae, 0x14, 0x60, 0xda, 0x88, 0x32, 0x46, 0xfc, 0xe2, 0x58, 0x2c, 0x96, 0xc4, 0x7e, 0x0a, 0xb0,
+    0x36, 0x8c, 0xf8, 0x42, 0x10, 0xaa, 0xde, 0x64, 0x7a, 0xc0, 0xb4, 0x0e, 0x5c, 0xe6, 0x92, 0x28,
+    0x24, 0x9e, 0xea, 0x50, 0x02, 0xb8, 0xcc, 0x76, 0x68, 0xd2, 0xa6, 0x1c, 0x4e, 0xf4, 0x80, 0x3a,
+    0xbc, 0x06, 0x72, 0xc8, 0x9a, 0x20, 0x54, 0xee, 0xf0, 0x4a, 0x3e, 0x84, 0xd6, 0x6c, 0x18, 0xa2,
+    0xe6, 0x5c, 0x28, 0x92, 0xc0, 0x7a, 0x0e, 0xb4, 0xaa, 0x10, 0x64, 0xde, 0x8c, 0x36, 0x42, 0xf8,
+    0x7e, 0xc4, 0xb0, 0x0a, 0x58, 0xe2, 0x96, 0x2c, 0x32, 0x88, 0xfc, 0x46, 0x14, 0xae, 0xda, 0x60,
+    0x6c, 0xd6, 0xa2, 0x18, 0x4a, 0xf0, 0x84, 0x3e, 0x20, 0x9a, 0xee, 0x54, 0x06, 0xbc, 0xc8, 0x72,
+    0xf4, 0x4e, 0x3a, 0x80, 0xd2, 0x68, 0x1c, 0xa6, 0xb8, 0x02, 0x76, 0xcc, 0x9e, 0x24, 0x50, 0xea,
+    0x48, 0xf2, 0x86, 0x3c, 0x6e, 0xd4, 0xa0, 0x1a, 0x04, 0xbe, 0xca, 0x70, 0x22, 0x98, 0xec, 0x56,
+    0xd0, 0x6a, 0x1e, 0xa4, 0xf6, 0x4c, 0x38, 0x82, 0x9c, 0x26, 0x52, 0xe8, 0xba, 0x00, 0x74, 0xce,
+    0xc2, 0x78, 0x0c, 0xb6, 0xe4, 0x5e, 0x2a, 0x90, 0x8e, 0x34, 0x40, 0xfa, 0xa8, 0x12, 0x66, 0xdc,
+    0x5a, 0xe0, 0x94, 0x2e, 0x7c, 0xc6, 0xb2, 0x08, 0x16, 0xac, 0xd8, 0x62, 0x30, 0x8a, 0xfe, 0x44,
+};
+
 uint16_t crc16_ccitt(uint16_t crc, unsigned char a)
 {
-    crc ^= (uint16_t)a << 8;
-    for (int ii = 0; ii < 8; ++ii) {
-        if (crc & 0x8000) {
-            crc = (crc << 1) ^ 0x1021;
-        } else {
-            crc = crc << 1;
-        }
-    }
-    return crc;
+    return (crc << 8) ^ crc16_ccitt_table[(crc >> 8) ^ a];
 }
 
 uint16_t crc16_ccitt_update(uint16_t crc, const void *data, uint32_t length)
@@ -52,12 +120,8 @@ uint16_t crc16_ccitt_update(uint16_t crc, const void *data, uint32_t length)
 
 void crc16_ccitt_sbuf_append(sbuf_t *dst, uint8_t *start)
 {
-    uint16_t crc = 0;
     const uint8_t * const end = sbufPtr(dst);
-    for (const uint8_t *ptr = start; ptr < end; ++ptr) {
-        crc = crc16_ccitt(crc, *ptr);
-    }
-    sbufWriteU16(dst, crc);
+    sbufWriteU16(dst, crc16_ccitt_update(0, start, end - start));
 }
 
 uint8_t crc8_calc(uint8_t crc, unsigned char a, uint8_t poly)
@@ -94,6 +158,50 @@ void crc8_sbuf_append(sbuf_t *dst, uint8_t *start, uint8_t poly)
     sbufWriteU8(dst, crc);
 }
 
+uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a)
+{
+    return crc8_dvb_s2_table[crc ^ a];
+}
+
+uint8_t crc8_dvb_s2_update(uint8_t crc, const void *data, uint32_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *pend = p + length;
+
+    for (; p != pend; p++) {
+        crc = crc8_dvb_s2_table[crc ^ *p];
+    }
+    return crc;
+}
+
+void crc8_dvb_s2_sbuf_append(sbuf_t *dst, uint8_t *start)
+{
+    const uint8_t * const end = sbufPtr(dst);
+    sbufWriteU8(dst, crc8_dvb_s2_update(0, start, end - start));
+}
+
+uint8_t crc8_poly_0xba(uint8_t crc, unsigned char a)
+{
+    return crc8_poly_0xba_table[crc ^ a];
+}
+
+uint8_t crc8_poly_0xba_update(uint8_t crc, const void *data, uint32_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *pend = p + length;
+
+    for (; p != pend; p++) {
+        crc = crc8_poly_0xba_table[crc ^ *p];
+    }
+    return crc;
+}
+
+void crc8_poly_0xba_sbuf_append(sbuf_t *dst, uint8_t *start)
+{
+    const uint8_t * const end = sbufPtr(dst);
+    sbufWriteU8(dst, crc8_poly_0xba_update(0, start, end - start));
+}
+
 uint8_t crc8_xor_update(uint8_t crc, const void *data, uint32_t length)
 {
     const uint8_t *p = (const uint8_t *)data;
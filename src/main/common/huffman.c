@@ -18,86 +18,145 @@
  * If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "platform.h"
 
 #ifdef USE_HUFFMAN
 
 #include "huffman.h"
 
-int huffmanEncodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable)
+/*
+ * Codes are emitted whole through a 32-bit accumulator, most significant bit
+ * first: at most 7 bits are left over from the previous code and codes are at
+ * most HUFFMAN_CODE_LEN_MAX bits, so a code always fits below them. Completed
+ * bytes are then written out a byte at a time.
+ */
+int huffmanEncodeBufStreaming(huffmanState_t *state, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable)
 {
-    int ret = 0;
-
-    uint8_t *outByte = outBuf;
-    *outByte = 0;
-    uint8_t outBit = 0x80;
-
-    for (int ii = 0; ii < inLen; ++ii) {
-        const int huffCodeLen = huffmanTable[*inBuf].codeLen;
-        const uint16_t huffCode = huffmanTable[*inBuf].code << 4;
-        ++inBuf;
-        uint16_t testBit = 0x8000;
-
-        for (int jj = 0; jj < huffCodeLen; ++jj) {
-            if (huffCode & testBit) {
-                *outByte |= outBit;
-            }
-
-            testBit >>= 1;
-            outBit >>= 1;
-            if (outBit == 0) {
-                outBit = 0x80;
-                ++outByte;
-                *outByte = 0;
-                ++ret;
-            }
+    uint8_t *outByte = state->outByte;
+    uint16_t bytesWritten = state->bytesWritten;
+    // bits of *outByte already used by the previous call
+    int bitCount = __builtin_clz(state->outBit) - 24;
+    uint32_t bits = bitCount ? (uint32_t)*outByte << 24 : 0;
+    const uint8_t savedOutByte = bitCount ? *outByte : 0;
 
-            if (ret >= outBufLen && ii < inLen - 1 && jj < huffCodeLen - 1) {
+    for (const uint8_t *pos = inBuf, *end = inBuf + inLen; pos < end; ++pos) {
+        const huffmanTable_t *entry = &huffmanTable[*pos];
+        // code holds the top 12 bits of a 16-bit left aligned code
+        bits |= (uint32_t)entry->code << (32 - HUFFMAN_CODE_LEN_MAX - bitCount);
+        bitCount += entry->codeLen;
+
+        while (bitCount >= 8) {
+            if (bytesWritten >= state->outBufLen) {
+                // buffer filled before the input was compressed: leave the
+                // state as it was, none of this input has been written
+                if (state->outBit != 0x80) {
+                    *state->outByte = savedOutByte;
+                }
                 return -1;
             }
+            *outByte++ = bits >> 24;
+            ++bytesWritten;
+            bits <<= 8;
+            bitCount -= 8;
         }
     }
-    if (outBit != 0x80) {
-        // ensure last character in output buffer is counted
-        ++ret;
+
+    if (bitCount) {
+        if (bytesWritten >= state->outBufLen) {
+            if (state->outBit != 0x80) {
+                *state->outByte = savedOutByte;
+            }
+            return -1;
+        }
+        // partial byte, completed by the next call
+        *outByte = bits >> 24;
     }
-    return ret;
+
+    state->outByte = outByte;
+    state->bytesWritten = bytesWritten;
+    state->outBit = 0x80 >> bitCount;
+    return 0;
 }
 
-int huffmanEncodeBufStreaming(huffmanState_t *state, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable)
+int huffmanEncodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable)
 {
-    uint8_t *savedOutBytePtr = state->outByte;
-    uint8_t savedOutByte = *savedOutBytePtr;
+    huffmanState_t state = {
+        .outByte = outBuf,
+        .bytesWritten = 0,
+        .outBufLen = outBufLen,
+        .outBit = 0x80,
+    };
+
+    if (huffmanEncodeBufStreaming(&state, inBuf, inLen, huffmanTable) < 0) {
+        return -1;
+    }
+    // ensure last character in output buffer is counted
+    return state.bytesWritten + (state.outBit != 0x80 ? 1 : 0);
+}
 
-    for (const uint8_t *pos = inBuf, *end = inBuf + inLen; pos < end; ++pos) {
-        const int huffCodeLen = huffmanTable[*pos].codeLen;
-        const uint16_t huffCode = huffmanTable[*pos].code << 4;
-        uint16_t testBit = 0x8000;
+bool huffmanBuildDecodeTable(huffmanDecodeTable_t *decodeTable, const huffmanTable_t *huffmanTable)
+{
+    memset(decodeTable, 0, sizeof(*decodeTable));
 
-        for (int jj = 0; jj < huffCodeLen; ++jj) {
-            if (huffCode & testBit) {
-                *state->outByte |= state->outBit;
+    for (int symbol = 0; symbol < HUFFMAN_TABLE_SIZE; symbol++) {
+        const int codeLen = huffmanTable[symbol].codeLen;
+        const unsigned code = huffmanTable[symbol].code;
+        if (codeLen == 0 || codeLen > HUFFMAN_CODE_LEN_MAX) {
+            return false;
+        }
+        // every window of HUFFMAN_CODE_LEN_MAX bits that starts with this code
+        const unsigned count = 1U << (HUFFMAN_CODE_LEN_MAX - codeLen);
+        if (code & (count - 1)) {
+            return false;
+        }
+        for (unsigned ii = 0; ii < count; ii++) {
+            huffmanDecodeEntry_t *entry = &decodeTable->entries[code + ii];
+            if (entry->codeLen) {
+                // not a prefix code
+                return false;
             }
+            entry->symbol = symbol;
+            entry->codeLen = codeLen;
+        }
+    }
+    return true;
+}
 
-            testBit >>= 1;
-            state->outBit >>= 1;
-            if (state->outBit == 0) {
-                state->outBit = 0x80;
-                ++state->outByte;
-                *state->outByte = 0;
-                ++state->bytesWritten;
-            }
+int huffmanDecodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inBufLen, int inBufCharacterCount, const huffmanDecodeTable_t *decodeTable)
+{
+    if (inBufCharacterCount > outBufLen) {
+        return -1;
+    }
 
-            // if buffer is filled and we haven't finished compressing
-            if (state->bytesWritten >= state->outBufLen && (pos < end - 1 || jj < huffCodeLen - 1)) {
-                // restore savedOutByte
-                *savedOutBytePtr = savedOutByte;
-                return -1;
-            }
+    const uint8_t *inEnd = inBuf + inBufLen;
+    // left aligned, as written by the encoder
+    uint32_t bits = 0;
+    int bitCount = 0;
+    int outCount = 0;
+
+    while (outCount < inBufCharacterCount) {
+        while (bitCount <= 24 && inBuf < inEnd) {
+            bits |= (uint32_t)*inBuf++ << (24 - bitCount);
+            bitCount += 8;
         }
-    }
 
-    return 0;
+        const huffmanDecodeEntry_t *entry = &decodeTable->entries[bits >> (32 - HUFFMAN_CODE_LEN_MAX)];
+        if (entry->codeLen == 0 || entry->codeLen > bitCount) {
+            // input ended inside a code, or no such code
+            return -1;
+        }
+        if (entry->symbol == HUFFMAN_EOF_SYMBOL) {
+            break;
+        }
+        outBuf[outCount++] = entry->symbol;
+        bits <<= entry->codeLen;
+        bitCount -= entry->codeLen;
+    }
+    return outCount;
 }
 
 #endif
@@ -20,9 +20,12 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define HUFFMAN_TABLE_SIZE 257 // 256 characters plus EOF
+#define HUFFMAN_EOF_SYMBOL 256
+#define HUFFMAN_CODE_LEN_MAX 12
 typedef struct huffmanTable_s {
     uint16_t    codeLen:4;
     uint16_t    code:12;
@@ -35,6 +38,17 @@ typedef struct huffmanState_s {
     uint8_t     outBit;
 } huffmanState_t;
 
+// Decoding looks up the next HUFFMAN_CODE_LEN_MAX bits of input, which
+// gives the symbol and the length of the code they start with
+typedef struct huffmanDecodeEntry_s {
+    uint16_t    symbol;         // character, or HUFFMAN_EOF_SYMBOL
+    uint8_t     codeLen;        // 0 if no code starts with these bits
+} huffmanDecodeEntry_t;
+
+typedef struct huffmanDecodeTable_s {
+    huffmanDecodeEntry_t entries[1 << HUFFMAN_CODE_LEN_MAX];
+} huffmanDecodeTable_t;
+
 extern const huffmanTable_t huffmanTable[HUFFMAN_TABLE_SIZE];
 
 struct huffmanInfo_s {
@@ -44,4 +58,12 @@ struct huffmanInfo_s {
 #define HUFFMAN_INFO_SIZE sizeof(struct huffmanInfo_s)
 
 int huffmanEncodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable);
+// Returns -1, leaving state unchanged, if the output buffer would overflow
 int huffmanEncodeBufStreaming(huffmanState_t *state, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable);
+
+// For host tools and tests, to check what MSP_DATAFLASH_READ sent.
+// Returns false if huffmanTable is not a prefix code.
+bool huffmanBuildDecodeTable(huffmanDecodeTable_t *decodeTable, const huffmanTable_t *huffmanTable);
+// Decodes inBufCharacterCount characters, stopping early at EOF. Returns the
+// number decoded, or -1 if outBuf is too small or the input is not valid.
+int huffmanDecodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inBufLen, int inBufCharacterCount, const huffmanDecodeTable_t *decodeTable);
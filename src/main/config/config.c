@@ -713,6 +713,9 @@ void validateAndFixGyroConfig(void)
     if (flightPlanConfigMutable()->waypointCount > MAX_WAYPOINTS) {
         flightPlanConfigMutable()->waypointCount = 0;
     }
+    if (flightPlanConfig()->missionStorage >= MISSION_STORAGE_COUNT) {
+        flightPlanConfigMutable()->missionStorage = MISSION_STORAGE_PG;
+    }
 #endif
 }
 
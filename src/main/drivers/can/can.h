@@ -84,7 +84,55 @@ bool canInit(canDevice_e device, uint32_t bitrate);
 bool canTransmit(canDevice_e device, uint32_t identifier, bool isExtended,
                  const uint8_t *data, uint8_t length);
 
+// One classic CAN frame, for callers that serialise frames ahead of time.
+typedef struct canFrame_s {
+    uint32_t id;                        // raw identifier (no XTD flag)
+    uint8_t  data[CAN_CLASSIC_MAX_DLC];
+    uint8_t  length;
+    bool     isExtended;
+} canFrame_t;
+
+// Transmit a run of classic CAN frames in order, all or nothing: returns
+// false without queueing any of them if the driver cannot take the whole
+// run right now, the device is uninitialised, or a frame is invalid. Lets a
+// multi-frame transfer go out back to back without a partial transfer ever
+// reaching the bus.
+bool canTransmitFrames(canDevice_e device, const canFrame_t *frames, uint8_t count);
+
 // Register a callback for received messages on the given device.
 // Passing NULL removes the callback. Only one callback per device is
 // supported; registering a new callback replaces any previous one.
 void canRegisterRxCallback(canDevice_e device, canRxCallbackPtr callback);
+
+// Longest filter list canSetFilters() takes.
+#define CAN_FILTER_LIST_MAX 32
+
+// Acceptance filter: a received frame of the same identifier kind matches
+// when (identifier & mask) == (id & mask).
+typedef struct canFilter_s {
+    uint32_t id;
+    uint32_t mask;
+    bool isExtended;
+} canFilter_t;
+
+// Filters of one identifier kind the device's controller holds in hardware.
+uint8_t canFilterCapacity(canDevice_e device, bool isExtended);
+
+// Replace the device's acceptance filters. The controller then drops every
+// frame no filter matches before it raises an interrupt; a count of zero
+// accepts everything again, which is also the state after canInit(). Lists
+// longer than canFilterCapacity() are merged down with canFilterReduce(), so
+// the result may pass more than asked but never less. May be called before
+// or after canInit(); reprogramming a running controller takes it off the
+// bus for a moment and drops frames waiting in its hardware FIFOs. Returns
+// false for an invalid device or more than CAN_FILTER_LIST_MAX filters.
+bool canSetFilters(canDevice_e device, const canFilter_t *filters, uint8_t count);
+
+// Merge filters of the given kind in place until at most `capacity` of them
+// are left, each time joining the pair whose union keeps the most mask
+// bits. Filters of the other kind are left as they are. Returns the new
+// count of the whole list.
+uint8_t canFilterReduce(canFilter_t *filters, uint8_t count, bool isExtended, uint8_t capacity);
+
+// True if the identifier passes the filter list (an empty list passes all).
+bool canFilterMatch(const canFilter_t *filters, uint8_t count, uint32_t identifier, bool isExtended);
@@ -0,0 +1,102 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#if ENABLE_CAN
+
+#include "common/utils.h"
+
+#include "drivers/can/can.h"
+
+// The smallest filter passing everything both pass: only bits both care
+// about and agree on stay in the mask
+static canFilter_t canFilterUnion(const canFilter_t *a, const canFilter_t *b)
+{
+    const uint32_t mask = a->mask & b->mask & ~(a->id ^ b->id);
+    const canFilter_t merged = {
+        .id = a->id & mask,
+        .mask = mask,
+        .isExtended = a->isExtended,
+    };
+    return merged;
+}
+
+uint8_t canFilterReduce(canFilter_t *filters, uint8_t count, bool isExtended, uint8_t capacity)
+{
+    for (;;) {
+        uint8_t kindCount = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            kindCount += filters[i].isExtended == isExtended;
+        }
+        if (kindCount <= capacity || kindCount < 2) {
+            return count;
+        }
+
+        // Join the pair that loses the fewest mask bits; identical filters
+        // lose none, so duplicates always go first
+        int bestBits = -1;
+        uint8_t bestA = 0;
+        uint8_t bestB = 0;
+        for (uint8_t a = 0; a < count; a++) {
+            if (filters[a].isExtended != isExtended) {
+                continue;
+            }
+            for (uint8_t b = a + 1; b < count; b++) {
+                if (filters[b].isExtended != isExtended) {
+                    continue;
+                }
+                const canFilter_t merged = canFilterUnion(&filters[a], &filters[b]);
+                const int bits = popcount32(merged.mask);
+                if (bits > bestBits) {
+                    bestBits = bits;
+                    bestA = a;
+                    bestB = b;
+                }
+            }
+        }
+
+        filters[bestA] = canFilterUnion(&filters[bestA], &filters[bestB]);
+        for (uint8_t i = bestB; i + 1 < count; i++) {
+            filters[i] = filters[i + 1];
+        }
+        count--;
+    }
+}
+
+bool canFilterMatch(const canFilter_t *filters, uint8_t count, uint32_t identifier, bool isExtended)
+{
+    if (count == 0) {
+        return true;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        const canFilter_t *filter = &filters[i];
+        if (filter->isExtended == isExtended && ((identifier ^ filter->id) & filter->mask) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // ENABLE_CAN
@@ -47,12 +47,7 @@
 #define CAN_TX_RING_MASK (CAN_TX_RING_SIZE - 1U)
 
 // One queued outgoing classic-CAN frame held in the software TX ring.
-typedef struct canTxFrame_s {
-    uint32_t id;                        // raw identifier (no XTD flag)
-    uint8_t  data[CAN_CLASSIC_MAX_DLC];
-    uint8_t  length;
-    bool     isExtended;
-} canTxFrame_t;
+typedef canFrame_t canTxFrame_t;
 
 typedef struct canPinDef_s {
     ioTag_t pin;
@@ -106,6 +101,11 @@ typedef struct canDevice_s {
     timeUs_t txStallSinceUs;            // when the snapshot was last refreshed
     volatile uint32_t txStallRecoveries;    // cancel-and-drop events (diagnostics)
 
+    // Acceptance filters from canSetFilters(), already merged down to the
+    // controller's capacity and kept so a re-init programs them again
+    canFilter_t filters[CAN_FILTER_LIST_MAX];
+    uint8_t filterCount;
+
     bool initialized;
 } canDevice_t;
 
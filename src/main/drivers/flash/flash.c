@@ -623,7 +623,7 @@ const flashGeometry_t *flashGetGeometry(void)
 
 static void flashConfigurePartitions(void)
 {
-#if defined(FIRMWARE_SIZE) || defined(CONFIG_IN_EXTERNAL_FLASH) || defined(CONFIG_IN_MEMORY_MAPPED_FLASH) || defined(USE_FLASHFS)
+#if defined(FIRMWARE_SIZE) || defined(CONFIG_IN_EXTERNAL_FLASH) || defined(CONFIG_IN_MEMORY_MAPPED_FLASH) || defined(USE_FLASHFS) || defined(USE_MISSION_STORE)
     const flashGeometry_t *flashGeometry = flashGetGeometry();
     if (flashGeometry->totalSize == 0) {
         return;
@@ -670,6 +670,24 @@ static void flashConfigurePartitions(void)
     startSector = 0;
 #endif
 
+#ifdef USE_MISSION_STORE
+    flashSector_t missionSectors = (FLASH_MISSION_PARTITION_SIZE / flashGeometry->sectorSize);
+
+    if (FLASH_MISSION_PARTITION_SIZE % flashGeometry->sectorSize > 0) {
+        missionSectors++; // needs a portion of a sector.
+    }
+
+    // never take more than half of what is left for blackbox
+    if (missionSectors <= (endSector + 1 - startSector) / 2) {
+        startSector = (endSector + 1) - missionSectors; // + 1 for inclusive
+
+        flashPartitionSet(FLASH_PARTITION_TYPE_MISSION, startSector, endSector);
+
+        endSector = startSector - 1;
+        startSector = 0;
+    }
+#endif
+
 #ifdef USE_FLASHFS
     flashPartitionSet(FLASH_PARTITION_TYPE_FLASHFS, startSector, endSector);
 #endif
@@ -720,6 +738,7 @@ static const char *flashPartitionNames[] = {
     "BBMGMT   ",
     "FIRMWARE ",
     "CONFIG   ",
+    "MISSION  ",
 };
 
 const char *flashPartitionGetTypeName(flashPartitionType_e type)
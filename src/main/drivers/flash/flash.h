@@ -29,6 +29,12 @@
 // Used to detect flashfs allocation size being too small.
 #define FLASH_MAX_PAGE_SIZE       2048
 
+// Flight plan mission partition, carved from the end of the flash before FlashFS on
+// targets that define USE_MISSION_STORE. 64KB holds about 4000 waypoints.
+#ifndef FLASH_MISSION_PARTITION_SIZE
+#define FLASH_MISSION_PARTITION_SIZE (64 * 1024)
+#endif
+
 #define SPIFLASH_INSTRUCTION_RDID 0x9F
 
 typedef enum {
@@ -100,6 +106,7 @@ typedef enum {
     FLASH_PARTITION_TYPE_BADBLOCK_MANAGEMENT,
     FLASH_PARTITION_TYPE_FIRMWARE,
     FLASH_PARTITION_TYPE_CONFIG,
+    FLASH_PARTITION_TYPE_MISSION,
     FLASH_MAX_PARTITIONS
 } flashPartitionType_e;
 
@@ -56,10 +56,72 @@ static bool needsFullRefresh = true;
 
 static hsvColor_t ledColorBuffer[WS2811_DATA_BUFFER_SIZE];
 
+// What the transfer buffer holds for each LED, before brightness scaling,
+// and which LEDs have been set to something else since
+static hsvColor_t ledSentBuffer[WS2811_DATA_BUFFER_SIZE];
+static uint32_t ledDirtyMask[(WS2811_DATA_BUFFER_SIZE + 31) / 32];
+static uint8_t sentBrightness;
+// The last frame's transfer did not start, so the transfer buffer holds
+// colours the LEDs have not been sent yet
+static bool resendPending;
+
+// A strip shows a handful of colours at a time, so conversions are looked up
+// in a small direct-mapped table before doing the HSV to RGB arithmetic
+#define WS2811_COLOR_TABLE_SIZE 8
+
+typedef struct ws2811ColorEntry_s {
+    hsvColor_t hsv;
+    rgbColor24bpp_t rgb;
+    bool valid;
+} ws2811ColorEntry_t;
+
+static ws2811ColorEntry_t colorTable[WS2811_COLOR_TABLE_SIZE];
+
+static ws2811UpdateStats_t updateStats;
+
+static bool hsvEqual(const hsvColor_t *a, const hsvColor_t *b)
+{
+    return a->h == b->h && a->s == b->s && a->v == b->v;
+}
+
+static void ledColorChanged(uint16_t index)
+{
+    if (hsvEqual(&ledColorBuffer[index], &ledSentBuffer[index])) {
+        ledDirtyMask[index / 32] &= ~(1U << (index % 32));
+    } else {
+        ledDirtyMask[index / 32] |= 1U << (index % 32);
+    }
+}
+
+// First LED from index on that needs writing to the transfer buffer, or count if none
+static unsigned nextDirtyLed(unsigned index, unsigned count)
+{
+    while (index < count) {
+        const uint32_t dirty = ledDirtyMask[index / 32] >> (index % 32);
+        if (dirty) {
+            return MIN(index + __builtin_ctz(dirty), count);
+        }
+        index = (index / 32 + 1) * 32;
+    }
+    return count;
+}
+
+static const rgbColor24bpp_t *ws2811Rgb24(const hsvColor_t *hsv)
+{
+    ws2811ColorEntry_t *entry = &colorTable[(hsv->h ^ hsv->s ^ (hsv->v >> 2)) % WS2811_COLOR_TABLE_SIZE];
+    if (!entry->valid || !hsvEqual(&entry->hsv, hsv)) {
+        entry->hsv = *hsv;
+        entry->rgb = *hsvToRgb24(hsv);
+        entry->valid = true;
+    }
+    return &entry->rgb;
+}
+
 #if !defined(USE_WS2811_SINGLE_COLOUR)
 void setLedHsv(uint16_t index, const hsvColor_t *color)
 {
     ledColorBuffer[index] = *color;
+    ledColorChanged(index);
 }
 
 void getLedHsv(uint16_t index, hsvColor_t *color)
@@ -70,11 +132,13 @@ void getLedHsv(uint16_t index, hsvColor_t *color)
 void setLedValue(uint16_t index, const uint8_t value)
 {
     ledColorBuffer[index].v = value;
+    ledColorChanged(index);
 }
 
 void scaleLedValue(uint16_t index, const uint8_t scalePercent)
 {
     ledColorBuffer[index].v = ((uint16_t)ledColorBuffer[index].v * scalePercent / 100);
+    ledColorChanged(index);
 }
 #endif
 
@@ -82,6 +146,7 @@ void setStripColor(const hsvColor_t *color)
 {
     for (unsigned index = 0; index < usedLedCount; index++) {
         ledColorBuffer[index] = *color;
+        ledColorChanged(index);
     }
 }
 
@@ -124,13 +189,25 @@ bool isWS2811LedStripReady(void)
     return ws2811Initialised && !ws2811LedDataTransferInProgress;
 }
 
+void ws2811GetUpdateStats(ws2811UpdateStats_t *stats)
+{
+    *stats = updateStats;
+}
+
 /*
  * This method is non-blocking unless an existing LED update is in progress.
  * it does not wait until all the LEDs have been updated, that happens in the background.
+ *
+ * Only LEDs whose colour changed since they were last written are converted and
+ * written to the transfer buffer, and a frame with no changes is not sent at all;
+ * the LEDs hold their colour and the buffer still holds the previous frame. A
+ * frame whose transfer was refused is sent again on the next call.
  */
 bool ws2811UpdateStrip(uint8_t brightness)
 {
     static uint8_t ledIndex = 0;
+    static uint16_t pixelsWritten = 0;
+    static uint32_t frameUpdateUs = 0;
     timeUs_t startTime = micros();
     // don't wait - risk of infinite block, just get an update next time round
     if (!ws2811Initialised || ws2811LedDataTransferInProgress) {
@@ -138,28 +215,63 @@ bool ws2811UpdateStrip(uint8_t brightness)
         return false;
     }
 
+    if (ledIndex == 0 && pixelsWritten == 0 && brightness != sentBrightness) {
+        // Every LED is scaled differently now
+        sentBrightness = brightness;
+        needsFullRefresh = true;
+    }
+
     // fill transmit buffer with correct compare values to achieve
     // correct pulse widths according to color values
     const unsigned ledUpdateCount = needsFullRefresh ? WS2811_DATA_BUFFER_SIZE : usedLedCount;
     const hsvColor_t hsvBlack = { 0, 0, 0 };
     while (ledIndex < ledUpdateCount) {
-        hsvColor_t scaledLed = ledIndex < usedLedCount ? ledColorBuffer[ledIndex] : hsvBlack;
-        // Scale the LED brightness
-        scaledLed.v = scaledLed.v * brightness / 100;
+        if (!needsFullRefresh) {
+            ledIndex = nextDirtyLed(ledIndex, ledUpdateCount);
+            if (ledIndex >= ledUpdateCount) {
+                break;
+            }
+        }
+        const hsvColor_t led = ledIndex < usedLedCount ? ledColorBuffer[ledIndex] : hsvBlack;
+        ledSentBuffer[ledIndex] = led;
+        ledDirtyMask[ledIndex / 32] &= ~(1U << (ledIndex % 32));
 
-        rgbColor24bpp_t *rgb24 = hsvToRgb24(&scaledLed);
+        // Scale the LED brightness
+        hsvColor_t scaledLed = led;
+        scaledLed.v = scaledLed.v * sentBrightness / 100;
 
-        ws2811LedStripUpdateTransferBuffer(rgb24, ledIndex++);
+        ws2811LedStripUpdateTransferBuffer(ws2811Rgb24(&scaledLed), ledIndex++);
+        pixelsWritten++;
 
         if (cmpTimeUs(micros(), startTime) > LED_TARGET_UPDATE_US) {
+            frameUpdateUs += cmpTimeUs(micros(), startTime);
             return false;
         }
     }
     ledIndex = 0;
     needsFullRefresh = false;
 
+    frameUpdateUs += cmpTimeUs(micros(), startTime);
+    updateStats.lastUpdateUs = MIN(frameUpdateUs, UINT16_MAX);
+    updateStats.maxUpdateUs = MAX(updateStats.maxUpdateUs, updateStats.lastUpdateUs);
+    updateStats.pixelsWritten = pixelsWritten;
+    frameUpdateUs = 0;
+
+    if (pixelsWritten == 0 && !resendPending) {
+        updateStats.framesSkipped++;
+        return true;
+    }
+    pixelsWritten = 0;
+
+    // Some platforms (ESP32) send the whole frame before returning, so only
+    // the start's own result says whether the LEDs got it
     ws2811LedDataTransferInProgress = true;
-    ws2811LedStripStartTransfer();
+    resendPending = !ws2811LedStripStartTransfer();
+    if (resendPending) {
+        ws2811LedDataTransferInProgress = false;
+    } else {
+        updateStats.framesSent++;
+    }
 
     return true;
 }
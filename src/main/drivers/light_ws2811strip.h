@@ -42,16 +42,26 @@ typedef enum {
     LED_GRBW
 } ledStripFormatRGB_e;
 
+typedef struct ws2811UpdateStats_s {
+    uint16_t lastUpdateUs;      // building the last frame, over all its passes
+    uint16_t maxUpdateUs;
+    uint16_t pixelsWritten;     // LEDs converted and written for the last frame
+    uint32_t framesSent;
+    uint32_t framesSkipped;     // unchanged, so not transferred
+} ws2811UpdateStats_t;
+
 extern volatile bool ws2811LedDataTransferInProgress;
 
 void ws2811LedStripInit(ioTag_t ioTag, ledStripFormatRGB_e ledFormat);
 void ws2811LedStripEnable(void);
 
 bool ws2811LedStripHardwareInit(void);
-void ws2811LedStripStartTransfer(void);
+// False if the transfer could not be started; the buffer is then sent again
+bool ws2811LedStripStartTransfer(void);
 void ws2811LedStripUpdateTransferBuffer(const rgbColor24bpp_t *color, unsigned ledIndex);
 
 bool ws2811UpdateStrip(uint8_t brightness);
+void ws2811GetUpdateStats(ws2811UpdateStats_t *stats);
 
 void setLedHsv(uint16_t index, const hsvColor_t *color);
 void getLedHsv(uint16_t index, hsvColor_t *color);
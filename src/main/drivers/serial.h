@@ -73,6 +73,9 @@ typedef enum {
 #define CTRL_LINE_STATE_RTS (1 << 1)
 
 typedef void (*serialReceiveCallbackPtr)(uint16_t data, void *rxCallbackData);   // used by serial drivers to return frames to app
+// Block delivery of received bytes, used by DMA driven ports when the line goes idle.
+// A frame that wraps the end of the DMA ring is delivered in two consecutive calls.
+typedef void (*serialReceiveFrameCallbackPtr)(const uint8_t *data, uint16_t len, void *rxCallbackData);
 typedef void (*serialIdleCallbackPtr)(void);
 
 typedef struct serialPort_s {
@@ -93,6 +96,8 @@ typedef struct serialPort_s {
     volatile uint32_t txBufferHead;
     volatile uint32_t txBufferTail;
     serialReceiveCallbackPtr rxCallback;
+    // Optional; when set, DMA driven ports deliver received data here instead of calling rxCallback per byte
+    serialReceiveFrameCallbackPtr rxFrameCallback;
     void *rxCallbackData;
 
     serialIdleCallbackPtr idleCallback;
@@ -28,17 +28,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 
 #include "platform.h"
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "io/serial.h"
 #include "serial_tcp.h"
+#include "sitl_reactor.h"
 
 #define BASE_PORT 5760
+#define IDLE_CHECK_MS       1000
+#define IDLE_TIMEOUT_MS     120000
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0      // SO_NOSIGPIPE is set on the socket instead
+#endif
 
 static const struct serialPortVTable tcpVTable; // Forward
 static tcpPort_t tcpSerialPorts[SERIAL_PORT_COUNT];
@@ -50,40 +63,156 @@ bool tcpIsStart(void)
     return tcpStart;
 }
 
-static void onData(dyad_Event *e)
+static void setNonBlocking(int fd)
 {
-    tcpPort_t* s = (tcpPort_t*)(e->udata);
-    tcpDataIn(s, (uint8_t*)e->data, e->size);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
 }
 
-static void onClose(dyad_Event *e)
+// I/O thread from here to tcpReconfigure()
+
+static void closeConnection(tcpPort_t *s)
 {
-    tcpPort_t* s = (tcpPort_t*)(e->udata);
+    sitlReactorRemove(s->conn);
+    close(s->conn);
+    s->conn = -1;
     s->clientCount--;
-    s->conn = NULL;
     fprintf(stderr, "[CLS]UART%u: %d,%d\n", s->id + 1U, s->connected, s->clientCount);
     if (s->clientCount == 0) {
         s->connected = false;
     }
 }
 
-static void onAccept(dyad_Event *e)
+static void flushTx(tcpPort_t *s)
 {
-    tcpPort_t* s = (tcpPort_t*)(e->udata);
-    fprintf(stderr, "New connection on UART%u, %d\n", s->id + 1U, s->clientCount);
+    void *span;
+    uint32_t count;
 
-    s->connected = true;
-    if (s->clientCount > 0) {
-        dyad_close(e->remote);
+    if (s->conn < 0) {
+        // nobody to send to; don't let the writer stall on a full queue
+        while ((count = sitlSpscReadable(&s->txQueue, &span))) {
+            sitlSpscRelease(&s->txQueue, count);
+        }
         return;
     }
-    s->clientCount++;
-    fprintf(stderr, "[NEW]UART%u: %d,%d\n", s->id + 1U, s->connected, s->clientCount);
-    s->conn = e->remote;
-    dyad_setNoDelay(e->remote, 1);
-    dyad_setTimeout(e->remote, 120);
-    dyad_addListener(e->remote, DYAD_EVENT_DATA, onData, e->udata);
-    dyad_addListener(e->remote, DYAD_EVENT_CLOSE, onClose, e->udata);
+
+    while ((count = sitlSpscReadable(&s->txQueue, &span))) {
+        const ssize_t sent = send(s->conn, span, count, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // socket buffer full: carry on when it drains
+                sitlReactorModify(s->conn, SITL_REACTOR_READ | SITL_REACTOR_WRITE);
+            } else {
+                closeConnection(s);
+            }
+            return;
+        }
+        sitlSpscRelease(&s->txQueue, sent);
+        // a client that only listens (telemetry, blackbox) is not idle
+        s->idleMs = 0;
+    }
+    sitlReactorModify(s->conn, SITL_REACTOR_READ);
+}
+
+static void onConnectionEvent(int fd, uint8_t events, void *context)
+{
+    tcpPort_t *s = context;
+
+    if (events & SITL_REACTOR_WRITE) {
+        flushTx(s);
+        if (s->conn != fd) {
+            return;
+        }
+    }
+
+    if (events & (SITL_REACTOR_READ | SITL_REACTOR_HANGUP)) {
+        uint8_t buffer[RX_BUFFER_SIZE];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            tcpDataIn(s, buffer, n);
+            s->idleMs = 0;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            closeConnection(s);
+        }
+    }
+}
+
+static void onAccept(int fd, uint8_t events, void *context)
+{
+    UNUSED(events);
+    tcpPort_t* s = context;
+
+    int client;
+    while ((client = accept(fd, NULL, NULL)) >= 0) {
+        fprintf(stderr, "New connection on UART%u, %d\n", s->id + 1U, s->clientCount);
+
+        s->connected = true;
+        if (s->clientCount > 0) {
+            close(client);
+            continue;
+        }
+
+        const int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        setNonBlocking(client);
+
+        s->clientCount++;
+        fprintf(stderr, "[NEW]UART%u: %d,%d\n", s->id + 1U, s->connected, s->clientCount);
+        s->conn = client;
+        s->idleMs = 0;
+        sitlReactorAdd(client, SITL_REACTOR_READ, onConnectionEvent, s);
+    }
+}
+
+// Ports with bytes queued by the main loop since the last wake
+static void onWake(void *context)
+{
+    UNUSED(context);
+    for (unsigned i = 0; i < ARRAYLEN(tcpSerialPorts); i++) {
+        tcpPort_t *s = &tcpSerialPorts[i];
+        if (tcpPortInitialized[i] && __atomic_exchange_n(&s->txPending, 0, __ATOMIC_ACQ_REL)) {
+            flushTx(s);
+        }
+    }
+}
+
+static void onIdleCheck(void *context)
+{
+    UNUSED(context);
+    for (unsigned i = 0; i < ARRAYLEN(tcpSerialPorts); i++) {
+        tcpPort_t *s = &tcpSerialPorts[i];
+        if (tcpPortInitialized[i] && s->conn >= 0) {
+            s->idleMs += IDLE_CHECK_MS;
+            if (s->idleMs >= IDLE_TIMEOUT_MS) {
+                closeConnection(s);
+            }
+        }
+    }
+}
+
+static int listenOn(int port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setNonBlocking(fd);
+
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 10) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
 
 static tcpPort_t* tcpReconfigure(tcpPort_t *s, int id)
@@ -93,33 +222,29 @@ static tcpPort_t* tcpReconfigure(tcpPort_t *s, int id)
         return s;
     }
 
-    if (pthread_mutex_init(&s->txLock, NULL) != 0) {
-        fprintf(stderr, "TX mutex init failed - %d\n", errno);
-        // TODO: clean up & re-init
-        return NULL;
+    if (!tcpStart) {
+        sitlReactorAddWakeHook(onWake, NULL);
+        sitlReactorAddTimer(IDLE_CHECK_MS, onIdleCheck, NULL);
     }
-
-    if (pthread_mutex_init(&s->rxLock, NULL) != 0) {
-        fprintf(stderr, "RX mutex init failed - %d\n", errno);
-        // TODO: clean up & re-init
-        return NULL;
-    }
-
     tcpStart = true;
-    tcpPortInitialized[id] = true;
 
+    sitlSpscInit(&s->rxQueue, s->rxBuffer, 1, RX_BUFFER_SIZE);
+    sitlSpscInit(&s->txQueue, s->txBuffer, 1, TX_BUFFER_SIZE);
+    s->txPending = 0;
     s->connected = false;
     s->clientCount = 0;
     s->id = id;
-    s->conn = NULL;
-    s->serv = dyad_newStream();
-    dyad_setNoDelay(s->serv, 1);
-    dyad_addListener(s->serv, DYAD_EVENT_ACCEPT, onAccept, s);
+    s->conn = -1;
+    s->idleMs = 0;
+    tcpPortInitialized[id] = true;
 
-    if (dyad_listenEx(s->serv, NULL, BASE_PORT + id + 1, 10) == 0) {
-        fprintf(stderr, "bind port %u for UART%u\n", (unsigned)BASE_PORT + id + 1, (unsigned)id + 1);
+    // each swarm instance gets its own block of ports
+    const unsigned port = BASE_PORT + sitlInstancePortOffset() + id + 1;
+    s->serv = listenOn(port);
+    if (s->serv >= 0 && sitlReactorAdd(s->serv, SITL_REACTOR_READ, onAccept, s)) {
+        fprintf(stderr, "bind port %u for UART%u\n", port, (unsigned)id + 1);
     } else {
-        fprintf(stderr, "bind port %u for UART%u failed!!\n", (unsigned)BASE_PORT + id + 1, (unsigned)id + 1);
+        fprintf(stderr, "bind port %u for UART%u failed!!\n", port, (unsigned)id + 1);
     }
     return s;
 }
@@ -158,116 +283,70 @@ serialPort_t *serTcpOpen(serialPortIdentifier_e identifier, serialReceiveCallbac
     return (serialPort_t *)s;
 }
 
+// Main loop side: the port is the consumer of rxQueue and the producer of txQueue
+
 static uint32_t tcpTotalRxBytesWaiting(const serialPort_t *instance)
 {
     tcpPort_t *s = (tcpPort_t*)instance;
-    uint32_t count;
-    pthread_mutex_lock(&s->rxLock);
-    if (s->port.rxBufferHead >= s->port.rxBufferTail) {
-        count = s->port.rxBufferHead - s->port.rxBufferTail;
-    } else {
-        count = s->port.rxBufferSize + s->port.rxBufferHead - s->port.rxBufferTail;
-    }
-    pthread_mutex_unlock(&s->rxLock);
-
-    return count;
+    return sitlSpscCount(&s->rxQueue);
 }
 
 static uint32_t tcpTotalTxBytesFree(const serialPort_t *instance)
 {
     tcpPort_t *s = (tcpPort_t*)instance;
-    uint32_t bytesUsed;
-
-    pthread_mutex_lock(&s->txLock);
-    if (s->port.txBufferHead >= s->port.txBufferTail) {
-        bytesUsed = s->port.txBufferHead - s->port.txBufferTail;
-    } else {
-        bytesUsed = s->port.txBufferSize + s->port.txBufferHead - s->port.txBufferTail;
-    }
-    uint32_t bytesFree = (s->port.txBufferSize - 1) - bytesUsed;
-    pthread_mutex_unlock(&s->txLock);
-
-    return bytesFree;
+    return (s->port.txBufferSize - 1) - sitlSpscCount(&s->txQueue);
 }
 
 static bool isTcpTransmitBufferEmpty(const serialPort_t *instance)
 {
     tcpPort_t *s = (tcpPort_t *)instance;
-    pthread_mutex_lock(&s->txLock);
-    bool isEmpty = s->port.txBufferTail == s->port.txBufferHead;
-    pthread_mutex_unlock(&s->txLock);
-    return isEmpty;
+    return sitlSpscCount(&s->txQueue) == 0;
 }
 
 static uint8_t tcpRead(serialPort_t *instance)
 {
-    uint8_t ch;
+    uint8_t ch = 0;
     tcpPort_t *s = (tcpPort_t *)instance;
-    pthread_mutex_lock(&s->rxLock);
-
-    ch = s->port.rxBuffer[s->port.rxBufferTail];
-    if (s->port.rxBufferTail + 1 >= s->port.rxBufferSize) {
-        s->port.rxBufferTail = 0;
-    } else {
-        s->port.rxBufferTail++;
-    }
-    pthread_mutex_unlock(&s->rxLock);
-
+    sitlSpscPop(&s->rxQueue, &ch);
     return ch;
 }
 
 static void tcpWrite(serialPort_t *instance, uint8_t ch)
 {
     tcpPort_t *s = (tcpPort_t *)instance;
-    pthread_mutex_lock(&s->txLock);
-
-    s->port.txBuffer[s->port.txBufferHead] = ch;
-    if (s->port.txBufferHead + 1 >= s->port.txBufferSize) {
-        s->port.txBufferHead = 0;
-    } else {
-        s->port.txBufferHead++;
-    }
-    pthread_mutex_unlock(&s->txLock);
+    sitlSpscPush(&s->txQueue, &ch);
 
     tcpDataOut(s);
 }
 
+// Hand the queued bytes to the I/O thread; one wake covers everything
+// written until it runs
 void tcpDataOut(tcpPort_t *instance)
 {
     tcpPort_t *s = (tcpPort_t *)instance;
-    if (s->conn == NULL) return;
-    pthread_mutex_lock(&s->txLock);
-
-    if (s->port.txBufferHead < s->port.txBufferTail) {
-        // send data till end of buffer
-        int chunk = s->port.txBufferSize - s->port.txBufferTail;
-        dyad_write(s->conn, (const void *)&s->port.txBuffer[s->port.txBufferTail], chunk);
-        s->port.txBufferTail = 0;
+    if (!__atomic_exchange_n(&s->txPending, 1, __ATOMIC_ACQ_REL)) {
+        sitlReactorWake();
     }
-    int chunk = s->port.txBufferHead - s->port.txBufferTail;
-    if (chunk)
-        dyad_write(s->conn, (const void*)&s->port.txBuffer[s->port.txBufferTail], chunk);
-    s->port.txBufferTail = s->port.txBufferHead;
-
-    pthread_mutex_unlock(&s->txLock);
 }
 
+// I/O thread; bytes that do not fit are dropped, like a UART overrun
 void tcpDataIn(tcpPort_t *instance, uint8_t* ch, int size)
 {
     tcpPort_t *s = (tcpPort_t *)instance;
-    pthread_mutex_lock(&s->rxLock);
-
-    while (size--) {
-//        printf("%c", *ch);
-        s->port.rxBuffer[s->port.rxBufferHead] = *(ch++);
-        if (s->port.rxBufferHead + 1 >= s->port.rxBufferSize) {
-            s->port.rxBufferHead = 0;
-        } else {
-            s->port.rxBufferHead++;
+
+    while (size > 0) {
+        void *span;
+        const uint32_t space = sitlSpscWritable(&s->rxQueue, &span);
+        if (!space) {
+            s->rxQueue.dropped += size;
+            return;
         }
+        const uint32_t chunk = MIN(space, (uint32_t)size);
+        memcpy(span, ch, chunk);
+        sitlSpscCommit(&s->rxQueue, chunk);
+        ch += chunk;
+        size -= chunk;
     }
-    pthread_mutex_unlock(&s->rxLock);
-//    printf("\n");
 }
 
 static const struct serialPortVTable tcpVTable = {
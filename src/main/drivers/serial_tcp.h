@@ -21,22 +21,26 @@
 #pragma once
 
 #include <netinet/in.h>
-#include <pthread.h>
-#include "dyad.h"
 #include "io/serial.h"
+#include "sitl_spsc.h"
 
-#define RX_BUFFER_SIZE    1400
-#define TX_BUFFER_SIZE    1400
+// Powers of two for the SPSC rings
+#define RX_BUFFER_SIZE    2048
+#define TX_BUFFER_SIZE    2048
 
 typedef struct {
     serialPort_t port;
     uint8_t rxBuffer[RX_BUFFER_SIZE];
     uint8_t txBuffer[TX_BUFFER_SIZE];
 
-    dyad_Stream *serv;
-    dyad_Stream *conn;
-    pthread_mutex_t txLock;
-    pthread_mutex_t rxLock;
+    // I/O thread -> main loop and back; the port's own head/tail are unused
+    sitlSpsc_t rxQueue;
+    sitlSpsc_t txQueue;
+    uint8_t txPending;          // main loop has queued bytes the I/O thread has not been told about
+
+    int serv;                   // listening socket
+    int conn;                   // the one client, -1 when none
+    uint32_t idleMs;
     bool connected;
     uint16_t clientCount;
     uint8_t id;
@@ -49,5 +53,3 @@ void tcpDataIn(tcpPort_t *instance, uint8_t* ch, int size);
 void tcpDataOut(tcpPort_t *instance);
 
 bool tcpIsStart(void);
-bool* tcpGetUsed(void);
-tcpPort_t* tcpGetPool(void);
@@ -34,6 +34,7 @@
 #ifdef USE_UART
 
 #include "build/build_config.h"
+#include "build/debug.h"
 
 #include <common/maths.h>
 #include "common/utils.h"
@@ -333,6 +334,7 @@ serialPort_t *uartOpen(serialPortIdentifier_e identifier, serialReceiveCallbackP
     uartPort->port.txBufferHead = uartPort->port.txBufferTail = 0;
     // callback works for IRQ-based RX ONLY
     uartPort->port.rxCallback = rxCallback;
+    uartPort->port.rxFrameCallback = NULL;
     uartPort->port.rxCallbackData = rxCallbackData;
     uartPort->port.mode = mode;
     uartPort->port.baudRate = baudRate;
@@ -385,6 +387,52 @@ static uint32_t uartTotalRxBytesWaiting(const serialPort_t *instance)
     }
 }
 
+#ifdef USE_DMA
+// Called by the platform IRQ handler when the RX line goes idle on a DMA driven port.
+// Everything the DMA has written since the previous idle is handed to the port's receive
+// callback in one go, so a frame costs one interrupt instead of one per byte.
+void uartRxDmaIdle(uartPort_t *uartPort)
+{
+    serialPort_t *port = &uartPort->port;
+
+    if (!port->rxFrameCallback && !port->rxCallback) {
+        // Polled port, data stays in the ring for serialRead()
+        return;
+    }
+
+    uint32_t bytesWaiting = uartTotalRxBytesWaiting(port);
+    if (bytesWaiting == 0) {
+        return;
+    }
+
+    uartPort->rxDMAFrameCount++;
+    uartPort->rxDMAByteCount += bytesWaiting;
+    DEBUG_SET(DEBUG_SERIAL_RX_DMA, 0, uartPort->rxDMAFrameCount);
+    DEBUG_SET(DEBUG_SERIAL_RX_DMA, 1, uartPort->rxDMAByteCount);
+    DEBUG_SET(DEBUG_SERIAL_RX_DMA, 2, bytesWaiting);
+
+    while (bytesWaiting > 0) {
+        // rxDMAPos counts down from the end of the buffer, so it is also the contiguous space left before the wrap
+        const uint32_t chunk = MIN(bytesWaiting, uartPort->rxDMAPos);
+        const uint8_t *data = (const uint8_t *)&port->rxBuffer[port->rxBufferSize - uartPort->rxDMAPos];
+
+        if (port->rxFrameCallback) {
+            port->rxFrameCallback(data, chunk, port->rxCallbackData);
+        } else {
+            for (uint32_t i = 0; i < chunk; i++) {
+                port->rxCallback(data[i], port->rxCallbackData);
+            }
+        }
+
+        uartPort->rxDMAPos -= chunk;
+        if (uartPort->rxDMAPos == 0) {
+            uartPort->rxDMAPos = port->rxBufferSize;
+        }
+        bytesWaiting -= chunk;
+    }
+}
+#endif
+
 static uint32_t uartTotalTxBytesFree(const serialPort_t *instance)
 {
     const uartPort_t *uartPort = (const uartPort_t*)instance;
@@ -41,6 +41,9 @@ typedef struct uartPort_s {
     uint32_t txDMAIrq;
 
     uint32_t rxDMAPos;
+    // idle line deliveries and the bytes they carried, each byte being a RX interrupt avoided
+    uint32_t rxDMAFrameCount;
+    uint32_t rxDMAByteCount;
 
     uint32_t txDMAPeripheralBaseAddr;
     uint32_t rxDMAPeripheralBaseAddr;
@@ -205,6 +205,7 @@ void uartReconfigure(uartPort_t *uartPort);
 void uartConfigureDma(uartDevice_t *uartdev);
 
 void uartDmaIrqHandler(dmaChannelDescriptor_t* descriptor);
+void uartRxDmaIdle(uartPort_t *uartPort);
 
 bool checkUsartTxOutput(uartPort_t *s);
 void uartTxMonitor(uartPort_t *s);
@@ -102,6 +102,7 @@
 #include "pg/pg_ids.h"
 #include "pg/rx.h"
 
+#include "rx/rc_latency.h"
 #include "rx/rc_stats.h"
 #include "rx/rx.h"
 
@@ -115,6 +116,7 @@
 #include "sensors/gyro.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/mavlink_offboard.h"
 
 #include "core.h"
 
@@ -1234,7 +1236,8 @@ void processRxModes(timeUs_t currentTimeUs)
         rescheduleTask(TASK_ATTITUDE, TASK_PERIOD_HZ(acc.sampleRateHz / (float)imuConfig()->imu_process_denom));
     } else {
         LED1_OFF;
-        rescheduleTask(TASK_ATTITUDE, TASK_PERIOD_HZ(100));
+        // an offboard companion link streams attitude at its own rate
+        rescheduleTask(TASK_ATTITUDE, TASK_PERIOD_HZ(MAX(100, mavlinkOffboardAttitudeRateHz())));
     }
 
     if (!IS_RC_MODE_ACTIVE(BOXPREARM) && ARMING_FLAG(WAS_ARMED_WITH_PREARM)) {
@@ -1428,6 +1431,10 @@ static FAST_CODE void subTaskMotorUpdate(timeUs_t currentTimeUs)
 
     writeMotors();
 
+#ifdef USE_RC_LATENCY_STATS
+    rcLatencyMotorsWritten(micros());
+#endif
+
 #ifdef USE_DSHOT_TELEMETRY_STATS
     if (debugMode == DEBUG_DSHOT_RPM_ERRORS && useDshotTelemetry) {
         const uint8_t motorCount = MIN(getMotorCount(), 4);
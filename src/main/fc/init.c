@@ -100,6 +100,8 @@
 #include "flight/failsafe.h"
 #if ENABLE_FLIGHT_PLAN && !defined(USE_WING)
 #include "flight/flight_plan_nav.h"
+#include "flight/geofence.h"
+#include "flight/mission_store.h"
 #endif
 #include "flight/imu.h"
 #include "flight/mixer.h"
@@ -118,6 +120,7 @@
 #include "io/displayport_max7456.h"
 #include "io/displayport_msp.h"
 #include "io/dronecan/dronecan.h"
+#include "io/dronecan/dronecan_esc.h"
 #include "io/flashfs.h"
 #include "io/gimbal.h"
 #include "io/gimbal_control.h"
@@ -185,6 +188,7 @@
 #include "sensors/initialisation.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/mavlink_offboard.h"
 
 #ifdef USE_HARDWARE_REVISION_DETECTION
 #include "hardware_revision.h"
@@ -735,6 +739,9 @@ void initPhase3(void)
     // Initialize the motor frequency filter now that we have a target looptime
     initDshotTelemetry(gyro.targetLooptime);
 #endif
+#if ENABLE_DRONECAN_ESC && defined(USE_ESC_SENSOR)
+    dronecanEscInitTelemetry(gyro.targetLooptime);
+#endif
 
     // Finally initialize the gyro filtering
     gyroInitFilters();
@@ -873,6 +880,8 @@ void initPhase3(void)
     positionInit();
     autopilotInit();
 #if ENABLE_FLIGHT_PLAN && !defined(USE_WING)
+    missionStoreInit();
+    geofenceInit();
     flightPlanNavInit();
 #endif
 
@@ -1040,6 +1049,10 @@ void initPhase3(void)
     }
 #endif
 
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    mavlinkOffboardInit();
+#endif
+
     setArmingDisabled(ARMING_DISABLED_BOOT_GRACE_TIME);
 
 // allocate SPI DMA streams before motor timers
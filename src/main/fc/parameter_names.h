@@ -200,6 +200,9 @@
 #define PARAM_NAME_AP_NAV_CARROT_LEAD_TIME "ap_nav_carrot_lead_time"
 #define PARAM_NAME_AP_NAV_CARROT_LEAD_MAX "ap_nav_carrot_lead_max"
 #define PARAM_NAME_AP_NAV_PRETURN_DIST "ap_nav_preturn_dist"
+#define PARAM_NAME_AP_NAV_PATH_MODE "ap_nav_path_mode"
+#define PARAM_NAME_AP_NAV_LATERAL_ACCEL "ap_nav_lateral_accel"
+#define PARAM_NAME_AP_NAV_JERK "ap_nav_jerk"
 
 // Phase 5: Velocity buildup
 #define PARAM_NAME_AP_VELOCITY_BUILDUP_MAX_PITCH "ap_velocity_buildup_max_pitch"
@@ -221,6 +224,8 @@
 #define PARAM_NAME_AP_RX_LOSS_POLICY "ap_rx_loss_policy"
 #define PARAM_NAME_AP_MAX_DISTANCE_FROM_HOME "ap_max_distance_from_home"
 #define PARAM_NAME_AP_GEOFENCE_ACTION "ap_geofence_action"
+#define PARAM_NAME_GEOFENCE_LOOKAHEAD "geofence_lookahead"
+#define PARAM_NAME_MISSION_STORAGE "mission_storage"
 
 // Flight-plan OSD minimap
 #define PARAM_NAME_OSD_NAV_MAP_MODE "osd_nav_map_mode"
@@ -51,6 +51,7 @@
 
 #include "pg/rx.h"
 
+#include "rx/rc_latency.h"
 #include "rx/rx.h"
 
 #include "sensors/battery.h"
@@ -622,6 +623,9 @@ FAST_CODE void processRcCommand(void)
 {
     bool updateSmoothing = false;
     if (isRxDataNew) {
+#ifdef USE_RC_LATENCY_STATS
+        rcLatencyRcDataConsumed(micros());
+#endif
         updateSmoothing = shouldUpdateSmoothing();
 
         if (updateSmoothing) {
@@ -933,4 +937,15 @@ rcSmoothingFilter_t *getRcSmoothingData(void)
 {
     return &rcSmoothingData;
 }
+
+// low frequency group delay of the setpoint PT3, each PT1 stage delays by (1 - k) / k loop iterations
+timeDelta_t rcSmoothingGetSetpointDelayUs(void)
+{
+    const float k = rcSmoothingData.filterSetpoint[FD_ROLL].k;
+
+    if (!rxConfig()->rc_smoothing || k <= 0.0f || k >= 1.0f) {
+        return 0;
+    }
+    return lrintf(3.0f * (1.0f - k) / k * targetPidLooptime);
+}
 #endif // USE_RC_SMOOTHING_FILTER
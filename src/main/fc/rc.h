@@ -52,6 +52,7 @@ void resetYawAxis(void);
 void initRcProcessing(void);
 bool isMotorsReversed(void);
 rcSmoothingFilter_t *getRcSmoothingData(void);
+timeDelta_t rcSmoothingGetSetpointDelayUs(void);
 
 float getMaxRcRate(int axis);
 float getFeedforward(int axis);
@@ -107,6 +107,7 @@
 
 #include "telemetry/telemetry.h"
 #include "telemetry/crsf.h"
+#include "telemetry/mavlink_offboard.h"
 
 #ifdef USE_BST
 #include "i2c_bst.h"
@@ -517,6 +518,10 @@ task_attribute_t task_attributes[TASK_COUNT] = {
     [TASK_DRONECAN] = DEFINE_TASK("DRONECAN", NULL, NULL, dronecanUpdate, TASK_PERIOD_HZ(50), TASK_PRIORITY_LOW),
 #endif
 
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    [TASK_MAVLINK_OFFBOARD] = DEFINE_TASK("MAV_OFFBOARD", NULL, NULL, mavlinkOffboardUpdate, TASK_PERIOD_HZ(500), TASK_PRIORITY_MEDIUM),
+#endif
+
 };
 
 task_t *getTask(unsigned taskId)
@@ -723,4 +728,8 @@ void tasksInit(void)
 #if ENABLE_DRONECAN
     setTaskEnabled(TASK_DRONECAN, dronecanIsInitialised());
 #endif
+
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    setTaskEnabled(TASK_MAVLINK_OFFBOARD, mavlinkOffboardIsEnabled());
+#endif
 }
@@ -41,7 +41,10 @@
 
 #include "flight/autopilot.h"
 #include "flight/flight_plan_nav.h"
+#include "flight/geofence.h"
 #include "flight/imu.h"
+#include "flight/mission_store.h"
+#include "flight/nav_path.h"
 #include "flight/position_estimator.h"
 #include "flight/position_nav.h"
 
@@ -112,6 +115,17 @@
 // still counts, and the nose still starts swinging, the moment they happen.
 #define FP_MEAS_FILTER_S         0.20f   // PT1 tau on along-track position and ground speed
 
+// Smooth-path legs (ap_nav_path_mode = SMOOTH). Each corner is rounded by a
+// fillet sized so the speed carried through it respects ap_nav_lateral_accel,
+// and the reference point runs a jerk-limited speed profile along
+// [second half of the previous fillet, straight, first half of this one].
+// positionNav gets both the point and its path velocity as feedforward.
+#define FP_PATH_SETBACK_MIN_M    1.0f
+#define FP_PATH_SETBACK_MAX_M    40.0f
+#define FP_PATH_STOP_TURN_COS    -0.866f  // turns sharper than 150 deg stop on the waypoint and reverse
+#define FP_PATH_SPEED_TAU_S      0.5f     // reference speed error -> acceleration demand
+#define FP_PATH_CREEP_MPS        0.3f     // floor so a stop corner's reference always reaches the waypoint
+
 // Landing descends toward a target far below the current position so vertical
 // arrival can never trigger; touchdown detection is what ends the descent.
 #define FP_LANDING_TARGET_DEPTH_M 200.0f
@@ -125,6 +139,11 @@
 // failsafe rescue); MAVLink-scale plans stay in the PG store.
 #define FP_INJECTED_PLAN_MAX 4
 
+// Offboard setpoints are streamed at 10-50 Hz; a stream silent this long has
+// stopped, and the craft holds the last commanded point instead of carrying on
+// along the last commanded velocity.
+#define FP_EXTERNAL_TIMEOUT_US 500000u
+
 // HOLD patterns chase a time-parametrised carrot around the hold point. The
 // angular rate cap keeps small radii flyable (full cruise on the default 2 m
 // radius would demand a 2.5 rad/s spin) and holds the rotation slow enough
@@ -148,8 +167,9 @@
 
 static struct {
     flightPlanNavState_e state;
-    uint8_t currentIndex;
-    uint8_t pendingStartIndex;  // MISSION_SET_CURRENT while idle; consumed by engage
+    uint16_t currentIndex;
+    uint16_t pendingStartIndex; // MISSION_SET_CURRENT while idle; consumed by engage
+    uint16_t pagedIndex;        // stored-mission leg last paged in with its lookahead
     timeUs_t holdStartUs;
     uint16_t holdDurationDs;
     bool active;
@@ -174,9 +194,17 @@ static struct {
     waypoint_t injected[FP_INJECTED_PLAN_MAX];
     uint8_t injectedCount;
 
+    // Offboard setpoint stream; while externalActive it preempts the mission
+    // legs, under the same estimator and geofence checks.
+    bool externalActive;
+    bool externalVelValid;
+    vector3_t externalTargetEnuM;
+    vector3_t externalVelEnuMps;
+    timeUs_t externalLastUs;
+
 #if ENABLE_RESCUE_PLAN
     // Failsafe rescue plan staged before the executor engages; drained by
-    // flightPlanNavEngage() in place of the PG mission.
+    // flightPlanNavEngage() in place of the stored mission.
     waypoint_t staged[FP_INJECTED_PLAN_MAX];
     uint8_t stagedCount;
     bool isRescuePlan;          // the active injected plan is a failsafe rescue
@@ -224,6 +252,25 @@ static struct {
     bool      measFiltValid;
     bool      overspeedHold;    // hysteretic governor: holding the carrot until the craft is back on profile
 
+    // Smooth-path legs reuse the leg target, cruise, carrotPrev* anchoring and
+    // carrotSpeedMps (the reference speed) above. The path is planned once when
+    // the leg anchors; pathSM is the reference's distance along it.
+    navPathFillet_t pathEntry;  // fillet round the previous waypoint; its second half starts this leg
+    navPathFillet_t pathExit;   // fillet round this leg's waypoint; its first half ends this leg
+    bool      pathHasEntry;
+    bool      pathHasExit;      // false: a stop corner, the leg ends on the waypoint at rest
+    bool      pathEntryPending; // the gate just crossed hands its fillet to the next leg
+    vector2_t pathEntryCornerM; // the waypoint that gate rounded
+    vector2_t pathLineStartM;
+    vector2_t pathLineEndM;
+    float     pathEntryLenM;
+    float     pathLineLenM;
+    float     pathExitLenM;
+    float     pathEntrySpeedMps;
+    float     pathCornerSpeedMps;
+    float     pathSM;
+    float     pathAccelMps2;
+
     // Landing state
     timeUs_t landingStartUs;
     timeUs_t touchdownQuietStartUs;
@@ -235,21 +282,27 @@ static flightPlanWaypointReachedFn reachedListener = NULL;
 static void onWaypointReached(void *userData);
 static void clearModifierState(void);
 
-static uint8_t activePlanCount(void)
+static uint16_t activePlanCount(void)
 {
-    return (fp.injectedCount > 0) ? fp.injectedCount : flightPlanConfig()->waypointCount;
+    return (fp.injectedCount > 0) ? fp.injectedCount : missionStoreGetCount();
 }
 
-static const waypoint_t *activePlanWaypoint(uint8_t index)
+static const waypoint_t *activePlanWaypoint(uint16_t index)
 {
     if (index >= activePlanCount()) {
         return NULL;
     }
-    return (fp.injectedCount > 0) ? &fp.injected[index] : &flightPlanConfig()->waypoints[index];
+    return (fp.injectedCount > 0) ? &fp.injected[index] : missionStoreGetWaypoint(index);
 }
 
 static const waypoint_t *currentWaypoint(void)
 {
+    if (fp.injectedCount == 0 && fp.currentIndex != fp.pagedIndex) {
+        // A new leg of the stored mission: page it in with the legs after it.
+        // It stays resident while flown, whatever the lookahead reads page over.
+        missionStorePrefetch(fp.currentIndex);
+        fp.pagedIndex = fp.currentIndex;
+    }
     return activePlanWaypoint(fp.currentIndex);
 }
 
@@ -257,15 +310,20 @@ static const waypoint_t *currentWaypoint(void)
 // plan has none left. Modifier records (ALT_CHANGE/DELAY/YAW_RATE) carry no
 // coordinates, so the corner geometry and the pass-through/last-leg decision
 // must look past them without consuming modifier state (drainModifiers does that).
-static const waypoint_t *nextPositionalWaypoint(uint8_t from)
+static uint16_t nextPositionalIndex(uint16_t from)
 {
-    for (uint8_t i = from; i < activePlanCount(); i++) {
+    for (uint16_t i = from; i < activePlanCount(); i++) {
         const waypoint_t *wp = activePlanWaypoint(i);
         if (wp != NULL && wp->type < WAYPOINT_TYPE_ALT_CHANGE) {
-            return wp;
+            return i;
         }
     }
-    return NULL;
+    return activePlanCount();
+}
+
+static const waypoint_t *nextPositionalWaypoint(uint16_t from)
+{
+    return activePlanWaypoint(nextPositionalIndex(from));
 }
 
 static bool computeTargetEnuM(const waypoint_t *wp, vector3_t *out)
@@ -296,11 +354,12 @@ static bool computeTargetEnuM(const waypoint_t *wp, vector3_t *out)
 
 // Walk fp.currentIndex past any consecutive modifier waypoints, applying their
 // effect to staged fp state. Returns the first positional waypoint, or NULL if
-// the plan ended (caller transitions to FP_NAV_COMPLETE). Bounded by
-// MAX_WAYPOINTS so a pathological all-modifier mission can't spin.
+// the plan ended (caller transitions to FP_NAV_COMPLETE). Bounded by the
+// plan size so a pathological all-modifier mission can't spin.
 static const waypoint_t *drainModifiers(void)
 {
-    for (uint8_t guard = 0; guard < MAX_WAYPOINTS; guard++) {
+    const uint16_t count = activePlanCount();
+    for (uint16_t guard = 0; guard < count; guard++) {
         const waypoint_t *wp = currentWaypoint();
         if (wp == NULL) {
             return NULL;
@@ -797,6 +856,263 @@ static void updateLegCarrot(float dtS, timeUs_t currentTimeUs, const positionEst
     positionNavMoveTargetEf(&carrot);
 }
 
+// Speed the smooth path carries round `corner` on the way from `from` to `to`,
+// and the fillet setback that carries it. Fillet curvature scales as
+// 1/setback, so the setback grows with v^2 until it meets half of either leg
+// (adjacent fillets never overlap) or FP_PATH_SETBACK_MAX_M. A stop corner
+// (hairpin, or a leg too short to round) returns 0 with no setback.
+static float planPathCorner(const vector2_t *from, const vector2_t *corner, const vector2_t *to,
+                            float cruiseMps, float lateralAccelMps2, float *setbackM)
+{
+    *setbackM = 0.0f;
+
+    vector2_t inDir, outDir;
+    vector2Sub(&inDir, corner, from);
+    vector2Sub(&outDir, to, corner);
+    const float inLenM = vector2Norm(&inDir);
+    const float outLenM = vector2Norm(&outDir);
+    const float maxSetbackM = fminf(FP_PATH_SETBACK_MAX_M, 0.5f * fminf(inLenM, outLenM));
+    if (maxSetbackM < FP_PATH_SETBACK_MIN_M) {
+        return 0.0f;
+    }
+    vector2Scale(&inDir, &inDir, 1.0f / inLenM);
+    vector2Scale(&outDir, &outDir, 1.0f / outLenM);
+    if (vector2Dot(&inDir, &outDir) < FP_PATH_STOP_TURN_COS) {
+        return 0.0f;
+    }
+
+    const float unitCurvature = navPathUnitCurvature(&inDir, &outDir);
+    *setbackM = constrainf(unitCurvature * sq(cruiseMps) / lateralAccelMps2, FP_PATH_SETBACK_MIN_M, maxSetbackM);
+    if (unitCurvature < 1e-3f) {
+        return cruiseMps;   // straight through
+    }
+    return fminf(cruiseMps, sqrtf(lateralAccelMps2 * *setbackM / unitCurvature));
+}
+
+static bool isStationKeepingWaypoint(const waypoint_t *wp)
+{
+    return wp->type == WAYPOINT_TYPE_HOLD || wp->type == WAYPOINT_TYPE_LAND || wp->type == WAYPOINT_TYPE_TAKEOFF;
+}
+
+// Plan the smooth path of the leg just dispatched, from the current and the
+// next one or two positional waypoints.
+static void anchorLegPath(const vector2_t *craft)
+{
+    const autopilotConfig_t *cfg = autopilotConfig();
+    const float lateralAccelMps2 = cfg->navLateralAccel * 0.01f;
+    const float decelMps2 = cfg->navDecel * 0.01f;
+    const vector2_t wp = { .x = fp.legTargetEnuM.v[ENU_E], .y = fp.legTargetEnuM.v[ENU_N] };
+
+    // A leg that follows a gate starts on the midpoint of the fillet round the
+    // waypoint just passed. Engage/retry start on the craft, a mid-leg
+    // re-dispatch on the last commanded reference.
+    fp.pathHasEntry = fp.carrotPrevValid && fp.pathEntryPending;
+    fp.pathEntryPending = false;
+    if (fp.pathHasEntry) {
+        fp.pathEntry = fp.pathExit;
+        fp.pathEntryLenM = navPathFilletLengthM(&fp.pathEntry) - navPathFilletMidLengthM(&fp.pathEntry);
+        fp.pathEntrySpeedMps = fp.pathCornerSpeedMps;
+        fp.pathLineStartM = fp.pathEntry.ctrl[5];
+    } else {
+        fp.pathEntryLenM = 0.0f;
+        fp.pathLineStartM = fp.carrotPrevValid ? fp.carrotPrevEnuM : *craft;
+    }
+    if (!fp.carrotPrevValid) {
+        fp.pathAccelMps2 = 0.0f;
+    }
+
+    // The corner at this waypoint, sized against the whole inbound leg when the
+    // leg follows a gate. The speed carried round it is also capped
+    // so the outbound leg can brake to the next corner's speed within half its
+    // length; a station-keeping or final next waypoint is a full stop.
+    fp.pathHasExit = false;
+    fp.pathCornerSpeedMps = 0.0f;
+    const uint16_t nextIndex = nextPositionalIndex(fp.currentIndex + 1);
+    const waypoint_t *nextWp = activePlanWaypoint(nextIndex);
+    vector3_t nextEnuM;
+    if (nextWp != NULL && computeTargetEnuM(nextWp, &nextEnuM)) {
+        const vector2_t next = { .x = nextEnuM.v[ENU_E], .y = nextEnuM.v[ENU_N] };
+        const vector2_t *from = fp.pathHasEntry ? &fp.pathEntryCornerM : &fp.pathLineStartM;
+        float setbackM;
+        const float cornerMps = planPathCorner(from, &wp, &next, fp.legCruiseMps, lateralAccelMps2, &setbackM);
+
+        float nextCornerMps = 0.0f;
+        const waypoint_t *afterWp = activePlanWaypoint(nextPositionalIndex(nextIndex + 1));
+        vector3_t afterEnuM;
+        if (!isStationKeepingWaypoint(nextWp) && afterWp != NULL && computeTargetEnuM(afterWp, &afterEnuM)) {
+            const vector2_t after = { .x = afterEnuM.v[ENU_E], .y = afterEnuM.v[ENU_N] };
+            float nextSetbackM;
+            nextCornerMps = planPathCorner(&wp, &next, &after, fp.legCruiseMps, lateralAccelMps2, &nextSetbackM);
+        }
+
+        if (setbackM > 0.0f) {
+            vector2_t inDir, outDir;
+            vector2Sub(&inDir, &wp, from);
+            vector2Sub(&outDir, &next, &wp);
+            const float outLenM = vector2Norm(&outDir);
+            vector2Normalize(&inDir, &inDir);
+            vector2Normalize(&outDir, &outDir);
+            navPathBuildFillet(&fp.pathExit, &wp, &inDir, &outDir, setbackM);
+            fp.pathHasExit = true;
+            fp.pathCornerSpeedMps = fminf(cornerMps, sqrtf(sq(nextCornerMps) + decelMps2 * outLenM));
+        }
+    }
+
+    fp.pathLineEndM = fp.pathHasExit ? fp.pathExit.ctrl[0] : wp;
+    fp.pathExitLenM = fp.pathHasExit ? navPathFilletMidLengthM(&fp.pathExit) : 0.0f;
+    vector2_t line;
+    vector2Sub(&line, &fp.pathLineEndM, &fp.pathLineStartM);
+    fp.pathLineLenM = vector2Norm(&line);
+    fp.pathSM = 0.0f;
+}
+
+// Point and unit tangent at sM along the leg's path; returns the speed limit there.
+static float samplePath(float sM, vector2_t *pos, vector2_t *tangent)
+{
+    if (sM < fp.pathEntryLenM) {
+        navPathFilletSample(&fp.pathEntry, navPathFilletMidLengthM(&fp.pathEntry) + sM, pos, tangent);
+        return fp.pathEntrySpeedMps;
+    }
+    sM -= fp.pathEntryLenM;
+    if (sM > fp.pathLineLenM && fp.pathHasExit) {
+        navPathFilletSample(&fp.pathExit, sM - fp.pathLineLenM, pos, tangent);
+        return fp.pathCornerSpeedMps;
+    }
+
+    vector2_t line;
+    vector2Sub(&line, &fp.pathLineEndM, &fp.pathLineStartM);
+    if (fp.pathLineLenM > 0.01f) {
+        vector2Scale(tangent, &line, 1.0f / fp.pathLineLenM);
+    } else if (fp.pathHasExit) {
+        vector2Sub(tangent, &fp.pathExit.ctrl[1], &fp.pathExit.ctrl[0]);
+        vector2Normalize(tangent, tangent);
+    } else {
+        tangent->x = 0.0f;
+        tangent->y = 1.0f;
+    }
+    pos->x = fp.pathLineStartM.x + tangent->x * fminf(sM, fp.pathLineLenM);
+    pos->y = fp.pathLineStartM.y + tangent->y * fminf(sM, fp.pathLineLenM);
+    return fp.legCruiseMps;
+}
+
+// One cycle of smooth-path tracking for an en-route pass-through leg: advance
+// the reference along the planned path on a jerk-limited speed profile, hand
+// positionNav the reference and its velocity, and advance the plan once the
+// reference is abeam the waypoint (the fillet midpoint). Returns true when that
+// started another pass-through leg that still needs its first cycle.
+static bool stepLegPath(float dtS, timeUs_t currentTimeUs, const positionEstimate3d_t *est)
+{
+    const autopilotConfig_t *cfg = autopilotConfig();
+    const float decelMps2 = cfg->navDecel * 0.01f;
+    const float accelMps2 = cfg->navAccel * 0.01f;
+    const float jerkMps3  = cfg->navJerk * 0.01f;
+    const float leadMaxM  = cfg->navCarrotLeadMax * 0.01f;
+
+    const vector2_t craft = { .x = est->position.v[ENU_E] * 0.01f, .y = est->position.v[ENU_N] * 0.01f };
+    const vector2_t toWp  = { .x = fp.legTargetEnuM.v[ENU_E] - craft.x, .y = fp.legTargetEnuM.v[ENU_N] - craft.y };
+
+    updateProgressTracking(vector2Norm(&toWp), currentTimeUs);
+    if (fp.state != FP_NAV_TARGETING) {
+        return false;   // the sanity check aborted the mission
+    }
+
+    if (!fp.legValid) {
+        anchorLegPath(&craft);
+        fp.legValid = true;
+    }
+
+    const float exitStartM = fp.pathEntryLenM + fp.pathLineLenM;
+    const float totalM = exitStartM + fp.pathExitLenM;
+    const float exitSpeedMps = fp.pathHasExit ? fp.pathCornerSpeedMps : 0.0f;
+
+    vector2_t refPos, refTangent;
+    const float limitMps = samplePath(fp.pathSM, &refPos, &refTangent);
+
+    // Trapezoid keyed on the reference's own distance to the corner fillet,
+    // started early by the distance covered while the braking ramps in at the
+    // jerk limit. The creep floor lets a stop corner's reference finish on the waypoint.
+    const float jerkLagM = fp.carrotSpeedMps * decelMps2 / jerkMps3;
+    const float brakeM = fmaxf(exitStartM - fp.pathSM - jerkLagM, 0.0f);
+    float desiredMps = fminf(limitMps, sqrtf(sq(exitSpeedMps) + 2.0f * decelMps2 * brakeM));
+    desiredMps = fmaxf(desiredMps, FP_PATH_CREEP_MPS);
+
+    // A reference running away from a craft that cannot follow (headwind,
+    // saturation) waits for it instead of dragging it across the corner.
+    vector2_t lead;
+    vector2Sub(&lead, &refPos, &craft);
+    if (vector2Dot(&lead, &refTangent) > leadMaxM) {
+        desiredMps = 0.0f;
+    }
+
+    const float accelDemand = constrainf((desiredMps - fp.carrotSpeedMps) / FP_PATH_SPEED_TAU_S, -decelMps2, accelMps2);
+    fp.pathAccelMps2 = constrainf(accelDemand, fp.pathAccelMps2 - jerkMps3 * dtS, fp.pathAccelMps2 + jerkMps3 * dtS);
+    fp.carrotSpeedMps += fp.pathAccelMps2 * dtS;
+    if (fp.carrotSpeedMps < 0.0f) {
+        fp.carrotSpeedMps = 0.0f;
+        fp.pathAccelMps2 = 0.0f;
+    }
+    if (fp.carrotSpeedMps > limitMps && limitMps < fp.legCruiseMps) {
+        // Never carry the slew's overshoot into a fillet: the corner speed is
+        // what bounds the lateral acceleration.
+        fp.carrotSpeedMps = limitMps;
+        fp.pathAccelMps2 = fminf(fp.pathAccelMps2, 0.0f);
+    }
+    fp.pathSM = fminf(fp.pathSM + fp.carrotSpeedMps * dtS, totalM);
+
+    samplePath(fp.pathSM, &refPos, &refTangent);
+
+    if (fp.pathSM >= totalM) {
+        // Abeam the waypoint: the next leg starts here and inherits the fillet.
+        // Plan and publish it in the same cycle so the feedforward never lapses.
+        fp.carrotPrevEnuM = refPos;
+        fp.carrotPrevValid = true;
+        fp.pathEntryPending = fp.pathHasExit;
+        fp.pathEntryCornerM.x = fp.legTargetEnuM.v[ENU_E];
+        fp.pathEntryCornerM.y = fp.legTargetEnuM.v[ENU_N];
+        onWaypointReached(NULL);
+        return fp.state == FP_NAV_TARGETING && fp.legIsPassGate && !fp.legValid;
+    }
+
+    // The configured yaw mode steers once the craft has a usable ground course.
+    // Below that (leg starts, stop corners) point the nose along the path so it
+    // is already there when the course develops. The course swings through a
+    // fillet by design, so fillets are excluded from the heading-fault check.
+    fp.inPreTurn = fp.pathSM < fp.pathEntryLenM || fp.pathSM > exitStartM;
+    const float groundSpeedCmS = sqrtf(sq(est->velocity.v[ENU_E]) + sq(est->velocity.v[ENU_N]));
+    if (groundSpeedCmS < cfg->minForwardVelocity) {
+        autopilotSetNavHeadingOverride(true, RADIANS_TO_DEGREES(atan2_approx(refTangent.x, refTangent.y)));
+    } else {
+        autopilotSetNavHeadingOverride(false, 0.0f);
+    }
+
+    const vector3_t reference = {.v = {
+        [ENU_E] = refPos.x,
+        [ENU_N] = refPos.y,
+        [ENU_U] = fp.legTargetEnuM.v[ENU_U],
+    }};
+    const vector3_t pathVelMps = {.v = {
+        [ENU_E] = refTangent.x * fp.carrotSpeedMps,
+        [ENU_N] = refTangent.y * fp.carrotSpeedMps,
+        [ENU_U] = 0.0f,
+    }};
+    fp.carrotPrevEnuM = refPos;
+    fp.carrotPrevValid = true;
+    positionNavMoveTargetEf(&reference);
+    positionNavSetPathVelocityEf(&pathVelMps);
+    return false;
+}
+
+static void updateLegPath(float dtS, timeUs_t currentTimeUs, const positionEstimate3d_t *est)
+{
+    // A reached leg hands over to the next in the same cycle. Zero length legs
+    // (repeated waypoints) end as soon as they start, so a run of them is passed
+    // here in one go; at most one pass over the plan per cycle.
+    const uint16_t maxLegs = activePlanCount();
+    for (uint16_t legs = 0; stepLegPath(dtS, currentTimeUs, est) && legs < maxLegs; legs++) {
+        dtS = 0.0f;
+    }
+}
+
 // Descent rate for the landing profile. Rescue contexts (an active rescue plan's
 // LAND leg, or the altitude-only fallback descent) honour gpsRescueConfig()'s
 // descendRate for legacy feel; every other landing (mission/geofence) keeps the
@@ -1057,17 +1373,18 @@ static void checkGeofence(timeUs_t currentTimeUs)
     }
 
     const autopilotConfig_t *cfg = autopilotConfig();
-    if (cfg->maxDistanceFromHomeM == 0 || !STATE(GPS_FIX_HOME)) {
-        return;
-    }
-    if (GPS_distanceToHome <= cfg->maxDistanceFromHomeM) {
+    const positionEstimate3d_t *est = positionEstimatorGetEstimate();
+    const bool outsideRadius = cfg->maxDistanceFromHomeM > 0 && STATE(GPS_FIX_HOME)
+        && GPS_distanceToHome > cfg->maxDistanceFromHomeM;
+    // polygon and circle zones respond to a predicted breach too, so the
+    // response starts before the boundary rather than after it
+    if (!outsideRadius && geofenceCheck(&est->position, &est->velocity) == GEOFENCE_OK) {
         return;
     }
 
     if (cfg->geofenceAction == AP_GEOFENCE_RTH) {
         injectReturnHomePlan(currentTimeUs);
     } else {
-        const positionEstimate3d_t *est = positionEstimatorGetEstimate();
         startLanding(currentTimeUs, est->position.v[ENU_E] * 0.01f, est->position.v[ENU_N] * 0.01f);
     }
 }
@@ -1197,7 +1514,7 @@ static void onWaypointReached(void *userData)
         return;
     }
 
-    // Listener indices refer to the PG mission; injected-plan progress is
+    // Listener indices refer to the stored mission; injected-plan progress is
     // meaningless to a MAVLink partner tracking the uploaded plan.
     if (reachedListener && fp.injectedCount == 0) {
         reachedListener(fp.currentIndex);
@@ -1258,6 +1575,7 @@ void flightPlanNavInit(void)
     fp.state = FP_NAV_IDLE;
     fp.currentIndex = 0;
     fp.pendingStartIndex = 0;
+    fp.pagedIndex = UINT16_MAX;
     fp.active = false;
     fp.zBiasM = 0.0f;
     fp.abortReason = FP_ABORT_NONE;
@@ -1285,11 +1603,13 @@ void flightPlanNavInit(void)
 void flightPlanNavEngage(void)
 {
     fp.currentIndex = 0;
+    fp.pagedIndex = UINT16_MAX;     // the stored mission may have been replaced since the last flight
     fp.state = FP_NAV_IDLE;
     fp.abortReason = FP_ABORT_NONE;
-    // Engagement always starts the PG mission; an injected plan does not
+    // Engagement always starts the stored mission; an injected plan does not
     // survive a switch cycle (no resume).
     fp.injectedCount = 0;
+    fp.externalActive = false;
     fp.patternPending = false;
     fp.patternActive = false;
     fp.hdgFaultTimeS = 0.0f;
@@ -1326,7 +1646,7 @@ void flightPlanNavEngage(void)
     fp.isRescuePlan = false;
     fp.rescueHeadingHold = false;
     if (fp.stagedCount > 0) {
-        // A staged failsafe rescue plan replaces the PG mission entirely;
+        // A staged failsafe rescue plan replaces the stored mission entirely;
         // rescue waypoint 0 is dispatched, never PG waypoint 0.
         memcpy(fp.injected, fp.staged, fp.stagedCount * sizeof(fp.injected[0]));
         fp.injectedCount = fp.stagedCount;
@@ -1338,7 +1658,8 @@ void flightPlanNavEngage(void)
     }
 #endif
 
-    if (flightPlanConfig()->waypointCount == 0) {
+    const uint16_t count = missionStoreGetCount();
+    if (count == 0) {
         fp.state = FP_NAV_COMPLETE;
         fp.active = true;
         positionNavClearTarget();
@@ -1346,7 +1667,7 @@ void flightPlanNavEngage(void)
     }
 
     // A MISSION_SET_CURRENT received while idle chooses the starting leg.
-    fp.currentIndex = (fp.pendingStartIndex < flightPlanConfig()->waypointCount) ? fp.pendingStartIndex : 0;
+    fp.currentIndex = (fp.pendingStartIndex < count) ? fp.pendingStartIndex : 0;
     fp.pendingStartIndex = 0;
     fp.active = true;
     // Try to dispatch immediately; if the GPS origin isn't ready yet we stay
@@ -1359,6 +1680,7 @@ void flightPlanNavDisengage(void)
     fp.active = false;
     fp.state = FP_NAV_IDLE;
     fp.injectedCount = 0;
+    fp.externalActive = false;
     fp.patternPending = false;
     fp.patternActive = false;
     fp.hdgFaultTimeS = 0.0f;
@@ -1392,6 +1714,7 @@ bool flightPlanNavInjectPlan(const waypoint_t *waypoints, uint8_t count)
 
     memcpy(fp.injected, waypoints, count * sizeof(*waypoints));
     fp.injectedCount = count;
+    fp.externalActive = false;
     fp.currentIndex = 0;
     fp.abortReason = FP_ABORT_NONE;
     fp.carrotPrevValid = false;   // a fresh plan re-anchors on the craft
@@ -1413,6 +1736,86 @@ bool flightPlanNavIsInjectedPlanActive(void)
     return fp.active && fp.injectedCount > 0;
 }
 
+// The setpoint is a moving target rather than a leg: it never completes
+// (negative acceptance radius, no callback) and the offboard stream, not the
+// executor, decides where the craft goes next.
+static void issueExternalTarget(void)
+{
+    positionNavSetTargetEf(&fp.externalTargetEnuM, autopilotConfig()->maxVelocity * 0.01f,
+                           FP_CARROT_NO_ARRIVAL_M, FP_COMPLETION_ANY_MPS, true, NULL, NULL);
+    positionNavSetAccelLimits(0.0f, FP_APPROACH_DECEL_MPS2);
+    positionNavSetAltitudeArrivalRequired(false);
+}
+
+bool flightPlanNavSetExternalTarget(const vector3_t *posEnuM, const vector3_t *velEnuMps,
+                                    float headingDeg, timeUs_t currentTimeUs)
+{
+    // Injected plans are the geofence and failsafe responses; an offboard
+    // stream must not steer the craft out of them.
+    if (!fp.active || fp.injectedCount > 0
+        || fp.state == FP_NAV_LANDING || fp.state == FP_NAV_ABORTED
+        || !positionEstimatorIsValidXY()) {
+        return false;
+    }
+
+    fp.externalTargetEnuM = *posEnuM;
+    fp.externalVelValid = velEnuMps != NULL;
+    if (velEnuMps) {
+        fp.externalVelEnuMps = *velEnuMps;
+    }
+    fp.externalLastUs = currentTimeUs;
+
+    if (!fp.externalActive) {
+        fp.externalActive = true;
+        fp.state = FP_NAV_TARGETING;
+        fp.patternPending = false;
+        fp.patternActive = false;
+        fp.legIsPassGate = false;
+        fp.legValid = false;
+        fp.inPreTurn = false;
+        issueExternalTarget();
+    } else if (!positionNavHasActiveTarget()) {
+        issueExternalTarget();
+    } else {
+        positionNavMoveTargetEf(&fp.externalTargetEnuM);
+    }
+    positionNavSetPathVelocityEf(fp.externalVelValid ? &fp.externalVelEnuMps : NULL);
+    autopilotSetNavHeadingOverride(headingDeg >= 0.0f, MAX(headingDeg, 0.0f));
+    return true;
+}
+
+bool flightPlanNavIsExternalTargetActive(void)
+{
+    return fp.active && fp.externalActive;
+}
+
+static void updateExternalTarget(timeUs_t currentTimeUs)
+{
+    if (!positionEstimatorIsValidXY()) {
+        fp.externalActive = false;
+        abortMission(FP_ABORT_ESTIMATOR);
+        return;
+    }
+
+    checkGeofence(currentTimeUs);
+    if (fp.injectedCount > 0 || fp.state != FP_NAV_TARGETING) {
+        // The fence response (return plan or landing) has taken over
+        fp.externalActive = false;
+        return;
+    }
+
+    if (fp.externalVelValid && cmpTimeUs(currentTimeUs, fp.externalLastUs) >= (timeDelta_t)FP_EXTERNAL_TIMEOUT_US) {
+        fp.externalVelValid = false;
+        positionNavSetPathVelocityEf(NULL);
+    }
+
+    // Position control re-initialising wipes the target, as for mission legs
+    if (!positionNavHasActiveTarget()) {
+        issueExternalTarget();
+        positionNavSetPathVelocityEf(fp.externalVelValid ? &fp.externalVelEnuMps : NULL);
+    }
+}
+
 void flightPlanNavUpdate(timeUs_t currentTimeUs)
 {
     if (!fp.active) {
@@ -1441,6 +1844,11 @@ void flightPlanNavUpdate(timeUs_t currentTimeUs)
     }
 #endif
 
+    if (fp.externalActive) {
+        updateExternalTarget(currentTimeUs);
+        return;
+    }
+
     // Retry dispatch if we engaged before the estimator had an origin.
     if (fp.state == FP_NAV_IDLE && activePlanCount() > 0) {
         dispatchWaypoint();
@@ -1490,7 +1898,9 @@ void flightPlanNavUpdate(timeUs_t currentTimeUs)
 
     if (fp.state == FP_NAV_TARGETING) {
         const positionEstimate3d_t *est = positionEstimatorGetEstimate();
-        if (fp.legIsPassGate) {
+        if (fp.legIsPassGate && autopilotConfig()->navPathMode == AP_NAV_PATH_SMOOTH) {
+            updateLegPath(dtS, currentTimeUs, est);     // runs the planned reference, owns gate advance + sanity
+        } else if (fp.legIsPassGate) {
             updateLegCarrot(dtS, currentTimeUs, est);   // marches the carrot, owns gate advance + sanity
         } else {
             checkLegProgress(currentTimeUs, est);
@@ -1545,7 +1955,7 @@ flightPlanNavState_e flightPlanNavGetState(void)
     return fp.state;
 }
 
-uint8_t flightPlanNavGetCurrentIndex(void)
+uint16_t flightPlanNavGetCurrentIndex(void)
 {
     return fp.currentIndex;
 }
@@ -1601,15 +2011,16 @@ uint16_t flightPlanNavGetEtaSeconds(void)
     return (etaS >= (float)UINT16_MAX) ? UINT16_MAX : (uint16_t)lrintf(etaS);
 }
 
-bool flightPlanNavSetCurrentIndex(uint8_t index)
+bool flightPlanNavSetCurrentIndex(uint16_t index)
 {
-    // SET_CURRENT addresses the uploaded PG mission; an injected runtime plan
+    // SET_CURRENT addresses the uploaded stored mission; an injected runtime plan
     // (geofence RTH / failsafe rescue) owns its own sequencing.
-    if (fp.injectedCount > 0 || index >= flightPlanConfig()->waypointCount) {
+    if (fp.injectedCount > 0 || index >= missionStoreGetCount()) {
         return false;
     }
 
     if (fp.active) {
+        fp.externalActive = false;    // jumping to a mission item hands control back to the mission
         fp.currentIndex = index;
         fp.patternPending = false;
         fp.patternActive = false;
@@ -25,6 +25,7 @@
 #include <stdint.h>
 
 #include "common/time.h"
+#include "common/vector.h"
 
 #include "pg/flight_plan.h"
 
@@ -64,7 +65,7 @@ void flightPlanNavUpdate(timeUs_t currentTimeUs);
 
 bool flightPlanNavIsActive(void);
 flightPlanNavState_e flightPlanNavGetState(void);
-uint8_t flightPlanNavGetCurrentIndex(void);
+uint16_t flightPlanNavGetCurrentIndex(void);
 flightPlanAbortReason_e flightPlanNavGetAbortReason(void);
 
 // Live navigation geometry to the active waypoint, for OSD/CLI readouts. All
@@ -77,10 +78,10 @@ int32_t flightPlanNavGetBearingToWaypointDeciDeg(void);
 uint16_t flightPlanNavGetEtaSeconds(void);
 
 // Set the active waypoint (MAVLink MISSION_SET_CURRENT). While the executor is
-// running the PG mission it re-dispatches to that leg; while idle it becomes
+// running the stored mission it re-dispatches to that leg; while idle it becomes
 // the index the next engage starts from. Returns false (and does nothing) for
 // out-of-range indices and while an injected plan is active.
-bool flightPlanNavSetCurrentIndex(uint8_t index);
+bool flightPlanNavSetCurrentIndex(uint16_t index);
 
 // Orbit period (deciseconds) at the configured pattern radius for a leg flown
 // at speedCmS (0 = autopilot max velocity). Converts MAVLink LOITER_TURNS turn
@@ -94,10 +95,22 @@ uint16_t flightPlanNavOrbitPeriodDs(uint16_t speedCmS);
 bool flightPlanNavInjectPlan(const waypoint_t *waypoints, uint8_t count);
 bool flightPlanNavIsInjectedPlanActive(void);
 
+// Offboard control (MAVLink SET_POSITION_TARGET_LOCAL_NED from a companion
+// computer): fly to an externally streamed setpoint in place of the mission
+// legs. posEnuM is in the position estimator's frame; velEnuMps (NULL = none)
+// is flown as feedforward; headingDeg < 0 leaves the configured yaw mode in
+// charge. Only valid while the executor is active and not flying a geofence or
+// rescue response; the estimator and geofence checks stay in force. When the
+// stream goes quiet the craft holds the last setpoint. Engage, disengage,
+// an injected plan or MISSION_SET_CURRENT hand control back to the executor.
+bool flightPlanNavSetExternalTarget(const vector3_t *posEnuM, const vector3_t *velEnuMps,
+                                    float headingDeg, timeUs_t currentTimeUs);
+bool flightPlanNavIsExternalTargetActive(void);
+
 #if ENABLE_RESCUE_PLAN
 // Synthesise a failsafe rescue mission (climb-in-place, fly home, land) from
 // the current position and home, staged for the next flightPlanNavEngage() to
-// consume in place of the PG mission; injected immediately if the executor is
+// consume in place of the stored mission; injected immediately if the executor is
 // already active. Returns false when no home or fix exists to build a plan —
 // the failsafe caller then degrades to auto-landing.
 bool flightPlanNavStageRescuePlan(void);
@@ -125,5 +138,5 @@ static inline float flightPlanNavGetRescueVerticalRateCmS(void) { return 0.0f; }
 // Single observer slot for "waypoint reached" — invoked with the index of the
 // waypoint that was just reached, before any HOLD timer or advance. Pass NULL
 // to detach. Used by telemetry/mavlink_mission to emit MISSION_ITEM_REACHED.
-typedef void (*flightPlanWaypointReachedFn)(uint8_t index);
+typedef void (*flightPlanWaypointReachedFn)(uint16_t index);
 void flightPlanNavSetReachedListener(flightPlanWaypointReachedFn fn);
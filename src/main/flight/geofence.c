@@ -0,0 +1,398 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#if ENABLE_FLIGHT_PLAN
+
+#include "common/axis.h"
+#include "common/maths.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+#include "flight/geofence.h"
+#include "flight/position_estimator.h"
+
+#include "io/gps.h"
+
+#include "pg/geofence.h"
+
+#define GEOFENCE_INDEX_BANDS    8
+#define MAX_GEOFENCE_POLYGONS   (MAX_GEOFENCE_ITEMS / 3)
+
+STATIC_ASSERT(MAX_GEOFENCE_ITEMS <= 32, geofence_edges_exceed_edge_mask);
+
+typedef struct {
+    float e0, n0;           // start vertex, cm
+    float de, dn;           // start to end vertex
+    float dEdN;             // east step per cm north, for the point-in-polygon ray
+    float invLengthSq;
+} fenceEdge_t;
+
+typedef struct {
+    float minE, minN, maxE, maxN;
+    float bandsPerCm;
+    uint32_t edges;                             // every edge of the polygon
+    uint32_t bandEdges[GEOFENCE_INDEX_BANDS];   // edges whose north extent overlaps each band
+    bool inclusion;
+} fencePolygon_t;
+
+typedef struct {
+    float e, n;
+    float radius;
+    bool inclusion;
+} fenceCircle_t;
+
+static struct {
+    bool stale;
+    bool built;
+    int32_t originLat;
+    int32_t originLon;
+    uint8_t edgeCount;
+    uint8_t polygonCount;
+    uint8_t circleCount;
+    fenceEdge_t edges[MAX_GEOFENCE_ITEMS];
+    fencePolygon_t polygons[MAX_GEOFENCE_POLYGONS];
+    fenceCircle_t circles[MAX_GEOFENCE_ITEMS];
+} fence;
+
+static bool isPolygonType(uint8_t type)
+{
+    return type == GEOFENCE_POLYGON_INCLUSION || type == GEOFENCE_POLYGON_EXCLUSION;
+}
+
+static bool isCircleType(uint8_t type)
+{
+    return type == GEOFENCE_CIRCLE_INCLUSION || type == GEOFENCE_CIRCLE_EXCLUSION;
+}
+
+bool geofenceItemsValid(const geofenceItem_t *items, uint8_t count)
+{
+    if (count > MAX_GEOFENCE_ITEMS) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; ) {
+        const geofenceItem_t *item = &items[i];
+        if (isPolygonType(item->type)) {
+            const unsigned vertices = item->param;
+            if (vertices < 3 || i + vertices > count) {
+                return false;
+            }
+            for (unsigned k = 1; k < vertices; k++) {
+                if (items[i + k].type != item->type || items[i + k].param != vertices) {
+                    return false;
+                }
+            }
+            i += vertices;
+        } else if (isCircleType(item->type)) {
+            if (item->param == 0) {
+                return false;
+            }
+            i++;
+        } else if (item->type == GEOFENCE_RETURN_POINT) {
+            i++;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void toLocalCm(const gpsLocation_t *origin, const geofenceItem_t *item, float *e, float *n)
+{
+    const gpsLocation_t location = {
+        .lat = item->latitude,
+        .lon = item->longitude,
+        .altCm = origin->altCm,
+    };
+    vector2_t enuCm;
+    GPS_distance2d(origin, &location, &enuCm);
+    *e = enuCm.v[EF_EAST];
+    *n = enuCm.v[EF_NORTH];
+}
+
+static unsigned bandOf(const fencePolygon_t *polygon, float n)
+{
+    const int band = (int)((n - polygon->minN) * polygon->bandsPerCm);
+    return constrain(band, 0, GEOFENCE_INDEX_BANDS - 1);
+}
+
+static void addPolygon(const gpsLocation_t *origin, const geofenceItem_t *items, unsigned vertices)
+{
+    fencePolygon_t *polygon = &fence.polygons[fence.polygonCount++];
+    memset(polygon, 0, sizeof(*polygon));
+    polygon->inclusion = items[0].type == GEOFENCE_POLYGON_INCLUSION;
+    polygon->minE = polygon->minN = FLT_MAX;
+    polygon->maxE = polygon->maxN = -FLT_MAX;
+
+    float e[MAX_GEOFENCE_ITEMS], n[MAX_GEOFENCE_ITEMS];
+    for (unsigned k = 0; k < vertices; k++) {
+        toLocalCm(origin, &items[k], &e[k], &n[k]);
+        polygon->minE = MIN(polygon->minE, e[k]);
+        polygon->maxE = MAX(polygon->maxE, e[k]);
+        polygon->minN = MIN(polygon->minN, n[k]);
+        polygon->maxN = MAX(polygon->maxN, n[k]);
+    }
+    polygon->bandsPerCm = GEOFENCE_INDEX_BANDS / MAX(polygon->maxN - polygon->minN, 1.0f);
+
+    for (unsigned k = 0; k < vertices; k++) {
+        const unsigned next = (k + 1) % vertices;
+        const unsigned index = fence.edgeCount++;
+        fenceEdge_t *edge = &fence.edges[index];
+        edge->e0 = e[k];
+        edge->n0 = n[k];
+        edge->de = e[next] - e[k];
+        edge->dn = n[next] - n[k];
+        edge->dEdN = edge->dn != 0.0f ? edge->de / edge->dn : 0.0f;
+        const float lengthSq = sq(edge->de) + sq(edge->dn);
+        edge->invLengthSq = lengthSq > 0.0f ? 1.0f / lengthSq : 0.0f;
+
+        polygon->edges |= 1u << index;
+        const unsigned firstBand = bandOf(polygon, MIN(n[k], n[next]));
+        const unsigned lastBand = bandOf(polygon, MAX(n[k], n[next]));
+        for (unsigned band = firstBand; band <= lastBand; band++) {
+            polygon->bandEdges[band] |= 1u << index;
+        }
+    }
+}
+
+static void rebuild(const gpsLocation_t *origin)
+{
+    fence.edgeCount = 0;
+    fence.polygonCount = 0;
+    fence.circleCount = 0;
+    fence.originLat = origin->lat;
+    fence.originLon = origin->lon;
+    fence.stale = false;
+    fence.built = true;
+
+    const geofenceConfig_t *cfg = geofenceConfig();
+    // a malformed fence is not enforced at all rather than partially
+    if (!geofenceItemsValid(cfg->items, cfg->itemCount)) {
+        return;
+    }
+    for (unsigned i = 0; i < cfg->itemCount; ) {
+        const geofenceItem_t *item = &cfg->items[i];
+        if (isPolygonType(item->type)) {
+            addPolygon(origin, item, item->param);
+            i += item->param;
+            continue;
+        }
+        if (isCircleType(item->type)) {
+            fenceCircle_t *circle = &fence.circles[fence.circleCount++];
+            toLocalCm(origin, item, &circle->e, &circle->n);
+            circle->radius = item->param * 100.0f;
+            circle->inclusion = item->type == GEOFENCE_CIRCLE_INCLUSION;
+        }
+        i++;
+    }
+}
+
+// False when there is nothing to enforce or no origin to enforce it around.
+static bool ensureIndex(void)
+{
+    if (geofenceConfig()->itemCount == 0) {
+        return false;
+    }
+    gpsLocation_t origin;
+    if (!positionEstimatorGetGpsOrigin(&origin)) {
+        return false;
+    }
+    if (fence.stale || !fence.built || origin.lat != fence.originLat || origin.lon != fence.originLon) {
+        rebuild(&origin);
+    }
+    return fence.polygonCount > 0 || fence.circleCount > 0;
+}
+
+void geofenceInit(void)
+{
+    memset(&fence, 0, sizeof(fence));
+    fence.stale = true;
+}
+
+void geofenceInvalidate(void)
+{
+    fence.stale = true;
+}
+
+static bool insidePolygon(const fencePolygon_t *polygon, float e, float n)
+{
+    if (e < polygon->minE || e > polygon->maxE || n < polygon->minN || n > polygon->maxN) {
+        return false;
+    }
+    // ray towards +East, only the edges of this band can cross it
+    bool inside = false;
+    uint32_t edges = polygon->bandEdges[bandOf(polygon, n)];
+    while (edges) {
+        const fenceEdge_t *edge = &fence.edges[__builtin_ctz(edges)];
+        edges &= edges - 1;
+        if ((edge->n0 > n) != (edge->n0 + edge->dn > n)
+            && e < edge->e0 + (n - edge->n0) * edge->dEdN) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+static bool positionAllowed(float e, float n)
+{
+    for (unsigned i = 0; i < fence.polygonCount; i++) {
+        const fencePolygon_t *polygon = &fence.polygons[i];
+        if (insidePolygon(polygon, e, n) != polygon->inclusion) {
+            return false;
+        }
+    }
+    for (unsigned i = 0; i < fence.circleCount; i++) {
+        const fenceCircle_t *circle = &fence.circles[i];
+        const bool inside = sq(e - circle->e) + sq(n - circle->n) <= sq(circle->radius);
+        if (inside != circle->inclusion) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static float edgeDistanceSq(const fenceEdge_t *edge, float e, float n)
+{
+    const float pe = e - edge->e0;
+    const float pn = n - edge->n0;
+    const float t = constrainf((pe * edge->de + pn * edge->dn) * edge->invLengthSq, 0.0f, 1.0f);
+    return sq(pe - t * edge->de) + sq(pn - t * edge->dn);
+}
+
+static float distanceToBoundary(float e, float n)
+{
+    float bestSq = FLT_MAX;
+    for (unsigned i = 0; i < fence.polygonCount; i++) {
+        const fencePolygon_t *polygon = &fence.polygons[i];
+        // the bounding box is a lower bound for every edge of the polygon
+        const float boxE = MAX(MAX(polygon->minE - e, e - polygon->maxE), 0.0f);
+        const float boxN = MAX(MAX(polygon->minN - n, n - polygon->maxN), 0.0f);
+        if (sq(boxE) + sq(boxN) >= bestSq) {
+            continue;
+        }
+        uint32_t edges = polygon->edges;
+        while (edges) {
+            const fenceEdge_t *edge = &fence.edges[__builtin_ctz(edges)];
+            edges &= edges - 1;
+            bestSq = MIN(bestSq, edgeDistanceSq(edge, e, n));
+        }
+    }
+    float best = sqrtf(bestSq);
+    for (unsigned i = 0; i < fence.circleCount; i++) {
+        const fenceCircle_t *circle = &fence.circles[i];
+        best = MIN(best, fabsf(sqrtf(sq(e - circle->e) + sq(n - circle->n)) - circle->radius));
+    }
+    return best;
+}
+
+static float cross2(float ae, float an, float be, float bn)
+{
+    return ae * bn - an * be;
+}
+
+// Starting from an allowed position, does the straight path to (e1, n1) leave it?
+static bool pathCrossesBoundary(float e0, float n0, float e1, float n1)
+{
+    const float de = e1 - e0;
+    const float dn = n1 - n0;
+    for (unsigned i = 0; i < fence.polygonCount; i++) {
+        const fencePolygon_t *polygon = &fence.polygons[i];
+        if (MAX(e0, e1) < polygon->minE || MIN(e0, e1) > polygon->maxE
+            || MAX(n0, n1) < polygon->minN || MIN(n0, n1) > polygon->maxN) {
+            continue;
+        }
+        uint32_t edges = 0;
+        const unsigned lastBand = bandOf(polygon, MAX(n0, n1));
+        for (unsigned band = bandOf(polygon, MIN(n0, n1)); band <= lastBand; band++) {
+            edges |= polygon->bandEdges[band];
+        }
+        while (edges) {
+            const fenceEdge_t *edge = &fence.edges[__builtin_ctz(edges)];
+            edges &= edges - 1;
+            const float denom = cross2(de, dn, edge->de, edge->dn);
+            if (denom == 0.0f) {
+                continue;
+            }
+            const float qe = edge->e0 - e0;
+            const float qn = edge->n0 - n0;
+            const float t = cross2(qe, qn, edge->de, edge->dn) / denom;
+            const float u = cross2(qe, qn, de, dn) / denom;
+            if (t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f) {
+                return true;
+            }
+        }
+    }
+    for (unsigned i = 0; i < fence.circleCount; i++) {
+        const fenceCircle_t *circle = &fence.circles[i];
+        if (circle->inclusion) {
+            // convex: the path stays inside if its end does
+            if (sq(e1 - circle->e) + sq(n1 - circle->n) > sq(circle->radius)) {
+                return true;
+            }
+        } else {
+            const float lengthSq = sq(de) + sq(dn);
+            const float t = lengthSq > 0.0f
+                ? constrainf(((circle->e - e0) * de + (circle->n - n0) * dn) / lengthSq, 0.0f, 1.0f) : 0.0f;
+            if (sq(e0 + t * de - circle->e) + sq(n0 + t * dn - circle->n) <= sq(circle->radius)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+geofenceStatus_e geofenceCheck(const vector3_t *positionCm, const vector3_t *velocityCms)
+{
+    if (!ensureIndex()) {
+        return GEOFENCE_OK;
+    }
+    const float e = positionCm->v[ENU_E];
+    const float n = positionCm->v[ENU_N];
+    if (!positionAllowed(e, n)) {
+        return GEOFENCE_BREACH;
+    }
+
+    const float lookaheadS = geofenceConfig()->lookaheadDs * 0.1f;
+    const float de = velocityCms->v[ENU_E] * lookaheadS;
+    const float dn = velocityCms->v[ENU_N] * lookaheadS;
+    // nothing within reach of the lookahead path: skip the crossing tests
+    if (sq(de) + sq(dn) < sq(distanceToBoundary(e, n))) {
+        return GEOFENCE_OK;
+    }
+    return pathCrossesBoundary(e, n, e + de, n + dn) ? GEOFENCE_BREACH_PREDICTED : GEOFENCE_OK;
+}
+
+float geofenceDistanceToBoundaryCm(const vector3_t *positionCm)
+{
+    if (!ensureIndex()) {
+        return -1.0f;
+    }
+    return distanceToBoundary(positionCm->v[ENU_E], positionCm->v[ENU_N]);
+}
+
+#endif // ENABLE_FLIGHT_PLAN
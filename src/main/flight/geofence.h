@@ -0,0 +1,54 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common/vector.h"
+
+#include "pg/geofence.h"
+
+// Inclusion/exclusion polygon and circle fences from geofenceConfig. The items
+// are converted once to local ENU around the estimator GPS origin and indexed
+// (bounding boxes, edges bucketed into north bands), so every check costs a
+// bounded number of edge tests. The index is rebuilt when the origin moves or
+// after geofenceInvalidate().
+
+typedef enum {
+    GEOFENCE_OK = 0,
+    GEOFENCE_BREACH_PREDICTED,  // inside, but the current velocity crosses a boundary within the lookahead
+    GEOFENCE_BREACH,            // outside an inclusion or inside an exclusion zone
+} geofenceStatus_e;
+
+void geofenceInit(void);
+// Call after geofenceConfig has been edited.
+void geofenceInvalidate(void);
+
+// Polygons need at least 3 consecutive vertices of one type all carrying the
+// vertex count, circles a radius.
+bool geofenceItemsValid(const geofenceItem_t *items, uint8_t count);
+
+// Position in cm and velocity in cm/s, estimator ENU; only East and North are used.
+geofenceStatus_e geofenceCheck(const vector3_t *positionCm, const vector3_t *velocityCms);
+// Distance to the nearest fence boundary in cm, -1 without an enforceable fence.
+float geofenceDistanceToBoundaryCm(const vector3_t *positionCm);
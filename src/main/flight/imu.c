@@ -53,6 +53,8 @@
 #include "sensors/gyro.h"
 #include "sensors/sensors.h"
 
+#include "telemetry/mavlink_offboard.h"
+
 #if ENABLE_SIMULATOR_MULTITHREAD
 #include <stdio.h>
 #include <pthread.h>
@@ -805,6 +807,9 @@ void imuUpdateAttitude(timeUs_t currentTimeUs)
 #endif
         imuCalculateEstimatedAttitude(currentTimeUs);
         IMU_UNLOCK;
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+        mavlinkOffboardCaptureAttitude(currentTimeUs);
+#endif
 
         // Update the throttle correction for angle and supply it to the mixer
         int throttleAngleCorrection = 0;
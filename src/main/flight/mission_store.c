@@ -0,0 +1,449 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#if ENABLE_FLIGHT_PLAN
+
+#include "common/crc.h"
+#include "common/maths.h"
+#include "common/streambuf.h"
+#include "common/utils.h"
+
+#include "drivers/flash/flash.h"
+
+#include "flight/mission_store.h"
+
+#include "pg/flight_plan.h"
+
+#ifdef USE_MISSION_STORE
+
+// Partition layout: a header at the start of the partition, records from the
+// second flash page on so the header can be programmed last, on its own.
+//
+// Header:  magic u32, version u8, record size u8, count u16, crc16 of the records u16
+// Record:  latitude i32, longitude i32, altitude i24 (cm), type u4 | pattern u4 << 4,
+//          speed u16, duration u16
+// All little endian. An erased header (magic 0xFFFFFFFF) means no mission, so a
+// power loss during an upload leaves the store empty rather than half written.
+#define MISSION_STORE_MAGIC             0x534d4642  // "BFMS"
+#define MISSION_STORE_VERSION           1
+#define MISSION_STORE_HEADER_SIZE       10
+#define MISSION_STORE_WRITE_BUFFER_SIZE 256         // records are buffered up to this many bytes per program
+
+STATIC_ASSERT(MISSION_STORE_WRITE_BUFFER_SIZE % MISSION_STORE_RECORD_SIZE == 0, mission_store_buffer_not_record_aligned);
+STATIC_ASSERT((MISSION_STORE_WINDOW_SIZE & (MISSION_STORE_WINDOW_SIZE - 1)) == 0, mission_store_window_not_power_of_two);
+
+#define WINDOW_EMPTY                    0xffff
+
+static struct {
+    bool active;                // storage is FLASH and the partition exists
+    uint32_t baseAddress;
+    uint32_t recordsAddress;
+    uint32_t sectorSize;
+    uint16_t capacity;
+    uint16_t count;             // committed waypoints, 0 while writing
+
+    // sector erases still to issue, run by missionStoreEraseAsync()
+    uint32_t eraseAddress;
+    uint32_t eraseEnd;
+
+    // write-once upload
+    bool writing;
+    uint16_t writeLimit;
+    uint16_t writeIndex;
+    uint16_t writeCrc;
+    uint16_t bufferedBytes;
+    uint32_t bufferAddress;
+    uint8_t buffer[MISSION_STORE_WRITE_BUFFER_SIZE];
+
+    // paged window, direct mapped by index; scratch takes lookups that map onto the pinned slot
+    uint16_t windowIndex[MISSION_STORE_WINDOW_SIZE];
+    waypoint_t window[MISSION_STORE_WINDOW_SIZE];
+    uint16_t scratchIndex;
+    waypoint_t scratch;
+    uint16_t pinnedIndex;
+} store;
+
+static void encodeWaypoint(uint8_t *record, const waypoint_t *wp)
+{
+    sbuf_t buf;
+    sbufInit(&buf, record, record + MISSION_STORE_RECORD_SIZE);
+    sbufWriteU32(&buf, wp->latitude);
+    sbufWriteU32(&buf, wp->longitude);
+    sbufWriteU8(&buf, wp->altitude & 0xff);
+    sbufWriteU8(&buf, (wp->altitude >> 8) & 0xff);
+    sbufWriteU8(&buf, (wp->altitude >> 16) & 0xff);
+    sbufWriteU8(&buf, (wp->type & 0x0f) | (wp->pattern << 4));
+    sbufWriteU16(&buf, wp->speed);
+    sbufWriteU16(&buf, wp->duration);
+}
+
+static void decodeWaypoint(waypoint_t *wp, uint8_t *record)
+{
+    sbuf_t buf;
+    sbufInit(&buf, record, record + MISSION_STORE_RECORD_SIZE);
+    wp->latitude = sbufReadU32(&buf);
+    wp->longitude = sbufReadU32(&buf);
+    uint32_t altitude = sbufReadU8(&buf);
+    altitude |= sbufReadU8(&buf) << 8;
+    altitude |= sbufReadU8(&buf) << 16;
+    wp->altitude = (int32_t)(altitude << 8) >> 8;   // sign extend 24 bits
+    const uint8_t typePattern = sbufReadU8(&buf);
+    wp->type = typePattern & 0x0f;
+    wp->pattern = typePattern >> 4;
+    wp->speed = sbufReadU16(&buf);
+    wp->duration = sbufReadU16(&buf);
+}
+
+static uint32_t recordAddress(uint16_t index)
+{
+    return store.recordsAddress + (uint32_t)index * MISSION_STORE_RECORD_SIZE;
+}
+
+static bool readWaypoint(uint16_t index, waypoint_t *wp)
+{
+    uint8_t record[MISSION_STORE_RECORD_SIZE];
+    if (flashReadBytes(recordAddress(index), record, sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+    decodeWaypoint(wp, record);
+    return true;
+}
+
+static void invalidateWindow(void)
+{
+    for (int i = 0; i < MISSION_STORE_WINDOW_SIZE; i++) {
+        store.windowIndex[i] = WINDOW_EMPTY;
+    }
+    store.scratchIndex = WINDOW_EMPTY;
+    store.pinnedIndex = WINDOW_EMPTY;
+}
+
+static const waypoint_t *pagedWaypoint(uint16_t index)
+{
+    const unsigned slot = index & (MISSION_STORE_WINDOW_SIZE - 1);
+    if (store.windowIndex[slot] == index) {
+        return &store.window[slot];
+    }
+
+    const bool slotPinned = store.pinnedIndex != WINDOW_EMPTY
+        && (store.pinnedIndex & (MISSION_STORE_WINDOW_SIZE - 1)) == slot;
+    if (slotPinned) {
+        if (store.scratchIndex != index) {
+            store.scratchIndex = WINDOW_EMPTY;
+            if (!readWaypoint(index, &store.scratch)) {
+                return NULL;
+            }
+            store.scratchIndex = index;
+        }
+        return &store.scratch;
+    }
+
+    store.windowIndex[slot] = WINDOW_EMPTY;
+    if (!readWaypoint(index, &store.window[slot])) {
+        return NULL;
+    }
+    store.windowIndex[slot] = index;
+    return &store.window[slot];
+}
+
+static bool readHeader(uint16_t *count)
+{
+    uint8_t header[MISSION_STORE_HEADER_SIZE];
+    if (flashReadBytes(store.baseAddress, header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    sbuf_t buf;
+    sbufInit(&buf, header, header + sizeof(header));
+    const uint32_t magic = sbufReadU32(&buf);
+    const uint8_t version = sbufReadU8(&buf);
+    const uint8_t recordSize = sbufReadU8(&buf);
+    *count = sbufReadU16(&buf);
+    const uint16_t expectedCrc = sbufReadU16(&buf);
+    if (magic != MISSION_STORE_MAGIC || version != MISSION_STORE_VERSION
+        || recordSize != MISSION_STORE_RECORD_SIZE || *count > store.capacity) {
+        return false;
+    }
+
+    // verify the records once at boot, in chunks through the write buffer
+    uint16_t crc = 0;
+    uint32_t remaining = (uint32_t)*count * MISSION_STORE_RECORD_SIZE;
+    uint32_t address = store.recordsAddress;
+    while (remaining > 0) {
+        const uint32_t chunk = MIN(remaining, (uint32_t)sizeof(store.buffer));
+        if (flashReadBytes(address, store.buffer, chunk) != (int)chunk) {
+            return false;
+        }
+        crc = crc16_ccitt_update(crc, store.buffer, chunk);
+        address += chunk;
+        remaining -= chunk;
+    }
+    return crc == expectedCrc;
+}
+
+static void flushWriteBuffer(void)
+{
+    if (store.bufferedBytes > 0) {
+        flashPageProgram(store.bufferAddress, store.buffer, store.bufferedBytes, NULL);
+        store.bufferAddress += store.bufferedBytes;
+        store.bufferedBytes = 0;
+    }
+}
+
+// Sector erases block the flash for tens of milliseconds each, so they are only
+// queued here and issued one at a time as the flash becomes idle
+static void eraseSectorsAsync(uint32_t length)
+{
+    store.eraseAddress = store.baseAddress;
+    store.eraseEnd = store.baseAddress + length;
+}
+
+static bool erasePending(void)
+{
+    return store.eraseAddress < store.eraseEnd;
+}
+#endif // USE_MISSION_STORE
+
+void missionStoreInit(void)
+{
+#ifdef USE_MISSION_STORE
+    memset(&store, 0, sizeof(store));
+    invalidateWindow();
+
+    const flashPartition_t *partition = flashPartitionFindByType(FLASH_PARTITION_TYPE_MISSION);
+    if (flightPlanConfig()->missionStorage != MISSION_STORAGE_FLASH || !partition) {
+        return;
+    }
+    const flashGeometry_t *geometry = flashGetGeometry();
+    store.sectorSize = geometry->sectorSize;
+    store.baseAddress = partition->startSector * geometry->sectorSize;
+    store.recordsAddress = store.baseAddress + MAX(geometry->pageSize, MISSION_STORE_HEADER_SIZE);
+    const uint32_t partitionSize = FLASH_PARTITION_SECTOR_COUNT(partition) * geometry->sectorSize;
+    const uint32_t capacity = (partitionSize - (store.recordsAddress - store.baseAddress)) / MISSION_STORE_RECORD_SIZE;
+    store.capacity = MIN(capacity, (uint32_t)UINT16_MAX - 1);
+    store.active = true;
+
+    uint16_t count;
+    if (readHeader(&count)) {
+        store.count = count;
+    }
+#endif
+}
+
+bool missionStoreIsFlash(void)
+{
+#ifdef USE_MISSION_STORE
+    return store.active;
+#else
+    return false;
+#endif
+}
+
+uint16_t missionStoreGetCount(void)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        return store.count;
+    }
+#endif
+    return MIN(flightPlanConfig()->waypointCount, MAX_WAYPOINTS);
+}
+
+uint16_t missionStoreGetCapacity(void)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        return store.capacity;
+    }
+#endif
+    return MAX_WAYPOINTS;
+}
+
+const waypoint_t *missionStoreGetWaypoint(uint16_t index)
+{
+    if (index >= missionStoreGetCount()) {
+        return NULL;
+    }
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        return pagedWaypoint(index);
+    }
+#endif
+    return &flightPlanConfig()->waypoints[index];
+}
+
+void missionStorePrefetch(uint16_t index)
+{
+#ifdef USE_MISSION_STORE
+    if (!store.active || index >= store.count) {
+        return;
+    }
+    // unpin first so the new active leg can take its own slot
+    store.pinnedIndex = WINDOW_EMPTY;
+    const uint16_t end = MIN(store.count, (uint32_t)index + MISSION_STORE_WINDOW_SIZE);
+    for (uint16_t i = index; i < end; i++) {
+        pagedWaypoint(i);
+    }
+    store.pinnedIndex = index;
+#else
+    UNUSED(index);
+#endif
+}
+
+bool missionStoreBeginWrite(uint16_t count)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        if (count > store.capacity) {
+            return false;
+        }
+        store.count = 0;
+        invalidateWindow();
+        eraseSectorsAsync(store.recordsAddress - store.baseAddress + (uint32_t)count * MISSION_STORE_RECORD_SIZE);
+        store.writing = true;
+        store.writeLimit = count;
+        store.writeIndex = 0;
+        store.writeCrc = 0;
+        store.bufferedBytes = 0;
+        store.bufferAddress = store.recordsAddress;
+        return true;
+    }
+#endif
+    if (count > MAX_WAYPOINTS) {
+        return false;
+    }
+    flightPlanConfigMutable()->waypointCount = 0;
+    return true;
+}
+
+bool missionStoreWriteWaypoint(uint16_t index, const waypoint_t *wp)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        // records are appended, the flash is only ever programmed once per upload
+        if (!store.writing || erasePending() || index != store.writeIndex || index >= store.writeLimit) {
+            return false;
+        }
+        uint8_t *record = &store.buffer[store.bufferedBytes];
+        encodeWaypoint(record, wp);
+        store.writeCrc = crc16_ccitt_update(store.writeCrc, record, MISSION_STORE_RECORD_SIZE);
+        store.bufferedBytes += MISSION_STORE_RECORD_SIZE;
+        store.writeIndex++;
+        if (store.bufferedBytes == sizeof(store.buffer)) {
+            flushWriteBuffer();
+        }
+        return true;
+    }
+#endif
+    if (index >= MAX_WAYPOINTS) {
+        return false;
+    }
+    flightPlanConfigMutable()->waypoints[index] = *wp;
+    return true;
+}
+
+bool missionStoreCommit(uint16_t count)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        if (!store.writing || erasePending() || count > store.writeIndex) {
+            return false;
+        }
+        flushWriteBuffer();
+        store.writing = false;
+
+        // a commit with fewer waypoints than written leaves the tail out of the crc
+        uint16_t crc = store.writeCrc;
+        if (count < store.writeIndex) {
+            crc = 0;
+            for (uint16_t i = 0; i < count; i++) {
+                uint8_t record[MISSION_STORE_RECORD_SIZE];
+                if (flashReadBytes(recordAddress(i), record, sizeof(record)) != sizeof(record)) {
+                    return false;
+                }
+                crc = crc16_ccitt_update(crc, record, sizeof(record));
+            }
+        }
+
+        uint8_t header[MISSION_STORE_HEADER_SIZE];
+        sbuf_t buf;
+        sbufInit(&buf, header, header + sizeof(header));
+        sbufWriteU32(&buf, MISSION_STORE_MAGIC);
+        sbufWriteU8(&buf, MISSION_STORE_VERSION);
+        sbufWriteU8(&buf, MISSION_STORE_RECORD_SIZE);
+        sbufWriteU16(&buf, count);
+        sbufWriteU16(&buf, crc);
+        flashPageProgram(store.baseAddress, header, sizeof(header), NULL);
+        flashFlush();
+
+        store.count = count;
+        invalidateWindow();
+        return true;
+    }
+#endif
+    if (count > MAX_WAYPOINTS) {
+        return false;
+    }
+    flightPlanConfigMutable()->waypointCount = count;
+    return true;
+}
+
+void missionStoreClear(void)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        store.writing = false;
+        store.count = 0;
+        invalidateWindow();
+        // erasing the header sector is enough to invalidate the mission
+        eraseSectorsAsync(1);
+        return;
+    }
+#endif
+    flightPlanConfigMutable()->waypointCount = 0;
+}
+
+void missionStoreEraseAsync(void)
+{
+#ifdef USE_MISSION_STORE
+    if (erasePending() && flashIsReady()) {
+        flashEraseSector(store.eraseAddress);
+        store.eraseAddress += store.sectorSize;
+    }
+#endif
+}
+
+bool missionStoreIsReady(void)
+{
+#ifdef USE_MISSION_STORE
+    if (store.active) {
+        return !erasePending() && flashIsReady();
+    }
+#endif
+    return true;
+}
+
+#endif // ENABLE_FLIGHT_PLAN
@@ -0,0 +1,66 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pg/flight_plan.h"
+
+// The stored mission flown by the flight-plan executor and exchanged over MAVLink.
+//
+// With mission_storage = PG it is flightPlanConfig (MAX_WAYPOINTS, saved with the
+// configuration). With mission_storage = FLASH it lives in a dedicated flash
+// partition as fixed-size records, so thousands of waypoints fit and RAM use does
+// not depend on the mission size: only a small window of waypoints around the
+// active leg is paged in. The CLI and stick capture always edit the PG mission.
+
+#define MISSION_STORE_RECORD_SIZE       16      // bytes per waypoint in flash
+#define MISSION_STORE_WINDOW_SIZE       8       // waypoints paged into RAM, power of two
+
+void missionStoreInit(void);
+
+// True when the flash partition holds the active mission.
+bool missionStoreIsFlash(void);
+uint16_t missionStoreGetCount(void);
+uint16_t missionStoreGetCapacity(void);
+
+// NULL when index is out of range or the record cannot be read. A paged waypoint
+// stays valid until a later lookup pages over it; the one passed to the most
+// recent missionStorePrefetch() is never paged out.
+const waypoint_t *missionStoreGetWaypoint(uint16_t index);
+
+// Page in index and the waypoints following it (the active leg and its lookahead).
+void missionStorePrefetch(uint16_t index);
+
+// Write-once upload: erase room for count waypoints, write them in order, then
+// commit the number actually written. The previous mission is gone after begin.
+// The erase runs in the background; waypoints are accepted once the store is ready.
+bool missionStoreBeginWrite(uint16_t count);
+bool missionStoreWriteWaypoint(uint16_t index, const waypoint_t *wp);
+bool missionStoreCommit(uint16_t count);
+void missionStoreClear(void);
+
+// Issue the next queued sector erase if the flash is idle. Call periodically.
+void missionStoreEraseAsync(void);
+// False while erases queued by a begin or clear are outstanding.
+bool missionStoreIsReady(void);
@@ -0,0 +1,177 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "platform.h"
+
+#if ENABLE_FLIGHT_PLAN
+
+#include "common/maths.h"
+#include "common/vector.h"
+
+#include "flight/nav_path.h"
+
+// Control points as fractions of the setback, measured from the corner. The
+// inner pair sets how tightly the curve hugs the waypoint: the midpoint ends up
+// at corner + (out - in) * setback * 9.25/32. These values minimise the peak
+// curvature of a right-angle turn (about 1.05/setback).
+#define NAV_PATH_CTRL_MID   0.85f
+#define NAV_PATH_CTRL_NEAR  0.4f
+#define NAV_PATH_ARC_SUBSTEPS 4
+
+static const float bernstein5[6] = { 1.0f, 5.0f, 10.0f, 10.0f, 5.0f, 1.0f };
+static const float bernstein4[5] = { 1.0f, 4.0f, 6.0f, 4.0f, 1.0f };
+static const float bernstein3[4] = { 1.0f, 3.0f, 3.0f, 1.0f };
+
+static float basis(const float *binomial, int degree, int i, float t)
+{
+    float value = binomial[i];
+    for (int k = 0; k < i; k++) {
+        value *= t;
+    }
+    for (int k = i; k < degree; k++) {
+        value *= 1.0f - t;
+    }
+    return value;
+}
+
+static void bezierPoint(const vector2_t *ctrl, float t, vector2_t *p)
+{
+    vector2Zero(p);
+    for (int i = 0; i < 6; i++) {
+        const float b = basis(bernstein5, 5, i, t);
+        p->x += b * ctrl[i].x;
+        p->y += b * ctrl[i].y;
+    }
+}
+
+static void bezierDerivatives(const vector2_t *ctrl, float t, vector2_t *d1, vector2_t *d2)
+{
+    vector2Zero(d1);
+    for (int i = 0; i < 5; i++) {
+        const float b = 5.0f * basis(bernstein4, 4, i, t);
+        d1->x += b * (ctrl[i + 1].x - ctrl[i].x);
+        d1->y += b * (ctrl[i + 1].y - ctrl[i].y);
+    }
+    if (d2 == NULL) {
+        return;
+    }
+    vector2Zero(d2);
+    for (int i = 0; i < 4; i++) {
+        const float b = 20.0f * basis(bernstein3, 3, i, t);
+        d2->x += b * (ctrl[i + 2].x - 2.0f * ctrl[i + 1].x + ctrl[i].x);
+        d2->y += b * (ctrl[i + 2].y - 2.0f * ctrl[i + 1].y + ctrl[i].y);
+    }
+}
+
+static float curvatureAt(const vector2_t *ctrl, float t)
+{
+    vector2_t d1, d2;
+    bezierDerivatives(ctrl, t, &d1, &d2);
+    const float speed = vector2Norm(&d1);
+    if (speed < 1e-6f) {
+        return 0.0f;
+    }
+    return fabsf(vector2Cross(&d1, &d2)) / (speed * speed * speed);
+}
+
+void navPathBuildFillet(navPathFillet_t *fillet, const vector2_t *corner,
+                        const vector2_t *inDir, const vector2_t *outDir, float setbackM)
+{
+    static const float inFraction[3] = { 1.0f, NAV_PATH_CTRL_MID, NAV_PATH_CTRL_NEAR };
+    for (int i = 0; i < 3; i++) {
+        fillet->ctrl[i].x = corner->x - inDir->x * setbackM * inFraction[i];
+        fillet->ctrl[i].y = corner->y - inDir->y * setbackM * inFraction[i];
+        fillet->ctrl[5 - i].x = corner->x + outDir->x * setbackM * inFraction[i];
+        fillet->ctrl[5 - i].y = corner->y + outDir->y * setbackM * inFraction[i];
+    }
+
+    // Chord sums over sub-steps; the corner curvature is bounded, so this is
+    // well inside a centimetre on any flyable fillet.
+    vector2_t prev = fillet->ctrl[0];
+    float lengthM = 0.0f;
+    float maxCurvature = 0.0f;
+    fillet->arcLenM[0] = 0.0f;
+    for (int i = 1; i <= NAV_PATH_FILLET_SAMPLES; i++) {
+        for (int k = 1; k <= NAV_PATH_ARC_SUBSTEPS; k++) {
+            const float t = (i - 1 + (float)k / NAV_PATH_ARC_SUBSTEPS) / NAV_PATH_FILLET_SAMPLES;
+            vector2_t p;
+            bezierPoint(fillet->ctrl, t, &p);
+            vector2_t chord;
+            vector2Sub(&chord, &p, &prev);
+            lengthM += vector2Norm(&chord);
+            prev = p;
+            maxCurvature = fmaxf(maxCurvature, curvatureAt(fillet->ctrl, t));
+        }
+        fillet->arcLenM[i] = lengthM;
+    }
+    fillet->maxCurvature = maxCurvature;
+}
+
+float navPathUnitCurvature(const vector2_t *inDir, const vector2_t *outDir)
+{
+    navPathFillet_t unit;
+    const vector2_t origin = { .x = 0.0f, .y = 0.0f };
+    navPathBuildFillet(&unit, &origin, inDir, outDir, 1.0f);
+    return unit.maxCurvature;
+}
+
+float navPathFilletLengthM(const navPathFillet_t *fillet)
+{
+    return fillet->arcLenM[NAV_PATH_FILLET_SAMPLES];
+}
+
+float navPathFilletMidLengthM(const navPathFillet_t *fillet)
+{
+    return fillet->arcLenM[NAV_PATH_FILLET_SAMPLES / 2];
+}
+
+void navPathFilletSample(const navPathFillet_t *fillet, float sM, vector2_t *pos, vector2_t *tangent)
+{
+    sM = constrainf(sM, 0.0f, navPathFilletLengthM(fillet));
+
+    int i = 0;
+    while (i < NAV_PATH_FILLET_SAMPLES - 1 && fillet->arcLenM[i + 1] < sM) {
+        i++;
+    }
+    const float span = fillet->arcLenM[i + 1] - fillet->arcLenM[i];
+    const float frac = (span > 1e-6f) ? (sM - fillet->arcLenM[i]) / span : 0.0f;
+    const float t = (i + frac) / NAV_PATH_FILLET_SAMPLES;
+
+    bezierPoint(fillet->ctrl, t, pos);
+
+    vector2_t d1;
+    bezierDerivatives(fillet->ctrl, t, &d1, NULL);
+    if (vector2Norm(&d1) < 1e-6f) {
+        vector2Sub(&d1, &fillet->ctrl[5], &fillet->ctrl[0]);
+    }
+    const float norm = vector2Norm(&d1);
+    if (norm > 1e-6f) {
+        vector2Scale(tangent, &d1, 1.0f / norm);
+    } else {
+        tangent->x = 1.0f;
+        tangent->y = 0.0f;
+    }
+}
+
+#endif // ENABLE_FLIGHT_PLAN
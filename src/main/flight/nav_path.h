@@ -0,0 +1,57 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "common/vector.h"
+
+// Corner fillets for smooth flight-plan paths. A fillet is a quintic Bézier
+// whose first three control points lie on the inbound leg and last three on
+// the outbound leg, so its curvature is zero where it joins either straight:
+// lateral acceleration ramps in and out instead of stepping (jerk-limited).
+// The curve is symmetric about the corner; its parameter midpoint is the point
+// closest to the waypoint. Arc length is tabulated at build time so sampling
+// by distance along the path is a table lookup.
+
+#define NAV_PATH_FILLET_SAMPLES 16
+
+typedef struct navPathFillet_s {
+    vector2_t ctrl[6];                                  // control points, ENU metres
+    float arcLenM[NAV_PATH_FILLET_SAMPLES + 1];         // cumulative arc length at uniform parameter steps
+    float maxCurvature;                                 // 1/m
+} navPathFillet_t;
+
+// setbackM is how far back along each leg from the corner the fillet starts
+// and ends. inDir and outDir are unit leg directions.
+void navPathBuildFillet(navPathFillet_t *fillet, const vector2_t *corner,
+                        const vector2_t *inDir, const vector2_t *outDir, float setbackM);
+
+// Peak curvature of a fillet with a 1 m setback for this turn; it scales as
+// 1/setback, so setback = k * v^2 / a_lat carries speed v through the corner.
+float navPathUnitCurvature(const vector2_t *inDir, const vector2_t *outDir);
+
+float navPathFilletLengthM(const navPathFillet_t *fillet);
+float navPathFilletMidLengthM(const navPathFillet_t *fillet);
+
+// Position and unit tangent at arc length sM from the fillet start
+void navPathFilletSample(const navPathFillet_t *fillet, float sM, vector2_t *pos, vector2_t *tangent);
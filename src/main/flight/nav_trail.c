@@ -19,10 +19,18 @@
  * If not, see <http://www.gnu.org/licenses/>.
  */
 
-// Breadcrumb trail recorder for the OSD navigation map: keeps a decimated
+// Breadcrumb trail recorder for the OSD navigation map: keeps a simplified
 // polyline of flown positions, in local ENU metres relative to home. Points
 // are laid down by distance flown, not by time — hovering adds nothing, so
 // the stored line is the geometry of the flight, not its duration.
+//
+// When the buffer runs low it is compacted in place with Douglas-Peucker: the
+// vertices that matter least to the shape go first, so straight legs shrink to
+// their end points while corners survive. The tolerance starts at a metre and
+// doubles only when a pass cannot free enough room, so it adapts to the size
+// and complexity of the flight. navTrailUpdate() runs from the RX task, so a
+// pass is spread over many calls with a fixed amount of work each, while new
+// points keep going into the room left at the end of the buffer.
 
 #include <math.h>
 #include <string.h>
@@ -45,18 +53,38 @@
 
 #define NAV_TRAIL_UPDATE_INTERVAL_US 100000  // 10 Hz poll; the spacing gate does the real decimation
 #define NAV_TRAIL_SPACING_M          5       // minimum distance between stored points
-#define NAV_TRAIL_MAX_SPACING_M      5000    // spacing growth cap under adaptive decimation
+#define NAV_TRAIL_TOLERANCE_M        1.0f    // initial simplification tolerance
+#define NAV_TRAIL_COMPACT_START      (NAV_TRAIL_CAPACITY * 4 / 5)   // points kept free for recording during a pass
+#define NAV_TRAIL_COMPACT_TARGET     (NAV_TRAIL_CAPACITY * 3 / 5)   // a pass leaves two fifths of the buffer free
+#define NAV_TRAIL_COMPACT_BUDGET     64      // point to segment distances per call
 
 static navTrailPoint_t trail[NAV_TRAIL_CAPACITY];
 static unsigned trailCount = 0;
-static uint16_t trailSpacingM = NAV_TRAIL_SPACING_M;
+static float trailToleranceM = NAV_TRAIL_TOLERANCE_M;
+static uint16_t trailRevision = 0;
+static uint32_t trailKeep[(NAV_TRAIL_CAPACITY + 31) / 32];
 static bool wasArmed = false;
 static timeUs_t lastUpdateUs = 0;
 
+// Douglas-Peucker pass in progress over the first count points, resumable at
+// any vertex of any span
+static struct {
+    bool active;
+    unsigned count;
+    unsigned kept;
+    unsigned start;         // span being split, start and end both kept
+    unsigned end;
+    unsigned next;          // next vertex of the span to measure, 0 before the span is set up
+    unsigned worst;
+    float worstSq;
+} compaction;
+
 void navTrailReset(void)
 {
     trailCount = 0;
-    trailSpacingM = NAV_TRAIL_SPACING_M;
+    trailToleranceM = NAV_TRAIL_TOLERANCE_M;
+    trailRevision++;
+    compaction.active = false;
 }
 
 unsigned navTrailCount(void)
@@ -72,21 +100,128 @@ const navTrailPoint_t *navTrailPointAt(unsigned index)
     return &trail[index];
 }
 
-static void pushTrailPoint(int16_t eastM, int16_t northM)
+uint16_t navTrailRevision(void)
+{
+    return trailRevision;
+}
+
+static bool isKept(unsigned index)
 {
-    // Adaptive decimation: when full, drop every second point and double the
-    // spacing so the whole flight stays represented at reduced resolution.
-    while (trailCount >= NAV_TRAIL_CAPACITY) {
-        for (unsigned i = 0; i < trailCount / 2; i++) {
-            trail[i] = trail[i * 2 + 1];
+    return trailKeep[index / 32] & (1u << (index % 32));
+}
+
+static void setKept(unsigned index)
+{
+    trailKeep[index / 32] |= 1u << (index % 32);
+}
+
+// Squared distance from p to the segment a-b, metres^2
+static float segmentDistanceSq(const navTrailPoint_t *p, const navTrailPoint_t *a, const navTrailPoint_t *b)
+{
+    const float abE = b->eastM - a->eastM;
+    const float abN = b->northM - a->northM;
+    const float apE = p->eastM - a->eastM;
+    const float apN = p->northM - a->northM;
+    const float lenSq = abE * abE + abN * abN;
+    const float t = (lenSq > 0.0f) ? constrainf((apE * abE + apN * abN) / lenSq, 0.0f, 1.0f) : 0.0f;
+    return sq(apE - t * abE) + sq(apN - t * abN);
+}
+
+static void beginSimplifyPass(void)
+{
+    memset(trailKeep, 0, sizeof(trailKeep));
+    setKept(0);
+    setKept(compaction.count - 1);
+    compaction.kept = 2;
+    compaction.start = 0;
+    compaction.next = 0;
+}
+
+// Douglas-Peucker over the points of the pass, marking survivors in trailKeep.
+// Iterative rather than recursive: each span between two kept vertices is
+// split at its farthest vertex until every span is within tolerance, so the
+// state is the keep mask and the position in the current span. Measures at
+// most budget vertices; returns true once the pass is complete.
+static bool continueSimplifyPass(float toleranceM, unsigned budget)
+{
+    const float toleranceSq = sq(toleranceM);
+    while (compaction.start < compaction.count - 1) {
+        if (compaction.next == 0) {
+            unsigned end = compaction.start + 1;
+            while (!isKept(end)) {
+                end++;
+            }
+            compaction.end = end;
+            compaction.next = compaction.start + 1;
+            compaction.worst = 0;
+            compaction.worstSq = toleranceSq;
+        }
+        for (; compaction.next < compaction.end; compaction.next++) {
+            if (budget == 0) {
+                return false;
+            }
+            budget--;
+            const unsigned i = compaction.next;
+            const float dSq = segmentDistanceSq(&trail[i], &trail[compaction.start], &trail[compaction.end]);
+            if (dSq > compaction.worstSq) {
+                compaction.worstSq = dSq;
+                compaction.worst = i;
+            }
+        }
+        if (compaction.worst != 0) {
+            setKept(compaction.worst);
+            compaction.kept++;
+        } else {
+            compaction.start = compaction.end;
         }
-        trailCount /= 2;
-        trailSpacingM = MIN(trailSpacingM * 2, NAV_TRAIL_MAX_SPACING_M);
+        compaction.next = 0;
+    }
+    return true;
+}
+
+// One bounded step of compaction. Each pass measures against the previous
+// simplified line, so the error against the flown track is bounded by the sum
+// of the tolerances used; with doubling that is under twice the current one.
+STATIC_UNIT_TESTED void navTrailCompactStep(void)
+{
+    if (!compaction.active || !continueSimplifyPass(trailToleranceM, NAV_TRAIL_COMPACT_BUDGET)) {
+        return;
+    }
+    if (compaction.kept > NAV_TRAIL_COMPACT_TARGET) {
+        trailToleranceM *= 2.0f;
+        beginSimplifyPass();
+        return;
+    }
+
+    // survivors of the pass, then the points recorded while it ran
+    unsigned count = 0;
+    for (unsigned i = 0; i < trailCount; i++) {
+        if (i >= compaction.count || isKept(i)) {
+            trail[count++] = trail[i];
+        }
+    }
+    trailCount = count;
+    trailRevision++;
+    compaction.active = false;
+}
+
+static void pushTrailPoint(int16_t eastM, int16_t northM)
+{
+    if (trailCount >= NAV_TRAIL_CAPACITY) {
+        // the pass has not caught up: keep the line ending at the craft
+        trailCount--;
+        trailRevision++;
     }
 
     trail[trailCount].eastM = eastM;
     trail[trailCount].northM = northM;
     trailCount++;
+
+    if (trailCount >= NAV_TRAIL_COMPACT_START && !compaction.active) {
+        compaction.active = true;
+        compaction.count = trailCount;
+        beginSimplifyPass();
+    }
 }
 
 // Feed one position (local ENU cm relative to home) through the distance
@@ -96,7 +231,7 @@ STATIC_UNIT_TESTED void navTrailIngestPosition(const vector2_t *posCm)
     // clamp to the int16 range BEFORE the distance gate - a GPS glitch past
     // +-32km otherwise leaves the raw coord in the gate math while the stored
     // point is already clamped, so dx/dy blow up, the gate fires every tick,
-    // and the buffer fills with the same clamped point until decimation has
+    // and the buffer fills with the same clamped point until compaction has
     // eaten the real trail
     const int16_t eastM = constrain(lrintf(posCm->x / 100.0f), INT16_MIN, INT16_MAX);
     const int16_t northM = constrain(lrintf(posCm->y / 100.0f), INT16_MIN, INT16_MAX);
@@ -109,14 +244,15 @@ STATIC_UNIT_TESTED void navTrailIngestPosition(const vector2_t *posCm)
     const navTrailPoint_t *last = &trail[trailCount - 1];
     const int64_t dx = eastM - last->eastM;
     const int64_t dy = northM - last->northM;
-    const int64_t spacing = trailSpacingM;
-    if (dx * dx + dy * dy >= spacing * spacing) {
+    if (dx * dx + dy * dy >= NAV_TRAIL_SPACING_M * NAV_TRAIL_SPACING_M) {
         pushTrailPoint(eastM, northM);
     }
 }
 
 void navTrailUpdate(timeUs_t currentTimeUs)
 {
+    navTrailCompactStep();
+
     // the trail is per-flight: reset on the arm edge, before this cycle's
     // position can be recorded, so the new line starts at the new launch point
     const bool armed = ARMING_FLAG(ARMED);
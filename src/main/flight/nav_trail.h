@@ -27,7 +27,8 @@
 
 #ifdef USE_OSD_NAV_MAP
 
-// Build-time cap for trail storage. 240 points * 4 bytes = 960 bytes of RAM.
+// Build-time cap for trail storage. 240 points * 4 bytes = 960 bytes of RAM,
+// plus a 30-byte mask used while compacting.
 #define NAV_TRAIL_CAPACITY 240
 
 // Trail points are stored in whole metres East/North of home: at map scales a
@@ -38,7 +39,8 @@ typedef struct navTrailPoint_s {
 } navTrailPoint_t;
 
 // Called periodically from the main loop; rate-limits internally and appends
-// a point once the craft has flown far enough from the last stored one.
+// a point once the craft has flown far enough from the last stored one. Every
+// call also runs a bounded step of any compaction in progress.
 void navTrailUpdate(timeUs_t currentTimeUs);
 void navTrailReset(void);
 
@@ -46,4 +48,9 @@ void navTrailReset(void);
 unsigned navTrailCount(void);
 const navTrailPoint_t *navTrailPointAt(unsigned index);
 
+// Bumped whenever stored points move or disappear (reset, compaction). While
+// it holds, the trail only grows at the end, so a consumer that has drawn
+// the first n points need only draw the rest.
+uint16_t navTrailRevision(void);
+
 #endif // USE_OSD_NAV_MAP
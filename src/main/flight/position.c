@@ -28,6 +28,8 @@
 
 #include "build/debug.h"
 
+#include "drivers/time.h"
+
 #include "common/maths.h"
 #include "common/filter.h"
 
@@ -46,6 +48,8 @@
 #include "sensors/barometer.h"
 #include "sensors/rangefinder.h"
 
+#include "telemetry/mavlink_offboard.h"
+
 #include "pg/pg.h"
 #include "pg/pg_ids.h"
 
@@ -95,7 +99,7 @@ void positionInit(void)
     positionEstimatorInit();
 }
 
-PG_REGISTER_WITH_RESET_TEMPLATE(positionConfig_t, positionConfig, PG_POSITION, 7);
+PG_REGISTER_WITH_RESET_TEMPLATE(positionConfig_t, positionConfig, PG_POSITION, 9);
 
 PG_RESET_TEMPLATE(positionConfig_t, positionConfig,
     .altitude_source = ALTITUDE_SOURCE_DEFAULT,
@@ -103,6 +107,9 @@ PG_RESET_TEMPLATE(positionConfig_t, positionConfig,
     .altitude_lpf = 300,
     .altitude_d_lpf = 300,
     .rangefinder_max_range_cm = 400,
+    .gps_delay_ms = 100,
+    .opticalflow_delay_ms = 20,
+    .position_ekf = false,
 );
 
 #if defined(USE_BARO) || defined(USE_GPS) || defined(USE_RANGEFINDER)
@@ -120,6 +127,9 @@ void calculateEstimatedAltitude(void)
 
     // Run the Kalman filter estimator (prediction + all sensor measurement updates)
     positionEstimatorUpdate();
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    mavlinkOffboardCapturePosition(micros());
+#endif
 
     // Get raw KF altitude estimate
     const float kfAltCm = positionEstimatorGetAltitudeCm();
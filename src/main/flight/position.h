@@ -23,6 +23,7 @@
 #include "common/time.h"
 
 #define TASK_ALTITUDE_RATE_HZ 100
+#define POSITION_MAX_MEASUREMENT_DELAY_MS 250
 
 typedef enum {
     ALTITUDE_SOURCE_DEFAULT = 0,
@@ -38,6 +39,9 @@ typedef struct positionConfig_s {
     uint16_t altitude_lpf;                // lowpass cutoff (value / 100) Hz for altitude smoothing
     uint16_t altitude_d_lpf;              // lowpass for (value / 100) Hz for altitude derivative smoothing
     uint16_t rangefinder_max_range_cm;    // Maximum rangefinder range to trust (cm)
+    uint8_t gps_delay_ms;                 // Age of a GPS solution when it reaches the estimator (ms)
+    uint8_t opticalflow_delay_ms;         // Age of an optical flow sample when it reaches the estimator (ms)
+    uint8_t position_ekf;                 // Use the coupled EKF (with accelerometer bias) instead of the per-axis filters
 } positionConfig_t;
 
 PG_DECLARE(positionConfig_t, positionConfig);
@@ -0,0 +1,201 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_POSITION_EKF
+
+#include "common/maths.h"
+
+#include "position_ekf.h"
+
+#define GRAVITY_CMSS        980.665f
+
+// Innovations beyond this many standard deviations are treated as outliers
+#define EKF_INNOVATION_GATE_SIGMA   10.0f
+
+// First state of each 3-axis block, indexed by axis (E/N/U or body X/Y/Z)
+#define EKF_POS     EKF_POS_E
+#define EKF_VEL     EKF_VEL_E
+#define EKF_BIAS    EKF_ACC_BIAS_X
+
+void positionEkfInit(positionEkf_t *ekf, const positionEkfConfig_t *config, float initialPosVar, float initialVelVar, float initialBiasVar)
+{
+    memset(ekf, 0, sizeof(*ekf));
+    ekf->config = *config;
+    for (int axis = 0; axis < 3; axis++) {
+        ekf->P[EKF_POS + axis][EKF_POS + axis] = initialPosVar;
+        ekf->P[EKF_VEL + axis][EKF_VEL + axis] = initialVelVar;
+        ekf->P[EKF_BIAS + axis][EKF_BIAS + axis] = initialBiasVar;
+    }
+    ekf->P[EKF_BARO_OFFSET][EKF_BARO_OFFSET] = initialPosVar;
+}
+
+void positionEkfResetState(positionEkf_t *ekf, positionEkfState_e state, float value, float variance)
+{
+    ekf->x[state] = value;
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        ekf->P[state][i] = 0.0f;
+        ekf->P[i][state] = 0.0f;
+    }
+    ekf->P[state][state] = variance;
+}
+
+// Prediction with the measured specific force as control input.
+//
+// Nominal state:
+//   a = R * (accel - bias) - g
+//   pos += vel * dt + 0.5 * a * dt^2
+//   vel += a * dt
+//
+// Error state transition F = I plus the blocks
+//   d(pos)/d(vel)  =  dt * I
+//   d(pos)/d(bias) = -0.5 * dt^2 * R
+//   d(vel)/d(bias) = -dt * R
+// P = F * P * F' + Q is evaluated block-wise, touching only the position and velocity
+// rows and columns, instead of as two dense 10x10 matrix products.
+void positionEkfPredict(positionEkf_t *ekf, float dt, const matrix33_t *bodyToEnu, const vector3_t *accelBody)
+{
+    const float halfDt2 = 0.5f * dt * dt;
+    const float (*R)[3] = bodyToEnu->m;
+
+    // Nominal state
+    for (int axis = 0; axis < 3; axis++) {
+        float accel = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            accel += R[axis][k] * (accelBody->v[k] - ekf->x[EKF_BIAS + k]);
+        }
+        if (axis == 2) {
+            accel -= GRAVITY_CMSS;
+        }
+        ekf->x[EKF_POS + axis] += ekf->x[EKF_VEL + axis] * dt + halfDt2 * accel;
+        ekf->x[EKF_VEL + axis] += accel * dt;
+    }
+
+    // P = F * P, row operations
+    for (int j = 0; j < EKF_STATE_COUNT; j++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float rotatedBias = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                rotatedBias += R[axis][k] * ekf->P[EKF_BIAS + k][j];
+            }
+            const float pVel = ekf->P[EKF_VEL + axis][j];
+            ekf->P[EKF_POS + axis][j] += dt * pVel - halfDt2 * rotatedBias;
+            ekf->P[EKF_VEL + axis][j] = pVel - dt * rotatedBias;
+        }
+    }
+
+    // P = P * F', column operations
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        float *row = ekf->P[i];
+        for (int axis = 0; axis < 3; axis++) {
+            float rotatedBias = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                rotatedBias += R[axis][k] * row[EKF_BIAS + k];
+            }
+            const float pVel = row[EKF_VEL + axis];
+            row[EKF_POS + axis] += dt * pVel - halfDt2 * rotatedBias;
+            row[EKF_VEL + axis] = pVel - dt * rotatedBias;
+        }
+    }
+
+    // The two passes round differently, mirror the touched rows so P stays exactly symmetric
+    for (int i = EKF_POS; i < EKF_BIAS; i++) {
+        for (int j = i + 1; j < EKF_STATE_COUNT; j++) {
+            const float p = 0.5f * (ekf->P[i][j] + ekf->P[j][i]);
+            ekf->P[i][j] = p;
+            ekf->P[j][i] = p;
+        }
+    }
+
+    // Process noise: accelerometer noise through B = [0.5*dt^2, dt], random walks on bias and baro offset
+    for (int axis = 0; axis < 3; axis++) {
+        const float q = axis == 2 ? ekf->config.qAccelZ : ekf->config.qAccelXY;
+        ekf->P[EKF_POS + axis][EKF_POS + axis] += halfDt2 * halfDt2 * q;
+        ekf->P[EKF_POS + axis][EKF_VEL + axis] += halfDt2 * dt * q;
+        ekf->P[EKF_VEL + axis][EKF_POS + axis] += halfDt2 * dt * q;
+        ekf->P[EKF_VEL + axis][EKF_VEL + axis] += dt * dt * q;
+        ekf->P[EKF_BIAS + axis][EKF_BIAS + axis] += dt * ekf->config.qAccelBias;
+    }
+    ekf->P[EKF_BARO_OFFSET][EKF_BARO_OFFSET] += dt * ekf->config.qBaroOffset;
+}
+
+// Scalar update for a measurement h * x where h is 1 at the given states and 0 elsewhere.
+// Only the columns of P selected by h are read to form P * h', and the covariance is
+// updated in Joseph form, P = (I - K*h) * P * (I - K*h)' + K*R*K', which expands to
+//   P -= K * c' + c * K' - S * K * K'    with c = P * h', S = h * c + R
+// and is evaluated on the upper triangle and mirrored to keep P symmetric.
+static bool positionEkfScalarUpdate(positionEkf_t *ekf, const positionEkfState_e *states, int stateCount, float measurement, float R)
+{
+    float c[EKF_STATE_COUNT];
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        c[i] = 0.0f;
+        for (int n = 0; n < stateCount; n++) {
+            c[i] += ekf->P[i][states[n]];
+        }
+    }
+
+    float S = R;
+    float innovation = measurement;
+    for (int n = 0; n < stateCount; n++) {
+        S += c[states[n]];
+        innovation -= ekf->x[states[n]];
+    }
+    if (S < 1e-9f) {
+        return false;
+    }
+    if (sq(innovation) > sq(EKF_INNOVATION_GATE_SIGMA) * S) {
+        ekf->rejectedUpdates++;
+        return false;
+    }
+
+    const float sInv = 1.0f / S;
+    float K[EKF_STATE_COUNT];
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        K[i] = c[i] * sInv;
+        ekf->x[i] += K[i] * innovation;
+    }
+
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        for (int j = i; j < EKF_STATE_COUNT; j++) {
+            const float p = ekf->P[i][j] - K[i] * c[j] - c[i] * K[j] + S * K[i] * K[j];
+            ekf->P[i][j] = p;
+            ekf->P[j][i] = p;
+        }
+    }
+    return true;
+}
+
+bool positionEkfUpdateState(positionEkf_t *ekf, positionEkfState_e state, float measurement, float R)
+{
+    return positionEkfScalarUpdate(ekf, &state, 1, measurement, R);
+}
+
+bool positionEkfUpdateStateSum(positionEkf_t *ekf, positionEkfState_e stateA, positionEkfState_e stateB, float measurement, float R)
+{
+    const positionEkfState_e states[] = { stateA, stateB };
+    return positionEkfScalarUpdate(ekf, states, 2, measurement, R);
+}
+
+#endif // USE_POSITION_EKF
@@ -0,0 +1,78 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "common/vector.h"
+
+// Coupled 3D error-state Kalman filter for the position estimator.
+//
+// Nominal state: position and velocity (ENU, cm and cm/s), accelerometer bias in the
+// body frame (cm/s^2) and the barometer offset (cm). The filter tracks the covariance of
+// the error of that state; corrections are injected into the nominal state after every
+// measurement. Because the bias lives in the body frame and is rotated by the attitude,
+// tilt changes make it observable on all three axes, which the independent per-axis
+// filters in position_filter.h cannot do.
+typedef enum {
+    EKF_POS_E = 0,
+    EKF_POS_N,
+    EKF_POS_U,
+    EKF_VEL_E,
+    EKF_VEL_N,
+    EKF_VEL_U,
+    EKF_ACC_BIAS_X,
+    EKF_ACC_BIAS_Y,
+    EKF_ACC_BIAS_Z,
+    EKF_BARO_OFFSET,
+    EKF_STATE_COUNT
+} positionEkfState_e;
+
+typedef struct positionEkfConfig_s {
+    float qAccelXY;         // accelerometer noise driving horizontal velocity, (cm/s^2)^2
+    float qAccelZ;          // accelerometer noise driving vertical velocity, (cm/s^2)^2
+    float qAccelBias;       // accelerometer bias random walk, (cm/s^2)^2 per second
+    float qBaroOffset;      // barometer offset random walk, cm^2 per second
+} positionEkfConfig_t;
+
+typedef struct positionEkf_s {
+    float x[EKF_STATE_COUNT];
+    float P[EKF_STATE_COUNT][EKF_STATE_COUNT];
+    positionEkfConfig_t config;
+    unsigned rejectedUpdates;   // measurements rejected by the innovation gate
+} positionEkf_t;
+
+void positionEkfInit(positionEkf_t *ekf, const positionEkfConfig_t *config, float initialPosVar, float initialVelVar, float initialBiasVar);
+// Reset one state to value with the given variance, dropping its correlations with the
+// other states; the rest, including the learned bias, are kept.
+void positionEkfResetState(positionEkf_t *ekf, positionEkfState_e state, float value, float variance);
+
+// bodyToEnu rotates body frame vectors into ENU. accelBody is the measured specific force in cm/s^2.
+void positionEkfPredict(positionEkf_t *ekf, float dt, const matrix33_t *bodyToEnu, const vector3_t *accelBody);
+
+// Scalar measurement of a single state, e.g. GPS position or velocity on one axis.
+bool positionEkfUpdateState(positionEkf_t *ekf, positionEkfState_e state, float measurement, float R);
+// Scalar measurement of the sum of two states, e.g. barometer altitude = position up + baro offset.
+bool positionEkfUpdateStateSum(positionEkf_t *ekf, positionEkfState_e stateA, positionEkfState_e stateB, float measurement, float R);
+
+static inline float positionEkfGetState(const positionEkf_t *ekf, positionEkfState_e state) { return ekf->x[state]; }
+static inline float positionEkfGetVariance(const positionEkf_t *ekf, positionEkfState_e state) { return ekf->P[state][state]; }
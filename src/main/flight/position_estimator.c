@@ -36,6 +36,7 @@
 #include "fc/runtime_config.h"
 
 #include "flight/imu.h"
+#include "flight/position_ekf.h"
 #include "flight/position_estimator.h"
 #include "flight/position_filter.h"
 #include "flight/position.h"
@@ -83,6 +84,12 @@
 #define R_BARO_ALT          1500.0f     // cm^2 lower value favours rapid baro changes
 #define R_RANGEFINDER_ALT    100.0f     // cm^2
 #define R_OPTICALFLOW_VEL    400.0f     // (cm/s)^2 at max quality
+#define R_STATIONARY_VEL     400.0f     // (cm/s)^2 zero velocity assumed while disarmed (EKF only)
+
+// Error-state EKF random walks
+#define Q_ACCEL_BIAS          1.0f      // (cm/s^2)^2 per second
+#define Q_BARO_OFFSET        25.0f      // cm^2 per second
+#define INITIAL_BIAS_VAR   2500.0f      // (cm/s^2)^2 (0.05g uncertainty)
 
 #define GRAVITY_CMSS        980.665f
 
@@ -188,6 +195,37 @@ static timeUs_t lastZMeasurementUs = 0;
 
 static sensorCalEntry_t zCal[CAL_Z_COUNT];
 
+#ifdef USE_POSITION_EKF
+// Coupled alternative to kfEast/kfNorth/kfUp, selected by position_ekf
+static positionEkf_t ekf;
+static bool ekfActive = false;
+#endif
+
+// Delayed-state buffer.
+// GPS solutions and optical flow samples describe the craft as it was gps_delay_ms /
+// opticalflow_delay_ms ago. The filters are snapshotted after every estimator step so
+// these measurements can be fused against the state at their own timestamp; the
+// resulting correction is then carried forward through the newer snapshots to now.
+#define STATE_HISTORY_SIZE  32  // estimator steps, must cover POSITION_MAX_MEASUREMENT_DELAY_MS
+
+STATIC_ASSERT(STATE_HISTORY_SIZE >= POSITION_MAX_MEASUREMENT_DELAY_MS * TASK_ALTITUDE_RATE_HZ / 1000, state_history_too_short);
+
+typedef struct {
+    positionKalman_t kf[XYZ_AXIS_COUNT];
+    bool xyPredicted;   // kfEast/kfNorth were predicted in the step that ended with this snapshot
+} stateSnapshot_t;
+
+static positionKalman_t * const kfAxis[XYZ_AXIS_COUNT] = {
+    [ENU_E] = &kfEast,
+    [ENU_N] = &kfNorth,
+    [ENU_U] = &kfUp,
+};
+
+static stateSnapshot_t stateHistory[STATE_HISTORY_SIZE];
+static unsigned stateHistoryHead = 0;   // slot for the snapshot of the current step
+static unsigned stateHistoryCount = 0;
+static bool xyPredictedThisStep = false;
+
 #ifdef USE_GPS
 static uint16_t gpsStamp = 0;
 static gpsLocation_t armLocationGps;
@@ -207,6 +245,82 @@ static float rangefinderAltOffsetCm = 0.0f;
 static bool rangefinderOffsetSet = false;
 #endif
 
+static void resetStateHistory(void)
+{
+    stateHistoryHead = 0;
+    stateHistoryCount = 0;
+}
+
+// Restart the history of the axes from firstAxis to lastAxis from their freshly
+// reset live filters, keeping the snapshots of the other axes
+static void resetStateHistoryAxes(int firstAxis, int lastAxis)
+{
+    for (unsigned i = 0; i < STATE_HISTORY_SIZE; i++) {
+        for (int axis = firstAxis; axis <= lastAxis; axis++) {
+            stateHistory[i].kf[axis] = *kfAxis[axis];
+        }
+    }
+}
+
+static void recordStateHistory(void)
+{
+    stateSnapshot_t *snapshot = &stateHistory[stateHistoryHead];
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        snapshot->kf[axis] = *kfAxis[axis];
+    }
+    snapshot->xyPredicted = xyPredictedThisStep;
+
+    stateHistoryHead = (stateHistoryHead + 1) % STATE_HISTORY_SIZE;
+    stateHistoryCount = MIN(stateHistoryCount + 1, (unsigned)STATE_HISTORY_SIZE);
+}
+
+// Number of estimator steps a measurement of the given age lies in the past, limited to the kept history
+static unsigned measurementDelaySteps(uint8_t delayMs)
+{
+    const unsigned steps = (delayMs * TASK_ALTITUDE_RATE_HZ + 500) / 1000;
+    return MIN(steps, stateHistoryCount);
+}
+
+static unsigned historyIndex(unsigned steps)
+{
+    return (stateHistoryHead + STATE_HISTORY_SIZE - steps) % STATE_HISTORY_SIZE;
+}
+
+// Filter a measurement 'steps' estimator steps old is fused into: the live filter when
+// it is current, otherwise a scratch copy of the snapshot, see delayedFusionApply().
+static positionKalman_t *delayedFusionBegin(int axis, unsigned steps, positionKalman_t *scratch)
+{
+    if (steps == 0) {
+        return kfAxis[axis];
+    }
+    *scratch = stateHistory[historyIndex(steps)].kf[axis];
+    return scratch;
+}
+
+// Carry the correction made to the past snapshot forward through the newer snapshots to the live filter
+static void delayedFusionApply(int axis, unsigned steps, const positionKalman_t *updated)
+{
+    if (steps == 0) {
+        return;
+    }
+
+    const float dt = HZ_TO_INTERVAL(TASK_ALTITUDE_RATE_HZ);
+    unsigned index = historyIndex(steps);
+    positionKalmanCorrection_t correction;
+    kalmanCorrectionInit(&correction, &stateHistory[index].kf[axis], updated);
+
+    for (unsigned i = steps; i > 0; i--) {
+        kalmanApplyCorrection(&stateHistory[index].kf[axis], &correction);
+        index = (index + 1) % STATE_HISTORY_SIZE;
+        // the step leading up to the next snapshot, or for the oldest step the live filter
+        const bool predicted = (axis == ENU_U) || (i > 1 ? stateHistory[index].xyPredicted : xyPredictedThisStep);
+        if (predicted) {
+            kalmanCorrectionPredict(&correction, dt);
+        }
+    }
+    kalmanApplyCorrection(kfAxis[axis], &correction);
+}
+
 static void initZCalEntries(void)
 {
     for (int i = 0; i < CAL_Z_COUNT; i++) {
@@ -221,6 +335,63 @@ static void initZCalEntries(void)
 #endif
 }
 
+#ifdef USE_POSITION_EKF
+// The EKF keeps no state history: a delayed position is moved forward to now with the estimated velocity instead
+static void ekfFusePosition(int axis, float positionCm, float R, uint8_t delayMs)
+{
+    const float velocity = positionEkfGetState(&ekf, EKF_VEL_E + axis);
+    positionEkfUpdateState(&ekf, EKF_POS_E + axis, positionCm + velocity * delayMs * 0.001f, R);
+}
+
+static void ekfFuseVelocity(int axis, float velocityCmS, float R)
+{
+    positionEkfUpdateState(&ekf, EKF_VEL_E + axis, velocityCmS, R);
+}
+
+// Body to ENU rotation and measured specific force in cm/s^2, the EKF prediction inputs
+static void ekfPredict(float dt)
+{
+    matrix33_t bodyToEnu;
+    for (int i = 0; i < 3; i++) {
+        // rMat rows are NWU; East is -West
+        bodyToEnu.m[ENU_E][i] = -rMat.m[NWU_W][i];
+        bodyToEnu.m[ENU_N][i] = rMat.m[NWU_N][i];
+        bodyToEnu.m[ENU_U][i] = rMat.m[NWU_U][i];
+    }
+    const float accScale = acc.dev.acc_1G_rec * GRAVITY_CMSS;
+    const vector3_t accelBody = {{ acc.accADC.x * accScale, acc.accADC.y * accScale, acc.accADC.z * accScale }};
+
+    positionEkfPredict(&ekf, dt, &bodyToEnu, &accelBody);
+
+    if (!ARMING_FLAG(ARMED)) {
+        // Sitting on the ground: observing zero velocity is what makes the accelerometer bias converge before takeoff
+        for (int axis = 0; axis < 3; axis++) {
+            ekfFuseVelocity(axis, 0.0f, R_STATIONARY_VEL);
+        }
+    }
+}
+#endif
+
+static void ekfResetXY(void)
+{
+#ifdef USE_POSITION_EKF
+    // keeps the learned accelerometer bias
+    positionEkfResetState(&ekf, EKF_POS_E, 0.0f, INITIAL_POS_VAR);
+    positionEkfResetState(&ekf, EKF_POS_N, 0.0f, INITIAL_POS_VAR);
+    positionEkfResetState(&ekf, EKF_VEL_E, 0.0f, INITIAL_VEL_VAR);
+    positionEkfResetState(&ekf, EKF_VEL_N, 0.0f, INITIAL_VEL_VAR);
+#endif
+}
+
+static void ekfResetZ(void)
+{
+#ifdef USE_POSITION_EKF
+    positionEkfResetState(&ekf, EKF_POS_U, 0.0f, INITIAL_POS_VAR);
+    positionEkfResetState(&ekf, EKF_VEL_U, 0.0f, INITIAL_VEL_VAR);
+    positionEkfResetState(&ekf, EKF_BARO_OFFSET, 0.0f, INITIAL_POS_VAR);
+#endif
+}
+
 void positionEstimatorInit(void)
 {
 
@@ -231,6 +402,16 @@ void positionEstimatorInit(void)
     kalmanInit(&kfEast, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, qaccelXY);
     kalmanInit(&kfNorth, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, qaccelXY);
     kalmanInit(&kfUp, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, Q_ACCEL_Z);
+#ifdef USE_POSITION_EKF
+    const positionEkfConfig_t ekfConfig = {
+        .qAccelXY = qaccelXY,
+        .qAccelZ = Q_ACCEL_Z,
+        .qAccelBias = Q_ACCEL_BIAS,
+        .qBaroOffset = Q_BARO_OFFSET,
+    };
+    positionEkfInit(&ekf, &ekfConfig, INITIAL_POS_VAR, INITIAL_VEL_VAR, INITIAL_BIAS_VAR);
+    ekfActive = positionConfig()->position_ekf;
+#endif
     estimate.position = (vector3_t){{0, 0, 0}};
     estimate.velocity = (vector3_t){{0, 0, 0}};
     estimate.trustXY = 0.0f;
@@ -241,6 +422,7 @@ void positionEstimatorInit(void)
     xyEnabled = false;
     lastXYMeasurementUs = 0;
     lastZMeasurementUs = 0;
+    resetStateHistory();
 
 #ifdef USE_GPS
     gpsStamp = 0;
@@ -266,12 +448,14 @@ void positionEstimatorEnableXY(bool enable)
     if (enable && !xyEnabled) {
         kalmanInit(&kfEast, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, qaccelXY);
         kalmanInit(&kfNorth, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, qaccelXY);
+        ekfResetXY();
         estimate.position.v[ENU_E] = 0.0f;
         estimate.position.v[ENU_N] = 0.0f;
         estimate.velocity.v[ENU_E] = 0.0f;
         estimate.velocity.v[ENU_N] = 0.0f;
         lastXYMeasurementUs = 0;
         estimate.isValidXY = false;
+        resetStateHistoryAxes(ENU_E, ENU_N);
 #ifdef USE_GPS
         // Clear before recapture: a stale origin from a prior XY session must
         // not survive into a new one, otherwise the late-capture path (see
@@ -362,6 +546,7 @@ static void feedGPSMeasurements(timeUs_t nowUs)
     const bool gpsXYAllowed = true;
 #endif
     const uint8_t altSource = positionConfig()->altitude_source;
+    const unsigned delaySteps = measurementDelaySteps(positionConfig()->gps_delay_ms);
     const bool gpsAltAllowed = (altSource == ALTITUDE_SOURCE_DEFAULT ||
                                 altSource == ALTITUDE_SOURCE_GPS_ONLY ||
                                 altSource == ALTITUDE_SOURCE_RANGEFINDER_PREFER);
@@ -383,13 +568,24 @@ static void feedGPSMeasurements(timeUs_t nowUs)
 
         const uint16_t xyDop = gpsDopOrFallback(gpsSol.dop.hdop, gpsSol.dop.pdop);
         const float rPos = gpsR(R_GPS_POS_BASE, xyDop);
-        kalmanUpdatePosition(&kfEast, gpsDistCm.v[EF_EAST], rPos);
-        kalmanUpdatePosition(&kfNorth, gpsDistCm.v[EF_NORTH], rPos);
-
         // GPS velocity (NED from UBX) -> ENU
         const float rVel = gpsR(R_GPS_VEL_BASE, xyDop);
-        kalmanUpdateVelocity(&kfEast, (float)gpsSol.velned.velE, rVel);
-        kalmanUpdateVelocity(&kfNorth, (float)gpsSol.velned.velN, rVel);
+        const float gpsVelCm[] = { [ENU_E] = gpsSol.velned.velE, [ENU_N] = gpsSol.velned.velN };
+
+        for (int axis = ENU_E; axis <= ENU_N; axis++) {
+#ifdef USE_POSITION_EKF
+            if (ekfActive) {
+                ekfFusePosition(axis, gpsDistCm.v[axis], rPos, positionConfig()->gps_delay_ms);
+                ekfFuseVelocity(axis, gpsVelCm[axis], rVel);
+                continue;
+            }
+#endif
+            positionKalman_t scratch;
+            positionKalman_t *kf = delayedFusionBegin(axis, delaySteps, &scratch);
+            kalmanUpdatePosition(kf, gpsDistCm.v[axis], rPos);
+            kalmanUpdateVelocity(kf, gpsVelCm[axis], rVel);
+            delayedFusionApply(axis, delaySteps, kf);
+        }
 
         lastXYMeasurementUs = nowUs;
     }
@@ -408,7 +604,17 @@ static void feedGPSMeasurements(timeUs_t nowUs)
         const float gpsAltR = gpsR(R_GPS_ALT_BASE, altDop) * (1.0f + baroPreference * 2.0f);
 
         const float gpsRelativeAltCm = gpsSol.llh.altCm - gpsAltOffsetCm;
-        kalmanUpdatePosition(&kfUp, gpsRelativeAltCm, gpsAltR);
+#ifdef USE_POSITION_EKF
+        if (ekfActive) {
+            ekfFusePosition(ENU_U, gpsRelativeAltCm, gpsAltR, positionConfig()->gps_delay_ms);
+        } else
+#endif
+        {
+            positionKalman_t scratch;
+            positionKalman_t *kf = delayedFusionBegin(ENU_U, delaySteps, &scratch);
+            kalmanUpdatePosition(kf, gpsRelativeAltCm, gpsAltR);
+            delayedFusionApply(ENU_U, delaySteps, kf);
+        }
         lastZMeasurementUs = nowUs;
 
         zCal[CAL_Z_GPS].rawReading = gpsSol.llh.altCm;
@@ -445,7 +651,15 @@ static void feedBaroMeasurements(timeUs_t nowUs)
     const float baroPreference = constrainf(positionConfig()->altitude_prefer_baro * 0.01f, 0.01f, 1.0f);
     const float baroR = R_BARO_ALT / baroPreference;
 
-    kalmanUpdatePosition(&kfUp, baroAltCm - baroAltOffsetCm, baroR);
+#ifdef USE_POSITION_EKF
+    if (ekfActive) {
+        // the EKF estimates the baro drift itself, baroAltOffsetCm stays at the captured baseline
+        positionEkfUpdateStateSum(&ekf, EKF_POS_U, EKF_BARO_OFFSET, baroAltCm - baroAltOffsetCm, baroR);
+    } else
+#endif
+    {
+        kalmanUpdatePosition(&kfUp, baroAltCm - baroAltOffsetCm, baroR);
+    }
     lastZMeasurementUs = nowUs;
 
     zCal[CAL_Z_BARO].rawReading = baroAltCm;
@@ -481,7 +695,14 @@ static void feedRangefinderMeasurements(timeUs_t nowUs)
         rfR *= 0.25f;  // even lower noise -> stronger pull
     }
 
-    kalmanUpdatePosition(&kfUp, altCm - rangefinderAltOffsetCm, rfR);
+#ifdef USE_POSITION_EKF
+    if (ekfActive) {
+        positionEkfUpdateState(&ekf, EKF_POS_U, altCm - rangefinderAltOffsetCm, rfR);
+    } else
+#endif
+    {
+        kalmanUpdatePosition(&kfUp, altCm - rangefinderAltOffsetCm, rfR);
+    }
     lastZMeasurementUs = nowUs;
 
     zCal[CAL_Z_RF].rawReading = altCm;
@@ -557,8 +778,21 @@ static void feedOpticalFlowMeasurements(timeUs_t nowUs)
     const float velEast  =  velForward * sinYaw - velRight * cosYaw;
     const float velNorth =  velForward * cosYaw + velRight * sinYaw;
 
-    kalmanUpdateVelocity(&kfEast, velEast, flowR);
-    kalmanUpdateVelocity(&kfNorth, velNorth, flowR);
+    const float flowVelCm[] = { [ENU_E] = velEast, [ENU_N] = velNorth };
+    const unsigned delaySteps = measurementDelaySteps(positionConfig()->opticalflow_delay_ms);
+
+    for (int axis = ENU_E; axis <= ENU_N; axis++) {
+#ifdef USE_POSITION_EKF
+        if (ekfActive) {
+            ekfFuseVelocity(axis, flowVelCm[axis], flowR);
+            continue;
+        }
+#endif
+        positionKalman_t scratch;
+        positionKalman_t *kf = delayedFusionBegin(axis, delaySteps, &scratch);
+        kalmanUpdateVelocity(kf, flowVelCm[axis], flowR);
+        delayedFusionApply(axis, delaySteps, kf);
+    }
 
     lastXYMeasurementUs = nowUs;
 #else
@@ -596,19 +830,28 @@ void positionEstimatorUpdate(void)
         positionEstimatorEnableXY(wantXY);
     }
 
-    // Compute earth-frame linear acceleration from IMU
-    float accelEast, accelNorth, accelUp;
-    getLinearAccelENU(&accelEast, &accelNorth, &accelUp);
-
-    // Z-axis: always runs (for altitude hold, OSD, vario).
-    // While disarmed, predict with zero acceleration so covariance continues to evolve
-    // and incoming baro/rangefinder updates remain responsive.
-    kalmanPredict(&kfUp, dt, ARMING_FLAG(ARMED) ? accelUp : 0.0f);
-
-    // XY axes: only when a consumer is active
-    if (xyEnabled && ARMING_FLAG(ARMED)) {
-        kalmanPredict(&kfEast, dt, accelEast);
-        kalmanPredict(&kfNorth, dt, accelNorth);
+#ifdef USE_POSITION_EKF
+    if (ekfActive) {
+        // All axes always run, so the accelerometer bias is learned on the ground as well
+        ekfPredict(dt);
+    } else
+#endif
+    {
+        // Compute earth-frame linear acceleration from IMU
+        float accelEast, accelNorth, accelUp;
+        getLinearAccelENU(&accelEast, &accelNorth, &accelUp);
+
+        // Z-axis: always runs (for altitude hold, OSD, vario).
+        // While disarmed, predict with zero acceleration so covariance continues to evolve
+        // and incoming baro/rangefinder updates remain responsive.
+        kalmanPredict(&kfUp, dt, ARMING_FLAG(ARMED) ? accelUp : 0.0f);
+
+        // XY axes: only when a consumer is active
+        xyPredictedThisStep = xyEnabled && ARMING_FLAG(ARMED);
+        if (xyPredictedThisStep) {
+            kalmanPredict(&kfEast, dt, accelEast);
+            kalmanPredict(&kfNorth, dt, accelNorth);
+        }
     }
 
     // Feed sensor measurements (order does not matter)
@@ -617,17 +860,45 @@ void positionEstimatorUpdate(void)
     feedRangefinderMeasurements(nowUs);
     feedOpticalFlowMeasurements(nowUs);
 
-    // Calibrate drifting sensor offsets against KF estimate anchored by non-drifting sources
-    crossCalibrateOffsets(zCal, CAL_Z_COUNT, kalmanGetPosition(&kfUp));
+#ifdef USE_POSITION_EKF
+    if (ekfActive) {
+        for (int axis = 0; axis < 3; axis++) {
+            estimate.position.v[axis] = positionEkfGetState(&ekf, EKF_POS_E + axis);
+            estimate.velocity.v[axis] = positionEkfGetState(&ekf, EKF_VEL_E + axis);
+        }
+        if (!xyEnabled) {
+            // horizontal dead reckoning without a consumer is not part of the estimate
+            estimate.position.v[ENU_E] = estimate.position.v[ENU_N] = 0.0f;
+            estimate.velocity.v[ENU_E] = estimate.velocity.v[ENU_N] = 0.0f;
+        }
+        for (int i = 0; i < CAL_Z_COUNT; i++) {
+            zCal[i].active = false;
+        }
 
-    // Extract state into the unified estimate (kfEast/kfNorth/kfUp are the East/North/Up filters)
-    estimate.position.v[ENU_E] = kalmanGetPosition(&kfEast);
-    estimate.position.v[ENU_N] = kalmanGetPosition(&kfNorth);
-    estimate.position.v[ENU_U] = kalmanGetPosition(&kfUp);
+        DEBUG_SET(DEBUG_POSITION_EKF, 0, lrintf(positionEkfGetState(&ekf, EKF_ACC_BIAS_X) * 10));
+        DEBUG_SET(DEBUG_POSITION_EKF, 1, lrintf(positionEkfGetState(&ekf, EKF_ACC_BIAS_Y) * 10));
+        DEBUG_SET(DEBUG_POSITION_EKF, 2, lrintf(positionEkfGetState(&ekf, EKF_ACC_BIAS_Z) * 10));
+        DEBUG_SET(DEBUG_POSITION_EKF, 3, lrintf(positionEkfGetState(&ekf, EKF_BARO_OFFSET)));
+        DEBUG_SET(DEBUG_POSITION_EKF, 4, lrintf(estimate.position.v[ENU_U]));
+        DEBUG_SET(DEBUG_POSITION_EKF, 5, lrintf(estimate.velocity.v[ENU_U]));
+        DEBUG_SET(DEBUG_POSITION_EKF, 6, ekf.rejectedUpdates);
+    } else
+#endif
+    {
+        // Calibrate drifting sensor offsets against KF estimate anchored by non-drifting sources
+        crossCalibrateOffsets(zCal, CAL_Z_COUNT, kalmanGetPosition(&kfUp));
 
-    estimate.velocity.v[ENU_E] = kalmanGetVelocity(&kfEast);
-    estimate.velocity.v[ENU_N] = kalmanGetVelocity(&kfNorth);
-    estimate.velocity.v[ENU_U] = kalmanGetVelocity(&kfUp);
+        recordStateHistory();
+
+        // Extract state into the unified estimate (kfEast/kfNorth/kfUp are the East/North/Up filters)
+        estimate.position.v[ENU_E] = kalmanGetPosition(&kfEast);
+        estimate.position.v[ENU_N] = kalmanGetPosition(&kfNorth);
+        estimate.position.v[ENU_U] = kalmanGetPosition(&kfUp);
+
+        estimate.velocity.v[ENU_E] = kalmanGetVelocity(&kfEast);
+        estimate.velocity.v[ENU_N] = kalmanGetVelocity(&kfNorth);
+        estimate.velocity.v[ENU_U] = kalmanGetVelocity(&kfUp);
+    }
 
     // Validity: based on recent measurement updates
     if (xyEnabled) {
@@ -641,9 +912,16 @@ void positionEstimatorUpdate(void)
 
     // Trust: derived from position covariance (lower variance = higher trust)
     // Map variance to 0-1: trust = 1 / (1 + variance/scale)
-    const float xyVar = (kalmanGetPositionVariance(&kfEast) + kalmanGetPositionVariance(&kfNorth)) * 0.5f;
+    float xyVar = (kalmanGetPositionVariance(&kfEast) + kalmanGetPositionVariance(&kfNorth)) * 0.5f;
+    float zVar = kalmanGetPositionVariance(&kfUp);
+#ifdef USE_POSITION_EKF
+    if (ekfActive) {
+        xyVar = (positionEkfGetVariance(&ekf, EKF_POS_E) + positionEkfGetVariance(&ekf, EKF_POS_N)) * 0.5f;
+        zVar = positionEkfGetVariance(&ekf, EKF_POS_U);
+    }
+#endif
     estimate.trustXY = 1.0f / (1.0f + xyVar / 10000.0f);
-    estimate.trustZ = 1.0f / (1.0f + kalmanGetPositionVariance(&kfUp) / 10000.0f);
+    estimate.trustZ = 1.0f / (1.0f + zVar / 10000.0f);
 }
 
 const positionEstimate3d_t *positionEstimatorGetEstimate(void)
@@ -701,10 +979,12 @@ bool positionEstimatorIsHeadingRequired(void)
 void positionEstimatorResetZ(void)
 {
     kalmanInit(&kfUp, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, Q_ACCEL_Z);
+    ekfResetZ();
     estimate.position.v[ENU_U] = 0.0f;
     estimate.velocity.v[ENU_U] = 0.0f;
     estimate.isValidZ = false;
     lastZMeasurementUs = 0;
+    resetStateHistoryAxes(ENU_U, ENU_U);
 #ifdef USE_GPS
     gpsAltOffsetCm = 0.0f;
     gpsAltOffsetSet = false;
@@ -726,12 +1006,14 @@ void positionEstimatorResetXY(void)
 {
     kalmanInit(&kfEast, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, Q_ACCEL_XY);
     kalmanInit(&kfNorth, 0.0f, 0.0f, INITIAL_POS_VAR, INITIAL_VEL_VAR, Q_ACCEL_XY);
+    ekfResetXY();
     estimate.position.v[ENU_E] = 0.0f;
     estimate.position.v[ENU_N] = 0.0f;
     estimate.velocity.v[ENU_E] = 0.0f;
     estimate.velocity.v[ENU_N] = 0.0f;
     estimate.isValidXY = false;
     lastXYMeasurementUs = 0;
+    resetStateHistoryAxes(ENU_E, ENU_N);
 #ifdef USE_GPS
     gpsArmLocationSet = false;
     if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
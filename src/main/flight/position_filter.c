@@ -19,8 +19,13 @@
  * If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
+
 #include "platform.h"
 
+#include "common/maths.h"
+#include "common/utils.h"
+
 #include "position_filter.h"
 
 void kalmanInit(positionKalman_t *kf, float initialPos, float initialVel,
@@ -143,3 +148,53 @@ void kalmanUpdateVelocity(positionKalman_t *kf, float measuredVel, float R)
     kf->P[1][0] = I_K1 * p10;
     kf->P[1][1] = I_K1 * p11;
 }
+
+// Delayed measurement support.
+//
+// A measurement taken at a past step k is fused into the snapshot of the filter at k.
+// For the linear model above the resulting change propagates to step n independently
+// of the accelerations applied in between (they cancel):
+//   dx(n) = F^(n-k) * dx(k)
+//   dP(n) = F^(n-k) * dP(k) * F'^(n-k)
+// Measurements fused between k and n were computed against the uncorrected state, so
+// the result is exact only when there were none; in practice the error is second order.
+void kalmanCorrectionInit(positionKalmanCorrection_t *correction, const positionKalman_t *before, const positionKalman_t *after)
+{
+    for (int i = 0; i < 2; i++) {
+        correction->x[i] = after->x[i] - before->x[i];
+        for (int j = 0; j < 2; j++) {
+            correction->P[i][j] = after->P[i][j] - before->P[i][j];
+        }
+    }
+}
+
+// Advance a correction by one prediction step: dx = F*dx, dP = F*dP*F'
+void kalmanCorrectionPredict(positionKalmanCorrection_t *correction, float dt)
+{
+    const float p00 = correction->P[0][0];
+    const float p01 = correction->P[0][1];
+    const float p10 = correction->P[1][0];
+    const float p11 = correction->P[1][1];
+
+    correction->x[0] += correction->x[1] * dt;
+
+    correction->P[0][0] = p00 + dt * (p10 + p01) + dt * dt * p11;
+    correction->P[0][1] = p01 + dt * p11;
+    correction->P[1][0] = p10 + dt * p11;
+}
+
+void kalmanApplyCorrection(positionKalman_t *kf, const positionKalmanCorrection_t *correction)
+{
+    kf->x[0] += correction->x[0];
+    kf->x[1] += correction->x[1];
+
+    // A delayed update can only remove uncertainty the filter still has; never let
+    // the variances collapse below zero when intermediate updates already reduced them.
+    const float p00 = kf->P[0][0] + correction->P[0][0];
+    const float p11 = kf->P[1][1] + correction->P[1][1];
+    kf->P[0][0] = MAX(p00, 0.01f * kf->P[0][0]);
+    kf->P[1][1] = MAX(p11, 0.01f * kf->P[1][1]);
+    const float maxP01 = sqrtf(kf->P[0][0] * kf->P[1][1]);
+    kf->P[0][1] = constrainf(kf->P[0][1] + correction->P[0][1], -maxP01, maxP01);
+    kf->P[1][0] = constrainf(kf->P[1][0] + correction->P[1][0], -maxP01, maxP01);
+}
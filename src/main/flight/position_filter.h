@@ -31,11 +31,22 @@ typedef struct positionKalman_s {
     float Q_accel;   // process noise: accelerometer variance (cm/s^2)^2
 } positionKalman_t;
 
+// State and covariance change caused by fusing a measurement into a past copy of the filter.
+// Carried forward with the state transition so it can be applied to the present filter.
+typedef struct positionKalmanCorrection_s {
+    float x[2];
+    float P[2][2];
+} positionKalmanCorrection_t;
+
 void kalmanInit(positionKalman_t *kf, float initialPos, float initialVel, float initialPosVar, float initialVelVar, float qAccel);
 void kalmanPredict(positionKalman_t *kf, float dt, float accel);
 void kalmanUpdatePosition(positionKalman_t *kf, float measuredPos, float R);
 void kalmanUpdateVelocity(positionKalman_t *kf, float measuredVel, float R);
 
+void kalmanCorrectionInit(positionKalmanCorrection_t *correction, const positionKalman_t *before, const positionKalman_t *after);
+void kalmanCorrectionPredict(positionKalmanCorrection_t *correction, float dt);
+void kalmanApplyCorrection(positionKalman_t *kf, const positionKalmanCorrection_t *correction);
+
 static inline float kalmanGetPosition(const positionKalman_t *kf) { return kf->x[0]; }
 static inline float kalmanGetVelocity(const positionKalman_t *kf) { return kf->x[1]; }
 static inline float kalmanGetPositionVariance(const positionKalman_t *kf) { return kf->P[0][0]; }
@@ -75,6 +75,8 @@ void positionNavSetTargetEf(
     cmd.acceptanceRadiusM = acceptanceRadiusM;
     cmd.completionSpeedMps = completionSpeedMps;
     cmd.altitudeArrivalRequired = true;
+    cmd.pathVelocityValid = false;
+    vector3Zero(&cmd.pathVelEfMps);
 
     cmd.callback = callback;
     cmd.callbackUserData = userData;
@@ -93,11 +95,25 @@ void positionNavMoveTargetEf(const vector3_t *targetPosEfM)
     cmd.targetPosEfM = *targetPosEfM;
 }
 
+void positionNavSetPathVelocityEf(const vector3_t *velEfMps)
+{
+    if (!cmd.active) {
+        return;
+    }
+    cmd.pathVelocityValid = (velEfMps != NULL);
+    if (velEfMps != NULL) {
+        cmd.pathVelEfMps = *velEfMps;
+    } else {
+        vector3Zero(&cmd.pathVelEfMps);
+    }
+}
+
 void positionNavClearTarget(void)
 {
     cmd.active = false;
     cmd.completed = false;
     cmd.completionSignalled = false;
+    cmd.pathVelocityValid = false;
     vector3Zero(&currentTargetVelCmS);
     vector3Zero(&previousTargetVelMps);
     withinAcceptanceRadius = false;
@@ -172,6 +188,16 @@ void positionNavUpdate(float dt, const positionEstimate3d_t *est)
     vector3_t targetVelMps;
     vector3Scale(&targetVelMps, &dirEf, desiredSpeedMps);
 
+    if (cmd.pathVelocityValid) {
+        // The path already carries the speed profile; only the vertical axis
+        // still closes on the target altitude.
+        targetVelMps.v[ENU_E] = cmd.pathVelEfMps.v[ENU_E];
+        targetVelMps.v[ENU_N] = cmd.pathVelEfMps.v[ENU_N];
+        targetVelMps.v[ENU_U] = cmd.includeAltitude
+            ? constrainf(POS_TO_VEL_KP * errorEfM.v[ENU_U], -cmd.cruiseSpeedMps, cmd.cruiseSpeedMps)
+            : 0.0f;
+    }
+
     if (cmd.maxAccelMps2 > 0.0f && dt > 0.0f) {
         vector3_t delta;
         vector3Sub(&delta, &targetVelMps, &previousTargetVelMps);
@@ -45,6 +45,9 @@ typedef struct positionNavCommand_s {
     bool autoClearOnReach;
     bool altitudeArrivalRequired;   // when false, arrival gates on the horizontal radius only
 
+    bool pathVelocityValid;         // the target is time-parametrised along a planned path
+    vector3_t pathVelEfMps;         // path velocity at the target, m/s ENU (ENU_U unused)
+
     positionNavReachedCallbackFn callback;
     void *callbackUserData;
 } positionNavCommand_t;
@@ -69,6 +72,13 @@ void positionNavSetTargetEf(
 // pattern carrots). No-op when there is no active command.
 void positionNavMoveTargetEf(const vector3_t *targetPosEfM);
 
+// Time-parametrised targets: the caller moves the target along a planned path
+// every cycle and supplies the path velocity at that point. While set, the
+// horizontal target velocity is the path velocity (the feedforward) instead of
+// the distance-derived approach speed; the position anchor corrects tracking
+// error. A new target clears it, as does passing NULL.
+void positionNavSetPathVelocityEf(const vector3_t *velEfMps);
+
 void positionNavClearTarget(void);
 
 bool positionNavHasActiveTarget(void);
@@ -30,10 +30,13 @@
 #include "common/maths.h"
 
 #include "drivers/dshot.h"
+#include "drivers/motor.h"
 
 #include "flight/mixer.h"
 #include "flight/pid.h"
 
+#include "io/dronecan/dronecan_esc.h"
+
 #include "pg/motor.h"
 
 #include "scheduler/scheduler.h"
@@ -55,6 +58,9 @@ typedef struct rpmFilter_s {
 
     float dt;
 
+    // motor speed source
+    float (*motorFrequencyHz)(uint8_t motorIndex);
+
     // state
     rpmNotch_t notch[MAX_SUPPORTED_MOTORS][RPM_FILTER_HARMONICS_MAX];
     int notchUpdatesPerIteration;
@@ -71,8 +77,14 @@ void rpmFilterInit(const rpmFilterConfig_t *config, const timeUs_t looptimeUs)
     rpmFilter.harmonicIndex = 0;
     rpmFilter.numHarmonics = 0; // disable RPM Filtering
 
-    // if bidirectional DShot is not available
-    if (!useDshotTelemetry) {
+    // motor speed from bidirectional DShot, or from DroneCAN ESCs' status
+    if (useDshotTelemetry) {
+        rpmFilter.motorFrequencyHz = getMotorFrequencyHz;
+#if ENABLE_DRONECAN_ESC && defined(USE_ESC_SENSOR)
+    } else if (isMotorProtocolDronecan()) {
+        rpmFilter.motorFrequencyHz = dronecanEscGetMotorFrequencyHz;
+#endif
+    } else {
         return;
     }
 
@@ -106,7 +118,7 @@ void rpmFilterInit(const rpmFilterConfig_t *config, const timeUs_t looptimeUs)
 
 static inline void rpmFilterUpdate(void)
 {
-    if (!useDshotTelemetry || !rpmFilter.numHarmonics) {
+    if (!rpmFilter.numHarmonics) {
         return;
     }
 
@@ -118,7 +130,7 @@ static inline void rpmFilterUpdate(void)
 
         // Only bother updating notches which have an effect on filtered output
         if (rpmFilter.weights[rpmFilter.harmonicIndex] > 0.0f) {
-            const float frequencyHz = constrainf((rpmFilter.harmonicIndex + 1) * getMotorFrequencyHz(rpmFilter.motorIndex), rpmFilter.minHz, rpmFilter.maxHz);
+            const float frequencyHz = constrainf((rpmFilter.harmonicIndex + 1) * rpmFilter.motorFrequencyHz(rpmFilter.motorIndex), rpmFilter.minHz, rpmFilter.maxHz);
             const float marginHz = frequencyHz - rpmFilter.minHz;
             float weight = 1.0f;
 
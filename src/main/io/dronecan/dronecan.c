@@ -41,6 +41,7 @@
 
 #include "io/dronecan/dronecan.h"
 #include "io/dronecan/dronecan_nodes.h"
+#include "io/dronecan/dronecan_route.h"
 
 #include "pg/dronecan.h"
 
@@ -81,12 +82,21 @@ static uint8_t dronecanPool[DRONECAN_POOL_SIZE];
 // is not re-entrant against concurrent canardBroadcast/Respond calls made
 // from task context, so we can't call canardHandleRxFrame directly in the
 // ISR. Instead the ISR pushes the raw frame onto a lock-free SPSC ring and
-// the task drains it. Size is a power of two so the index can be masked.
+// the task drains it. Size is a power of two so the index can be masked, at
+// most 256 for the 8-bit indices; a target with a busy bus can raise it.
+// With the controller filters only subscribed traffic lands here, so the
+// ring covers the bursts between task runs: a GNSS Fix2 is 6 frames and an
+// octo's esc.Status replies arrive back to back.
 //-----------------------------------------------------------------------------
-#define DRONECAN_RX_RING_SIZE   32U
+#ifndef DRONECAN_RX_RING_SIZE
+#define DRONECAN_RX_RING_SIZE   64U
+#endif
 #define DRONECAN_RX_RING_MASK   (DRONECAN_RX_RING_SIZE - 1U)
 
+STATIC_ASSERT((DRONECAN_RX_RING_SIZE & DRONECAN_RX_RING_MASK) == 0 && DRONECAN_RX_RING_SIZE <= 256, dronecan_rx_ring_size);
+
 typedef struct dronecanRxRingEntry_s {
+    timeUs_t timestampUs;               // arrival, taken in the ISR
     uint32_t id;
     uint8_t  data[8];
     uint8_t  length;
@@ -96,6 +106,8 @@ typedef struct dronecanRxRingEntry_s {
 static dronecanRxRingEntry_t dronecanRxRing[DRONECAN_RX_RING_SIZE];
 static volatile uint8_t dronecanRxHead;     // written by ISR
 static volatile uint8_t dronecanRxTail;     // written by task
+static volatile uint32_t dronecanRxRingOverflows;   // frames dropped, ring full (ISR)
+static volatile uint8_t dronecanRxRingPeak;         // most frames waiting at once (ISR)
 
 //-----------------------------------------------------------------------------
 // Singleton state
@@ -104,8 +116,17 @@ static CanardInstance dronecanInstance;
 static bool dronecanInitialised;
 static canDevice_e dronecanDevice = CANINVALID;
 
+// Subscriber i is route i of the table, which finds the subscribers for a
+// transfer without scanning them all
 static dronecanSubscriber_t dronecanSubscribers[DRONECAN_MAX_SUBSCRIBERS];
-static uint8_t dronecanSubscriberCount;
+static dronecanRouteTable_t dronecanRoutes;
+static uint8_t dronecanFilterCount;
+
+STATIC_ASSERT(DRONECAN_MAX_SUBSCRIBERS <= DRONECAN_ROUTE_MAX, dronecan_route_table_too_small);
+STATIC_ASSERT(DRONECAN_ROUTE_FILTERS_MAX <= CAN_FILTER_LIST_MAX, dronecan_filter_list_too_long);
+STATIC_ASSERT(DRONECAN_TRANSFER_RESPONSE == CanardTransferTypeResponse
+    && DRONECAN_TRANSFER_REQUEST == CanardTransferTypeRequest
+    && DRONECAN_TRANSFER_BROADCAST == CanardTransferTypeBroadcast, dronecan_transfer_types);
 
 // 1 Hz boundary tracker. Keeping a separate counter (rather than doing
 // modulo arithmetic on currentTimeUs) lets us emit NodeStatus with exactly
@@ -126,31 +147,26 @@ static bool dronecanShouldAcceptTransfer(const CanardInstance *ins,
     UNUSED(ins);
     UNUSED(source_node_id);
 
-    for (uint8_t i = 0; i < dronecanSubscriberCount; i++) {
-        const dronecanSubscriber_t *sub = &dronecanSubscribers[i];
-        if (sub->dataTypeId == data_type_id
-                && sub->transferType == (uint8_t)transfer_type) {
-            *out_data_type_signature = sub->signature;
-            return true;
-        }
+    // Runs for the first frame of every transfer
+    const int index = dronecanRouteTableFind(&dronecanRoutes, data_type_id, (uint8_t)transfer_type);
+    if (index < 0) {
+        return false;
     }
-
-    return false;
+    *out_data_type_signature = dronecanSubscribers[index].signature;
+    return true;
 }
 
 static void dronecanOnTransferReception(CanardInstance *ins,
                                         CanardRxTransfer *transfer)
 {
-    for (uint8_t i = 0; i < dronecanSubscriberCount; i++) {
-        const dronecanSubscriber_t *sub = &dronecanSubscribers[i];
-        if (sub->dataTypeId == transfer->data_type_id
-                && sub->transferType == transfer->transfer_type) {
-            if (sub->handler) {
-                // Keep scanning after a match — independent modules may
-                // subscribe to the same data type (node tracking and DNA
-                // both consume NodeStatus).
-                sub->handler(ins, transfer);
-            }
+    // Walk every route for the transfer — independent modules may subscribe
+    // to the same data type (node tracking and DNA both consume NodeStatus).
+    for (int index = dronecanRouteTableFind(&dronecanRoutes, transfer->data_type_id, transfer->transfer_type);
+         index >= 0;
+         index = dronecanRouteTableNext(&dronecanRoutes, index)) {
+        const dronecanSubscriber_t *sub = &dronecanSubscribers[index];
+        if (sub->handler) {
+            sub->handler(ins, transfer);
         }
     }
 }
@@ -164,15 +180,23 @@ static void dronecanCanRxAdapter(uint32_t identifier, bool isExtended,
 {
     uint8_t head = dronecanRxHead;
     uint8_t next = (head + 1U) & DRONECAN_RX_RING_MASK;
+    const uint8_t tail = dronecanRxTail;
 
     // Drop frames when the ring is full. The task is the only consumer; if
     // it can't keep up, the per-transfer timeouts inside libcanard will let
     // the sender retry on the next period rather than jamming the node.
-    if (next == dronecanRxTail) {
+    if (next == tail) {
+        dronecanRxRingOverflows++;
         return;
     }
 
+    const uint8_t waiting = (next - tail) & DRONECAN_RX_RING_MASK;
+    if (waiting > dronecanRxRingPeak) {
+        dronecanRxRingPeak = waiting;
+    }
+
     dronecanRxRingEntry_t *slot = &dronecanRxRing[head];
+    slot->timestampUs = microsISR();
     slot->id = identifier;
     slot->isExtended = isExtended;
     slot->length = (length > 8U) ? 8U : length;
@@ -189,7 +213,7 @@ static void dronecanCanRxAdapter(uint32_t identifier, bool isExtended,
     dronecanRxHead = next;
 }
 
-static void dronecanDrainRxRing(timeUs_t currentTimeUs)
+static void dronecanDrainRxRing(void)
 {
     while (dronecanRxTail != dronecanRxHead) {
         // Pair the ISR-side fence on head with a consumer-side fence so
@@ -207,7 +231,9 @@ static void dronecanDrainRxRing(timeUs_t currentTimeUs)
         // timeout (2s) / stale cleanup. Zero-extending a uint32 micros() is
         // accurate inside the 71-minute wraparound window; the task runs at
         // 50 Hz so every active transfer will be serviced well inside that.
-        canardHandleRxFrame(&dronecanInstance, &frame, (uint64_t)currentTimeUs);
+        // The arrival time rather than the drain time, so a transfer's
+        // timestamp_usec says when its first frame was on the bus.
+        canardHandleRxFrame(&dronecanInstance, &frame, (uint64_t)slot->timestampUs);
 
         dronecanRxTail = (dronecanRxTail + 1U) & DRONECAN_RX_RING_MASK;
     }
@@ -237,6 +263,24 @@ static void dronecanDrainTxQueue(void)
     }
 }
 
+//-----------------------------------------------------------------------------
+// Controller acceptance filters
+//
+// Derived from the route table, so the controller drops traffic nobody
+// subscribed to (other nodes' services, unused message types) before it
+// raises an interrupt. The driver merges the list down if it has fewer
+// filter slots, which only lets more through.
+//-----------------------------------------------------------------------------
+
+static void dronecanInstallFilters(void)
+{
+    canFilter_t filters[DRONECAN_ROUTE_FILTERS_MAX];
+    const uint8_t count = dronecanRouteTableFilters(&dronecanRoutes, canardGetLocalNodeID(&dronecanInstance), filters);
+    if (canSetFilters(dronecanDevice, filters, count)) {
+        dronecanFilterCount = count;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Public API
 //-----------------------------------------------------------------------------
@@ -266,7 +310,9 @@ void dronecanInit(void)
 
     dronecanRxHead = 0;
     dronecanRxTail = 0;
-    dronecanSubscriberCount = 0;
+    dronecanRxRingOverflows = 0;
+    dronecanRxRingPeak = 0;
+    dronecanRouteTableInit(&dronecanRoutes);
 
     canardInit(&dronecanInstance, dronecanPool, sizeof(dronecanPool),
                dronecanOnTransferReception, dronecanShouldAcceptTransfer,
@@ -303,12 +349,13 @@ void dronecanInit(void)
     dronecanDnaInit();
 #endif
 
+    dronecanInstallFilters();
     canRegisterRxCallback(dronecanDevice, dronecanCanRxAdapter);
 
 #if ENABLE_DRONECAN_ESC
     // RawCommand is emitted from the PID loop (see dronecan_esc.c) and every
     // emission drains the TX queue, so the task only services RX telemetry and
-    // housekeeping. 100 Hz keeps the 32-slot RX ring ahead of worst-case
+    // housekeeping. 100 Hz keeps the RX ring ahead of worst-case
     // esc.Status/GNSS bursts; tracking esc_rate_hz here would just duplicate
     // the PID-loop flush at up to 500 Hz.
     if (isMotorProtocolDronecan()) {
@@ -332,7 +379,7 @@ void dronecanUpdate(timeUs_t currentTimeUs)
         return;
     }
 
-    dronecanDrainRxRing(currentTimeUs);
+    dronecanDrainRxRing();
 
 #if ENABLE_DRONECAN_ESC
     // Broadcast esc.RawCommand (when commanding ESCs) and age stale telemetry.
@@ -352,7 +399,9 @@ void dronecanUpdate(timeUs_t currentTimeUs)
         dronecanLastSecondUs = currentTimeUs;
         dronecanNodeUpdate(currentTimeUs);
         dronecanNodesUpdate(currentTimeUs);
-        canardCleanupStaleTransfers(&dronecanInstance, (uint64_t)currentTimeUs);
+        // Not currentTimeUs: transfers carry ISR arrival stamps, which may be
+        // later than the tick start and must not look like they are from the future
+        canardCleanupStaleTransfers(&dronecanInstance, (uint64_t)micros());
     }
 
     dronecanDrainTxQueue();
@@ -360,13 +409,28 @@ void dronecanUpdate(timeUs_t currentTimeUs)
 
 bool dronecanRegisterSubscriber(const dronecanSubscriber_t *subscriber)
 {
-    if (dronecanSubscriberCount >= DRONECAN_MAX_SUBSCRIBERS) {
+    const uint8_t index = dronecanRoutes.count;
+    if (index >= DRONECAN_MAX_SUBSCRIBERS
+            || !dronecanRouteTableAdd(&dronecanRoutes, subscriber->dataTypeId, subscriber->transferType)) {
         return false;
     }
-    dronecanSubscribers[dronecanSubscriberCount++] = *subscriber;
+    dronecanSubscribers[index] = *subscriber;
+
+    // Late subscribers widen the filters already on the controller
+    if (dronecanInitialised) {
+        dronecanInstallFilters();
+    }
     return true;
 }
 
+void dronecanGetRxStats(dronecanRxStats_t *stats)
+{
+    stats->ringOverflows = dronecanRxRingOverflows;
+    stats->ringPeak = dronecanRxRingPeak;
+    stats->ringSize = DRONECAN_RX_RING_SIZE - 1U;
+    stats->filters = dronecanFilterCount;
+}
+
 CanardInstance *dronecanGetInstance(void)
 {
     return &dronecanInstance;
@@ -380,4 +444,22 @@ void dronecanFlushTx(void)
     dronecanDrainTxQueue();
 }
 
+bool dronecanTransmitFrames(const canFrame_t *frames, uint8_t count)
+{
+    if (!dronecanInitialised) {
+        return false;
+    }
+    // Never overtake a transfer libcanard still holds
+    dronecanDrainTxQueue();
+    if (canardPeekTxQueue(&dronecanInstance) != NULL) {
+        return false;
+    }
+    return canTransmitFrames(dronecanDevice, frames, count);
+}
+
+uint8_t dronecanGetLocalNodeId(void)
+{
+    return canardGetLocalNodeID(&dronecanInstance);
+}
+
 #endif // ENABLE_DRONECAN
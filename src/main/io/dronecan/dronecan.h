@@ -32,6 +32,8 @@
 
 #include "common/time.h"
 
+#include "drivers/can/can.h"
+
 // Maximum number of subscribers a single stack instance accepts. A full
 // build registers 11 (GetNodeInfo server + client, NodeStatus x2, GPS x2,
 // mag x2, airspeed, ESC status, DNA allocation). Bump if a target needs
@@ -48,6 +50,13 @@ typedef struct dronecanSubscriber_s {
                                         // transfer has been reassembled
 } dronecanSubscriber_t;
 
+typedef struct dronecanRxStats_s {
+    uint32_t ringOverflows;             // frames dropped, ISR ring full
+    uint16_t ringPeak;                  // most frames waiting for the task at once
+    uint16_t ringSize;                  // usable ring slots
+    uint8_t  filters;                   // acceptance filters asked of the controller
+} dronecanRxStats_t;
+
 // Start the stack on the CAN device selected by dronecanConfig(). No-op if
 // the PG flag is clear, the node ID is 0, or the underlying CAN device failed
 // to initialise. Idempotent — safe to call from fc/init.c unconditionally.
@@ -64,10 +73,14 @@ bool dronecanIsInitialised(void);
 void dronecanUpdate(timeUs_t currentTimeUs);
 
 // Register an RX handler for a specific DSDL data type. Returns false if the
-// subscriber table is full. Handlers fire from task context (never from the
+// subscriber table is full. The controller's acceptance filters follow the
+// registered subscribers, so nothing else reaches the stack. Handlers fire from task context (never from the
 // CAN ISR) so they can safely touch PG state and cross-subsystem globals.
 bool dronecanRegisterSubscriber(const dronecanSubscriber_t *subscriber);
 
+// Receive-path counters for the CLI status.
+void dronecanGetRxStats(dronecanRxStats_t *stats);
+
 // Handle to the singleton Canard instance, so node-side publishers and
 // responders can call canardBroadcastObj / canardRequestOrRespondObj without
 // each one having to re-discover the pool.
@@ -80,4 +93,13 @@ CanardInstance *dronecanGetInstance(void);
 // was momentarily full. No-op until the stack is initialised.
 void dronecanFlushTx(void);
 
+// Hand frames serialised outside libcanard (see dronecan_frames.h) straight
+// to the CAN driver, all or nothing. Returns false, leaving the caller to go
+// through libcanard instead, if the stack is down, libcanard still holds
+// frames the new ones would overtake, or the driver can't take them all.
+bool dronecanTransmitFrames(const canFrame_t *frames, uint8_t count);
+
+// Node ID the stack transmits as.
+uint8_t dronecanGetLocalNodeId(void);
+
 #endif // ENABLE_DRONECAN
@@ -30,6 +30,7 @@
 
 #include "canard.h"
 
+#include "common/filter.h"
 #include "common/maths.h"
 #include "common/time.h"
 #include "common/utils.h"
@@ -41,6 +42,7 @@
 #include "drivers/time.h"
 
 #include "flight/mixer.h"
+#include "flight/rpm_filter.h"
 
 #include "pg/dronecan.h"
 #include "pg/motor.h"
@@ -52,6 +54,7 @@
 
 #include "io/dronecan/dronecan.h"
 #include "io/dronecan/dronecan_esc.h"
+#include "io/dronecan/dronecan_frames.h"
 #include "io/dronecan/dronecan_msg.h"
 #include "io/dronecan/dronecan_nodes.h"
 
@@ -65,6 +68,8 @@
 // which touches driver-level rings only). We therefore emit RawCommand straight
 // from updateComplete(), rate-gated to esc_rate_hz, for low and jitter-free
 // command latency that does not depend on the LOW-priority task being serviced.
+// Normally the transfer does not touch libcanard at all (see
+// transmitRawCommandDirect()); libcanard's queue is only the fallback.
 //-----------------------------------------------------------------------------
 
 // Throttle staging, written per-motor by write() and read by the broadcast in
@@ -77,6 +82,30 @@ static uint8_t escRawCommandTransferId;
 static uint32_t escBroadcastPeriodUs;
 static timeUs_t escLastBroadcastUs;
 
+// RawCommand payload at the most motors we drive, and the frames it takes
+#define ESC_RAWCOMMAND_PAYLOAD_MAX  ((MAX_SUPPORTED_MOTORS * UAVCAN_ESC_RAWCOMMAND_BITS + 7U) / 8U)
+#define ESC_RAWCOMMAND_FRAMES_MAX   DRONECAN_TRANSFER_FRAMES(ESC_RAWCOMMAND_PAYLOAD_MAX)
+
+static dronecanEscStats_t escStats;
+
+#if defined(USE_ESC_SENSOR)
+// Command-to-Status latency: per ESC, when the oldest RawCommand it has not
+// yet answered with a Status went out (0 once answered)
+static timeUs_t escCommandPendingUs[MAX_SUPPORTED_MOTORS];
+
+static void noteRawCommandSent(uint8_t motorCount)
+{
+    const timeUs_t now = micros();
+    for (uint8_t i = 0; i < motorCount; i++) {
+        if (escCommandPendingUs[i] == 0) {
+            escCommandPendingUs[i] = now;
+        }
+    }
+}
+
+static void updateMotorFrequencies(void);
+#endif
+
 void dronecanEscWrite(uint8_t motorIndex, float value)
 {
     if (motorIndex >= MAX_SUPPORTED_MOTORS) {
@@ -87,6 +116,25 @@ void dronecanEscWrite(uint8_t motorIndex, float value)
     escStaging[motorIndex] = (int16_t)constrainf(value, 0, UAVCAN_ESC_RAWCOMMAND_MAX);
 }
 
+// RawCommand goes out at up to 500 Hz, so it skips libcanard's TX pool: the
+// frames are serialised on the stack and handed to the driver as one run,
+// sharing libcanard's transfer ID sequence. Returns false when the driver
+// can't take them right now, leaving the transfer to libcanard.
+static bool transmitRawCommandDirect(const uint8_t *payload, uint16_t payloadLen)
+{
+    canFrame_t frames[ESC_RAWCOMMAND_FRAMES_MAX];
+    const uint32_t identifier = dronecanMessageId(CANARD_TRANSFER_PRIORITY_HIGH, UAVCAN_ESC_RAWCOMMAND_ID,
+                                                  dronecanGetLocalNodeId());
+    const uint8_t count = dronecanEncodeBroadcast(frames, ARRAYLEN(frames), identifier,
+                                                  UAVCAN_ESC_RAWCOMMAND_SIGNATURE, escRawCommandTransferId,
+                                                  payload, payloadLen);
+    if (count == 0 || !dronecanTransmitFrames(frames, count)) {
+        return false;
+    }
+    escRawCommandTransferId = (escRawCommandTransferId + 1) & DRONECAN_TRANSFER_ID_MASK;
+    return true;
+}
+
 static void broadcastRawCommand(void)
 {
     const uint8_t motorCount = getMotorCount();
@@ -96,28 +144,44 @@ static void broadcastRawCommand(void)
 
     // Pack motorCount int14 values, MSB-first per field. TAO: no length prefix.
     // 8 motors * 14 bits = 112 bits = 14 bytes worst case.
-    uint8_t payload[(MAX_SUPPORTED_MOTORS * UAVCAN_ESC_RAWCOMMAND_BITS + 7U) / 8U];
+    uint8_t payload[ESC_RAWCOMMAND_PAYLOAD_MAX];
     memset(payload, 0, sizeof(payload));
 
     uint32_t bitOffset = 0;
     for (uint8_t i = 0; i < motorCount; i++) {
         const int16_t v = constrain(escStaging[i], 0, UAVCAN_ESC_RAWCOMMAND_MAX);
-        canardEncodeScalar(payload, bitOffset, UAVCAN_ESC_RAWCOMMAND_BITS, &v);
+        dronecanPackScalar(payload, bitOffset, UAVCAN_ESC_RAWCOMMAND_BITS, (uint64_t)v);
         bitOffset += UAVCAN_ESC_RAWCOMMAND_BITS;
     }
     const uint16_t payloadLen = (uint16_t)((bitOffset + 7U) / 8U);
 
-    CanardTxTransfer tx;
-    canardInitTxTransfer(&tx);
-    tx.transfer_type       = CanardTransferTypeBroadcast;
-    tx.data_type_signature = UAVCAN_ESC_RAWCOMMAND_SIGNATURE;
-    tx.data_type_id        = UAVCAN_ESC_RAWCOMMAND_ID;
-    tx.inout_transfer_id   = &escRawCommandTransferId;
-    tx.priority            = CANARD_TRANSFER_PRIORITY_HIGH;
-    tx.payload             = payload;
-    tx.payload_len         = payloadLen;
-
-    canardBroadcastObj(dronecanGetInstance(), &tx);
+    if (transmitRawCommandDirect(payload, payloadLen)) {
+        escStats.directTransfers++;
+    } else {
+        CanardTxTransfer tx;
+        canardInitTxTransfer(&tx);
+        tx.transfer_type       = CanardTransferTypeBroadcast;
+        tx.data_type_signature = UAVCAN_ESC_RAWCOMMAND_SIGNATURE;
+        tx.data_type_id        = UAVCAN_ESC_RAWCOMMAND_ID;
+        tx.inout_transfer_id   = &escRawCommandTransferId;
+        tx.priority            = CANARD_TRANSFER_PRIORITY_HIGH;
+        tx.payload             = payload;
+        tx.payload_len         = payloadLen;
+
+        if (canardBroadcastObj(dronecanGetInstance(), &tx) < 0) {
+            escStats.droppedTransfers++;
+            return;
+        }
+        escStats.queuedTransfers++;
+        // Flush straight to the driver so the frames ride out on this PID
+        // iteration if the bus frees up; the driver's SW ring + TC interrupt
+        // absorb the rest.
+        dronecanFlushTx();
+    }
+
+#if defined(USE_ESC_SENSOR)
+    noteRawCommandSent(motorCount);
+#endif
 }
 
 // Encode the current throttles into a RawCommand transfer and push it to the
@@ -128,9 +192,6 @@ static void emitRawCommand(void)
         return;
     }
     broadcastRawCommand();
-    // Flush straight to the driver so the frame rides out on this PID iteration
-    // if the bus is free; the driver's SW ring + TC interrupt absorb the rest.
-    dronecanFlushTx();
 }
 
 void dronecanEscUpdateComplete(void)
@@ -141,6 +202,10 @@ void dronecanEscUpdateComplete(void)
         return;
     }
 
+#if defined(USE_ESC_SENSOR)
+    updateMotorFrequencies();
+#endif
+
     // Rate-gate to esc_rate_hz. We run every PID loop (kHz) but the bus can
     // only carry frames at the configured rate; emit the instant a period is
     // due rather than waiting on the dronecan task tick.
@@ -170,6 +235,30 @@ static timeUs_t escStatusLastUs[MAX_SUPPORTED_MOTORS];
 #define ESC_STATUS_AGE_INTERVAL_US  100000
 #define KELVIN_TO_CELSIUS       273.15f
 
+// Motor speed for the RPM filter. Status arrives at the ESCs' own rate and in
+// task-sized batches; the PID loop smooths the steps with the same low-pass
+// bidirectional DShot uses. A silent ESC reads 0 Hz, which fades its notches out.
+static float escErpmToHz;
+static float escStatusFrequencyHz[MAX_SUPPORTED_MOTORS];
+FAST_DATA_ZERO_INIT static pt1Filter_t escFrequencyLpf[MAX_SUPPORTED_MOTORS];
+FAST_DATA_ZERO_INIT static float escMotorFrequencyHz[MAX_SUPPORTED_MOTORS];
+FAST_DATA_ZERO_INIT static bool escFrequencyLpfReady;
+
+static void noteStatusLatency(uint8_t escIndex, timeUs_t arrivalUs)
+{
+    const timeUs_t sentUs = escCommandPendingUs[escIndex];
+    if (sentUs == 0 || cmpTimeUs(arrivalUs, sentUs) < 0) {
+        return;
+    }
+    escCommandPendingUs[escIndex] = 0;
+
+    const uint32_t latencyUs = cmpTimeUs(arrivalUs, sentUs);
+    escStats.latencyLastUs = latencyUs;
+    escStats.latencyAvgUs = escStats.latencySamples ? (escStats.latencyAvgUs * 15 + latencyUs) / 16 : latencyUs;
+    escStats.latencyMaxUs = MAX(escStats.latencyMaxUs, latencyUs);
+    escStats.latencySamples++;
+}
+
 static void handleEscStatus(CanardInstance *ins, CanardRxTransfer *t)
 {
     UNUSED(ins);
@@ -214,6 +303,20 @@ static void handleEscStatus(CanardInstance *ins, CanardRxTransfer *t)
 
     escSensorSetExternal(escIndex, &data);
     escStatusLastUs[escIndex] = micros();
+
+    escStatusFrequencyHz[escIndex] = ABS(rpm) * escErpmToHz;
+    // The transfer is stamped with its first frame's arrival in the CAN ISR
+    noteStatusLatency(escIndex, (timeUs_t)t->timestamp_usec);
+}
+
+static void updateMotorFrequencies(void)
+{
+    if (!escFrequencyLpfReady) {
+        return;
+    }
+    for (uint8_t i = 0; i < getMotorCount(); i++) {
+        escMotorFrequencyHz[i] = pt1FilterApply(&escFrequencyLpf[i], escStatusFrequencyHz[i]);
+    }
 }
 
 #endif // USE_ESC_SENSOR
@@ -226,6 +329,7 @@ void dronecanEscInit(void)
 {
     memset(escStaging, 0, sizeof(escStaging));
     escRawCommandTransferId = 0;
+    memset(&escStats, 0, sizeof(escStats));
 
     // Derive the PID-loop emission period from the configured rate. The PG
     // value is already range-checked elsewhere; constrain again defensively.
@@ -236,7 +340,11 @@ void dronecanEscInit(void)
 #if defined(USE_ESC_SENSOR)
     for (int i = 0; i < MAX_SUPPORTED_MOTORS; i++) {
         escStatusLastUs[i] = 0;
+        escCommandPendingUs[i] = 0;
+        escStatusFrequencyHz[i] = 0;
     }
+    // Status.rpm is electrical RPM, as for escSensorData below
+    escErpmToHz = 1.0f / SECONDS_PER_MINUTE / (motorConfig()->motorPoleCount / 2.0f);
 
     escSensorExternalInit();
 
@@ -263,6 +371,9 @@ void dronecanEscUpdate(timeUs_t currentTimeUs)
                 && cmpTimeUs(currentTimeUs, escStatusLastUs[i]) >= ESC_STATUS_AGE_INTERVAL_US) {
             escSensorExternalAge(i);
             escStatusLastUs[i] = currentTimeUs;
+            escStatusFrequencyHz[i] = 0;
+            // Measure from the next command, not one the ESC never answered
+            escCommandPendingUs[i] = 0;
         }
     }
 #else
@@ -270,6 +381,30 @@ void dronecanEscUpdate(timeUs_t currentTimeUs)
 #endif
 }
 
+#if defined(USE_ESC_SENSOR)
+void dronecanEscInitTelemetry(const timeUs_t looptimeUs)
+{
+#ifdef USE_RPM_FILTER
+    for (int i = 0; i < MAX_SUPPORTED_MOTORS; i++) {
+        pt1FilterInit(&escFrequencyLpf[i], pt1FilterGain(rpmFilterConfig()->rpm_filter_lpf_hz, looptimeUs * 1e-6f));
+    }
+    escFrequencyLpfReady = true;
+#else
+    UNUSED(looptimeUs);
+#endif
+}
+
+float dronecanEscGetMotorFrequencyHz(uint8_t motorIndex)
+{
+    return escMotorFrequencyHz[motorIndex];
+}
+#endif // USE_ESC_SENSOR
+
+void dronecanEscGetStats(dronecanEscStats_t *stats)
+{
+    *stats = escStats;
+}
+
 //-----------------------------------------------------------------------------
 // Motor driver (vtable) — bridges drivers/motor.c to the throttle buffer above.
 //
@@ -48,6 +48,28 @@ void dronecanEscUpdate(timeUs_t currentTimeUs);
 void dronecanEscWrite(uint8_t motorIndex, float value);
 void dronecanEscUpdateComplete(void);
 
+typedef struct dronecanEscStats_s {
+    uint32_t directTransfers;           // RawCommands handed to the driver directly
+    uint32_t queuedTransfers;           // RawCommands that went through libcanard instead
+    uint32_t droppedTransfers;          // RawCommands libcanard had no room for
+    uint32_t latencySamples;            // Status replies timed against a command
+    uint32_t latencyLastUs;             // RawCommand sent to the next Status arriving
+    uint32_t latencyAvgUs;
+    uint32_t latencyMaxUs;
+} dronecanEscStats_t;
+
+// RawCommand path and command-to-Status latency counters, for the CLI status.
+void dronecanEscGetStats(dronecanEscStats_t *stats);
+
+#if defined(USE_ESC_SENSOR)
+// Set up the motor frequency low-pass once the PID loop time is known.
+void dronecanEscInitTelemetry(const timeUs_t looptimeUs);
+
+// Motor speed in Hz from esc.Status, smoothed at PID rate: the RPM filter's
+// source when DRONECAN is the motor protocol. 0 for a silent ESC.
+float dronecanEscGetMotorFrequencyHz(uint8_t motorIndex);
+#endif
+
 // Motor-driver entry points (called from drivers/motor.c). Populate the motor
 // vtable and define the output endpoints for the DRONECAN protocol family.
 bool dronecanMotorDevInit(motorDevice_t *device, uint8_t motorCount);
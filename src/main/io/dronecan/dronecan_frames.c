@@ -0,0 +1,129 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#if ENABLE_DRONECAN
+
+#include "common/crc.h"
+
+#include "io/dronecan/dronecan_frames.h"
+
+#define DRONECAN_TAIL_START     0x80U
+#define DRONECAN_TAIL_END       0x40U
+#define DRONECAN_TAIL_TOGGLE    0x20U
+
+void dronecanPackScalar(uint8_t *buffer, uint32_t bitOffset, uint8_t bitLength, uint64_t value)
+{
+    // Little-endian bytes, with a trailing partial byte moved up to its top
+    // bits, then copied MSB first
+    uint8_t bytes[8];
+    for (unsigned i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = (uint8_t)(value >> (i * 8));
+    }
+    if (bitLength % 8) {
+        bytes[bitLength / 8] <<= 8 - bitLength % 8;
+    }
+
+    for (uint8_t i = 0; i < bitLength; i++) {
+        const uint32_t dst = bitOffset + i;
+        const uint8_t dstMask = 0x80U >> (dst % 8);
+        if (bytes[i / 8] & (0x80U >> (i % 8))) {
+            buffer[dst / 8] |= dstMask;
+        } else {
+            buffer[dst / 8] &= ~dstMask;
+        }
+    }
+}
+
+uint16_t dronecanTransferCrc(uint64_t signature, const uint8_t *payload, uint16_t length)
+{
+    uint8_t seed[8];
+    for (unsigned i = 0; i < sizeof(seed); i++) {
+        seed[i] = (uint8_t)(signature >> (i * 8));
+    }
+    const uint16_t crc = crc16_ccitt_update(0xFFFF, seed, sizeof(seed));
+    return crc16_ccitt_update(crc, payload, length);
+}
+
+uint32_t dronecanMessageId(uint8_t priority, uint16_t dataTypeId, uint8_t sourceNodeId)
+{
+    return ((uint32_t)(priority & 0x1F) << 24) | ((uint32_t)dataTypeId << 8) | (sourceNodeId & 0x7F);
+}
+
+uint8_t dronecanEncodeBroadcast(canFrame_t *frames, uint8_t maxFrames, uint32_t identifier,
+                                uint64_t signature, uint8_t transferId,
+                                const uint8_t *payload, uint16_t length)
+{
+    const uint16_t frameCount = DRONECAN_TRANSFER_FRAMES(length);
+    if (frameCount > maxFrames) {
+        return 0;
+    }
+
+    const uint8_t tid = transferId & DRONECAN_TRANSFER_ID_MASK;
+
+    if (frameCount == 1) {
+        canFrame_t *frame = &frames[0];
+        frame->id = identifier;
+        frame->isExtended = true;
+        memcpy(frame->data, payload, length);
+        frame->data[length] = DRONECAN_TAIL_START | DRONECAN_TAIL_END | tid;
+        frame->length = length + 1;
+        return 1;
+    }
+
+    const uint16_t crc = dronecanTransferCrc(signature, payload, length);
+    uint16_t offset = 0;
+    for (uint16_t i = 0; i < frameCount; i++) {
+        canFrame_t *frame = &frames[i];
+        frame->id = identifier;
+        frame->isExtended = true;
+
+        uint8_t n = 0;
+        if (i == 0) {
+            frame->data[n++] = crc & 0xFF;
+            frame->data[n++] = crc >> 8;
+        }
+        while (n < DRONECAN_FRAME_PAYLOAD_MAX && offset < length) {
+            frame->data[n++] = payload[offset++];
+        }
+
+        uint8_t tail = tid;
+        if (i == 0) {
+            tail |= DRONECAN_TAIL_START;
+        }
+        if (i == frameCount - 1) {
+            tail |= DRONECAN_TAIL_END;
+        }
+        if (i & 1) {
+            tail |= DRONECAN_TAIL_TOGGLE;
+        }
+        frame->data[n++] = tail;
+        frame->length = n;
+    }
+    return frameCount;
+}
+
+#endif // ENABLE_DRONECAN
@@ -0,0 +1,65 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "platform.h"
+
+#if ENABLE_DRONECAN
+
+#include <stdint.h>
+
+#include "drivers/can/can.h"
+
+// Transfer serialisation straight to CAN frames, for the few transfers sent
+// often enough that going through libcanard's TX pool costs more than the
+// transfer itself. Follows libcanard's wire layout exactly and is kept free
+// of canard.h so it can be tested on its own.
+
+// Payload bytes a frame carries next to its tail byte.
+#define DRONECAN_FRAME_PAYLOAD_MAX  (CAN_CLASSIC_MAX_DLC - 1U)
+
+// Transfer IDs count modulo 32.
+#define DRONECAN_TRANSFER_ID_MASK   0x1FU
+
+// Frames a transfer of `length` payload bytes occupies. Multi-frame
+// transfers lead with a two-byte transfer CRC.
+#define DRONECAN_TRANSFER_FRAMES(length) \
+    ((length) <= DRONECAN_FRAME_PAYLOAD_MAX ? 1U : ((length) + 2U + DRONECAN_FRAME_PAYLOAD_MAX - 1U) / DRONECAN_FRAME_PAYLOAD_MAX)
+
+// Write the low `bitLength` bits (1..64) of value at bitOffset, laid out as
+// canardEncodeScalar() does. Bits outside the field are left alone.
+void dronecanPackScalar(uint8_t *buffer, uint32_t bitOffset, uint8_t bitLength, uint64_t value);
+
+// CRC of a multi-frame transfer: CRC-16-CCITT-FALSE seeded with the data
+// type signature.
+uint16_t dronecanTransferCrc(uint64_t signature, const uint8_t *payload, uint16_t length);
+
+// 29-bit identifier of a message broadcast.
+uint32_t dronecanMessageId(uint8_t priority, uint16_t dataTypeId, uint8_t sourceNodeId);
+
+// Split a broadcast into frames. Returns the frame count, or 0 if it takes
+// more than maxFrames.
+uint8_t dronecanEncodeBroadcast(canFrame_t *frames, uint8_t maxFrames, uint32_t identifier,
+                                uint64_t signature, uint8_t transferId,
+                                const uint8_t *payload, uint16_t length);
+
+#endif // ENABLE_DRONECAN
@@ -0,0 +1,147 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform.h"
+
+#if ENABLE_DRONECAN
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "drivers/can/can.h"
+
+#include "io/dronecan/dronecan_route.h"
+
+// 29-bit DroneCAN frame identifier
+//  message:   priority [28:24], data type [23:8], 0 [7], source node [6:0]
+//  anonymous: as a message from source 0, with a discriminator in [23:10]
+//             and only the low two bits of the data type in [9:8]
+//  service:   priority [28:24], service type [23:16], request [15],
+//             destination node [14:8], 1 [7], source node [6:0]
+#define DRONECAN_ID_SERVICE             (1UL << 7)
+#define DRONECAN_ID_SOURCE_MASK         0x7FUL
+#define DRONECAN_ID_MESSAGE_TYPE_POS    8U
+#define DRONECAN_ID_MESSAGE_TYPE_MASK   (0xFFFFUL << DRONECAN_ID_MESSAGE_TYPE_POS)
+#define DRONECAN_ID_ANONYMOUS_TYPE_MASK (0x3UL << DRONECAN_ID_MESSAGE_TYPE_POS)
+#define DRONECAN_ID_SERVICE_TYPE_POS    16U
+#define DRONECAN_ID_SERVICE_TYPE_MASK   (0xFFUL << DRONECAN_ID_SERVICE_TYPE_POS)
+#define DRONECAN_ID_REQUEST             (1UL << 15)
+#define DRONECAN_ID_DESTINATION_POS     8U
+#define DRONECAN_ID_DESTINATION_MASK    (0x7FUL << DRONECAN_ID_DESTINATION_POS)
+
+static unsigned routeBucket(uint16_t dataTypeId, uint8_t transferType)
+{
+    const uint32_t key = (uint32_t)dataTypeId << 2 | transferType;
+    return (key * 2654435761u) >> (32 - DRONECAN_ROUTE_BUCKET_BITS);
+}
+
+static bool routeIs(const dronecanRoute_t *route, uint16_t dataTypeId, uint8_t transferType)
+{
+    return route->dataTypeId == dataTypeId && route->transferType == transferType;
+}
+
+void dronecanRouteTableInit(dronecanRouteTable_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+bool dronecanRouteTableAdd(dronecanRouteTable_t *table, uint16_t dataTypeId, uint8_t transferType)
+{
+    if (table->count >= DRONECAN_ROUTE_MAX) {
+        return false;
+    }
+
+    const uint8_t index = table->count++;
+    table->routes[index].dataTypeId = dataTypeId;
+    table->routes[index].transferType = transferType;
+    table->next[index] = 0;
+
+    uint8_t *link = &table->head[routeBucket(dataTypeId, transferType)];
+    while (*link) {
+        link = &table->next[*link - 1];
+    }
+    *link = index + 1;
+    return true;
+}
+
+static int routeFrom(const dronecanRouteTable_t *table, uint8_t link, uint16_t dataTypeId, uint8_t transferType)
+{
+    for (; link; link = table->next[link - 1]) {
+        if (routeIs(&table->routes[link - 1], dataTypeId, transferType)) {
+            return link - 1;
+        }
+    }
+    return -1;
+}
+
+int dronecanRouteTableFind(const dronecanRouteTable_t *table, uint16_t dataTypeId, uint8_t transferType)
+{
+    return routeFrom(table, table->head[routeBucket(dataTypeId, transferType)], dataTypeId, transferType);
+}
+
+int dronecanRouteTableNext(const dronecanRouteTable_t *table, int index)
+{
+    const dronecanRoute_t *route = &table->routes[index];
+    return routeFrom(table, table->next[index], route->dataTypeId, route->transferType);
+}
+
+uint8_t dronecanRouteTableFilters(const dronecanRouteTable_t *table, uint8_t localNodeId, canFilter_t *filters)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < table->count; i++) {
+        const dronecanRoute_t *route = &table->routes[i];
+
+        // Routes sharing a key need the same filters
+        if (dronecanRouteTableFind(table, route->dataTypeId, route->transferType) != i) {
+            continue;
+        }
+
+        if (route->transferType == DRONECAN_TRANSFER_BROADCAST) {
+            filters[count++] = (canFilter_t) {
+                .id = (uint32_t)route->dataTypeId << DRONECAN_ID_MESSAGE_TYPE_POS,
+                .mask = DRONECAN_ID_MESSAGE_TYPE_MASK | DRONECAN_ID_SERVICE,
+                .isExtended = true,
+            };
+            if (route->dataTypeId <= (DRONECAN_ID_ANONYMOUS_TYPE_MASK >> DRONECAN_ID_MESSAGE_TYPE_POS)) {
+                filters[count++] = (canFilter_t) {
+                    .id = (uint32_t)route->dataTypeId << DRONECAN_ID_MESSAGE_TYPE_POS,
+                    .mask = DRONECAN_ID_ANONYMOUS_TYPE_MASK | DRONECAN_ID_SERVICE | DRONECAN_ID_SOURCE_MASK,
+                    .isExtended = true,
+                };
+            }
+        } else {
+            const uint32_t request = route->transferType == DRONECAN_TRANSFER_REQUEST ? DRONECAN_ID_REQUEST : 0;
+            filters[count++] = (canFilter_t) {
+                .id = ((uint32_t)route->dataTypeId << DRONECAN_ID_SERVICE_TYPE_POS) | request
+                    | ((uint32_t)localNodeId << DRONECAN_ID_DESTINATION_POS) | DRONECAN_ID_SERVICE,
+                .mask = DRONECAN_ID_SERVICE_TYPE_MASK | DRONECAN_ID_REQUEST
+                      | DRONECAN_ID_DESTINATION_MASK | DRONECAN_ID_SERVICE,
+                .isExtended = true,
+            };
+        }
+    }
+
+    return count;
+}
+
+#endif // ENABLE_DRONECAN
@@ -0,0 +1,82 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "platform.h"
+
+#if ENABLE_DRONECAN
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "drivers/can/can.h"
+
+// RX routing: which transfers the stack subscribes to, looked up per
+// reassembled transfer and turned into controller acceptance filters. Kept
+// free of libcanard so it can be tested on its own.
+
+// libcanard's CanardTransferType values, repeated here so this module builds
+// without canard.h; dronecan.c asserts they agree.
+#define DRONECAN_TRANSFER_RESPONSE  0U
+#define DRONECAN_TRANSFER_REQUEST   1U
+#define DRONECAN_TRANSFER_BROADCAST 2U
+
+#define DRONECAN_ROUTE_MAX          16U     // routes one table holds
+#define DRONECAN_ROUTE_BUCKET_BITS  5U
+#define DRONECAN_ROUTE_BUCKETS      (1U << DRONECAN_ROUTE_BUCKET_BITS)
+
+// Two filters per route at most: a low message type also arrives anonymously
+#define DRONECAN_ROUTE_FILTERS_MAX  (DRONECAN_ROUTE_MAX * 2U)
+
+typedef struct dronecanRoute_s {
+    uint16_t dataTypeId;
+    uint8_t  transferType;                  // DRONECAN_TRANSFER_*
+} dronecanRoute_t;
+
+// Direct-mapped on (data type, transfer type). Routes sharing a key, or
+// only a bucket, are chained in the order they were added, so handlers for
+// one transfer still run in registration order.
+typedef struct dronecanRouteTable_s {
+    dronecanRoute_t routes[DRONECAN_ROUTE_MAX];
+    uint8_t next[DRONECAN_ROUTE_MAX];       // next route + 1 in the bucket, 0 ends
+    uint8_t head[DRONECAN_ROUTE_BUCKETS];   // first route + 1, 0 if empty
+    uint8_t count;
+} dronecanRouteTable_t;
+
+void dronecanRouteTableInit(dronecanRouteTable_t *table);
+
+// Append a route; it gets index `count` as it was before the call. Returns
+// false if the table is full.
+bool dronecanRouteTableAdd(dronecanRouteTable_t *table, uint16_t dataTypeId, uint8_t transferType);
+
+// Index of the first route for the transfer, or -1. dronecanRouteTableNext()
+// continues from a found index to the next route with the same key.
+int dronecanRouteTableFind(const dronecanRouteTable_t *table, uint16_t dataTypeId, uint8_t transferType);
+int dronecanRouteTableNext(const dronecanRouteTable_t *table, int index);
+
+// Extended-frame acceptance filters passing exactly the frames of the routed
+// transfers: messages of each type, anonymous messages where the type fits
+// the anonymous frame's two bits, and service transfers addressed to
+// localNodeId. Returns the number written, at most DRONECAN_ROUTE_FILTERS_MAX.
+uint8_t dronecanRouteTableFilters(const dronecanRouteTable_t *table, uint8_t localNodeId, canFilter_t *filters);
+
+#endif // ENABLE_DRONECAN
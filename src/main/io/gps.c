@@ -384,6 +384,7 @@ static bool gpsNewFrameNMEA(char c);
 #endif
 #ifdef USE_GPS_UBLOX
 static bool gpsNewFrameUBLOX(uint8_t data);
+static void ubloxReceiveBlock(uint32_t rxBytesWaiting);
 #endif
 
 static void gpsSetState(gpsState_e state)
@@ -1434,16 +1435,6 @@ void rescheduleWhenNecessary(uint8_t* wait, bool* isFast)
     }
 }
 
-static bool ubloxParsingAlmostDone = false;
-
-static inline uint32_t cpuCycleLimit(void)
-{
-    if (ubloxParsingAlmostDone) {
-        return clockMicrosToCycles(GPS_UBLOX_RECV_TIME_MAX - GPS_FRAME_PROCESS_TIME_US);
-    }
-    return clockMicrosToCycles(GPS_UBLOX_RECV_TIME_MAX);
-}
-
 void gpsUpdate(timeUs_t currentTimeUs)
 {
     static timeDelta_t gpsStateDurationFractionUs[GPS_STATE_COUNT];
@@ -1460,21 +1451,15 @@ void gpsUpdate(timeUs_t currentTimeUs)
         }
         rxBytesWaiting = serialRxBytesWaiting(gpsPort);
         DEBUG_SET(DEBUG_GPS_CONNECTION, 7, rxBytesWaiting);
-        const uint32_t initialCycleCount = getCycleCounter();
         static uint8_t wait = 0;
         static bool isFast = false;
-        while (rxBytesWaiting-- > 0) {
+        if (rxBytesWaiting > 0) {
             wait = 0;
             if (!isFast) {
                 rescheduleTask(TASK_SELF, TASK_PERIOD_HZ(TASK_GPS_RATE_FAST));
                 isFast = true;
             }
-            if (cmp32((getCycleCounter() - initialCycleCount), cpuCycleLimit()) > 0) {
-                break;
-            }
-            if (gpsNewFrameUBLOX(serialRead(gpsPort))) {
-                gpsHandleFrameComplete();
-            }
+            ubloxReceiveBlock(rxBytesWaiting);
         }
         rescheduleWhenNecessary(&wait, &isFast);
         break;
@@ -2292,6 +2277,22 @@ static union {
 static uint8_t ubxRcvMsgChecksumA;
 static uint8_t ubxRcvMsgChecksumB;
 
+// Block parser receive buffer.
+// Bytes are moved out of the serial port in one go and whole frames are validated and decoded straight
+// from this buffer. Frames are kept starting at UBX_RX_FRAME_OFFSET (mod 4) so that the payload, which
+// follows the 6 byte header, is 32 bit aligned and NAV-PVT can be decoded in place without a copy.
+// It is sized for the largest payload accepted, a 64 satellite NAV-SAT (M10 receivers tracking four
+// constellations routinely report more than the 32 satellites kept), so that every accepted frame can be
+// checksummed in place, and a corrupt header with any accepted length can be dropped and the frames
+// buffered behind it parsed again rather than lost.
+#define UBX_HEADER_SIZE 6
+#define UBX_CHECKSUM_SIZE 2
+#define UBX_RX_FRAME_OFFSET 2
+#define UBX_RX_BUFFER_SIZE (UBX_RX_FRAME_OFFSET + UBX_HEADER_SIZE + UBLOX_MAX_PAYLOAD_SANITY_SIZE + UBX_CHECKSUM_SIZE)
+static uint8_t ubxRxBuffer[UBX_RX_BUFFER_SIZE] __attribute__((aligned(4)));
+static uint16_t ubxRxHead = UBX_RX_FRAME_OFFSET;   // First byte not yet parsed.
+static uint16_t ubxRxTail = UBX_RX_FRAME_OFFSET;   // One past the last byte received.
+
 // Message frame parsing state machine control.
 typedef enum {
     UBX_PARSE_PREAMBLE_SYNC_1,
@@ -2492,6 +2493,57 @@ static void setRtcDateTimeFromGps(void) {
 }
 #endif
 
+static void ubloxParseNavPvt(const ubxNavPvt_t *navPvt)
+{
+#ifdef USE_DASHBOARD
+    *dashboardGpsPacketLogCurrentChar = DASHBOARD_LOG_UBLOX_SOL;
+#endif
+    ubxHaveNewValidFix = (navPvt->flags & NAV_STATUS_FIX_VALID) && (navPvt->fixType == FIX_3D);
+    gpsSol.time = navPvt->time;
+    calculateNavInterval();
+    gpsSol.llh.lon = navPvt->lon;
+    gpsSol.llh.lat = navPvt->lat;
+    gpsSol.llh.altCm = navPvt->hMSL / 10;  //alt in cm
+    gpsSetFixState(ubxHaveNewValidFix);
+    ubxHaveNewPosition = true;
+    gpsSol.numSat = navPvt->numSV;
+    gpsSol.acc.hAcc = navPvt->hAcc;
+    gpsSol.acc.vAcc = navPvt->vAcc;
+    gpsSol.acc.sAcc = navPvt->sAcc;
+    gpsSol.acc.headAcc = navPvt->headAcc;
+    // gSpeed & velD are in mm/s (int32_t), gpsSol.speed3d in cm/s (uint16_t)
+    float gs = (float)navPvt->gSpeed;
+    float vd = (float)navPvt->velD;
+    gpsSol.speed3d = (uint16_t)(sqrtf(sq(gs) + sq(vd)) * 0.1f);     // mm/s -> cm/s
+    // Update 2D ground speed (mm/s -> cm/s) for NAV-PVT when NAV-VELNED is disabled
+    gpsSol.groundSpeed = (uint16_t)(navPvt->gSpeed / 10);    // cm/s
+    gpsSol.groundCourse = (uint16_t)(navPvt->headMot / 10000);     // Heading 2D deg * 100000 rescaled to deg * 10
+    gpsSol.dop.pdop = navPvt->pDOP;
+    // NAV-PVT doesn't provide hDOP/vDOP, estimate from pDOP (pDOP >= hDOP/vDOP, so this is conservative)
+    gpsSol.dop.hdop = navPvt->pDOP;
+    gpsSol.dop.vdop = navPvt->pDOP;
+    gpsSol.velned.velN = (int16_t)(navPvt->velN / 10); // cm/s
+    gpsSol.velned.velE = (int16_t)(navPvt->velE / 10); // cm/s
+    gpsSol.velned.velD = (int16_t)(navPvt->velD / 10); // cm/s
+    ubxHaveNewSpeed = true;
+    // Store GPS date/time for telemetry, applying nano correction per u-blox spec.
+    gpsDateTimeFromNavPvt(&gpsSol.dateTime, navPvt);
+#ifdef USE_RTC_TIME
+    setRtcDateTimeFromGps();
+#endif
+}
+
+// we only return true when we get new position and speed data
+// this ensures we don't use stale data
+static bool ubloxHaveNewNavSolution(void)
+{
+    if (ubxHaveNewPosition && ubxHaveNewSpeed) {
+        ubxHaveNewSpeed = ubxHaveNewPosition = false;
+        return true;
+    }
+    return false;
+}
+
 static bool UBLOX_parse_gps(void)
 {
 //    lastUbxRcvMsgClass = ubxRcvMsgClass;
@@ -2503,42 +2555,7 @@ static bool UBLOX_parse_gps(void)
     switch (CLSMSG(ubxRcvMsgClass, ubxRcvMsgID)) {
 
     case CLSMSG(CLASS_NAV, MSG_NAV_PVT):
-#ifdef USE_DASHBOARD
-        *dashboardGpsPacketLogCurrentChar = DASHBOARD_LOG_UBLOX_SOL;
-#endif
-        ubxHaveNewValidFix = (ubxRcvMsgPayload.ubxNavPvt.flags & NAV_STATUS_FIX_VALID) && (ubxRcvMsgPayload.ubxNavPvt.fixType == FIX_3D);
-        gpsSol.time = ubxRcvMsgPayload.ubxNavPvt.time;
-        calculateNavInterval();
-        gpsSol.llh.lon = ubxRcvMsgPayload.ubxNavPvt.lon;
-        gpsSol.llh.lat = ubxRcvMsgPayload.ubxNavPvt.lat;
-        gpsSol.llh.altCm = ubxRcvMsgPayload.ubxNavPvt.hMSL / 10;  //alt in cm
-        gpsSetFixState(ubxHaveNewValidFix);
-        ubxHaveNewPosition = true;
-        gpsSol.numSat = ubxRcvMsgPayload.ubxNavPvt.numSV;
-        gpsSol.acc.hAcc = ubxRcvMsgPayload.ubxNavPvt.hAcc;
-        gpsSol.acc.vAcc = ubxRcvMsgPayload.ubxNavPvt.vAcc;
-        gpsSol.acc.sAcc = ubxRcvMsgPayload.ubxNavPvt.sAcc;
-        gpsSol.acc.headAcc = ubxRcvMsgPayload.ubxNavPvt.headAcc;
-        // gSpeed & velD are in mm/s (int32_t), gpsSol.speed3d in cm/s (uint16_t)
-        float gs = (float)ubxRcvMsgPayload.ubxNavPvt.gSpeed;
-        float vd = (float)ubxRcvMsgPayload.ubxNavPvt.velD;
-        gpsSol.speed3d = (uint16_t)(sqrtf(sq(gs) + sq(vd)) * 0.1f);     // mm/s -> cm/s
-        // Update 2D ground speed (mm/s -> cm/s) for NAV-PVT when NAV-VELNED is disabled
-        gpsSol.groundSpeed = (uint16_t)(ubxRcvMsgPayload.ubxNavPvt.gSpeed / 10);    // cm/s
-        gpsSol.groundCourse = (uint16_t)(ubxRcvMsgPayload.ubxNavPvt.headMot / 10000);     // Heading 2D deg * 100000 rescaled to deg * 10
-        gpsSol.dop.pdop = ubxRcvMsgPayload.ubxNavPvt.pDOP;
-        // NAV-PVT doesn't provide hDOP/vDOP, estimate from pDOP (pDOP >= hDOP/vDOP, so this is conservative)
-        gpsSol.dop.hdop = ubxRcvMsgPayload.ubxNavPvt.pDOP;
-        gpsSol.dop.vdop = ubxRcvMsgPayload.ubxNavPvt.pDOP;
-        gpsSol.velned.velN = (int16_t)(ubxRcvMsgPayload.ubxNavPvt.velN / 10); // cm/s
-        gpsSol.velned.velE = (int16_t)(ubxRcvMsgPayload.ubxNavPvt.velE / 10); // cm/s
-        gpsSol.velned.velD = (int16_t)(ubxRcvMsgPayload.ubxNavPvt.velD / 10); // cm/s
-        ubxHaveNewSpeed = true;
-        // Store GPS date/time for telemetry, applying nano correction per u-blox spec.
-        gpsDateTimeFromNavPvt(&gpsSol.dateTime, &ubxRcvMsgPayload.ubxNavPvt);
-#ifdef USE_RTC_TIME
-        setRtcDateTimeFromGps();
-#endif
+        ubloxParseNavPvt(&ubxRcvMsgPayload.ubxNavPvt);
         break;
     case CLSMSG(CLASS_NAV, MSG_NAV_SAT):
 #ifdef USE_DASHBOARD
@@ -2713,19 +2730,11 @@ static bool UBLOX_parse_gps(void)
     }
 #undef CLSMSG
 
-    // we only return true when we get new position and speed data
-    // this ensures we don't use stale data
-    if (ubxHaveNewPosition && ubxHaveNewSpeed) {
-        ubxHaveNewSpeed = ubxHaveNewPosition = false;
-        return true;
-    }
-    return false;
+    return ubloxHaveNewNavSolution();
 }
 
 static bool gpsNewFrameUBLOX(uint8_t data)
 {
-    ubloxParsingAlmostDone = false;
-
     // Fast path for payload content — this is the hot loop state, hit once per payload byte (up to 392 times for NAV-SAT).
     // Handling it before the switch avoids the jump table lookup for the vast majority of bytes in a message.
     if (ubxFrameParseState == UBX_PARSE_PAYLOAD_CONTENT) {
@@ -2813,7 +2822,6 @@ static bool gpsNewFrameUBLOX(uint8_t data)
         if (ubxRcvMsgChecksumA == data) {
             // Checksum A matches, go on to checksum B.
             ubxFrameParseState = UBX_PARSE_CHECKSUM_B;
-            ubloxParsingAlmostDone = true;
             break;
         }
         // Bad checksum A, restart new message parsing.
@@ -2856,6 +2864,122 @@ static bool gpsNewFrameUBLOX(uint8_t data)
     // Note this function returns if UBLOX_parse_gps() found new position data, NOT whether this function successfully parsed the frame or not.
     return newPositionDataReceived;
 }
+
+static bool ubloxHandleFrame(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t payloadLength)
+{
+#ifdef USE_DASHBOARD
+    dashboardGpsPacketCount++;  // Packet counter used by dashboard device.
+    shiftPacketLog();           // Make space for message handling to add the message type char to the dashboard device packet log.
+#endif
+    // Fast path for the high rate navigation solution, decoded straight from the receive buffer.
+    if (msgClass == CLASS_NAV && msgId == MSG_NAV_PVT && payloadLength >= sizeof(ubxNavPvt_t) && ((uintptr_t)payload & 3) == 0) {
+        ubloxParseNavPvt((const ubxNavPvt_t *)payload);
+        return ubloxHaveNewNavSolution();
+    }
+
+    ubxRcvMsgClass = msgClass;
+    ubxRcvMsgID = msgId;
+    ubxRcvMsgPayloadLength = payloadLength;
+    memcpy(ubxRcvMsgPayload.rawBytes, payload, MIN(payloadLength, UBLOX_PAYLOAD_SIZE));
+    return UBLOX_parse_gps();
+}
+
+static void ubloxDropRxBytes(uint16_t count)
+{
+#ifdef USE_DASHBOARD
+    logErrorToPacketLog();
+#endif
+    ubxRxHead += count;
+}
+
+// Parses the frame at the head of the receive buffer.
+// Returns false when no progress can be made until more bytes are received.
+static bool ubloxParseNextFrame(bool *newPositionDataReceived)
+{
+    const uint8_t *frame = memchr(&ubxRxBuffer[ubxRxHead], PREAMBLE1, ubxRxTail - ubxRxHead);
+    if (!frame) {
+        ubxRxHead = ubxRxTail;
+        return false;
+    }
+    ubxRxHead = frame - ubxRxBuffer;
+
+    const uint16_t available = ubxRxTail - ubxRxHead;
+    if (available < 2) {
+        return false;
+    }
+    if (frame[1] != PREAMBLE2) {
+        // False start, resync on the next preamble.
+        ubxRxHead++;
+        return true;
+    }
+    if (available < UBX_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint16_t payloadLength = frame[4] | (frame[5] << 8);
+    if (payloadLength > UBLOX_MAX_PAYLOAD_SANITY_SIZE) {
+        // Payload length is not reasonable, treat as a bad packet and look for a new message.
+        ubloxDropRxBytes(1);
+        return true;
+    }
+    const uint16_t frameLength = UBX_HEADER_SIZE + payloadLength + UBX_CHECKSUM_SIZE;
+    if (available < frameLength) {
+        return false;
+    }
+
+    // Fletcher checksum over class, id, length and payload, in one pass over the buffer.
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+    for (const uint8_t *p = &frame[2]; p < &frame[UBX_HEADER_SIZE + payloadLength]; p++) {
+        checksumB += (checksumA += *p);
+    }
+    if (checksumA != frame[frameLength - 2] || checksumB != frame[frameLength - 1]) {
+        ubloxDropRxBytes(1);
+        return true;
+    }
+
+    ubxRxHead += frameLength;
+    if (ubloxHandleFrame(frame[2], frame[3], &frame[UBX_HEADER_SIZE], payloadLength)) {
+        *newPositionDataReceived = true;
+    }
+    return true;
+}
+
+static void ubloxReceiveBlock(uint32_t rxBytesWaiting)
+{
+    const uint32_t initialCycleCount = getCycleCounter();
+    const uint32_t frameCycleLimit = clockMicrosToCycles(GPS_UBLOX_RECV_TIME_MAX - GPS_FRAME_PROCESS_TIME_US);
+
+    const uint32_t count = MIN(rxBytesWaiting, (uint32_t)(UBX_RX_BUFFER_SIZE - ubxRxTail));
+    for (uint32_t i = 0; i < count; i++) {
+        ubxRxBuffer[ubxRxTail++] = serialRead(gpsPort);
+    }
+
+    bool newPositionDataReceived = false;
+    while (ubxRxHead < ubxRxTail) {
+        if (cmp32(getCycleCounter() - initialCycleCount, frameCycleLimit) > 0) {
+            // Out of time, the remaining frames are handled on the next run.
+            break;
+        }
+        if (!ubloxParseNextFrame(&newPositionDataReceived)) {
+            break;
+        }
+        if (newPositionDataReceived) {
+            gpsHandleFrameComplete();
+            newPositionDataReceived = false;
+        }
+    }
+
+    if (ubxRxHead == ubxRxTail) {
+        ubxRxHead = ubxRxTail = UBX_RX_FRAME_OFFSET;
+    } else if (ubxRxTail == UBX_RX_BUFFER_SIZE || (ubxRxHead & 3) != UBX_RX_FRAME_OFFSET) {
+        // Move the partial frame to the start of the buffer, restoring payload alignment and making room for the rest of it.
+        const uint16_t remaining = ubxRxTail - ubxRxHead;
+        memmove(&ubxRxBuffer[UBX_RX_FRAME_OFFSET], &ubxRxBuffer[ubxRxHead], remaining);
+        ubxRxHead = UBX_RX_FRAME_OFFSET;
+        ubxRxTail = UBX_RX_FRAME_OFFSET + remaining;
+    }
+}
 #endif // USE_GPS_UBLOX
 
 static void gpsHandlePassthrough(uint8_t data)
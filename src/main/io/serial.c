@@ -667,6 +667,7 @@ void closeSerialPort(serialPort_t *serialPort)
 
     // TODO wait until data has been transmitted.
     serialPort->rxCallback = NULL;
+    serialPort->rxFrameCallback = NULL;
 
     serialPortUsage->function = FUNCTION_NONE;
     serialPortUsage->serialPort = NULL;
@@ -50,6 +50,9 @@
 #ifdef USE_GIMBAL
 #include "pg/gimbal.h"
 #endif
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+#include "pg/mavlink_offboard.h"
+#endif
 #ifdef USE_VTX_COMMON
 #include "drivers/vtx_common.h"
 #include "io/vtx.h"
@@ -109,6 +112,11 @@ uint32_t serialSynthesizeFunctionMask(serialPortIdentifier_e identifier)
         mask |= FUNCTION_GIMBAL;
     }
 #endif
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    if (mavlinkOffboardConfig()->offboard_uart == identifier) {
+        mask |= FUNCTION_MAVLINK_OFFBOARD;
+    }
+#endif
 #ifdef USE_VTX_COMMON
     if (vtxSettingsConfig()->vtx_uart == identifier) {
         switch (vtxSettingsConfig()->vtx_type) {
@@ -231,6 +239,11 @@ static void clearClaimsOnPort(serialPortIdentifier_e identifier)
         gimbalTrackConfigMutable()->gimbal_uart = SERIAL_PORT_NONE;
     }
 #endif
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    if (mavlinkOffboardConfig()->offboard_uart == identifier) {
+        mavlinkOffboardConfigMutable()->offboard_uart = SERIAL_PORT_NONE;
+    }
+#endif
 #ifdef USE_VTX_COMMON
     if (vtxSettingsConfig()->vtx_uart == identifier) {
         vtxSettingsConfigMutable()->vtx_uart = SERIAL_PORT_NONE;
@@ -412,6 +425,11 @@ bool serialApplyFunctionMask(serialPortIdentifier_e identifier, uint32_t mask)
         gimbalTrackConfigMutable()->gimbal_uart = identifier;
     }
 #endif
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    if (mask & FUNCTION_MAVLINK_OFFBOARD) {
+        mavlinkOffboardConfigMutable()->offboard_uart = identifier;
+    }
+#endif
 #ifdef USE_VTX_COMMON
     // VTX bit count pre-validated ≤ 1; at most one branch fires.
 #ifdef USE_VTX_SMARTAUDIO
@@ -138,6 +138,15 @@ int main(int argc, char * argv[])
     }
 #endif
 
+#ifdef USE_BLACKBOX_REPLAY
+    {
+        const char *replayFile = targetGetReplayFile();
+        if (replayFile) {
+            return targetReplayBlackbox(replayFile);
+        }
+    }
+#endif
+
     // Launch the scheduler
     run();
 
@@ -149,7 +158,10 @@ void FAST_CODE run(void)
     while (true) {
         scheduler();
 
-#if defined(RUN_LOOP_DELAY_US) && RUN_LOOP_DELAY_US > 0
+#if ENABLE_SIMULATOR
+        // wakes early for FDM and RC packets from the I/O thread
+        sitlMainLoopIdle(RUN_LOOP_DELAY_US);
+#elif defined(RUN_LOOP_DELAY_US) && RUN_LOOP_DELAY_US > 0
         delayMicroseconds_real(RUN_LOOP_DELAY_US);
 #endif
     }
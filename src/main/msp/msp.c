@@ -139,6 +139,7 @@
 
 #include "rx/rx.h"
 #include "rx/rx_bind.h"
+#include "rx/rc_latency.h"
 #include "rx/msp.h"
 
 #include "scheduler/scheduler.h"
@@ -1357,6 +1358,25 @@ case MSP_NAME:
         }
         break;
 
+#ifdef USE_RC_LATENCY_STATS
+    case MSP2_RC_LATENCY:
+        sbufWriteU8(dst, RC_LATENCY_STAGE_COUNT);
+        sbufWriteU8(dst, RC_LATENCY_BUCKET_COUNT);
+        sbufWriteU16(dst, RC_LATENCY_BUCKET_BASE_US);
+        for (int stage = 0; stage < RC_LATENCY_STAGE_COUNT; stage++) {
+            const rcLatencyStats_t *stats = rcLatencyGetStats(stage);
+            sbufWriteU32(dst, stats->count);
+            sbufWriteU32(dst, rcLatencyGetAverageUs(stage));
+            sbufWriteU32(dst, stats->minUs);
+            sbufWriteU32(dst, stats->maxUs);
+            sbufWriteU32(dst, stats->lastUs);
+            for (int bucket = 0; bucket < RC_LATENCY_BUCKET_COUNT; bucket++) {
+                sbufWriteU32(dst, stats->bucket[bucket]);
+            }
+        }
+        break;
+#endif
+
     case MSP2_MOTOR_OUTPUT_REORDERING:
         {
             sbufWriteU8(dst, MAX_SUPPORTED_MOTORS);
@@ -4454,6 +4474,12 @@ RAM_CODE static mspResult_e mspProcessInCommand(mspDescriptor_t srcDesc, int16_t
 
         break;
 #endif
+#ifdef USE_RC_LATENCY_STATS
+    case MSP2_RESET_RC_LATENCY:
+        rcLatencyReset();
+
+        break;
+#endif
 
     case MSP2_SET_TEXT:
         {
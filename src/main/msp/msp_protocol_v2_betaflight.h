@@ -37,6 +37,8 @@
 #define MSP2_CLI_SETTING                    0x3010
 #define MSP2_CLI_SETTING_INFO               0x3011
 #define MSP2_CLI_COMMAND                    0x3012
+#define MSP2_RC_LATENCY                     0x3013  // stick to motor latency statistics, see rx/rc_latency.h
+#define MSP2_RESET_RC_LATENCY               0x3014
 
 // MSP2_CLI_COMMAND response flags (byte following the u16 total-length header)
 #define MSP2_CLI_COMMAND_FLAG_TRUNCATED     (1 << 0) // output exceeded the pageable buffer
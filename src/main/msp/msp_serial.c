@@ -292,14 +292,6 @@ static void mspSerialProcessReceivedPacketData(mspPort_t *mspPort, uint8_t c)
     }
 }
 
-static uint8_t mspSerialChecksumBuf(uint8_t checksum, const uint8_t *data, int len)
-{
-    while (len-- > 0) {
-        checksum ^= *data++;
-    }
-    return checksum;
-}
-
 #define JUMBO_FRAME_SIZE_LIMIT 255
 static int mspSerialSendFrame(mspPort_t *msp, const uint8_t * hdr, int hdrLen, const uint8_t * data, int dataLen, const uint8_t * crc, int crcLen)
 {
@@ -350,8 +342,8 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet, mspVersion_e msp
         }
 
         // Pre-calculate CRC
-        checksum = mspSerialChecksumBuf(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
-        checksum = mspSerialChecksumBuf(checksum, sbufPtr(&packet->buf), dataLen);
+        checksum = crc8_xor_update(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
+        checksum = crc8_xor_update(checksum, sbufPtr(&packet->buf), dataLen);
         crcBuf[crcLen++] = checksum;
     } else if (mspVersion == MSP_V2_OVER_V1) {
         mspHeaderV1_t * hdrV1 = (mspHeaderV1_t *)&hdrBuf[hdrLen];
@@ -386,9 +378,9 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet, mspVersion_e msp
         crcBuf[crcLen++] = checksum;
 
         // V1 CRC: All headers + data payload + V2 CRC byte
-        checksum = mspSerialChecksumBuf(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
-        checksum = mspSerialChecksumBuf(checksum, sbufPtr(&packet->buf), dataLen);
-        checksum = mspSerialChecksumBuf(checksum, crcBuf, crcLen);
+        checksum = crc8_xor_update(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
+        checksum = crc8_xor_update(checksum, sbufPtr(&packet->buf), dataLen);
+        checksum = crc8_xor_update(checksum, crcBuf, crcLen);
         crcBuf[crcLen++] = checksum;
     } else if (mspVersion == MSP_V2_NATIVE) {
         mspHeaderV2_t * hdrV2 = (mspHeaderV2_t *)&hdrBuf[hdrLen];
@@ -40,6 +40,7 @@
 #include "blackbox/blackbox_io.h"
 
 #include "build/build_config.h"
+#include "build/debug.h"
 #include "build/version.h"
 
 #include "cms/cms.h"
@@ -1545,6 +1546,7 @@ void osdUpdate(timeUs_t currentTimeUs)
     case OSD_STATE_DRAW_ELEMENT:
         {
             uint8_t osdElement = osdGetActiveElement();
+            const uint8_t osdItem = osdGetActiveElementItem();
 
             timeUs_t startElementTime = micros();
 
@@ -1559,6 +1561,13 @@ void osdUpdate(timeUs_t currentTimeUs)
                 osdElementDurationFractionUs[osdElement]--;
             }
 
+            // Multi-pass elements (horizon, nav map) are timed per pass, which
+            // is what the scheduler has to fit into a slot
+            DEBUG_SET(DEBUG_OSD_ELEMENT_TIME, 0, osdElement);
+            DEBUG_SET(DEBUG_OSD_ELEMENT_TIME, 1, MIN(executeTimeUs, INT16_MAX));
+            DEBUG_SET(DEBUG_OSD_ELEMENT_TIME, 2, MIN(osdElementDurationFractionUs[osdElement] >> OSD_EXEC_TIME_SHIFT, INT16_MAX));
+            DEBUG_SET(DEBUG_OSD_ELEMENT_TIME, 3, osdItem);
+
             if (osdIsRenderPending()) {
                 osdState = OSD_STATE_DISPLAY_ELEMENT;
 
@@ -162,6 +162,7 @@
 #include "flight/gps_rescue.h"
 #include "flight/position.h"
 #include "flight/imu.h"
+#include "flight/mission_store.h"
 #include "flight/mixer.h"
 #include "flight/pid.h"
 #include "flight/pos_hold.h"
@@ -1362,15 +1363,15 @@ static void osdPutHyphen(osdElementParms_t *element)
 }
 
 // Current waypoint clamped into the stored plan; valid only when count > 0.
-static uint8_t osdWpCurrentIndex(uint8_t count)
+static uint16_t osdWpCurrentIndex(uint16_t count)
 {
-    const uint8_t index = flightPlanNavGetCurrentIndex();
-    return (index < count) ? index : (uint8_t)(count - 1);
+    const uint16_t index = flightPlanNavGetCurrentIndex();
+    return (index < count) ? index : (uint16_t)(count - 1);
 }
 
 static void osdElementWpNumber(osdElementParms_t *element)
 {
-    const uint8_t count = flightPlanConfig()->waypointCount;
+    const uint16_t count = missionStoreGetCount();
     if (count == 0) {
         osdPutHyphen(element);
         return;
@@ -1380,12 +1381,12 @@ static void osdElementWpNumber(osdElementParms_t *element)
 
 static void osdElementWpNextNumber(osdElementParms_t *element)
 {
-    const uint8_t count = flightPlanConfig()->waypointCount;
+    const uint16_t count = missionStoreGetCount();
     if (count == 0) {
         osdPutHyphen(element);
         return;
     }
-    const uint8_t next = osdWpCurrentIndex(count) + 1;
+    const uint16_t next = osdWpCurrentIndex(count) + 1;
     if (next >= count) {
         osdPutHyphen(element);
         return;
@@ -1404,12 +1405,12 @@ static void osdFormatWaypointCoordinate(char *buff, int32_t value, char leadingS
 
 static void osdElementWpCoordinate(osdElementParms_t *element)
 {
-    const uint8_t count = flightPlanConfig()->waypointCount;
-    if (count == 0) {
+    const uint16_t count = missionStoreGetCount();
+    const waypoint_t *wp = (count > 0) ? missionStoreGetWaypoint(osdWpCurrentIndex(count)) : NULL;
+    if (wp == NULL) {
         osdPutHyphen(element);
         return;
     }
-    const waypoint_t *wp = &flightPlanConfig()->waypoints[osdWpCurrentIndex(count)];
     if (element->item == OSD_WP_CURRENT_LON) {
         osdFormatWaypointCoordinate(element->buff, wp->longitude, SYM_LON);
     } else {
@@ -1419,12 +1420,13 @@ static void osdElementWpCoordinate(osdElementParms_t *element)
 
 static void osdElementWpAltitude(osdElementParms_t *element)
 {
-    const uint8_t count = flightPlanConfig()->waypointCount;
-    if (count == 0) {
+    const uint16_t count = missionStoreGetCount();
+    const waypoint_t *wp = (count > 0) ? missionStoreGetWaypoint(osdWpCurrentIndex(count)) : NULL;
+    if (wp == NULL) {
         osdPutHyphen(element);
         return;
     }
-    osdFormatAltitudeString(element->buff, flightPlanConfig()->waypoints[osdWpCurrentIndex(count)].altitude, element->type);
+    osdFormatAltitudeString(element->buff, wp->altitude, element->type);
 }
 
 static void osdElementWpDistance(osdElementParms_t *element)
@@ -2543,6 +2545,12 @@ uint8_t osdGetActiveElement(void)
     return activeElementNumber;
 }
 
+// OSD item (osd_items_e) at the active element slot
+uint8_t osdGetActiveElementItem(void)
+{
+    return activeElementNumber < activeOsdElementCount ? activeOsdElementArray[activeElementNumber] : OSD_ITEM_COUNT;
+}
+
 uint8_t osdGetActiveElementCount(void)
 {
     return activeOsdElementCount;
@@ -64,6 +64,7 @@ char osdGetTemperatureSymbolForSelectedUnit(void);
 void osdAddActiveElements(void);
 bool osdIsRenderPending(void);
 uint8_t osdGetActiveElement(void);
+uint8_t osdGetActiveElementItem(void);
 uint8_t osdGetActiveElementCount(void);
 bool osdDrawNextActiveElement(displayPort_t *osdDisplayPort);
 bool osdDisplayActiveElement(void);
@@ -30,7 +30,15 @@
 //
 // All map geometry is local ENU centimetres relative to home (home is the
 // origin); waypoints are converted from their stored absolute coordinates
-// once per frame.
+// only when the plan or home changes.
+//
+// Rendering is layered. The border, range ring and stored trail are
+// rasterized into a cached layer once per projection (scale, rotation,
+// centre) and extended as the trail grows; waypoint marker cells are resolved
+// at the same time. Each frame copies the layer and adds only what moves: the
+// live trail tail, blinking marker, scale label, home and craft. A rebuild is
+// spread over OSD passes a few dozen trail segments at a time, so no single
+// pass carries the whole map.
 
 #include <math.h>
 #include <stdlib.h>
@@ -51,6 +59,7 @@
 
 #include "flight/flight_plan_nav.h"
 #include "flight/imu.h"
+#include "flight/mission_store.h"
 #include "flight/nav_trail.h"
 
 #include "io/gps.h"
@@ -70,6 +79,9 @@
 #define NAV_MAP_MIN_SCALE_M   20
 #define NAV_MAP_OVER_HOME_CM  1000.0f
 #define NAV_MAP_MARKER_MAX    9      // single-glyph markers: digits '1'..'9' only
+#define NAV_MAP_TRAIL_SEGMENTS_PER_PASS 32   // trail rasterization budget of one OSD pass
+#define NAV_MAP_RECENTRE_CELLS  0.25f // a craft-centred view follows the craft in quarter cells
+#define NAV_MAP_ROTATION_STEP_DEG 3   // a heading-up view turns in steps of this size
 
 typedef struct navMapFrame_s {
     uint8_t grid[NAV_MAP_ROWS][NAV_MAP_COLS];
@@ -84,12 +96,47 @@ typedef struct navMapFrame_s {
     int16_t mapRotationDeg;   // rotation actually applied to the view
 } navMapFrame_t;
 
+// Static layers for the current projection
+typedef struct navMapLayers_s {
+    uint8_t grid[NAV_MAP_ROWS][NAV_MAP_COLS];       // border, range ring, stored trail
+    uint8_t trailBarRowPlusOne[NAV_MAP_COLS];       // stroke dedup state after the stored trail
+    int8_t markerCol[NAV_MAP_MARKER_MAX];
+    int8_t markerRow[NAV_MAP_MARKER_MAX];
+    uint32_t scaleM;
+    uint16_t trailRevision;
+    unsigned trailPlotted;                          // stored points already rasterized
+    bool homeValid;
+    bool baseDrawn;
+    bool valid;
+} navMapLayers_t;
+
+// Positional waypoints of the plan in home-relative ENU
+typedef struct navMapWaypoints_s {
+    vector2_t posCm[NAV_MAP_MARKER_MAX];
+    uint8_t index[NAV_MAP_MARKER_MAX];
+    uint8_t count;
+    uint32_t signature;
+    bool valid;
+} navMapWaypoints_t;
+
 static navMapFrame_t frame;
+static navMapLayers_t layers;
+static navMapWaypoints_t waypoints;
 static bool framePrepared = false;
 static uint8_t renderRow = 0;
 static uint32_t autoScaleM = 0;
 static uint8_t animPhase = 0;
 static uint8_t trailBarRowPlusOne[NAV_MAP_COLS];   // per-frame stroke dedup, 0 = column clean
+
+// frame state carried from prepareFrame() to composeFrame()
+static vector2_t frameCraftCm;
+static int frameHeadingDeg;
+static bool frameFixValid;
+static bool framePositionValid;
+
+// where the plot primitives draw: the cached layer or this frame
+static uint8_t (*canvas)[NAV_MAP_COLS] = frame.grid;
+static uint8_t *canvasBarRowPlusOne = trailBarRowPlusOne;
 static uint32_t lastScaleShownM = 0;
 static uint8_t scaleFlashFrames = 0;
 static bool scaleZoomedOut = false;
@@ -136,6 +183,47 @@ static void waypointEnuCm(const waypoint_t *wp, vector2_t *posCm)
     GPS_distance2d(&GPS_home_llh, &loc, posCm);
 }
 
+static uint32_t signatureMix(uint32_t hash, uint32_t value)
+{
+    return (hash ^ value) * 16777619u;   // FNV-1a step, one word at a time
+}
+
+// Refresh the waypoint positions when the plan or home has changed. Only the
+// markers that can be drawn (the same NAV_MAP_MARKER_MAX bound as the labels)
+// are kept, and only they are fitted by auto-zoom.
+static void updateWaypointCache(void)
+{
+    const uint16_t count = missionStoreGetCount();
+    uint32_t signature = signatureMix(2166136261u, count);
+    signature = signatureMix(signature, GPS_home_llh.lat);
+    signature = signatureMix(signature, GPS_home_llh.lon);
+    for (uint16_t i = 0; i < count && i < NAV_MAP_MARKER_MAX; i++) {
+        const waypoint_t *wp = missionStoreGetWaypoint(i);
+        if (wp != NULL) {
+            signature = signatureMix(signature, wp->type);
+            signature = signatureMix(signature, wp->latitude);
+            signature = signatureMix(signature, wp->longitude);
+        }
+    }
+    if (waypoints.valid && signature == waypoints.signature) {
+        return;
+    }
+
+    waypoints.count = 0;
+    for (uint16_t i = 0; i < count && i < NAV_MAP_MARKER_MAX; i++) {
+        const waypoint_t *wp = missionStoreGetWaypoint(i);
+        if (wp == NULL || !waypointIsPositional(wp)) {
+            continue;
+        }
+        waypointEnuCm(wp, &waypoints.posCm[waypoints.count]);
+        waypoints.index[waypoints.count] = i;
+        waypoints.count++;
+    }
+    waypoints.signature = signature;
+    waypoints.valid = true;
+    layers.valid = false;
+}
+
 // rotate a home-relative ENU position into screen space (x right, y up)
 static void worldToView(const vector2_t *posCm, float *viewX, float *viewY)
 {
@@ -168,7 +256,7 @@ static bool cellInInterior(int col, int row)
 static void plotCell(int col, int row, uint8_t glyph)
 {
     if (cellInInterior(col, row)) {
-        frame.grid[row + 1][col + 1] = glyph;
+        canvas[row + 1][col + 1] = glyph;
     }
 }
 
@@ -176,7 +264,7 @@ static void plotCellClamped(int col, int row, uint8_t glyph)
 {
     col = constrain(col, 0, NAV_MAP_COLS - 3);
     row = constrain(row, 0, NAV_MAP_ROWS - 3);
-    frame.grid[row + 1][col + 1] = glyph;
+    canvas[row + 1][col + 1] = glyph;
 }
 
 // draw a solid line between two world points, clipped to the visible area
@@ -245,11 +333,11 @@ static void plotWorldLine(const vector2_t *fromCm, const vector2_t *toCm)
             // adjacent-row case though: a loop or switchback re-crossing the
             // same column a few rows off is a real stroke, let it draw
             if (col >= 0 && col < NAV_MAP_COLS) {
-                const uint8_t marked = trailBarRowPlusOne[col];
+                const uint8_t marked = canvasBarRowPlusOne[col];
                 if (marked != 0 && abs((int)marked - (row + 1)) <= 1) {
                     continue;
                 }
-                trailBarRowPlusOne[col] = (uint8_t)(row + 1);
+                canvasBarRowPlusOne[col] = (uint8_t)(row + 1);
             }
             const float d = rF - row;
             plotCell(col, row, SYM_AH_BAR9_0 + constrain(lrintf((d + 0.5f) * 8.0f), 0, 8));
@@ -265,25 +353,39 @@ static void plotWorldLine(const vector2_t *fromCm, const vector2_t *toCm)
     }
 }
 
+static vector2_t trailPointCm(unsigned index)
+{
+    const navTrailPoint_t *pt = navTrailPointAt(index);
+    const vector2_t posCm = { .x = pt->eastM * 100.0f, .y = pt->northM * 100.0f };
+    return posCm;
+}
+
 // one continuous smoothed line from launch to the craft. Points are laid
-// down by distance flown - hovering adds nothing, the line just waits -
-// and the final segment tracks the craft so the path extends live.
-static void plotTrail(const vector2_t *craftCm, bool positionValid)
+// down by distance flown - hovering adds nothing, the line just waits. The
+// stored part is drawn into the layer incrementally, oldest first, so the
+// stroke dedup sees the same order as a full redraw; returns true once the
+// layer has caught up with the recorder.
+static bool plotStoredTrail(unsigned maxSegments)
 {
     const unsigned count = navTrailCount();
-    vector2_t prev = { .x = 0.0f, .y = 0.0f };
-    bool prevValid = false;
-    for (unsigned i = 0; i < count; i++) {
-        const navTrailPoint_t *pt = navTrailPointAt(i);
-        const vector2_t cur = { .x = pt->eastM * 100.0f, .y = pt->northM * 100.0f };
-        if (prevValid) {
-            plotWorldLine(&prev, &cur);
+    while (layers.trailPlotted < count && maxSegments > 0) {
+        if (layers.trailPlotted > 0) {
+            const vector2_t from = trailPointCm(layers.trailPlotted - 1);
+            const vector2_t to = trailPointCm(layers.trailPlotted);
+            plotWorldLine(&from, &to);
+            maxSegments--;
         }
-        prev = cur;
-        prevValid = true;
+        layers.trailPlotted++;
     }
-    if (prevValid && positionValid) {
-        plotWorldLine(&prev, craftCm);
+    return layers.trailPlotted >= count;
+}
+
+// the final segment tracks the craft so the path extends live
+static void plotTrailTail(const vector2_t *craftCm)
+{
+    if (layers.trailPlotted > 0) {
+        const vector2_t last = trailPointCm(layers.trailPlotted - 1);
+        plotWorldLine(&last, craftCm);
     }
 }
 
@@ -336,26 +438,29 @@ static void plotMarker(const vector2_t *posCm, uint8_t glyph, bool clampToEdge)
     }
 }
 
-static void drawBorderAndScale(uint32_t scaleM)
+static void drawBorder(void)
 {
     // frame with the stick-overlay box-drawing glyphs
     for (int col = 0; col < NAV_MAP_COLS; col++) {
-        frame.grid[0][col] = SYM_STICK_OVERLAY_HORIZONTAL;
-        frame.grid[NAV_MAP_ROWS - 1][col] = SYM_STICK_OVERLAY_HORIZONTAL;
+        canvas[0][col] = SYM_STICK_OVERLAY_HORIZONTAL;
+        canvas[NAV_MAP_ROWS - 1][col] = SYM_STICK_OVERLAY_HORIZONTAL;
     }
     for (int row = 1; row < NAV_MAP_ROWS - 1; row++) {
-        frame.grid[row][0] = SYM_STICK_OVERLAY_VERTICAL;
-        frame.grid[row][NAV_MAP_COLS - 1] = SYM_STICK_OVERLAY_VERTICAL;
+        canvas[row][0] = SYM_STICK_OVERLAY_VERTICAL;
+        canvas[row][NAV_MAP_COLS - 1] = SYM_STICK_OVERLAY_VERTICAL;
     }
 
     // top-border orientation cue: which way is up
     if (frame.rotated) {
-        frame.grid[0][1] = SYM_ARROW_SMALL_UP;          // nose-up
+        canvas[0][1] = SYM_ARROW_SMALL_UP;          // nose-up
     } else {
-        frame.grid[0][1] = 'N';
-        frame.grid[0][2] = SYM_ARROW_SMALL_UP;
+        canvas[0][1] = 'N';
+        canvas[0][2] = SYM_ARROW_SMALL_UP;
     }
+}
 
+static void drawScaleLabel(uint32_t scaleM)
+{
     // map width (scale) embedded in the bottom border, right aligned,
     // bracketed so it reads as "this map is this wide", not telemetry
     char valText[10];
@@ -397,7 +502,7 @@ static void drawBorderAndScale(uint32_t scaleM)
     const int start = NAV_MAP_COLS - 1 - len;
     if (start > 0) {
         for (int i = 0; i < len; i++) {
-            frame.grid[NAV_MAP_ROWS - 1][start + i] = scaleText[i];
+            canvas[NAV_MAP_ROWS - 1][start + i] = scaleText[i];
         }
     }
 }
@@ -410,40 +515,86 @@ static void drawCenteredMapText(const char *text)
         start = 1;
     }
     for (int i = 0; i < len && (start + i) < NAV_MAP_COLS - 1; i++) {
-        frame.grid[NAV_MAP_ROWS / 2][start + i] = text[i];
+        canvas[NAV_MAP_ROWS / 2][start + i] = text[i];
     }
 }
 
 // numbered markers at the plan's positional waypoints; modifier entries
 // (ALT_CHANGE, DELAY, YAW_RATE) are skipped - their lat/lon are meaningless.
 // Numbering follows the plan index so the map matches the CLI/OSD "WP n"
-// readouts. The waypoint the executor is flying to blinks.
+// readouts. Cells are resolved with the layer; the waypoint the executor is
+// flying to blinks, so the markers are stamped per frame.
+static void resolveWaypointMarkers(void)
+{
+    for (unsigned i = 0; i < waypoints.count; i++) {
+        int col, row;
+        worldToCellRounded(&waypoints.posCm[i], &col, &row);
+        const bool visible = cellInInterior(col, row);
+        layers.markerCol[i] = visible ? col : -1;
+        layers.markerRow[i] = visible ? row : -1;
+    }
+}
+
 static void plotWaypointMarkers(void)
 {
-    const uint8_t count = MIN(flightPlanConfig()->waypointCount, (uint8_t)MAX_WAYPOINTS);
     const bool navActive = flightPlanNavIsActive();
-    const uint8_t activeIndex = flightPlanNavGetCurrentIndex();
+    const uint16_t activeIndex = flightPlanNavGetCurrentIndex();
 
-    for (uint8_t i = 0; i < count && i < NAV_MAP_MARKER_MAX; i++) {
-        const waypoint_t *wp = &flightPlanConfig()->waypoints[i];
-        if (!waypointIsPositional(wp)) {
+    for (unsigned i = 0; i < waypoints.count; i++) {
+        if (layers.markerCol[i] < 0) {
             continue;
         }
-        if (navActive && i == activeIndex && ((animPhase >> 2) & 1)) {
+        if (navActive && waypoints.index[i] == activeIndex && ((animPhase >> 2) & 1)) {
             continue;   // blink the active marker
         }
-        vector2_t posCm;
-        waypointEnuCm(wp, &posCm);
-        plotMarker(&posCm, '1' + i, false);
+        plotCell(layers.markerCol[i], layers.markerRow[i], '1' + waypoints.index[i]);
     }
 }
 
+// Advance the static layers by one OSD pass worth of work; true when they
+// are complete for the current projection and can be composed.
+static bool buildLayersStep(void)
+{
+    if (layers.valid && layers.trailRevision != navTrailRevision()) {
+        layers.valid = false;   // the recorder compacted or reset the trail
+    }
+    if (!layers.valid) {
+        layers.valid = true;
+        layers.baseDrawn = false;
+        layers.trailRevision = navTrailRevision();
+        layers.trailPlotted = 0;
+    }
+
+    canvas = layers.grid;
+    canvasBarRowPlusOne = layers.trailBarRowPlusOne;
+
+    unsigned budget = NAV_MAP_TRAIL_SEGMENTS_PER_PASS;
+    if (!layers.baseDrawn) {
+        memset(layers.grid, SYM_BLANK, sizeof(layers.grid));
+        memset(layers.trailBarRowPlusOne, 0, sizeof(layers.trailBarRowPlusOne));
+        drawBorder();
+        if (layers.homeValid) {
+            // layers, lowest priority first
+            plotRangeRing(layers.scaleM);
+            resolveWaypointMarkers();
+        }
+        layers.baseDrawn = true;
+        budget /= 2;
+    }
+    const bool complete = !layers.homeValid || plotStoredTrail(budget);
+
+    canvas = frame.grid;
+    canvasBarRowPlusOne = trailBarRowPlusOne;
+    return complete;
+}
+
+// Per-frame state: craft position, projection and auto-zoom. The projection
+// is kept while the view has moved less than a quarter cell or turned less
+// than NAV_MAP_ROTATION_STEP_DEG, so the cached layers stay usable.
 static void prepareFrame(void)
 {
     const osdNavMapConfig_t *cfg = osdNavMapConfig();
 
-    memset(frame.grid, SYM_BLANK, sizeof(frame.grid));
-    memset(trailBarRowPlusOne, 0, sizeof(trailBarRowPlusOne));
     animPhase++;
 
     const bool homeValid = STATE(GPS_FIX_HOME);
@@ -457,29 +608,48 @@ static void prepareFrame(void)
     }
     const int headingDeg = wrapDeg360(DECIDEGREES_TO_DEGREES((int32_t)attitude.values.yaw));
 
+    if (homeValid) {
+        updateWaypointCache();
+    }
+
     // orientation: heading-up turns the map with the aircraft's nose, so home
     // sits at the top of the map exactly when the craft faces home
-    frame.rotated = (cfg->mode == OSD_NAV_MAP_MODE_HEADING_UP) && positionValid;
-    frame.mapRotationDeg = frame.rotated ? headingDeg : 0;
-    if (frame.rotated) {
-        const float rotRad = DEGREES_TO_RADIANS(frame.mapRotationDeg);
-        frame.sinRot = sin_approx(rotRad);
-        frame.cosRot = cos_approx(rotRad);
-    } else {
-        frame.sinRot = 0.0f;
-        frame.cosRot = 1.0f;
+    const bool rotated = (cfg->mode == OSD_NAV_MAP_MODE_HEADING_UP) && positionValid;
+    int rotationDeg = rotated ? headingDeg : 0;
+    if (layers.valid && rotated && frame.rotated) {
+        const int turnDeg = abs(((rotationDeg - frame.mapRotationDeg + 540) % 360) - 180);
+        if (turnDeg < NAV_MAP_ROTATION_STEP_DEG) {
+            rotationDeg = frame.mapRotationDeg;
+        }
+    }
+    if (!layers.valid || rotated != frame.rotated || rotationDeg != frame.mapRotationDeg) {
+        layers.valid = false;
+        frame.rotated = rotated;
+        frame.mapRotationDeg = rotationDeg;
+        if (frame.rotated) {
+            const float rotRad = DEGREES_TO_RADIANS(frame.mapRotationDeg);
+            frame.sinRot = sin_approx(rotRad);
+            frame.cosRot = cos_approx(rotRad);
+        } else {
+            frame.sinRot = 0.0f;
+            frame.cosRot = 1.0f;
+        }
     }
 
     // view centre
+    vector2_t centre = home;
     if (cfg->centre == OSD_NAV_MAP_CENTRE_CRAFT) {
-        frame.centerEastCm = craft.x;
-        frame.centerNorthCm = craft.y;
-    } else {
-        frame.centerEastCm = 0.0f;
-        frame.centerNorthCm = 0.0f;
+        centre = craft;
+    }
+    if (!layers.valid
+        || fabsf(centre.x - frame.centerEastCm) >= NAV_MAP_RECENTRE_CELLS * frame.cmPerCol
+        || fabsf(centre.y - frame.centerNorthCm) >= NAV_MAP_RECENTRE_CELLS * frame.cmPerCol) {
+        layers.valid = false;
+        frame.centerEastCm = centre.x;
+        frame.centerNorthCm = centre.y;
     }
 
-    // auto-zoom: fit the craft and every positional waypoint of the plan.
+    // auto-zoom: fit the craft and every drawn waypoint of the plan.
     // Home is deliberately NOT fitted: with home at the view centre it
     // contributes nothing, and on a craft-centred map the off-map edge arrow
     // carries the home direction so the local view can stay tight.
@@ -493,20 +663,9 @@ static void prepareFrame(void)
         maxY = fmaxf(maxY, fabsf(viewY));
     }
     if (homeValid) {
-        // only fit waypoints that actually get drawn - labels stop at
-        // NAV_MAP_MARKER_MAX ('1'..'9'), so fitting the later ones just zooms
-        // the map out for markers you never see (same bound as
-        // plotWaypointMarkers)
-        const uint8_t count = MIN(flightPlanConfig()->waypointCount, (uint8_t)MAX_WAYPOINTS);
-        for (uint8_t i = 0; i < count && i < NAV_MAP_MARKER_MAX; i++) {
-            const waypoint_t *wp = &flightPlanConfig()->waypoints[i];
-            if (!waypointIsPositional(wp)) {
-                continue;
-            }
-            vector2_t posCm;
+        for (unsigned i = 0; i < waypoints.count; i++) {
             float viewX, viewY;
-            waypointEnuCm(wp, &posCm);
-            worldToView(&posCm, &viewX, &viewY);
+            worldToView(&waypoints.posCm[i], &viewX, &viewY);
             maxX = fmaxf(maxX, fabsf(viewX));
             maxY = fmaxf(maxY, fabsf(viewY));
         }
@@ -526,25 +685,43 @@ static void prepareFrame(void)
         || (newScale < autoScaleM && requiredM < NAV_MAP_ZOOM_IN_FILL * newScale)) {
         autoScaleM = newScale;
     }
-    const uint32_t scaleM = autoScaleM;
-    frame.cmPerCol = scaleM * 100.0f / interiorCols;
+    frame.cmPerCol = autoScaleM * 100.0f / interiorCols;
     frame.cmPerRow = frame.cmPerCol * NAV_MAP_CELL_ASPECT;
 
-    drawBorderAndScale(scaleM);
+    if (autoScaleM != layers.scaleM || homeValid != layers.homeValid) {
+        layers.valid = false;
+        layers.scaleM = autoScaleM;
+        layers.homeValid = homeValid;
+    }
+
+    frameCraftCm = craft;
+    frameHeadingDeg = headingDeg;
+    frameFixValid = fixValid;
+    framePositionValid = positionValid;
+}
+
+// Copy the static layers and add what changes every frame
+static void composeFrame(void)
+{
+    memcpy(frame.grid, layers.grid, sizeof(frame.grid));
+    memcpy(trailBarRowPlusOne, layers.trailBarRowPlusOne, sizeof(trailBarRowPlusOne));
+
+    drawScaleLabel(layers.scaleM);
 
-    if (!homeValid) {
-        drawCenteredMapText(fixValid ? "SET HOME" : "WAIT GPS");
+    if (!layers.homeValid) {
+        drawCenteredMapText(frameFixValid ? "SET HOME" : "WAIT GPS");
         return;
     }
 
-    // layers, lowest priority first
-    plotRangeRing(scaleM);
-    plotTrail(&craft, positionValid);
+    if (framePositionValid) {
+        plotTrailTail(&frameCraftCm);
+    }
     plotWaypointMarkers();
 
     // home: flag when in view; when it leaves the map, a direction arrow
     // pinned to the nearest edge shows which way home lies
     {
+        const vector2_t home = { .x = 0.0f, .y = 0.0f };
         float viewX, viewY, colF, rowF;
         worldToView(&home, &viewX, &viewY);
         viewToCellF(viewX, viewY, &colF, &rowF);
@@ -562,12 +739,12 @@ static void prepareFrame(void)
     // craft marker: over-home ring when (nearly) on top of home, otherwise an
     // arrow showing the nose direction. Nose-up maps show the arrow straight
     // up by definition.
-    if (positionValid) {
-        if (vector2Norm(&craft) < fminf(frame.cmPerCol, NAV_MAP_OVER_HOME_CM)) {
-            plotMarker(&craft, SYM_OVER_HOME, true);
+    if (framePositionValid) {
+        if (vector2Norm(&frameCraftCm) < fminf(frame.cmPerCol, NAV_MAP_OVER_HOME_CM)) {
+            plotMarker(&frameCraftCm, SYM_OVER_HOME, true);
         } else {
-            const int screenHeading = frame.rotated ? 0 : headingDeg;
-            plotMarker(&craft, osdGetDirectionSymbolFromHeading(screenHeading), true);
+            const int screenHeading = frame.rotated ? 0 : frameHeadingDeg;
+            plotMarker(&frameCraftCm, osdGetDirectionSymbolFromHeading(screenHeading), true);
         }
     } else {
         drawCenteredMapText("NO GPS");
@@ -584,6 +761,9 @@ void osdNavMapResetRenderStateForTest(void)
     lastScaleShownM = 0;
     scaleFlashFrames = 0;
     scaleZoomedOut = false;
+    memset(&frame, 0, sizeof(frame));
+    memset(&layers, 0, sizeof(layers));
+    memset(&waypoints, 0, sizeof(waypoints));
 }
 
 uint32_t osdNavMapScaleMForTest(void)
@@ -602,6 +782,16 @@ void osdElementNavMap(osdElementParms_t *element)
         renderRow = 0;
     }
 
+    if (renderRow == 0) {
+        if (!buildLayersStep()) {
+            // this pass went on rasterizing the static layers
+            element->drawElement = false;
+            element->rendered = false;
+            return;
+        }
+        composeFrame();
+    }
+
     // vertical clip: rows beyond the screen are dropped
     if (element->elemPosY + renderRow >= displayPort->rows) {
         element->drawElement = false;
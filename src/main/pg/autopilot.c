@@ -28,7 +28,7 @@
 
 #include "autopilot.h"
 
-PG_REGISTER_WITH_RESET_TEMPLATE(autopilotConfig_t, autopilotConfig, PG_AUTOPILOT, 10);
+PG_REGISTER_WITH_RESET_TEMPLATE(autopilotConfig_t, autopilotConfig, PG_AUTOPILOT, 11);
 
 PG_RESET_TEMPLATE(autopilotConfig_t, autopilotConfig,
     .landingAltitudeM = 4,
@@ -70,6 +70,9 @@ PG_RESET_TEMPLATE(autopilotConfig_t, autopilotConfig,
     .navCarrotLeadTime = 12,          // 1.2 s carrot lead
     .navCarrotLeadMax = 2500,         // 25 m maximum carrot lead
     .navPreturnDist = 1500,           // 15 m pre-turn blend zone
+    .navPathMode = AP_NAV_PATH_CARROT,
+    .navLateralAccel = 300,           // 3 m/s^2 through corner fillets
+    .navJerk = 500,                   // 5 m/s^3 along-path jerk
 
     // Yaw control parameters
     .yawMode = YAW_MODE_VELOCITY,     // Default: follow velocity
@@ -50,6 +50,13 @@ typedef enum {
     AP_GEOFENCE_COUNT
 } autopilotGeofenceAction_e;
 
+// En-route leg path generation
+typedef enum {
+    AP_NAV_PATH_CARROT = 0,     // leg-line carrot, corners carved at the gate
+    AP_NAV_PATH_SMOOTH = 1,     // corner fillets flown on a precomputed, jerk-limited speed profile
+    AP_NAV_PATH_COUNT
+} autopilotNavPathMode_e;
+
 typedef struct autopilotConfig_s {
     uint8_t landingAltitudeM;   // altitude below which landing behaviours can change, metres
     uint16_t hoverThrottle;      // value used at the start of a rescue or position hold
@@ -86,6 +93,9 @@ typedef struct autopilotConfig_s {
     uint8_t  navCarrotLeadTime;       // deciseconds of travel the carrot leads the craft by (default 12 = 1.2s)
     uint16_t navCarrotLeadMax;        // cm, maximum carrot lead ahead of the craft (default 2500)
     uint16_t navPreturnDist;          // cm, approach zone over which the nose blends onto the next leg (default 1500)
+    uint8_t  navPathMode;             // autopilotNavPathMode_e (default AP_NAV_PATH_CARROT)
+    uint16_t navLateralAccel;         // cm/s^2, lateral acceleration budget through smooth-path corners (default 300)
+    uint16_t navJerk;                 // cm/s^3, along-path jerk limit of the smooth-path speed profile (default 500)
 
     // Yaw control parameters
     uint8_t yawMode;                  // autopilotYawMode_e (default YAW_MODE_VELOCITY)
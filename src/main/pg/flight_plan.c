@@ -26,15 +26,14 @@
 
 #include "pg/flight_plan.h"
 
-#include "pg/flight_plan.h"
-
 #if ENABLE_FLIGHT_PLAN
 
-PG_REGISTER_WITH_RESET_TEMPLATE(flightPlanConfig_t, flightPlanConfig, PG_FLIGHT_PLAN_CONFIG, 1);
+PG_REGISTER_WITH_RESET_TEMPLATE(flightPlanConfig_t, flightPlanConfig, PG_FLIGHT_PLAN_CONFIG, 2);
 
 PG_RESET_TEMPLATE(flightPlanConfig_t, flightPlanConfig,
     .waypointCount = 0,
-    .waypoints = { { 0 } }
+    .waypoints = { { 0 } },
+    .missionStorage = MISSION_STORAGE_PG,
 );
 
 #endif // ENABLE_FLIGHT_PLAN
@@ -63,9 +63,16 @@ typedef struct {
     uint8_t pattern;        // waypointPattern_e (for hold type)
 } waypoint_t;
 
+typedef enum {
+    MISSION_STORAGE_PG = 0,         // waypoints above, at most MAX_WAYPOINTS
+    MISSION_STORAGE_FLASH,          // flash mission partition (flight/mission_store.h)
+    MISSION_STORAGE_COUNT
+} missionStorage_e;
+
 typedef struct {
     uint8_t waypointCount;
     waypoint_t waypoints[MAX_WAYPOINTS];
+    uint8_t missionStorage;         // missionStorage_e, where uploaded missions are stored and flown from
 } flightPlanConfig_t;
 
 PG_DECLARE(flightPlanConfig_t, flightPlanConfig);
@@ -0,0 +1,39 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform.h"
+
+#include "pg/pg.h"
+#include "pg/pg_ids.h"
+
+#include "pg/geofence.h"
+
+#if ENABLE_FLIGHT_PLAN
+
+PG_REGISTER_WITH_RESET_TEMPLATE(geofenceConfig_t, geofenceConfig, PG_GEOFENCE_CONFIG, 0);
+
+PG_RESET_TEMPLATE(geofenceConfig_t, geofenceConfig,
+    .itemCount = 0,
+    .items = { { 0 } },
+    .lookaheadDs = 30,
+);
+
+#endif // ENABLE_FLIGHT_PLAN
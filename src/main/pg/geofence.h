@@ -0,0 +1,55 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "pg/pg.h"
+
+// Up to 32 items so polygon edges fit the uint32_t edge masks of the fence index.
+#define MAX_GEOFENCE_ITEMS 32
+
+// Mirrors the MAVLink fence items (MAV_CMD_NAV_FENCE_*). Polygon vertices are
+// consecutive items of the same type, each carrying the vertex count of its polygon.
+typedef enum {
+    GEOFENCE_POLYGON_INCLUSION = 0,     // stay inside
+    GEOFENCE_POLYGON_EXCLUSION,         // stay outside
+    GEOFENCE_CIRCLE_INCLUSION,
+    GEOFENCE_CIRCLE_EXCLUSION,
+    GEOFENCE_RETURN_POINT,              // stored for the GCS, not enforced
+    GEOFENCE_ITEM_TYPE_COUNT
+} geofenceItemType_e;
+
+typedef struct {
+    int32_t latitude;       // degrees * 10^7
+    int32_t longitude;      // degrees * 10^7
+    uint16_t param;         // polygon: vertex count of the polygon, circle: radius in metres
+    uint8_t type;           // geofenceItemType_e
+} geofenceItem_t;
+
+typedef struct {
+    uint8_t itemCount;
+    geofenceItem_t items[MAX_GEOFENCE_ITEMS];
+    uint8_t lookaheadDs;    // breach is predicted this far ahead along the current velocity, deciseconds
+} geofenceConfig_t;
+
+PG_DECLARE(geofenceConfig_t, geofenceConfig);
@@ -0,0 +1,41 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform.h"
+
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+
+#include "io/serial.h"
+
+#include "pg/pg.h"
+#include "pg/pg_ids.h"
+
+#include "pg/mavlink_offboard.h"
+
+PG_REGISTER_WITH_RESET_TEMPLATE(mavlinkOffboardConfig_t, mavlinkOffboardConfig, PG_MAVLINK_OFFBOARD_CONFIG, 0);
+
+PG_RESET_TEMPLATE(mavlinkOffboardConfig_t, mavlinkOffboardConfig,
+    .offboard_uart = SERIAL_PORT_NONE,
+    .offboard_attitude_rate_hz = 200,
+    .offboard_position_rate_hz = 100,
+);
+
+#endif // ENABLE_TELEMETRY_MAVLINK_OFFBOARD
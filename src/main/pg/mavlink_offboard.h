@@ -0,0 +1,34 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "pg/pg.h"
+
+typedef struct mavlinkOffboardConfig_s {
+    int8_t offboard_uart;               // serialPortIdentifier_e; SERIAL_PORT_NONE = unassigned
+    uint8_t offboard_attitude_rate_hz;  // ATTITUDE_QUATERNION and HIGHRES_IMU
+    uint8_t offboard_position_rate_hz;  // LOCAL_POSITION_NED and ODOMETRY, capped at the position estimator rate
+} mavlinkOffboardConfig_t;
+
+PG_DECLARE(mavlinkOffboardConfig_t, mavlinkOffboardConfig);
@@ -72,6 +72,11 @@ STATIC_UNIT_TESTED uint32_t crsfChannelData[CRSF_MAX_CHANNEL];
 
 static serialPort_t *serialPort;
 static timeUs_t crsfFrameStartAtUs = 0;
+static timeUs_t crsfRcFrameDoneAtUs = 0;
+static uint8_t crsfFramePosition = 0;
+#if defined(USE_CRSF_V3)
+static uint8_t crsfFrameErrorCnt = 0;
+#endif
 static uint8_t telemetryBuf[CRSF_FRAME_SIZE_MAX];
 static uint8_t telemetryBufLen = 0;
 static float channelScale = CRSF_RC_CHANNEL_SCALE_LEGACY;
@@ -331,47 +336,27 @@ static void crsfCheckRssi(uint32_t currentTimeUs)
 STATIC_UNIT_TESTED uint8_t crsfFrameCRC(void)
 {
     // CRC includes type and payload
-    uint8_t crc = crc8_dvb_s2(0, crsfFrame.frame.type);
-    for (int ii = 0; ii < crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC; ++ii) {
-        crc = crc8_dvb_s2(crc, crsfFrame.frame.payload[ii]);
-    }
-    return crc;
+    const int length = MAX(crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_CRC, CRSF_FRAME_LENGTH_TYPE);
+    return crc8_dvb_s2_update(0, &crsfFrame.frame.type, length);
 }
 
 #if defined(USE_CRSF_V3) || defined(UNIT_TEST)
 STATIC_UNIT_TESTED uint8_t crsfFrameCmdCRC(void)
 {
     // CRC includes type and payload
-    uint8_t crc = crc8_poly_0xba(0, crsfFrame.frame.type);
-    for (int ii = 0; ii < crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC - 1; ++ii) {
-        crc = crc8_poly_0xba(crc, crsfFrame.frame.payload[ii]);
-    }
-    return crc;
+    const int length = MAX(crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_CRC - 1, CRSF_FRAME_LENGTH_TYPE);
+    return crc8_poly_0xba_update(0, &crsfFrame.frame.type, length);
 }
 #endif
 
-static bool crsfFrameLengthIsValid(void)
+static bool crsfFrameLengthIsValid(uint8_t frameLength)
 {
-    const uint8_t frameLength = crsfFrame.frame.frameLength;
     return frameLength >= CRSF_FRAME_LENGTH_TYPE_CRC &&
         frameLength <= CRSF_FRAME_SIZE_MAX - CRSF_FRAME_LENGTH_ADDRESS - CRSF_FRAME_LENGTH_FRAMELENGTH;
 }
 
-// Receive ISR callback, called back from serial port
-STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c, void *data)
+static void crsfCheckFrameTimeout(timeUs_t currentTimeUs)
 {
-    rxRuntimeState_t *const rxRuntimeState = (rxRuntimeState_t *const)data;
-
-    static uint8_t crsfFramePosition = 0;
-#if defined(USE_CRSF_V3)
-    static uint8_t crsfFrameErrorCnt = 0;
-#endif
-    const timeUs_t currentTimeUs = microsISR();
-
-#ifdef DEBUG_CRSF_PACKETS
-    debug[2] = currentTimeUs - crsfFrameStartAtUs;
-#endif
-
     if (cmpTimeUs(currentTimeUs, crsfFrameStartAtUs) > frameTimeNeededUs) {
         // We've received a character after max time needed to complete a frame,
         // so this must be the start of a new frame.
@@ -383,6 +368,120 @@ STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c, void *data)
 #endif
         crsfFramePosition = 0;
     }
+}
+
+// Handle a complete frame of fullFrameLength bytes sitting in crsfFrame
+static void crsfProcessFrame(rxRuntimeState_t *rxRuntimeState, int fullFrameLength, timeUs_t currentTimeUs)
+{
+    const uint8_t crc = crsfFrameCRC();
+    if (crc == crsfFrame.bytes[fullFrameLength - 1]) {
+#if defined(USE_CRSF_V3)
+        crsfFrameErrorCnt = 0;
+#endif
+#if defined(USE_CRSF_V3) && defined(USE_TELEMETRY_CRSF)
+        crsfScheduleTelemetryResponse();
+#endif
+        switch (crsfFrame.frame.type) {
+        case CRSF_FRAMETYPE_RC_CHANNELS_PACKED:
+        case CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED:
+            if (crsfFrame.frame.deviceAddress == CRSF_ADDRESS_FLIGHT_CONTROLLER) {
+                rxRuntimeState->lastRcFrameTimeUs = currentTimeUs;
+                // IMPORTANT: Copy frame data BEFORE setting flag to avoid race condition
+                // where crsfFrameStatus() could see flag=true but read stale data
+                memcpy(&crsfChannelDataFrame, &crsfFrame, sizeof(crsfFrame));
+                crsfRcFrameDoneAtUs = currentTimeUs;
+                crsfFrameDone = true;
+            }
+            break;
+
+#if defined(USE_TELEMETRY_CRSF) && defined(USE_MSP_OVER_TELEMETRY)
+        case CRSF_FRAMETYPE_MSP_REQ:
+        case CRSF_FRAMETYPE_MSP_WRITE: {
+            if (crsfFrame.frame.frameLength >= 4) {
+                uint8_t *frameStart = (uint8_t *)&crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE;
+                if (bufferCrsfMspFrame(frameStart, crsfFrame.frame.frameLength - 4)) {
+                    crsfScheduleMspResponse(crsfFrame.frame.payload[1]);
+                }
+            }
+            break;
+        }
+#endif
+#if defined(USE_CRSF_CMS_TELEMETRY)
+        case CRSF_FRAMETYPE_DEVICE_PING:
+            crsfScheduleDeviceInfoResponse();
+            break;
+        case CRSF_FRAMETYPE_DEVICE_INFO:
+            crsfHandleDeviceInfoResponse(crsfFrame.frame.payload);
+            break;
+        case CRSF_FRAMETYPE_DISPLAYPORT_CMD: {
+            uint8_t *frameStart = (uint8_t *)&crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE;
+            crsfProcessDisplayPortCmd(frameStart);
+            break;
+        }
+#endif
+#if defined(USE_CRSF_LINK_STATISTICS)
+
+        case CRSF_FRAMETYPE_LINK_STATISTICS: {
+            // if to FC and 10 bytes + CRSF_FRAME_ORIGIN_DEST_SIZE
+            if ((rssiSource == RSSI_SOURCE_RX_PROTOCOL_CRSF) &&
+                (crsfFrame.frame.deviceAddress == CRSF_ADDRESS_FLIGHT_CONTROLLER) &&
+                (crsfFrame.frame.frameLength == CRSF_FRAME_ORIGIN_DEST_SIZE + CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE)) {
+                const crsfLinkStatistics_t* statsFrame = (const crsfLinkStatistics_t*)&crsfFrame.frame.payload;
+                handleCrsfLinkStatisticsFrame(statsFrame, currentTimeUs);
+            }
+            break;
+        }
+#if defined(USE_CRSF_V3)
+        case CRSF_FRAMETYPE_LINK_STATISTICS_RX: {
+            break;
+        }
+        case CRSF_FRAMETYPE_LINK_STATISTICS_TX: {
+            if ((rssiSource == RSSI_SOURCE_RX_PROTOCOL_CRSF) &&
+                (crsfFrame.frame.deviceAddress == CRSF_ADDRESS_FLIGHT_CONTROLLER) &&
+                (crsfFrame.frame.frameLength == CRSF_FRAME_ORIGIN_DEST_SIZE + CRSF_FRAME_LINK_STATISTICS_TX_PAYLOAD_SIZE)) {
+                const crsfLinkStatisticsTx_t* statsFrame = (const crsfLinkStatisticsTx_t*)&crsfFrame.frame.payload;
+                handleCrsfLinkStatisticsTxFrame(statsFrame, currentTimeUs);
+            }
+            break;
+        }
+#endif
+#endif
+#if defined(USE_CRSF_V3)
+        case CRSF_FRAMETYPE_COMMAND:
+            if ((crsfFrame.bytes[fullFrameLength - 2] == crsfFrameCmdCRC()) &&
+                (crsfFrame.bytes[3] == CRSF_ADDRESS_FLIGHT_CONTROLLER)) {
+                crsfProcessCommand(crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE);
+            }
+            break;
+#endif
+        default:
+            break;
+        }
+    } else {
+#if defined(USE_CRSF_V3)
+        if (crsfFrameErrorCnt < CRSF_FRAME_ERROR_COUNT_THRESHOLD)
+            crsfFrameErrorCnt++;
+#endif
+    }
+}
+
+static void crsfCheckBaudFallback(void)
+{
+#if defined(USE_CRSF_V3)
+    if (crsfBaudNegotiationInProgress() || isEepromWriteInProgress()) {
+        // don't count errors when negotiation or eeprom write is in progress
+        crsfFrameErrorCnt = 0;
+    } else if (crsfFrameErrorCnt >= CRSF_FRAME_ERROR_COUNT_THRESHOLD) {
+        // fall back to default speed if speed mismatch detected
+        setCrsfDefaultSpeed();
+        crsfFrameErrorCnt = 0;
+    }
+#endif
+}
+
+static void crsfReceiveByte(uint8_t c, rxRuntimeState_t *rxRuntimeState, timeUs_t currentTimeUs)
+{
+    crsfCheckFrameTimeout(currentTimeUs);
 
     if (crsfFramePosition == 0) {
         crsfFrameStartAtUs = currentTimeUs;
@@ -391,7 +490,7 @@ STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c, void *data)
     // full frame length includes the length of the address and framelength fields
     // sometimes we can receive some garbage data. So, we need to check max size for preventing buffer overrun.
     if (crsfFramePosition == CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH &&
-        !crsfFrameLengthIsValid()) {
+        !crsfFrameLengthIsValid(crsfFrame.frame.frameLength)) {
         // Invalid declared lengths are protocol violations, not evidence of a negotiated-baud mismatch.
         // Drop them without contributing to the CRSFv3 baud fallback error counter.
         crsfFramePosition = 0;
@@ -401,109 +500,54 @@ STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c, void *data)
         crsfFrame.frame.frameLength + CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH;
 
     if (crsfFramePosition < fullFrameLength) {
-        crsfFrame.bytes[crsfFramePosition++] = (uint8_t)c;
+        crsfFrame.bytes[crsfFramePosition++] = c;
         if (crsfFramePosition >= fullFrameLength) {
             crsfFramePosition = 0;
-            const uint8_t crc = crsfFrameCRC();
-            if (crc == crsfFrame.bytes[fullFrameLength - 1]) {
-#if defined(USE_CRSF_V3)
-                crsfFrameErrorCnt = 0;
-#endif
-#if defined(USE_CRSF_V3) && defined(USE_TELEMETRY_CRSF)
-                crsfScheduleTelemetryResponse();
-#endif
-                switch (crsfFrame.frame.type) {
-                case CRSF_FRAMETYPE_RC_CHANNELS_PACKED:
-                case CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED:
-                    if (crsfFrame.frame.deviceAddress == CRSF_ADDRESS_FLIGHT_CONTROLLER) {
-                        rxRuntimeState->lastRcFrameTimeUs = currentTimeUs;
-                        // IMPORTANT: Copy frame data BEFORE setting flag to avoid race condition
-                        // where crsfFrameStatus() could see flag=true but read stale data
-                        memcpy(&crsfChannelDataFrame, &crsfFrame, sizeof(crsfFrame));
-                        crsfFrameDone = true;
-                    }
-                    break;
+            crsfProcessFrame(rxRuntimeState, fullFrameLength, currentTimeUs);
+        }
+        crsfCheckBaudFallback();
+    }
+}
 
-#if defined(USE_TELEMETRY_CRSF) && defined(USE_MSP_OVER_TELEMETRY)
-                case CRSF_FRAMETYPE_MSP_REQ:
-                case CRSF_FRAMETYPE_MSP_WRITE: {
-                    if (crsfFrame.frame.frameLength >= 4) {
-                        uint8_t *frameStart = (uint8_t *)&crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE;
-                        if (bufferCrsfMspFrame(frameStart, crsfFrame.frame.frameLength - 4)) {
-                            crsfScheduleMspResponse(crsfFrame.frame.payload[1]);
-                        }
-                    }
-                    break;
-                }
-#endif
-#if defined(USE_CRSF_CMS_TELEMETRY)
-                case CRSF_FRAMETYPE_DEVICE_PING:
-                    crsfScheduleDeviceInfoResponse();
-                    break;
-                case CRSF_FRAMETYPE_DEVICE_INFO:
-                    crsfHandleDeviceInfoResponse(crsfFrame.frame.payload);
-                    break;
-                case CRSF_FRAMETYPE_DISPLAYPORT_CMD: {
-                    uint8_t *frameStart = (uint8_t *)&crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE;
-                    crsfProcessDisplayPortCmd(frameStart);
-                    break;
-                }
-#endif
-#if defined(USE_CRSF_LINK_STATISTICS)
+// Receive ISR callback, called back from serial port
+STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c, void *data)
+{
+    rxRuntimeState_t *const rxRuntimeState = (rxRuntimeState_t *const)data;
+    const timeUs_t currentTimeUs = microsISR();
 
-                case CRSF_FRAMETYPE_LINK_STATISTICS: {
-                    // if to FC and 10 bytes + CRSF_FRAME_ORIGIN_DEST_SIZE
-                    if ((rssiSource == RSSI_SOURCE_RX_PROTOCOL_CRSF) &&
-                        (crsfFrame.frame.deviceAddress == CRSF_ADDRESS_FLIGHT_CONTROLLER) &&
-                        (crsfFrame.frame.frameLength == CRSF_FRAME_ORIGIN_DEST_SIZE + CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE)) {
-                        const crsfLinkStatistics_t* statsFrame = (const crsfLinkStatistics_t*)&crsfFrame.frame.payload;
-                        handleCrsfLinkStatisticsFrame(statsFrame, currentTimeUs);
-                    }
-                    break;
-                }
-#if defined(USE_CRSF_V3)
-                case CRSF_FRAMETYPE_LINK_STATISTICS_RX: {
-                    break;
-                }
-                case CRSF_FRAMETYPE_LINK_STATISTICS_TX: {
-                    if ((rssiSource == RSSI_SOURCE_RX_PROTOCOL_CRSF) &&
-                        (crsfFrame.frame.deviceAddress == CRSF_ADDRESS_FLIGHT_CONTROLLER) &&
-                        (crsfFrame.frame.frameLength == CRSF_FRAME_ORIGIN_DEST_SIZE + CRSF_FRAME_LINK_STATISTICS_TX_PAYLOAD_SIZE)) {
-                        const crsfLinkStatisticsTx_t* statsFrame = (const crsfLinkStatisticsTx_t*)&crsfFrame.frame.payload;
-                        handleCrsfLinkStatisticsTxFrame(statsFrame, currentTimeUs);
-                    }
-                    break;
-                }
-#endif
-#endif
-#if defined(USE_CRSF_V3)
-                case CRSF_FRAMETYPE_COMMAND:
-                    if ((crsfFrame.bytes[fullFrameLength - 2] == crsfFrameCmdCRC()) &&
-                        (crsfFrame.bytes[3] == CRSF_ADDRESS_FLIGHT_CONTROLLER)) {
-                        crsfProcessCommand(crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE);
-                    }
-                    break;
-#endif
-                default:
-                    break;
-                }
-            } else {
-#if defined(USE_CRSF_V3)
-                if (crsfFrameErrorCnt < CRSF_FRAME_ERROR_COUNT_THRESHOLD)
-                    crsfFrameErrorCnt++;
+#ifdef DEBUG_CRSF_PACKETS
+    debug[2] = currentTimeUs - crsfFrameStartAtUs;
 #endif
+
+    crsfReceiveByte((uint8_t)c, rxRuntimeState, currentTimeUs);
+}
+
+// Receive ISR callback for DMA driven ports, called back on UART idle line with everything received since the last idle.
+// Whole frames at the head of the block are copied and checked in one pass; partial frames fall back to the byte parser.
+STATIC_UNIT_TESTED void crsfDataReceiveFrame(const uint8_t *data, uint16_t len, void *callbackData)
+{
+    rxRuntimeState_t *const rxRuntimeState = (rxRuntimeState_t *const)callbackData;
+    const timeUs_t currentTimeUs = microsISR();
+
+    while (len > 0) {
+        crsfCheckFrameTimeout(currentTimeUs);
+
+        if (crsfFramePosition == 0 && len >= CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH) {
+            const uint8_t frameLength = data[1];
+            const int fullFrameLength = frameLength + CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH;
+            if (crsfFrameLengthIsValid(frameLength) && len >= fullFrameLength) {
+                crsfFrameStartAtUs = currentTimeUs;
+                memcpy(crsfFrame.bytes, data, fullFrameLength);
+                crsfProcessFrame(rxRuntimeState, fullFrameLength, currentTimeUs);
+                crsfCheckBaudFallback();
+                data += fullFrameLength;
+                len -= fullFrameLength;
+                continue;
             }
         }
-#if defined(USE_CRSF_V3)
-        if (crsfBaudNegotiationInProgress() || isEepromWriteInProgress()) {
-            // don't count errors when negotiation or eeprom write is in progress
-            crsfFrameErrorCnt = 0;
-        } else if (crsfFrameErrorCnt >= CRSF_FRAME_ERROR_COUNT_THRESHOLD) {
-            // fall back to default speed if speed mismatch detected
-            setCrsfDefaultSpeed();
-            crsfFrameErrorCnt = 0;
-        }
-#endif
+
+        crsfReceiveByte(*data++, rxRuntimeState, currentTimeUs);
+        len--;
     }
 }
 
@@ -517,6 +561,9 @@ STATIC_UNIT_TESTED uint8_t crsfFrameStatus(rxRuntimeState_t *rxRuntimeState)
     if (crsfFrameDone) {
         crsfFrameDone = false;
 
+        // time from the end of the RC frame on the wire to the RX task picking it up
+        DEBUG_SET(DEBUG_SERIAL_RX_DMA, 3, MIN(cmpTimeUs(micros(), crsfRcFrameDoneAtUs), INT16_MAX));
+
         // unpack the RC channels
         if (crsfChannelDataFrame.frame.type == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
             // use ordinary RC frame structure (0x16)
@@ -686,6 +733,11 @@ bool crsfRxInit(const rxConfig_t *rxConfig, rxRuntimeState_t *rxRuntimeState)
         CRSF_PORT_OPTIONS | (rxConfig->serialrx_inverted ? SERIAL_INVERTED : 0)
         );
 
+    if (serialPort) {
+        // only used when the port runs RX DMA, otherwise crsfDataReceive() gets each byte
+        serialPort->rxFrameCallback = crsfDataReceiveFrame;
+    }
+
     if (rssiSource == RSSI_SOURCE_NONE) {
         rssiSource = RSSI_SOURCE_RX_PROTOCOL_CRSF;
     }
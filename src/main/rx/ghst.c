@@ -138,11 +138,8 @@ uint8_t ghstRxGetTelemetryBufLen(void)
 STATIC_UNIT_TESTED uint8_t ghstFrameCRC(const ghstFrame_t *const pGhstFrame)
 {
     // CRC includes type and payload
-    uint8_t crc = crc8_dvb_s2(0, pGhstFrame->frame.type);
-    for (int i = 0; i < pGhstFrame->frame.len - GHST_FRAME_LENGTH_TYPE - GHST_FRAME_LENGTH_CRC; ++i) {
-        crc = crc8_dvb_s2(crc, pGhstFrame->frame.payload[i]);
-    }
-    return crc;
+    const int length = MAX(pGhstFrame->frame.len - GHST_FRAME_LENGTH_CRC, GHST_FRAME_LENGTH_TYPE);
+    return crc8_dvb_s2_update(0, &pGhstFrame->frame.type, length);
 }
 
 static void rxSwapFrameBuffers(void)
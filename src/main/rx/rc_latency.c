@@ -0,0 +1,133 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_RC_LATENCY_STATS
+
+#include "build/debug.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "fc/rc.h"
+
+#include "rx/rx.h"
+
+#include "rx/rc_latency.h"
+
+static rcLatencyStats_t latencyStats[RC_LATENCY_STAGE_COUNT];
+
+static const char * const stageNames[RC_LATENCY_STAGE_COUNT] = {
+    "RX_PARSE", "SCHED_WAIT", "SMOOTHING", "MOTOR_OUT", "TOTAL"
+};
+
+// the frame most recently seen by rxFrameCheck()
+static timeUs_t frameDetectedAtUs;
+// the frame timestamp carried with rcData, between processRcCommand() and the next motor write
+static timeUs_t consumedFrameTimeUs;
+static timeUs_t consumedAtUs;
+static bool motorWritePending;
+
+static void rcLatencyAddSample(rcLatencyStage_e stage, timeDelta_t latencyUs)
+{
+    rcLatencyStats_t *stats = &latencyStats[stage];
+    const uint32_t sampleUs = MAX(latencyUs, 0);
+
+    const unsigned bucket = sampleUs < RC_LATENCY_BUCKET_BASE_US ? 0 : llog2(sampleUs / RC_LATENCY_BUCKET_BASE_US) + 1;
+    stats->bucket[MIN(bucket, RC_LATENCY_BUCKET_COUNT - 1U)]++;
+
+    if (stats->count == 0 || sampleUs < stats->minUs) {
+        stats->minUs = sampleUs;
+    }
+    stats->maxUs = MAX(stats->maxUs, sampleUs);
+    stats->lastUs = sampleUs;
+    stats->sumUs += sampleUs;
+    stats->count++;
+
+    DEBUG_SET(DEBUG_RC_LATENCY, stage, MIN(sampleUs, (uint32_t)INT16_MAX));
+}
+
+void rcLatencyFrameReceived(timeUs_t frameTimeUs, timeUs_t detectedTimeUs)
+{
+    rcLatencyAddSample(RC_LATENCY_RX_PARSE, cmpTimeUs(detectedTimeUs, frameTimeUs));
+    frameDetectedAtUs = detectedTimeUs;
+}
+
+void rcLatencyRcDataConsumed(timeUs_t currentTimeUs)
+{
+    const timeUs_t frameTimeUs = rxFrameTimeUs();
+
+    if (frameTimeUs == 0 || frameTimeUs == consumedFrameTimeUs) {
+        // rcData was refreshed without a new frame, e.g. on signal loss
+        return;
+    }
+
+    rcLatencyAddSample(RC_LATENCY_SCHEDULER_WAIT, cmpTimeUs(currentTimeUs, frameDetectedAtUs));
+    consumedFrameTimeUs = frameTimeUs;
+    consumedAtUs = currentTimeUs;
+    motorWritePending = true;
+}
+
+void rcLatencyMotorsWritten(timeUs_t currentTimeUs)
+{
+    if (!motorWritePending) {
+        return;
+    }
+    motorWritePending = false;
+
+#ifdef USE_RC_SMOOTHING_FILTER
+    const timeDelta_t smoothingDelayUs = rcSmoothingGetSetpointDelayUs();
+#else
+    const timeDelta_t smoothingDelayUs = 0;
+#endif
+
+    rcLatencyAddSample(RC_LATENCY_MOTOR_OUTPUT, cmpTimeUs(currentTimeUs, consumedAtUs));
+    rcLatencyAddSample(RC_LATENCY_SMOOTHING, smoothingDelayUs);
+    rcLatencyAddSample(RC_LATENCY_TOTAL, cmpTimeUs(currentTimeUs, consumedFrameTimeUs) + smoothingDelayUs);
+}
+
+void rcLatencyReset(void)
+{
+    memset(latencyStats, 0, sizeof(latencyStats));
+}
+
+const rcLatencyStats_t *rcLatencyGetStats(rcLatencyStage_e stage)
+{
+    return &latencyStats[stage];
+}
+
+uint32_t rcLatencyGetAverageUs(rcLatencyStage_e stage)
+{
+    const rcLatencyStats_t *stats = &latencyStats[stage];
+    return stats->count ? stats->sumUs / stats->count : 0;
+}
+
+const char *rcLatencyGetStageName(rcLatencyStage_e stage)
+{
+    return stageNames[stage];
+}
+
+#endif // USE_RC_LATENCY_STATS
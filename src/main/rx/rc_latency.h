@@ -0,0 +1,62 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "common/time.h"
+
+// Stick-to-motor latency, split into the stages an RC frame passes through
+typedef enum {
+    RC_LATENCY_RX_PARSE = 0,    // driver frame timestamp to frame detected by rxFrameCheck()
+    RC_LATENCY_SCHEDULER_WAIT,  // frame detected to rcData consumed by processRcCommand()
+    RC_LATENCY_SMOOTHING,       // group delay of the active setpoint smoothing filter
+    RC_LATENCY_MOTOR_OUTPUT,    // processRcCommand() to writeMotors() done
+    RC_LATENCY_TOTAL,           // frame timestamp to motor write, plus smoothing delay
+    RC_LATENCY_STAGE_COUNT
+} rcLatencyStage_e;
+
+// bucket n counts samples below (RC_LATENCY_BUCKET_BASE_US << n), the last bucket everything above
+#define RC_LATENCY_BUCKET_BASE_US   64
+#define RC_LATENCY_BUCKET_COUNT     12
+
+typedef struct rcLatencyStats_s {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t lastUs;
+    uint64_t sumUs;
+    uint32_t bucket[RC_LATENCY_BUCKET_COUNT];
+} rcLatencyStats_t;
+
+#ifdef USE_RC_LATENCY_STATS
+
+void rcLatencyFrameReceived(timeUs_t frameTimeUs, timeUs_t detectedTimeUs);
+void rcLatencyRcDataConsumed(timeUs_t currentTimeUs);
+void rcLatencyMotorsWritten(timeUs_t currentTimeUs);
+
+void rcLatencyReset(void);
+const rcLatencyStats_t *rcLatencyGetStats(rcLatencyStage_e stage);
+uint32_t rcLatencyGetAverageUs(rcLatencyStage_e stage);
+const char *rcLatencyGetStageName(rcLatencyStage_e stage);
+
+#endif // USE_RC_LATENCY_STATS
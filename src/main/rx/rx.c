@@ -56,6 +56,7 @@
 
 #include "rx/rx.h"
 #include "rx/pwm.h"
+#include "rx/rc_latency.h"
 #include "rx/fport.h"
 #include "rx/sbus.h"
 #include "rx/spektrum.h"
@@ -114,6 +115,8 @@ rssiSource_e rssiSource;
 linkQualitySource_e linkQualitySource;
 
 static bool rxDataProcessingRequired = false;
+static timeUs_t rxFrameReceivedUs = 0;     // timestamp of the newest complete frame
+static timeUs_t rcDataFrameTimeUs = 0;     // timestamp of the frame the current rcData was taken from
 static bool auxiliaryProcessingRequired = false;
 
 static bool rxSignalReceived = false;
@@ -198,6 +201,7 @@ static bool nullProcessFrame(const rxRuntimeState_t *rxRuntimeState)
 static volatile uint16_t udpChannelData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
 static volatile uint8_t udpChannelCount = 0;
 static volatile bool udpFrameReceived = false;
+static volatile timeUs_t udpFrameTimeUs = 0;
 
 static float readRCUdp(const rxRuntimeState_t *rxRuntimeState, uint8_t channel)
 {
@@ -214,6 +218,7 @@ static uint8_t frameStatusUdp(rxRuntimeState_t *state)
         const uint8_t count = udpChannelCount;
         state->channelCount = count;
         rxChannelCount = MIN(rxConfig()->max_aux_channel + NON_AUX_CHANNEL_COUNT, count);
+        state->lastRcFrameTimeUs = udpFrameTimeUs;
         udpFrameReceived = false;
         return RX_FRAME_COMPLETE;
     }
@@ -227,6 +232,7 @@ void rxUpdateUdpChannels(const uint16_t *channels, uint8_t channelCount)
         udpChannelData[i] = channels[i];
     }
     udpChannelCount = count;
+    udpFrameTimeUs = micros();
     udpFrameReceived = true;
 }
 #endif
@@ -619,6 +625,11 @@ FAST_CODE_NOINLINE void rxFrameCheck(timeUs_t currentTimeUs, timeDelta_t current
         if (useDataDrivenProcessing) {
             rxDataProcessingRequired = true;
             //  process the new Rx packet when it arrives
+            // use driver rx time if available, current time otherwise
+            rxFrameReceivedUs = rxRuntimeState.lastRcFrameTimeUs ? rxRuntimeState.lastRcFrameTimeUs : currentTimeUs;
+#ifdef USE_RC_LATENCY_STATS
+            rcLatencyFrameReceived(rxFrameReceivedUs, currentTimeUs);
+#endif
         }
     } else {
         //  watch for next packet
@@ -855,12 +866,18 @@ bool calculateRxChannelsAndUpdateFailsafe(timeUs_t currentTimeUs)
 
     readRxChannelsApplyRanges();            // returns rcRaw
     detectAndApplySignalLossBehaviour();    // returns rcData
+    rcDataFrameTimeUs = rxSignalReceived ? rxFrameReceivedUs : 0;
 
     rcSampleIndex++;
 
     return true;
 }
 
+timeUs_t rxFrameTimeUs(void)
+{
+    return rcDataFrameTimeUs;
+}
+
 void parseRcChannels(const char *input, rxConfig_t *rxConfig)
 {
     for (const char *c = input; *c; c++) {
@@ -209,6 +209,9 @@ typedef enum {
 #if ENABLE_DRONECAN
     TASK_DRONECAN,
 #endif
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+    TASK_MAVLINK_OFFBOARD,
+#endif
 
     /* Count of real tasks */
     TASK_COUNT,
@@ -889,6 +889,13 @@ extern struct linker_symbol __fontdata_end;
 #define ENABLE_FLIGHT_PLAN 0
 #endif
 
+// Flight-plan missions beyond MAX_WAYPOINTS, stored in a dedicated flash
+// partition and paged into RAM by the executor (mission_storage = FLASH).
+// Opt-in per target: the partition is taken from the blackbox flash.
+#if defined(USE_MISSION_STORE) && (!ENABLE_FLIGHT_PLAN || defined(USE_WING) || !defined(USE_FLASH_CHIP))
+#undef USE_MISSION_STORE
+#endif
+
 // GPS rescue (both the BOXGPSRESCUE switch and the failsafe procedure) flown as
 // a synthesised flight-plan mission through the unified autopilot, instead of
 // the legacy gps_rescue controller. Default-on wherever the flight-plan engine
@@ -928,6 +935,17 @@ extern struct linker_symbol __fontdata_end;
 #endif
 #endif
 
+// Companion-computer offboard link: high-rate state streams and position
+// setpoint ingestion on a dedicated port. The setpoints drive the flight-plan
+// executor, so it takes the mission module's shape.
+#if !defined(ENABLE_TELEMETRY_MAVLINK_OFFBOARD)
+#if defined(USE_TELEMETRY_MAVLINK) && ENABLE_FLIGHT_PLAN && !defined(USE_WING)
+#define ENABLE_TELEMETRY_MAVLINK_OFFBOARD 1
+#else
+#define ENABLE_TELEMETRY_MAVLINK_OFFBOARD 0
+#endif
+#endif
+
 // MAVLink inbound COMMAND_LONG / COMMAND_INT actuation (arm/disarm, mode set,
 // RTL, set-home, reboot). Defaults on wherever MAVLink telemetry is built in.
 #if !defined(ENABLE_TELEMETRY_MAVLINK_COMMANDS)
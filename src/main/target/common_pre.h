@@ -287,6 +287,7 @@
 #define USE_ESCSERIAL_SIMONK
 #define USE_ALTITUDE_HOLD
 #define USE_POSITION_HOLD
+#define USE_POSITION_EKF
 
 #if !defined(USE_GPS)
 #define USE_GPS
@@ -416,6 +417,7 @@
 #define USE_RX_LINK_QUALITY_INFO
 #define USE_RX_MSP_OVERRIDE
 #define USE_RX_LINK_UPLINK_POWER
+#define USE_RC_LATENCY_STATS
 
 #define USE_GYRO_DLPF_EXPERIMENTAL
 #define USE_SENSOR_NAMES
@@ -46,6 +46,7 @@
 
 #include "drivers/nvic.h"
 #include "drivers/persistent.h"
+#include "drivers/time.h"
 
 #include "fc/rc_modes.h"
 #include "fc/runtime_config.h"
@@ -73,12 +74,12 @@
 #include "sensors/acceleration.h"
 #include "sensors/gyro.h"
 
+#include "telemetry/crsf_scheduler.h"
 #include "telemetry/telemetry.h"
 #include "telemetry/msp_shared.h"
 
 #include "crsf.h"
 
-#define CRSF_CYCLETIME_US                   100000 // 100ms, 10 Hz -- all telemetry frames are inserted in this timeslice
 #define CRSF_DEVICEINFO_VERSION             0x01
 #define CRSF_DEVICEINFO_PARAMETER_COUNT     0
 
@@ -926,7 +927,7 @@ static void crsfFrameDisplayPortClear(sbuf_t *dst)
 
 #endif
 
-// schedule array to decide how often each type of frame is sent
+// frame types sent from the schedule
 typedef enum {
     CRSF_FRAME_START_INDEX = 0,
     CRSF_FRAME_ATTITUDE_INDEX = CRSF_FRAME_START_INDEX,
@@ -952,8 +953,29 @@ typedef enum {
     CRSF_TIMED_SCHEDULE_COUNT_MAX
 } crsfTimedFrameTypeIndex_e;
 
-static uint8_t crsfScheduleCount;
-static uint16_t crsfSchedule[CRSF_SCHEDULE_COUNT_MAX];
+typedef struct crsfFrameRate_s {
+    uint32_t intervalUs;
+    uint32_t refreshUs;             // an unchanged frame is resent after this long
+    crsfPriority_e priority;
+} crsfFrameRate_t;
+
+// On a 1:64 telemetry ratio the link carries a few frames a second, so what
+// the pilot watches goes first and frames that rarely change only go out
+// when they do
+static const crsfFrameRate_t crsfFrameRates[CRSF_SCHEDULE_COUNT_MAX] = {
+    [CRSF_FRAME_ATTITUDE_INDEX]         = { 100000, 1000000, CRSF_PRIORITY_HIGH },
+    [CRSF_FRAME_BARO_ALTITUDE_INDEX]    = { 100000, 1000000, CRSF_PRIORITY_NORMAL },
+    [CRSF_FRAME_BATTERY_SENSOR_INDEX]   = { 200000, 1000000, CRSF_PRIORITY_HIGH },
+    [CRSF_FRAME_FLIGHT_MODE_INDEX]      = { 200000, 1000000, CRSF_PRIORITY_HIGH },
+    [CRSF_FRAME_MAG_INDEX]              = { 500000, 2000000, CRSF_PRIORITY_LOW },
+    [CRSF_FRAME_GPS_INDEX]              = { 100000, 1000000, CRSF_PRIORITY_NORMAL },
+    [CRSF_FRAME_VARIO_SENSOR_INDEX]     = { 100000, 1000000, CRSF_PRIORITY_NORMAL },
+    [CRSF_FRAME_HEARTBEAT_INDEX]        = { 20000, 0, CRSF_PRIORITY_FILLER },    // a frame at least every 20ms
+    [CRSF_FRAME_BARO_SENSOR_INDEX]      = { 100000, 1000000, CRSF_PRIORITY_LOW },
+};
+
+static crsfScheduler_t crsfScheduler;
+static uint8_t crsfSlotFrame[CRSF_SCHEDULER_SLOTS_MAX];    // crsfFrameTypeIndex_e of each slot
 static uint16_t crsfTimedSchedule;
 
 #if defined(USE_MSP_OVER_TELEMETRY)
@@ -981,9 +1003,67 @@ static void crsfSendMspResponse(uint8_t *payload, const uint8_t payloadSize)
     sbufWriteData(dst, payload, payloadSize);
     crsfFinalize(dst);
 }
+
+// Whether the periodic path would send a frame in this pass
+static bool crsfFrameWaiting(timeUs_t currentTimeUs)
+{
+#if defined(USE_CRSF_V3)
+    if (crsfRxIsEventDrivenTelemetry() && !telemetryResponsePending) {
+        return false;
+    }
+#endif
+    return crsfRxIsTelemetryBufEmpty() && crsfSchedulerNext(&crsfScheduler, currentTimeUs) >= 0;
+}
+#endif
+
+static void crsfFrameScheduled(sbuf_t *dst, crsfFrameTypeIndex_e frameIndex)
+{
+    switch (frameIndex) {
+    case CRSF_FRAME_ATTITUDE_INDEX:
+        crsfFrameAttitude(dst);
+        break;
+#if defined(USE_BARO) && defined(USE_VARIO)
+    case CRSF_FRAME_BARO_ALTITUDE_INDEX:
+        crsfFrameAltitude(dst);
+        break;
+#endif
+    case CRSF_FRAME_BATTERY_SENSOR_INDEX:
+        crsfFrameBatterySensor(dst);
+        break;
+    case CRSF_FRAME_FLIGHT_MODE_INDEX:
+        crsfFrameFlightMode(dst);
+        break;
+#if defined(USE_BARO) && !defined(USE_CRSF_V3)
+    case CRSF_FRAME_BARO_SENSOR_INDEX:
+        crsfFrameBaro(dst);
+        break;
+#endif
+#if defined(USE_MAG)
+    case CRSF_FRAME_MAG_INDEX:
+        crsfFrameMag(dst);
+        break;
+#endif
+#ifdef USE_GPS
+    case CRSF_FRAME_GPS_INDEX:
+        crsfFrameGps(dst);
+        break;
+#endif
+#ifdef USE_VARIO
+    case CRSF_FRAME_VARIO_SENSOR_INDEX:
+        crsfFrameVarioSensor(dst);
+        break;
 #endif
+#if defined(USE_CRSF_V3)
+    case CRSF_FRAME_HEARTBEAT_INDEX:
+        crsfFrameHeartbeat(dst);
+        break;
+#endif
+    default:
+        break;
+    }
+}
 
-static bool processCrsf(uint32_t currentTimeUs, uint32_t crsfLastCycleTime)
+static bool processCrsf(timeUs_t currentTimeUs)
 {
     sbuf_t crsfPayloadBuf;
     sbuf_t *dst = &crsfPayloadBuf;
@@ -1029,80 +1109,23 @@ static bool processCrsf(uint32_t currentTimeUs, uint32_t crsfLastCycleTime)
     }
 #endif
 
-    if (crsfScheduleCount == 0) {
-        return false;
-    }
-
-    if (currentTimeUs < crsfLastCycleTime + CRSF_CYCLETIME_US / crsfScheduleCount) {
-        return false;
-    }
-
-    static uint8_t crsfScheduleIndex = 0;
-    const uint16_t currentSchedule = crsfSchedule[crsfScheduleIndex];
-
-    if (currentSchedule & BIT(CRSF_FRAME_ATTITUDE_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameAttitude(dst);
-        crsfFinalize(dst);
-    }
-#if defined(USE_BARO) && defined(USE_VARIO)
-    // send barometric altitude
-    if (currentSchedule & BIT(CRSF_FRAME_BARO_ALTITUDE_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameAltitude(dst);
-        crsfFinalize(dst);
-    }
-#endif
-    if (currentSchedule & BIT(CRSF_FRAME_BATTERY_SENSOR_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameBatterySensor(dst);
-        crsfFinalize(dst);
-    }
-
-    if (currentSchedule & BIT(CRSF_FRAME_FLIGHT_MODE_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameFlightMode(dst);
-        crsfFinalize(dst);
-    }
-#if defined(USE_BARO) && !defined(USE_CRSF_V3)
-    if (currentSchedule & BIT(CRSF_FRAME_BARO_SENSOR_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameBaro(dst);
-        crsfFinalize(dst);
-    }
-#endif
-#if defined(USE_MAG)
-    if (currentSchedule & BIT(CRSF_FRAME_MAG_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameMag(dst);
-        crsfFinalize(dst);
-    }
-#endif
-#ifdef USE_GPS
-    if (currentSchedule & BIT(CRSF_FRAME_GPS_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameGps(dst);
-        crsfFinalize(dst);
-    }
-#endif
-#ifdef USE_VARIO
-    if (currentSchedule & BIT(CRSF_FRAME_VARIO_SENSOR_INDEX)) {
-        crsfInitializeFrame(dst);
-        crsfFrameVarioSensor(dst);
-        crsfFinalize(dst);
-    }
-#endif
-#if defined(USE_CRSF_V3)
-    if (currentSchedule & BIT(CRSF_FRAME_HEARTBEAT_INDEX)) {
+    // A frame that has not changed since it last went out gives the slot to
+    // the next one due
+    for (int tries = 0; tries < crsfScheduler.count; tries++) {
+        const int slot = crsfSchedulerNext(&crsfScheduler, currentTimeUs);
+        if (slot < 0) {
+            return false;
+        }
         crsfInitializeFrame(dst);
-        crsfFrameHeartbeat(dst);
-        crsfFinalize(dst);
+        crsfFrameScheduled(dst, crsfSlotFrame[slot]);
+        const uint16_t payloadHash = crc16_ccitt_update(0, &crsfFrame[1], sbufPtr(dst) - &crsfFrame[1]);
+        if (crsfSchedulerOffer(&crsfScheduler, slot, payloadHash, currentTimeUs)) {
+            crsfFinalize(dst);
+            return true;
+        }
     }
-#endif
-
-    crsfScheduleIndex = (crsfScheduleIndex + 1) % crsfScheduleCount;
 
-    return true;
+    return false;
 }
 
 void crsfScheduleDeviceInfoResponse(void)
@@ -1120,8 +1143,8 @@ FAST_CODE void crsfScheduleTelemetryResponse(void)
 // Cap TASK_TELEMETRY wake-ups at 50Hz so high RC link rates (e.g. 250Hz ELRS)
 // cannot wake the scheduler faster than it produces frames, which otherwise
 // starves time-critical tasks (PID/motor write). Each sensor frame type is
-// sent at most once per CRSF_CYCLETIME_US (100ms), so 50Hz task wakes are
-// sufficient to transmit all types on schedule.
+// scheduled at 10Hz at most, so 50Hz task wakes are sufficient to transmit all
+// types on schedule.
 // Latency-sensitive ad-hoc responses (MSP-over-telemetry, device info) bypass
 // the cap so they still drain at the inbound frame rate.
 bool crsfTelemetryUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs)
@@ -1173,6 +1196,15 @@ void crsfHandleDeviceInfoResponse(uint8_t *payload)
 }
 #endif
 
+static void crsfScheduleFrame(crsfFrameTypeIndex_e frameIndex, timeUs_t currentTimeUs)
+{
+    const crsfFrameRate_t *rate = &crsfFrameRates[frameIndex];
+    const int slot = crsfSchedulerAddSlot(&crsfScheduler, rate->intervalUs, rate->refreshUs, rate->priority, currentTimeUs);
+    if (slot >= 0) {
+        crsfSlotFrame[slot] = frameIndex;
+    }
+}
+
 void initCrsfTelemetry(void)
 {
     // check if there is a serial port open for CRSF telemetry (ie opened by the CRSF RX)
@@ -1192,34 +1224,35 @@ void initCrsfTelemetry(void)
 #endif
     crsfTimedSchedule = 0;
 
-    uint8_t index = 0;
+    const timeUs_t nowUs = micros();
+    crsfSchedulerInit(&crsfScheduler);
     if (sensors(SENSOR_ACC) && telemetryIsSensorEnabled(SENSOR_PITCH | SENSOR_ROLL | SENSOR_HEADING)) {
-        crsfSchedule[index++] = BIT(CRSF_FRAME_ATTITUDE_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_ATTITUDE_INDEX, nowUs);
     }
 #if defined(USE_BARO) && defined(USE_VARIO)
     if (telemetryIsSensorEnabled(SENSOR_ALTITUDE)) {
-        crsfSchedule[index++] = BIT(CRSF_FRAME_BARO_ALTITUDE_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_BARO_ALTITUDE_INDEX, nowUs);
     }
 #endif
     if ((isBatteryVoltageConfigured() && telemetryIsSensorEnabled(SENSOR_VOLTAGE))
         || (isAmperageConfigured() && telemetryIsSensorEnabled(SENSOR_CURRENT | SENSOR_FUEL))) {
-        crsfSchedule[index++] = BIT(CRSF_FRAME_BATTERY_SENSOR_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_BATTERY_SENSOR_INDEX, nowUs);
     }
     if (telemetryIsSensorEnabled(SENSOR_MODE)) {
-        crsfSchedule[index++] = BIT(CRSF_FRAME_FLIGHT_MODE_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_FLIGHT_MODE_INDEX, nowUs);
     }
 #ifdef USE_BARO
     if (sensors(SENSOR_BARO)) {
 #ifdef USE_CRSF_V3
         crsfTimedSchedule |= BIT(CRSF_TIMED_FRAME_BARO_INDEX);
 #else
-        crsfSchedule[index++] = BIT(CRSF_FRAME_BARO_SENSOR_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_BARO_SENSOR_INDEX, nowUs);
 #endif
     }
 #endif
 #if defined(USE_MAG)
     if (sensors(SENSOR_MAG)) {
-        crsfSchedule[index++] = BIT(CRSF_FRAME_MAG_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_MAG_INDEX, nowUs);
     }
 #endif
 #ifdef USE_GPS
@@ -1228,7 +1261,7 @@ void initCrsfTelemetry(void)
 #ifdef USE_CRSF_V3
         crsfTimedSchedule |= BIT(CRSF_TIMED_FRAME_GPS_INDEX) | BIT(CRSF_TIMED_FRAME_GPS_TIME_INDEX) | BIT(CRSF_TIMED_FRAME_GPS_EXTENDED_INDEX);
 #else
-        crsfSchedule[index++] = BIT(CRSF_FRAME_GPS_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_GPS_INDEX, nowUs);
 #endif
     }
 #endif
@@ -1239,21 +1272,17 @@ void initCrsfTelemetry(void)
 #endif
 #ifdef USE_VARIO
     if ((sensors(SENSOR_BARO) || featureIsEnabled(FEATURE_GPS)) && telemetryIsSensorEnabled(SENSOR_VARIO)) {
-        crsfSchedule[index++] = BIT(CRSF_FRAME_VARIO_SENSOR_INDEX);
+        crsfScheduleFrame(CRSF_FRAME_VARIO_SENSOR_INDEX, nowUs);
     }
 #endif
 
 #if defined(USE_CRSF_V3)
     if (!(crsfTimedSchedule & BIT(CRSF_TIMED_FRAME_ACCGYRO_INDEX))) {
-        while (index < (CRSF_CYCLETIME_US / CRSF_TELEMETRY_FRAME_INTERVAL_MAX_US) && index < CRSF_SCHEDULE_COUNT_MAX) {
-            // schedule heartbeat to ensure that telemetry/heartbeat frames are sent at minimum 50Hz
-            crsfSchedule[index++] = BIT(CRSF_FRAME_HEARTBEAT_INDEX);
-        }
+        // heartbeat fills the gaps so that telemetry/heartbeat frames are sent at minimum 50Hz
+        crsfScheduleFrame(CRSF_FRAME_HEARTBEAT_INDEX, nowUs);
     }
 #endif
 
-    crsfScheduleCount = index;
-
 #if defined(USE_CRSF_CMS_TELEMETRY)
     crsfDisplayportRegister();
 #endif
@@ -1316,8 +1345,6 @@ void crsfProcessCommand(uint8_t *frameStart)
  */
 void handleCrsfTelemetry(timeUs_t currentTimeUs)
 {
-    static uint32_t crsfLastCycleTime;
-
     if (!crsfTelemetryEnabled) {
         return;
     }
@@ -1336,10 +1363,11 @@ void handleCrsfTelemetry(timeUs_t currentTimeUs)
     // Send ad-hoc response frames as soon as possible, ahead of the gate below: a chunked reply
     // needs one pass per chunk, and inbound frames can be too sparse to clock them out. ELRS
     // WiFi passthrough has no RC link, so its only inbound frames are the MSP requests themselves.
+    // A long reply still lets a due telemetry frame through every few chunks.
 #if defined(USE_MSP_OVER_TELEMETRY)
-    if (mspReplyPending) {
+    if (mspReplyPending && crsfSchedulerMspTurn(&crsfScheduler, crsfFrameWaiting(currentTimeUs))) {
         mspReplyPending = handleCrsfMspFrameBuffer(&crsfSendMspResponse);
-        crsfLastCycleTime = currentTimeUs; // reset telemetry timing due to ad-hoc request
+        crsfSchedulerMspSent(&crsfScheduler, currentTimeUs);
 #if defined(USE_CRSF_V3)
         telemetryResponsePending = false;
 #endif
@@ -1357,7 +1385,6 @@ void handleCrsfTelemetry(timeUs_t currentTimeUs)
 #if defined(USE_CRSF_V3)
         telemetryResponsePending = false;
 #endif
-        crsfLastCycleTime = currentTimeUs; // reset telemetry timing due to ad-hoc request
         return;
     }
 
@@ -1378,7 +1405,6 @@ void handleCrsfTelemetry(timeUs_t currentTimeUs)
         crsfInitializeFrame(dst);
         crsfFrameDisplayPortClear(dst);
         crsfFinalize(dst);
-        crsfLastCycleTime = currentTimeUs;
 #if defined(USE_CRSF_V3)
         telemetryResponsePending = false;
 #endif
@@ -1413,8 +1439,6 @@ void handleCrsfTelemetry(timeUs_t currentTimeUs)
             crsfRxSendTelemetryData();
             batchIndex++;
             batchLastTimeUs = currentTimeUs;
-
-            crsfLastCycleTime = currentTimeUs;
 #if defined(USE_CRSF_V3)
             telemetryResponsePending = false;
 #endif
@@ -1427,18 +1451,17 @@ void handleCrsfTelemetry(timeUs_t currentTimeUs)
         return; // do nothing if telemetry ouptut buffer is not empty yet.
     }
 
-    // Actual telemetry data only needs to be sent at a low frequency, ie 10Hz
-    // Spread out scheduled frames evenly so each frame is sent at the same frequency.
-    // speed up the telemetry rate to that configured if using accgyro data
-    if (processCrsf(currentTimeUs, crsfLastCycleTime)) {
-        crsfLastCycleTime = currentTimeUs;
+    // Each frame type goes out at its own rate, highest priority first, and only when its content
+    // has changed or is due a refresh. Spare slots carry accgyro data if it is configured.
+    if (!processCrsf(currentTimeUs)) {
 #ifdef USE_CRSF_ACCGYRO_TELEMETRY
-    } else if (crsfAccGyroEnabled() && crsfRxIsEventDrivenTelemetry()) {  // let the inbound request rate dictate the outbound rate
-        sbuf_t crsfPayloadBuf;
-        sbuf_t *dst = &crsfPayloadBuf;
-        crsfInitializeFrame(dst);
-        if (crsfFrameAccGyro(dst, currentTimeUs)) {
-            crsfFinalize(dst);
+        if (crsfAccGyroEnabled() && crsfRxIsEventDrivenTelemetry()) {  // let the inbound request rate dictate the outbound rate
+            sbuf_t crsfPayloadBuf;
+            sbuf_t *dst = &crsfPayloadBuf;
+            crsfInitializeFrame(dst);
+            if (crsfFrameAccGyro(dst, currentTimeUs)) {
+                crsfFinalize(dst);
+            }
         }
 #endif
     }
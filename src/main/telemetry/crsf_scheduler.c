@@ -0,0 +1,141 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#if defined(USE_TELEMETRY_CRSF)
+
+#include "common/maths.h"
+#include "common/time.h"
+
+#include "telemetry/crsf_scheduler.h"
+
+// MSP chunks a reply may send back to back while a frame is waiting
+#define CRSF_SCHEDULER_MSP_RUN_MAX      2
+// A frame gains a priority level for every whole interval it is late, so a
+// link with fewer slots than the schedule wants still serves every frame
+#define CRSF_SCHEDULER_BOOST_MAX        8
+
+void crsfSchedulerInit(crsfScheduler_t *scheduler)
+{
+    memset(scheduler, 0, sizeof(*scheduler));
+}
+
+int crsfSchedulerAddSlot(crsfScheduler_t *scheduler, uint32_t intervalUs, uint32_t refreshUs, crsfPriority_e priority, timeUs_t currentTimeUs)
+{
+    if (scheduler->count >= CRSF_SCHEDULER_SLOTS_MAX || intervalUs == 0) {
+        return -1;
+    }
+    crsfFrameSlot_t *slot = &scheduler->slots[scheduler->count];
+    memset(slot, 0, sizeof(*slot));
+    slot->intervalUs = intervalUs;
+    slot->refreshUs = refreshUs;
+    slot->priority = priority;
+    slot->nextDueUs = currentTimeUs;
+    return scheduler->count++;
+}
+
+static int effectivePriority(const crsfFrameSlot_t *slot, timeUs_t currentTimeUs)
+{
+    if (slot->priority == CRSF_PRIORITY_FILLER) {
+        return CRSF_PRIORITY_FILLER;
+    }
+    const uint32_t lateUs = cmpTimeUs(currentTimeUs, slot->nextDueUs);
+    return slot->priority + MIN(lateUs / slot->intervalUs, (uint32_t)CRSF_SCHEDULER_BOOST_MAX);
+}
+
+int crsfSchedulerNext(const crsfScheduler_t *scheduler, timeUs_t currentTimeUs)
+{
+    int next = -1;
+    int nextPriority = 0;
+    for (int i = 0; i < scheduler->count; i++) {
+        const crsfFrameSlot_t *slot = &scheduler->slots[i];
+        if (cmpTimeUs(currentTimeUs, slot->nextDueUs) < 0) {
+            continue;
+        }
+        // Highest priority first, then whichever fell due earliest
+        const int priority = effectivePriority(slot, currentTimeUs);
+        if (next < 0 || priority > nextPriority
+            || (priority == nextPriority && cmpTimeUs(slot->nextDueUs, scheduler->slots[next].nextDueUs) < 0)) {
+            next = i;
+            nextPriority = priority;
+        }
+    }
+    return next;
+}
+
+// Keep the cadence unless it has slipped by a whole interval, then restart
+// it rather than sending a catch-up burst
+static void advance(crsfFrameSlot_t *slot, timeUs_t currentTimeUs)
+{
+    slot->nextDueUs += slot->intervalUs;
+    if (cmpTimeUs(currentTimeUs, slot->nextDueUs) >= 0) {
+        slot->nextDueUs = currentTimeUs + slot->intervalUs;
+    }
+}
+
+// Something went out: the fillers wait another interval
+static void postponeFillers(crsfScheduler_t *scheduler, timeUs_t currentTimeUs)
+{
+    for (int i = 0; i < scheduler->count; i++) {
+        crsfFrameSlot_t *slot = &scheduler->slots[i];
+        if (slot->priority == CRSF_PRIORITY_FILLER) {
+            slot->nextDueUs = currentTimeUs + slot->intervalUs;
+        }
+    }
+}
+
+bool crsfSchedulerOffer(crsfScheduler_t *scheduler, int index, uint16_t payloadHash, timeUs_t currentTimeUs)
+{
+    crsfFrameSlot_t *slot = &scheduler->slots[index];
+
+    advance(slot, currentTimeUs);
+    if (slot->sent && slot->payloadHash == payloadHash
+        && cmpTimeUs(currentTimeUs, slot->lastSentUs) < (timeDelta_t)slot->refreshUs) {
+        return false;
+    }
+
+    slot->payloadHash = payloadHash;
+    slot->lastSentUs = currentTimeUs;
+    slot->sent = true;
+    scheduler->mspRun = 0;
+    postponeFillers(scheduler, currentTimeUs);
+    return true;
+}
+
+bool crsfSchedulerMspTurn(const crsfScheduler_t *scheduler, bool frameDue)
+{
+    return !frameDue || scheduler->mspRun < CRSF_SCHEDULER_MSP_RUN_MAX;
+}
+
+void crsfSchedulerMspSent(crsfScheduler_t *scheduler, timeUs_t currentTimeUs)
+{
+    if (scheduler->mspRun < UINT8_MAX) {
+        scheduler->mspRun++;
+    }
+    postponeFillers(scheduler, currentTimeUs);
+}
+
+#endif // USE_TELEMETRY_CRSF
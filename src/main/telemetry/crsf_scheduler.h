@@ -0,0 +1,78 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common/time.h"
+
+// Scheduling of the periodic CRSF telemetry frames into the downlink slots
+// the receiver hands out. Each frame type has a target rate and a priority;
+// a frame whose payload has not changed is skipped until its refresh time,
+// so a slow link spends its few slots on news. MSP replies share the slots
+// with the frames instead of holding them all until the reply is done.
+
+#define CRSF_SCHEDULER_SLOTS_MAX        12
+
+typedef enum {
+    CRSF_PRIORITY_FILLER = 0,           // only when nothing has gone out for its interval
+    CRSF_PRIORITY_LOW,
+    CRSF_PRIORITY_NORMAL,
+    CRSF_PRIORITY_HIGH,
+} crsfPriority_e;
+
+typedef struct crsfFrameSlot_s {
+    uint32_t intervalUs;                // target rate
+    uint32_t refreshUs;                 // an unchanged payload is resent after this long
+    timeUs_t nextDueUs;
+    timeUs_t lastSentUs;
+    uint16_t payloadHash;
+    uint8_t  priority;
+    bool     sent;                      // payloadHash and lastSentUs are valid
+} crsfFrameSlot_t;
+
+typedef struct crsfScheduler_s {
+    crsfFrameSlot_t slots[CRSF_SCHEDULER_SLOTS_MAX];
+    uint8_t  count;
+    uint8_t  mspRun;                    // MSP chunks sent since the last frame
+} crsfScheduler_t;
+
+void crsfSchedulerInit(crsfScheduler_t *scheduler);
+
+// Add a frame type sent every intervalUs at most. Returns its slot, or -1
+// when the schedule is full.
+int crsfSchedulerAddSlot(crsfScheduler_t *scheduler, uint32_t intervalUs, uint32_t refreshUs, crsfPriority_e priority, timeUs_t currentTimeUs);
+
+// The slot to build a frame for now, or -1 when none is due.
+int crsfSchedulerNext(const crsfScheduler_t *scheduler, timeUs_t currentTimeUs);
+
+// Offer the frame built for `slot`, identified by a hash of its payload.
+// Returns true if it should be sent, and accounts for it; false if it is
+// unchanged and not due a refresh, in which case the slot waits another
+// interval and the caller may try the next one.
+bool crsfSchedulerOffer(crsfScheduler_t *scheduler, int slot, uint16_t payloadHash, timeUs_t currentTimeUs);
+
+// Whether a pending MSP reply gets this downlink slot. A reply may take a
+// few slots in a row, then gives one up to any frame that is due.
+bool crsfSchedulerMspTurn(const crsfScheduler_t *scheduler, bool frameDue);
+void crsfSchedulerMspSent(crsfScheduler_t *scheduler, timeUs_t currentTimeUs);
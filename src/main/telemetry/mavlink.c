@@ -89,6 +89,7 @@
 #pragma GCC diagnostic pop
 
 #include "telemetry/mavlink.h"
+#include "telemetry/mavlink_scheduler.h"
 #if ENABLE_TELEMETRY_MAVLINK_MISSION
 #include "telemetry/mavlink_mission.h"
 #endif
@@ -97,8 +98,6 @@
 #include "build/version.h"
 
 #define TELEMETRY_MAVLINK_INITIAL_PORT_MODE MODE_RXTX
-#define TELEMETRY_MAVLINK_MAXRATE 50
-#define TELEMETRY_MAVLINK_DELAY ((1000 * 1000) / TELEMETRY_MAVLINK_MAXRATE)
 
 #define MAVLINK_SYSTEM_ID 1
 #define MAVLINK_COMPONENT_ID MAV_COMP_ID_AUTOPILOT1
@@ -109,7 +108,6 @@ static const serialPortConfig_t *portConfig;
 
 static bool mavlinkTelemetryEnabled =  false;
 static portSharing_e mavlinkPortSharing;
-static uint32_t lastMavlinkMessageTime = 0;
 static armingDisableFlags_e lastArmingDisableFlags = 0;
 
 static mavlink_message_t mavRxMsg;
@@ -151,10 +149,17 @@ static const bfMavModeDescriptor_t bfMavModeDescriptors[BF_MAV_MODE_COUNT] = {
 static mavlink_message_t mavMsg;
 static uint8_t mavBuffer[MAVLINK_MAX_PACKET_LEN];
 
+// Periodic streams go out through the scheduler, which budgets every byte
+// written here, scheduled or not
+static mavlinkScheduler_t mavScheduler;
+static uint32_t mavlinkTxBytes;
+static uint32_t mavlinkTxBytesAccounted;
+
 static void mavlinkSerialWrite(uint8_t * buf, uint16_t length)
 {
     for (int i = 0; i < length; i++)
         serialWrite(mavlinkPort, buf[i]);
+    mavlinkTxBytes += length;
 }
 
 // Pack-to-buffer + write helper shared with telemetry/mavlink_mission so the
@@ -268,6 +273,15 @@ static void handlePing(const mavlink_message_t *msg)
     mavlinkSerialWrite(mavBuffer, msgLength);
 }
 
+// A telemetry radio (SiK and the like) reporting how full its transmit
+// buffer is: the air link, not the serial port, is then the bottleneck
+static void handleRadioStatus(const mavlink_message_t *msg)
+{
+    mavlink_radio_status_t radioStatus;
+    mavlink_msg_radio_status_decode(msg, &radioStatus);
+    mavlinkSchedulerRadioStatus(&mavScheduler, radioStatus.txbuf, telemetryConfig()->mavlink_min_txbuff);
+}
+
 static void handleTimesync(const mavlink_message_t *msg)
 {
     mavlink_timesync_t timesync;
@@ -772,6 +786,9 @@ static void mavlinkDispatch(const mavlink_message_t *msg)
     case MAVLINK_MSG_ID_TIMESYNC:
         handleTimesync(msg);
         break;
+    case MAVLINK_MSG_ID_RADIO_STATUS:
+        handleRadioStatus(msg);
+        break;
     case MAVLINK_MSG_ID_COMMAND_LONG:
         handleCommandLong(msg);
         break;
@@ -1351,73 +1368,83 @@ static mavlinkTelemetryOutputMessage_t mavTelemetryOutputMessages[] = {
     {
         .id = MAVLINK_MSG_ID_SYS_STATUS,
         .stream = MAV_DATA_STREAM_EXTENDED_STATUS,
+        .priority = MAVLINK_PRIORITY_HIGH,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_SYS_STATUS_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendSystemStatus,
     },
     {
         .id = MAVLINK_MSG_ID_RC_CHANNELS_RAW,
         .stream = MAV_DATA_STREAM_RC_CHANNELS,
+        .priority = MAVLINK_PRIORITY_LOW,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_RC_CHANNELS_RAW_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendRCChannelsAndRSSI,
     },
 #ifdef USE_GPS
     {
         .id = MAVLINK_MSG_ID_GPS_RAW_INT,
         .stream = MAV_DATA_STREAM_POSITION,
+        .priority = MAVLINK_PRIORITY_NORMAL,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_GPS_RAW_INT_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendGpsRaw,
     },
     {
         .id = MAVLINK_MSG_ID_GLOBAL_POSITION_INT,
         .stream = MAV_DATA_STREAM_POSITION,
+        .priority = MAVLINK_PRIORITY_NORMAL,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_GLOBAL_POSITION_INT_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendGpsGlobalPosition,
     },
     {
         .id = MAVLINK_MSG_ID_GPS_GLOBAL_ORIGIN,
         .stream = MAV_DATA_STREAM_POSITION,
+        .priority = MAVLINK_PRIORITY_LOW,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_GPS_GLOBAL_ORIGIN_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendGpsGlobalOrigin,
     },
     {
         .id = MAVLINK_MSG_ID_HOME_POSITION,
         .stream = MAV_DATA_STREAM_POSITION,
+        .priority = MAVLINK_PRIORITY_LOW,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_HOME_POSITION_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendHomePosition,
     },
 #endif
     {
         .id = MAVLINK_MSG_ID_ATTITUDE,
         .stream = MAV_DATA_STREAM_EXTRA1,
+        .priority = MAVLINK_PRIORITY_NORMAL,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_ATTITUDE_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendAttitude,
     },
     {
         .id = MAVLINK_MSG_ID_HEARTBEAT,
         .stream = MAV_DATA_STREAM_EXTRA2,
+        .priority = MAVLINK_PRIORITY_HIGH,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_HEARTBEAT_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendHeartbeat,
     },
     {
         .id = MAVLINK_MSG_ID_VFR_HUD,
         .stream = MAV_DATA_STREAM_EXTRA2,
+        .priority = MAVLINK_PRIORITY_NORMAL,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_VFR_HUD_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendHUD,
     },
     {
         .id = MAVLINK_MSG_ID_BATTERY_STATUS,
         .stream = MAV_DATA_STREAM_EXTRA3,
+        .priority = MAVLINK_PRIORITY_NORMAL,
+        .length = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_BATTERY_STATUS_LEN,
         .updateInterval = UINT32_MAX,
-        .updateTime = 0,
         .sendMessageFunc = mavlinkSendBatteryStatus,
     }
 };
@@ -1460,31 +1487,42 @@ static uint32_t getConfigStreamUpdateInterval(uint8_t stream) {
     return updateInterval;
 }
 
+STATIC_ASSERT(TELEMETRIES_OUTPUT_MESSAGES_COUNT <= MAVLINK_SCHEDULER_STREAMS_MAX, mavlink_scheduler_too_small);
+
+static void scheduleOutputMessage(uint16_t index, timeUs_t currentTimeUs)
+{
+    const timeMs_t intervalMs = mavTelemetryOutputMessages[index].updateInterval;
+    mavlinkSchedulerSetInterval(&mavScheduler, index, intervalMs == UINT32_MAX ? 0 : intervalMs * 1000, currentTimeUs);
+}
+
 static void configureMAVLinkOutputMessagesIntervals(void)
 {
-    // Seed timers to avoid burst on enable
-    timeMs_t nowMs = millis();
+    // Budget from the port's own rate; RADIO_STATUS narrows it if a radio
+    // further down cannot keep up
+    const timeUs_t nowUs = micros();
+    mavlinkSchedulerInit(&mavScheduler, mavlinkPort ? mavlinkPort->baudRate : baudRates[BAUD_57600], nowUs);
+    mavlinkTxBytesAccounted = mavlinkTxBytes;
 
     for (uint16_t i = 0; i < TELEMETRIES_OUTPUT_MESSAGES_COUNT; i++) {
+        mavlinkSchedulerAddStream(&mavScheduler, mavTelemetryOutputMessages[i].length, mavTelemetryOutputMessages[i].priority);
         mavTelemetryOutputMessages[i].updateInterval = getConfigStreamUpdateInterval(mavTelemetryOutputMessages[i].stream);
-        // Phase offset (3*i) staggers transmissions across ~15ms to reduce TX buffer spikes
-        if (mavTelemetryOutputMessages[i].updateInterval != UINT32_MAX) {
-            mavTelemetryOutputMessages[i].updateTime =  nowMs + mavTelemetryOutputMessages[i].updateInterval + 3 * i;
-        }
+        // The scheduler staggers the phases to reduce TX buffer spikes
+        scheduleOutputMessage(i, nowUs);
     }
 }
 
 // A return value of -1 indicates this stream is disabled, 0 indicates it is not available, > 0 indicates the interval at which it is sent.
+// That is the interval the link budget grants, which may be longer than the one requested.
 static int32_t getMessageUpdateInterval(uint32_t messageId)
 {
     int32_t updateIntervalUs = 0;
     for (uint16_t i = 0; i < TELEMETRIES_OUTPUT_MESSAGES_COUNT; i++) {
         if (mavTelemetryOutputMessages[i].id == messageId) {
-            uint32_t updateIntervalMs = mavTelemetryOutputMessages[i].updateInterval;
-            if (updateIntervalMs == UINT32_MAX) {
+            if (mavTelemetryOutputMessages[i].updateInterval == UINT32_MAX) {
                 updateIntervalUs = -1;
             } else {
-                updateIntervalUs = updateIntervalMs * 1000 <= INT32_MAX ? (int32_t)(updateIntervalMs * 1000) : INT32_MAX;
+                const uint32_t grantedUs = mavScheduler.streams[i].grantedIntervalUs;
+                updateIntervalUs = grantedUs <= INT32_MAX ? (int32_t)grantedUs : INT32_MAX;
             }
             break;
         }
@@ -1506,23 +1544,48 @@ static bool setMessageUpdateInterval(uint32_t messageId, uint32_t intervalMs)
                 intervalMs = MIN_MAVLINK_TELEMETRY_UPDATE_INTERVAL_MS;
             }
             mavTelemetryOutputMessages[i].updateInterval = intervalMs;
+            scheduleOutputMessage(i, micros());
             return true;
         }
     }
     return false;
 }
 
-static void processMAVLinkTelemetry(void)
+static void processMAVLinkTelemetry(timeUs_t currentTimeUs)
 {
-    timeMs_t currentTimeMs = millis();
-    for (uint16_t i = 0; i < TELEMETRIES_OUTPUT_MESSAGES_COUNT; i++) {
-        if (mavTelemetryOutputMessages[i].updateInterval != UINT32_MAX && mavTelemetryOutputMessages[i].sendMessageFunc != NULL) {
-            if (currentTimeMs >= mavTelemetryOutputMessages[i].updateTime) {
-                mavTelemetryOutputMessages[i].sendMessageFunc();
-                mavTelemetryOutputMessages[i].updateTime = currentTimeMs + mavTelemetryOutputMessages[i].updateInterval;
-            }
+    // Whatever went out since the last tick outside the schedule
+    mavlinkSchedulerCharge(&mavScheduler, mavlinkTxBytes - mavlinkTxBytesAccounted);
+    mavlinkTxBytesAccounted = mavlinkTxBytes;
+
+    int index;
+    while ((index = mavlinkSchedulerNext(&mavScheduler, currentTimeUs, serialTxBytesFree(mavlinkPort))) >= 0) {
+        if (mavTelemetryOutputMessages[index].sendMessageFunc != NULL) {
+            mavTelemetryOutputMessages[index].sendMessageFunc();
         }
+        mavlinkSchedulerSent(&mavScheduler, index, mavlinkTxBytes - mavlinkTxBytesAccounted, currentTimeUs);
+        mavlinkTxBytesAccounted = mavlinkTxBytes;
+    }
+}
+
+bool mavlinkTelemetryGetBudget(uint32_t *budgetBytesPerSec, uint32_t *linkBytesPerSec)
+{
+    if (!mavlinkTelemetryEnabled) {
+        return false;
     }
+    *budgetBytesPerSec = mavScheduler.budgetBytesPerSec;
+    *linkBytesPerSec = mavScheduler.linkBytesPerSec;
+    return true;
+}
+
+bool mavlinkTelemetryGetStreamRate(uint8_t index, uint32_t *messageId, uint16_t *requestedDeciHz, uint16_t *achievedDeciHz)
+{
+    if (!mavlinkTelemetryEnabled || index >= TELEMETRIES_OUTPUT_MESSAGES_COUNT) {
+        return false;
+    }
+    *messageId = mavTelemetryOutputMessages[index].id;
+    *requestedDeciHz = mavlinkSchedulerRequestedRate(&mavScheduler, index);
+    *achievedDeciHz = mavlinkSchedulerAchievedRate(&mavScheduler, index);
+    return true;
 }
 
 void checkMAVLinkTelemetryState(void)
@@ -1570,18 +1633,11 @@ void handleMAVLinkTelemetry(void)
     mavMissionUpdate(millis());
 #endif
 
-    bool shouldSendTelemetry = false;
-    uint32_t now = micros();
-    if (isValidMavlinkTxBuffer()) {
-        shouldSendTelemetry = shouldSendMavlinkTelemetry();
-    } else if ((now - lastMavlinkMessageTime) >= TELEMETRY_MAVLINK_DELAY) {
-        shouldSendTelemetry = true;
-    }
-
-    if (shouldSendTelemetry) {
-        processMAVLinkTelemetry();
+    // A MAVLink receiver sharing the port reports its own TX buffer and
+    // holds the streams back while it is full
+    if (!isValidMavlinkTxBuffer() || shouldSendMavlinkTelemetry()) {
+        processMAVLinkTelemetry(micros());
         mavlinkProcessArmingStatusText();
-        lastMavlinkMessageTime = now;
     }
 }
 
@@ -20,6 +20,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "common/time.h"
 
 #define MIN_MAVLINK_TELEMETRY_UPDATE_INTERVAL_MS 20
@@ -49,7 +52,14 @@ void mavlinkSendMessage(mavlink_message_t *msg);
 typedef struct mavlinkTelemetryOutputMessage_s {
     const uint32_t id;
     const uint8_t stream;
-    timeMs_t updateInterval;
-    timeMs_t updateTime;
+    const uint8_t priority;         // mavlinkPriority_e, which streams give way first on a slow link
+    const uint16_t length;          // encoded size on the wire, until a send measures it
+    timeMs_t updateInterval;        // requested; the scheduler may grant less
     void (*const sendMessageFunc)(void);
 } mavlinkTelemetryOutputMessage_t;
+
+// Stream rates for the CLI status: the byte budget the link gives the
+// scheduler, and each stream's requested and achieved rate in 0.1 Hz.
+// Return false while MAVLink telemetry is off or past the last stream.
+bool mavlinkTelemetryGetBudget(uint32_t *budgetBytesPerSec, uint32_t *linkBytesPerSec);
+bool mavlinkTelemetryGetStreamRate(uint8_t index, uint32_t *messageId, uint16_t *requestedDeciHz, uint16_t *achievedDeciHz);
@@ -29,6 +29,7 @@
 #if ENABLE_TELEMETRY_MAVLINK_MISSION
 
 #include "common/time.h"
+#include "common/utils.h"
 
 #include "drivers/time.h"
 
@@ -37,11 +38,14 @@
 #include "fc/runtime_config.h"
 
 #include "flight/flight_plan_nav.h"
+#include "flight/geofence.h"
+#include "flight/mission_store.h"
 
 #include "io/gps.h"
 
 #include "pg/autopilot.h"
 #include "pg/flight_plan.h"
+#include "pg/geofence.h"
 
 // mavlink library uses unnamed unions that causes GCC to complain if -Wpedantic
 // is used - ignore -Wpedantic for mavlink code. Pull in the full MAVLink headers
@@ -60,44 +64,54 @@
 
 #define MISSION_UPLOAD_RETRY_MS   1500
 #define MISSION_UPLOAD_MAX_RETRY  5
+// Most MISSION_REQUEST_INTs an upload keeps outstanding. The window opens
+// one request per item received, so it doubles every round trip from one.
+#define MISSION_UPLOAD_WINDOW     8
 #define MISSION_DOWNLOAD_IDLE_MS  5000
 #define MISSION_CURRENT_PERIOD_MS 1000
 
 typedef enum {
     MISSION_IDLE,
-    MISSION_RECEIVING,  // sent REQUEST_INT, awaiting MISSION_ITEM_INT
+    MISSION_RECEIVING,  // REQUEST_INTs outstanding, awaiting MISSION_ITEM_INTs
     MISSION_SENDING,    // sent COUNT, awaiting MISSION_REQUEST_INT
 } missionState_e;
 
 static struct {
     missionState_e state;
     uint8_t  missionType;       // MAV_MISSION_TYPE of the active transfer
-    uint16_t nextSeq;
+    uint16_t nextSeq;           // upload: first item not yet taken, download: past the highest sent
     uint16_t totalCount;
+    uint8_t  windowSize;        // upload: requests allowed outstanding
+    uint8_t  requestedMask;     // upload: window slots requested and not yet received
+    uint8_t  receivedMask;      // upload: window slots received ahead of nextSeq
     uint8_t  partnerSys;
     uint8_t  partnerComp;
     timeMs_t lastActivityMs;
     uint8_t  retries;
     timeMs_t lastCurrentTxMs;
-    int16_t  pendingReachedIndex;
+    int32_t  pendingReachedIndex;
     bool     rtlTerminator;     // current upload ends with NAV_RETURN_TO_LAUNCH (last slot discarded)
+    bool     awaitingStore;     // upload: nothing requested until the store has erased room
 } m;
 
-// Geofence storage. Accepted and round-tripped to the GCS for display, but NOT
-// yet enforced or persisted across reboot — enforcement + a backing PG land in a
-// later step. Held in RAM only.
-#define MAX_FENCE_POINTS 16
-typedef struct {
-    uint16_t command;   // MAV_CMD_NAV_FENCE_*
-    int32_t  lat;       // 1e7 degrees
-    int32_t  lon;       // 1e7 degrees
-    float    param1;    // vertex count (polygon) or radius in metres (circle)
-} fencePoint_t;
+// The fence lives in geofenceConfig and is enforced by flight/geofence.c. An
+// upload is staged here and only replaces the active fence once complete and
+// valid, so an aborted transfer leaves the previous fence in force.
+static geofenceItem_t fenceUpload[MAX_GEOFENCE_ITEMS];
 
-static struct {
-    uint8_t count;
-    fencePoint_t points[MAX_FENCE_POINTS];
-} fenceStore;
+// Waypoints that arrived ahead of nextSeq. The store is written strictly in
+// order (flash records are appended), so they wait here until the gap fills.
+static waypoint_t missionUpload[MISSION_UPLOAD_WINDOW];
+
+STATIC_ASSERT(MISSION_UPLOAD_WINDOW <= 8, mission_upload_window_fits_mask);
+
+static const uint16_t fenceItemCommands[GEOFENCE_ITEM_TYPE_COUNT] = {
+    [GEOFENCE_POLYGON_INCLUSION] = MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION,
+    [GEOFENCE_POLYGON_EXCLUSION] = MAV_CMD_NAV_FENCE_POLYGON_VERTEX_EXCLUSION,
+    [GEOFENCE_CIRCLE_INCLUSION]  = MAV_CMD_NAV_FENCE_CIRCLE_INCLUSION,
+    [GEOFENCE_CIRCLE_EXCLUSION]  = MAV_CMD_NAV_FENCE_CIRCLE_EXCLUSION,
+    [GEOFENCE_RETURN_POINT]      = MAV_CMD_NAV_FENCE_RETURN_POINT,
+};
 
 static mavlink_message_t txMsg;
 
@@ -141,27 +155,80 @@ static void sendCount(uint8_t partnerSys, uint8_t partnerComp, uint8_t missionTy
     mavlinkSendMessage(&txMsg);
 }
 
+static uint8_t uploadSlotBit(uint16_t seq)
+{
+    return 1 << (seq % MISSION_UPLOAD_WINDOW);
+}
+
+// Request every item in the window not yet asked for or received.
+static void requestUploadWindow(void)
+{
+    const uint16_t end = MIN(m.nextSeq + m.windowSize, m.totalCount);
+    for (uint16_t seq = m.nextSeq; seq < end; seq++) {
+        const uint8_t bit = uploadSlotBit(seq);
+        if (!((m.requestedMask | m.receivedMask) & bit)) {
+            m.requestedMask |= bit;
+            sendRequestInt(m.partnerSys, m.partnerComp, m.missionType, seq);
+        }
+    }
+}
+
+static void startUpload(const mavlink_message_t *msg, uint8_t missionType, uint16_t count)
+{
+    m.state = MISSION_RECEIVING;
+    m.missionType = missionType;
+    m.nextSeq = 0;
+    m.totalCount = count;
+    m.partnerSys = msg->sysid;
+    m.partnerComp = msg->compid;
+    m.lastActivityMs = millis();
+    m.retries = 0;
+    m.rtlTerminator = false;
+    m.windowSize = 1;
+    m.requestedMask = 0;
+    m.receivedMask = 0;
+    m.awaitingStore = (missionType == MAV_MISSION_TYPE_MISSION) && !missionStoreIsReady();
+    if (!m.awaitingStore) {
+        requestUploadWindow();
+    }
+}
+
 static void abortUpload(uint8_t result)
 {
     sendAck(m.partnerSys, m.partnerComp, m.missionType, result);
     m.state = MISSION_IDLE;
 }
 
+// A flash mission is complete once committed; only a PG mission needs the
+// whole configuration rewritten to persist.
+static void saveMissionIfPg(void)
+{
+    if (!missionStoreIsFlash()) {
+        saveConfigAndNotify();
+    }
+}
+
 static void sendMissionItem(uint8_t partnerSys, uint8_t partnerComp, uint16_t seq)
 {
     if (m.missionType == MAV_MISSION_TYPE_FENCE) {
-        const fencePoint_t *fpt = &fenceStore.points[seq];
+        if (seq >= geofenceConfig()->itemCount) {
+            return;
+        }
+        const geofenceItem_t *item = &geofenceConfig()->items[seq];
+        const bool hasParam = item->type != GEOFENCE_RETURN_POINT;
         mavlink_msg_mission_item_int_pack(MAVLINK_SYSTEM_ID, MAVLINK_COMPONENT_ID, &txMsg,
-            partnerSys, partnerComp, seq, MAV_FRAME_GLOBAL_INT, fpt->command, 0, 1,
-            fpt->param1, 0.0f, 0.0f, 0.0f,
-            fpt->lat, fpt->lon, 0.0f,
+            partnerSys, partnerComp, seq, MAV_FRAME_GLOBAL_INT, fenceItemCommands[item->type], 0, 1,
+            hasParam ? (float)item->param : 0.0f, 0.0f, 0.0f, 0.0f,
+            item->latitude, item->longitude, 0.0f,
             MAV_MISSION_TYPE_FENCE);
         mavlinkSendMessage(&txMsg);
         return;
     }
 
-    const flightPlanConfig_t *plan = flightPlanConfig();
-    const waypoint_t *wp = &plan->waypoints[seq];
+    const waypoint_t *wp = missionStoreGetWaypoint(seq);
+    if (wp == NULL) {
+        return;
+    }
 
     uint16_t command;
     float param1 = 0.0f;
@@ -225,19 +292,31 @@ static void sendMissionItem(uint8_t partnerSys, uint8_t partnerComp, uint16_t se
     mavlinkSendMessage(&txMsg);
 }
 
-// True for the fence item commands we accept and round-trip.
-static bool isSupportedFenceCommand(uint16_t command)
+// Maps a MAV_CMD_NAV_FENCE_* item; false for anything else.
+static bool mapFenceItem(const mavlink_mission_item_int_t *it, geofenceItem_t *item)
 {
-    switch (command) {
-    case MAV_CMD_NAV_FENCE_RETURN_POINT:
-    case MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION:
-    case MAV_CMD_NAV_FENCE_POLYGON_VERTEX_EXCLUSION:
-    case MAV_CMD_NAV_FENCE_CIRCLE_INCLUSION:
-    case MAV_CMD_NAV_FENCE_CIRCLE_EXCLUSION:
-        return true;
-    default:
-        return false;
+    for (unsigned type = 0; type < GEOFENCE_ITEM_TYPE_COUNT; type++) {
+        if (fenceItemCommands[type] == it->command) {
+            item->type = type;
+            item->latitude = it->x;
+            item->longitude = it->y;
+            // vertex count or radius in metres
+            item->param = (type == GEOFENCE_RETURN_POINT || it->param1 <= 0.0f) ? 0
+                : (it->param1 >= (float)UINT16_MAX) ? UINT16_MAX : lrintf(it->param1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void replaceFence(const geofenceItem_t *items, uint8_t count)
+{
+    geofenceConfig_t *cfg = geofenceConfigMutable();
+    if (count > 0) {
+        memcpy(cfg->items, items, count * sizeof(*items));
     }
+    cfg->itemCount = count;
+    geofenceInvalidate();
 }
 
 static bool decodeFrameAltCm(uint8_t frame, float z, int32_t *altCmOut, uint8_t *resultOut)
@@ -445,8 +524,8 @@ static bool mapMavCmdToWaypoint(const mavlink_mission_item_int_t *it, waypoint_t
 static void handleRequestList(const mavlink_message_t *msg, uint8_t missionType)
 {
     const uint16_t count = (missionType == MAV_MISSION_TYPE_FENCE)
-        ? fenceStore.count
-        : flightPlanConfig()->waypointCount;
+        ? geofenceConfig()->itemCount
+        : missionStoreGetCount();
     m.partnerSys = msg->sysid;
     m.partnerComp = msg->compid;
     m.missionType = missionType;
@@ -480,12 +559,8 @@ static void handleRequestInt(const mavlink_message_t *msg)
         m.state = MISSION_IDLE;
         return;
     }
-    // Allow current seq or one-back retransmit; everything else is out of sequence.
-    if (req.seq != m.nextSeq && !(m.nextSeq > 0 && req.seq == m.nextSeq - 1)) {
-        sendAck(msg->sysid, msg->compid, m.missionType, MAV_MISSION_INVALID_SEQUENCE);
-        m.state = MISSION_IDLE;
-        return;
-    }
+    // Any item may be asked for in any order, so a GCS can keep several
+    // requests in flight and retry the ones it lost.
     if (req.seq >= m.totalCount) {
         sendAck(msg->sysid, msg->compid, m.missionType, MAV_MISSION_INVALID_SEQUENCE);
         m.state = MISSION_IDLE;
@@ -493,13 +568,9 @@ static void handleRequestInt(const mavlink_message_t *msg)
     }
 
     sendMissionItem(msg->sysid, msg->compid, req.seq);
-    if (req.seq == m.totalCount - 1) {
-        // Final item — partner is expected to send MISSION_ACK; drop to IDLE on receipt
-        // or via the SENDING-idle timeout.
-        m.nextSeq = req.seq + 1;
-    } else if (req.seq == m.nextSeq) {
-        m.nextSeq++;
-    }
+    // After the final item the partner is expected to send MISSION_ACK; drop
+    // to IDLE on receipt or via the SENDING-idle timeout.
+    m.nextSeq = MAX(m.nextSeq, req.seq + 1);
     m.lastActivityMs = millis();
 }
 
@@ -513,31 +584,25 @@ static void handleCount(const mavlink_message_t *msg)
     }
 
     if (mc.mission_type == MAV_MISSION_TYPE_FENCE) {
-        if (mc.count > MAX_FENCE_POINTS) {
+        // the executor enforces the fence, it is not swapped under a flying plan
+        if (FLIGHT_MODE(AUTOPILOT_MODE)) {
+            sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, MAV_MISSION_DENIED);
+            return;
+        }
+        if (mc.count > MAX_GEOFENCE_ITEMS) {
             sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, MAV_MISSION_NO_SPACE);
             return;
         }
-        // MAVLink semantics: MISSION_COUNT begins a full replacement, so drop
-        // the old fence up front (as the waypoint path does) rather than leave a
-        // half-overwritten store visible mid-transfer. A partner that aborts must
-        // re-upload; the fence is RAM-only and not yet enforced, so no armed
-        // behaviour depends on it surviving a failed transfer.
-        fenceStore.count = 0;
+        // Unlike the waypoint path the old fence stays in force while the new
+        // one is staged; it is replaced once the last item arrives.
         if (mc.count == 0) {
+            replaceFence(NULL, 0);
+            saveConfigAndNotify();
             sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, MAV_MISSION_ACCEPTED);
             m.state = MISSION_IDLE;
             return;
         }
-        m.state = MISSION_RECEIVING;
-        m.missionType = MAV_MISSION_TYPE_FENCE;
-        m.nextSeq = 0;
-        m.totalCount = mc.count;
-        m.partnerSys = msg->sysid;
-        m.partnerComp = msg->compid;
-        m.lastActivityMs = millis();
-        m.retries = 0;
-        m.rtlTerminator = false;
-        sendRequestInt(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, 0);
+        startUpload(msg, MAV_MISSION_TYPE_FENCE, mc.count);
         return;
     }
 
@@ -549,33 +614,27 @@ static void handleCount(const mavlink_message_t *msg)
         sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, MAV_MISSION_DENIED);
         return;
     }
-    if (mc.count > MAX_WAYPOINTS) {
+    if (mc.count > missionStoreGetCapacity()) {
         sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, MAV_MISSION_NO_SPACE);
         return;
     }
     if (mc.count == 0) {
-        flightPlanConfigMutable()->waypointCount = 0;
-        saveConfigAndNotify();
+        missionStoreClear();
+        saveMissionIfPg();
         sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, MAV_MISSION_ACCEPTED);
         m.state = MISSION_IDLE;
         return;
     }
 
-    // MAVLink semantics: a new upload replaces any existing mission. Zero the
-    // count immediately so any consumer (CLI dump, executor on next engage)
-    // doesn't see a half-overwritten waypoint table mid-transfer.
-    flightPlanConfigMutable()->waypointCount = 0;
+    // MAVLink semantics: a new upload replaces any existing mission. Beginning
+    // the write empties the store immediately so any consumer (CLI dump, executor
+    // on next engage) doesn't see a half-overwritten waypoint table mid-transfer.
+    if (!missionStoreBeginWrite(mc.count)) {
+        sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, MAV_MISSION_NO_SPACE);
+        return;
+    }
 
-    m.state = MISSION_RECEIVING;
-    m.missionType = MAV_MISSION_TYPE_MISSION;
-    m.nextSeq = 0;
-    m.totalCount = mc.count;
-    m.partnerSys = msg->sysid;
-    m.partnerComp = msg->compid;
-    m.lastActivityMs = millis();
-    m.retries = 0;
-    m.rtlTerminator = false;
-    sendRequestInt(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, 0);
+    startUpload(msg, MAV_MISSION_TYPE_MISSION, mc.count);
 }
 
 static void handleItemInt(const mavlink_message_t *msg)
@@ -593,64 +652,82 @@ static void handleItemInt(const mavlink_message_t *msg)
         abortUpload(MAV_MISSION_UNSUPPORTED);
         return;
     }
-    if (it.seq != m.nextSeq) {
+    // Items already taken come again when a retried request crosses the
+    // original answer; anything past the window was never asked for.
+    if (it.seq < m.nextSeq) {
+        return;
+    }
+    if (it.seq >= m.totalCount || it.seq >= m.nextSeq + MISSION_UPLOAD_WINDOW) {
         abortUpload(MAV_MISSION_INVALID_SEQUENCE);
         return;
     }
+    const uint8_t bit = uploadSlotBit(it.seq);
+    if (m.receivedMask & bit) {
+        return;
+    }
 
     if (m.missionType == MAV_MISSION_TYPE_FENCE) {
-        if (!isSupportedFenceCommand(it.command)) {
+        if (!mapFenceItem(&it, &fenceUpload[it.seq])) {
             abortUpload(MAV_MISSION_UNSUPPORTED);
             return;
         }
-        fenceStore.points[it.seq].command = it.command;
-        fenceStore.points[it.seq].lat = it.x;
-        fenceStore.points[it.seq].lon = it.y;
-        fenceStore.points[it.seq].param1 = it.param1;
-
-        m.nextSeq++;
-        m.lastActivityMs = millis();
-        m.retries = 0;
-
-        if (m.nextSeq < m.totalCount) {
-            sendRequestInt(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, m.nextSeq);
+    } else {
+        bool isRtl = false;
+        const bool isLastSlot = (it.seq == m.totalCount - 1);
+        uint8_t result = MAV_MISSION_ACCEPTED;
+        if (!mapMavCmdToWaypoint(&it, &missionUpload[it.seq % MISSION_UPLOAD_WINDOW], isLastSlot, &isRtl, &result)) {
+            abortUpload(result);
             return;
         }
-        fenceStore.count = (uint8_t)m.totalCount;
-        sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, MAV_MISSION_ACCEPTED);
-        m.state = MISSION_IDLE;
-        return;
+        // RTL discards its own slot; mission count finalises at the items before it.
+        m.rtlTerminator |= isRtl;
     }
 
-    waypoint_t wp;
-    bool isRtl = false;
-    const bool isLastSlot = (it.seq == m.totalCount - 1);
-    uint8_t result = MAV_MISSION_ACCEPTED;
-    if (!mapMavCmdToWaypoint(&it, &wp, isLastSlot, &isRtl, &result)) {
-        abortUpload(result);
-        return;
+    m.receivedMask |= bit;
+    m.requestedMask &= ~bit;
+    m.lastActivityMs = millis();
+    m.retries = 0;
+    if (m.windowSize < MISSION_UPLOAD_WINDOW) {
+        m.windowSize++;
     }
 
-    if (isRtl) {
-        // RTL discards its own slot; mission count finalises at items received so far.
-        m.rtlTerminator = true;
-    } else {
-        flightPlanConfigMutable()->waypoints[it.seq] = wp;
+    // Take everything now contiguous, in order
+    while (m.nextSeq < m.totalCount && (m.receivedMask & uploadSlotBit(m.nextSeq))) {
+        const uint16_t seq = m.nextSeq;
+        const bool isRtlSlot = m.rtlTerminator && seq == m.totalCount - 1;
+        if (m.missionType == MAV_MISSION_TYPE_MISSION && !isRtlSlot
+            && !missionStoreWriteWaypoint(seq, &missionUpload[seq % MISSION_UPLOAD_WINDOW])) {
+            abortUpload(MAV_MISSION_ERROR);
+            return;
+        }
+        m.receivedMask &= ~uploadSlotBit(seq);
+        m.nextSeq++;
     }
 
-    m.nextSeq++;
-    m.lastActivityMs = millis();
-    m.retries = 0;
-
     if (m.nextSeq < m.totalCount) {
-        sendRequestInt(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, m.nextSeq);
+        requestUploadWindow();
+        return;
+    }
+
+    // Upload complete: replace and persist once.
+    if (m.missionType == MAV_MISSION_TYPE_FENCE) {
+        if (!geofenceItemsValid(fenceUpload, m.totalCount)) {
+            abortUpload(MAV_MISSION_INVALID);
+            return;
+        }
+        replaceFence(fenceUpload, m.totalCount);
+        saveConfigAndNotify();
+        sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_FENCE, MAV_MISSION_ACCEPTED);
+        m.state = MISSION_IDLE;
         return;
     }
 
-    // Upload complete.
     const uint16_t finalCount = m.rtlTerminator ? m.totalCount - 1 : m.totalCount;
-    flightPlanConfigMutable()->waypointCount = finalCount;
-    saveConfigAndNotify();
+    if (!missionStoreCommit(finalCount)) {
+        abortUpload(MAV_MISSION_ERROR);
+        return;
+    }
+    saveMissionIfPg();
     sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, MAV_MISSION_ACCEPTED);
     m.state = MISSION_IDLE;
 }
@@ -671,16 +748,19 @@ static void handleClearAll(const mavlink_message_t *msg)
         sendAck(msg->sysid, msg->compid, mc.mission_type, MAV_MISSION_UNSUPPORTED);
         return;
     }
-    if (clearMission && FLIGHT_MODE(AUTOPILOT_MODE)) {
+    if (FLIGHT_MODE(AUTOPILOT_MODE)) {
         sendAck(msg->sysid, msg->compid, mc.mission_type, MAV_MISSION_DENIED);
         return;
     }
 
     if (clearFence) {
-        fenceStore.count = 0;
+        replaceFence(NULL, 0);
     }
     if (clearMission) {
-        flightPlanConfigMutable()->waypointCount = 0;
+        missionStoreClear();
+    }
+    // the fence is always in the configuration, the mission only with PG storage
+    if (clearFence || !missionStoreIsFlash()) {
         saveConfigAndNotify();
     }
     sendAck(msg->sysid, msg->compid, mc.mission_type, MAV_MISSION_ACCEPTED);
@@ -699,7 +779,7 @@ static void handleMissionAck(const mavlink_message_t *msg)
     }
 }
 
-static void onWaypointReached(uint8_t index)
+static void onWaypointReached(uint16_t index)
 {
     m.pendingReachedIndex = index;
 }
@@ -708,7 +788,7 @@ static void onWaypointReached(uint8_t index)
 // mavMissionUpdate() and once immediately in response to MISSION_SET_CURRENT.
 static void sendMissionCurrent(void)
 {
-    const uint16_t total = flightPlanConfig()->waypointCount;
+    const uint16_t total = missionStoreGetCount();
     const bool active = flightPlanNavIsActive();
     const uint16_t seq = (total && active && !flightPlanNavIsInjectedPlanActive())
         ? flightPlanNavGetCurrentIndex() : 0;
@@ -735,7 +815,7 @@ static void handleSetCurrent(const mavlink_message_t *msg)
     if (!targetIsUs(sc.target_system, sc.target_component)) {
         return;
     }
-    if (sc.seq > UINT8_MAX || !flightPlanNavSetCurrentIndex((uint8_t)sc.seq)) {
+    if (!flightPlanNavSetCurrentIndex(sc.seq)) {
         // Per spec, a failed SET_CURRENT is reported via MISSION_ACK(MAV_MISSION_ERROR).
         sendAck(msg->sysid, msg->compid, MAV_MISSION_TYPE_MISSION, MAV_MISSION_ERROR);
         return;
@@ -796,14 +876,29 @@ bool mavMissionHandleMessage(const mavlink_message_t *msg)
 
 void mavMissionUpdate(timeMs_t nowMs)
 {
-    // RECEIVING timeout: retransmit REQUEST_INT, give up after MAX_RETRY.
+    // Flash erases for an upload or clear run from here, never from the message
+    // handlers. The partner hears nothing until they are done; that is no retry.
+    missionStoreEraseAsync();
+    if (m.state == MISSION_RECEIVING && m.awaitingStore) {
+        m.lastActivityMs = nowMs;
+        if (missionStoreIsReady()) {
+            m.awaitingStore = false;
+            requestUploadWindow();
+        }
+    }
+
+    // RECEIVING timeout: give up after MAX_RETRY, otherwise close the window
+    // back down to the first missing item and request it again. Items already
+    // buffered beyond it are kept and the window reopens as answers arrive.
     if (m.state == MISSION_RECEIVING && (nowMs - m.lastActivityMs) >= MISSION_UPLOAD_RETRY_MS) {
         if (m.retries >= MISSION_UPLOAD_MAX_RETRY) {
             abortUpload(MAV_MISSION_OPERATION_CANCELLED);
         } else {
             m.retries++;
             m.lastActivityMs = nowMs;
-            sendRequestInt(m.partnerSys, m.partnerComp, m.missionType, m.nextSeq);
+            m.windowSize = 1;
+            m.requestedMask = 0;
+            requestUploadWindow();
         }
     }
 
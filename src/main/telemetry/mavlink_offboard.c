@@ -0,0 +1,634 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+
+#include "common/axis.h"
+#include "common/maths.h"
+#include "common/time.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+#include "drivers/time.h"
+
+#include "fc/runtime_config.h"
+
+#include "flight/flight_plan_nav.h"
+#include "flight/imu.h"
+#include "flight/pid.h"
+#include "flight/position_estimator.h"
+
+#include "io/serial.h"
+
+#include "pg/mavlink_offboard.h"
+
+#include "sensors/acceleration.h"
+#include "sensors/gyro.h"
+
+// This link parses on a channel of its own, and the MAVLink helpers keep a
+// status and message buffer per channel: one is all this file needs.
+#define MAVLINK_COMM_NUM_BUFFERS 1
+
+// mavlink library uses unnamed unions that causes GCC to complain if -Wpedantic
+// is used - ignore -Wpedantic for mavlink code.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "common/mavlink.h"
+#pragma GCC diagnostic pop
+
+#include "telemetry/mavlink_offboard.h"
+
+#define MAVLINK_OFFBOARD_SYSTEM_ID      1
+#define MAVLINK_OFFBOARD_COMPONENT_ID   MAV_COMP_ID_AUTOPILOT1
+
+// The default streams need about 560 kbit/s; a slower configured rate is
+// raised to this. Ignored by USB VCP.
+#define MAVLINK_OFFBOARD_MIN_BAUD       921600
+
+// Samples wait here between capture and the next update; 8 at 250 Hz is 32 ms
+#define MAVLINK_OFFBOARD_RING_SIZE      8
+#define MAVLINK_OFFBOARD_RX_BYTES_MAX   128u
+// One update packs everything due into a single buffered write, so a UART
+// with TX DMA sends the batch in one transfer
+#define MAVLINK_OFFBOARD_TX_BUFFER      512
+#define MAVLINK_OFFBOARD_ATTITUDE_BYTES (2 * MAVLINK_NUM_NON_PAYLOAD_BYTES \
+    + MAVLINK_MSG_ID_ATTITUDE_QUATERNION_LEN + MAVLINK_MSG_ID_HIGHRES_IMU_LEN)
+#define MAVLINK_OFFBOARD_POSITION_BYTES (2 * MAVLINK_NUM_NON_PAYLOAD_BYTES \
+    + MAVLINK_MSG_ID_LOCAL_POSITION_NED_LEN + MAVLINK_MSG_ID_ODOMETRY_LEN)
+
+#define MAVLINK_OFFBOARD_HEARTBEAT_US   1000000
+#define MAVLINK_OFFBOARD_TIMESYNC_US    1000000
+#define MAVLINK_OFFBOARD_RATE_WINDOW_US 1000000
+
+// TIMESYNC: replies slower than this say nothing useful about the offset; a
+// sample this far off the estimate means the companion clock was reset
+#define MAVLINK_OFFBOARD_TIMESYNC_RTT_MAX_NS    100000000LL
+#define MAVLINK_OFFBOARD_TIMESYNC_STEP_NS       1000000000LL
+// Setpoints stamped further than this from now are stale
+#define MAVLINK_OFFBOARD_SETPOINT_AGE_MAX_MS    500
+
+typedef struct {
+    uint64_t timeUs;
+    float q[4];                 // body FRD to earth NED, w x y z
+    float rateRadS[XYZ_AXIS_COUNT];
+    float accMps2[XYZ_AXIS_COUNT];
+} attitudeSample_t;
+
+typedef struct {
+    uint64_t timeUs;
+    float posNedM[3];
+    float velNedMps[3];
+    float q[4];
+    float rateRadS[XYZ_AXIS_COUNT];
+} positionSample_t;
+
+// head and tail count samples written and read; the ring holds their
+// difference. Captures and the update run from the same scheduler loop.
+typedef struct {
+    uint8_t head;
+    uint8_t tail;
+    uint32_t intervalUs;
+    timeUs_t nextDueUs;
+    uint16_t capturedInWindow;
+    uint16_t rateHz;
+} sampleRing_t;
+
+static struct {
+    int64_t offsetNs;           // companion clock minus ours
+    int64_t rttNs;              // of the best recent sample
+    int64_t pendingTs1Ns;       // our request awaiting its reply
+    bool valid;
+} timesync;
+
+static serialPort_t *offboardPort = NULL;
+static mavlink_message_t txMsg;
+static mavlink_message_t rxMsg;
+static mavlink_status_t rxStatus;
+static uint8_t txBuffer[MAVLINK_OFFBOARD_TX_BUFFER];
+
+static sampleRing_t attitudeRing;
+static attitudeSample_t attitudeSamples[MAVLINK_OFFBOARD_RING_SIZE];
+static sampleRing_t positionRing;
+static positionSample_t positionSamples[MAVLINK_OFFBOARD_RING_SIZE];
+
+static uint32_t droppedSamples;
+static uint32_t setpointsAccepted;
+static uint32_t setpointsRejected;
+static timeUs_t rateWindowStartUs;
+static timeUs_t nextHeartbeatUs;
+static timeUs_t nextTimesyncUs;
+
+// Setpoint axes a companion leaves out keep their last commanded value
+static bool lastSetpointValid;
+static vector3_t lastSetpointEnuM;
+
+// timeUs_t wraps after about 71 minutes, MAVLink's time_usec does not.
+// Readings from the capture hooks and the update only move forward, apart
+// from the odd one stamped a little before the latest.
+static uint64_t extendTimeUs(timeUs_t timeUs)
+{
+#ifdef USE_64BIT_TIME
+    return timeUs;
+#else
+    static uint32_t epoch;
+    static timeUs_t latestUs;
+    if (cmpTimeUs(timeUs, latestUs) > 0) {
+        if (timeUs < latestUs) {
+            epoch++;
+        }
+        latestUs = timeUs;
+    }
+    // stamped before the latest reading, but on the far side of a wrap
+    const bool previousEpoch = timeUs > latestUs;
+    return ((uint64_t)(epoch - previousEpoch) << 32) | timeUs;
+#endif
+}
+
+static uint8_t ringCount(const sampleRing_t *ring)
+{
+    return (uint8_t)(ring->head - ring->tail);
+}
+
+// Returns the slot to fill; a full ring gives up its oldest sample
+static uint8_t ringPush(sampleRing_t *ring)
+{
+    if (ringCount(ring) == MAVLINK_OFFBOARD_RING_SIZE) {
+        ring->tail++;
+        droppedSamples++;
+    }
+    ring->capturedInWindow++;
+    return ring->head++ % MAVLINK_OFFBOARD_RING_SIZE;
+}
+
+static uint8_t ringPeek(const sampleRing_t *ring)
+{
+    return ring->tail % MAVLINK_OFFBOARD_RING_SIZE;
+}
+
+// Decimate the producer to the stream rate. The producing task may run at
+// the stream rate itself, so allow a little early rather than miss every
+// other sample to jitter; a slipped cadence restarts instead of bursting.
+static bool ringDue(sampleRing_t *ring, timeUs_t currentTimeUs)
+{
+    if (!ring->intervalUs || cmpTimeUs(currentTimeUs, ring->nextDueUs) < -(timeDelta_t)(ring->intervalUs / 4)) {
+        return false;
+    }
+    ring->nextDueUs += ring->intervalUs;
+    if (cmpTimeUs(currentTimeUs, ring->nextDueUs) >= 0) {
+        ring->nextDueUs = currentTimeUs + ring->intervalUs;
+    }
+    return true;
+}
+
+static void ringInit(sampleRing_t *ring, uint8_t rateHz, timeUs_t currentTimeUs)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->intervalUs = rateHz ? 1000000 / rateHz : 0;
+    ring->nextDueUs = currentTimeUs;
+}
+
+// Betaflight's attitude is body FLU in earth NWU, MAVLink's body FRD in earth
+// NED. Both frames turn half a revolution about their x axis, which negates
+// the y and z components of the quaternion and of every body vector.
+STATIC_UNIT_TESTED void captureBodyState(float q[4], float rateRadS[XYZ_AXIS_COUNT])
+{
+    quaternion_t attitudeQ;
+    getQuaternion(&attitudeQ);
+    q[0] = attitudeQ.w;
+    q[1] = attitudeQ.x;
+    q[2] = -attitudeQ.y;
+    q[3] = -attitudeQ.z;
+    rateRadS[X] = DEGREES_TO_RADIANS(gyro.gyroADCf[X]);
+    rateRadS[Y] = -DEGREES_TO_RADIANS(gyro.gyroADCf[Y]);
+    rateRadS[Z] = -DEGREES_TO_RADIANS(gyro.gyroADCf[Z]);
+}
+
+void mavlinkOffboardCaptureAttitude(timeUs_t currentTimeUs)
+{
+    if (!offboardPort || !ringDue(&attitudeRing, currentTimeUs)) {
+        return;
+    }
+    attitudeSample_t *sample = &attitudeSamples[ringPush(&attitudeRing)];
+    sample->timeUs = extendTimeUs(currentTimeUs);
+    captureBodyState(sample->q, sample->rateRadS);
+    const float scale = acc.dev.acc_1G_rec * G_ACCELERATION;
+    sample->accMps2[X] = acc.accADC.x * scale;
+    sample->accMps2[Y] = -acc.accADC.y * scale;
+    sample->accMps2[Z] = -acc.accADC.z * scale;
+}
+
+void mavlinkOffboardCapturePosition(timeUs_t currentTimeUs)
+{
+    // No XY estimate, no local position: the companion sees the stream stop
+    if (!offboardPort || !positionEstimatorIsValidXY() || !ringDue(&positionRing, currentTimeUs)) {
+        return;
+    }
+    const positionEstimate3d_t *est = positionEstimatorGetEstimate();
+    positionSample_t *sample = &positionSamples[ringPush(&positionRing)];
+    sample->timeUs = extendTimeUs(currentTimeUs);
+    sample->posNedM[0] = est->position.v[ENU_N] * 0.01f;
+    sample->posNedM[1] = est->position.v[ENU_E] * 0.01f;
+    sample->posNedM[2] = -est->position.v[ENU_U] * 0.01f;
+    sample->velNedMps[0] = est->velocity.v[ENU_N] * 0.01f;
+    sample->velNedMps[1] = est->velocity.v[ENU_E] * 0.01f;
+    sample->velNedMps[2] = -est->velocity.v[ENU_U] * 0.01f;
+    captureBodyState(sample->q, sample->rateRadS);
+}
+
+// v (earth NED) into the body frame: the transpose of the rotation q describes
+STATIC_UNIT_TESTED void rotateNedToBody(const float q[4], const float v[3], float out[3])
+{
+    const float w = q[0], x = q[1], y = q[2], z = q[3];
+    out[0] = (1 - 2 * (y * y + z * z)) * v[0] + 2 * (x * y + w * z) * v[1] + 2 * (x * z - w * y) * v[2];
+    out[1] = 2 * (x * y - w * z) * v[0] + (1 - 2 * (x * x + z * z)) * v[1] + 2 * (y * z + w * x) * v[2];
+    out[2] = 2 * (x * z + w * y) * v[0] + 2 * (y * z - w * x) * v[1] + (1 - 2 * (x * x + y * y)) * v[2];
+}
+
+static uint16_t packAttitude(uint8_t *buf, const attitudeSample_t *sample)
+{
+    static const float noReprOffset[4] = { 0 };
+    mavlink_msg_attitude_quaternion_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+        sample->timeUs / 1000,
+        sample->q[0], sample->q[1], sample->q[2], sample->q[3],
+        sample->rateRadS[X], sample->rateRadS[Y], sample->rateRadS[Z],
+        noReprOffset);
+    uint16_t length = mavlink_msg_to_send_buffer(buf, &txMsg);
+
+    mavlink_msg_highres_imu_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+        sample->timeUs,
+        sample->accMps2[X], sample->accMps2[Y], sample->accMps2[Z],
+        sample->rateRadS[X], sample->rateRadS[Y], sample->rateRadS[Z],
+        0, 0, 0,                // magnetometer
+        0, 0, 0, 0,             // pressures, temperature
+        HIGHRES_IMU_UPDATED_XACC | HIGHRES_IMU_UPDATED_YACC | HIGHRES_IMU_UPDATED_ZACC
+            | HIGHRES_IMU_UPDATED_XGYRO | HIGHRES_IMU_UPDATED_YGYRO | HIGHRES_IMU_UPDATED_ZGYRO,
+        0);
+    length += mavlink_msg_to_send_buffer(buf + length, &txMsg);
+    return length;
+}
+
+static uint16_t packPosition(uint8_t *buf, const positionSample_t *sample)
+{
+    mavlink_msg_local_position_ned_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+        sample->timeUs / 1000,
+        sample->posNedM[0], sample->posNedM[1], sample->posNedM[2],
+        sample->velNedMps[0], sample->velNedMps[1], sample->velNedMps[2]);
+    uint16_t length = mavlink_msg_to_send_buffer(buf, &txMsg);
+
+    // ODOMETRY carries its velocity in the child (body) frame
+    float velBodyMps[3];
+    rotateNedToBody(sample->q, sample->velNedMps, velBodyMps);
+    static const float unknownCovariance[21] = { NAN };
+    mavlink_msg_odometry_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+        sample->timeUs, MAV_FRAME_LOCAL_NED, MAV_FRAME_BODY_FRD,
+        sample->posNedM[0], sample->posNedM[1], sample->posNedM[2],
+        sample->q,
+        velBodyMps[0], velBodyMps[1], velBodyMps[2],
+        sample->rateRadS[X], sample->rateRadS[Y], sample->rateRadS[Z],
+        unknownCovariance, unknownCovariance,
+        0, MAV_ESTIMATOR_TYPE_AUTOPILOT, 0);
+    length += mavlink_msg_to_send_buffer(buf + length, &txMsg);
+    return length;
+}
+
+// Oldest sample first across both rings, for as long as the batch buffer and
+// the port's transmit buffer have room for it. What does not fit waits for
+// the next update, or is overwritten if the link cannot keep up; a position
+// sample that does not fit lets the smaller attitude samples past it rather
+// than holding up both streams.
+STATIC_UNIT_TESTED uint16_t packPendingSamples(uint8_t *buf, uint16_t room)
+{
+    uint16_t length = 0;
+    bool positionFits = true;
+    for (;;) {
+        const bool haveAttitude = ringCount(&attitudeRing) > 0;
+        const bool havePosition = positionFits && ringCount(&positionRing) > 0;
+        if (!haveAttitude && !havePosition) {
+            break;
+        }
+        const attitudeSample_t *attitudeSample = &attitudeSamples[ringPeek(&attitudeRing)];
+        const positionSample_t *positionSample = &positionSamples[ringPeek(&positionRing)];
+        const bool attitudeFirst = haveAttitude && (!havePosition || attitudeSample->timeUs <= positionSample->timeUs);
+        if (attitudeFirst) {
+            if (room - length < MAVLINK_OFFBOARD_ATTITUDE_BYTES) {
+                break;
+            }
+            length += packAttitude(buf + length, attitudeSample);
+            attitudeRing.tail++;
+        } else {
+            if (room - length < MAVLINK_OFFBOARD_POSITION_BYTES) {
+                positionFits = false;
+                continue;
+            }
+            length += packPosition(buf + length, positionSample);
+            positionRing.tail++;
+        }
+    }
+    return length;
+}
+
+static void sendMessage(void)
+{
+    const uint16_t length = mavlink_msg_to_send_buffer(txBuffer, &txMsg);
+    if (serialTxBytesFree(offboardPort) >= length) {
+        serialWriteBuf(offboardPort, txBuffer, length);
+    }
+}
+
+static void sendHeartbeat(void)
+{
+    uint8_t baseMode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
+    if (ARMING_FLAG(ARMED)) {
+        baseMode |= MAV_MODE_FLAG_SAFETY_ARMED;
+    }
+    if (flightPlanNavIsExternalTargetActive()) {
+        baseMode |= MAV_MODE_FLAG_GUIDED_ENABLED;
+    }
+    mavlink_msg_heartbeat_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+        MAV_TYPE_GENERIC_MULTIROTOR, MAV_AUTOPILOT_GENERIC, baseMode, 0,
+        ARMING_FLAG(ARMED) ? MAV_STATE_ACTIVE : MAV_STATE_STANDBY);
+    sendMessage();
+}
+
+static int64_t nowNs(void)
+{
+    return (int64_t)extendTimeUs(micros()) * 1000;
+}
+
+// One reply to our request: the companion stamped tc1 somewhere within the
+// round trip, taken as its middle. The offset follows the samples with the
+// shortest round trips, whose midpoint guess is the tightest; the best round
+// trip ages so the estimate keeps following a drifting clock.
+STATIC_UNIT_TESTED void timesyncSample(int64_t tc1Ns, int64_t ts1Ns, int64_t receivedNs)
+{
+    const int64_t rttNs = receivedNs - ts1Ns;
+    if (rttNs <= 0 || rttNs > MAVLINK_OFFBOARD_TIMESYNC_RTT_MAX_NS) {
+        return;
+    }
+    const int64_t sampleNs = tc1Ns - (ts1Ns + rttNs / 2);
+    if (!timesync.valid || llabs(sampleNs - timesync.offsetNs) > MAVLINK_OFFBOARD_TIMESYNC_STEP_NS) {
+        timesync.offsetNs = sampleNs;
+        timesync.rttNs = rttNs;
+        timesync.valid = true;
+        return;
+    }
+    timesync.rttNs += timesync.rttNs / 8;
+    if (rttNs <= timesync.rttNs) {
+        timesync.rttNs = rttNs;
+        timesync.offsetNs += (sampleNs - timesync.offsetNs) / 4;
+    }
+}
+
+static void handleTimesync(const mavlink_message_t *msg)
+{
+    mavlink_timesync_t request;
+    mavlink_msg_timesync_decode(msg, &request);
+
+    if (request.tc1 == 0) {
+        // The companion aligning its clock to ours
+        mavlink_msg_timesync_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+            nowNs(), request.ts1, msg->sysid, msg->compid);
+        sendMessage();
+    } else if (request.ts1 == timesync.pendingTs1Ns) {
+        timesyncSample(request.tc1, request.ts1, nowNs());
+        timesync.pendingTs1Ns = 0;
+    }
+}
+
+static void sendTimesyncRequest(void)
+{
+    timesync.pendingTs1Ns = nowNs();
+    mavlink_msg_timesync_pack(MAVLINK_OFFBOARD_SYSTEM_ID, MAVLINK_OFFBOARD_COMPONENT_ID, &txMsg,
+        0, timesync.pendingTs1Ns, 0, 0);
+    sendMessage();
+}
+
+// Setpoint stamps are accepted in our time base (a companion that aligned its
+// clock with TIMESYNC, as MAVROS does) or in the companion's own once the
+// offset is known. 0 means unstamped.
+STATIC_UNIT_TESTED bool setpointIsFresh(uint32_t stampMs, timeMs_t nowMs)
+{
+    if (stampMs == 0 || ABS((int32_t)(nowMs - stampMs)) <= MAVLINK_OFFBOARD_SETPOINT_AGE_MAX_MS) {
+        return true;
+    }
+    if (!timesync.valid) {
+        return false;
+    }
+    const uint32_t oursMs = stampMs - (uint32_t)(timesync.offsetNs / 1000000);
+    return ABS((int32_t)(nowMs - oursMs)) <= MAVLINK_OFFBOARD_SETPOINT_AGE_MAX_MS;
+}
+
+// Local NED (absolute, or offset from the current position) to the position
+// estimator's ENU metres. Axes the type mask leaves out hold: XY at the last
+// setpoint or the current position, Z likewise. Returns false for frames and
+// masks that cannot be flown.
+STATIC_UNIT_TESTED bool setpointToEnu(const mavlink_set_position_target_local_ned_t *sp,
+                                      const positionEstimate3d_t *est,
+                                      vector3_t *posEnuM, vector3_t *velEnuMps, bool *velValid, float *headingDeg)
+{
+    if (sp->coordinate_frame != MAV_FRAME_LOCAL_NED && sp->coordinate_frame != MAV_FRAME_LOCAL_OFFSET_NED) {
+        return false;
+    }
+    const uint16_t mask = sp->type_mask;
+    const bool xyIgnored = mask & (POSITION_TARGET_TYPEMASK_X_IGNORE | POSITION_TARGET_TYPEMASK_Y_IGNORE);
+    const bool zIgnored = mask & POSITION_TARGET_TYPEMASK_Z_IGNORE;
+    *velValid = !(mask & (POSITION_TARGET_TYPEMASK_VX_IGNORE | POSITION_TARGET_TYPEMASK_VY_IGNORE));
+    if (xyIgnored && !*velValid) {
+        return false;
+    }
+
+    const vector3_t currentEnuM = {.v = {
+        [ENU_E] = est->position.v[ENU_E] * 0.01f,
+        [ENU_N] = est->position.v[ENU_N] * 0.01f,
+        [ENU_U] = est->position.v[ENU_U] * 0.01f,
+    }};
+    const vector3_t *holdEnuM = lastSetpointValid ? &lastSetpointEnuM : &currentEnuM;
+    const bool offset = sp->coordinate_frame == MAV_FRAME_LOCAL_OFFSET_NED;
+
+    if (xyIgnored) {
+        // Velocity only: anchor on the craft, the feedforward does the flying
+        posEnuM->v[ENU_E] = currentEnuM.v[ENU_E];
+        posEnuM->v[ENU_N] = currentEnuM.v[ENU_N];
+    } else {
+        posEnuM->v[ENU_E] = sp->y + (offset ? currentEnuM.v[ENU_E] : 0.0f);
+        posEnuM->v[ENU_N] = sp->x + (offset ? currentEnuM.v[ENU_N] : 0.0f);
+    }
+    posEnuM->v[ENU_U] = zIgnored ? holdEnuM->v[ENU_U] : -sp->z + (offset ? currentEnuM.v[ENU_U] : 0.0f);
+
+    if (*velValid) {
+        velEnuMps->v[ENU_E] = sp->vy;
+        velEnuMps->v[ENU_N] = sp->vx;
+        velEnuMps->v[ENU_U] = (mask & POSITION_TARGET_TYPEMASK_VZ_IGNORE) ? 0.0f : -sp->vz;
+    }
+
+    *headingDeg = -1.0f;
+    if (!(mask & POSITION_TARGET_TYPEMASK_YAW_IGNORE)) {
+        // NED yaw is already a compass heading
+        *headingDeg = fmodf(RADIANS_TO_DEGREES(sp->yaw) + 360.0f, 360.0f);
+    }
+    return true;
+}
+
+static void handleSetPositionTarget(const mavlink_message_t *msg, timeUs_t currentTimeUs)
+{
+    mavlink_set_position_target_local_ned_t sp;
+    mavlink_msg_set_position_target_local_ned_decode(msg, &sp);
+
+    if ((sp.target_system != 0 && sp.target_system != MAVLINK_OFFBOARD_SYSTEM_ID)
+        || (sp.target_component != 0 && sp.target_component != MAVLINK_OFFBOARD_COMPONENT_ID)) {
+        return;
+    }
+
+    if (!flightPlanNavIsExternalTargetActive()) {
+        lastSetpointValid = false;
+    }
+
+    vector3_t posEnuM;
+    vector3_t velEnuMps;
+    bool velValid;
+    float headingDeg;
+    if (!setpointIsFresh(sp.time_boot_ms, millis())
+        || !setpointToEnu(&sp, positionEstimatorGetEstimate(), &posEnuM, &velEnuMps, &velValid, &headingDeg)
+        || !flightPlanNavSetExternalTarget(&posEnuM, velValid ? &velEnuMps : NULL, headingDeg, currentTimeUs)) {
+        setpointsRejected++;
+        return;
+    }
+    lastSetpointEnuM = posEnuM;
+    lastSetpointValid = true;
+    setpointsAccepted++;
+}
+
+static void processReceivedBytes(timeUs_t currentTimeUs)
+{
+    uint32_t waiting = MIN(serialRxBytesWaiting(offboardPort), MAVLINK_OFFBOARD_RX_BYTES_MAX);
+    while (waiting--) {
+        if (mavlink_parse_char(MAVLINK_COMM_0, serialRead(offboardPort), &rxMsg, &rxStatus) != MAVLINK_FRAMING_OK) {
+            continue;
+        }
+        switch (rxMsg.msgid) {
+        case MAVLINK_MSG_ID_TIMESYNC:
+            handleTimesync(&rxMsg);
+            break;
+        case MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED:
+            handleSetPositionTarget(&rxMsg, currentTimeUs);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void mavlinkOffboardUpdate(timeUs_t currentTimeUs)
+{
+    if (!offboardPort) {
+        return;
+    }
+
+    processReceivedBytes(currentTimeUs);
+
+    if (cmpTimeUs(currentTimeUs, nextHeartbeatUs) >= 0) {
+        nextHeartbeatUs = currentTimeUs + MAVLINK_OFFBOARD_HEARTBEAT_US;
+        sendHeartbeat();
+    }
+    if (cmpTimeUs(currentTimeUs, nextTimesyncUs) >= 0) {
+        nextTimesyncUs = currentTimeUs + MAVLINK_OFFBOARD_TIMESYNC_US;
+        sendTimesyncRequest();
+    }
+
+    const uint16_t room = MIN(serialTxBytesFree(offboardPort), sizeof(txBuffer));
+    const uint16_t length = packPendingSamples(txBuffer, room);
+    if (length) {
+        serialWriteBuf(offboardPort, txBuffer, length);
+    }
+
+    if (cmpTimeUs(currentTimeUs, rateWindowStartUs) >= MAVLINK_OFFBOARD_RATE_WINDOW_US) {
+        attitudeRing.rateHz = attitudeRing.capturedInWindow;
+        positionRing.rateHz = positionRing.capturedInWindow;
+        attitudeRing.capturedInWindow = 0;
+        positionRing.capturedInWindow = 0;
+        rateWindowStartUs = currentTimeUs;
+    }
+}
+
+void mavlinkOffboardInit(void)
+{
+    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_MAVLINK_OFFBOARD);
+    if (!portConfig) {
+        return;
+    }
+
+    uint8_t baudRateIndex = portConfig->telemetry_baudrateIndex;
+    if (baudRateIndex >= BAUD_COUNT) {
+        baudRateIndex = BAUD_921600;
+    }
+    const uint32_t baudRate = MAX(baudRates[baudRateIndex], (uint32_t)MAVLINK_OFFBOARD_MIN_BAUD);
+
+    offboardPort = openSerialPort(portConfig->identifier, FUNCTION_MAVLINK_OFFBOARD, NULL, NULL,
+        baudRate, MODE_RXTX, SERIAL_NOT_INVERTED);
+    if (!offboardPort) {
+        return;
+    }
+
+    // A transmit buffer too small for a whole position batch would never
+    // send one, so leave that stream off rather than capture into the void
+    const timeUs_t nowUs = micros();
+    const bool positionFits = serialTxBytesFree(offboardPort) >= MAVLINK_OFFBOARD_POSITION_BYTES;
+    ringInit(&attitudeRing, mavlinkOffboardConfig()->offboard_attitude_rate_hz, nowUs);
+    ringInit(&positionRing, positionFits ? mavlinkOffboardConfig()->offboard_position_rate_hz : 0, nowUs);
+    rateWindowStartUs = nowUs;
+    nextHeartbeatUs = nowUs;
+    nextTimesyncUs = nowUs;
+    memset(&timesync, 0, sizeof(timesync));
+    lastSetpointValid = false;
+    mavlink_reset_channel_status(MAVLINK_COMM_0);
+}
+
+bool mavlinkOffboardIsEnabled(void)
+{
+    return offboardPort != NULL;
+}
+
+uint16_t mavlinkOffboardAttitudeRateHz(void)
+{
+    return offboardPort ? mavlinkOffboardConfig()->offboard_attitude_rate_hz : 0;
+}
+
+void mavlinkOffboardGetStatus(mavlinkOffboardStatus_t *status)
+{
+    status->attitudeRateHz = attitudeRing.rateHz;
+    status->positionRateHz = positionRing.rateHz;
+    status->droppedSamples = droppedSamples;
+    status->setpointsAccepted = setpointsAccepted;
+    status->setpointsRejected = setpointsRejected;
+    status->timesyncValid = timesync.valid;
+    status->timesyncOffsetNs = timesync.offsetNs;
+    status->timesyncRttUs = timesync.rttNs / 1000;
+}
+
+#endif // ENABLE_TELEMETRY_MAVLINK_OFFBOARD
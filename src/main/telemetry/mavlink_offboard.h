@@ -0,0 +1,68 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "common/time.h"
+
+// Dedicated high-rate MAVLink link for a companion computer: attitude, IMU
+// and local position streamed at estimator rate from timestamped sample
+// rings, TIMESYNC in both directions, and SET_POSITION_TARGET_LOCAL_NED
+// setpoints handed to the flight-plan executor. Runs on its own port
+// (FUNCTION_MAVLINK_OFFBOARD), beside and independent of MAVLink telemetry.
+
+#if ENABLE_TELEMETRY_MAVLINK_OFFBOARD
+
+typedef struct mavlinkOffboardStatus_s {
+    uint16_t attitudeRateHz;            // samples captured over the last second
+    uint16_t positionRateHz;
+    uint32_t droppedSamples;            // overwritten before the link could send them
+    uint32_t setpointsAccepted;
+    uint32_t setpointsRejected;         // wrong frame or target, stale, or executor not engaged
+    bool timesyncValid;
+    int64_t timesyncOffsetNs;           // companion clock minus ours
+    uint32_t timesyncRttUs;
+} mavlinkOffboardStatus_t;
+
+void mavlinkOffboardInit(void);
+bool mavlinkOffboardIsEnabled(void);
+void mavlinkOffboardUpdate(timeUs_t currentTimeUs);
+
+// Sample hooks, called where the data is produced: after each attitude update
+// and after each position estimator update. Decimated to the configured rates.
+void mavlinkOffboardCaptureAttitude(timeUs_t currentTimeUs);
+void mavlinkOffboardCapturePosition(timeUs_t currentTimeUs);
+
+// Attitude task rate the link needs, 0 when it is not running
+uint16_t mavlinkOffboardAttitudeRateHz(void);
+
+void mavlinkOffboardGetStatus(mavlinkOffboardStatus_t *status);
+
+#else
+
+static inline uint16_t mavlinkOffboardAttitudeRateHz(void) { return 0; }
+
+#endif // ENABLE_TELEMETRY_MAVLINK_OFFBOARD
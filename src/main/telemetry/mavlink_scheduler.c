@@ -0,0 +1,255 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#if defined(USE_TELEMETRY_MAVLINK)
+
+#include "common/maths.h"
+#include "common/time.h"
+
+#include "telemetry/mavlink_scheduler.h"
+
+// Share of the budget the streams are planned against; the rest carries
+// traffic sent on demand (acks, mission and parameter replies)
+#define MAVLINK_SCHEDULER_STREAM_SHARE  0.875f
+// A priority level is slowed down to this fraction of its requested rate
+// before the level above it gives anything up
+#define MAVLINK_SCHEDULER_MIN_SCALE     0.125f
+// Largest burst, so a quiet spell does not save up a flood: 100 ms of
+// budget, but never less than the longest MAVLink 2 packet
+#define MAVLINK_SCHEDULER_BURST_MIN     280
+#define MAVLINK_SCHEDULER_BURST_DIVIDER 10
+// Radio back-pressure: multiplicative decrease down to a floor, additive
+// increase back up to the serial link rate
+#define MAVLINK_SCHEDULER_BUDGET_MIN    100
+#define MAVLINK_SCHEDULER_FLOOR_DIVIDER 16
+#define MAVLINK_SCHEDULER_BACKOFF_NUM   3
+#define MAVLINK_SCHEDULER_BACKOFF_DEN   4
+#define MAVLINK_SCHEDULER_RECOVER_DIVIDER 32
+// Streams set together are phase-staggered by this much each
+#define MAVLINK_SCHEDULER_STAGGER_US    3000
+#define MAVLINK_SCHEDULER_WINDOW_US     1000000
+
+static int32_t burstBytes(const mavlinkScheduler_t *scheduler)
+{
+    return MAX(MAVLINK_SCHEDULER_BURST_MIN, (int32_t)(scheduler->budgetBytesPerSec / MAVLINK_SCHEDULER_BURST_DIVIDER));
+}
+
+void mavlinkSchedulerInit(mavlinkScheduler_t *scheduler, uint32_t baudRate, timeUs_t currentTimeUs)
+{
+    memset(scheduler, 0, sizeof(*scheduler));
+    // 8N1: ten bit times a byte
+    scheduler->linkBytesPerSec = MAX(baudRate / 10, MAVLINK_SCHEDULER_BUDGET_MIN);
+    scheduler->budgetBytesPerSec = scheduler->linkBytesPerSec;
+    scheduler->tokens = burstBytes(scheduler);
+    scheduler->refillUs = currentTimeUs;
+    scheduler->windowStartUs = currentTimeUs;
+}
+
+int mavlinkSchedulerAddStream(mavlinkScheduler_t *scheduler, uint16_t bytes, mavlinkPriority_e priority)
+{
+    if (scheduler->count >= MAVLINK_SCHEDULER_STREAMS_MAX) {
+        return -1;
+    }
+    mavlinkStreamSchedule_t *stream = &scheduler->streams[scheduler->count];
+    memset(stream, 0, sizeof(*stream));
+    stream->bytes = bytes;
+    stream->priority = priority;
+    return scheduler->count++;
+}
+
+void mavlinkSchedulerSetInterval(mavlinkScheduler_t *scheduler, int index, uint32_t intervalUs, timeUs_t currentTimeUs)
+{
+    mavlinkStreamSchedule_t *stream = &scheduler->streams[index];
+    stream->requestedIntervalUs = intervalUs;
+    stream->grantedIntervalUs = intervalUs;
+    stream->nextDueUs = currentTimeUs + intervalUs + index * MAVLINK_SCHEDULER_STAGGER_US;
+    stream->sentInWindow = 0;
+    stream->achievedRateDeciHz = 0;
+    scheduler->allocationDirty = true;
+}
+
+void mavlinkSchedulerRadioStatus(mavlinkScheduler_t *scheduler, uint8_t txbufPercent, uint8_t minTxbufPercent)
+{
+    const uint32_t budget = scheduler->budgetBytesPerSec;
+    if (txbufPercent < minTxbufPercent) {
+        const uint32_t floor = MAX(scheduler->linkBytesPerSec / MAVLINK_SCHEDULER_FLOOR_DIVIDER, MAVLINK_SCHEDULER_BUDGET_MIN);
+        scheduler->budgetBytesPerSec = MAX(budget * MAVLINK_SCHEDULER_BACKOFF_NUM / MAVLINK_SCHEDULER_BACKOFF_DEN, floor);
+    } else if (txbufPercent > (minTxbufPercent + 100) / 2) {
+        scheduler->budgetBytesPerSec = MIN(budget + scheduler->linkBytesPerSec / MAVLINK_SCHEDULER_RECOVER_DIVIDER, scheduler->linkBytesPerSec);
+    }
+    if (scheduler->budgetBytesPerSec != budget) {
+        scheduler->tokens = MIN(scheduler->tokens, burstBytes(scheduler));
+        scheduler->allocationDirty = true;
+    }
+}
+
+void mavlinkSchedulerCharge(mavlinkScheduler_t *scheduler, uint32_t bytes)
+{
+    // Debt is bounded to a second of budget so one large reply cannot
+    // silence the streams for longer than that
+    const int32_t floor = -(int32_t)scheduler->budgetBytesPerSec;
+    scheduler->tokens = MAX(scheduler->tokens - (int32_t)MIN(bytes, scheduler->budgetBytesPerSec), floor);
+}
+
+// Grant rates that fit the budget. Levels are served from the top: each
+// takes what it asked for if it fits, keeping back only the floor the
+// levels below are entitled to, so the lowest priority is slowed first and
+// the highest last.
+static void mavlinkSchedulerAllocate(mavlinkScheduler_t *scheduler, timeUs_t currentTimeUs)
+{
+    float demand[MAVLINK_PRIORITY_COUNT] = { 0 };
+    for (int i = 0; i < scheduler->count; i++) {
+        const mavlinkStreamSchedule_t *stream = &scheduler->streams[i];
+        if (stream->requestedIntervalUs) {
+            demand[stream->priority] += stream->bytes * 1e6f / stream->requestedIntervalUs;
+        }
+    }
+
+    float scale[MAVLINK_PRIORITY_COUNT];
+    float available = scheduler->budgetBytesPerSec * MAVLINK_SCHEDULER_STREAM_SHARE;
+    for (int level = MAVLINK_PRIORITY_COUNT - 1; level >= 0; level--) {
+        float reserved = 0;
+        for (int below = 0; below < level; below++) {
+            reserved += demand[below] * MAVLINK_SCHEDULER_MIN_SCALE;
+        }
+        scale[level] = 1.0f;
+        if (demand[level] > 0) {
+            scale[level] = constrainf((available - reserved) / demand[level], MAVLINK_SCHEDULER_MIN_SCALE, 1.0f);
+        }
+        available -= demand[level] * scale[level];
+    }
+
+    for (int i = 0; i < scheduler->count; i++) {
+        mavlinkStreamSchedule_t *stream = &scheduler->streams[i];
+        if (!stream->requestedIntervalUs) {
+            continue;
+        }
+        stream->grantedIntervalUs = (uint32_t)MIN(stream->requestedIntervalUs / scale[stream->priority], (float)UINT32_MAX / 2);
+        // A stream sped back up should not sit out the rest of a long interval
+        if (cmpTimeUs(stream->nextDueUs, currentTimeUs) > (timeDelta_t)stream->grantedIntervalUs) {
+            stream->nextDueUs = currentTimeUs + stream->grantedIntervalUs;
+        }
+    }
+    scheduler->allocationDirty = false;
+}
+
+static void mavlinkSchedulerRefill(mavlinkScheduler_t *scheduler, timeUs_t currentTimeUs)
+{
+    const timeDelta_t elapsedUs = cmpTimeUs(currentTimeUs, scheduler->refillUs);
+    if (elapsedUs <= 0) {
+        return;
+    }
+    const int32_t burst = burstBytes(scheduler);
+    const uint32_t credit = (uint64_t)scheduler->budgetBytesPerSec * elapsedUs / 1000000;
+    if (scheduler->tokens + (int64_t)credit >= burst) {
+        scheduler->tokens = burst;
+        scheduler->refillUs = currentTimeUs;
+    } else if (credit > 0) {
+        scheduler->tokens += credit;
+        // Keep the fraction of a byte not credited yet for the next refill
+        scheduler->refillUs += (uint64_t)credit * 1000000 / scheduler->budgetBytesPerSec;
+    }
+}
+
+static void mavlinkSchedulerMeasure(mavlinkScheduler_t *scheduler, timeUs_t currentTimeUs)
+{
+    const timeDelta_t elapsedUs = cmpTimeUs(currentTimeUs, scheduler->windowStartUs);
+    if (elapsedUs < MAVLINK_SCHEDULER_WINDOW_US) {
+        return;
+    }
+    for (int i = 0; i < scheduler->count; i++) {
+        mavlinkStreamSchedule_t *stream = &scheduler->streams[i];
+        stream->achievedRateDeciHz = (uint64_t)stream->sentInWindow * 10000000 / elapsedUs;
+        stream->sentInWindow = 0;
+    }
+    scheduler->windowStartUs = currentTimeUs;
+}
+
+int mavlinkSchedulerNext(mavlinkScheduler_t *scheduler, timeUs_t currentTimeUs, uint32_t txFreeBytes)
+{
+    if (scheduler->allocationDirty) {
+        mavlinkSchedulerAllocate(scheduler, currentTimeUs);
+    }
+    mavlinkSchedulerRefill(scheduler, currentTimeUs);
+    mavlinkSchedulerMeasure(scheduler, currentTimeUs);
+
+    // Highest priority first, then whichever fell due earliest. The grants
+    // already fit the budget, so this only orders a tick's worth of work.
+    int next = -1;
+    for (int i = 0; i < scheduler->count; i++) {
+        const mavlinkStreamSchedule_t *stream = &scheduler->streams[i];
+        if (!stream->requestedIntervalUs || cmpTimeUs(currentTimeUs, stream->nextDueUs) < 0) {
+            continue;
+        }
+        if (next < 0 || stream->priority > scheduler->streams[next].priority
+                || (stream->priority == scheduler->streams[next].priority
+                    && cmpTimeUs(stream->nextDueUs, scheduler->streams[next].nextDueUs) < 0)) {
+            next = i;
+        }
+    }
+
+    if (next < 0) {
+        return -1;
+    }
+    const uint16_t bytes = scheduler->streams[next].bytes;
+    if (scheduler->tokens < bytes || txFreeBytes < bytes) {
+        return -1;
+    }
+    return next;
+}
+
+void mavlinkSchedulerSent(mavlinkScheduler_t *scheduler, int index, uint16_t bytes, timeUs_t currentTimeUs)
+{
+    mavlinkStreamSchedule_t *stream = &scheduler->streams[index];
+
+    scheduler->tokens -= bytes;
+    if (bytes && bytes != stream->bytes) {
+        stream->bytes = bytes;
+        scheduler->allocationDirty = true;
+    }
+    stream->sentInWindow++;
+
+    // Keep the cadence unless it has slipped by a whole interval, then
+    // restart it rather than sending a catch-up burst
+    stream->nextDueUs += stream->grantedIntervalUs;
+    if (cmpTimeUs(currentTimeUs, stream->nextDueUs) >= 0) {
+        stream->nextDueUs = currentTimeUs + stream->grantedIntervalUs;
+    }
+}
+
+uint16_t mavlinkSchedulerRequestedRate(const mavlinkScheduler_t *scheduler, int index)
+{
+    const uint32_t intervalUs = scheduler->streams[index].requestedIntervalUs;
+    return intervalUs ? MIN(10000000 / intervalUs, UINT16_MAX) : 0;
+}
+
+uint16_t mavlinkSchedulerAchievedRate(const mavlinkScheduler_t *scheduler, int index)
+{
+    return scheduler->streams[index].achievedRateDeciHz;
+}
+
+#endif // USE_TELEMETRY_MAVLINK
@@ -0,0 +1,93 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common/time.h"
+
+// Bandwidth-budgeted scheduling of the periodic MAVLink streams. Knows what
+// each stream costs on the wire and what the link can carry, grants every
+// stream a rate that fits, and picks what goes out next. Kept free of the
+// MAVLink headers so it can be tested on its own.
+
+#define MAVLINK_SCHEDULER_STREAMS_MAX   16
+
+typedef enum {
+    MAVLINK_PRIORITY_LOW = 0,           // degraded first
+    MAVLINK_PRIORITY_NORMAL,
+    MAVLINK_PRIORITY_HIGH,              // degraded last
+    MAVLINK_PRIORITY_COUNT
+} mavlinkPriority_e;
+
+typedef struct mavlinkStreamSchedule_s {
+    uint32_t requestedIntervalUs;       // 0 when the stream is off
+    uint32_t grantedIntervalUs;         // what the budget allows, >= requested
+    timeUs_t nextDueUs;
+    uint16_t bytes;                     // encoded size, learnt from what was sent
+    uint8_t  priority;
+    uint16_t sentInWindow;
+    uint16_t achievedRateDeciHz;        // over the last rate window
+} mavlinkStreamSchedule_t;
+
+typedef struct mavlinkScheduler_s {
+    mavlinkStreamSchedule_t streams[MAVLINK_SCHEDULER_STREAMS_MAX];
+    uint8_t  count;
+    uint32_t linkBytesPerSec;           // what the serial port itself carries
+    uint32_t budgetBytesPerSec;         // after radio back-pressure
+    int32_t  tokens;                    // bytes that may go out now
+    timeUs_t refillUs;
+    timeUs_t windowStartUs;
+    bool     allocationDirty;
+} mavlinkScheduler_t;
+
+// Start an empty schedule for a serial link at the given baud rate (8N1).
+void mavlinkSchedulerInit(mavlinkScheduler_t *scheduler, uint32_t baudRate, timeUs_t currentTimeUs);
+
+// Add a stream costing about `bytes` per message. Returns its index, or -1
+// when the schedule is full.
+int mavlinkSchedulerAddStream(mavlinkScheduler_t *scheduler, uint16_t bytes, mavlinkPriority_e priority);
+
+// Ask for a stream every intervalUs, 0 turning it off. Streams set in the
+// same tick are phase-staggered so they do not all fall due together.
+void mavlinkSchedulerSetInterval(mavlinkScheduler_t *scheduler, int index, uint32_t intervalUs, timeUs_t currentTimeUs);
+
+// RADIO_STATUS from a telemetry radio: free space of its transmit buffer in
+// percent. Below minTxbufPercent the radio is falling behind and the budget
+// backs off multiplicatively; with room to spare it grows back linearly.
+void mavlinkSchedulerRadioStatus(mavlinkScheduler_t *scheduler, uint8_t txbufPercent, uint8_t minTxbufPercent);
+
+// Account for bytes written outside the schedule (command acks, mission and
+// parameter replies, status text), which the budget has to carry too.
+void mavlinkSchedulerCharge(mavlinkScheduler_t *scheduler, uint32_t bytes);
+
+// The stream to send now, or -1. txFreeBytes is the room in the serial
+// port's transmit buffer; a message that does not fit waits.
+int mavlinkSchedulerNext(mavlinkScheduler_t *scheduler, timeUs_t currentTimeUs, uint32_t txFreeBytes);
+
+// Report that stream `index` went out as `bytes` on the wire.
+void mavlinkSchedulerSent(mavlinkScheduler_t *scheduler, int index, uint16_t bytes, timeUs_t currentTimeUs);
+
+// Requested and achieved rates in 0.1 Hz, for reporting.
+uint16_t mavlinkSchedulerRequestedRate(const mavlinkScheduler_t *scheduler, int index);
+uint16_t mavlinkSchedulerAchievedRate(const mavlinkScheduler_t *scheduler, int index);
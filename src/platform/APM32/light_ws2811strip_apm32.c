@@ -175,17 +175,18 @@ bool ws2811LedStripHardwareInit(void)
     return true;
 }
 
-void ws2811LedStripStartTransfer(void)
+bool ws2811LedStripStartTransfer(void)
 {
     if (DMA_SetCurrDataCounter(&TmrHandle, timerChannel, ledStripDMABuffer, WS2811_DMA_BUFFER_SIZE) != DAL_OK) {
         /* DMA set error */
         ws2811LedDataTransferInProgress = false;
-        return;
+        return false;
     }
     /* Reset timer counter */
     __DAL_TMR_SET_COUNTER(&TmrHandle,0);
     /* Enable channel DMA requests */
     TIM_DMACmd(&TmrHandle,timerChannel,ENABLE);
+    return true;
 }
 
 #endif // USE_LED_STRIP
@@ -136,6 +136,11 @@ void uartReconfigure(uartPort_t *uartPort)
             DDL_USART_EnableDMAReq_RX(USARTx);
 
             uartPort->rxDMAPos = xDDL_EX_DMA_GetDataLength(uartPort->rxDMAResource);
+
+            // Idle line hands received frames to ISR-side consumers, see uartRxDmaIdle()
+            if (uartPort->port.rxCallback) {
+                SET_BIT(USARTx->CTRL1, USART_CTRL1_IDLEIEN);
+            }
         } else
 #endif
         {
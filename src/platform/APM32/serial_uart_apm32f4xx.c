@@ -329,6 +329,11 @@ FAST_IRQ_HANDLER void uartIrqHandler(uartPort_t *s)
     }
 
     if (DDL_USART_IsActiveFlag_IDLE(USARTx)) {
+#ifdef USE_DMA
+        if (s->rxDMAResource) {
+            uartRxDmaIdle(s);
+        }
+#endif
         if (s->port.idleCallback) {
             s->port.idleCallback();
         }
@@ -120,6 +120,11 @@ void uartReconfigure(uartPort_t *uartPort)
             xDMA_Cmd(uartPort->rxDMAResource, TRUE);
             usart_dma_receiver_enable(USARTx,TRUE);
             uartPort->rxDMAPos = xDMA_GetCurrDataCounter(uartPort->rxDMAResource);
+
+            // Idle line hands received frames to ISR-side consumers, see uartRxDmaIdle()
+            if (uartPort->port.rxCallback) {
+                usart_interrupt_enable(USARTx, USART_IDLE_INT, TRUE);
+            }
         } else {
             usart_flag_clear(USARTx, USART_RDBF_FLAG);
             usart_interrupt_enable(USARTx, USART_RDBF_INT, TRUE);
@@ -303,6 +308,11 @@ void uartIrqHandler(uartPort_t *s)
     }
 
     if (usart_flag_get(USARTx, USART_IDLEF_FLAG) == SET) {
+#ifdef USE_DMA
+        if (s->rxDMAResource) {
+            uartRxDmaIdle(s);
+        }
+#endif
         if (s->port.idleCallback) {
             s->port.idleCallback();
         }
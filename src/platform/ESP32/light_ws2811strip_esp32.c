@@ -184,9 +184,11 @@ void ws2811LedStripUpdateTransferBuffer(const rgbColor24bpp_t *color, unsigned l
     }
 }
 
-void ws2811LedStripStartTransfer(void)
+bool ws2811LedStripStartTransfer(void)
 {
-    if (!ws2812Initialized) return;
+    if (!ws2812Initialized) {
+        return false;
+    }
 
     ws2811LedDataTransferInProgress = true;
 
@@ -218,6 +220,7 @@ void ws2811LedStripStartTransfer(void)
     rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_TX_DONE(ch));
 
     ws2811LedDataTransferInProgress = false;
+    return true;
 }
 
 #endif // USE_LED_STRIP
@@ -191,17 +191,17 @@ bool ws2811LedStripHardwareInit(void)
     return true;
 }
 
-void ws2811LedStripStartTransfer(void)
+bool ws2811LedStripStartTransfer(void)
 {
     if (!ledStripIO) {
         ws2811LedDataTransferInProgress = false;
-        return; // Not initialized
+        return false; // Not initialized
     }
 
     // guard to ensure we don't start a transfer before a reset period has elapsed.
     if (ABS(cmpTimeUs(ledStripCompletedTime, micros())) < 50) {
         ws2811LedDataTransferInProgress = false;
-        return; // Not initialized
+        return false;
     }
 
     // Set the read address to the led_data buffer
@@ -209,6 +209,7 @@ void ws2811LedStripStartTransfer(void)
     dma_channel_set_trans_count(dma_chan, WS2811_LED_STRIP_BUFFER_SIZE, false);
     // Start the DMA transfer
     dma_channel_start(dma_chan);
+    return true;
 }
 
 void ws2811LedStripUpdateTransferBuffer(const rgbColor24bpp_t *color, unsigned ledIndex)
@@ -8,14 +8,24 @@ DEFAULT_OUTPUT := exe
 INCLUDE_DIRS := \
         $(INCLUDE_DIRS) \
         $(TARGET_PLATFORM_DIR) \
-        $(TARGET_PLATFORM_DIR)/include \
-        $(LIB_MAIN_DIR)/dyad
+        $(TARGET_PLATFORM_DIR)/include
 
 MCU_COMMON_SRC  := \
-        $(LIB_MAIN_DIR)/dyad/dyad.c \
         SIMULATOR/sitl.c \
+        SIMULATOR/sitl_can.c \
+        SIMULATOR/sitl_can_bus.c \
+        SIMULATOR/sitl_physics.c \
+        SIMULATOR/sitl_reactor.c \
+        SIMULATOR/sitl_shm.c \
+        SIMULATOR/sitl_blackbox_decode.c \
+        SIMULATOR/sitl_replay.c \
         SIMULATOR/udplink.c
 
+# DroneCAN over the virtual CAN bus, when libcanard is checked out
+ifneq ($(wildcard $(ROOT)/$(DRONECAN_LIB_DIR)/canard.c),)
+LIB_SUBMODULES += $(DRONECAN_LIB_DIR)
+endif
+
 #Flags
 ARCH_FLAGS      =
 DEVICE_FLAGS    =
@@ -30,6 +40,7 @@ MCU_EXCLUDES = \
         drivers/rx/rx_xn297.c \
         drivers/display_ug2864hsweg01.c \
         telemetry/crsf.c \
+        telemetry/crsf_scheduler.c \
         telemetry/ghst.c \
         telemetry/srxl.c \
         io/displayport_oled.c
@@ -78,9 +78,13 @@
 #include "io/gps.h"
 #include "io/gps_virtual.h"
 
-#include "dyad.h"
 #include "udplink.h"
 #include "sitl_gyro.h"
+#include "sitl_physics.h"
+#include "sitl_reactor.h"
+#include "sitl_shm.h"
+#include "sitl_spsc.h"
+#include "sitl_world.h"
 
 // ENABLE_GAZEBO_BRIDGE is a boolean selector for the gyro yaw sign (passed to
 // sitlGyroBodyFromSim below). target.h defaults it to 1; configs set 0 for the
@@ -91,8 +95,6 @@ STATIC_ASSERT((ENABLE_GAZEBO_BRIDGE) == 0 || (ENABLE_GAZEBO_BRIDGE) == 1,
 
 uint32_t SystemCoreClock;
 
-static fdm_packet fdmPkt;
-static rc_packet rcPkt;
 static servo_packet pwmPkt;
 static servo_packet_raw pwmRawPkt;
 
@@ -101,13 +103,43 @@ static bool fdm_received = false;
 
 static struct timespec start_time;
 static double simRate = 1.0;
-static pthread_t tcpWorker, udpWorker, udpWorkerRC;
-static bool workerRunning = true;
 static udpLink_t stateLink, pwmLink, pwmRawLink, rcLink;
-static pthread_mutex_t updateLock;
-static pthread_mutex_t mainLoopLock;
+
+// FDM and RC packets from the I/O thread, consumed by the main loop
+#define PACKET_QUEUE_LENGTH 8
+
+typedef struct fdmQueueEntry_s {
+    fdm_packet pkt;
+    struct timespec receivedAt;     // simRate is measured against arrival, not consumption
+} fdmQueueEntry_t;
+
+static fdmQueueEntry_t fdmQueueStorage[PACKET_QUEUE_LENGTH];
+static rc_packet rcQueueStorage[PACKET_QUEUE_LENGTH];
+static sitlSpsc_t fdmQueue;
+static sitlSpsc_t rcQueue;
+
+// One servo_packet per fdm_packet; one PID loop per fdm_packet with ENABLE_SIMULATOR_GYROPID_SYNC.
+// Both start allowed, as the mutexes they replace started unlocked: the
+// first PID loop is what produces the first motor output
+static bool motorUpdateAllowed = true;
+static bool pidLoopAllowed = true;
 static char simulator_ip[32] = "127.0.0.1";
 
+// Multi-vehicle swarm (--instance N): ports and file names are per instance
+static uint8_t instanceId = 0;
+static char instanceFilePrefix[16] = "";
+static char eepromFileName[32] = EEPROM_FILENAME;
+static char gpxFileName[32] = "sitl_track.gpx";
+
+// One world process simulating the whole swarm (--world <group>)
+static char worldGroup[32] = "";
+static udpLink_t worldStateLink, worldMotorLink;
+static udpLink_t *fdmSourceLink = &stateLink;
+
+// Shared-memory FDM/motor link to a simulator on this host (--shm <name>)
+static const char *shmName = NULL;
+static sitlShmRegion_t *shmRegion = NULL;
+
 static const char *configFilePath = NULL;
 
 // GPX track logging for post-flight visualisation (enabled with --gpx)
@@ -115,6 +147,20 @@ static FILE *gpxTrackFile = NULL;
 static bool gpxHeaderWritten = false;
 static bool gpxEnabled = false;
 
+// Built-in rigid-body model replacing the external simulator (--physics)
+static bool physicsEnabled = false;
+static const char *physicsConfigPath = NULL;
+static double physicsSpeedup = 1.0;
+static sitlPhysicsConfig_t physicsConfig;
+static sitlPhysicsState_t physicsState;
+
+#ifdef USE_BLACKBOX_REPLAY
+// Blackbox log fed through the flight code on a virtual clock (--replay)
+static const char *replayFilePath = NULL;
+static bool replayClockRunning = false;
+static uint64_t replayClockUs;
+#endif
+
 #if ENABLE_FLIGHT_PLAN
 static const char *gpxWaypointTypeName(uint8_t type)
 {
@@ -130,7 +176,7 @@ static const char *gpxWaypointTypeName(uint8_t type)
 
 static void gpxTrackOpen(void)
 {
-    gpxTrackFile = fopen("sitl_track.gpx", "w");
+    gpxTrackFile = fopen(gpxFileName, "w");
     if (gpxTrackFile) {
         fprintf(gpxTrackFile,
             "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
@@ -194,7 +240,7 @@ static void gpxTrackClose(void)
         fclose(gpxTrackFile);
         gpxTrackFile = NULL;
         gpxHeaderWritten = false;
-        printf("[SITL] GPS track written to sitl_track.gpx\n");
+        printf("[SITL] GPS track written to %s\n", gpxFileName);
     }
 }
 
@@ -203,6 +249,26 @@ static void gpxTrackClose(void)
 #define PORT_STATE      9003    // In
 #define PORT_RC         9004    // In
 
+static int instancePort(int port)
+{
+    return port + sitlInstancePortOffset();
+}
+
+static bool worldEnabled(void)
+{
+    return worldGroup[0] != '\0';
+}
+
+int sitlInstancePortOffset(void)
+{
+    return instanceId * SITL_INSTANCE_PORT_STRIDE;
+}
+
+const char *sitlInstanceFilePrefix(void)
+{
+    return instanceFilePrefix;
+}
+
 int targetParseArgs(int argc, char * argv[])
 {
     for (int i = 1; i < argc; i++) {
@@ -210,11 +276,21 @@ int targetParseArgs(int argc, char * argv[])
             printf("Betaflight SITL\n");
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
-            printf("  --ip <address>     Simulator IP address (default: %s)\n", simulator_ip);
+            printf("  --ip <address>     Simulator (or --world) IP address (default: %s)\n", simulator_ip);
+            printf("  --instance <n>     Swarm member 0-%d: ports move up by %d*n, files get a sitl<n>_ prefix\n",
+                   SITL_INSTANCE_MAX, SITL_INSTANCE_PORT_STRIDE);
+            printf("  --world <group>    Take state from a multicast world process, send motors to --ip\n");
+            printf("  --shm <name>       Exchange state and motors with a local simulator through shared memory <name>\n");
 #ifdef CONFIG_IN_FILE
             printf("  --config <file>    Load CLI config file, save to EEPROM, and exit\n");
 #endif
             printf("  --gpx              Write GPS track to sitl_track.gpx\n");
+            printf("  --physics          Fly the built-in quad model instead of an external simulator\n");
+            printf("  --physics-config <file>  Airframe and sensor parameters for --physics\n");
+            printf("  --speedup <x>      Run --physics at x times real time (default 1)\n");
+#ifdef USE_BLACKBOX_REPLAY
+            printf("  --replay <log>     Replay a blackbox log through the filters and estimators, log the result, and exit\n");
+#endif
             printf("  --help, -h         Show this help message\n");
             exit(0);
 #ifdef CONFIG_IN_FILE
@@ -224,14 +300,55 @@ int targetParseArgs(int argc, char * argv[])
         } else if (strcmp(argv[i], "--ip") == 0 && i + 1 < argc) {
             strncpy(simulator_ip, argv[++i], sizeof(simulator_ip) - 1);
             simulator_ip[sizeof(simulator_ip) - 1] = '\0';
+        } else if (strcmp(argv[i], "--instance") == 0 && i + 1 < argc) {
+            char *end;
+            const long n = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || n < 0 || n > SITL_INSTANCE_MAX) {
+                fprintf(stderr, "[SITL] --instance must be 0-%d\n", SITL_INSTANCE_MAX);
+                exit(1);
+            }
+            instanceId = n;
+        } else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+            const char *group = argv[++i];
+            if (!IN_MULTICAST(ntohl(inet_addr(group)))) {
+                fprintf(stderr, "[SITL] --world needs an IPv4 multicast group, not %s\n", group);
+                exit(1);
+            }
+            strncpy(worldGroup, group, sizeof(worldGroup) - 1);
+            worldGroup[sizeof(worldGroup) - 1] = '\0';
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shmName = argv[++i];
         } else if (strcmp(argv[i], "--gpx") == 0) {
             gpxEnabled = true;
+        } else if (strcmp(argv[i], "--physics") == 0) {
+            physicsEnabled = true;
+        } else if (strcmp(argv[i], "--physics-config") == 0 && i + 1 < argc) {
+            physicsEnabled = true;
+            physicsConfigPath = argv[++i];
+        } else if (strcmp(argv[i], "--speedup") == 0 && i + 1 < argc) {
+            physicsSpeedup = atof(argv[++i]);
+            if (physicsSpeedup <= 0.0) {
+                fprintf(stderr, "[SITL] --speedup must be positive\n");
+                exit(1);
+            }
+#ifdef USE_BLACKBOX_REPLAY
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFilePath = argv[++i];
+#endif
         } else {
             fprintf(stderr, "[SITL] Unknown argument: %s (use --help for usage)\n", argv[i]);
             exit(1);
         }
     }
 
+    // instance 0 keeps the single-vehicle names
+    if (instanceId > 0) {
+        snprintf(instanceFilePrefix, sizeof(instanceFilePrefix), "sitl%u_", (unsigned)instanceId);
+        snprintf(eepromFileName, sizeof(eepromFileName), "%s%s", instanceFilePrefix, EEPROM_FILENAME);
+        snprintf(gpxFileName, sizeof(gpxFileName), "%ssitl_track.gpx", instanceFilePrefix);
+        printf("[SITL] Instance %u: ports +%d, files %s*\n", (unsigned)instanceId, sitlInstancePortOffset(), instanceFilePrefix);
+    }
+
 #ifdef CONFIG_IN_FILE
     if (configFilePath) {
         FILE *fp = fopen(configFilePath, "r");
@@ -244,8 +361,53 @@ int targetParseArgs(int argc, char * argv[])
     }
 #endif
 
+#ifdef USE_BLACKBOX_REPLAY
+    if (replayFilePath) {
+        if (physicsEnabled) {
+            fprintf(stderr, "[SITL] --replay and --physics cannot be combined\n");
+            exit(1);
+        }
+        FILE *fp = fopen(replayFilePath, "rb");
+        if (!fp) {
+            fprintf(stderr, "[SITL] Blackbox log not found: %s\n", replayFilePath);
+            exit(1);
+        }
+        fclose(fp);
+        printf("[SITL] Replaying %s, simulator ports ignored\n", replayFilePath);
+        return 0;
+    }
+#endif
+
+    if (physicsEnabled) {
+        sitlPhysicsConfigDefaults(&physicsConfig);
+        if (physicsConfigPath && !sitlPhysicsConfigLoad(&physicsConfig, physicsConfigPath)) {
+            exit(1);
+        }
+        sitlPhysicsInit(&physicsState, &physicsConfig);
+        // No simulator paces the clock, so the speedup is the sim rate
+        simRate = physicsSpeedup;
+        printf("[SITL] Built-in physics at %.1fx real time, simulator state on port %d ignored\n",
+               physicsSpeedup, instancePort(PORT_STATE));
+        return 0;
+    }
+
+    if (shmName) {
+        if (worldEnabled()) {
+            fprintf(stderr, "[SITL] --shm and --world cannot be combined\n");
+            exit(1);
+        }
+        printf("[SITL] The SITL will exchange state and motors through shared memory %s\n", shmName);
+        return 0;
+    }
+
+    if (worldEnabled()) {
+        printf("[SITL] The SITL will take state from world group %s:%d and output to %s:%d as vehicle %u\n",
+               worldGroup, SITL_WORLD_STATE_PORT, simulator_ip, SITL_WORLD_MOTOR_PORT, (unsigned)instanceId);
+        return 0;
+    }
+
     printf("[SITL] The SITL will output to IP %s:%d (Gazebo) and %s:%d (RealFlightBridge)\n",
-           simulator_ip, PORT_PWM, simulator_ip, PORT_PWM_RAW);
+           simulator_ip, instancePort(PORT_PWM), simulator_ip, instancePort(PORT_PWM_RAW));
     return 0;
 }
 
@@ -256,11 +418,39 @@ const char *targetGetConfigFile(void)
 }
 #endif
 
+#ifdef USE_BLACKBOX_REPLAY
+const char *targetGetReplayFile(void)
+{
+    return replayFilePath;
+}
+
+// Takes over micros() and millis() for the rest of the run
+void sitlReplayClockSet(uint64_t timeUs)
+{
+    replayClockUs = timeUs;
+    replayClockRunning = true;
+}
+
+static bool replaying(void)
+{
+    return replayFilePath != NULL;
+}
+#else
+static bool replaying(void)
+{
+    return false;
+}
+#endif
+
 int timeval_sub(struct timespec *result, struct timespec *x, struct timespec *y);
 
 int lockMainPID(void)
 {
-    return pthread_mutex_trylock(&mainLoopLock);
+    if (!pidLoopAllowed) {
+        return 1;
+    }
+    pidLoopAllowed = false;
+    return 0;
 }
 
 #define RAD2DEG (180.0 / M_PI)
@@ -269,18 +459,86 @@ int lockMainPID(void)
 
 static void sendMotorUpdate(void)
 {
+    if (shmRegion) {
+        sitlShmPush(&shmRegion->up, &pwmPkt);
+        return;
+    }
+    if (worldEnabled()) {
+        uint8_t datagram[sizeof(sitlWorldMotorHeader_t) + sizeof(servo_packet)];
+        udpSend(&worldMotorLink, datagram, sitlWorldMotorFrame(datagram, instanceId, &pwmPkt, sizeof(servo_packet)));
+        return;
+    }
     udpSend(&pwmLink, &pwmPkt, sizeof(servo_packet));
 }
 
-static void updateState(const fdm_packet* pkt)
+#if defined(USE_VIRTUAL_MAG)
+static void setVirtualMagFromAttitude(float attQw, float attQx, float attQy, float attQz)
+{
+    // Synthetic earth field, NWU, 4096 counts: 60° inclination and 2° east
+    // declination so every body component is generically nonzero
+    // (compassEnabledAndCalibrated requires nonzero x, y and z). The 2°
+    // heading bias is negligible against scenario tolerances; the vertical
+    // component is ignored by imuCalcMagErr's horizontal projection.
+    static const float fieldN = 2046.8f;
+    static const float fieldW = -71.5f;
+    static const float fieldU = -3547.2f;
+    // v_body = R(q)^T * v_world
+    const float r00 = 1.0f - 2.0f * (attQy * attQy + attQz * attQz);
+    const float r01 = 2.0f * (attQx * attQy - attQw * attQz);
+    const float r02 = 2.0f * (attQx * attQz + attQw * attQy);
+    const float r10 = 2.0f * (attQx * attQy + attQw * attQz);
+    const float r11 = 1.0f - 2.0f * (attQx * attQx + attQz * attQz);
+    const float r12 = 2.0f * (attQy * attQz - attQw * attQx);
+    const float r20 = 2.0f * (attQx * attQz - attQw * attQy);
+    const float r21 = 2.0f * (attQy * attQz + attQw * attQx);
+    const float r22 = 1.0f - 2.0f * (attQx * attQx + attQy * attQy);
+    const float magX = r00 * fieldN + r10 * fieldW + r20 * fieldU;
+    const float magY = r01 * fieldN + r11 * fieldW + r21 * fieldU;
+    const float magZ = r02 * fieldN + r12 * fieldW + r22 * fieldU;
+    virtualMagSet(lrintf(magX), lrintf(magY), lrintf(magZ));
+}
+#endif
+
+// Periodic status (about 1 Hz)
+static void printPeriodicStatus(uint64_t realtime_now)
+{
+    static uint64_t lastDebugTimeUs = 0;
+    if (realtime_now - lastDebugTimeUs < 1000000) {
+        return;
+    }
+    lastDebugTimeUs = realtime_now;
+
+    const armingDisableFlags_e flags = getArmingDisableFlags();
+    if (flags) {
+        printf("[SITL] t=%dms Arming disabled:", (int)millis());
+        for (unsigned i = 0; i < ARMING_DISABLE_FLAGS_COUNT; i++) {
+            const armingDisableFlags_e flag = (1 << i);
+            if (flags & flag) {
+                printf(" %s", getArmingDisableFlagName(flag));
+            }
+        }
+        printf("\n");
+    }
+
+#if defined(USE_GPS)
+    printf("[SITL] t=%dms  spd=%.2fm/s  pos=(%d,%d)  alt=%.2fm  att=(%.1f,%.1f,%.1f)",
+        (int)millis(),
+        (double)gpsSol.groundSpeed * 0.01,
+        gpsSol.llh.lat, gpsSol.llh.lon,
+        (double)getAltitudeCm() * 0.01,
+        (double)attitude.values.roll * 0.1,
+        (double)attitude.values.pitch * 0.1,
+        (double)attitude.values.yaw * 0.1);
+    printf("\n");
+#endif
+}
+
+static void updateState(const fdm_packet* pkt, struct timespec now_ts)
 {
     static double last_timestamp = 0; // in seconds
     static uint64_t last_realtime = 0; // in uS
     static struct timespec last_ts; // last packet
 
-    struct timespec now_ts;
-    clock_gettime(CLOCK_MONOTONIC, &now_ts);
-
     const uint64_t realtime_now = micros64_real();
     if (realtime_now > last_realtime + 500*1e3) { // 500ms timeout
         last_timestamp = pkt->timestamp;
@@ -350,30 +608,7 @@ static void updateState(const fdm_packet* pkt)
 #endif
 
 #if defined(USE_VIRTUAL_MAG)
-    {
-        // Synthetic earth field, NWU, 4096 counts: 60° inclination and 2° east
-        // declination so every body component is generically nonzero
-        // (compassEnabledAndCalibrated requires nonzero x, y and z). The 2°
-        // heading bias is negligible against scenario tolerances; the vertical
-        // component is ignored by imuCalcMagErr's horizontal projection.
-        static const float fieldN = 2046.8f;
-        static const float fieldW = -71.5f;
-        static const float fieldU = -3547.2f;
-        // v_body = R(q)^T * v_world
-        const float r00 = 1.0f - 2.0f * (attQy * attQy + attQz * attQz);
-        const float r01 = 2.0f * (attQx * attQy - attQw * attQz);
-        const float r02 = 2.0f * (attQx * attQz + attQw * attQy);
-        const float r10 = 2.0f * (attQx * attQy + attQw * attQz);
-        const float r11 = 1.0f - 2.0f * (attQx * attQx + attQz * attQz);
-        const float r12 = 2.0f * (attQy * attQz - attQw * attQx);
-        const float r20 = 2.0f * (attQx * attQz - attQw * attQy);
-        const float r21 = 2.0f * (attQy * attQz + attQw * attQx);
-        const float r22 = 1.0f - 2.0f * (attQx * attQx + attQy * attQy);
-        const float magX = r00 * fieldN + r10 * fieldW + r20 * fieldU;
-        const float magY = r01 * fieldN + r11 * fieldW + r21 * fieldU;
-        const float magZ = r02 * fieldN + r12 * fieldW + r22 * fieldU;
-        virtualMagSet(lrintf(magX), lrintf(magY), lrintf(magZ));
-    }
+    setVirtualMagFromAttitude(attQw, attQx, attQy, attQz);
 #endif
 
 #if !defined(USE_IMU_CALC)
@@ -481,101 +716,217 @@ static void updateState(const fdm_packet* pkt)
     last_ts.tv_sec = now_ts.tv_sec;
     last_ts.tv_nsec = now_ts.tv_nsec;
 
-    // Periodic status (about 1 Hz)
-    static uint64_t lastDebugTimeUs = 0;
-    if (realtime_now - lastDebugTimeUs >= 1000000) {
-        lastDebugTimeUs = realtime_now;
-
-        const armingDisableFlags_e flags = getArmingDisableFlags();
-        if (flags) {
-            printf("[SITL] t=%dms Arming disabled:", (int)millis());
-            for (unsigned i = 0; i < ARMING_DISABLE_FLAGS_COUNT; i++) {
-                const armingDisableFlags_e flag = (1 << i);
-                if (flags & flag) {
-                    printf(" %s", getArmingDisableFlagName(flag));
-                }
-            }
-            printf("\n");
-        }
+    printPeriodicStatus(realtime_now);
 
-#if defined(USE_GPS)
-        printf("[SITL] t=%dms  spd=%.2fm/s  pos=(%d,%d)  alt=%.2fm  att=(%.1f,%.1f,%.1f)",
-            (int)millis(),
-            (double)gpsSol.groundSpeed * 0.01,
-            gpsSol.llh.lat, gpsSol.llh.lon,
-            (double)getAltitudeCm() * 0.01,
-            (double)attitude.values.roll * 0.1,
-            (double)attitude.values.pitch * 0.1,
-            (double)attitude.values.yaw * 0.1);
-        printf("\n");
+    motorUpdateAllowed = true; // can send PWM output now
+
+#if ENABLE_SIMULATOR_GYROPID_SYNC
+    pidLoopAllowed = true; // can run main loop
+#endif
+}
+
+#define PHYSICS_MAX_STEP_S       0.001
+#define PHYSICS_MAX_GAP_S        0.1     // longer stalls are dropped, not integrated
+#define PHYSICS_GPS_INTERVAL_S   0.1
+#define EARTH_RADIUS_M           6378137.0
+
+// Advance the built-in model to the current sim time under the last motor
+// commands, then feed the virtual sensors from it. Runs on the main loop
+// right after the mixer, which is what paces the model: there is no
+// simulator to lock step with.
+static void physicsUpdate(const double motorCommand[SITL_PHYSICS_MOTOR_COUNT])
+{
+    static uint64_t lastUs = 0;
+    static double lastGpsS = -PHYSICS_GPS_INTERVAL_S;
+
+    const uint64_t nowUs = micros64();
+    double remainingS = lastUs ? (nowUs - lastUs) * 1e-6 : 0.0;
+    lastUs = nowUs;
+    if (remainingS > PHYSICS_MAX_GAP_S) {
+        remainingS = PHYSICS_MAX_GAP_S;
+    }
+    while (remainingS > 0.0) {
+        const double dtS = MIN(remainingS, PHYSICS_MAX_STEP_S);
+        sitlPhysicsStep(&physicsState, &physicsConfig, motorCommand, dtS);
+        remainingS -= dtS;
+    }
+
+    sitlPhysicsSample_t imu;
+    sitlPhysicsSense(&physicsState, &physicsConfig, physicsConfig.imuLatencyS, &imu);
+
+    // Already in Betaflight's frames, no bridge remapping
+    virtualGyroSet(virtualGyroDev,
+                   constrain(imu.rateRadS[0] * GYRO_SCALE * RAD2DEG, -32767, 32767),
+                   constrain(imu.rateRadS[1] * GYRO_SCALE * RAD2DEG, -32767, 32767),
+                   constrain(imu.rateRadS[2] * GYRO_SCALE * RAD2DEG, -32767, 32767));
+    virtualAccSet(virtualAccDev,
+                  constrain(imu.specificForceMps2[0] * ACC_SCALE, -32767, 32767),
+                  constrain(imu.specificForceMps2[1] * ACC_SCALE, -32767, 32767),
+                  constrain(imu.specificForceMps2[2] * ACC_SCALE, -32767, 32767));
+
+    const double baroAltM = physicsConfig.originAltM + imu.posNwuM[2]
+        + physicsConfig.baroNoiseM * sitlPhysicsNoise(&physicsState);
+    virtualBaroSet((int32_t)sitlPhysicsPressurePa(baroAltM), 2500);
+
+#if defined(USE_VIRTUAL_MAG)
+    setVirtualMagFromAttitude(imu.quat[0], imu.quat[1], imu.quat[2], imu.quat[3]);
+#endif
+#if !defined(USE_IMU_CALC)
+    imuSetAttitudeQuat(imu.quat[0], imu.quat[1], imu.quat[2], imu.quat[3]);
 #endif
+
+#if defined(USE_VIRTUAL_GPS)
+    if (physicsState.now.timeS - lastGpsS >= PHYSICS_GPS_INTERVAL_S) {
+        lastGpsS = physicsState.now.timeS;
+
+        sitlPhysicsSample_t fix;
+        sitlPhysicsSense(&physicsState, &physicsConfig, physicsConfig.gpsLatencyS, &fix);
+        const double northM = fix.posNwuM[0] + physicsConfig.gpsNoiseM * sitlPhysicsNoise(&physicsState);
+        const double eastM = -fix.posNwuM[1] + physicsConfig.gpsNoiseM * sitlPhysicsNoise(&physicsState);
+        const double altitude = physicsConfig.originAltM + fix.posNwuM[2]
+            + physicsConfig.gpsNoiseM * sitlPhysicsNoise(&physicsState);
+        const double latitude = physicsConfig.originLatDeg + northM / EARTH_RADIUS_M * RAD2DEG;
+        const double longitude = physicsConfig.originLonDeg
+            + eastM / (EARTH_RADIUS_M * cos(physicsConfig.originLatDeg / RAD2DEG)) * RAD2DEG;
+
+        const double velN = fix.velNwuMps[0];
+        const double velE = -fix.velNwuMps[1];
+        const double velD = -fix.velNwuMps[2];
+        const double speed = sqrt(sq(velN) + sq(velE));
+        const double speed3D = sqrt(sq(velN) + sq(velE) + sq(velD));
+        double course = atan2(velE, velN) * RAD2DEG;
+        if (course < 0.0) {
+            course += 360.0;
+        }
+        setVirtualGPS(latitude, longitude, altitude, speed, speed3D, course, velN, velE, velD);
+
+        if (gpxEnabled) {
+            static double lastGpxS = -1.0;
+            if (physicsState.now.timeS - lastGpxS >= 1.0) {
+                lastGpxS = physicsState.now.timeS;
+                gpxTrackWrite(latitude, longitude, altitude);
+            }
+        }
     }
+#endif
 
-    pthread_mutex_unlock(&updateLock); // can send PWM output now
+    printPeriodicStatus(micros64_real());
 
 #if ENABLE_SIMULATOR_GYROPID_SYNC
-    pthread_mutex_unlock(&mainLoopLock); // can run main loop
+    pidLoopAllowed = true; // can run main loop
 #endif
 }
 
-static void* udpThread(void* data)
+// I/O thread: queue every datagram waiting on the socket and wake the main loop
+
+static void onStateReadable(int fd, uint8_t events, void *context)
 {
-    UNUSED(data);
-    int n = 0;
+    UNUSED(fd);
+    UNUSED(events);
+    UNUSED(context);
 
-    while (workerRunning) {
-        n = udpRecv(&stateLink, &fdmPkt, sizeof(fdm_packet), 100);
+    fdmQueueEntry_t entry;
+    int n;
+    while ((n = udpRecv(&stateLink, &entry.pkt, sizeof(fdm_packet), 0)) >= 0) {
         if (n == sizeof(fdm_packet)) {
-            if (!fdm_received) {
-                printf("[SITL] new fdm %d t:%f from %s:%d\n", n, fdmPkt.timestamp, inet_ntoa(stateLink.recv.sin_addr), stateLink.recv.sin_port);
-                fdm_received = true;
-            }
-            updateState(&fdmPkt);
+            clock_gettime(CLOCK_MONOTONIC, &entry.receivedAt);
+            sitlSpscPush(&fdmQueue, &entry);
         }
     }
+    sitlReactorNotifyMain();
+}
 
-    printf("udpThread end!!\n");
-    return NULL;
+// The world multicasts the whole swarm's state; keep this vehicle's record
+static void onWorldStateReadable(int fd, uint8_t events, void *context)
+{
+    UNUSED(fd);
+    UNUSED(events);
+    UNUSED(context);
+
+    uint8_t datagram[1472];     // one Ethernet frame: a dozen vehicles
+    int n;
+    while ((n = udpRecv(&worldStateLink, datagram, sizeof(datagram), 0)) >= 0) {
+        const void *record = sitlWorldStateRecord(datagram, n, instanceId, sizeof(fdm_packet));
+        if (record) {
+            fdmQueueEntry_t entry;
+            memcpy(&entry.pkt, record, sizeof(fdm_packet));
+            clock_gettime(CLOCK_MONOTONIC, &entry.receivedAt);
+            sitlSpscPush(&fdmQueue, &entry);
+        }
+    }
+    sitlReactorNotifyMain();
 }
 
-static void *udpRCThread(void *data)
+static void onRcReadable(int fd, uint8_t events, void *context)
 {
-    UNUSED(data);
-    int n = 0;
+    UNUSED(fd);
+    UNUSED(events);
+    UNUSED(context);
 
-    while (workerRunning) {
-        n = udpRecv(&rcLink, &rcPkt, sizeof(rc_packet), 100);
+    rc_packet pkt;
+    int n;
+    while ((n = udpRecv(&rcLink, &pkt, sizeof(rc_packet), 0)) >= 0) {
         if (n == sizeof(rc_packet)) {
-            if (!rc_received) {
-                printf("[SITL] new rc %d: t:%f AETR: %d %d %d %d AUX1-4: %d %d %d %d\n", n, rcPkt.timestamp,
-                    rcPkt.channels[0], rcPkt.channels[1],rcPkt.channels[2],rcPkt.channels[3],
-                    rcPkt.channels[4], rcPkt.channels[5],rcPkt.channels[6],rcPkt.channels[7]);
-
-                rc_received = true;
-            }
-            rxUpdateUdpChannels(rcPkt.channels, SIMULATOR_MAX_RC_CHANNELS);
+            sitlSpscPush(&rcQueue, &pkt);
         }
     }
-
-    printf("udpRCThread end!!\n");
-    return NULL;
+    sitlReactorNotifyMain();
 }
 
-static void* tcpThread(void* data)
+// Main loop idle: sleep until the I/O thread has something or timeoutUs
+// passes, then apply what it queued
+void sitlMainLoopIdle(uint32_t timeoutUs)
 {
-    UNUSED(data);
+    fdmQueueEntry_t entry;
+
+    if (shmRegion) {
+        // the simulator wakes us directly; RC and serial wait out the timeout
+        sitlShmWait(&shmRegion->down, timeoutUs);
+        sitlReactorWaitMain(0);
+
+        uint64_t pushedUs;
+        while (sitlShmPop(&shmRegion->down, &entry.pkt, &pushedUs)) {
+            if (!fdm_received) {
+                printf("[SITL] new fdm t:%f from shared memory %s\n", entry.pkt.timestamp, shmName);
+                fdm_received = true;
+            }
+            entry.receivedAt.tv_sec = pushedUs / 1000000;
+            entry.receivedAt.tv_nsec = (pushedUs % 1000000) * 1000;
+            updateState(&entry.pkt, entry.receivedAt);
+        }
+    } else {
+        sitlReactorWaitMain(timeoutUs);
+    }
 
-    dyad_init();
-    dyad_setTickInterval(0.2f);
-    dyad_setUpdateTimeout(0.01f);
+    while (sitlSpscPop(&fdmQueue, &entry)) {
+        if (physicsEnabled || replaying()) {
+            continue;
+        }
+        if (!fdm_received) {
+            printf("[SITL] new fdm t:%f from %s:%d\n", entry.pkt.timestamp, inet_ntoa(fdmSourceLink->si.sin_addr), ntohs(fdmSourceLink->si.sin_port));
+            fdm_received = true;
+        }
+        updateState(&entry.pkt, entry.receivedAt);
+    }
+
+    rc_packet rcPkt;
+    while (sitlSpscPop(&rcQueue, &rcPkt)) {
+        if (!rc_received) {
+            printf("[SITL] new rc: t:%f AETR: %d %d %d %d AUX1-4: %d %d %d %d\n", rcPkt.timestamp,
+                rcPkt.channels[0], rcPkt.channels[1],rcPkt.channels[2],rcPkt.channels[3],
+                rcPkt.channels[4], rcPkt.channels[5],rcPkt.channels[6],rcPkt.channels[7]);
 
-    while (workerRunning) {
-        dyad_update();
+            rc_received = true;
+        }
+        rxUpdateUdpChannels(rcPkt.channels, SIMULATOR_MAX_RC_CHANNELS);
     }
 
-    dyad_shutdown();
-    printf("tcpThread end!!\n");
-    return NULL;
+    sitlCanPoll();
+}
+
+static void shmClose(void)
+{
+    sitlShmUnlink(shmName);
 }
 
 // system
@@ -591,43 +942,53 @@ void systemInit(void)
 
     SystemCoreClock = 500 * 1e6; // virtual 500MHz
 
-    if (pthread_mutex_init(&updateLock, NULL) != 0) {
-        printf("Create updateLock error!\n");
-        exit(1);
-    }
+    sitlSpscInit(&fdmQueue, fdmQueueStorage, sizeof(fdmQueueEntry_t), PACKET_QUEUE_LENGTH);
+    sitlSpscInit(&rcQueue, rcQueueStorage, sizeof(rc_packet), PACKET_QUEUE_LENGTH);
 
-    if (pthread_mutex_init(&mainLoopLock, NULL) != 0) {
-        printf("Create mainLoopLock error!\n");
+    if (!sitlReactorInit()) {
+        printf("Create I/O reactor error!\n");
         exit(1);
     }
 
-    ret = pthread_create(&tcpWorker, NULL, tcpThread, NULL);
-    if (ret != 0) {
-        printf("Create tcpWorker error!\n");
-        exit(1);
-    }
+    ret = udpInit(&pwmLink, simulator_ip, instancePort(PORT_PWM), false);
+    printf("[SITL] init PwmOut UDP link to gazebo %s:%d...%d\n", simulator_ip, instancePort(PORT_PWM), ret);
 
-    ret = udpInit(&pwmLink, simulator_ip, PORT_PWM, false);
-    printf("[SITL] init PwmOut UDP link to gazebo %s:%d...%d\n", simulator_ip, PORT_PWM, ret);
+    ret = udpInit(&pwmRawLink, simulator_ip, instancePort(PORT_PWM_RAW), false);
+    printf("[SITL] init PwmOut UDP link to RF9 %s:%d...%d\n", simulator_ip, instancePort(PORT_PWM_RAW), ret);
 
-    ret = udpInit(&pwmRawLink, simulator_ip, PORT_PWM_RAW, false);
-    printf("[SITL] init PwmOut UDP link to RF9 %s:%d...%d\n", simulator_ip, PORT_PWM_RAW, ret);
+    ret = udpInit(&stateLink, NULL, instancePort(PORT_STATE), true);
+    printf("[SITL] start UDP server @%d...%d\n", instancePort(PORT_STATE), ret);
 
-    ret = udpInit(&stateLink, NULL, PORT_STATE, true);
-    printf("[SITL] start UDP server @%d...%d\n", PORT_STATE, ret);
+    ret = udpInit(&rcLink, NULL, instancePort(PORT_RC), true);
+    printf("[SITL] start UDP server for RC input @%d...%d\n", instancePort(PORT_RC), ret);
 
-    ret = udpInit(&rcLink, NULL, PORT_RC, true);
-    printf("[SITL] start UDP server for RC input @%d...%d\n", PORT_RC, ret);
+    sitlReactorAdd(stateLink.fd, SITL_REACTOR_READ, onStateReadable, NULL);
+    sitlReactorAdd(rcLink.fd, SITL_REACTOR_READ, onRcReadable, NULL);
 
-    ret = pthread_create(&udpWorker, NULL, udpThread, NULL);
-    if (ret != 0) {
-        printf("Create udpWorker error!\n");
-        exit(1);
+    // physics and replay need no simulator
+    if (shmName && !physicsEnabled && !replaying()) {
+        shmRegion = sitlShmCreate(shmName, sizeof(fdm_packet), sizeof(servo_packet));
+        if (!shmRegion) {
+            exit(1);
+        }
+        atexit(shmClose);
+        printf("[SITL] created shared memory link %s\n", shmName);
+    }
+
+    if (worldEnabled()) {
+        ret = udpInit(&worldMotorLink, simulator_ip, SITL_WORLD_MOTOR_PORT, false);
+        printf("[SITL] init motor UDP link to world %s:%d...%d\n", simulator_ip, SITL_WORLD_MOTOR_PORT, ret);
+
+        ret = udpInitMulticast(&worldStateLink, worldGroup, SITL_WORLD_STATE_PORT);
+        printf("[SITL] join world group %s:%d...%d\n", worldGroup, SITL_WORLD_STATE_PORT, ret);
+
+        sitlReactorAdd(worldStateLink.fd, SITL_REACTOR_READ, onWorldStateReadable, NULL);
+        fdmSourceLink = &worldStateLink;
     }
 
-    ret = pthread_create(&udpWorkerRC, NULL, udpRCThread, NULL);
-    if (ret != 0) {
-        printf("Create udpRCThread error!\n");
+    // serial ports join it as they are opened
+    if (!sitlReactorStart()) {
+        printf("Create I/O thread error!\n");
         exit(1);
     }
 }
@@ -635,9 +996,7 @@ void systemInit(void)
 void systemReset(void)
 {
     printf("[system]Reset!\n");
-    workerRunning = false;
-    pthread_join(tcpWorker, NULL);
-    pthread_join(udpWorker, NULL);
+    sitlReactorStop();
     exit(0);
 }
 void systemResetToBootloader(bootloaderRequestType_e requestType)
@@ -645,9 +1004,7 @@ void systemResetToBootloader(bootloaderRequestType_e requestType)
     UNUSED(requestType);
 
     printf("[system]ResetToBootloader!\n");
-    workerRunning = false;
-    pthread_join(tcpWorker, NULL);
-    pthread_join(udpWorker, NULL);
+    sitlReactorStop();
     exit(0);
 }
 
@@ -697,6 +1054,12 @@ uint64_t micros64(void)
     static uint64_t out = 0;
     uint64_t now = nanos64_real();
 
+#ifdef USE_BLACKBOX_REPLAY
+    if (replayClockRunning) {
+        return replayClockUs;
+    }
+#endif
+
     out += (now - last) * simRate;
     last = now;
 
@@ -709,6 +1072,12 @@ uint64_t millis64(void)
     static uint64_t out = 0;
     uint64_t now = nanos64_real();
 
+#ifdef USE_BLACKBOX_REPLAY
+    if (replayClockRunning) {
+        return replayClockUs / 1000;
+    }
+#endif
+
     out += (now - last) * simRate;
     last = now;
 
@@ -760,6 +1129,12 @@ static void microsleep(uint32_t usec)
 
 void delayMicroseconds(uint32_t us)
 {
+#ifdef USE_BLACKBOX_REPLAY
+    if (replayClockRunning) {
+        replayClockUs += us;
+        return;
+    }
+#endif
     microsleep(us / simRate);
 }
 
@@ -770,6 +1145,12 @@ void delayMicroseconds_real(uint32_t us)
 
 void delay(uint32_t ms)
 {
+#ifdef USE_BLACKBOX_REPLAY
+    if (replayClockRunning) {
+        replayClockUs += ms * 1000ULL;
+        return;
+    }
+#endif
     uint64_t start = millis64();
 
     while ((millis64() - start) < ms) {
@@ -872,10 +1253,27 @@ static void pwmCompleteMotorUpdate(void)
         pwmPkt.motor_speed[i] = motorsPwm[i] / outScale;
     }
 
+    if (physicsEnabled) {
+        // the model has no reversible props; 3D commands below neutral idle
+        const double motorCommand[SITL_PHYSICS_MOTOR_COUNT] = {
+            pwmPkt.motor_speed[0], pwmPkt.motor_speed[1], pwmPkt.motor_speed[2], pwmPkt.motor_speed[3],
+        };
+        physicsUpdate(motorCommand);
+        return;
+    }
+
+    // open loop: nothing listens to the motors
+    if (replaying()) {
+        return;
+    }
+
     // get one "fdm_packet" can only send one "servo_packet"!!
-    if (pthread_mutex_trylock(&updateLock) != 0) return;
-    udpSend(&pwmLink, &pwmPkt, sizeof(servo_packet));
-    udpSend(&pwmRawLink, &pwmRawPkt, sizeof(servo_packet_raw));
+    if (!motorUpdateAllowed) return;
+    motorUpdateAllowed = false;
+    sendMotorUpdate();
+    if (!worldEnabled() && !shmRegion) {
+        udpSend(&pwmRawLink, &pwmRawPkt, sizeof(servo_packet_raw));
+    }
 }
 
 void servoWrite(uint8_t index, float value)
@@ -942,7 +1340,7 @@ bool loadEEPROMFromFile(void)
     }
 
     // open or create
-    eepromFd = fopen(EEPROM_FILENAME, "r+");
+    eepromFd = fopen(eepromFileName, "r+");
     if (eepromFd != NULL) {
         // obtain file size:
         fseek(eepromFd, 0, SEEK_END);
@@ -951,15 +1349,15 @@ bool loadEEPROMFromFile(void)
 
         size_t n = fread(eepromData, 1, sizeof(eepromData), eepromFd);
         if (n == lSize) {
-            printf("[FLASH_Unlock] loaded '%s', size = %ld / %ld\n", EEPROM_FILENAME, lSize, sizeof(eepromData));
+            printf("[FLASH_Unlock] loaded '%s', size = %ld / %ld\n", eepromFileName, lSize, sizeof(eepromData));
         } else {
-            fprintf(stderr, "[FLASH_Unlock] failed to load '%s'\n", EEPROM_FILENAME);
+            fprintf(stderr, "[FLASH_Unlock] failed to load '%s'\n", eepromFileName);
             return false;
         }
     } else {
-        printf("[FLASH_Unlock] created '%s', size = %ld\n", EEPROM_FILENAME, sizeof(eepromData));
-        if ((eepromFd = fopen(EEPROM_FILENAME, "w+")) == NULL) {
-            fprintf(stderr, "[FLASH_Unlock] failed to create '%s'\n", EEPROM_FILENAME);
+        printf("[FLASH_Unlock] created '%s', size = %ld\n", eepromFileName, sizeof(eepromData));
+        if ((eepromFd = fopen(eepromFileName, "w+")) == NULL) {
+            fprintf(stderr, "[FLASH_Unlock] failed to create '%s'\n", eepromFileName);
             return false;
         }
 
@@ -984,7 +1382,7 @@ void configLock(void)
         fwrite(eepromData, 1, sizeof(eepromData), eepromFd);
         fclose(eepromFd);
         eepromFd = NULL;
-        printf("[FLASH_Lock] saved '%s'\n", EEPROM_FILENAME);
+        printf("[FLASH_Lock] saved '%s'\n", eepromFileName);
     } else {
         fprintf(stderr, "[FLASH_Lock] eeprom is not unlocked\n");
     }
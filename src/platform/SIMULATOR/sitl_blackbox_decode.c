@@ -0,0 +1,598 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blackbox/blackbox.h"
+#include "blackbox/blackbox_fielddefs.h"
+
+#include "sitl_blackbox_decode.h"
+
+#define LOG_START_MARKER    "H Product:"
+#define HEADER_LINE_MAX     4096
+#define LOG_END_MESSAGE     "End of log"
+
+static uint8_t readByte(blackboxDecoder_t *decoder)
+{
+    if (decoder->pos >= decoder->length) {
+        decoder->overrun = true;
+        return 0;
+    }
+    return decoder->data[decoder->pos++];
+}
+
+static uint32_t readUnsignedVB(blackboxDecoder_t *decoder)
+{
+    uint32_t result = 0;
+
+    // 5 bytes carry all 32 bits; anything longer is corruption
+    for (int shift = 0; shift < 35; shift += 7) {
+        const uint8_t c = readByte(decoder);
+        result |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return result;
+        }
+    }
+    decoder->overrun = true;
+    return 0;
+}
+
+static int32_t readSignedVB(blackboxDecoder_t *decoder)
+{
+    const uint32_t i = readUnsignedVB(decoder);
+
+    // ZigZag decode
+    return (int32_t)((i >> 1) ^ -(int32_t)(i & 1));
+}
+
+static int32_t signExtend(uint32_t value, int bits)
+{
+    const uint32_t signBit = 1U << (bits - 1);
+    const uint32_t mask = (bits == 32) ? 0xFFFFFFFF : ((1U << bits) - 1);
+
+    return (int32_t)(((value & mask) ^ signBit) - signBit);
+}
+
+// The 32 bit case shared by both TAG2_3S* encodings: two bits per field give its byte count
+static void readTag2Bytes(blackboxDecoder_t *decoder, uint8_t selectors, int32_t values[3])
+{
+    for (int i = 0; i < 3; i++, selectors >>= 2) {
+        const int bytes = (selectors & 0x03) + 1;
+        uint32_t value = 0;
+        for (int b = 0; b < bytes; b++) {
+            value |= (uint32_t)readByte(decoder) << (8 * b);
+        }
+        values[i] = signExtend(value, 8 * bytes);
+    }
+}
+
+static void readTag2_3S32(blackboxDecoder_t *decoder, int32_t values[3])
+{
+    const uint8_t lead = readByte(decoder);
+    uint8_t b;
+
+    switch (lead >> 6) {
+    case 0:
+        values[0] = signExtend(lead >> 4, 2);
+        values[1] = signExtend(lead >> 2, 2);
+        values[2] = signExtend(lead, 2);
+        break;
+    case 1:
+        values[0] = signExtend(lead, 4);
+        b = readByte(decoder);
+        values[1] = signExtend(b >> 4, 4);
+        values[2] = signExtend(b, 4);
+        break;
+    case 2:
+        values[0] = signExtend(lead, 6);
+        values[1] = signExtend(readByte(decoder), 6);
+        values[2] = signExtend(readByte(decoder), 6);
+        break;
+    default:
+        readTag2Bytes(decoder, lead, values);
+        break;
+    }
+}
+
+static void readTag2_3SVariable(blackboxDecoder_t *decoder, int32_t values[3])
+{
+    const uint8_t lead = readByte(decoder);
+    uint8_t b1, b2;
+
+    switch (lead >> 6) {
+    case 0:
+        values[0] = signExtend(lead >> 4, 2);
+        values[1] = signExtend(lead >> 2, 2);
+        values[2] = signExtend(lead, 2);
+        break;
+    case 1:
+        // 554 bits per field  ss11 1112 2222 3333
+        b1 = readByte(decoder);
+        values[0] = signExtend(lead >> 1, 5);
+        values[1] = signExtend(((lead & 0x01) << 4) | (b1 >> 4), 5);
+        values[2] = signExtend(b1, 4);
+        break;
+    case 2:
+        // 877 bits per field  ss11 1111 1122 2222 2333 3333
+        b1 = readByte(decoder);
+        b2 = readByte(decoder);
+        values[0] = signExtend(((lead & 0x3F) << 2) | (b1 >> 6), 8);
+        values[1] = signExtend(((b1 & 0x3F) << 1) | (b2 >> 7), 7);
+        values[2] = signExtend(b2, 7);
+        break;
+    default:
+        readTag2Bytes(decoder, lead, values);
+        break;
+    }
+}
+
+static void readTag8_4S16(blackboxDecoder_t *decoder, int32_t values[4])
+{
+    uint8_t selector = readByte(decoder);
+    bool nibbleIndex = false;   // true when the low nibble of buffer is still unread
+    uint8_t buffer = 0;
+
+    for (int i = 0; i < 4; i++, selector >>= 2) {
+        switch (selector & 0x03) {
+        case 0:
+            values[i] = 0;
+            break;
+        case 1:
+            if (!nibbleIndex) {
+                buffer = readByte(decoder);
+                values[i] = signExtend(buffer >> 4, 4);
+            } else {
+                values[i] = signExtend(buffer, 4);
+            }
+            nibbleIndex = !nibbleIndex;
+            break;
+        case 2:
+            if (!nibbleIndex) {
+                values[i] = signExtend(readByte(decoder), 8);
+            } else {
+                const uint8_t high = buffer & 0x0F;
+                buffer = readByte(decoder);
+                values[i] = signExtend((high << 4) | (buffer >> 4), 8);
+            }
+            break;
+        case 3:
+            if (!nibbleIndex) {
+                const uint8_t high = readByte(decoder);
+                values[i] = signExtend((high << 8) | readByte(decoder), 16);
+            } else {
+                const uint8_t high = buffer & 0x0F;
+                const uint8_t middle = readByte(decoder);
+                buffer = readByte(decoder);
+                values[i] = signExtend((high << 12) | (middle << 4) | (buffer >> 4), 16);
+            }
+            break;
+        }
+    }
+}
+
+static void readTag8_8SVB(blackboxDecoder_t *decoder, int32_t *values, int count)
+{
+    // A lone field is written without the header byte
+    if (count == 1) {
+        values[0] = readSignedVB(decoder);
+        return;
+    }
+
+    uint8_t header = readByte(decoder);
+    for (int i = 0; i < count; i++, header >>= 1) {
+        values[i] = (header & 0x01) ? readSignedVB(decoder) : 0;
+    }
+}
+
+static int32_t predict(const blackboxDecoder_t *decoder, const blackboxDecodeFieldDefs_t *defs, int i, int32_t value,
+                       const int32_t *current, const int32_t *prev, const int32_t *prev2)
+{
+    switch (defs->predictor[i]) {
+    case FLIGHT_LOG_FIELD_PREDICTOR_0:
+        return value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_PREVIOUS:
+        return prev ? value + prev[i] : value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_STRAIGHT_LINE:
+        return prev ? value + 2 * prev[i] - prev2[i] : value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_AVERAGE_2:
+        // The writer averages in int, truncating toward zero
+        return prev ? value + (prev[i] + prev2[i]) / 2 : value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_MINTHROTTLE:
+        return value + decoder->minthrottle;
+    case FLIGHT_LOG_FIELD_PREDICTOR_MOTOR_0:
+        return decoder->motor0Index >= 0 && decoder->motor0Index < i ? value + current[decoder->motor0Index] : value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_INC:
+        // Only main P frames carry this, one per P interval iterations
+        return prev ? value + prev[i] + (decoder->pInterval > 0 ? decoder->pInterval : 1) : value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_HOME_COORD:
+        if (decoder->gpsHomeIndex[0] < 0) {
+            return value;
+        }
+        return value + decoder->gpsHome[decoder->gpsHomeIndex[i == decoder->gpsCoordIndex ? 0 : 1]];
+    case FLIGHT_LOG_FIELD_PREDICTOR_1500:
+        return value + 1500;
+    case FLIGHT_LOG_FIELD_PREDICTOR_VBATREF:
+        return value + decoder->vbatref;
+    case FLIGHT_LOG_FIELD_PREDICTOR_LAST_MAIN_FRAME_TIME:
+        return decoder->mainTimeIndex >= 0 ? value + decoder->main[0][decoder->mainTimeIndex] : value;
+    case FLIGHT_LOG_FIELD_PREDICTOR_MINMOTOR:
+        return value + decoder->motorOutputLow;
+    default:
+        return value;
+    }
+}
+
+// Decode one frame's fields into current; prev/prev2 are NULL for frames that are not deltas
+static bool readFields(blackboxDecoder_t *decoder, const blackboxDecodeFieldDefs_t *defs,
+                       int32_t *current, const int32_t *prev, const int32_t *prev2)
+{
+    for (int i = 0; i < defs->count;) {
+        int32_t values[8];
+        int count = 1;
+
+        switch (defs->encoding[i]) {
+        case FLIGHT_LOG_FIELD_ENCODING_SIGNED_VB:
+            values[0] = readSignedVB(decoder);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_UNSIGNED_VB:
+            values[0] = (int32_t)readUnsignedVB(decoder);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_NEG_14BIT:
+            values[0] = -signExtend(readUnsignedVB(decoder), 14);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_NULL:
+            values[0] = 0;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG8_4S16:
+            readTag8_4S16(decoder, values);
+            count = 4;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG2_3S32:
+            readTag2_3S32(decoder, values);
+            count = 3;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG2_3SVARIABLE:
+            readTag2_3SVariable(decoder, values);
+            count = 3;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG8_8SVB:
+            // Groups up to 8 consecutive fields sharing the encoding
+            while (count < 8 && i + count < defs->count && defs->encoding[i + count] == FLIGHT_LOG_FIELD_ENCODING_TAG8_8SVB) {
+                count++;
+            }
+            readTag8_8SVB(decoder, values, count);
+            break;
+        default:
+            return false;
+        }
+
+        for (int j = 0; j < count && i < defs->count; j++, i++) {
+            current[i] = predict(decoder, defs, i, values[j], current, prev, prev2);
+        }
+    }
+
+    return !decoder->overrun;
+}
+
+static bool readEvent(blackboxDecoder_t *decoder)
+{
+    decoder->event = readByte(decoder);
+    decoder->eventValue[0] = 0;
+    decoder->eventValue[1] = 0;
+
+    switch (decoder->event) {
+    case FLIGHT_LOG_EVENT_SYNC_BEEP:
+    case FLIGHT_LOG_EVENT_DISARM:
+        decoder->eventValue[0] = readUnsignedVB(decoder);
+        break;
+    case FLIGHT_LOG_EVENT_FLIGHTMODE:
+        decoder->eventValue[0] = readUnsignedVB(decoder);
+        decoder->eventValue[1] = readUnsignedVB(decoder);
+        break;
+    case FLIGHT_LOG_EVENT_INFLIGHT_ADJUSTMENT: {
+        const uint8_t function = readByte(decoder);
+        decoder->eventValue[0] = function;
+        if (function & FLIGHT_LOG_EVENT_INFLIGHT_ADJUSTMENT_FUNCTION_FLOAT_VALUE_FLAG) {
+            for (int i = 0; i < 4; i++) {
+                decoder->eventValue[1] |= (uint32_t)readByte(decoder) << (8 * i);
+            }
+        } else {
+            decoder->eventValue[1] = readSignedVB(decoder);
+        }
+        break;
+    }
+    case FLIGHT_LOG_EVENT_LOGGING_RESUME:
+        decoder->eventValue[0] = readUnsignedVB(decoder);
+        decoder->eventValue[1] = readUnsignedVB(decoder);
+        // The main stream restarts from the next I frame
+        decoder->mainValid = false;
+        break;
+    case FLIGHT_LOG_EVENT_LOG_END:
+        if (decoder->length - decoder->pos < sizeof(LOG_END_MESSAGE)
+            || memcmp(decoder->data + decoder->pos, LOG_END_MESSAGE, sizeof(LOG_END_MESSAGE)) != 0) {
+            return false;
+        }
+        decoder->pos += sizeof(LOG_END_MESSAGE);
+        decoder->ended = true;
+        break;
+    default:
+        return false;
+    }
+
+    return !decoder->overrun;
+}
+
+static bool isFrameStart(uint8_t c)
+{
+    return c == 'I' || c == 'P' || c == 'G' || c == 'H' || c == 'S' || c == 'E';
+}
+
+static bool startsWith(const blackboxDecoder_t *decoder, size_t pos, const char *text)
+{
+    const size_t length = strlen(text);
+
+    return decoder->length - pos >= length && memcmp(decoder->data + pos, text, length) == 0;
+}
+
+char blackboxDecodeNextFrame(blackboxDecoder_t *decoder)
+{
+    while (!decoder->ended && decoder->pos < decoder->length) {
+        const size_t start = decoder->pos;
+        const char type = readByte(decoder);
+        int32_t fields[BLACKBOX_DECODE_MAX_FIELDS];
+        bool valid;
+
+        // A second log in the same file
+        if (type == 'H' && startsWith(decoder, start, LOG_START_MARKER)) {
+            break;
+        }
+
+        decoder->overrun = false;
+        switch (type) {
+        case 'I':
+            valid = readFields(decoder, &decoder->iDefs, fields, NULL, NULL);
+            break;
+        case 'P':
+            valid = decoder->pDefs.count == decoder->iDefs.count
+                && readFields(decoder, &decoder->pDefs, fields, decoder->main[0], decoder->main[1]);
+            break;
+        case 'G':
+            valid = readFields(decoder, &decoder->gDefs, fields, NULL, NULL);
+            break;
+        case 'H':
+            valid = readFields(decoder, &decoder->hDefs, fields, NULL, NULL);
+            break;
+        case 'S':
+            valid = readFields(decoder, &decoder->sDefs, fields, NULL, NULL);
+            break;
+        case 'E':
+            valid = readEvent(decoder);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+
+        // Like blackbox-tools, only trust a frame that is followed by another frame or the end of the data
+        if (valid && !decoder->ended && decoder->pos < decoder->length) {
+            valid = isFrameStart(decoder->data[decoder->pos]);
+        }
+
+        if (!valid) {
+            // Scan forward a byte at a time until something decodes again
+            if (!decoder->resyncing) {
+                decoder->corruptFrames++;
+                decoder->resyncing = true;
+            }
+            decoder->mainValid = false;
+            decoder->ended = false;
+            decoder->pos = start + 1;
+            continue;
+        }
+        decoder->resyncing = false;
+
+        switch (type) {
+        case 'I':
+            memcpy(decoder->main[0], fields, sizeof(fields));
+            memcpy(decoder->main[1], fields, sizeof(fields));
+            memcpy(decoder->main[2], fields, sizeof(fields));
+            decoder->mainValid = true;
+            break;
+        case 'P':
+            if (!decoder->mainValid) {
+                // A delta against an unknown base; wait for the next I frame
+                continue;
+            }
+            memcpy(decoder->main[2], decoder->main[1], sizeof(fields));
+            memcpy(decoder->main[1], decoder->main[0], sizeof(fields));
+            memcpy(decoder->main[0], fields, sizeof(fields));
+            break;
+        case 'G':
+            memcpy(decoder->gps, fields, sizeof(fields));
+            break;
+        case 'H':
+            memcpy(decoder->gpsHome, fields, sizeof(fields));
+            break;
+        case 'S':
+            memcpy(decoder->slow, fields, sizeof(fields));
+            break;
+        default:
+            break;
+        }
+
+        return type;
+    }
+
+    decoder->ended = true;
+    return 0;
+}
+
+int blackboxDecodeFieldIndex(const blackboxDecodeFieldDefs_t *defs, const char *name)
+{
+    for (int i = 0; i < defs->count; i++) {
+        if (defs->name[i] && strcmp(defs->name[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static blackboxDecodeFieldDefs_t *fieldDefsFor(blackboxDecoder_t *decoder, char frameType)
+{
+    switch (frameType) {
+    case 'I':
+        return &decoder->iDefs;
+    case 'P':
+        return &decoder->pDefs;
+    case 'G':
+        return &decoder->gDefs;
+    case 'H':
+        return &decoder->hDefs;
+    case 'S':
+        return &decoder->sDefs;
+    default:
+        return NULL;
+    }
+}
+
+static void parseFieldNames(blackboxDecoder_t *decoder, blackboxDecodeFieldDefs_t *defs, char *value)
+{
+    defs->count = 0;
+    for (char *name = strtok(value, ","); name && defs->count < BLACKBOX_DECODE_MAX_FIELDS; name = strtok(NULL, ",")) {
+        const size_t length = strlen(name) + 1;
+        if (decoder->namesUsed + length > sizeof(decoder->names)) {
+            break;
+        }
+        memcpy(decoder->names + decoder->namesUsed, name, length);
+        defs->name[defs->count++] = decoder->names + decoder->namesUsed;
+        decoder->namesUsed += length;
+    }
+}
+
+static int parseFieldValues(uint8_t *out, char *value)
+{
+    int count = 0;
+
+    for (char *item = strtok(value, ","); item && count < BLACKBOX_DECODE_MAX_FIELDS; item = strtok(NULL, ",")) {
+        out[count++] = atoi(item);
+    }
+    return count;
+}
+
+static void parseHeaderLine(blackboxDecoder_t *decoder, char *line)
+{
+    char *value = strchr(line, ':');
+    if (!value) {
+        return;
+    }
+    *value++ = '\0';
+
+    char frameType;
+    char property[16];
+    if (sscanf(line, "Field %c %15s", &frameType, property) == 2) {
+        blackboxDecodeFieldDefs_t *defs = fieldDefsFor(decoder, frameType);
+        if (!defs) {
+            return;
+        }
+        if (strcmp(property, "name") == 0) {
+            parseFieldNames(decoder, defs, value);
+        } else if (strcmp(property, "signed") == 0) {
+            parseFieldValues(defs->isSigned, value);
+        } else if (strcmp(property, "predictor") == 0) {
+            const int count = parseFieldValues(defs->predictor, value);
+            // P frames have no name line of their own
+            if (frameType == 'P') {
+                defs->count = count;
+            }
+        } else if (strcmp(property, "encoding") == 0) {
+            parseFieldValues(defs->encoding, value);
+        }
+    } else if (strcmp(line, "I interval") == 0) {
+        decoder->iInterval = atoi(value);
+    } else if (strcmp(line, "P interval") == 0) {
+        // Old logs give a "num/denom" ratio of logged to skipped frames
+        const char *slash = strchr(value, '/');
+        const int numerator = atoi(value);
+        decoder->pInterval = (slash && numerator > 0) ? atoi(slash + 1) / numerator : numerator;
+    } else if (strcmp(line, "minthrottle") == 0) {
+        decoder->minthrottle = atoi(value);
+    } else if (strcmp(line, "motorOutput") == 0) {
+        decoder->motorOutputLow = atoi(value);
+        const char *comma = strchr(value, ',');
+        decoder->motorOutputHigh = comma ? atoi(comma + 1) : decoder->motorOutputLow;
+    } else if (strcmp(line, "vbatref") == 0) {
+        decoder->vbatref = atoi(value);
+    } else if (strcmp(line, "acc_1G") == 0) {
+        decoder->acc1G = atoi(value);
+    } else if (strcmp(line, "looptime") == 0) {
+        decoder->looptimeUs = atoi(value);
+    } else if (strcmp(line, "blackbox_high_resolution") == 0) {
+        decoder->highResolution = atoi(value) != 0;
+    }
+}
+
+bool blackboxDecodeInit(blackboxDecoder_t *decoder, const uint8_t *data, size_t length)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->data = data;
+    decoder->length = length;
+
+    // Skip anything ahead of the first log
+    while (decoder->pos < length && !startsWith(decoder, decoder->pos, LOG_START_MARKER)) {
+        decoder->pos++;
+    }
+
+    while (startsWith(decoder, decoder->pos, "H ")) {
+        char line[HEADER_LINE_MAX];
+        size_t lineLength = 0;
+
+        decoder->pos += 2;
+        while (decoder->pos < length && data[decoder->pos] != '\n') {
+            if (lineLength < sizeof(line) - 1) {
+                line[lineLength++] = data[decoder->pos];
+            }
+            decoder->pos++;
+        }
+        decoder->pos++;
+        line[lineLength] = '\0';
+
+        parseHeaderLine(decoder, line);
+    }
+
+    // P frames reuse the I frame names and signedness
+    for (int i = 0; i < decoder->pDefs.count; i++) {
+        decoder->pDefs.name[i] = decoder->iDefs.name[i];
+        decoder->pDefs.isSigned[i] = decoder->iDefs.isSigned[i];
+    }
+
+    decoder->motor0Index = blackboxDecodeFieldIndex(&decoder->iDefs, "motor[0]");
+    decoder->mainTimeIndex = blackboxDecodeFieldIndex(&decoder->iDefs, "time");
+    decoder->gpsCoordIndex = blackboxDecodeFieldIndex(&decoder->gDefs, "GPS_coord[0]");
+    decoder->gpsHomeIndex[0] = blackboxDecodeFieldIndex(&decoder->hDefs, "GPS_home[0]");
+    decoder->gpsHomeIndex[1] = blackboxDecodeFieldIndex(&decoder->hDefs, "GPS_home[1]");
+
+    return decoder->iDefs.count > 0 && decoder->pos <= length;
+}
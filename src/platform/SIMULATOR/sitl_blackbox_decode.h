@@ -0,0 +1,97 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Decoder for the log format written by blackbox.c, for SITL replay (--replay).
+//
+// Like blackbox-tools it is driven entirely by the "H Field" definitions in the
+// log header rather than by this build's field tables, so logs from firmware
+// with different field sets, conditions or motor counts decode unchanged. Only
+// the first log of a multi-log file is read.
+
+#define BLACKBOX_DECODE_MAX_FIELDS      128
+#define BLACKBOX_DECODE_NAME_STORAGE    2048
+
+typedef struct blackboxDecodeFieldDefs_s {
+    int count;
+    const char *name[BLACKBOX_DECODE_MAX_FIELDS];   // "gyroADC[0]"; P frames share the I names
+    uint8_t isSigned[BLACKBOX_DECODE_MAX_FIELDS];
+    uint8_t predictor[BLACKBOX_DECODE_MAX_FIELDS];  // flightLogFieldPredictor_e
+    uint8_t encoding[BLACKBOX_DECODE_MAX_FIELDS];   // flightLogFieldEncoding_e
+} blackboxDecodeFieldDefs_t;
+
+typedef struct blackboxDecoder_s {
+    const uint8_t *data;
+    size_t length;
+    size_t pos;
+
+    // From the header
+    blackboxDecodeFieldDefs_t iDefs;
+    blackboxDecodeFieldDefs_t pDefs;
+    blackboxDecodeFieldDefs_t gDefs;
+    blackboxDecodeFieldDefs_t hDefs;
+    blackboxDecodeFieldDefs_t sDefs;
+    char names[BLACKBOX_DECODE_NAME_STORAGE];
+    size_t namesUsed;
+    int iInterval;
+    int pInterval;
+    int minthrottle;
+    int motorOutputLow;
+    int motorOutputHigh;
+    int vbatref;
+    int acc1G;
+    int looptimeUs;
+    bool highResolution;
+    int motor0Index;                // fields the predictors refer to, -1 if absent
+    int mainTimeIndex;
+    int gpsCoordIndex;
+    int gpsHomeIndex[2];
+
+    // Decoded state: main[0] is the latest I or P frame, main[1] and main[2] the two before it
+    int32_t main[3][BLACKBOX_DECODE_MAX_FIELDS];
+    bool mainValid;                 // false until an I frame arrives, and after corruption
+    int32_t gps[BLACKBOX_DECODE_MAX_FIELDS];
+    int32_t gpsHome[BLACKBOX_DECODE_MAX_FIELDS];
+    int32_t slow[BLACKBOX_DECODE_MAX_FIELDS];
+    uint8_t event;                  // FlightLogEvent of the latest E frame
+    uint32_t eventValue[2];         // its integer payload, if any
+    bool ended;
+    bool overrun;
+    bool resyncing;
+    unsigned corruptFrames;         // times the stream lost sync
+} blackboxDecoder_t;
+
+// Parse the header of the log in data[0..length). Returns false when there is
+// no usable header (no main field definitions).
+bool blackboxDecodeInit(blackboxDecoder_t *decoder, const uint8_t *data, size_t length);
+
+// Decode the next frame and return its type: 'I', 'P', 'G', 'H', 'S' or 'E',
+// or 0 at the end of the log. Main frames that cannot be decoded are dropped
+// and the stream resynchronises on the next I frame.
+char blackboxDecodeNextFrame(blackboxDecoder_t *decoder);
+
+// Index of a named field ("gyroADC[0]", "GPS_coord[1]", "time") or -1
+int blackboxDecodeFieldIndex(const blackboxDecodeFieldDefs_t *defs, const char *name);
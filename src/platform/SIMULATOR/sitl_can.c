@@ -0,0 +1,482 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include "platform.h"
+
+#if ENABLE_CAN
+
+#include "drivers/can/can.h"
+#include "drivers/can/can_impl.h"
+
+#include "pg/can.h"
+
+#include "sitl_can_bus.h"
+#include "sitl_reactor.h"
+#include "sitl_spsc.h"
+#include "udplink.h"
+
+// CAN controllers on the virtual bus of sitl_can_bus.h, one multicast port
+// per device.
+//
+// The I/O thread plays the peripheral: it announces queued frames, keeps the
+// bus timeline and times frame ends with a timerfd (the 1 ms reactor tick
+// where there is none). Received frames are queued to the main loop, which
+// hands them to the rx callback between tasks the way the ISR would.
+// canTransmit() fills the software TX ring as on hardware; its head is
+// written by the main loop and its tail by the I/O thread.
+//
+// Every frame is acknowledged, so the no-ACK stall recovery of the hardware
+// driver has nothing to do here.
+//
+// Acceptance filters are applied in the I/O thread, where the controller
+// would apply them, so rejected frames never reach the queue. There is no
+// filter RAM to run out of; canSetFilters() only merges lists longer than
+// SITL_CAN_FILTER_CAPACITY.
+
+#define SITL_CAN_MAX_BITRATE        1000000
+#define SITL_CAN_RX_QUEUE_LENGTH    64      // frames, power of two
+#define SITL_CAN_STATUS_PERIOD_MS   5000
+#define SITL_CAN_FILTER_CAPACITY    CAN_FILTER_LIST_MAX
+
+typedef struct canRxRecord_s {
+    uint32_t id;
+    uint8_t flags;
+    uint8_t length;
+    uint8_t data[CAN_CLASSIC_MAX_DLC];
+} canRxRecord_t;
+
+typedef struct sitlCanController_s {
+    udpLink_t rxLink;
+    udpLink_t txLink;
+    int timerFd;
+    uint32_t sender;
+    // I/O thread only
+    sitlCanBus_t bus;
+    bool txOnBus;               // the ring's tail frame is on the timeline
+    uint32_t lastStatusFrames;
+    uint64_t lastStatusBusyNs;
+    uint64_t lastStatusNs;
+    uint32_t rxFiltered;        // frames the acceptance filters rejected
+    // Odd while the main loop rewrites the filters in canDevice
+    uint32_t filterSeq;
+    // I/O thread -> main loop
+    sitlSpsc_t rxQueue;
+    canRxRecord_t rxStorage[SITL_CAN_RX_QUEUE_LENGTH];
+} sitlCanController_t;
+
+static sitlCanController_t controllers[CANDEV_COUNT];
+static bool reactorHooked = false;
+
+const canHardware_t canHardware[CANDEV_COUNT] = {
+    { .device = CANDEV_1, .reg = (canResource_t *)&controllers[CANDEV_1] },
+    { .device = CANDEV_2, .reg = (canResource_t *)&controllers[CANDEV_2] },
+    { .device = CANDEV_3, .reg = (canResource_t *)&controllers[CANDEV_3] },
+};
+
+canDevice_t canDevice[CANDEV_COUNT];
+
+static uint64_t monotonicNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// No pins to route: every device has a transceiver on the virtual bus
+void canPinConfigure(const canPinConfig_t *pConfig)
+{
+    UNUSED(pConfig);
+
+    for (size_t hwindex = 0; hwindex < ARRAYLEN(canHardware); hwindex++) {
+        const canHardware_t *hw = &canHardware[hwindex];
+        canDevice[hw->device].reg = hw->reg;
+    }
+}
+
+// I/O thread
+
+static void armTimer(sitlCanController_t *ctrl)
+{
+#ifdef __linux__
+    const uint64_t deadline = sitlCanBusDeadline(&ctrl->bus);
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (deadline != UINT64_MAX) {
+        its.it_value.tv_sec = deadline / 1000000000;
+        its.it_value.tv_nsec = deadline % 1000000000;
+        // zero disarms
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+            its.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(ctrl->timerFd, TFD_TIMER_ABSTIME, &its, NULL);
+#else
+    UNUSED(ctrl);
+#endif
+}
+
+static void startNextFrame(canDevice_e device, uint64_t nowNs)
+{
+    sitlCanController_t *ctrl = &controllers[device];
+    canDevice_t *pDev = &canDevice[device];
+
+    const uint8_t tail = pDev->txTail;
+    if (ctrl->txOnBus || tail == __atomic_load_n(&pDev->txHead, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    const canTxFrame_t *tx = &pDev->txRing[tail];
+    sitlCanWireFrame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.magic = SITL_CAN_MAGIC;
+    frame.sender = ctrl->sender;
+    frame.bitrate = ctrl->bus.bitrate;
+    frame.id = tx->id;
+    frame.flags = tx->isExtended ? SITL_CAN_FLAG_EXTENDED : 0;
+    frame.length = tx->length;
+    memcpy(frame.data, tx->data, tx->length);
+    frame.bits = sitlCanFrameBits(tx->id, tx->isExtended, tx->data, tx->length);
+    const uint64_t idleNs = sitlCanBusIdleFrom(&ctrl->bus);
+    frame.startNs = nowNs > idleNs ? nowNs : idleNs;
+
+    // a full timeline retries on the next frame end
+    if (sitlCanBusAnnounce(&ctrl->bus, &frame, true, nowNs)) {
+        udpSend(&ctrl->txLink, &frame, sizeof(frame));
+        ctrl->txOnBus = true;
+    }
+}
+
+// Frames arriving while canSetFilters() runs pass, as they would between
+// two filter writes on hardware
+static bool acceptFrame(canDevice_e device, uint32_t id, bool isExtended)
+{
+    sitlCanController_t *ctrl = &controllers[device];
+    const canDevice_t *pDev = &canDevice[device];
+
+    const uint32_t seq = __atomic_load_n(&ctrl->filterSeq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+        return true;
+    }
+    const bool match = canFilterMatch(pDev->filters, pDev->filterCount, id, isExtended);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return match || __atomic_load_n(&ctrl->filterSeq, __ATOMIC_RELAXED) != seq;
+}
+
+static void serviceBus(canDevice_e device)
+{
+    sitlCanController_t *ctrl = &controllers[device];
+    canDevice_t *pDev = &canDevice[device];
+    const uint64_t nowNs = monotonicNs();
+    bool received = false;
+
+    sitlCanPending_t done;
+    while (sitlCanBusComplete(&ctrl->bus, nowNs, &done)) {
+        if (done.own) {
+            __atomic_store_n(&pDev->txTail, (pDev->txTail + 1U) & CAN_TX_RING_MASK, __ATOMIC_RELEASE);
+            pDev->txCompletions++;
+            ctrl->txOnBus = false;
+            continue;
+        }
+
+        if (!acceptFrame(device, done.frame.id, done.frame.flags & SITL_CAN_FLAG_EXTENDED)) {
+            ctrl->rxFiltered++;
+            continue;
+        }
+
+        canRxRecord_t record;
+        record.id = done.frame.id;
+        record.flags = done.frame.flags;
+        record.length = done.frame.length;
+        memcpy(record.data, done.frame.data, sizeof(record.data));
+        if (!sitlSpscPush(&ctrl->rxQueue, &record)) {
+            pDev->rxOverruns++;
+        }
+        received = true;
+    }
+
+    startNextFrame(device, nowNs);
+    armTimer(ctrl);
+    if (received) {
+        sitlReactorNotifyMain();
+    }
+}
+
+static void onBusReadable(int fd, uint8_t events, void *context)
+{
+    UNUSED(fd);
+    UNUSED(events);
+    const canDevice_e device = (canDevice_e)(intptr_t)context;
+    sitlCanController_t *ctrl = &controllers[device];
+
+    sitlCanWireFrame_t frame;
+    int n;
+    while ((n = udpRecv(&ctrl->rxLink, &frame, sizeof(frame), 0)) >= 0) {
+        if (n != sizeof(frame) || frame.magic != SITL_CAN_MAGIC || frame.sender == ctrl->sender
+            || frame.length > CAN_CLASSIC_MAX_DLC) {
+            continue;
+        }
+        sitlCanBusAnnounce(&ctrl->bus, &frame, false, monotonicNs());
+    }
+    serviceBus(device);
+}
+
+#ifdef __linux__
+static void onTimerExpired(int fd, uint8_t events, void *context)
+{
+    UNUSED(events);
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0) {
+        // spurious wake-up, the timer has been re-armed since
+    }
+    serviceBus((canDevice_e)(intptr_t)context);
+}
+#endif
+
+// canTransmit() queued a frame
+static void onWake(void *context)
+{
+    UNUSED(context);
+    for (int device = 0; device < CANDEV_COUNT; device++) {
+        if (canDevice[device].initialized) {
+            serviceBus((canDevice_e)device);
+        }
+    }
+}
+
+static void onStatusTimer(void *context)
+{
+    UNUSED(context);
+    const uint64_t nowNs = monotonicNs();
+
+    for (int device = 0; device < CANDEV_COUNT; device++) {
+        sitlCanController_t *ctrl = &controllers[device];
+        const canDevice_t *pDev = &canDevice[device];
+        const sitlCanBus_t *bus = &ctrl->bus;
+        if (!pDev->initialized || bus->frames == ctrl->lastStatusFrames) {
+            continue;
+        }
+
+        const double load = 100.0 * (bus->busyNs - ctrl->lastStatusBusyNs) / (nowNs - ctrl->lastStatusNs);
+        printf("[CAN%d] load %.1f%% frames %u (own %u) wait avg %uus max %uus late %u rx filtered %u overruns %u tx overflows %u\n",
+            CAN_DEV_TO_CFG(device), load, (unsigned)bus->frames, (unsigned)bus->ownFrames,
+            bus->ownFrames ? (unsigned)(bus->ownWaitNs / bus->ownFrames / 1000) : 0,
+            (unsigned)(bus->ownWaitMaxNs / 1000), (unsigned)bus->lateFrames,
+            (unsigned)ctrl->rxFiltered, (unsigned)pDev->rxOverruns, (unsigned)pDev->txRingOverflows);
+
+        ctrl->lastStatusFrames = bus->frames;
+        ctrl->lastStatusBusyNs = bus->busyNs;
+        ctrl->lastStatusNs = nowNs;
+    }
+}
+
+#ifndef __linux__
+static void onTick(void *context)
+{
+    onWake(context);
+}
+#endif
+
+// Main loop
+
+bool canInit(canDevice_e device, uint32_t bitrate)
+{
+    if (device < 0 || device >= CANDEV_COUNT) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+    sitlCanController_t *ctrl = &controllers[device];
+    if (!pDev->reg || pDev->initialized) {
+        return pDev->initialized;
+    }
+    if (bitrate == 0 || bitrate > SITL_CAN_MAX_BITRATE) {
+        return false;
+    }
+
+    const int port = SITL_CAN_PORT + device + sitlInstancePortOffset();
+    if (udpInitMulticast(&ctrl->rxLink, SITL_CAN_GROUP, port) != 0 || udpInit(&ctrl->txLink, SITL_CAN_GROUP, port, false) != 0) {
+        printf("[SITL] CAN%d: cannot join %s:%d\n", CAN_DEV_TO_CFG(device), SITL_CAN_GROUP, port);
+        return false;
+    }
+    // the bus stays on this host
+    const unsigned char ttl = 0;
+    setsockopt(ctrl->txLink.fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    ctrl->sender = (uint32_t)getpid() * 2654435761u ^ (uint32_t)monotonicNs();
+    sitlCanBusInit(&ctrl->bus, bitrate);
+    ctrl->lastStatusNs = monotonicNs();
+    sitlSpscInit(&ctrl->rxQueue, ctrl->rxStorage, sizeof(canRxRecord_t), SITL_CAN_RX_QUEUE_LENGTH);
+
+#ifdef __linux__
+    ctrl->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (ctrl->timerFd < 0 || !sitlReactorAdd(ctrl->timerFd, SITL_REACTOR_READ, onTimerExpired, (void *)(intptr_t)device)) {
+        return false;
+    }
+#endif
+    if (!reactorHooked) {
+        sitlReactorAddWakeHook(onWake, NULL);
+        sitlReactorAddTimer(SITL_CAN_STATUS_PERIOD_MS, onStatusTimer, NULL);
+#ifndef __linux__
+        sitlReactorAddTimer(1, onTick, NULL);
+#endif
+        reactorHooked = true;
+    }
+
+    pDev->initialized = true;
+    if (!sitlReactorAdd(ctrl->rxLink.fd, SITL_REACTOR_READ, onBusReadable, (void *)(intptr_t)device)) {
+        pDev->initialized = false;
+        return false;
+    }
+
+    printf("[SITL] CAN%d on udp://%s:%d at %u kbit/s\n", CAN_DEV_TO_CFG(device), SITL_CAN_GROUP, port, (unsigned)(bitrate / 1000));
+    return true;
+}
+
+uint8_t canFilterCapacity(canDevice_e device, bool isExtended)
+{
+    UNUSED(device);
+    UNUSED(isExtended);
+    return SITL_CAN_FILTER_CAPACITY;
+}
+
+bool canSetFilters(canDevice_e device, const canFilter_t *filters, uint8_t count)
+{
+    if (device < 0 || device >= CANDEV_COUNT || count > CAN_FILTER_LIST_MAX) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+    sitlCanController_t *ctrl = &controllers[device];
+
+    __atomic_add_fetch(&ctrl->filterSeq, 1, __ATOMIC_SEQ_CST);
+    memcpy(pDev->filters, filters, count * sizeof(*filters));
+    count = canFilterReduce(pDev->filters, count, false, canFilterCapacity(device, false));
+    pDev->filterCount = canFilterReduce(pDev->filters, count, true, canFilterCapacity(device, true));
+    __atomic_add_fetch(&ctrl->filterSeq, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void canRegisterRxCallback(canDevice_e device, canRxCallbackPtr callback)
+{
+    if (device < 0 || device >= CANDEV_COUNT) {
+        return;
+    }
+
+    canDevice[device].rxCallback = callback;
+}
+
+bool canTransmit(canDevice_e device, uint32_t identifier, bool isExtended,
+                 const uint8_t *data, uint8_t length)
+{
+    if (device < 0 || device >= CANDEV_COUNT) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+    if (!pDev->initialized || length > CAN_CLASSIC_MAX_DLC) {
+        return false;
+    }
+    if (length > 0 && data == NULL) {
+        return false;
+    }
+
+    const uint8_t head = pDev->txHead;
+    const uint8_t next = (head + 1U) & CAN_TX_RING_MASK;
+    if (next == __atomic_load_n(&pDev->txTail, __ATOMIC_ACQUIRE)) {
+        pDev->txRingOverflows++;
+        return false;
+    }
+
+    canTxFrame_t *frame = &pDev->txRing[head];
+    frame->id = identifier;
+    frame->isExtended = isExtended;
+    frame->length = length;
+    if (length) {
+        memcpy(frame->data, data, length);
+    }
+    __atomic_store_n(&pDev->txHead, next, __ATOMIC_RELEASE);
+
+    sitlReactorWake();
+    return true;
+}
+
+bool canTransmitFrames(canDevice_e device, const canFrame_t *frames, uint8_t count)
+{
+    if (device < 0 || device >= CANDEV_COUNT) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+    if (!pDev->initialized || frames == NULL || count == 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (frames[i].length > CAN_CLASSIC_MAX_DLC) {
+            return false;
+        }
+    }
+
+    const uint8_t head = pDev->txHead;
+    const uint8_t used = (head - __atomic_load_n(&pDev->txTail, __ATOMIC_ACQUIRE)) & CAN_TX_RING_MASK;
+    if (count > CAN_TX_RING_MASK - used) {
+        pDev->txRingOverflows++;
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        pDev->txRing[(head + i) & CAN_TX_RING_MASK] = frames[i];
+    }
+    __atomic_store_n(&pDev->txHead, (head + count) & CAN_TX_RING_MASK, __ATOMIC_RELEASE);
+
+    sitlReactorWake();
+    return true;
+}
+
+// Hand the frames the I/O thread received to the rx callbacks
+void sitlCanPoll(void)
+{
+    for (int device = 0; device < CANDEV_COUNT; device++) {
+        canDevice_t *pDev = &canDevice[device];
+        if (!pDev->initialized) {
+            continue;
+        }
+
+        canRxRecord_t record;
+        while (sitlSpscPop(&controllers[device].rxQueue, &record)) {
+            if (pDev->rxCallback) {
+                pDev->rxCallback(record.id, record.flags & SITL_CAN_FLAG_EXTENDED, record.data, record.length);
+            }
+        }
+    }
+}
+
+#endif // ENABLE_CAN
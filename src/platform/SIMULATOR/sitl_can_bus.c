@@ -0,0 +1,209 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "sitl_can_bus.h"
+
+#define CAN_CRC15_POLY      0x4599
+// CRC delimiter, ACK slot, ACK delimiter, 7 bits EOF, 3 bits intermission
+#define CAN_FRAME_TAIL_BITS (1 + 1 + 1 + 7 + 3)
+// SOF to the end of the CRC for an extended frame with 8 bytes
+#define CAN_STUFFED_MAX_BITS (1 + 11 + 2 + 18 + 3 + 4 + 64 + 15)
+
+typedef struct bitWriter_s {
+    uint8_t bits[CAN_STUFFED_MAX_BITS];
+    unsigned count;
+} bitWriter_t;
+
+static void putBits(bitWriter_t *w, uint32_t value, unsigned width)
+{
+    while (width--) {
+        w->bits[w->count++] = (value >> width) & 1;
+    }
+}
+
+static uint16_t crc15(const uint8_t *bits, unsigned count)
+{
+    uint16_t crc = 0;
+    for (unsigned i = 0; i < count; i++) {
+        const bool feedback = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7fff;
+        if (feedback) {
+            crc ^= CAN_CRC15_POLY;
+        }
+    }
+    return crc;
+}
+
+uint16_t sitlCanFrameBits(uint32_t id, bool isExtended, const uint8_t *data, uint8_t length)
+{
+    if (length > SITL_CAN_MAX_DLC) {
+        length = SITL_CAN_MAX_DLC;
+    }
+
+    bitWriter_t w = { .count = 0 };
+    putBits(&w, 0, 1);                          // SOF
+    if (isExtended) {
+        putBits(&w, (id >> 18) & 0x7ff, 11);
+        putBits(&w, 3, 2);                      // SRR, IDE
+        putBits(&w, id & 0x3ffff, 18);
+        putBits(&w, 0, 3);                      // RTR, r1, r0
+    } else {
+        putBits(&w, id & 0x7ff, 11);
+        putBits(&w, 0, 3);                      // RTR, IDE, r0
+    }
+    putBits(&w, length, 4);
+    for (unsigned i = 0; i < length; i++) {
+        putBits(&w, data[i], 8);
+    }
+    putBits(&w, crc15(w.bits, w.count), 15);
+
+    // A bit of the opposite level follows five equal ones, and itself
+    // starts the next run
+    unsigned stuffed = 0;
+    unsigned run = 1;
+    uint8_t level = w.bits[0];
+    for (unsigned i = 1; i < w.count; i++) {
+        if (w.bits[i] == level) {
+            if (++run == 5) {
+                stuffed++;
+                level = !level;
+                run = 1;
+            }
+        } else {
+            level = w.bits[i];
+            run = 1;
+        }
+    }
+
+    return w.count + stuffed + CAN_FRAME_TAIL_BITS;
+}
+
+uint32_t sitlCanArbitrationKey(uint32_t id, bool isExtended)
+{
+    // The arbitration field MSB first: base identifier, then SRR and IDE
+    // (recessive for extended, where a standard frame has dominant RTR and
+    // IDE), then the identifier extension
+    if (isExtended) {
+        return ((id >> 18) & 0x7ff) << 20 | 3u << 18 | (id & 0x3ffff);
+    }
+    return (id & 0x7ff) << 20;
+}
+
+void sitlCanBusInit(sitlCanBus_t *bus, uint32_t bitrate)
+{
+    memset(bus, 0, sizeof(*bus));
+    bus->bitrate = bitrate;
+}
+
+uint64_t sitlCanBusFrameNs(const sitlCanBus_t *bus, uint16_t bits)
+{
+    return (uint64_t)bits * 1000000000u / bus->bitrate;
+}
+
+uint64_t sitlCanBusIdleFrom(const sitlCanBus_t *bus)
+{
+    return bus->pendingCount ? bus->pending[bus->pendingCount - 1].endNs : bus->idleFromNs;
+}
+
+static bool servedBefore(const sitlCanPending_t *a, const sitlCanPending_t *b)
+{
+    if (a->frame.startNs != b->frame.startNs) {
+        return a->frame.startNs < b->frame.startNs;
+    }
+    return a->key < b->key;
+}
+
+static void retime(sitlCanBus_t *bus)
+{
+    uint64_t idleNs = bus->idleFromNs;
+    for (unsigned i = 0; i < bus->pendingCount; i++) {
+        sitlCanPending_t *p = &bus->pending[i];
+        p->startNs = p->frame.startNs > idleNs ? p->frame.startNs : idleNs;
+        p->endNs = p->startNs + sitlCanBusFrameNs(bus, p->frame.bits);
+        idleNs = p->endNs;
+    }
+}
+
+bool sitlCanBusAnnounce(sitlCanBus_t *bus, const sitlCanWireFrame_t *frame, bool own, uint64_t nowNs)
+{
+    if (frame->bitrate != bus->bitrate) {
+        bus->bitrateErrors++;
+        return false;
+    }
+    if (bus->pendingCount == SITL_CAN_PENDING_LENGTH) {
+        bus->overflows++;
+        return false;
+    }
+
+    sitlCanPending_t entry;
+    entry.frame = *frame;
+    entry.key = sitlCanArbitrationKey(frame->id, frame->flags & SITL_CAN_FLAG_EXTENDED);
+    entry.own = own;
+
+    // Frames already on the bus keep it
+    unsigned slot = 0;
+    while (slot < bus->pendingCount && bus->pending[slot].startNs <= nowNs) {
+        slot++;
+    }
+    if (slot > 0 && frame->startNs < bus->pending[slot - 1].frame.startNs) {
+        bus->lateFrames++;
+    }
+    while (slot < bus->pendingCount && servedBefore(&bus->pending[slot], &entry)) {
+        slot++;
+    }
+
+    memmove(&bus->pending[slot + 1], &bus->pending[slot], (bus->pendingCount - slot) * sizeof(entry));
+    bus->pending[slot] = entry;
+    bus->pendingCount++;
+    retime(bus);
+    return true;
+}
+
+uint64_t sitlCanBusDeadline(const sitlCanBus_t *bus)
+{
+    return bus->pendingCount ? bus->pending[0].endNs : UINT64_MAX;
+}
+
+bool sitlCanBusComplete(sitlCanBus_t *bus, uint64_t nowNs, sitlCanPending_t *done)
+{
+    if (!bus->pendingCount || bus->pending[0].endNs > nowNs) {
+        return false;
+    }
+
+    *done = bus->pending[0];
+    bus->pendingCount--;
+    memmove(&bus->pending[0], &bus->pending[1], bus->pendingCount * sizeof(*done));
+
+    bus->idleFromNs = done->endNs;
+    bus->busyNs += done->endNs - done->startNs;
+    bus->frames++;
+    if (done->own) {
+        const uint64_t waitNs = done->startNs - done->frame.startNs;
+        bus->ownFrames++;
+        bus->ownWaitNs += waitNs;
+        if (waitNs > bus->ownWaitMaxNs) {
+            bus->ownWaitMaxNs = waitNs;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Virtual classic CAN bus shared by the SITL and node simulators on one host.
+//
+// Every node multicasts a sitlCanWireFrame_t when it starts a frame, carrying
+// the bus time (CLOCK_MONOTONIC, ns) it starts at and its length in bits with
+// stuffing. Each node keeps the same timeline of announced frames: they are
+// served in order of start time, ties going to the lower arbitration key as
+// on the wire, and a frame waits for the one before it to end. Frames are
+// delivered to the receivers, and count as sent for the transmitter, when
+// they end on that timeline. A node only starts a frame once the bus is
+// idle on its timeline, so contention reduces to nodes that became ready for
+// the same idle point, which arbitration then orders like the real bus.
+//
+// Every frame is acknowledged; there are no error frames.
+
+#define SITL_CAN_MAGIC          0x4e414353u    // "SCAN" little-endian
+#define SITL_CAN_PORT           9007           // + device, + instance offset
+#define SITL_CAN_GROUP          "239.255.67.65"
+
+#define SITL_CAN_FLAG_EXTENDED  (1 << 0)
+
+#define SITL_CAN_MAX_DLC        8
+#define SITL_CAN_PENDING_LENGTH 32      // announced frames not yet ended
+
+// Host byte order, like the other SITL packets
+typedef struct sitlCanWireFrame_s {
+    uint32_t magic;
+    uint32_t sender;            // random per node, drops our own echo
+    uint64_t startNs;           // bus time the frame starts
+    uint32_t bitrate;           // nodes at another bit rate see an error
+    uint32_t id;
+    uint8_t flags;
+    uint8_t length;
+    uint16_t bits;              // on the wire, stuffing and interframe space included
+    uint8_t data[SITL_CAN_MAX_DLC];
+    uint32_t reserved;
+} sitlCanWireFrame_t;
+
+typedef struct sitlCanPending_s {
+    sitlCanWireFrame_t frame;
+    uint64_t startNs;           // when it gets the bus on this timeline
+    uint64_t endNs;
+    uint32_t key;
+    bool own;
+} sitlCanPending_t;
+
+typedef struct sitlCanBus_s {
+    uint32_t bitrate;
+    uint64_t idleFromNs;        // end of the last frame off the timeline
+    sitlCanPending_t pending[SITL_CAN_PENDING_LENGTH];
+    uint8_t pendingCount;
+
+    // Statistics
+    uint64_t busyNs;            // bus time taken by delivered frames
+    uint32_t frames;
+    uint32_t ownFrames;
+    uint64_t ownWaitNs;         // own frames: bus start - announced start
+    uint64_t ownWaitMaxNs;
+    uint32_t lateFrames;        // announced after a later frame had the bus
+    uint32_t bitrateErrors;
+    uint32_t overflows;         // announcements dropped, timeline full
+} sitlCanBus_t;
+
+// Bits a data frame takes on the wire: stuffed SOF to CRC, then the CRC
+// delimiter, ACK, EOF and the interframe space
+uint16_t sitlCanFrameBits(uint32_t id, bool isExtended, const uint8_t *data, uint8_t length);
+// Lower wins arbitration; a standard frame beats an extended one with the
+// same base identifier
+uint32_t sitlCanArbitrationKey(uint32_t id, bool isExtended);
+
+void sitlCanBusInit(sitlCanBus_t *bus, uint32_t bitrate);
+uint64_t sitlCanBusFrameNs(const sitlCanBus_t *bus, uint16_t bits);
+// Earliest a new frame could start: the end of the last announced frame
+uint64_t sitlCanBusIdleFrom(const sitlCanBus_t *bus);
+// Put an announced frame on the timeline; frames already on the bus at nowNs
+// keep it. False if it was dropped.
+bool sitlCanBusAnnounce(sitlCanBus_t *bus, const sitlCanWireFrame_t *frame, bool own, uint64_t nowNs);
+// End of the first frame on the timeline, UINT64_MAX if none
+uint64_t sitlCanBusDeadline(const sitlCanBus_t *bus);
+// Take the first frame off the timeline if it has ended by nowNs
+bool sitlCanBusComplete(sitlCanBus_t *bus, uint64_t nowNs, sitlCanPending_t *done);
@@ -0,0 +1,338 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sitl_physics.h"
+
+#define GRAVITY_MPS2    9.80665
+
+// Motor positions as unit multiples of arm / sqrt(2), FLU body, BF quad-X order
+static const double motorX[SITL_PHYSICS_MOTOR_COUNT] = { -1.0, 1.0, -1.0, 1.0 };
+static const double motorY[SITL_PHYSICS_MOTOR_COUNT] = { -1.0, -1.0, 1.0, 1.0 };
+// A CW prop pushes the frame CCW, which is positive about body z (up)
+static const double motorYawSign[SITL_PHYSICS_MOTOR_COUNT] = { 1.0, -1.0, -1.0, 1.0 };
+
+void sitlPhysicsConfigDefaults(sitlPhysicsConfig_t *config)
+{
+    // A 5 inch freestyle quad, hovering near 36% command
+    *config = (sitlPhysicsConfig_t) {
+        .massKg = 0.6,
+        .inertiaKgM2 = { 0.0025, 0.0025, 0.0045 },
+        .armLengthM = 0.11,
+        .maxThrustN = 7.5,
+        .thrustExpo = 0.7,
+        .torqueCoeffM = 0.016,
+        .motorTauS = 0.03,
+        .dragCoeff = { 0.25, 0.25, 0.4 },
+        .rotDragCoeff = 0.0005,
+        .gyroNoiseRadS = 0.005,
+        .accNoiseMps2 = 0.05,
+        .baroNoiseM = 0.1,
+        .gpsNoiseM = 0.2,
+        .imuLatencyS = 0.002,
+        .gpsLatencyS = 0.1,
+        .originLatDeg = -27.5,
+        .originLonDeg = 153.0,
+        .originAltM = 30.0,
+    };
+}
+
+typedef struct configKey_s {
+    const char *name;
+    size_t offset;
+} configKey_t;
+
+#define CONFIG_KEY(key, field) { key, offsetof(sitlPhysicsConfig_t, field) }
+
+static const configKey_t configKeys[] = {
+    CONFIG_KEY("mass", massKg),
+    CONFIG_KEY("inertia_x", inertiaKgM2[0]),
+    CONFIG_KEY("inertia_y", inertiaKgM2[1]),
+    CONFIG_KEY("inertia_z", inertiaKgM2[2]),
+    CONFIG_KEY("arm_length", armLengthM),
+    CONFIG_KEY("max_thrust", maxThrustN),
+    CONFIG_KEY("thrust_expo", thrustExpo),
+    CONFIG_KEY("torque_coeff", torqueCoeffM),
+    CONFIG_KEY("motor_tau", motorTauS),
+    CONFIG_KEY("drag_x", dragCoeff[0]),
+    CONFIG_KEY("drag_y", dragCoeff[1]),
+    CONFIG_KEY("drag_z", dragCoeff[2]),
+    CONFIG_KEY("rot_drag", rotDragCoeff),
+    CONFIG_KEY("gyro_noise", gyroNoiseRadS),
+    CONFIG_KEY("acc_noise", accNoiseMps2),
+    CONFIG_KEY("baro_noise", baroNoiseM),
+    CONFIG_KEY("gps_noise", gpsNoiseM),
+    CONFIG_KEY("imu_latency", imuLatencyS),
+    CONFIG_KEY("gps_latency", gpsLatencyS),
+    CONFIG_KEY("origin_lat", originLatDeg),
+    CONFIG_KEY("origin_lon", originLonDeg),
+    CONFIG_KEY("origin_alt", originAltM),
+};
+
+bool sitlPhysicsConfigLoad(sitlPhysicsConfig_t *config, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "[SITL] physics config not found: %s\n", path);
+        return false;
+    }
+
+    bool ok = true;
+    char line[128];
+    unsigned lineNumber = 0;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char key[32];
+        double value;
+        char extra;
+        if (sscanf(line, " %31[a-z_] = %lf %c", key, &value, &extra) != 2) {
+            // blank and comment-only lines are fine
+            char probe;
+            if (sscanf(line, " %c", &probe) == 1) {
+                fprintf(stderr, "[SITL] %s:%u: expected key = value\n", path, lineNumber);
+                ok = false;
+            }
+            continue;
+        }
+        ok = false;
+        for (unsigned i = 0; i < sizeof(configKeys) / sizeof(configKeys[0]); i++) {
+            if (strcmp(key, configKeys[i].name) == 0) {
+                *(double *)((char *)config + configKeys[i].offset) = value;
+                ok = true;
+                break;
+            }
+        }
+        if (!ok) {
+            fprintf(stderr, "[SITL] %s:%u: unknown physics key '%s'\n", path, lineNumber, key);
+        }
+    }
+    fclose(fp);
+
+    if (ok && (config->massKg <= 0.0 || config->maxThrustN <= 0.0 || config->motorTauS <= 0.0
+               || config->inertiaKgM2[0] <= 0.0 || config->inertiaKgM2[1] <= 0.0 || config->inertiaKgM2[2] <= 0.0)) {
+        fprintf(stderr, "[SITL] %s: mass, inertia, max_thrust and motor_tau must be positive\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+static void rotateToWorld(const double q[4], const double body[3], double world[3])
+{
+    const double w = q[0], x = q[1], y = q[2], z = q[3];
+    world[0] = (1 - 2 * (y * y + z * z)) * body[0] + 2 * (x * y - w * z) * body[1] + 2 * (x * z + w * y) * body[2];
+    world[1] = 2 * (x * y + w * z) * body[0] + (1 - 2 * (x * x + z * z)) * body[1] + 2 * (y * z - w * x) * body[2];
+    world[2] = 2 * (x * z - w * y) * body[0] + 2 * (y * z + w * x) * body[1] + (1 - 2 * (x * x + y * y)) * body[2];
+}
+
+static void rotateToBody(const double q[4], const double world[3], double body[3])
+{
+    const double conj[4] = { q[0], -q[1], -q[2], -q[3] };
+    rotateToWorld(conj, world, body);
+}
+
+static void setLevel(double q[4])
+{
+    // keep the heading, drop the tilt
+    const double yaw = atan2(2 * (q[0] * q[3] + q[1] * q[2]), 1 - 2 * (q[2] * q[2] + q[3] * q[3]));
+    q[0] = cos(yaw / 2);
+    q[1] = 0.0;
+    q[2] = 0.0;
+    q[3] = sin(yaw / 2);
+}
+
+void sitlPhysicsInit(sitlPhysicsState_t *state, const sitlPhysicsConfig_t *config)
+{
+    (void)config;
+    memset(state, 0, sizeof(*state));
+    state->now.quat[0] = 1.0;
+    state->now.specificForceMps2[2] = GRAVITY_MPS2;
+    state->onGround = true;
+    state->noiseSeed = 0x2545f491;
+    for (unsigned i = 0; i < SITL_PHYSICS_DELAY_SLOTS; i++) {
+        state->history[i] = state->now;
+    }
+}
+
+void sitlPhysicsStep(sitlPhysicsState_t *state, const sitlPhysicsConfig_t *config,
+                     const double motorCommand[SITL_PHYSICS_MOTOR_COUNT], double dtS)
+{
+    if (dtS <= 0.0) {
+        return;
+    }
+    sitlPhysicsSample_t *s = &state->now;
+
+    // Motors: first-order lag on thrust toward the command's steady-state value
+    const double motorAlpha = 1.0 - exp(-dtS / config->motorTauS);
+    double thrustN = 0.0;
+    double torqueNm[3] = { 0.0, 0.0, 0.0 };
+    const double arm = config->armLengthM * M_SQRT1_2;
+    for (unsigned i = 0; i < SITL_PHYSICS_MOTOR_COUNT; i++) {
+        double u = motorCommand[i];
+        u = u < 0.0 ? 0.0 : (u > 1.0 ? 1.0 : u);
+        const double target = config->maxThrustN * (config->thrustExpo * u * u + (1.0 - config->thrustExpo) * u);
+        state->motorThrustN[i] += (target - state->motorThrustN[i]) * motorAlpha;
+        const double f = state->motorThrustN[i];
+        thrustN += f;
+        torqueNm[0] += motorY[i] * arm * f;     // r x F with F along +z
+        torqueNm[1] -= motorX[i] * arm * f;
+        torqueNm[2] += motorYawSign[i] * config->torqueCoeffM * f;
+    }
+
+    // Rotation: Euler's equations with linear rate damping
+    const double *inertia = config->inertiaKgM2;
+    const double *w = s->rateRadS;
+    const double gyroscopic[3] = {
+        (inertia[1] - inertia[2]) * w[1] * w[2],
+        (inertia[2] - inertia[0]) * w[2] * w[0],
+        (inertia[0] - inertia[1]) * w[0] * w[1],
+    };
+    double rate[3];
+    for (int axis = 0; axis < 3; axis++) {
+        const double accel = (torqueNm[axis] + gyroscopic[axis] - config->rotDragCoeff * w[axis]) / inertia[axis];
+        rate[axis] = w[axis] + accel * dtS;
+    }
+
+    // Attitude: integrate q' = q (x) (0, w / 2) at the mid-step rate, renormalise
+    const double wm[3] = { (w[0] + rate[0]) * 0.5, (w[1] + rate[1]) * 0.5, (w[2] + rate[2]) * 0.5 };
+    double *q = s->quat;
+    const double dq[4] = {
+        0.5 * (-q[1] * wm[0] - q[2] * wm[1] - q[3] * wm[2]),
+        0.5 * ( q[0] * wm[0] + q[2] * wm[2] - q[3] * wm[1]),
+        0.5 * ( q[0] * wm[1] - q[1] * wm[2] + q[3] * wm[0]),
+        0.5 * ( q[0] * wm[2] + q[1] * wm[1] - q[2] * wm[0]),
+    };
+    double norm = 0.0;
+    for (int i = 0; i < 4; i++) {
+        q[i] += dq[i] * dtS;
+        norm += q[i] * q[i];
+    }
+    norm = sqrt(norm);
+    for (int i = 0; i < 4; i++) {
+        q[i] /= norm;
+    }
+    memcpy(s->rateRadS, rate, sizeof(rate));
+
+    // Translation: thrust and body drag rotated to the world, plus gravity
+    double velBody[3];
+    rotateToBody(q, s->velNwuMps, velBody);
+    const double forceBody[3] = {
+        -config->dragCoeff[0] * velBody[0],
+        -config->dragCoeff[1] * velBody[1],
+        thrustN - config->dragCoeff[2] * velBody[2],
+    };
+    double forceWorld[3];
+    rotateToWorld(q, forceBody, forceWorld);
+
+    const double velBefore[3] = { s->velNwuMps[0], s->velNwuMps[1], s->velNwuMps[2] };
+    for (int axis = 0; axis < 3; axis++) {
+        double accel = forceWorld[axis] / config->massKg;
+        if (axis == 2) {
+            accel -= GRAVITY_MPS2;
+        }
+        s->velNwuMps[axis] += accel * dtS;
+        s->posNwuM[axis] += s->velNwuMps[axis] * dtS;
+    }
+
+    // Ground: no penetration; sitting there without lift it comes to rest level
+    state->onGround = false;
+    if (s->posNwuM[2] <= 0.0) {
+        s->posNwuM[2] = 0.0;
+        if (s->velNwuMps[2] < 0.0) {
+            s->velNwuMps[2] = 0.0;
+        }
+        state->onGround = true;
+        if (thrustN < config->massKg * GRAVITY_MPS2) {
+            s->velNwuMps[0] = 0.0;
+            s->velNwuMps[1] = 0.0;
+            memset(s->rateRadS, 0, sizeof(s->rateRadS));
+            setLevel(q);
+        }
+    }
+
+    // What the accelerometer feels: the actual change of velocity (ground
+    // contact included, so a touchdown shows as a spike) less gravity
+    double specificWorld[3];
+    for (int axis = 0; axis < 3; axis++) {
+        specificWorld[axis] = (s->velNwuMps[axis] - velBefore[axis]) / dtS;
+    }
+    specificWorld[2] += GRAVITY_MPS2;
+    rotateToBody(q, specificWorld, s->specificForceMps2);
+
+    s->timeS += dtS;
+    if (s->timeS - state->history[state->historyHead].timeS >= SITL_PHYSICS_DELAY_STEP_S - 1e-9) {
+        state->historyHead = (state->historyHead + 1) % SITL_PHYSICS_DELAY_SLOTS;
+        state->history[state->historyHead] = *s;
+    }
+}
+
+double sitlPhysicsNoise(sitlPhysicsState_t *state)
+{
+    // xorshift32 into Box-Muller; one of the pair is discarded for simplicity
+    double u[2];
+    for (int i = 0; i < 2; i++) {
+        uint32_t x = state->noiseSeed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        state->noiseSeed = x;
+        u[i] = (x + 1.0) / 4294967297.0;
+    }
+    return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+void sitlPhysicsSense(sitlPhysicsState_t *state, const sitlPhysicsConfig_t *config,
+                      double latencyS, sitlPhysicsSample_t *sample)
+{
+    if (latencyS <= 0.0) {
+        *sample = state->now;
+    } else {
+        // newest recorded state at least latencyS old
+        const double wantS = state->now.timeS - latencyS;
+        unsigned index = state->historyHead;
+        for (unsigned i = 0; i < SITL_PHYSICS_DELAY_SLOTS - 1; i++) {
+            if (state->history[index].timeS <= wantS + 1e-9) {
+                break;
+            }
+            index = (index + SITL_PHYSICS_DELAY_SLOTS - 1) % SITL_PHYSICS_DELAY_SLOTS;
+        }
+        *sample = state->history[index];
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        sample->rateRadS[axis] += config->gyroNoiseRadS * sitlPhysicsNoise(state);
+        sample->specificForceMps2[axis] += config->accNoiseMps2 * sitlPhysicsNoise(state);
+    }
+}
+
+double sitlPhysicsPressurePa(double altitudeM)
+{
+    return 101325.0 * pow(1.0 - 2.25577e-5 * altitudeM, 5.25588);
+}
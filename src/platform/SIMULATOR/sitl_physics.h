@@ -0,0 +1,105 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// In-process rigid-body quad-X model for headless SITL (--physics).
+//
+// Frames are Betaflight's own: world NWU, body FLU (x forward, y left, z up),
+// so the attitude quaternion, body rates and specific force go to the virtual
+// sensors without any bridge remapping. Motor order and spin follow the BF
+// quad-X mixer: M1 rear-right, M2 front-right, M3 rear-left, M4 front-left;
+// M1/M4 props spin CW seen from above, M2/M3 CCW.
+//
+// The host is double precision; nothing here runs on a flight controller.
+
+#define SITL_PHYSICS_MOTOR_COUNT    4
+#define SITL_PHYSICS_DELAY_SLOTS    128     // sensor latency line...
+#define SITL_PHYSICS_DELAY_STEP_S   0.002   // ...sampled this often, so 256 ms deep
+
+typedef struct sitlPhysicsConfig_s {
+    double massKg;
+    double inertiaKgM2[3];          // principal moments about body x, y, z
+    double armLengthM;              // centre to motor
+    double maxThrustN;              // per motor at full command
+    double thrustExpo;              // thrust = max * (expo * u^2 + (1 - expo) * u)
+    double torqueCoeffM;            // prop reaction torque per newton of thrust
+    double motorTauS;               // first-order motor response
+    double dragCoeff[3];            // linear body drag, N per m/s along x, y, z
+    double rotDragCoeff;            // angular damping, Nm per rad/s
+    double gyroNoiseRadS;           // standard deviations of additive white noise
+    double accNoiseMps2;
+    double baroNoiseM;
+    double gpsNoiseM;
+    double imuLatencyS;             // sensor sample age when delivered
+    double gpsLatencyS;
+    double originLatDeg;            // world origin: where the craft starts
+    double originLonDeg;
+    double originAltM;
+} sitlPhysicsConfig_t;
+
+typedef struct sitlPhysicsSample_s {
+    double timeS;
+    double posNwuM[3];
+    double velNwuMps[3];
+    double quat[4];                 // body to world, w x y z
+    double rateRadS[3];             // body, right-handed about FLU axes
+    double specificForceMps2[3];    // body, what an accelerometer reads
+} sitlPhysicsSample_t;
+
+typedef struct sitlPhysicsState_s {
+    sitlPhysicsSample_t now;
+    double motorThrustN[SITL_PHYSICS_MOTOR_COUNT];
+    bool onGround;
+    sitlPhysicsSample_t history[SITL_PHYSICS_DELAY_SLOTS];
+    unsigned historyHead;
+    uint32_t noiseSeed;
+} sitlPhysicsState_t;
+
+void sitlPhysicsConfigDefaults(sitlPhysicsConfig_t *config);
+
+// key = value lines, '#' comments; keys are the config field names without
+// units (mass, inertia_x, arm_length, max_thrust, ...). Returns false and
+// leaves the rest of the file unread on the first unknown key or bad value.
+bool sitlPhysicsConfigLoad(sitlPhysicsConfig_t *config, const char *path);
+
+// Level and at rest on the ground at the origin, nose north
+void sitlPhysicsInit(sitlPhysicsState_t *state, const sitlPhysicsConfig_t *config);
+
+// Advance by dtS with motor commands in [0, 1]
+void sitlPhysicsStep(sitlPhysicsState_t *state, const sitlPhysicsConfig_t *config,
+                     const double motorCommand[SITL_PHYSICS_MOTOR_COUNT], double dtS);
+
+// Noisy sample of the true state latencyS ago, to the delay line's 2 ms
+// resolution (the current state for zero latency, the oldest kept when the
+// line is shorter than that)
+void sitlPhysicsSense(sitlPhysicsState_t *state, const sitlPhysicsConfig_t *config,
+                      double latencyS, sitlPhysicsSample_t *sample);
+
+// Standard atmosphere pressure at an altitude above sea level, Pa
+double sitlPhysicsPressurePa(double altitudeM);
+
+// Gaussian noise, unit standard deviation, from the state's own generator so
+// runs are repeatable
+double sitlPhysicsNoise(sitlPhysicsState_t *state);
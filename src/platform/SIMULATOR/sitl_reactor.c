@@ -0,0 +1,448 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/select.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif
+
+#include "sitl_reactor.h"
+
+typedef struct reactorEntry_s {
+    int fd;                 // -1 when free
+    uint8_t events;
+    bool retired;           // removed during the current dispatch, not reusable yet
+    sitlReactorHandler_t handler;
+    void *context;
+} reactorEntry_t;
+
+typedef struct reactorTimer_s {
+    uint32_t periodMs;
+    uint64_t dueMs;
+    sitlReactorCallback_t callback;
+    void *context;
+} reactorTimer_t;
+
+typedef struct reactorHook_s {
+    sitlReactorCallback_t hook;
+    void *context;
+} reactorHook_t;
+
+// An eventfd on Linux, a pipe elsewhere
+typedef struct reactorSignal_s {
+    int readFd;
+    int writeFd;
+    uint8_t pending;        // set by the first signal, cleared by the waiter
+} reactorSignal_t;
+
+static reactorEntry_t entries[SITL_REACTOR_MAX_FDS];
+static pthread_mutex_t entriesLock = PTHREAD_MUTEX_INITIALIZER;   // registration only, never dispatch
+
+static reactorTimer_t timers[SITL_REACTOR_MAX_TIMERS];
+static uint32_t timerCount;
+static reactorHook_t wakeHooks[SITL_REACTOR_MAX_WAKE_HOOKS];
+static uint32_t wakeHookCount;
+
+static reactorSignal_t wakeSignal;
+static reactorSignal_t mainSignal;
+
+static pthread_t reactorThread;
+static bool running;
+
+#ifdef __linux__
+static int epollFd = -1;
+#endif
+
+static uint64_t nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool signalInit(reactorSignal_t *sig)
+{
+#ifdef __linux__
+    sig->readFd = sig->writeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sig->readFd < 0) {
+        return false;
+    }
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+    }
+    sig->readFd = fds[0];
+    sig->writeFd = fds[1];
+#endif
+    sig->pending = 0;
+    return true;
+}
+
+// Wake the waiter once however many times this is called before it runs
+static void signalRaise(reactorSignal_t *sig)
+{
+    if (__atomic_exchange_n(&sig->pending, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+#ifdef __linux__
+    const uint64_t one = 1;
+    if (write(sig->writeFd, &one, sizeof(one)) < 0) {
+        // counter saturated; the waiter is already woken
+    }
+#else
+    const uint8_t one = 1;
+    if (write(sig->writeFd, &one, sizeof(one)) < 0) {
+        // pipe full; the waiter is already woken
+    }
+#endif
+}
+
+// Cleared before the work is done, so a signal raised during it wakes again
+static void signalConsume(reactorSignal_t *sig)
+{
+    uint64_t drain;
+    while (read(sig->readFd, &drain, sizeof(drain)) > 0) {
+    }
+    __atomic_store_n(&sig->pending, 0, __ATOMIC_RELEASE);
+}
+
+#ifdef __linux__
+static uint32_t toEpollEvents(uint8_t events)
+{
+    return ((events & SITL_REACTOR_READ) ? EPOLLIN : 0) | ((events & SITL_REACTOR_WRITE) ? EPOLLOUT : 0);
+}
+
+static uint8_t fromEpollEvents(uint32_t events)
+{
+    return ((events & EPOLLIN) ? SITL_REACTOR_READ : 0)
+        | ((events & EPOLLOUT) ? SITL_REACTOR_WRITE : 0)
+        | ((events & (EPOLLHUP | EPOLLERR)) ? SITL_REACTOR_HANGUP : 0);
+}
+#endif
+
+static reactorEntry_t *findEntry(int fd)
+{
+    for (unsigned i = 0; i < SITL_REACTOR_MAX_FDS; i++) {
+        if (entries[i].fd == fd) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool sitlReactorAdd(int fd, uint8_t events, sitlReactorHandler_t handler, void *context)
+{
+    pthread_mutex_lock(&entriesLock);
+
+    reactorEntry_t *entry = NULL;
+    for (unsigned i = 0; i < SITL_REACTOR_MAX_FDS && !entry; i++) {
+        if (entries[i].fd < 0 && !entries[i].retired) {
+            entry = &entries[i];
+        }
+    }
+    if (entry) {
+        entry->events = events;
+        entry->handler = handler;
+        entry->context = context;
+        __atomic_store_n(&entry->fd, fd, __ATOMIC_RELEASE);
+#ifdef __linux__
+        struct epoll_event ev = { .events = toEpollEvents(events), .data.ptr = entry };
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            entry->fd = -1;
+            entry = NULL;
+        }
+#else
+        // the poll set is rebuilt on the next pass
+        signalRaise(&wakeSignal);
+#endif
+    }
+
+    pthread_mutex_unlock(&entriesLock);
+
+    if (!entry) {
+        fprintf(stderr, "[SITL] I/O reactor cannot watch fd %d\n", fd);
+    }
+    return entry != NULL;
+}
+
+bool sitlReactorModify(int fd, uint8_t events)
+{
+    reactorEntry_t *entry = findEntry(fd);
+    if (!entry) {
+        return false;
+    }
+    if (entry->events == events) {
+        return true;
+    }
+    entry->events = events;
+#ifdef __linux__
+    struct epoll_event ev = { .events = toEpollEvents(events), .data.ptr = entry };
+    return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+#else
+    return true;
+#endif
+}
+
+void sitlReactorRemove(int fd)
+{
+    pthread_mutex_lock(&entriesLock);
+    reactorEntry_t *entry = findEntry(fd);
+    if (entry) {
+#ifdef __linux__
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+        entry->fd = -1;
+        entry->retired = true;
+    }
+    pthread_mutex_unlock(&entriesLock);
+}
+
+bool sitlReactorAddTimer(uint32_t periodMs, sitlReactorCallback_t callback, void *context)
+{
+    pthread_mutex_lock(&entriesLock);
+    const uint32_t index = timerCount;
+    if (index < SITL_REACTOR_MAX_TIMERS) {
+        timers[index] = (reactorTimer_t) {
+            .periodMs = periodMs,
+            .dueMs = nowMs() + periodMs,
+            .callback = callback,
+            .context = context,
+        };
+        __atomic_store_n(&timerCount, index + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&entriesLock);
+
+    // so the wait is recomputed with the new deadline
+    signalRaise(&wakeSignal);
+    return index < SITL_REACTOR_MAX_TIMERS;
+}
+
+bool sitlReactorAddWakeHook(sitlReactorCallback_t hook, void *context)
+{
+    pthread_mutex_lock(&entriesLock);
+    const uint32_t index = wakeHookCount;
+    if (index < SITL_REACTOR_MAX_WAKE_HOOKS) {
+        wakeHooks[index] = (reactorHook_t) { .hook = hook, .context = context };
+        __atomic_store_n(&wakeHookCount, index + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&entriesLock);
+    return index < SITL_REACTOR_MAX_WAKE_HOOKS;
+}
+
+void sitlReactorWake(void)
+{
+    signalRaise(&wakeSignal);
+}
+
+void sitlReactorNotifyMain(void)
+{
+    signalRaise(&mainSignal);
+}
+
+bool sitlReactorWaitMain(uint32_t timeoutUs)
+{
+    if (__atomic_load_n(&mainSignal.pending, __ATOMIC_ACQUIRE)) {
+        signalConsume(&mainSignal);
+        return true;
+    }
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(mainSignal.readFd, &fds);
+    struct timeval tv = { .tv_sec = timeoutUs / 1000000, .tv_usec = timeoutUs % 1000000 };
+    if (select(mainSignal.readFd + 1, &fds, NULL, NULL, &tv) > 0) {
+        signalConsume(&mainSignal);
+        return true;
+    }
+    return false;
+}
+
+// Run due timers and return the milliseconds until the next one, -1 for none
+static int runTimers(void)
+{
+    const uint32_t count = __atomic_load_n(&timerCount, __ATOMIC_ACQUIRE);
+    const uint64_t now = nowMs();
+    int timeoutMs = -1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        reactorTimer_t *timer = &timers[i];
+        if (now >= timer->dueMs) {
+            timer->callback(timer->context);
+            timer->dueMs = now + timer->periodMs;
+        }
+        const int untilDue = (int)(timer->dueMs - now);
+        if (timeoutMs < 0 || untilDue < timeoutMs) {
+            timeoutMs = untilDue;
+        }
+    }
+    return timeoutMs;
+}
+
+static void runWakeHooks(void)
+{
+    signalConsume(&wakeSignal);
+
+    const uint32_t count = __atomic_load_n(&wakeHookCount, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+        wakeHooks[i].hook(wakeHooks[i].context);
+    }
+}
+
+static void dispatch(reactorEntry_t *entry, uint8_t events)
+{
+    // removed by an earlier handler of the same pass
+    if (entry->fd < 0) {
+        return;
+    }
+    entry->handler(entry->fd, events, entry->context);
+}
+
+static void endPass(void)
+{
+    for (unsigned i = 0; i < SITL_REACTOR_MAX_FDS; i++) {
+        entries[i].retired = false;
+    }
+}
+
+#ifdef __linux__
+static void *reactorRun(void *data)
+{
+    (void)data;
+    struct epoll_event events[SITL_REACTOR_MAX_FDS];
+
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        const int timeoutMs = runTimers();
+        const int n = epoll_wait(epollFd, events, SITL_REACTOR_MAX_FDS, timeoutMs);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                runWakeHooks();
+            } else {
+                dispatch(events[i].data.ptr, fromEpollEvents(events[i].events));
+            }
+        }
+        pthread_mutex_lock(&entriesLock);
+        endPass();
+        pthread_mutex_unlock(&entriesLock);
+    }
+    return NULL;
+}
+#else
+static void *reactorRun(void *data)
+{
+    (void)data;
+    struct pollfd fds[SITL_REACTOR_MAX_FDS + 1];
+    reactorEntry_t *fdEntries[SITL_REACTOR_MAX_FDS + 1];
+
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        const int timeoutMs = runTimers();
+
+        nfds_t count = 0;
+        fds[count] = (struct pollfd) { .fd = wakeSignal.readFd, .events = POLLIN };
+        fdEntries[count++] = NULL;
+        pthread_mutex_lock(&entriesLock);
+        for (unsigned i = 0; i < SITL_REACTOR_MAX_FDS; i++) {
+            if (entries[i].fd >= 0) {
+                fds[count] = (struct pollfd) {
+                    .fd = entries[i].fd,
+                    .events = ((entries[i].events & SITL_REACTOR_READ) ? POLLIN : 0) | ((entries[i].events & SITL_REACTOR_WRITE) ? POLLOUT : 0),
+                };
+                fdEntries[count++] = &entries[i];
+            }
+        }
+        pthread_mutex_unlock(&entriesLock);
+
+        if (poll(fds, count, timeoutMs) <= 0) {
+            continue;
+        }
+        for (nfds_t i = 0; i < count; i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            if (!fdEntries[i]) {
+                runWakeHooks();
+            } else {
+                dispatch(fdEntries[i], ((fds[i].revents & POLLIN) ? SITL_REACTOR_READ : 0)
+                    | ((fds[i].revents & POLLOUT) ? SITL_REACTOR_WRITE : 0)
+                    | ((fds[i].revents & (POLLHUP | POLLERR)) ? SITL_REACTOR_HANGUP : 0));
+            }
+        }
+        pthread_mutex_lock(&entriesLock);
+        endPass();
+        pthread_mutex_unlock(&entriesLock);
+    }
+    return NULL;
+}
+#endif
+
+bool sitlReactorInit(void)
+{
+    for (unsigned i = 0; i < SITL_REACTOR_MAX_FDS; i++) {
+        entries[i].fd = -1;
+    }
+    if (!signalInit(&wakeSignal) || !signalInit(&mainSignal)) {
+        return false;
+    }
+#ifdef __linux__
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        return false;
+    }
+    // NULL data marks the wake signal
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeSignal.readFd, &ev) != 0) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool sitlReactorStart(void)
+{
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    return pthread_create(&reactorThread, NULL, reactorRun, NULL) == 0;
+}
+
+void sitlReactorStop(void)
+{
+    if (!__atomic_exchange_n(&running, false, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    // the pending latch may hold off the write
+    __atomic_store_n(&wakeSignal.pending, 0, __ATOMIC_RELEASE);
+    signalRaise(&wakeSignal);
+    pthread_join(reactorThread, NULL);
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single I/O thread for the SITL: every socket (TCP serial ports, FDM/RC UDP)
+// and timer is served by one epoll loop (poll() where epoll is missing) that
+// sleeps until something happens. Handlers run on the I/O thread and pass
+// data on through sitl_spsc.h queues; the main loop is woken through
+// sitlReactorNotifyMain() and sleeps in sitlReactorWaitMain().
+
+#define SITL_REACTOR_MAX_FDS        32
+#define SITL_REACTOR_MAX_TIMERS     8
+#define SITL_REACTOR_MAX_WAKE_HOOKS 4
+
+// Interest and readiness flags
+#define SITL_REACTOR_READ       (1 << 0)
+#define SITL_REACTOR_WRITE      (1 << 1)
+#define SITL_REACTOR_HANGUP     (1 << 2)    // reported only
+
+typedef void (*sitlReactorHandler_t)(int fd, uint8_t events, void *context);
+typedef void (*sitlReactorCallback_t)(void *context);
+
+bool sitlReactorInit(void);
+bool sitlReactorStart(void);
+void sitlReactorStop(void);
+
+// Any thread; handlers run on the I/O thread. Remove only from the I/O thread.
+bool sitlReactorAdd(int fd, uint8_t events, sitlReactorHandler_t handler, void *context);
+bool sitlReactorModify(int fd, uint8_t events);
+void sitlReactorRemove(int fd);
+
+// Periodic callback on the I/O thread (millisecond resolution)
+bool sitlReactorAddTimer(uint32_t periodMs, sitlReactorCallback_t callback, void *context);
+
+// Hooks run on the I/O thread after sitlReactorWake(), which any thread may
+// call; wakes that arrive before the hooks run are merged
+bool sitlReactorAddWakeHook(sitlReactorCallback_t hook, void *context);
+void sitlReactorWake(void);
+
+// I/O thread -> main loop
+void sitlReactorNotifyMain(void);
+// Main loop: sleep up to timeoutUs or until notified; true if notified
+bool sitlReactorWaitMain(uint32_t timeoutUs);
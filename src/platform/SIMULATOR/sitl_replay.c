@@ -0,0 +1,490 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Blackbox log replay (--replay): the recorded gyro, acc, attitude, baro, mag,
+// GPS and RC samples are fed through the virtual sensors into the normal
+// gyro, filter, PID, attitude and position estimator tasks, open loop and on
+// a virtual clock that runs as fast as the host allows. The flight code logs
+// the result to a new LOGnnnnn.BFL through the virtual blackbox device, with
+// the original timestamps, for side-by-side comparison with the input.
+//
+// The scheduler is bypassed: a gyro tick runs GYRO, then FILTER and PID when
+// their denominators say so, and the periodic sensor and estimator tasks run
+// when due. RX, failsafe and the arming checks do not run; the replay arms
+// and selects ANGLE/HORIZON directly from the logged box modes.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "blackbox/blackbox.h"
+
+#include "common/maths.h"
+#include "common/time.h"
+
+#include "drivers/accgyro/accgyro_virtual.h"
+#include "drivers/barometer/barometer_virtual.h"
+#include "drivers/compass/compass_virtual.h"
+#include "drivers/time.h"
+
+#include "fc/core.h"
+#include "fc/rc.h"
+#include "fc/rc_controls.h"
+#include "fc/rc_modes.h"
+#include "fc/runtime_config.h"
+#include "fc/tasks.h"
+
+#include "flight/imu.h"
+#include "flight/pid.h"
+
+#include "io/gps_virtual.h"
+
+#include "pg/rx.h"
+
+#include "rx/rx.h"
+
+#include "scheduler/scheduler.h"
+
+#include "sensors/barometer.h"
+#include "sensors/gyro.h"
+
+#include "sitl_blackbox_decode.h"
+#include "sitl_physics.h"
+
+#define REPLAY_SETTLE_US        3000000     // stationary boot for gyro and baro calibration
+#define REPLAY_ARM_LEAD_US      500000      // armed this long before the data so the new log header is out
+#define REPLAY_MAX_GAP_US       100000      // longer gaps (logging paused) are cut to this
+#define REPLAY_SHUTDOWN_US      2000000     // to let the new log close
+#define REPLAY_VIRTUAL_ACC_1G   256
+#define REPLAY_GYRO_SCALE       16.4f       // virtual gyro LSB per deg/s
+
+// One main frame in the virtual sensors' units
+typedef struct replaySample_s {
+    uint64_t timeUs;
+    float gyro[XYZ_AXIS_COUNT];
+    float acc[XYZ_AXIS_COUNT];
+    float quat[4];
+    float baroAltCm;
+    float mag[XYZ_AXIS_COUNT];
+    float rcCommand[4];
+} replaySample_t;
+
+typedef struct replayFields_s {
+    int time;
+    int gyro[XYZ_AXIS_COUNT];
+    int acc[XYZ_AXIS_COUNT];
+    int quat[XYZ_AXIS_COUNT];
+    int baroAlt;
+    int mag[XYZ_AXIS_COUNT];
+    int rcCommand[4];
+    int slowFlightModeFlags;
+    int gpsCoord[2];
+    int gpsAltitude;
+    int gpsSpeed;
+    int gpsCourse;
+    int gpsVelned[3];
+} replayFields_t;
+
+static blackboxDecoder_t decoder;
+static replayFields_t fields;
+
+static const taskId_e replayPeriodicTasks[] = {
+    TASK_ACCEL,
+    TASK_ATTITUDE,
+#ifdef USE_BARO
+    TASK_BARO,
+#endif
+#ifdef USE_MAG
+    TASK_COMPASS,
+#endif
+#ifdef USE_GPS
+    TASK_GPS,
+#endif
+#if defined(USE_BARO) || defined(USE_GPS)
+    TASK_ALTITUDE,
+#endif
+};
+static timeUs_t replayTaskDueUs[ARRAYLEN(replayPeriodicTasks)];
+
+static void lookupIndexedFields(const blackboxDecodeFieldDefs_t *defs, int *out, int count, const char *name)
+{
+    for (int i = 0; i < count; i++) {
+        char fieldName[32];
+        snprintf(fieldName, sizeof(fieldName), "%s[%d]", name, i);
+        out[i] = blackboxDecodeFieldIndex(defs, fieldName);
+    }
+}
+
+static void lookupFields(void)
+{
+    const blackboxDecodeFieldDefs_t *main = &decoder.iDefs;
+
+    fields.time = blackboxDecodeFieldIndex(main, "time");
+    // The unfiltered gyro is what the filters saw; older logs only carry the filtered one
+    lookupIndexedFields(main, fields.gyro, XYZ_AXIS_COUNT, "gyroUnfilt");
+    if (fields.gyro[0] < 0) {
+        lookupIndexedFields(main, fields.gyro, XYZ_AXIS_COUNT, "gyroADC");
+    }
+    lookupIndexedFields(main, fields.acc, XYZ_AXIS_COUNT, "accSmooth");
+    lookupIndexedFields(main, fields.quat, XYZ_AXIS_COUNT, "imuQuaternion");
+    fields.baroAlt = blackboxDecodeFieldIndex(main, "baroAlt");
+    lookupIndexedFields(main, fields.mag, XYZ_AXIS_COUNT, "magADC");
+    lookupIndexedFields(main, fields.rcCommand, 4, "rcCommand");
+
+    fields.slowFlightModeFlags = blackboxDecodeFieldIndex(&decoder.sDefs, "flightModeFlags");
+
+    lookupIndexedFields(&decoder.gDefs, fields.gpsCoord, 2, "GPS_coord");
+    fields.gpsAltitude = blackboxDecodeFieldIndex(&decoder.gDefs, "GPS_altitude");
+    fields.gpsSpeed = blackboxDecodeFieldIndex(&decoder.gDefs, "GPS_speed");
+    fields.gpsCourse = blackboxDecodeFieldIndex(&decoder.gDefs, "GPS_ground_course");
+    lookupIndexedFields(&decoder.gDefs, fields.gpsVelned, 3, "GPS_velned");
+}
+
+static float fieldOr(const int32_t *frame, int index, float missing)
+{
+    return index >= 0 ? frame[index] : missing;
+}
+
+static void sampleFromMainFrame(replaySample_t *sample, uint64_t timeUs)
+{
+    const int32_t *frame = decoder.main[0];
+    const float highResolutionScale = decoder.highResolution ? 0.1f : 1.0f;
+    const float accScale = decoder.acc1G > 0 ? (float)REPLAY_VIRTUAL_ACC_1G / decoder.acc1G : 1.0f;
+
+    sample->timeUs = timeUs;
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        sample->gyro[i] = fieldOr(frame, fields.gyro[i], 0) * highResolutionScale * REPLAY_GYRO_SCALE;
+        sample->acc[i] = fieldOr(frame, fields.acc[i], i == Z ? decoder.acc1G : 0) * accScale;
+        sample->mag[i] = fieldOr(frame, fields.mag[i], 0);
+    }
+
+    // x, y, z scaled to int16 with the sign chosen so w is positive
+    float sumSq = 0.0f;
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        sample->quat[i + 1] = fieldOr(frame, fields.quat[i], 0) / (float)0x7FFF;
+        sumSq += sq(sample->quat[i + 1]);
+    }
+    sample->quat[0] = sqrtf(MAX(0.0f, 1.0f - sumSq));
+
+    sample->baroAltCm = fieldOr(frame, fields.baroAlt, 0);
+
+    for (int i = 0; i < 3; i++) {
+        sample->rcCommand[i] = fieldOr(frame, fields.rcCommand[i], 0) * highResolutionScale;
+    }
+    sample->rcCommand[THROTTLE] = fieldOr(frame, fields.rcCommand[THROTTLE], 1000);
+}
+
+static void feedSensors(const replaySample_t *a, const replaySample_t *b, float f, bool gyroStill)
+{
+    float v[XYZ_AXIS_COUNT];
+
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        v[i] = gyroStill ? 0.0f : a->gyro[i] + (b->gyro[i] - a->gyro[i]) * f;
+    }
+    virtualGyroSet(virtualGyroDev, constrain(lrintf(v[X]), -32767, 32767),
+                   constrain(lrintf(v[Y]), -32767, 32767), constrain(lrintf(v[Z]), -32767, 32767));
+
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        v[i] = a->acc[i] + (b->acc[i] - a->acc[i]) * f;
+    }
+    virtualAccSet(virtualAccDev, constrain(lrintf(v[X]), -32767, 32767),
+                  constrain(lrintf(v[Y]), -32767, 32767), constrain(lrintf(v[Z]), -32767, 32767));
+
+    if (fields.quat[0] >= 0) {
+        float q[4];
+        float norm = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            q[i] = a->quat[i] + (b->quat[i] - a->quat[i]) * f;
+            norm += sq(q[i]);
+        }
+        norm = sqrtf(norm);
+        imuSetAttitudeQuat(q[0] / norm, q[1] / norm, q[2] / norm, q[3] / norm);
+    }
+
+#ifdef USE_BARO
+    // baroAlt is relative to the ground the logging FC calibrated on; so is the replay's
+    const float baroAltCm = a->baroAltCm + (b->baroAltCm - a->baroAltCm) * f;
+    virtualBaroSet((int32_t)sitlPhysicsPressurePa(baroAltCm * 0.01f), 2500);
+#endif
+
+#ifdef USE_VIRTUAL_MAG
+    if (fields.mag[0] >= 0) {
+        virtualMagSet(lrintf(b->mag[X]), lrintf(b->mag[Y]), lrintf(b->mag[Z]));
+    }
+#endif
+}
+
+// The logged rcCommand is post deadband, expo and throttle curve, so it is
+// written over what updateRcCommands() makes of the approximate stick positions
+static void applyRcCommand(const replaySample_t *sample)
+{
+    rcData[ROLL] = rxConfig()->midrc + sample->rcCommand[ROLL];
+    rcData[PITCH] = rxConfig()->midrc + sample->rcCommand[PITCH];
+    rcData[YAW] = rxConfig()->midrc - sample->rcCommand[YAW];
+    rcData[THROTTLE] = rxConfig()->mincheck
+        + (sample->rcCommand[THROTTLE] - PWM_RANGE_MIN) * (PWM_RANGE_MAX - rxConfig()->mincheck) / (PWM_RANGE_MAX - PWM_RANGE_MIN);
+
+    updateRcCommands();
+    for (int i = 0; i < 4; i++) {
+        rcCommand[i] = sample->rcCommand[i];
+    }
+}
+
+static void applyBoxModes(uint32_t flags)
+{
+    boxBitmask_t modes;
+    memset(&modes, 0, sizeof(modes));
+    modes.bits[0] = flags;
+    rcModeUpdate(&modes);
+
+    if (IS_RC_MODE_ACTIVE(BOXANGLE)) {
+        ENABLE_FLIGHT_MODE(ANGLE_MODE);
+    } else {
+        DISABLE_FLIGHT_MODE(ANGLE_MODE);
+    }
+    if (IS_RC_MODE_ACTIVE(BOXHORIZON) && !IS_RC_MODE_ACTIVE(BOXANGLE)) {
+        ENABLE_FLIGHT_MODE(HORIZON_MODE);
+    } else {
+        DISABLE_FLIGHT_MODE(HORIZON_MODE);
+    }
+}
+
+static void applyGpsFrame(void)
+{
+#ifdef USE_VIRTUAL_GPS
+    if (fields.gpsCoord[0] < 0 || fields.gpsCoord[1] < 0) {
+        return;
+    }
+    const int32_t *frame = decoder.gps;
+    const double velN = (double)fieldOr(frame, fields.gpsVelned[0], 0) * 0.01;
+    const double velE = (double)fieldOr(frame, fields.gpsVelned[1], 0) * 0.01;
+    const double velD = (double)fieldOr(frame, fields.gpsVelned[2], 0) * 0.01;
+
+    setVirtualGPS(frame[fields.gpsCoord[0]] / (double)GPS_DEGREES_DIVIDER,
+                  frame[fields.gpsCoord[1]] / (double)GPS_DEGREES_DIVIDER,
+                  (double)fieldOr(frame, fields.gpsAltitude, 0) * 0.1,      // decimetres
+                  (double)fieldOr(frame, fields.gpsSpeed, 0) * 0.01,
+                  sqrt(sq(velN) + sq(velE) + sq(velD)),
+                  (double)fieldOr(frame, fields.gpsCourse, 0) * 0.1,        // decidegrees
+                  velN, velE, velD);
+#endif
+}
+
+// One gyro sample's worth of the flight code at virtual time nowUs
+static void runTick(uint64_t nowUs)
+{
+    const timeUs_t currentTimeUs = (timeUs_t)nowUs;
+
+    sitlReplayClockSet(nowUs);
+
+    schedulerExecuteTask(getTask(TASK_GYRO), currentTimeUs);
+    if (gyroFilterReady()) {
+        schedulerExecuteTask(getTask(TASK_FILTER), currentTimeUs);
+    }
+    if (pidLoopReady()) {
+        schedulerExecuteTask(getTask(TASK_PID), currentTimeUs);
+    }
+
+    for (unsigned i = 0; i < ARRAYLEN(replayPeriodicTasks); i++) {
+        taskInfo_t info;
+        getTaskInfo(replayPeriodicTasks[i], &info);
+        if (!info.isEnabled || cmpTimeUs(currentTimeUs, replayTaskDueUs[i]) < 0) {
+            continue;
+        }
+        task_t *task = getTask(replayPeriodicTasks[i]);
+        schedulerExecuteTask(task, currentTimeUs);
+        // Tasks may have rescheduled themselves
+        replayTaskDueUs[i] = currentTimeUs + task->attribute->desiredPeriodUs;
+    }
+}
+
+static bool loadFile(const char *path, uint8_t **data, size_t *length)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    *data = size > 0 ? malloc(size) : NULL;
+    *length = *data ? fread(*data, 1, size, fp) : 0;
+    fclose(fp);
+
+    if (*length != (size_t)size || size <= 0) {
+        free(*data);
+        *data = NULL;
+        return false;
+    }
+    return true;
+}
+
+int targetReplayBlackbox(const char *path)
+{
+    uint8_t *data;
+    size_t length;
+
+    if (!loadFile(path, &data, &length)) {
+        fprintf(stderr, "[SITL] Cannot read %s\n", path);
+        return 1;
+    }
+    if (!blackboxDecodeInit(&decoder, data, length)) {
+        fprintf(stderr, "[SITL] %s: no blackbox log header\n", path);
+        free(data);
+        return 1;
+    }
+    lookupFields();
+    if (fields.time < 0 || fields.gyro[0] < 0) {
+        fprintf(stderr, "[SITL] %s: the log has no time or gyro fields\n", path);
+        free(data);
+        return 1;
+    }
+    if (fields.quat[0] < 0) {
+        printf("[SITL] %s has no attitude, the replay flies level\n", path);
+    }
+
+    const timeDelta_t gyroPeriodUs = getTask(TASK_GYRO)->attribute->desiredPeriodUs;
+    if (decoder.looptimeUs && decoder.looptimeUs != gyroPeriodUs) {
+        printf("[SITL] The log's gyro ran every %dus, this replay every %dus; samples are interpolated\n",
+               decoder.looptimeUs, gyroPeriodUs);
+    }
+
+    // Side frames ahead of the first main frame seed the sensors
+    char type;
+    while ((type = blackboxDecodeNextFrame(&decoder)) && type != 'I') {
+        if (type == 'G') {
+            applyGpsFrame();
+        }
+    }
+    if (!type) {
+        fprintf(stderr, "[SITL] %s: no frames\n", path);
+        free(data);
+        return 1;
+    }
+
+    // Keep the log's own timestamps when it started late enough after boot
+    uint32_t lastLogTimeUs = decoder.main[0][fields.time];
+    const uint64_t bootUs = micros64() + REPLAY_SETTLE_US;
+    uint64_t offsetUs = lastLogTimeUs >= bootUs ? 0 : bootUs - lastLogTimeUs;
+
+    replaySample_t previous, current;
+    sampleFromMainFrame(&current, lastLogTimeUs + offsetUs);
+    const uint64_t firstSampleUs = current.timeUs;
+
+    blackboxConfigMutable()->device = BLACKBOX_DEVICE_VIRTUAL;
+    blackboxInit();
+
+    const uint64_t wallStartUs = micros64_real();
+    uint64_t nowUs = current.timeUs - REPLAY_SETTLE_US;
+    for (unsigned i = 0; i < ARRAYLEN(replayPeriodicTasks); i++) {
+        replayTaskDueUs[i] = (timeUs_t)nowUs;
+    }
+
+    // Stationary boot: zero rates so calibration finds no bias, then arm on the first sample
+    applyRcCommand(&current);
+    for (; nowUs < current.timeUs; nowUs += gyroPeriodUs) {
+        if (nowUs >= current.timeUs - REPLAY_ARM_LEAD_US && !ARMING_FLAG(ARMED)) {
+            if (!gyroIsCalibrationComplete()) {
+                printf("[SITL] Gyro calibration did not finish before the replay\n");
+            }
+            ENABLE_ARMING_FLAG(ARMED);
+            // processRxModes() is not run; the controller is evaluated at any throttle
+            pidSetItermReset(false);
+            pidStabilisationState(PID_STABILISATION_ON);
+#ifdef USE_RUNAWAY_TAKEOFF
+            // nor is the takeoff detection that would end the runaway check
+            runawayTakeoffTemporaryDisable(true);
+#endif
+        }
+        feedSensors(&current, &current, 0.0f, !ARMING_FLAG(ARMED));
+        runTick(nowUs);
+    }
+
+    unsigned mainFrames = 1;
+    bool disarmed = false;
+    while (!disarmed && (type = blackboxDecodeNextFrame(&decoder))) {
+        switch (type) {
+        case 'I':
+        case 'P': {
+            const uint32_t logTimeUs = decoder.main[0][fields.time];
+            uint32_t deltaUs = logTimeUs - lastLogTimeUs;
+            lastLogTimeUs = logTimeUs;
+            if (deltaUs > REPLAY_MAX_GAP_US) {
+                offsetUs -= deltaUs - REPLAY_MAX_GAP_US;
+                deltaUs = REPLAY_MAX_GAP_US;
+            }
+
+            previous = current;
+            sampleFromMainFrame(&current, previous.timeUs + deltaUs);
+            mainFrames++;
+
+            // RC steps with the frame it was logged in
+            applyRcCommand(&previous);
+            for (; nowUs <= current.timeUs; nowUs += gyroPeriodUs) {
+                const float f = deltaUs ? (float)(nowUs - previous.timeUs) / deltaUs : 1.0f;
+                feedSensors(&previous, &current, constrainf(f, 0.0f, 1.0f), false);
+                runTick(nowUs);
+            }
+            break;
+        }
+        case 'G':
+            applyGpsFrame();
+            break;
+        case 'S':
+            if (fields.slowFlightModeFlags >= 0) {
+                applyBoxModes(decoder.slow[fields.slowFlightModeFlags]);
+            }
+            break;
+        case 'E':
+            if (decoder.event == FLIGHT_LOG_EVENT_FLIGHTMODE) {
+                applyBoxModes(decoder.eventValue[0]);
+            } else if (decoder.event == FLIGHT_LOG_EVENT_DISARM) {
+                disarmed = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Disarm and hold the last sample while the new log closes
+    DISABLE_ARMING_FLAG(ARMED);
+    blackboxFinish();
+    const uint64_t shutdownUs = nowUs + REPLAY_SHUTDOWN_US;
+    for (; !blackboxMayEditConfig() && nowUs < shutdownUs; nowUs += gyroPeriodUs) {
+        feedSensors(&current, &current, 0.0f, false);
+        runTick(nowUs);
+    }
+
+    const double wallS = (micros64_real() - wallStartUs) * 1e-6;
+    printf("[SITL] Replayed %u frames, %.1fs of flight in %.1fs%s, %u lost sync\n",
+           mainFrames, (current.timeUs - firstSampleUs) * 1e-6, wallS,
+           blackboxMayEditConfig() ? "" : " (new log not closed)", decoder.corruptFrames);
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,240 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "sitl_shm.h"
+
+// Sleep-poll period where there is no futex
+#define SITL_SHM_POLL_US    20
+// Records usually follow within a few microseconds in lock-step; spinning
+// that long saves the wake-up and the sleep syscalls. Only worth it when the
+// other side runs on another CPU meanwhile.
+#define SITL_SHM_SPIN_US    10
+
+static void ringReset(sitlShmRing_t *ring, uint32_t recordSize)
+{
+    ring->head = 0;
+    ring->dropped = 0;
+    ring->tail = 0;
+    ring->sleeping = 0;
+    ring->recordSize = recordSize;
+}
+
+sitlShmRegion_t *sitlShmCreate(const char *name, uint32_t downRecordSize, uint32_t upRecordSize)
+{
+    if (downRecordSize > SITL_SHM_RECORD_SIZE || upRecordSize > SITL_SHM_RECORD_SIZE) {
+        fprintf(stderr, "[SHM] record larger than %d bytes\n", SITL_SHM_RECORD_SIZE);
+        return NULL;
+    }
+
+    const int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "[SHM] shm_open %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(sitlShmRegion_t)) != 0) {
+        fprintf(stderr, "[SHM] ftruncate %s: %s\n", name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, sizeof(sitlShmRegion_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[SHM] mmap %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+
+    sitlShmRegion_t *region = (sitlShmRegion_t *)map;
+    // a simulator still attached from a previous run sees the magic drop
+    // while the rings are reset
+    __atomic_store_n(&region->magic, 0, __ATOMIC_RELEASE);
+    ringReset(&region->down, downRecordSize);
+    ringReset(&region->up, upRecordSize);
+    region->version = SITL_SHM_VERSION;
+    __atomic_store_n(&region->magic, SITL_SHM_MAGIC, __ATOMIC_RELEASE);
+    return region;
+}
+
+sitlShmRegion_t *sitlShmAttach(const char *name)
+{
+    const int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(sitlShmRegion_t)) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, sizeof(sitlShmRegion_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    sitlShmRegion_t *region = (sitlShmRegion_t *)map;
+    if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != SITL_SHM_MAGIC || region->version != SITL_SHM_VERSION) {
+        munmap(map, sizeof(sitlShmRegion_t));
+        return NULL;
+    }
+    return region;
+}
+
+void sitlShmDetach(sitlShmRegion_t *region)
+{
+    if (region) {
+        munmap(region, sizeof(sitlShmRegion_t));
+    }
+}
+
+void sitlShmUnlink(const char *name)
+{
+    shm_unlink(name);
+}
+
+// The futex is shared between processes, so never FUTEX_PRIVATE_FLAG
+
+static void wakeConsumer(sitlShmRing_t *ring)
+{
+#ifdef __linux__
+    syscall(SYS_futex, &ring->head, FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+    (void)ring;
+#endif
+}
+
+static void sleepWhileHeadIs(sitlShmRing_t *ring, uint32_t head, uint32_t timeoutUs)
+{
+#ifdef __linux__
+    const struct timespec timeout = { .tv_sec = timeoutUs / 1000000, .tv_nsec = (timeoutUs % 1000000) * 1000L };
+    // returns at once with EAGAIN if the head has already moved
+    syscall(SYS_futex, &ring->head, FUTEX_WAIT, head, &timeout, NULL, 0);
+#else
+    (void)ring;
+    (void)head;
+    const uint32_t us = timeoutUs < SITL_SHM_POLL_US ? timeoutUs : SITL_SHM_POLL_US;
+    const struct timespec ts = { .tv_sec = 0, .tv_nsec = us * 1000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static uint64_t monotonicUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Spin-wait hint: lets a sibling hyperthread run and saves power while spinning
+static inline void cpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ volatile("yield");
+#endif
+}
+
+bool sitlShmPush(sitlShmRing_t *ring, const void *record)
+{
+    const uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= SITL_SHM_RING_LENGTH) {
+        ring->dropped++;
+        return false;
+    }
+    memcpy(ring->records[head & (SITL_SHM_RING_LENGTH - 1)], record, ring->recordSize);
+    // the time the consumer measures arrival from, not when it got round to it
+    ring->pushedUs[head & (SITL_SHM_RING_LENGTH - 1)] = monotonicUs();
+
+    // Sequentially consistent against the consumer announcing its sleep in
+    // sitlShmWait(): either it sees the new head or we see it sleeping
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->sleeping, __ATOMIC_SEQ_CST)) {
+        wakeConsumer(ring);
+    }
+    return true;
+}
+
+bool sitlShmPop(sitlShmRing_t *ring, void *record, uint64_t *pushedUs)
+{
+    const uint32_t tail = ring->tail;
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+        return false;
+    }
+    memcpy(record, ring->records[tail & (SITL_SHM_RING_LENGTH - 1)], ring->recordSize);
+    if (pushedUs) {
+        *pushedUs = ring->pushedUs[tail & (SITL_SHM_RING_LENGTH - 1)];
+    }
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static uint32_t spinUs(void)
+{
+    static int cpus = 0;
+    if (cpus == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return cpus > 1 ? SITL_SHM_SPIN_US : 0;
+}
+
+bool sitlShmWait(sitlShmRing_t *ring, uint32_t timeoutUs)
+{
+    const uint32_t tail = ring->tail;
+    const uint64_t start = monotonicUs();
+    const uint64_t deadline = start + timeoutUs;
+    const uint64_t spinUntil = start + (timeoutUs < spinUs() ? timeoutUs : spinUs());
+
+    for (;;) {
+        if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != tail) {
+            return true;
+        }
+        const uint64_t now = monotonicUs();
+        if (now >= deadline) {
+            return false;
+        }
+        if (now < spinUntil) {
+            cpuRelax();
+            continue;
+        }
+
+        __atomic_store_n(&ring->sleeping, 1, __ATOMIC_SEQ_CST);
+        const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST);
+        if (head == tail) {
+            sleepWhileHeadIs(ring, head, deadline - now);
+        }
+        __atomic_store_n(&ring->sleeping, 0, __ATOMIC_RELAXED);
+    }
+}
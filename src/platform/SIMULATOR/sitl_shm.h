@@ -0,0 +1,82 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared-memory link between the SITL and a simulator on the same host
+// (--shm <name>), replacing the FDM and motor UDP ports.
+//
+// The SITL creates a POSIX shared memory object holding two single-producer
+// single-consumer rings: down carries fdm_packet from the simulator, up
+// carries servo_packet back. The packets and their pacing are those of the
+// UDP link, one servo_packet per fdm_packet. A record is copied once into
+// the ring and once out; nothing enters the kernel unless the consumer is
+// asleep, in which case the producer wakes it with a futex on the ring's
+// head (a short sleep-poll where futexes are missing).
+//
+// A simulator bridge includes this header, builds sitl_shm.c and calls
+// sitlShmAttach() with the same name after the SITL has started.
+
+#define SITL_SHM_MAGIC          0x4d485342u    // "BSHM" little-endian
+#define SITL_SHM_VERSION        2
+#define SITL_SHM_RING_LENGTH    16          // records, power of two
+#define SITL_SHM_RECORD_SIZE    256         // bytes, upper bound on a record
+#define SITL_SHM_CACHE_LINE     64
+
+typedef struct sitlShmRing_s {
+    // Producer side: head is also the futex word a sleeping consumer waits on
+    uint32_t head __attribute__((aligned(SITL_SHM_CACHE_LINE)));
+    uint32_t dropped;           // records refused because the ring was full
+    // Consumer side
+    uint32_t tail __attribute__((aligned(SITL_SHM_CACHE_LINE)));
+    uint32_t sleeping;          // consumer is blocked in sitlShmWait()
+    uint32_t recordSize __attribute__((aligned(SITL_SHM_CACHE_LINE)));
+    uint64_t pushedUs[SITL_SHM_RING_LENGTH];    // CLOCK_MONOTONIC when each record was pushed
+    uint8_t records[SITL_SHM_RING_LENGTH][SITL_SHM_RECORD_SIZE];
+} sitlShmRing_t;
+
+typedef struct sitlShmRegion_s {
+    uint32_t magic;
+    uint32_t version;
+    sitlShmRing_t down;         // simulator -> SITL
+    sitlShmRing_t up;           // SITL -> simulator
+} sitlShmRegion_t;
+
+// SITL side: create (or take over) the named object and reset both rings
+sitlShmRegion_t *sitlShmCreate(const char *name, uint32_t downRecordSize, uint32_t upRecordSize);
+// Simulator side: map an object created by sitlShmCreate()
+sitlShmRegion_t *sitlShmAttach(const char *name);
+void sitlShmDetach(sitlShmRegion_t *region);
+// Remove the name; existing mappings stay valid
+void sitlShmUnlink(const char *name);
+
+// Producer: copy a record in and wake the consumer if it sleeps; false if full
+bool sitlShmPush(sitlShmRing_t *ring, const void *record);
+// Consumer: copy the oldest record out, and the CLOCK_MONOTONIC microsecond
+// it was pushed at unless pushedUs is NULL; false if empty
+bool sitlShmPop(sitlShmRing_t *ring, void *record, uint64_t *pushedUs);
+// Consumer: block until the ring has a record or timeoutUs passes; true if
+// it has one
+bool sitlShmWait(sitlShmRing_t *ring, uint32_t timeoutUs);
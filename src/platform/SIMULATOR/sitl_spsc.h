@@ -0,0 +1,120 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Lock-free single-producer single-consumer ring of fixed-size records, the
+// hand-off between the SITL I/O thread and the main loop.
+//
+// head is only written by the producer and tail only by the consumer; each
+// publishes with a release store that the other side reads with an acquire
+// load, so a record is complete before its slot is seen. The indices run
+// freely and are masked on access, so capacity must be a power of two.
+// Records are contiguous in storage, which lets byte queues be filled by
+// recv() and drained by send() in place through the span calls.
+
+#define SITL_SPSC_CACHE_LINE 64
+
+typedef struct sitlSpsc_s {
+    uint8_t *storage;
+    uint32_t recordSize;
+    uint32_t mask;
+    // Kept on their own cache lines: the two threads write one each
+    uint32_t head __attribute__((aligned(SITL_SPSC_CACHE_LINE)));
+    uint32_t dropped;       // pushes refused because the queue was full
+    uint32_t tail __attribute__((aligned(SITL_SPSC_CACHE_LINE)));
+} sitlSpsc_t;
+
+static inline void sitlSpscInit(sitlSpsc_t *q, void *storage, uint32_t recordSize, uint32_t capacity)
+{
+    q->storage = (uint8_t *)storage;
+    q->recordSize = recordSize;
+    q->mask = capacity - 1;
+    q->head = 0;
+    q->tail = 0;
+    q->dropped = 0;
+}
+
+static inline uint32_t sitlSpscCount(const sitlSpsc_t *q)
+{
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
+
+// Producer: contiguous free records from the head, up to the end of storage
+static inline uint32_t sitlSpscWritable(sitlSpsc_t *q, void **span)
+{
+    const uint32_t head = q->head;
+    const uint32_t space = q->mask + 1 - (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE));
+    const uint32_t toEnd = q->mask + 1 - (head & q->mask);
+
+    *span = q->storage + (head & q->mask) * q->recordSize;
+    return space < toEnd ? space : toEnd;
+}
+
+// Producer: publish count records written into the span
+static inline void sitlSpscCommit(sitlSpsc_t *q, uint32_t count)
+{
+    __atomic_store_n(&q->head, q->head + count, __ATOMIC_RELEASE);
+}
+
+// Consumer: contiguous queued records from the tail, up to the end of storage
+static inline uint32_t sitlSpscReadable(sitlSpsc_t *q, void **span)
+{
+    const uint32_t tail = q->tail;
+    const uint32_t count = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - tail;
+    const uint32_t toEnd = q->mask + 1 - (tail & q->mask);
+
+    *span = q->storage + (tail & q->mask) * q->recordSize;
+    return count < toEnd ? count : toEnd;
+}
+
+// Consumer: hand count records back to the producer
+static inline void sitlSpscRelease(sitlSpsc_t *q, uint32_t count)
+{
+    __atomic_store_n(&q->tail, q->tail + count, __ATOMIC_RELEASE);
+}
+
+static inline bool sitlSpscPush(sitlSpsc_t *q, const void *record)
+{
+    void *slot;
+    if (!sitlSpscWritable(q, &slot)) {
+        q->dropped++;
+        return false;
+    }
+    memcpy(slot, record, q->recordSize);
+    sitlSpscCommit(q, 1);
+    return true;
+}
+
+static inline bool sitlSpscPop(sitlSpsc_t *q, void *record)
+{
+    void *slot;
+    if (!sitlSpscReadable(q, &slot)) {
+        return false;
+    }
+    memcpy(record, slot, q->recordSize);
+    sitlSpscRelease(q, 1);
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Framing between a swarm of SITL instances (--instance N) and one world
+// process simulating all of them (--world <group>).
+//
+// Down: the world multicasts one datagram per step to every vehicle, a
+// sitlWorldStateHeader_t followed by count records for the instances
+// firstInstance .. firstInstance + count - 1; each vehicle picks its own.
+// Up: each vehicle sends its motor packet to the world behind a
+// sitlWorldMotorHeader_t naming the sender.
+//
+// Records are opaque here (fdm_packet and servo_packet in practice), in host
+// byte order like the single-vehicle UDP protocol.
+
+#define SITL_WORLD_MAGIC        0x57464253u    // "SBFW" little-endian
+#define SITL_WORLD_STATE_PORT   9005    // In, multicast
+#define SITL_WORLD_MOTOR_PORT   9006    // Out, to the world host
+
+typedef struct sitlWorldStateHeader_s {
+    uint32_t magic;
+    uint16_t firstInstance;
+    uint16_t count;
+} sitlWorldStateHeader_t;
+
+typedef struct sitlWorldMotorHeader_s {
+    uint32_t magic;
+    uint16_t instance;
+    uint16_t reserved;
+} sitlWorldMotorHeader_t;
+
+// This instance's record in a state datagram, or NULL if it is malformed or
+// does not carry one
+static inline const void *sitlWorldStateRecord(const void *datagram, size_t length, uint16_t instance, size_t recordSize)
+{
+    sitlWorldStateHeader_t header;
+    if (length < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, datagram, sizeof(header));
+    if (header.magic != SITL_WORLD_MAGIC || length != sizeof(header) + (size_t)header.count * recordSize) {
+        return NULL;
+    }
+    if (instance < header.firstInstance || instance - header.firstInstance >= header.count) {
+        return NULL;
+    }
+    return (const uint8_t *)datagram + sizeof(header) + (size_t)(instance - header.firstInstance) * recordSize;
+}
+
+// Frame a motor record for the world into datagram; returns the length to send
+static inline size_t sitlWorldMotorFrame(void *datagram, uint16_t instance, const void *record, size_t recordSize)
+{
+    sitlWorldMotorHeader_t header;
+    header.magic = SITL_WORLD_MAGIC;
+    header.instance = instance;
+    header.reserved = 0;
+    memcpy(datagram, &header, sizeof(header));
+    memcpy((uint8_t *)datagram + sizeof(header), record, recordSize);
+    return sizeof(header) + recordSize;
+}
@@ -110,6 +110,10 @@
 
 #define ENABLE_RX_UDP           1
 
+// CAN devices on a virtual bus shared with node simulators on this host
+// (sitl_can.c); DroneCAN is linked when the libcanard submodule is present
+#define ENABLE_CAN              1
+
 // DEFAULT_RX_FEATURE is picked by config/feature.h: FEATURE_RX_UDP when
 // ENABLE_RX_UDP=1 (bare SITL / Gazebo), else FEATURE_RX_MSP. Configs that want
 // MSP RX as the default (e.g. SITL_X_PLANE) override DEFAULT_RX_FEATURE.
@@ -131,6 +135,7 @@
 
 #define USE_BLACKBOX
 #define USE_BLACKBOX_VIRTUAL
+#define USE_BLACKBOX_REPLAY
 
 #undef USE_STACK_CHECK // I think SITL don't need this
 #undef USE_DASHBOARD
@@ -264,8 +269,23 @@ uint64_t micros64(void);
 uint64_t millis64(void);
 
 int lockMainPID(void);
+void sitlMainLoopIdle(uint32_t timeoutUs);
 
 int targetParseArgs(int argc, char * argv[]);
+
+// Multi-vehicle SITL: --instance N moves every UDP and TCP port up by
+// N * SITL_INSTANCE_PORT_STRIDE and prefixes the files it writes
+#define SITL_INSTANCE_MAX           99
+#define SITL_INSTANCE_PORT_STRIDE   10
+int sitlInstancePortOffset(void);
+const char *sitlInstanceFilePrefix(void);   // "" for instance 0
+// Main loop: hand frames received on the virtual CAN bus to the rx callbacks
+void sitlCanPoll(void);
 #ifdef CONFIG_IN_FILE
 const char *targetGetConfigFile(void);
 #endif
+#ifdef USE_BLACKBOX_REPLAY
+const char *targetGetReplayFile(void);
+int targetReplayBlackbox(const char *path);
+void sitlReplayClockSet(uint64_t timeUs);
+#endif
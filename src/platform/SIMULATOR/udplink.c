@@ -44,6 +44,22 @@ int udpInit(udpLink_t* link, const char* addr, int port, bool isServer)
     return 0;
 }
 
+int udpInitMulticast(udpLink_t* link, const char* group, int port)
+{
+    int ret = udpInit(link, NULL, port, true);
+    if (ret != 0) {
+        return ret;
+    }
+
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = inet_addr(group);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(link->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1) {
+        return -3;
+    }
+    return 0;
+}
+
 int udpSend(udpLink_t* link, const void* data, size_t size)
 {
     return sendto(link->fd, data, size, 0, (struct sockaddr *)&link->si, sizeof(link->si));
@@ -54,6 +70,12 @@ int udpRecv(udpLink_t* link, void* data, size_t size, uint32_t timeout_ms)
     fd_set fds;
     struct timeval tv;
 
+    // the socket is non-blocking: nothing to wait for
+    if (timeout_ms == 0) {
+        socklen_t len = sizeof(link->si);
+        return recvfrom(link->fd, data, size, 0, (struct sockaddr *)&link->si, &len);
+    }
+
     FD_ZERO(&fds);
     FD_SET(link->fd, &fds);
 
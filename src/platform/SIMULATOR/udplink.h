@@ -29,6 +29,9 @@ typedef struct {
 } udpLink_t;
 
 int udpInit(udpLink_t* link, const char* addr, int port, bool isServer);
+// Server on port receiving the multicast group as well; SO_REUSEADDR lets
+// every instance on the host bind it
+int udpInitMulticast(udpLink_t* link, const char* group, int port);
 int udpRecv(udpLink_t* link, void* data, size_t size, uint32_t timeout_ms);
 int udpSend(udpLink_t* link, const void* data, size_t size);
 
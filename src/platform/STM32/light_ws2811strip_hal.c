@@ -239,7 +239,7 @@ bool ws2811LedStripHardwareInit(void)
     return true;
 }
 
-void ws2811LedStripStartTransfer(void)
+bool ws2811LedStripStartTransfer(void)
 {
 #ifdef USE_LED_STRIP_CACHE_MGMT
     SCB_CleanDCache_by_Addr(ledStripDMABuffer, WS2811_DMA_BUF_CACHE_ALIGN_BYTES);
@@ -261,7 +261,7 @@ void ws2811LedStripStartTransfer(void)
     if (DMA_SetCurrDataCounter(&TimHandle, timerChannel, ledStripDMABuffer, ws2811DmaLength) != HAL_OK) {
         /* DMA set error */
         ws2811LedDataTransferInProgress = false;
-        return;
+        return false;
     }
     /* Reset timer counter */
     __HAL_TIM_SET_COUNTER(&TimHandle,0);
@@ -272,5 +272,6 @@ void ws2811LedStripStartTransfer(void)
 #else
     TIM_DMACmd(&TimHandle,timerChannel,ENABLE);
 #endif
+    return true;
 }
 #endif
@@ -167,7 +167,7 @@ bool ws2811LedStripHardwareInit(void)
     return true;
 }
 
-void ws2811LedStripStartTransfer(void)
+bool ws2811LedStripStartTransfer(void)
 {
     DMA_Channel_TypeDef *dmaCh = (DMA_Channel_TypeDef *)ws2811DmaRef;
 
@@ -186,5 +186,6 @@ void ws2811LedStripStartTransfer(void)
 
     /* Enable timer DMA request for this channel */
     SET_BIT(ws2811Timer->DIER, ws2811DmaSource);
+    return true;
 }
 #endif
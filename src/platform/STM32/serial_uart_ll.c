@@ -156,6 +156,11 @@ void uartReconfigure(uartPort_t *uartPort)
             LL_USART_EnableDMAReq_RX(USARTx);
 
             uartPort->rxDMAPos = xLL_EX_DMA_GetDataLength(uartPort->rxDMAResource);
+
+            // Idle line hands received frames to ISR-side consumers, see uartRxDmaIdle()
+            if (uartPort->port.rxCallback) {
+                SET_BIT(USARTx->CR1, USART_CR1_IDLEIE);
+            }
         } else
 #endif
         {
@@ -379,6 +384,11 @@ FAST_IRQ_HANDLER void uartIrqHandler(uartPort_t *s)
 
     // UART reception idle detected
     if (LL_USART_IsEnabledIT_IDLE(USARTx) && LL_USART_IsActiveFlag_IDLE(USARTx)) {
+#ifdef USE_DMA
+        if (s->rxDMAResource) {
+            uartRxDmaIdle(s);
+        }
+#endif
         if (s->port.idleCallback) {
             s->port.idleCallback();
         }
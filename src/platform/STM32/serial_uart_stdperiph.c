@@ -121,6 +121,11 @@ void uartReconfigure(uartPort_t *uartPort)
             xDMA_Cmd(uartPort->rxDMAResource, ENABLE);
             USART_DMACmd(USARTx, USART_DMAReq_Rx, ENABLE);
             uartPort->rxDMAPos = xDMA_GetCurrDataCounter(uartPort->rxDMAResource);
+
+            // Idle line hands received frames to ISR-side consumers, see uartRxDmaIdle()
+            if (uartPort->port.rxCallback) {
+                USART_ITConfig(USARTx, USART_IT_IDLE, ENABLE);
+            }
         } else
 #endif
         {
@@ -332,6 +332,11 @@ void uartIrqHandler(uartPort_t *s)
     }
 
     if (USART_GetITStatus(USARTx, USART_IT_IDLE) == SET) {
+#ifdef USE_DMA
+        if (s->rxDMAResource) {
+            uartRxDmaIdle(s);
+        }
+#endif
         if (s->port.idleCallback) {
             s->port.idleCallback();
         }
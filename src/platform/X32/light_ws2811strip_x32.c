@@ -209,7 +209,7 @@ bool ws2811LedStripHardwareInit(void)
     return true;
 }
 
-void ws2811LedStripStartTransfer(void)
+bool ws2811LedStripStartTransfer(void)
 {
     ws2811CleanDmaBuffer();
 
@@ -222,6 +222,7 @@ void ws2811LedStripStartTransfer(void)
     TIM_EnableDma(timer, timerDmaRequest, ENABLE);
     __DSB();
     xDMA_Cmd(dmaRef, ENABLE);
+    return true;
 }
 
 #endif
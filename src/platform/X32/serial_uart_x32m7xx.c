@@ -431,7 +431,7 @@ void uartTxMonitor(uartPort_t *s)
 #ifdef USE_DMA
 static void uartProcessRxDMA(uartPort_t *s)
 {
-    if (!s->rxDMAResource || !s->port.rxCallback) {
+    if (!s->rxDMAResource || (!s->port.rxCallback && !s->port.rxFrameCallback)) {
         return;
     }
 
@@ -457,6 +457,16 @@ static void uartProcessRxDMA(uartPort_t *s)
         rxDMAHead %= rxBufferSize;
     }
 
+    if (s->port.rxFrameCallback) {
+        // Contiguous runs up to the DMA head, split in two at the end of the ring
+        while (s->rxDMAPos != rxDMAHead) {
+            const uint32_t end = (rxDMAHead > s->rxDMAPos) ? rxDMAHead : rxBufferSize;
+            s->port.rxFrameCallback((const uint8_t *)&s->port.rxBuffer[s->rxDMAPos], end - s->rxDMAPos, s->port.rxCallbackData);
+            s->rxDMAPos = (end >= rxBufferSize) ? 0 : end;
+        }
+        return;
+    }
+
     while (s->rxDMAPos != rxDMAHead) {
         const uint8_t byte = s->port.rxBuffer[s->rxDMAPos];
 
@@ -124,16 +124,25 @@
 // Per-instance RAM reservation in WORDS (1 word = 4 bytes):
 //  - 3 Rx FIFO 0 slots × 4 words = 12 words
 //  - 3 Tx FIFO slots  × 4 words = 12 words
-//  Round to a fixed 64-word (256-byte) slice per instance to leave head-room
-//  for future additions (extra FIFOs, filters). Total usage with 3 instances
-//  is 192 words / 768 bytes out of the 10 KiB of shared Message RAM.
+//  - 16 extended filters × 2 words = 32 words
+//  - 8 standard filters × 1 word = 8 words
+//  That fills a fixed 64-word (256-byte) slice per instance. Total usage with
+//  3 instances is 192 words / 768 bytes out of the 10 KiB of shared Message
+//  RAM.
 #define CAN_H7_RF0_NBR              (3U)
 #define CAN_H7_TFQ_NBR              (3U)
+#define CAN_H7_FLE_NBR              (16U)
+#define CAN_H7_FLS_NBR              (8U)
 #define CAN_H7_ELEMENT_WORDS        (4U)        // 2 hdr + 8-byte data
 #define CAN_H7_PER_INSTANCE_WORDS   (64U)
 #define CAN_H7_RF0_WORD_OFFSET      (0U)
 #define CAN_H7_TFQ_WORD_OFFSET      (CAN_H7_RF0_WORD_OFFSET + \
                                      CAN_H7_RF0_NBR * CAN_H7_ELEMENT_WORDS)
+#define CAN_H7_FLE_WORD_OFFSET      (CAN_H7_TFQ_WORD_OFFSET + \
+                                     CAN_H7_TFQ_NBR * CAN_H7_ELEMENT_WORDS)
+#define CAN_H7_FLS_WORD_OFFSET      (CAN_H7_FLE_WORD_OFFSET + CAN_H7_FLE_NBR * 2U)
+
+STATIC_ASSERT(CAN_H7_FLS_WORD_OFFSET + CAN_H7_FLS_NBR <= CAN_H7_PER_INSTANCE_WORDS, can_h7_slice_overflow);
 
 // Element-size code 0b000 = 8-byte data field (classic CAN).
 #define CAN_H7_ESC_CODE_8B          (0U)
@@ -173,6 +182,30 @@ static uint32_t canRxElementAddress(canDevice_e device, uint32_t index)
 #endif
 }
 
+static uint32_t canStdFilterAddress(canDevice_e device, uint32_t index)
+{
+#if defined(STM32G4) || defined(STM32C5)
+    return canMessageRamBase(device) + CAN_SRAM_FLSSA + index * CAN_SRAM_FLS_SIZE;
+#elif defined(STM32H7)
+    return canMessageRamBase(device) + (CAN_H7_FLS_WORD_OFFSET + index) * 4U;
+#else
+    UNUSED(device); UNUSED(index);
+    return 0;
+#endif
+}
+
+static uint32_t canExtFilterAddress(canDevice_e device, uint32_t index)
+{
+#if defined(STM32G4) || defined(STM32C5)
+    return canMessageRamBase(device) + CAN_SRAM_FLESA + index * CAN_SRAM_FLE_SIZE;
+#elif defined(STM32H7)
+    return canMessageRamBase(device) + (CAN_H7_FLE_WORD_OFFSET + index * 2U) * 4U;
+#else
+    UNUSED(device); UNUSED(index);
+    return 0;
+#endif
+}
+
 static uint32_t canTxElementAddress(canDevice_e device, uint32_t index)
 {
 #if defined(STM32G4) || defined(STM32C5)
@@ -334,6 +367,28 @@ static bool canNominalBitTiming(uint32_t bitrate, uint32_t *nbtp)
 #define CAN_RX_WORD1_DLC_POS    (16U)
 #define CAN_RX_WORD1_DLC_MASK   (0xFUL << CAN_RX_WORD1_DLC_POS)
 
+//-----------------------------------------------------------------------------
+// Filter elements (identical across G4 and H7 M_CAN IP)
+//
+// All filters are classic (match when the identifier ANDed with the mask
+// equals the filter ANDed with the mask) and store into Rx FIFO 0.
+//  Standard, 1 word: SFT = bits 30..31, SFEC = bits 27..29, SFID1 (filter)
+//  = bits 16..26, SFID2 (mask) = bits 0..10.
+//  Extended, 2 words: F0 EFEC = bits 29..31, EFID1 (filter) = bits 0..28;
+//  F1 EFT = bits 30..31, EFID2 (mask) = bits 0..28.
+// Frames matching no filter are rejected once a list is installed (ANFS /
+// ANFE = 10b); with no list the controller accepts everything.
+//-----------------------------------------------------------------------------
+
+#define CAN_FILTER_SFT_CLASSIC  (2UL << 30)
+#define CAN_FILTER_SFEC_FIFO0   (1UL << 27)
+#define CAN_FILTER_SFID1_POS    (16U)
+#define CAN_FILTER_STDID_MASK   (0x7FFUL)
+#define CAN_FILTER_EFEC_FIFO0   (1UL << 29)
+#define CAN_FILTER_EFT_CLASSIC  (2UL << 30)
+#define CAN_FILTER_EXTID_MASK   (0x1FFFFFFFUL)
+#define CAN_FILTER_ANF_REJECT   (2UL)
+
 //-----------------------------------------------------------------------------
 // Low-level helpers (register level)
 //-----------------------------------------------------------------------------
@@ -423,9 +478,9 @@ static void canEnableInterrupt(canDevice_e device, uint8_t irq)
 #if defined(STM32H7)
 // Program the H7 Message RAM layout for this instance. Addresses in the
 // SIDFC/XIDFC/RXF0C/TXBC registers are word offsets from SRAMCAN_BASE, not
-// absolute byte addresses. We only activate Rx FIFO 0 and the Tx FIFO; the
-// other regions (standard/extended filters, Rx FIFO 1, Rx buffers, Tx event
-// FIFO) are left zero-sized.
+// absolute byte addresses. We only activate the filter lists, Rx FIFO 0 and
+// the Tx FIFO; the other regions (Rx FIFO 1, Rx buffers, Tx event FIFO) are
+// left zero-sized.
 static void canConfigureMessageRamH7(canDevice_e device, FDCAN_GlobalTypeDef *regs)
 {
     const uint32_t instanceWords = (uint32_t)device * CAN_H7_PER_INSTANCE_WORDS;
@@ -433,10 +488,9 @@ static void canConfigureMessageRamH7(canDevice_e device, FDCAN_GlobalTypeDef *re
     const uint32_t rf0SA = instanceWords + CAN_H7_RF0_WORD_OFFSET;
     const uint32_t tfqSA = instanceWords + CAN_H7_TFQ_WORD_OFFSET;
 
-    // No standard / extended filter lists installed — point at the region
-    // start with size 0 so the peripheral never walks them.
-    regs->SIDFC = (instanceWords << FDCAN_SIDFC_FLSSA_Pos) & FDCAN_SIDFC_FLSSA_Msk;
-    regs->XIDFC = (instanceWords << FDCAN_XIDFC_FLESA_Pos) & FDCAN_XIDFC_FLESA_Msk;
+    // Filter lists start empty; canProgramFilters() sets their sizes.
+    regs->SIDFC = ((instanceWords + CAN_H7_FLS_WORD_OFFSET) << FDCAN_SIDFC_FLSSA_Pos) & FDCAN_SIDFC_FLSSA_Msk;
+    regs->XIDFC = ((instanceWords + CAN_H7_FLE_WORD_OFFSET) << FDCAN_XIDFC_FLESA_Pos) & FDCAN_XIDFC_FLESA_Msk;
 
     // Rx FIFO 0: 3 classic-CAN elements.
     regs->RXF0C = ((rf0SA << FDCAN_RXF0C_F0SA_Pos) & FDCAN_RXF0C_F0SA_Msk)
@@ -457,6 +511,45 @@ static void canConfigureMessageRamH7(canDevice_e device, FDCAN_GlobalTypeDef *re
 }
 #endif // STM32H7
 
+// Write the device's filter list into Message RAM and switch the global
+// filter to match it. Requires INIT + CCE.
+static void canProgramFilters(canDevice_e device, FDCAN_GlobalTypeDef *regs)
+{
+    const canDevice_t *pDev = &canDevice[device];
+    uint32_t stdCount = 0;
+    uint32_t extCount = 0;
+
+    for (uint8_t i = 0; i < pDev->filterCount; i++) {
+        const canFilter_t *filter = &pDev->filters[i];
+        if (filter->isExtended) {
+            volatile uint32_t *element = (volatile uint32_t *)canExtFilterAddress(device, extCount++);
+            element[0] = CAN_FILTER_EFEC_FIFO0 | (filter->id & CAN_FILTER_EXTID_MASK);
+            element[1] = CAN_FILTER_EFT_CLASSIC | (filter->mask & CAN_FILTER_EXTID_MASK);
+        } else {
+            volatile uint32_t *element = (volatile uint32_t *)canStdFilterAddress(device, stdCount++);
+            *element = CAN_FILTER_SFT_CLASSIC | CAN_FILTER_SFEC_FIFO0
+                     | ((filter->id & CAN_FILTER_STDID_MASK) << CAN_FILTER_SFID1_POS)
+                     | (filter->mask & CAN_FILTER_STDID_MASK);
+        }
+    }
+
+    const uint32_t nonMatching = pDev->filterCount ? CAN_FILTER_ANF_REJECT : 0U;
+
+#if defined(STM32G4) || defined(STM32C5)
+    regs->RXGFC = (regs->RXGFC & ~(FDCAN_RXGFC_LSS | FDCAN_RXGFC_LSE | FDCAN_RXGFC_ANFS | FDCAN_RXGFC_ANFE))
+                | ((stdCount << FDCAN_RXGFC_LSS_Pos) & FDCAN_RXGFC_LSS)
+                | ((extCount << FDCAN_RXGFC_LSE_Pos) & FDCAN_RXGFC_LSE)
+                | (nonMatching << FDCAN_RXGFC_ANFS_Pos)
+                | (nonMatching << FDCAN_RXGFC_ANFE_Pos);
+#elif defined(STM32H7)
+    regs->SIDFC = (regs->SIDFC & ~FDCAN_SIDFC_LSS) | ((stdCount << FDCAN_SIDFC_LSS_Pos) & FDCAN_SIDFC_LSS_Msk);
+    regs->XIDFC = (regs->XIDFC & ~FDCAN_XIDFC_LSE) | ((extCount << FDCAN_XIDFC_LSE_Pos) & FDCAN_XIDFC_LSE_Msk);
+    regs->GFC = (regs->GFC & ~(FDCAN_GFC_ANFS | FDCAN_GFC_ANFE))
+              | (nonMatching << FDCAN_GFC_ANFS_Pos)
+              | (nonMatching << FDCAN_GFC_ANFE_Pos);
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // Init / public API
 //-----------------------------------------------------------------------------
@@ -523,17 +616,17 @@ void canInitDevice(canDevice_e device, uint32_t bitrate)
     // Wipe the per-instance message RAM region to remove any prior contents.
     canClearMessageRam(device);
 
-#if defined(STM32G4) || defined(STM32C5)
-    // Accept-non-matching policy: route everything to Rx FIFO 0 (fields 00b
-    // in ANFS / ANFE). The Message RAM layout itself is fixed by silicon.
-    regs->RXGFC &= ~(FDCAN_RXGFC_ANFS | FDCAN_RXGFC_ANFE);
-#elif defined(STM32H7)
-    // H7 uses a separate GFC register and requires explicit Message RAM
-    // configuration via SIDFC/XIDFC/RXF0C/TXBC/RXESC/TXESC.
-    regs->GFC &= ~(FDCAN_GFC_ANFS | FDCAN_GFC_ANFE);
+#if defined(STM32H7)
+    // H7 requires explicit Message RAM configuration via
+    // SIDFC/XIDFC/RXF0C/TXBC/RXESC/TXESC. On G4/C5 the layout is fixed by
+    // silicon.
     canConfigureMessageRamH7(device, regs);
 #endif
 
+    // Install any filters set before init; with none, everything is routed
+    // to Rx FIFO 0.
+    canProgramFilters(device, regs);
+
     // Reset the software TX ring so a re-init starts from a clean queue.
     pDev->txHead = 0;
     pDev->txTail = 0;
@@ -578,6 +671,49 @@ bool canInit(canDevice_e device, uint32_t bitrate)
     return canDevice[device].initialized;
 }
 
+uint8_t canFilterCapacity(canDevice_e device, bool isExtended)
+{
+    UNUSED(device);
+#if defined(STM32G4) || defined(STM32C5)
+    return isExtended ? CAN_SRAM_FLE_NBR : CAN_SRAM_FLS_NBR;
+#elif defined(STM32H7)
+    return isExtended ? CAN_H7_FLE_NBR : CAN_H7_FLS_NBR;
+#else
+    UNUSED(isExtended);
+    return 0;
+#endif
+}
+
+bool canSetFilters(canDevice_e device, const canFilter_t *filters, uint8_t count)
+{
+    if (device < 0 || device >= CANDEV_COUNT || count > CAN_FILTER_LIST_MAX) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+
+    memcpy(pDev->filters, filters, count * sizeof(*filters));
+    count = canFilterReduce(pDev->filters, count, false, canFilterCapacity(device, false));
+    pDev->filterCount = canFilterReduce(pDev->filters, count, true, canFilterCapacity(device, true));
+
+    if (!pDev->initialized) {
+        // canInitDevice() programs them
+        return true;
+    }
+
+    // List sizes and the global filter only change under INIT + CCE, which
+    // also resets the Tx FIFO; the ISR must not touch the FIFOs meanwhile.
+    FDCAN_GlobalTypeDef *regs = canRegs(device);
+    NVIC_DisableIRQ((IRQn_Type)pDev->irq0);
+    if (canEnterConfigMode(regs)) {
+        canProgramFilters(device, regs);
+        pDev->initialized = canExitConfigMode(regs);
+    }
+    NVIC_EnableIRQ((IRQn_Type)pDev->irq0);
+
+    return true;
+}
+
 void canRegisterRxCallback(canDevice_e device, canRxCallbackPtr callback)
 {
     if (device < 0 || device >= CANDEV_COUNT) {
@@ -652,6 +788,60 @@ static void canTxKick(canDevice_e device)
     }
 }
 
+// The software ring cannot take what the caller asked for: count the
+// rejection and, if the bus has stopped acknowledging, recover.
+//
+// A saturated ring with zero completions means nothing is ACKing (peers
+// unpowered, bus fault): auto-retransmission keeps the pending hardware slots
+// busy forever and TC never fires. The FDCAN has no per-frame one-shot mode
+// and disabling retransmission globally would drop frames on ordinary
+// arbitration loss, so recover by cancelling the pending slots and discarding
+// the stale backlog. A live bus completes a classic frame in well under a
+// millisecond, so this never fires from congestion alone.
+static void canTxBackpressure(canDevice_e device)
+{
+    canDevice_t *pDev = &canDevice[device];
+
+    const timeUs_t now = micros();
+    if (pDev->txCompletions != pDev->txCompletionsSeen) {
+        pDev->txCompletionsSeen = pDev->txCompletions;
+        pDev->txStallSinceUs = now;
+    } else if (cmpTimeUs(now, pDev->txStallSinceUs) >= CAN_TX_STALL_TIMEOUT_US) {
+        FDCAN_GlobalTypeDef *regs = canRegs(device);
+        NVIC_DisableIRQ((IRQn_Type)pDev->irq0);
+        regs->TXBCR = (1UL << CAN_TX_FIFO_DEPTH) - 1UL;
+        pDev->txTail = pDev->txHead;
+        pDev->txStallRecoveries++;
+        pDev->txStallSinceUs = now;
+        NVIC_EnableIRQ((IRQn_Type)pDev->irq0);
+    }
+    pDev->txRingOverflows++;
+}
+
+// Publish ring slots filled up to newHead and push as much as the hardware
+// FIFO will take now.
+static void canTxCommit(canDevice_e device, uint8_t newHead)
+{
+    canDevice_t *pDev = &canDevice[device];
+
+    // Publish the filled slots before advancing head so the TC ISR (which
+    // consumes via txTail) never observes an advanced head over a partially
+    // written slot. Cortex-M is strongly ordered in hardware but the compiler
+    // may reorder these non-volatile stores around the volatile head write.
+    __asm volatile ("" ::: "memory");
+    pDev->txHead = newHead;
+
+    // Mask this device's IRQ so the TC handler (the other canTxKick caller)
+    // cannot run concurrently and corrupt the FIFO put sequence. This also
+    // briefly masks RX on the same line, but the critical section is only a
+    // few SRAM writes long. Safe to unconditionally re-enable: irq0 is always
+    // enabled once initialized is set, and the transmit entry points are
+    // task-context only (never called from an ISR).
+    NVIC_DisableIRQ((IRQn_Type)pDev->irq0);
+    canTxKick(device);
+    NVIC_EnableIRQ((IRQn_Type)pDev->irq0);
+}
+
 // Queue a classic CAN frame for transmission. The frame is appended to the
 // software TX ring and pushed into the hardware FIFO immediately if room is
 // available; anything that doesn't fit is drained by the TC interrupt.
@@ -686,29 +876,7 @@ bool canTransmit(canDevice_e device, uint32_t identifier, bool isExtended,
     if (next == pDev->txTail) {
         // Ring full — genuine backpressure. Drop and report so the caller can
         // retry; libcanard leaves the frame at its queue head on a false.
-        //
-        // A saturated ring with zero completions means nothing is ACKing
-        // (peers unpowered, bus fault): auto-retransmission keeps the pending
-        // hardware slots busy forever and TC never fires. The FDCAN has no
-        // per-frame one-shot mode and disabling retransmission globally would
-        // drop frames on ordinary arbitration loss, so recover by cancelling
-        // the pending slots and discarding the stale backlog. A live bus
-        // completes a classic frame in well under a millisecond, so this
-        // never fires from congestion alone.
-        const timeUs_t now = micros();
-        if (pDev->txCompletions != pDev->txCompletionsSeen) {
-            pDev->txCompletionsSeen = pDev->txCompletions;
-            pDev->txStallSinceUs = now;
-        } else if (cmpTimeUs(now, pDev->txStallSinceUs) >= CAN_TX_STALL_TIMEOUT_US) {
-            FDCAN_GlobalTypeDef *regs = canRegs(device);
-            NVIC_DisableIRQ((IRQn_Type)pDev->irq0);
-            regs->TXBCR = (1UL << CAN_TX_FIFO_DEPTH) - 1UL;
-            pDev->txTail = head;
-            pDev->txStallRecoveries++;
-            pDev->txStallSinceUs = now;
-            NVIC_EnableIRQ((IRQn_Type)pDev->irq0);
-        }
-        pDev->txRingOverflows++;
+        canTxBackpressure(device);
         return false;
     }
 
@@ -720,22 +888,43 @@ bool canTransmit(canDevice_e device, uint32_t identifier, bool isExtended,
         frame->data[i] = data[i];
     }
 
-    // Publish the filled slot before advancing head so the TC ISR (which
-    // consumes via txTail) never observes an advanced head over a partially
-    // written slot. Cortex-M is strongly ordered in hardware but the compiler
-    // may reorder these non-volatile stores around the volatile head write.
-    __asm volatile ("" ::: "memory");
-    pDev->txHead = next;
-
-    // Push as much as the hardware FIFO will take now. Mask this device's IRQ
-    // so the TC handler (the other canTxKick caller) cannot run concurrently
-    // and corrupt the FIFO put sequence. This also briefly masks RX on the same
-    // line, but the critical section is only a few SRAM writes long. Safe to
-    // unconditionally re-enable: irq0 is always enabled once initialized is set,
-    // and canTransmit is task-context only (never called from an ISR).
-    NVIC_DisableIRQ((IRQn_Type)pDev->irq0);
-    canTxKick(device);
-    NVIC_EnableIRQ((IRQn_Type)pDev->irq0);
+    canTxCommit(device, next);
+
+    return true;
+}
+
+// Same contract as canTransmit(), for a run of frames that must go out
+// whole: the free space is checked once for the run and head advances once,
+// so the TC ISR never starts draining a half-copied transfer.
+bool canTransmitFrames(canDevice_e device, const canFrame_t *frames, uint8_t count)
+{
+    if (device < 0 || device >= CANDEV_COUNT) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+    if (!pDev->initialized || frames == NULL || count == 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (frames[i].length > CAN_CLASSIC_MAX_DLC) {
+            return false;
+        }
+    }
+
+    // One slot always stays empty to tell a full ring from an empty one
+    const uint8_t head = pDev->txHead;
+    const uint8_t used = (head - pDev->txTail) & CAN_TX_RING_MASK;
+    if (count > CAN_TX_RING_MASK - used) {
+        canTxBackpressure(device);
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        pDev->txRing[(head + i) & CAN_TX_RING_MASK] = frames[i];
+    }
+
+    canTxCommit(device, (head + count) & CAN_TX_RING_MASK);
 
     return true;
 }
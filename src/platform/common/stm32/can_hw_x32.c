@@ -49,12 +49,19 @@
 
 #define CAN_X32_RF0_NBR             (3U)
 #define CAN_X32_TFQ_NBR             (3U)
+#define CAN_X32_FLE_NBR             (16U)
+#define CAN_X32_FLS_NBR             (8U)
 #define CAN_X32_ELEMENT_WORDS       (4U)
 #define CAN_X32_PER_INSTANCE_WORDS  (64U)
 #define CAN_X32_PER_BANK_INSTANCES  (4U)
 #define CAN_X32_RF0_WORD_OFFSET     (0U)
 #define CAN_X32_TFQ_WORD_OFFSET     (CAN_X32_RF0_WORD_OFFSET + \
                                      CAN_X32_RF0_NBR * CAN_X32_ELEMENT_WORDS)
+#define CAN_X32_FLE_WORD_OFFSET     (CAN_X32_TFQ_WORD_OFFSET + \
+                                     CAN_X32_TFQ_NBR * CAN_X32_ELEMENT_WORDS)
+#define CAN_X32_FLS_WORD_OFFSET     (CAN_X32_FLE_WORD_OFFSET + CAN_X32_FLE_NBR * 2U)
+
+STATIC_ASSERT(CAN_X32_FLS_WORD_OFFSET + CAN_X32_FLS_NBR <= CAN_X32_PER_INSTANCE_WORDS, can_x32_slice_overflow);
 
 #define CAN_X32_BANK1_BASE          (0x30050000UL)
 #define CAN_X32_BANK2_BASE          (0x30054000UL)
@@ -68,6 +75,12 @@
 #define FDCAN_SIDFC_FLSSA_Msk       FDCAN_SIDFC_FLSSA
 #define FDCAN_XIDFC_FLESA_Pos       (2U)
 #define FDCAN_XIDFC_FLESA_Msk       FDCAN_XIDFC_FLESA
+#define FDCAN_SIDFC_LSS_Pos         (16U)
+#define FDCAN_SIDFC_LSS_Msk         FDCAN_SIDFC_LSS
+#define FDCAN_XIDFC_LSE_Pos         (16U)
+#define FDCAN_XIDFC_LSE_Msk         FDCAN_XIDFC_LSE
+#define FDCAN_GFC_ANFE_Pos          (2U)
+#define FDCAN_GFC_ANFS_Pos          (4U)
 #define FDCAN_RXF0C_F0SA_Pos        (2U)
 #define FDCAN_RXF0C_F0SA_Msk        FDCAN_RXF0C_F0SA
 #define FDCAN_RXF0C_F0S_Pos         (16U)
@@ -84,6 +97,9 @@
 #define FDCAN_RXESC_RBDS_Msk        FDCAN_RXESC_RBDS
 #define FDCAN_TXESC_TBDS_Pos        (0U)
 #define FDCAN_TXESC_TBDS_Msk        FDCAN_TXESC_TBDS
+#ifndef FDCAN_TXFQS_TFFL
+#define FDCAN_TXFQS_TFFL            (0x3FUL)
+#endif
 
 static uint32_t canMessageRamBase(canDevice_e device)
 {
@@ -111,6 +127,16 @@ static uint32_t canTxElementAddress(canDevice_e device, uint32_t index)
          + index * CAN_TX_ELEMENT_BYTES;
 }
 
+static uint32_t canStdFilterAddress(canDevice_e device, uint32_t index)
+{
+    return canMessageRamBase(device) + (CAN_X32_FLS_WORD_OFFSET + index) * 4U;
+}
+
+static uint32_t canExtFilterAddress(canDevice_e device, uint32_t index)
+{
+    return canMessageRamBase(device) + (CAN_X32_FLE_WORD_OFFSET + index * 2U) * 4U;
+}
+
 //-----------------------------------------------------------------------------
 // Bit timing
 //
@@ -217,6 +243,20 @@ static bool canNominalBitTiming(uint32_t bitrate, uint32_t *nbtp)
 #define CAN_RX_WORD1_DLC_POS    (16U)
 #define CAN_RX_WORD1_DLC_MASK   (0xFUL << CAN_RX_WORD1_DLC_POS)
 
+//-----------------------------------------------------------------------------
+// Filter elements: classic filter/mask pairs storing into Rx FIFO 0; frames
+// matching none are rejected once a list is installed. See can_hw.c.
+//-----------------------------------------------------------------------------
+
+#define CAN_FILTER_SFT_CLASSIC  (2UL << 30)
+#define CAN_FILTER_SFEC_FIFO0   (1UL << 27)
+#define CAN_FILTER_SFID1_POS    (16U)
+#define CAN_FILTER_STDID_MASK   (0x7FFUL)
+#define CAN_FILTER_EFEC_FIFO0   (1UL << 29)
+#define CAN_FILTER_EFT_CLASSIC  (2UL << 30)
+#define CAN_FILTER_EXTID_MASK   (0x1FFFFFFFUL)
+#define CAN_FILTER_ANF_REJECT   (2UL)
+
 //-----------------------------------------------------------------------------
 // Low-level helpers
 //-----------------------------------------------------------------------------
@@ -284,8 +324,8 @@ static void canConfigureMessageRam(canDevice_e device, FDCAN_GlobalTypeDef *regs
     const uint32_t rf0Nbr   = CAN_X32_RF0_NBR;
     const uint32_t tfqNbr   = CAN_X32_TFQ_NBR;
 
-    regs->SIDFC = (instanceWords << FDCAN_SIDFC_FLSSA_Pos) & FDCAN_SIDFC_FLSSA_Msk;
-    regs->XIDFC = (instanceWords << FDCAN_XIDFC_FLESA_Pos) & FDCAN_XIDFC_FLESA_Msk;
+    regs->SIDFC = ((instanceWords + CAN_X32_FLS_WORD_OFFSET) << FDCAN_SIDFC_FLSSA_Pos) & FDCAN_SIDFC_FLSSA_Msk;
+    regs->XIDFC = ((instanceWords + CAN_X32_FLE_WORD_OFFSET) << FDCAN_XIDFC_FLESA_Pos) & FDCAN_XIDFC_FLESA_Msk;
 
     regs->RXF0C = ((rf0SA << FDCAN_RXF0C_F0SA_Pos) & FDCAN_RXF0C_F0SA_Msk)
                 | ((rf0Nbr << FDCAN_RXF0C_F0S_Pos) & FDCAN_RXF0C_F0S_Msk);
@@ -302,6 +342,40 @@ static void canConfigureMessageRam(canDevice_e device, FDCAN_GlobalTypeDef *regs
     regs->TXESC = (escCode << FDCAN_TXESC_TBDS_Pos);
 }
 
+// Requires INIT + CCE.
+static void canProgramFilters(canDevice_e device, FDCAN_GlobalTypeDef *regs)
+{
+    const canDevice_t *pDev = &canDevice[device];
+    uint32_t stdCount = 0;
+    uint32_t extCount = 0;
+
+    for (uint8_t i = 0; i < pDev->filterCount; i++) {
+        const canFilter_t *filter = &pDev->filters[i];
+        if (filter->isExtended) {
+            volatile uint32_t *element = (volatile uint32_t *)canExtFilterAddress(device, extCount++);
+            element[0] = CAN_FILTER_EFEC_FIFO0 | (filter->id & CAN_FILTER_EXTID_MASK);
+            element[1] = CAN_FILTER_EFT_CLASSIC | (filter->mask & CAN_FILTER_EXTID_MASK);
+        } else {
+            volatile uint32_t *element = (volatile uint32_t *)canStdFilterAddress(device, stdCount++);
+            *element = CAN_FILTER_SFT_CLASSIC | CAN_FILTER_SFEC_FIFO0
+                     | ((filter->id & CAN_FILTER_STDID_MASK) << CAN_FILTER_SFID1_POS)
+                     | (filter->mask & CAN_FILTER_STDID_MASK);
+        }
+    }
+
+    SCB_CleanDCache_by_Addr(
+        (uint32_t *)canExtFilterAddress(device, 0),
+        (CAN_X32_FLE_NBR * 2U + CAN_X32_FLS_NBR) * 4U);
+
+    const uint32_t nonMatching = pDev->filterCount ? CAN_FILTER_ANF_REJECT : 0U;
+
+    regs->SIDFC = (regs->SIDFC & ~FDCAN_SIDFC_LSS) | ((stdCount << FDCAN_SIDFC_LSS_Pos) & FDCAN_SIDFC_LSS_Msk);
+    regs->XIDFC = (regs->XIDFC & ~FDCAN_XIDFC_LSE) | ((extCount << FDCAN_XIDFC_LSE_Pos) & FDCAN_XIDFC_LSE_Msk);
+    regs->GFC = (regs->GFC & ~(FDCAN_GFC_ANFS | FDCAN_GFC_ANFE))
+              | (nonMatching << FDCAN_GFC_ANFS_Pos)
+              | (nonMatching << FDCAN_GFC_ANFE_Pos);
+}
+
 //-----------------------------------------------------------------------------
 // Init / public API
 //-----------------------------------------------------------------------------
@@ -351,8 +425,8 @@ void canInitDevice(canDevice_e device, uint32_t bitrate)
 
     canClearMessageRam(device);
 
-    regs->GFC &= ~(FDCAN_GFC_ANFS | FDCAN_GFC_ANFE);
     canConfigureMessageRam(device, regs);
+    canProgramFilters(device, regs);
 
     // Pre-fill Tx FIFO slots so they don't transmit as ID=0x000 phantom frames.
     for (uint32_t i = 0; i < 3U; i++) {
@@ -392,6 +466,39 @@ bool canInit(canDevice_e device, uint32_t bitrate)
     return canDevice[device].initialized;
 }
 
+uint8_t canFilterCapacity(canDevice_e device, bool isExtended)
+{
+    UNUSED(device);
+    return isExtended ? CAN_X32_FLE_NBR : CAN_X32_FLS_NBR;
+}
+
+bool canSetFilters(canDevice_e device, const canFilter_t *filters, uint8_t count)
+{
+    if (device < 0 || device >= CANDEV_COUNT || count > CAN_FILTER_LIST_MAX) {
+        return false;
+    }
+
+    canDevice_t *pDev = &canDevice[device];
+
+    memcpy(pDev->filters, filters, count * sizeof(*filters));
+    count = canFilterReduce(pDev->filters, count, false, canFilterCapacity(device, false));
+    pDev->filterCount = canFilterReduce(pDev->filters, count, true, canFilterCapacity(device, true));
+
+    if (!pDev->initialized) {
+        return true;
+    }
+
+    FDCAN_GlobalTypeDef *regs = canRegs(device);
+    NVIC_DisableIRQ((IRQn_Type)pDev->irq0);
+    if (canEnterConfigMode(regs)) {
+        canProgramFilters(device, regs);
+        pDev->initialized = canExitConfigMode(regs);
+    }
+    NVIC_EnableIRQ((IRQn_Type)pDev->irq0);
+
+    return true;
+}
+
 void canRegisterRxCallback(canDevice_e device, canRxCallbackPtr callback)
 {
     if (device < 0 || device >= CANDEV_COUNT) {
@@ -401,6 +508,33 @@ void canRegisterRxCallback(canDevice_e device, canRxCallbackPtr callback)
     canDevice[device].rxCallback = callback;
 }
 
+// Fill the Tx FIFO slot at putIndex and request its transmission.
+static void canTxPut(canDevice_e device, FDCAN_GlobalTypeDef *regs, uint32_t putIndex,
+                     uint32_t identifier, bool isExtended, const uint8_t *data, uint8_t length)
+{
+    volatile uint32_t *slot = (volatile uint32_t *)canTxElementAddress(device, putIndex);
+
+    if (isExtended) {
+        slot[0] = CAN_TX_WORD0_XTD | (identifier & 0x1FFFFFFFUL);
+    } else {
+        slot[0] = (identifier & 0x7FFUL) << 18;
+    }
+
+    slot[1] = (uint32_t)length << CAN_TX_WORD1_DLC_POS;
+
+    uint32_t words[2] = { 0, 0 };
+    for (uint8_t i = 0; i < length; i++) {
+        words[i >> 2] |= ((uint32_t)data[i]) << ((i & 3U) * 8U);
+    }
+    slot[2] = words[0];
+    slot[3] = words[1];
+
+    __DSB();
+    SCB_CleanDCache_by_Addr((uint32_t *)slot, CAN_TX_ELEMENT_BYTES);
+
+    regs->TXBAR = 1UL << putIndex;
+}
+
 bool canTransmit(canDevice_e device, uint32_t identifier, bool isExtended,
                  const uint8_t *data, uint8_t length)
 {
@@ -424,28 +558,40 @@ bool canTransmit(canDevice_e device, uint32_t identifier, bool isExtended,
         return false;
     }
 
-    uint32_t putIndex = (txfqs & FDCAN_TXFQS_TFQPI) >> 16;
-    volatile uint32_t *slot = (volatile uint32_t *)canTxElementAddress(device, putIndex);
+    canTxPut(device, regs, (txfqs & FDCAN_TXFQS_TFQPI) >> 16, identifier, isExtended, data, length);
 
-    if (isExtended) {
-        slot[0] = CAN_TX_WORD0_XTD | (identifier & 0x1FFFFFFFUL);
-    } else {
-        slot[0] = (identifier & 0x7FFUL) << 18;
-    }
+    return true;
+}
 
-    slot[1] = (uint32_t)length << CAN_TX_WORD1_DLC_POS;
+// No software ring here: the run goes out only if the Tx FIFO has a free
+// slot for every frame of it.
+bool canTransmitFrames(canDevice_e device, const canFrame_t *frames, uint8_t count)
+{
+    if (device < 0 || device >= CANDEV_COUNT) {
+        return false;
+    }
 
-    uint32_t words[2] = { 0, 0 };
-    for (uint8_t i = 0; i < length; i++) {
-        words[i >> 2] |= ((uint32_t)data[i]) << ((i & 3U) * 8U);
+    canDevice_t *pDev = &canDevice[device];
+    if (!pDev->initialized || frames == NULL || count == 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (frames[i].length > CAN_CLASSIC_MAX_DLC) {
+            return false;
+        }
     }
-    slot[2] = words[0];
-    slot[3] = words[1];
 
-    __DSB();
-    SCB_CleanDCache_by_Addr((uint32_t *)slot, CAN_TX_ELEMENT_BYTES);
+    FDCAN_GlobalTypeDef *regs = canRegs(device);
 
-    regs->TXBAR = 1UL << putIndex;
+    if ((regs->TXFQS & FDCAN_TXFQS_TFFL) < count) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const canFrame_t *frame = &frames[i];
+        canTxPut(device, regs, (regs->TXFQS & FDCAN_TXFQS_TFQPI) >> 16,
+                 frame->id, frame->isExtended, frame->data, frame->length);
+    }
 
     return true;
 }
@@ -0,0 +1,446 @@
+#!/usr/bin/env python3
+"""DroneCAN node simulator on the SITL virtual CAN bus.
+
+Joins the bus of a running betaflight_SITL (sitl_can_bus.h: one multicast
+datagram per frame, announced when it starts, with its length in bits) and
+plays the peripherals the DroneCAN stack talks to:
+  - a GNSS node broadcasting uavcan.equipment.gnss.Fix2 and NodeStatus
+  - N ESC nodes broadcasting uavcan.equipment.esc.Status, with an RPM that
+    follows the throttle of the last esc.RawCommand received
+  - optional filler traffic of a data type nobody subscribes to, to load the
+    flight controller's RX path
+
+and measures what the flight controller sends: esc.RawCommand rate, the
+interval between commands and their latency on the bus (start of the first
+frame to the end of the last), plus the bus load seen by this node.
+
+Usage:
+  dronecan_node_sim.py --escs 4 --duration 10
+  dronecan_node_sim.py --instance 1 --bitrate 500 --filler-rate 2000 -v
+  dronecan_node_sim.py --min-rawcommand-rate 400   # exit 1 below 400 Hz
+"""
+
+import argparse
+import heapq
+import os
+import random
+import socket
+import struct
+import sys
+import time
+
+CAN_MAGIC = 0x4E414353
+CAN_PORT = 9007
+CAN_GROUP = "239.255.67.65"
+CAN_FLAG_EXTENDED = 1
+INSTANCE_PORT_STRIDE = 10
+# magic, sender, startNs, bitrate, id, flags, length, bits, data, reserved
+WIRE = struct.Struct("<IIQIIBBH8sI")
+
+NODE_STATUS_ID = 341
+NODE_STATUS_SIGNATURE = 0x0F0868D0C1A7C6F1
+GNSS_FIX2_ID = 1063
+GNSS_FIX2_SIGNATURE = 0xCA41E7000F37435F
+ESC_RAWCOMMAND_ID = 1030
+ESC_RAWCOMMAND_SIGNATURE = 0x217F5C87D7EC951D
+ESC_STATUS_ID = 1034
+ESC_STATUS_SIGNATURE = 0xA9AF28AEA2FBB254
+FILLER_ID = 20000           # vendor range, no subscriber
+FILLER_SIGNATURE = 0
+
+PRIORITY_HIGH = 8
+PRIORITY_MEDIUM = 16
+PRIORITY_LOW = 24
+
+RAWCOMMAND_MAX = 8191
+TX_QUEUE_LIMIT = 256
+
+VERBOSE = False
+
+
+def log(msg):
+    print(f"[cansim] {msg}", flush=True)
+
+
+# --- CAN frame timing, as sitlCanFrameBits() -------------------------------
+
+def frame_bits(can_id, extended, data):
+    bits = [0]
+    def put(value, width):
+        for i in range(width - 1, -1, -1):
+            bits.append((value >> i) & 1)
+    if extended:
+        put((can_id >> 18) & 0x7FF, 11)
+        put(3, 2)
+        put(can_id & 0x3FFFF, 18)
+        put(0, 3)
+    else:
+        put(can_id & 0x7FF, 11)
+        put(0, 3)
+    put(len(data), 4)
+    for b in data:
+        put(b, 8)
+    crc = 0
+    for b in bits:
+        feedback = b ^ ((crc >> 14) & 1)
+        crc = (crc << 1) & 0x7FFF
+        if feedback:
+            crc ^= 0x4599
+    put(crc, 15)
+
+    stuffed, run, level = 0, 1, bits[0]
+    for b in bits[1:]:
+        if b == level:
+            run += 1
+            if run == 5:
+                stuffed += 1
+                level ^= 1
+                run = 1
+        else:
+            level, run = b, 1
+    return len(bits) + stuffed + 13
+
+
+# --- DSDL bit packing, as libcanard's canardEncodeScalar() -----------------
+
+class BitWriter:
+    def __init__(self):
+        self.bits = []
+
+    def put(self, value, width):
+        raw = bytearray((value & ((1 << width) - 1)).to_bytes(8, "little"))
+        if width % 8:
+            raw[width // 8] = (raw[width // 8] << (8 - width % 8)) & 0xFF
+        for i in range(width):
+            self.bits.append((raw[i // 8] >> (7 - i % 8)) & 1)
+
+    def put_f16(self, value):
+        self.put(struct.unpack("<H", struct.pack("<e", value))[0], 16)
+
+    def put_f32(self, value):
+        self.put(struct.unpack("<I", struct.pack("<f", value))[0], 32)
+
+    def payload(self):
+        out = bytearray((len(self.bits) + 7) // 8)
+        for i, b in enumerate(self.bits):
+            out[i // 8] |= b << (7 - i % 8)
+        return bytes(out)
+
+
+def get_scalar(payload, offset, width, signed=False):
+    raw = bytearray(8)
+    for i in range(width):
+        bit = (payload[(offset + i) // 8] >> (7 - (offset + i) % 8)) & 1
+        raw[i // 8] |= bit << (7 - i % 8)
+    if width % 8:
+        raw[width // 8] >>= 8 - width % 8
+    value = int.from_bytes(raw, "little")
+    if signed and value & (1 << (width - 1)):
+        value -= 1 << width
+    return value
+
+
+def transfer_crc(signature, payload):
+    crc = 0xFFFF
+    for b in signature.to_bytes(8, "little") + payload:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def message_frames(node_id, data_type_id, signature, priority, transfer_id, payload):
+    can_id = (priority << 24) | (data_type_id << 8) | node_id
+    if len(payload) <= 7:
+        return [(can_id, payload + bytes([0xC0 | transfer_id]))]
+    crc = transfer_crc(signature, payload)
+    body = struct.pack("<H", crc) + payload
+    frames, toggle = [], 0
+    for start in range(0, len(body), 7):
+        chunk = body[start:start + 7]
+        tail = (0x80 if start == 0 else 0) | (0x40 if start + 7 >= len(body) else 0) | (toggle << 5) | transfer_id
+        frames.append((can_id, chunk + bytes([tail])))
+        toggle ^= 1
+    return frames
+
+
+# --- Nodes ------------------------------------------------------------------
+
+class Node:
+    def __init__(self, node_id):
+        self.node_id = node_id
+        self.transfer_ids = {}
+        self.start = time.monotonic()
+
+    def frames(self, data_type_id, signature, priority, payload):
+        tid = self.transfer_ids.get(data_type_id, 0)
+        self.transfer_ids[data_type_id] = (tid + 1) & 0x1F
+        return message_frames(self.node_id, data_type_id, signature, priority, tid, payload)
+
+    def node_status(self):
+        w = BitWriter()
+        w.put(int(time.monotonic() - self.start), 32)     # uptime_sec
+        w.put(0, 2)                                         # health OK
+        w.put(0, 3)                                         # mode OPERATIONAL
+        w.put(0, 3)                                         # sub_mode
+        w.put(0, 16)                                        # vendor status
+        return self.frames(NODE_STATUS_ID, NODE_STATUS_SIGNATURE, PRIORITY_LOW, w.payload())
+
+
+class GnssNode(Node):
+    def __init__(self, node_id, lat, lon, alt_m):
+        super().__init__(node_id)
+        self.lat, self.lon, self.alt_m = lat, lon, alt_m
+
+    def fix2(self):
+        now_us = int(time.monotonic() * 1e6)
+        w = BitWriter()
+        w.put(now_us, 56)                           # timestamp
+        w.put(now_us, 56)                           # gnss_timestamp
+        w.put(3, 3)                                 # GPS time
+        w.put(0, 13)                                # void13
+        w.put(18, 8)                                # num_leap_seconds
+        w.put(round(self.lon * 1e8), 37)
+        w.put(round(self.lat * 1e8), 37)
+        w.put(round(self.alt_m * 1000), 27)         # height_ellipsoid_mm
+        w.put(round(self.alt_m * 1000), 27)         # height_msl_mm
+        for v in (0.0, 0.0, 0.0):
+            w.put_f32(v)                            # ned_velocity
+        w.put(14, 6)                                # sats_used
+        w.put(3, 2)                                 # 3D fix
+        w.put(0, 4)                                 # mode SINGLE
+        w.put(0, 6)                                 # sub_mode
+        w.put(6, 6)                                 # covariance, diagonal
+        for v in (0.25, 0.25, 0.64, 0.01, 0.01, 0.04):
+            w.put_f16(v)
+        w.put_f16(1.2)                              # pdop
+        return self.frames(GNSS_FIX2_ID, GNSS_FIX2_SIGNATURE, PRIORITY_MEDIUM, w.payload())
+
+
+class EscNode(Node):
+    def __init__(self, node_id, index, max_rpm):
+        super().__init__(node_id)
+        self.index = index
+        self.max_rpm = max_rpm
+        self.command = 0
+
+    def status(self):
+        rpm = self.command * self.max_rpm // RAWCOMMAND_MAX
+        w = BitWriter()
+        w.put(0, 32)                                # error_count
+        w.put_f16(16.0 - 0.5 * self.command / RAWCOMMAND_MAX)
+        w.put_f16(20.0 * self.command / RAWCOMMAND_MAX)
+        w.put_f16(313.15)                           # temperature, K
+        w.put(rpm, 18)
+        w.put(100 * self.command // RAWCOMMAND_MAX, 7)
+        w.put(self.index, 5)
+        return self.frames(ESC_STATUS_ID, ESC_STATUS_SIGNATURE, PRIORITY_LOW, w.payload())
+
+
+# --- Bus --------------------------------------------------------------------
+
+class Bus:
+    def __init__(self, instance, device, bitrate):
+        port = CAN_PORT + device + instance * INSTANCE_PORT_STRIDE
+        self.dest = (CAN_GROUP, port)
+        self.bitrate = bitrate
+        self.sender = random.getrandbits(32)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("", port))
+        mreq = struct.pack("4s4s", socket.inet_aton(CAN_GROUP), socket.inet_aton("0.0.0.0"))
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 0)
+        self.sock.setblocking(False)
+        self.idle_from_ns = 0
+        self.busy_ns = 0
+        self.queue = []
+        self.sent = 0
+        self.dropped = 0
+
+    def frame_ns(self, bits):
+        return bits * 1_000_000_000 // self.bitrate
+
+    def occupy(self, start_ns, bits):
+        start_ns = max(start_ns, self.idle_from_ns)
+        self.idle_from_ns = start_ns + self.frame_ns(bits)
+        self.busy_ns += self.frame_ns(bits)
+
+    def queue_frames(self, frames):
+        if len(self.queue) + len(frames) > TX_QUEUE_LIMIT:
+            self.dropped += len(frames)
+            return
+        self.queue.extend(frames)
+
+    def pump(self):
+        """Start the next queued frame if the bus is idle; ns until it could be"""
+        now = time.monotonic_ns()
+        while self.queue and self.idle_from_ns <= now:
+            can_id, data = self.queue.pop(0)
+            bits = frame_bits(can_id, True, data)
+            datagram = WIRE.pack(CAN_MAGIC, self.sender, now, self.bitrate, can_id, CAN_FLAG_EXTENDED,
+                                 len(data), bits, data.ljust(8, b"\0"), 0)
+            self.sock.sendto(datagram, self.dest)
+            self.occupy(now, bits)
+            self.sent += 1
+        return max(0, self.idle_from_ns - now) if self.queue else None
+
+    def receive(self):
+        while True:
+            try:
+                datagram = self.sock.recv(64)
+            except BlockingIOError:
+                return
+            if len(datagram) != WIRE.size:
+                continue
+            magic, sender, start_ns, bitrate, can_id, flags, length, bits, data, _ = WIRE.unpack(datagram)
+            if magic != CAN_MAGIC or sender == self.sender or length > 8:
+                continue
+            if bitrate != self.bitrate:
+                log(f"frame at {bitrate // 1000} kbit/s on a {self.bitrate // 1000} kbit/s bus")
+                continue
+            self.occupy(start_ns, bits)
+            yield can_id, bool(flags & CAN_FLAG_EXTENDED), data[:length], start_ns, start_ns + self.frame_ns(bits)
+
+
+class RawCommandMonitor:
+    """Reassembles esc.RawCommand transfers and records rate, interval and latency"""
+
+    def __init__(self, escs):
+        self.escs = escs
+        self.partial = {}
+        self.times = []
+        self.latencies = []
+        self.crc_errors = 0
+        self.sources = set()
+
+    def frame(self, can_id, data, start_ns, end_ns):
+        if (can_id >> 7) & 1 or ((can_id >> 8) & 0xFFFF) != ESC_RAWCOMMAND_ID or not data:
+            return
+        source = can_id & 0x7F
+        tail = data[-1]
+        first, last, tid = bool(tail & 0x80), bool(tail & 0x40), tail & 0x1F
+        body = data[:-1]
+        if first:
+            self.partial[source] = (tid, start_ns, bytearray(body))
+        elif source in self.partial and self.partial[source][0] == tid:
+            self.partial[source][2].extend(body)
+        else:
+            return
+        if not last:
+            return
+
+        tid, first_ns, payload = self.partial.pop(source)
+        if not first:
+            crc = payload[0] | payload[1] << 8
+            payload = bytes(payload[2:])
+            if transfer_crc(ESC_RAWCOMMAND_SIGNATURE, payload) != crc:
+                self.crc_errors += 1
+                return
+        self.sources.add(source)
+        self.times.append(end_ns)
+        self.latencies.append(end_ns - first_ns)
+        commands = [get_scalar(payload, 14 * i, 14, signed=True) for i in range(len(payload) * 8 // 14)]
+        for esc in self.escs:
+            if esc.index < len(commands):
+                esc.command = max(0, commands[esc.index])
+
+
+def percentile(values, p):
+    if not values:
+        return 0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(p / 100 * len(ordered)))]
+
+
+def main():
+    global VERBOSE
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--instance", type=int, default=0, help="SITL --instance")
+    ap.add_argument("--device", type=int, default=1, help="CAN device, as the can_* settings (1-3)")
+    ap.add_argument("--bitrate", type=int, default=1000, help="kbit/s, as can_bitrate_khz")
+    ap.add_argument("--escs", type=int, default=4)
+    ap.add_argument("--esc-first-node", type=int, default=20)
+    ap.add_argument("--esc-rate", type=float, default=50.0, help="esc.Status per ESC, Hz")
+    ap.add_argument("--max-rpm", type=int, default=30000, help="RPM at full RawCommand")
+    ap.add_argument("--gnss-node", type=int, default=60, help="0 disables the GNSS node")
+    ap.add_argument("--gnss-rate", type=float, default=10.0, help="Fix2, Hz")
+    ap.add_argument("--lat", type=float, default=-27.5)
+    ap.add_argument("--lon", type=float, default=153.0)
+    ap.add_argument("--alt", type=float, default=30.0)
+    ap.add_argument("--filler-rate", type=float, default=0.0, help="single-frame filler transfers, Hz")
+    ap.add_argument("--duration", type=float, default=0.0, help="seconds, 0 runs until interrupted")
+    ap.add_argument("--min-rawcommand-rate", type=float, default=0.0, help="exit 1 below this RawCommand rate, Hz")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+    VERBOSE = args.verbose
+
+    bus = Bus(args.instance, args.device - 1, args.bitrate * 1000)
+    escs = [EscNode(args.esc_first_node + i, i, args.max_rpm) for i in range(args.escs)]
+    gnss = GnssNode(args.gnss_node, args.lat, args.lon, args.alt) if args.gnss_node else None
+    filler = Node(args.gnss_node + 1 if args.gnss_node else 61)
+    monitor = RawCommandMonitor(escs)
+    log(f"{args.escs} ESCs, GNSS node {args.gnss_node} on {bus.dest[0]}:{bus.dest[1]} at {args.bitrate} kbit/s")
+
+    # (due, period, producer)
+    now = time.monotonic()
+    schedule = []
+    def every(rate, producer):
+        if rate > 0:
+            heapq.heappush(schedule, (now + random.random() / rate, len(schedule), 1.0 / rate, producer))
+    for esc in escs:
+        every(args.esc_rate, esc.status)
+        every(1.0, esc.node_status)
+    if gnss:
+        every(args.gnss_rate, gnss.fix2)
+        every(1.0, gnss.node_status)
+    every(args.filler_rate, lambda: filler.frames(FILLER_ID, FILLER_SIGNATURE, PRIORITY_LOW, os.urandom(7)))
+
+    start = time.monotonic()
+    start_ns = time.monotonic_ns()
+    received = 0
+    last_report = start
+    try:
+        while not args.duration or time.monotonic() - start < args.duration:
+            now = time.monotonic()
+            while schedule and schedule[0][0] <= now:
+                due, order, period, producer = heapq.heappop(schedule)
+                bus.queue_frames(producer())
+                heapq.heappush(schedule, (due + period, order, period, producer))
+
+            for can_id, extended, data, frame_start, frame_end in bus.receive():
+                received += 1
+                if extended:
+                    monitor.frame(can_id, data, frame_start, frame_end)
+
+            wait_ns = bus.pump()
+            timeout = schedule[0][0] - time.monotonic() if schedule else 0.01
+            if wait_ns is not None:
+                timeout = min(timeout, wait_ns / 1e9)
+            time.sleep(max(0.0, min(timeout, 0.0005)))
+
+            if VERBOSE and now - last_report >= 1.0:
+                last_report = now
+                log(f"rx {received} tx {bus.sent} RawCommand {len(monitor.times)} load "
+                    f"{100.0 * bus.busy_ns / (time.monotonic_ns() - start_ns):.1f}%")
+    except KeyboardInterrupt:
+        pass
+
+    elapsed = time.monotonic() - start
+    intervals = [b - a for a, b in zip(monitor.times, monitor.times[1:])]
+    rate = len(monitor.times) / elapsed if elapsed > 0 else 0.0
+    log(f"{elapsed:.1f}s: frames rx {received} tx {bus.sent} (queue drops {bus.dropped}), "
+        f"bus load {100.0 * bus.busy_ns / (time.monotonic_ns() - start_ns):.1f}%")
+    log(f"RawCommand from nodes {sorted(monitor.sources)}: {len(monitor.times)} at {rate:.1f} Hz, "
+        f"interval p50 {percentile(intervals, 50) / 1e3:.0f}us p99 {percentile(intervals, 99) / 1e3:.0f}us, "
+        f"bus latency p50 {percentile(monitor.latencies, 50) / 1e3:.0f}us p99 {percentile(monitor.latencies, 99) / 1e3:.0f}us, "
+        f"CRC errors {monitor.crc_errors}")
+    if args.min_rawcommand_rate and rate < args.min_rawcommand_rate:
+        log(f"FAIL: RawCommand below {args.min_rawcommand_rate} Hz")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
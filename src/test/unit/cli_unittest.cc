@@ -385,6 +385,7 @@ void changeBatteryProfile(uint8_t) {}
 uint8_t getCurrentBatteryProfileIndex(void) { return 0; }
 bool serialIsPortAvailable(serialPortIdentifier_e) { return false; }
 void generateLedConfig(ledConfig_t *, char *, size_t) {}
+void ws2811GetUpdateStats(ws2811UpdateStats_t *stats) { memset(stats, 0, sizeof(*stats)); }
 //bool isSerialTransmitBufferEmpty(const serialPort_t *) {return true; }
 //void serialWrite(serialPort_t *, uint8_t ch) { printf("%c", ch);}
 
@@ -431,6 +432,8 @@ float getCurrentRxRateHz(void) { return 0; }
 uint16_t getAverageSystemLoadPercent(void) { return 0; }
 bool getRxRateValid(void) { return false; }
 const uint16_t *getBuildOptions(unsigned *count) { *count = 0; return NULL; }
+bool mavlinkTelemetryGetBudget(uint32_t *, uint32_t *) { return false; }
+bool mavlinkTelemetryGetStreamRate(uint8_t, uint32_t *, uint16_t *, uint16_t *) { return false; }
 }
 
 // Verifies cliGetSettingByName returns "name = value" for an array setting.
@@ -0,0 +1,180 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/maths.h"
+    #include "common/streambuf.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// Bit at a time CRC16-CCITT, as crc.c computed it before the tables
+static uint16_t crc16CcittBitwise(uint16_t crc, uint8_t a)
+{
+    crc ^= (uint16_t)a << 8;
+    for (int ii = 0; ii < 8; ++ii) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static const uint8_t checkString[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+
+// The CRC is linear in the state and the byte, so every byte from the zero
+// state and from each single-bit state covers all of them; a stride through
+// the states is a cross-check on top
+TEST(CrcTest, Crc16CcittMatchesBitwiseForEveryByte)
+{
+    std::vector<uint16_t> states = { 0, UINT16_MAX };
+    for (int bit = 0; bit < 16; bit++) {
+        states.push_back(1 << bit);
+    }
+    for (uint32_t crc = 1; crc <= UINT16_MAX; crc += 97) {
+        states.push_back(crc);
+    }
+
+    for (uint16_t crc : states) {
+        for (uint32_t a = 0; a <= UINT8_MAX; a++) {
+            ASSERT_EQ(crc16CcittBitwise(crc, a), crc16_ccitt(crc, a)) << "crc " << crc << " byte " << a;
+        }
+    }
+}
+
+TEST(CrcTest, Crc8TablesMatchBitwiseForEveryStateAndByte)
+{
+    for (uint32_t crc = 0; crc <= UINT8_MAX; crc++) {
+        for (uint32_t a = 0; a <= UINT8_MAX; a++) {
+            ASSERT_EQ(crc8_calc(crc, a, 0xD5), crc8_dvb_s2(crc, a)) << "crc " << crc << " byte " << a;
+            ASSERT_EQ(crc8_calc(crc, a, 0xBA), crc8_poly_0xba(crc, a)) << "crc " << crc << " byte " << a;
+        }
+    }
+}
+
+TEST(CrcTest, BufferCheckValues)
+{
+    EXPECT_EQ(0x31c3, crc16_ccitt_update(0, checkString, sizeof(checkString)));
+    EXPECT_EQ(0xbc, crc8_dvb_s2_update(0, checkString, sizeof(checkString)));
+    EXPECT_EQ(0x20, crc8_poly_0xba_update(0, checkString, sizeof(checkString)));
+    EXPECT_EQ(0xbc, crc8_update(0, checkString, sizeof(checkString), 0xD5));
+
+    // split buffers carry the CRC across
+    const uint16_t crc16 = crc16_ccitt_update(0, checkString, 4);
+    EXPECT_EQ(0x31c3, crc16_ccitt_update(crc16, checkString + 4, sizeof(checkString) - 4));
+    const uint8_t crc8 = crc8_dvb_s2_update(0, checkString, 4);
+    EXPECT_EQ(0xbc, crc8_dvb_s2_update(crc8, checkString + 4, sizeof(checkString) - 4));
+
+    EXPECT_EQ(0x5a, crc8_dvb_s2_update(0x5a, checkString, 0));
+}
+
+TEST(CrcTest, SbufAppend)
+{
+    uint8_t buffer[16];
+    sbuf_t buf;
+
+    buf.ptr = buffer;
+    buf.end = buffer + sizeof(buffer);
+    sbufWriteData(&buf, checkString, sizeof(checkString));
+    crc8_dvb_s2_sbuf_append(&buf, buffer);
+    EXPECT_EQ(sizeof(checkString) + 1, (size_t)(buf.ptr - buffer));
+    EXPECT_EQ(0xbc, buffer[sizeof(checkString)]);
+
+    buf.ptr = buffer;
+    sbufWriteData(&buf, checkString, sizeof(checkString));
+    crc8_poly_0xba_sbuf_append(&buf, buffer);
+    EXPECT_EQ(0x20, buffer[sizeof(checkString)]);
+
+    buf.ptr = buffer;
+    sbufWriteData(&buf, checkString, sizeof(checkString));
+    crc16_ccitt_sbuf_append(&buf, buffer);
+    EXPECT_EQ(sizeof(checkString) + 2, (size_t)(buf.ptr - buffer));
+    // sbufWriteU16 is little endian
+    EXPECT_EQ(0xc3, buffer[sizeof(checkString)]);
+    EXPECT_EQ(0x31, buffer[sizeof(checkString) + 1]);
+}
+
+TEST(CrcTest, CrcOfMessageAndCrcIsZero)
+{
+    uint8_t frame[sizeof(checkString) + 1];
+    memcpy(frame, checkString, sizeof(checkString));
+    frame[sizeof(checkString)] = crc8_dvb_s2_update(0, checkString, sizeof(checkString));
+    EXPECT_EQ(0, crc8_dvb_s2_update(0, frame, sizeof(frame)));
+}
+
+// Timing only, recorded as test properties; wall-clock time is no pass/fail
+// criterion on a shared or instrumented build
+TEST(CrcTest, BitwiseAndTableTiming)
+{
+    // a frame-sized mix of bytes, pseudo-random so no branch pattern settles
+    std::vector<uint8_t> data(4096);
+    uint32_t seed = 12345;
+    for (uint8_t &c : data) {
+        seed = seed * 1103515245 + 12345;
+        c = seed >> 16;
+    }
+
+    const int iterations = 50;
+    const double bytes = (double)data.size() * iterations;
+
+    // best of a few runs, so a preempted run doesn't decide the comparison
+    double bitwiseNsPerByte = 0;
+    double tableNsPerByte = 0;
+    uint16_t bitwiseCrc16 = 0;
+    uint8_t bitwiseCrc8 = 0;
+    uint16_t tableCrc16 = 0;
+    uint8_t tableCrc8 = 0;
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            bitwiseCrc16 = 0;
+            bitwiseCrc8 = 0;
+            for (uint8_t c : data) {
+                bitwiseCrc16 = crc16CcittBitwise(bitwiseCrc16, c);
+                bitwiseCrc8 = crc8_calc(bitwiseCrc8, c, 0xD5);
+            }
+        }
+        const double bitwiseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / bytes;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            tableCrc16 = crc16_ccitt_update(0, data.data(), data.size());
+            tableCrc8 = crc8_dvb_s2_update(0, data.data(), data.size());
+        }
+        const double tableNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / bytes;
+
+        bitwiseNsPerByte = run ? MIN(bitwiseNsPerByte, bitwiseNs) : bitwiseNs;
+        tableNsPerByte = run ? MIN(tableNsPerByte, tableNs) : tableNs;
+    }
+
+    EXPECT_EQ(bitwiseCrc16, tableCrc16);
+    EXPECT_EQ(bitwiseCrc8, tableCrc8);
+
+    RecordProperty("bitwise_ns_per_byte", std::to_string(bitwiseNsPerByte));
+    RecordProperty("table_ns_per_byte", std::to_string(tableNsPerByte));
+}
@@ -0,0 +1,203 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "platform.h"
+
+#include "telemetry/crsf_scheduler.h"
+}
+
+// Hand out downlink slots every slotUs, the way handleCrsfTelemetry sees
+// them, offering each due frame with the payload hash hashOf() gives it.
+// Counts the frames sent per slot.
+static void runFor(crsfScheduler_t *scheduler, timeUs_t *nowUs, uint32_t durationUs, uint32_t slotUs,
+                   uint16_t (*hashOf)(int slot, timeUs_t nowUs), uint32_t *sent)
+{
+    for (uint32_t elapsed = 0; elapsed < durationUs; elapsed += slotUs) {
+        for (int tries = 0; tries < scheduler->count; tries++) {
+            const int slot = crsfSchedulerNext(scheduler, *nowUs);
+            if (slot < 0) {
+                break;
+            }
+            if (crsfSchedulerOffer(scheduler, slot, hashOf(slot, *nowUs), *nowUs)) {
+                sent[slot]++;
+                break;
+            }
+        }
+        *nowUs += slotUs;
+    }
+}
+
+static uint16_t alwaysChanging(int, timeUs_t nowUs)
+{
+    return nowUs & 0xffff;
+}
+
+static uint16_t neverChanging(int slot, timeUs_t)
+{
+    return slot;
+}
+
+TEST(CrsfSchedulerTest, DueFramesGoHighestPriorityFirst)
+{
+    crsfScheduler_t scheduler;
+    const timeUs_t nowUs = 1000000;
+    crsfSchedulerInit(&scheduler);
+    EXPECT_EQ(0, crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_LOW, nowUs));
+    EXPECT_EQ(1, crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_HIGH, nowUs));
+    EXPECT_EQ(2, crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_NORMAL, nowUs));
+
+    EXPECT_EQ(1, crsfSchedulerNext(&scheduler, nowUs));
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 1, 0x1234, nowUs));
+    EXPECT_EQ(2, crsfSchedulerNext(&scheduler, nowUs));
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 2, 0x1234, nowUs));
+    EXPECT_EQ(0, crsfSchedulerNext(&scheduler, nowUs));
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 0, 0x1234, nowUs));
+
+    // nothing again until an interval later
+    EXPECT_EQ(-1, crsfSchedulerNext(&scheduler, nowUs + 99999));
+    EXPECT_EQ(1, crsfSchedulerNext(&scheduler, nowUs + 100000));
+}
+
+TEST(CrsfSchedulerTest, UnchangedPayloadWaitsForRefresh)
+{
+    crsfScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    crsfSchedulerInit(&scheduler);
+    crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_HIGH, nowUs);
+
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 0, 0xabcd, nowUs));
+    for (int i = 1; i < 10; i++) {
+        nowUs += 100000;
+        ASSERT_EQ(0, crsfSchedulerNext(&scheduler, nowUs));
+        EXPECT_FALSE(crsfSchedulerOffer(&scheduler, 0, 0xabcd, nowUs));
+    }
+    nowUs += 100000;
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 0, 0xabcd, nowUs));
+
+    // a change goes out as soon as the slot is due
+    nowUs += 100000;
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 0, 0xabce, nowUs));
+}
+
+TEST(CrsfSchedulerTest, SkippedFrameGivesSlotToNextDue)
+{
+    crsfScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    crsfSchedulerInit(&scheduler);
+    crsfSchedulerAddSlot(&scheduler, 200000, 1000000, CRSF_PRIORITY_HIGH, nowUs);
+    crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_NORMAL, nowUs);
+
+    // a flight mode that never changes is sent once a second, the rest of
+    // its slots carry the changing frame
+    uint32_t sent[2] = { 0 };
+    uint16_t (*hashOf)(int, timeUs_t) = [](int slot, timeUs_t nowUs) -> uint16_t {
+        return slot == 0 ? 0x55 : (nowUs & 0xffff);
+    };
+    runFor(&scheduler, &nowUs, 10000000, 20000, hashOf, sent);
+    EXPECT_NEAR(10, (int)sent[0], 1);
+    EXPECT_NEAR(100, (int)sent[1], 1);
+}
+
+TEST(CrsfSchedulerTest, SlowLinkStillServesEveryFrame)
+{
+    crsfScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    crsfSchedulerInit(&scheduler);
+    crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_HIGH, nowUs);
+    crsfSchedulerAddSlot(&scheduler, 200000, 1000000, CRSF_PRIORITY_HIGH, nowUs);
+    crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_NORMAL, nowUs);
+    crsfSchedulerAddSlot(&scheduler, 500000, 2000000, CRSF_PRIORITY_LOW, nowUs);
+
+    // 250 Hz at 1:64: a slot every 256 ms, far short of the 27 frames a
+    // second asked for
+    uint32_t sent[4] = { 0 };
+    runFor(&scheduler, &nowUs, 60000000, 256000, alwaysChanging, sent);
+
+    uint32_t total = 0;
+    for (int i = 0; i < 4; i++) {
+        EXPECT_GT(sent[i], 10u);
+        total += sent[i];
+    }
+    EXPECT_GE(total, 233u);
+    // the high priority frames get the largest share
+    EXPECT_GT(sent[0], sent[3]);
+    EXPECT_GT(sent[1], sent[3]);
+}
+
+TEST(CrsfSchedulerTest, FillerOnlyWhenLinkIsIdle)
+{
+    crsfScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    crsfSchedulerInit(&scheduler);
+    crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_HIGH, nowUs);
+    crsfSchedulerAddSlot(&scheduler, 20000, 0, CRSF_PRIORITY_FILLER, nowUs);
+
+    // frames at 10 Hz, heartbeat in between: a frame every 20 ms
+    uint32_t sent[2] = { 0 };
+    runFor(&scheduler, &nowUs, 1000000, 10000, alwaysChanging, sent);
+    EXPECT_NEAR(10, (int)sent[0], 1);
+    EXPECT_NEAR(40, (int)sent[1], 2);
+
+    // with the frame unchanged its slots go to the heartbeat too
+    memset(sent, 0, sizeof(sent));
+    runFor(&scheduler, &nowUs, 1000000, 10000, neverChanging, sent);
+    EXPECT_NEAR(1, (int)sent[0], 1);
+    EXPECT_NEAR(49, (int)sent[1], 2);
+}
+
+TEST(CrsfSchedulerTest, MspReplySharesSlotsWithDueFrames)
+{
+    crsfScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    crsfSchedulerInit(&scheduler);
+    crsfSchedulerAddSlot(&scheduler, 100000, 1000000, CRSF_PRIORITY_HIGH, nowUs);
+
+    // nothing due: the reply takes every slot
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(crsfSchedulerMspTurn(&scheduler, false));
+        crsfSchedulerMspSent(&scheduler, nowUs);
+    }
+
+    // a frame waiting: it gets a slot after at most two chunks
+    EXPECT_FALSE(crsfSchedulerMspTurn(&scheduler, true));
+    EXPECT_TRUE(crsfSchedulerOffer(&scheduler, 0, 1, nowUs));
+    EXPECT_TRUE(crsfSchedulerMspTurn(&scheduler, true));
+    crsfSchedulerMspSent(&scheduler, nowUs);
+    EXPECT_TRUE(crsfSchedulerMspTurn(&scheduler, true));
+    crsfSchedulerMspSent(&scheduler, nowUs);
+    EXPECT_FALSE(crsfSchedulerMspTurn(&scheduler, true));
+}
+
+TEST(CrsfSchedulerTest, FullScheduleRejectsSlot)
+{
+    crsfScheduler_t scheduler;
+    crsfSchedulerInit(&scheduler);
+    for (int i = 0; i < CRSF_SCHEDULER_SLOTS_MAX; i++) {
+        EXPECT_EQ(i, crsfSchedulerAddSlot(&scheduler, 100000, 0, CRSF_PRIORITY_NORMAL, 0));
+    }
+    EXPECT_EQ(-1, crsfSchedulerAddSlot(&scheduler, 100000, 0, CRSF_PRIORITY_NORMAL, 0));
+}
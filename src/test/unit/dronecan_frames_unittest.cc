@@ -0,0 +1,156 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "platform.h"
+
+#include "drivers/can/can.h"
+
+#include "io/dronecan/dronecan_frames.h"
+}
+
+// esc.RawCommand, as dronecan_esc.c sends it
+static const uint16_t rawCommandId = 1030;
+static const uint64_t rawCommandSignature = 0x217f5c87d7ec951dULL;
+static const uint8_t priorityHigh = 8;
+static const uint8_t localNode = 10;
+
+static uint16_t packRawCommand(uint8_t *payload, const uint16_t *throttles, uint8_t count)
+{
+    memset(payload, 0, (count * 14 + 7) / 8);
+    for (uint8_t i = 0; i < count; i++) {
+        dronecanPackScalar(payload, i * 14, 14, throttles[i]);
+    }
+    return (count * 14 + 7) / 8;
+}
+
+// Expected bytes below are from the node simulator's own encoder
+// (src/test/sitl/dronecan_node_sim.py), written after libcanard's.
+
+TEST(DronecanFramesTest, PackScalarMatchesCanardLayout)
+{
+    const uint16_t throttles[] = { 0, 8191, 1234, 4000 };
+    uint8_t payload[7];
+    EXPECT_EQ(7, packRawCommand(payload, throttles, 4));
+
+    const uint8_t expected[] = { 0x00, 0x03, 0xfd, 0xfd, 0x21, 0x28, 0x0f };
+    EXPECT_EQ(0, memcmp(expected, payload, sizeof(expected)));
+}
+
+TEST(DronecanFramesTest, PackScalarKeepsNeighbouringBits)
+{
+    uint8_t buffer[2] = { 0xff, 0xff };
+    dronecanPackScalar(buffer, 2, 3, 0);
+    EXPECT_EQ(0xc7, buffer[0]);
+    EXPECT_EQ(0xff, buffer[1]);
+
+    // A field straddling a byte boundary, value bits above the width ignored
+    dronecanPackScalar(buffer, 6, 4, 0xf5);
+    EXPECT_EQ(0xc5, buffer[0]);
+    EXPECT_EQ(0x7f, buffer[1]);
+}
+
+TEST(DronecanFramesTest, TransferCrcIsSeededWithSignature)
+{
+    const uint8_t check[] = "123456789";
+    EXPECT_EQ(0xf62f, dronecanTransferCrc(0, check, 9));
+
+    const uint16_t throttles[] = { 100, 200, 300, 400, 500, 600, 700, 8191 };
+    uint8_t payload[14];
+    packRawCommand(payload, throttles, 8);
+    EXPECT_EQ(0xe95d, dronecanTransferCrc(rawCommandSignature, payload, sizeof(payload)));
+}
+
+TEST(DronecanFramesTest, MessageId)
+{
+    EXPECT_EQ(0x0804060au, dronecanMessageId(priorityHigh, rawCommandId, localNode));
+    EXPECT_EQ(0x1f00017fu, dronecanMessageId(0xff, 1, 0xff));
+}
+
+TEST(DronecanFramesTest, SingleFrameTransfer)
+{
+    const uint16_t throttles[] = { 0, 8191, 1234, 4000 };
+    uint8_t payload[7];
+    const uint16_t length = packRawCommand(payload, throttles, 4);
+
+    canFrame_t frames[3];
+    const uint32_t id = dronecanMessageId(priorityHigh, rawCommandId, localNode);
+    EXPECT_EQ(1, dronecanEncodeBroadcast(frames, 3, id, rawCommandSignature, 5, payload, length));
+
+    EXPECT_EQ(id, frames[0].id);
+    EXPECT_TRUE(frames[0].isExtended);
+    EXPECT_EQ(8, frames[0].length);
+    EXPECT_EQ(0, memcmp(payload, frames[0].data, 7));
+    EXPECT_EQ(0xc5, frames[0].data[7]);
+}
+
+TEST(DronecanFramesTest, MultiFrameTransfer)
+{
+    const uint16_t throttles[] = { 100, 200, 300, 400, 500, 600, 700, 8191 };
+    uint8_t payload[14];
+    const uint16_t length = packRawCommand(payload, throttles, 8);
+    EXPECT_EQ(3u, DRONECAN_TRANSFER_FRAMES(length));
+
+    canFrame_t frames[3];
+    const uint32_t id = dronecanMessageId(priorityHigh, rawCommandId, localNode);
+    EXPECT_EQ(3, dronecanEncodeBroadcast(frames, 3, id, rawCommandSignature, 31, payload, length));
+
+    const uint8_t expected[3][8] = {
+        { 0x5d, 0xe9, 0x64, 0x03, 0x20, 0x02, 0xc0, 0x9f },
+        { 0x64, 0x01, 0xf4, 0x05, 0x60, 0x2b, 0xc0, 0x3f },
+        { 0xbf, 0xdf, 0x5f },
+    };
+    const uint8_t lengths[3] = { 8, 8, 3 };
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(id, frames[i].id);
+        EXPECT_TRUE(frames[i].isExtended);
+        ASSERT_EQ(lengths[i], frames[i].length);
+        EXPECT_EQ(0, memcmp(expected[i], frames[i].data, lengths[i])) << "frame " << i;
+    }
+}
+
+TEST(DronecanFramesTest, TransferIdWraps)
+{
+    const uint8_t payload[] = { 1, 2, 3 };
+    canFrame_t frame;
+    EXPECT_EQ(1, dronecanEncodeBroadcast(&frame, 1, 0, 0, 33, payload, sizeof(payload)));
+    EXPECT_EQ(4, frame.length);
+    EXPECT_EQ(0xc1, frame.data[3]);
+}
+
+TEST(DronecanFramesTest, RejectsTooFewFrames)
+{
+    uint8_t payload[14] = { 0 };
+    canFrame_t frames[2];
+    EXPECT_EQ(0, dronecanEncodeBroadcast(frames, 2, 0, rawCommandSignature, 0, payload, sizeof(payload)));
+
+    // Eight bytes is the shortest payload that needs a second frame
+    EXPECT_EQ(1u, DRONECAN_TRANSFER_FRAMES(7));
+    EXPECT_EQ(2u, DRONECAN_TRANSFER_FRAMES(8));
+    EXPECT_EQ(2, dronecanEncodeBroadcast(frames, 2, 0, rawCommandSignature, 0, payload, 8));
+    EXPECT_EQ(8, frames[0].length);
+    EXPECT_EQ(4, frames[1].length);
+}
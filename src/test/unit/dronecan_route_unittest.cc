@@ -0,0 +1,201 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "platform.h"
+
+#include "drivers/can/can.h"
+
+#include "io/dronecan/dronecan_route.h"
+}
+
+// Data type IDs as the stack registers them
+static const uint16_t nodeStatusId = 341;
+static const uint16_t getNodeInfoId = 1;
+static const uint16_t allocationId = 1;
+static const uint16_t fix2Id = 1063;
+static const uint16_t escStatusId = 1034;
+
+static const uint8_t localNode = 10;
+
+static uint32_t messageId(uint8_t priority, uint16_t dataTypeId, uint8_t source)
+{
+    return (uint32_t)priority << 24 | (uint32_t)dataTypeId << 8 | source;
+}
+
+static uint32_t anonymousId(uint16_t discriminator, uint16_t dataTypeId)
+{
+    return (uint32_t)discriminator << 10 | (uint32_t)(dataTypeId & 3) << 8;
+}
+
+static uint32_t serviceId(uint8_t serviceTypeId, bool request, uint8_t destination, uint8_t source)
+{
+    return 4u << 24 | (uint32_t)serviceTypeId << 16 | (uint32_t)request << 15
+        | (uint32_t)destination << 8 | 1u << 7 | source;
+}
+
+class DronecanRouteTest : public ::testing::Test {
+protected:
+    dronecanRouteTable_t table;
+    canFilter_t filters[DRONECAN_ROUTE_FILTERS_MAX];
+    uint8_t filterCount;
+
+    void SetUp() override
+    {
+        // The subscribers of a full build, in dronecanInit() order
+        dronecanRouteTableInit(&table);
+        dronecanRouteTableAdd(&table, getNodeInfoId, DRONECAN_TRANSFER_REQUEST);
+        dronecanRouteTableAdd(&table, nodeStatusId, DRONECAN_TRANSFER_BROADCAST);
+        dronecanRouteTableAdd(&table, getNodeInfoId, DRONECAN_TRANSFER_RESPONSE);
+        dronecanRouteTableAdd(&table, fix2Id, DRONECAN_TRANSFER_BROADCAST);
+        dronecanRouteTableAdd(&table, escStatusId, DRONECAN_TRANSFER_BROADCAST);
+        dronecanRouteTableAdd(&table, allocationId, DRONECAN_TRANSFER_BROADCAST);
+        dronecanRouteTableAdd(&table, nodeStatusId, DRONECAN_TRANSFER_BROADCAST);
+        filterCount = dronecanRouteTableFilters(&table, localNode, filters);
+    }
+
+    bool accepts(uint32_t id) const
+    {
+        return canFilterMatch(filters, filterCount, id, true);
+    }
+};
+
+TEST_F(DronecanRouteTest, FindsEveryRouteForATransfer)
+{
+    int index = dronecanRouteTableFind(&table, nodeStatusId, DRONECAN_TRANSFER_BROADCAST);
+    EXPECT_EQ(1, index);
+    index = dronecanRouteTableNext(&table, index);
+    EXPECT_EQ(6, index);
+    EXPECT_EQ(-1, dronecanRouteTableNext(&table, index));
+
+    // same data type, told apart by the transfer type
+    EXPECT_EQ(0, dronecanRouteTableFind(&table, getNodeInfoId, DRONECAN_TRANSFER_REQUEST));
+    EXPECT_EQ(2, dronecanRouteTableFind(&table, getNodeInfoId, DRONECAN_TRANSFER_RESPONSE));
+    EXPECT_EQ(5, dronecanRouteTableFind(&table, allocationId, DRONECAN_TRANSFER_BROADCAST));
+
+    EXPECT_EQ(-1, dronecanRouteTableFind(&table, 1030, DRONECAN_TRANSFER_BROADCAST));
+    EXPECT_EQ(-1, dronecanRouteTableFind(&table, fix2Id, DRONECAN_TRANSFER_REQUEST));
+}
+
+TEST_F(DronecanRouteTest, ChainsCollidingBuckets)
+{
+    dronecanRouteTable_t full;
+    dronecanRouteTableInit(&full);
+    for (uint16_t id = 0; id < DRONECAN_ROUTE_MAX; id++) {
+        EXPECT_TRUE(dronecanRouteTableAdd(&full, 1000 + id * DRONECAN_ROUTE_BUCKETS, DRONECAN_TRANSFER_BROADCAST));
+    }
+    EXPECT_FALSE(dronecanRouteTableAdd(&full, 1, DRONECAN_TRANSFER_BROADCAST));
+
+    for (uint16_t id = 0; id < DRONECAN_ROUTE_MAX; id++) {
+        const int index = dronecanRouteTableFind(&full, 1000 + id * DRONECAN_ROUTE_BUCKETS, DRONECAN_TRANSFER_BROADCAST);
+        EXPECT_EQ(id, index);
+        EXPECT_EQ(-1, dronecanRouteTableNext(&full, index));
+    }
+}
+
+TEST_F(DronecanRouteTest, FiltersPassSubscribedMessages)
+{
+    // NodeStatus once despite two subscribers, allocation twice for its
+    // anonymous frames, and one each for the rest
+    EXPECT_EQ(7, filterCount);
+
+    EXPECT_TRUE(accepts(messageId(16, nodeStatusId, 42)));
+    EXPECT_TRUE(accepts(messageId(0, fix2Id, 127)));
+    EXPECT_TRUE(accepts(messageId(24, escStatusId, 1)));
+    EXPECT_TRUE(accepts(messageId(30, allocationId, 5)));
+    EXPECT_TRUE(accepts(anonymousId(0x2a5f, allocationId)));
+
+    // unsubscribed messages, including anonymous ones of other types
+    EXPECT_FALSE(accepts(messageId(16, 1030, 42)));         // esc.RawCommand
+    EXPECT_FALSE(accepts(messageId(16, fix2Id + 1, 42)));
+    EXPECT_FALSE(accepts(anonymousId(0x2a5f, 2)));
+
+    // only the extended frames DroneCAN uses
+    EXPECT_FALSE(canFilterMatch(filters, filterCount, nodeStatusId << 8 & 0x7ff, false));
+}
+
+TEST_F(DronecanRouteTest, FiltersPassServicesForThisNodeOnly)
+{
+    EXPECT_TRUE(accepts(serviceId(getNodeInfoId, true, localNode, 42)));
+    EXPECT_TRUE(accepts(serviceId(getNodeInfoId, false, localNode, 42)));
+
+    EXPECT_FALSE(accepts(serviceId(getNodeInfoId, true, localNode + 1, 42)));
+    EXPECT_FALSE(accepts(serviceId(getNodeInfoId, false, 1, 42)));
+    EXPECT_FALSE(accepts(serviceId(getNodeInfoId + 10, true, localNode, 42)));
+}
+
+TEST_F(DronecanRouteTest, ReducedFiltersStillPassEverything)
+{
+    const uint32_t wanted[] = {
+        messageId(16, nodeStatusId, 42),
+        messageId(0, fix2Id, 127),
+        messageId(24, escStatusId, 1),
+        messageId(30, allocationId, 5),
+        anonymousId(0x2a5f, allocationId),
+        serviceId(getNodeInfoId, true, localNode, 42),
+        serviceId(getNodeInfoId, false, localNode, 42),
+    };
+
+    for (uint8_t capacity = filterCount; capacity >= 1; capacity--) {
+        canFilter_t reduced[DRONECAN_ROUTE_FILTERS_MAX];
+        memcpy(reduced, filters, sizeof(filters));
+        const uint8_t count = canFilterReduce(reduced, filterCount, true, capacity);
+        EXPECT_EQ(capacity, count);
+        for (const uint32_t id : wanted) {
+            EXPECT_TRUE(canFilterMatch(reduced, count, id, true)) << "capacity " << (int)capacity << " id " << std::hex << id;
+        }
+    }
+}
+
+TEST(CanFilterTest, ReduceMergesDuplicatesFirstAndKeepsTheOtherKind)
+{
+    canFilter_t filters[] = {
+        { .id = 0x100, .mask = 0x7ff, .isExtended = false },
+        { .id = 0x12300, .mask = 0xffff80, .isExtended = true },
+        { .id = 0x12380, .mask = 0xffff80, .isExtended = true },
+        { .id = 0x12300, .mask = 0xffff80, .isExtended = true },
+    };
+
+    // the duplicate goes without widening anything
+    uint8_t count = canFilterReduce(filters, 4, true, 2);
+    EXPECT_EQ(3, count);
+    EXPECT_FALSE(filters[0].isExtended);
+    EXPECT_TRUE(canFilterMatch(filters, count, 0x12300, true));
+    EXPECT_TRUE(canFilterMatch(filters, count, 0x12380, true));
+    EXPECT_FALSE(canFilterMatch(filters, count, 0x12400, true));
+
+    // then the pair differing in one bit drops only that bit
+    count = canFilterReduce(filters, count, true, 1);
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(0xffff00u, filters[1].mask);
+    EXPECT_TRUE(canFilterMatch(filters, count, 0x100, false));
+    EXPECT_FALSE(canFilterMatch(filters, count, 0x101, false));
+}
+
+TEST(CanFilterTest, EmptyListPassesEverything)
+{
+    EXPECT_TRUE(canFilterMatch(NULL, 0, 0x1234, true));
+    EXPECT_TRUE(canFilterMatch(NULL, 0, 0x123, false));
+}
@@ -32,6 +32,7 @@ extern "C" {
     #include "fc/runtime_config.h"
 
     #include "flight/flight_plan_nav.h"
+    #include "flight/geofence.h"
     #include "flight/imu.h"
     #include "flight/position_estimator.h"
     #include "flight/position_nav.h"
@@ -40,6 +41,7 @@ extern "C" {
 
     #include "pg/autopilot.h"
     #include "pg/flight_plan.h"
+    #include "pg/geofence.h"
     #include "pg/gps_rescue.h"
     #include "pg/pg.h"
 
@@ -76,6 +78,8 @@ vector3_t g_lastDispatchTargetEfM;   // destination from positionNavSetTargetEf
 int g_setTargetCalls;
 int g_clearTargetCalls;
 int g_moveTargetCalls;
+vector3_t g_pathVelEfMps;           // last positionNavSetPathVelocityEf() feedforward
+bool g_pathVelValid;
 
 gpsLocation_t g_stubGpsOrigin;
 bool g_stubGpsOriginSet;
@@ -112,6 +116,7 @@ void positionNavSetTargetEf(
     g_lastTarget.userData = userData;
     g_lastTarget.valid = true;
     g_setTargetCalls++;
+    g_pathVelValid = false;
 }
 
 void positionNavMoveTargetEf(const vector3_t *targetPosEfM)
@@ -123,6 +128,17 @@ void positionNavMoveTargetEf(const vector3_t *targetPosEfM)
     g_moveTargetCalls++;
 }
 
+void positionNavSetPathVelocityEf(const vector3_t *velEfMps)
+{
+    if (!g_lastTarget.valid) {
+        return;
+    }
+    g_pathVelValid = (velEfMps != NULL);
+    if (velEfMps != NULL) {
+        g_pathVelEfMps = *velEfMps;
+    }
+}
+
 void positionNavClearTarget(void)
 {
     g_clearTargetCalls++;
@@ -251,6 +267,8 @@ protected:
         g_setTargetCalls = 0;
         g_clearTargetCalls = 0;
         g_moveTargetCalls = 0;
+        g_pathVelValid = false;
+        memset(&g_pathVelEfMps, 0, sizeof(g_pathVelEfMps));
         g_stubMicros = 0;
 
         memset(&g_stubEstimate, 0, sizeof(g_stubEstimate));
@@ -306,6 +324,9 @@ protected:
         cfg->navCarrotLeadMax = 2500;      // 25 m
         cfg->navPreturnDist = 1500;        // 15 m
 
+        memset(geofenceConfigMutable(), 0, sizeof(geofenceConfig_t));
+        geofenceInit();
+
         flightPlanNavInit();
     }
 
@@ -935,7 +956,7 @@ TEST_F(FlightPlanNavTest, YawRateCapClearsOnDisengageAndEngage)
 
 namespace {
 int g_reachedCalls;
-void recordReached(uint8_t index) { (void)index; g_reachedCalls++; }
+void recordReached(uint16_t index) { (void)index; g_reachedCalls++; }
 } // namespace
 
 TEST_F(FlightPlanNavTest, InjectedPlanReplacesMissionAndRunsToTermination)
@@ -1329,6 +1350,54 @@ TEST_F(FlightPlanNavSafetyTest, GeofenceWithoutHomeFixDoesNothing)
     EXPECT_EQ(flightPlanNavGetState(), FP_NAV_TARGETING);
 }
 
+// 200 m square inclusion polygon centred on the origin
+static void setSquareInclusionFence(uint8_t lookaheadDs)
+{
+    const int32_t halfSide = 8983;   // 100 m in 1e-7 degrees at the equator
+    const int32_t corners[4][2] = {
+        { -halfSide, -halfSide }, { halfSide, -halfSide }, { halfSide, halfSide }, { -halfSide, halfSide },
+    };
+    geofenceConfig_t *fence = geofenceConfigMutable();
+    for (int i = 0; i < 4; i++) {
+        fence->items[i].type = GEOFENCE_POLYGON_INCLUSION;
+        fence->items[i].latitude = corners[i][0];
+        fence->items[i].longitude = corners[i][1];
+        fence->items[i].param = 4;
+    }
+    fence->itemCount = 4;
+    fence->lookaheadDs = lookaheadDs;
+    geofenceInvalidate();
+}
+
+TEST_F(FlightPlanNavSafetyTest, PolygonFencePredictedBreachLandsBeforeBoundary)
+{
+    autopilotConfigMutable()->geofenceAction = AP_GEOFENCE_LAND;
+    setSquareInclusionFence(30);
+    engageDistantLeg();
+
+    // 80 m north at 10 m/s: the boundary is 2 s away, inside the 3 s lookahead
+    g_stubEstimate.position.v[ENU_N] = 80.0f * 100.0f;
+    g_stubEstimate.velocity.v[ENU_N] = 10.0f * 100.0f;
+    flightPlanNavUpdate(g_stubMicros + 10'000);
+
+    EXPECT_EQ(flightPlanNavGetState(), FP_NAV_LANDING);
+    ASSERT_TRUE(g_lastTarget.valid);
+    EXPECT_NEAR(g_lastTarget.targetEfM.y, 80.0f, 0.1f);
+}
+
+TEST_F(FlightPlanNavSafetyTest, PolygonFenceSlowApproachDoesNothing)
+{
+    autopilotConfigMutable()->geofenceAction = AP_GEOFENCE_LAND;
+    setSquareInclusionFence(30);
+    engageDistantLeg();
+
+    g_stubEstimate.position.v[ENU_N] = 80.0f * 100.0f;
+    g_stubEstimate.velocity.v[ENU_N] = 2.0f * 100.0f;
+    flightPlanNavUpdate(g_stubMicros + 10'000);
+
+    EXPECT_EQ(flightPlanNavGetState(), FP_NAV_TARGETING);
+}
+
 TEST_F(FlightPlanNavSafetyTest, GeofenceBreachWithRthActionInjectsReturnPlan)
 {
     autopilotConfigMutable()->maxDistanceFromHomeM = 100;
@@ -1504,6 +1573,84 @@ TEST_F(FlightPlanNavSafetyTest, LandingQuietTimerResetsIfDescentResumes)
     EXPECT_EQ(g_disarmCalls, 1);
 }
 
+// --- Offboard external target ---
+
+TEST_F(FlightPlanNavSafetyTest, ExternalVelocityTimesOutToHold)
+{
+    engageDistantLeg();
+    const vector3_t pos = {{ 5.0f, 10.0f, 20.0f }};
+    const vector3_t vel = {{ 1.0f, 2.0f, 0.0f }};
+    ASSERT_TRUE(flightPlanNavSetExternalTarget(&pos, &vel, -1.0f, g_stubMicros));
+    EXPECT_TRUE(flightPlanNavIsExternalTargetActive());
+    EXPECT_TRUE(g_pathVelValid);
+    EXPECT_NEAR(g_lastTarget.targetEfM.y, 10.0f, 0.01f);
+
+    flightPlanNavUpdate(g_stubMicros + 400'000);
+    EXPECT_TRUE(g_pathVelValid);
+
+    // The stream went quiet: drop the feedforward and hold the last position
+    flightPlanNavUpdate(g_stubMicros + 500'000);
+    EXPECT_FALSE(g_pathVelValid);
+    EXPECT_TRUE(g_lastTarget.valid);
+    EXPECT_NEAR(g_lastTarget.targetEfM.x, 5.0f, 0.01f);
+    EXPECT_NEAR(g_lastTarget.targetEfM.y, 10.0f, 0.01f);
+    EXPECT_EQ(flightPlanNavGetState(), FP_NAV_TARGETING);
+    EXPECT_TRUE(flightPlanNavIsExternalTargetActive());
+}
+
+TEST_F(FlightPlanNavSafetyTest, GeofenceBreachEndsExternalTarget)
+{
+    autopilotConfigMutable()->maxDistanceFromHomeM = 100;
+    autopilotConfigMutable()->geofenceAction = AP_GEOFENCE_RTH;
+    stateFlags |= GPS_FIX_HOME;
+    engageDistantLeg();
+    const vector3_t pos = {{ 0.0f, 200.0f, 20.0f }};
+    ASSERT_TRUE(flightPlanNavSetExternalTarget(&pos, NULL, -1.0f, g_stubMicros));
+
+    GPS_distanceToHome = 150;
+    g_stubEstimate.position.v[ENU_N] = 150.0f * 100.0f;
+    flightPlanNavUpdate(g_stubMicros + 10'000);
+
+    // The return plan takes over and the stream can no longer steer
+    EXPECT_FALSE(flightPlanNavIsExternalTargetActive());
+    EXPECT_TRUE(flightPlanNavIsInjectedPlanActive());
+    EXPECT_NEAR(g_lastDispatchTargetEfM.y, 0.0f, 0.1f);
+    EXPECT_FALSE(flightPlanNavSetExternalTarget(&pos, NULL, -1.0f, g_stubMicros + 20'000));
+    EXPECT_NEAR(g_lastDispatchTargetEfM.y, 0.0f, 0.1f);
+}
+
+TEST_F(FlightPlanNavSafetyTest, EstimatorLossAbortsExternalTarget)
+{
+    engageDistantLeg();
+    const vector3_t pos = {{ 5.0f, 10.0f, 20.0f }};
+    ASSERT_TRUE(flightPlanNavSetExternalTarget(&pos, NULL, -1.0f, g_stubMicros));
+
+    g_stubValidXY = false;
+    flightPlanNavUpdate(g_stubMicros + 10'000);
+
+    EXPECT_EQ(flightPlanNavGetState(), FP_NAV_ABORTED);
+    EXPECT_EQ(flightPlanNavGetAbortReason(), FP_ABORT_ESTIMATOR);
+    EXPECT_FALSE(flightPlanNavIsExternalTargetActive());
+    EXPECT_FALSE(flightPlanNavSetExternalTarget(&pos, NULL, -1.0f, g_stubMicros + 20'000));
+}
+
+TEST_F(FlightPlanNavSafetyTest, ExternalTargetRejectedWhileInjectedPlanActive)
+{
+    engageDistantLeg();
+    const waypoint_t wp = makeWaypoint(100, 0, 15000, WAYPOINT_TYPE_FLYOVER);
+    ASSERT_TRUE(flightPlanNavInjectPlan(&wp, 1));
+    const int callsBefore = g_setTargetCalls;
+    const vector3_t lastTarget = g_lastDispatchTargetEfM;
+
+    const vector3_t pos = {{ 50.0f, 50.0f, 20.0f }};
+    EXPECT_FALSE(flightPlanNavSetExternalTarget(&pos, NULL, 90.0f, g_stubMicros));
+    EXPECT_FALSE(flightPlanNavIsExternalTargetActive());
+    EXPECT_EQ(g_setTargetCalls, callsBefore);
+    EXPECT_NEAR(g_lastDispatchTargetEfM.x, lastTarget.x, 0.01f);
+    EXPECT_NEAR(g_lastDispatchTargetEfM.y, lastTarget.y, 0.01f);
+    EXPECT_FALSE(g_navHeadingOverrideValid);
+}
+
 // --- Leg-line carrot tracking and turn-angle cornering ---
 
 class FlightPlanNavCarrotTest : public FlightPlanNavTest {
@@ -1777,6 +1924,183 @@ TEST_F(FlightPlanNavCarrotTest, ChaseLagCompensationCrossesGateNearCornerSpeed)
     EXPECT_LT(crossingSpeedMps, 4.3f);
 }
 
+// --- Smooth-path legs: corner fillets on a jerk-limited profile ---
+
+class FlightPlanNavPathTest : public FlightPlanNavCarrotTest {
+protected:
+    void SetUp() override {
+        FlightPlanNavCarrotTest::SetUp();
+        autopilotConfig_t *cfg = autopilotConfigMutable();
+        cfg->navPathMode = AP_NAV_PATH_SMOOTH;
+        cfg->navLateralAccel = 300;         // 3 m/s^2
+        cfg->navJerk = 500;                 // 5 m/s^3
+    }
+
+    struct Flight {
+        float timeS;
+        float maxCrossTrackM;               // from the drawn waypoint polyline
+        float rmsCrossTrackM;
+        float maxPathLateralAccelMps2;      // of the commanded path velocity
+        bool completed;
+    };
+
+    static float distanceToSegment(float e, float n, const float *a, const float *b) {
+        const float de = b[0] - a[0], dn = b[1] - a[1];
+        const float lenSq = de * de + dn * dn;
+        const float t = lenSq > 0.0f ? fminf(fmaxf(((e - a[0]) * de + (n - a[1]) * dn) / lenSq, 0.0f), 1.0f) : 0.0f;
+        return hypotf(e - (a[0] + t * de), n - (a[1] + t * dn));
+    }
+
+    // Flies `route` (metres E,N; the craft starts at the origin) to completion
+    // with a simple multirotor model standing in for the autopilot: the position
+    // anchor on the commanded target (error capped at 5 m, as the nav anchor is)
+    // plus positionNav's velocity as feedforward, through a first-order velocity
+    // response with a tilt-limited acceleration. Without a path velocity the
+    // feedforward is positionNav's approach law toward the target.
+    Flight fly(const float (*route)[2], int count, uint8_t pathMode) {
+        autopilotConfigMutable()->navPathMode = pathMode;
+        for (int i = 0; i < count; i++) {
+            addWaypointMetres(route[i][0], route[i][1], 15000, WAYPOINT_TYPE_FLYBY);
+        }
+        float polyline[MAX_WAYPOINTS + 1][2] = { { 0.0f, 0.0f } };
+        memcpy(&polyline[1], route, count * sizeof(route[0]));
+
+        const float dt = 0.05f;
+        const float kPos = 0.8f;
+        const float tauS = 0.4f;
+        const float maxAccelMps2 = 6.0f;
+        float pos[2] = { 0.0f, 0.0f };
+        float vel[2] = { 0.0f, 0.0f };
+        float prevFf[2] = { 0.0f, 0.0f };
+        bool prevFfValid = false;
+        Flight result = {};
+        float sumSq = 0.0f;
+        int samples = 0;
+
+        g_stubMicros = 1'000'000;
+        flightPlanNavEngage();
+        for (int i = 0; i < 12000 && flightPlanNavGetState() == FP_NAV_TARGETING; i++) {
+            const float errE = g_lastTarget.targetEfM.x - pos[0];
+            const float errN = g_lastTarget.targetEfM.y - pos[1];
+            const float dist = hypotf(errE, errN);
+            float ff[2];
+            if (g_pathVelValid) {
+                ff[0] = g_pathVelEfMps.x;
+                ff[1] = g_pathVelEfMps.y;
+                const float ffSpeed = hypotf(ff[0], ff[1]);
+                if (prevFfValid && ffSpeed > 1.0f) {
+                    const float dvE = (ff[0] - prevFf[0]) / dt, dvN = (ff[1] - prevFf[1]) / dt;
+                    result.maxPathLateralAccelMps2 = fmaxf(result.maxPathLateralAccelMps2,
+                                                           fabsf(ff[0] * dvN - ff[1] * dvE) / ffSpeed);
+                }
+                prevFf[0] = ff[0];
+                prevFf[1] = ff[1];
+                prevFfValid = true;
+            } else {
+                const float speed = fminf(g_lastTarget.cruiseSpeedMps, dist);
+                ff[0] = dist > 0.01f ? errE / dist * speed : 0.0f;
+                ff[1] = dist > 0.01f ? errN / dist * speed : 0.0f;
+                prevFfValid = false;
+            }
+            const float errScale = dist > 5.0f ? 5.0f / dist : 1.0f;
+            float accel[2] = {
+                (ff[0] + kPos * errE * errScale - vel[0]) / tauS,
+                (ff[1] + kPos * errN * errScale - vel[1]) / tauS,
+            };
+            const float accelMag = hypotf(accel[0], accel[1]);
+            if (accelMag > maxAccelMps2) {
+                accel[0] *= maxAccelMps2 / accelMag;
+                accel[1] *= maxAccelMps2 / accelMag;
+            }
+            for (int axis = 0; axis < 2; axis++) {
+                vel[axis] += accel[axis] * dt;
+                pos[axis] += vel[axis] * dt;
+            }
+            setCraftMetres(pos[0], pos[1]);
+            g_stubEstimate.velocity.v[ENU_E] = vel[0] * 100.0f;
+            g_stubEstimate.velocity.v[ENU_N] = vel[1] * 100.0f;
+            // Yaw follows the executor's nose override, else the ground course
+            // (VELOCITY mode), and turns instantly.
+            if (g_navHeadingOverrideValid) {
+                attitude.values.yaw = lrintf(fmodf(g_navHeadingOverrideDeg + 360.0f, 360.0f) * 10.0f);
+            } else if (hypotf(vel[0], vel[1]) > 1.0f) {
+                attitude.values.yaw = lrintf(fmodf(atan2f(vel[0], vel[1]) * 180.0f / M_PIf + 360.0f, 360.0f) * 10.0f);
+            }
+            step(50'000);
+            result.timeS += dt;
+
+            float crossTrackM = FLT_MAX;
+            for (int k = 0; k < count; k++) {
+                crossTrackM = fminf(crossTrackM, distanceToSegment(pos[0], pos[1], polyline[k], polyline[k + 1]));
+            }
+            result.maxCrossTrackM = fmaxf(result.maxCrossTrackM, crossTrackM);
+            sumSq += crossTrackM * crossTrackM;
+            samples++;
+
+            // The last leg is a point target that positionNav completes on radius entry
+            if (g_lastTarget.callback != nullptr
+                && hypotf(g_lastTarget.targetEfM.x - pos[0], g_lastTarget.targetEfM.y - pos[1]) < g_lastTarget.acceptanceRadiusM) {
+                triggerReached();
+            }
+        }
+        result.completed = flightPlanNavGetState() == FP_NAV_COMPLETE;
+        result.rmsCrossTrackM = samples > 0 ? sqrtf(sumSq / samples) : 0.0f;
+        return result;
+    }
+
+    Flight flyFresh(const float (*route)[2], int count, uint8_t pathMode) {
+        SetUp();
+        return fly(route, count, pathMode);
+    }
+};
+
+// Survey lawnmower: 100 m passes 20 m apart, two 90 degree corners per turn
+static const float lawnmower[][2] = {
+    { 0, 100 }, { 20, 100 }, { 20, 0 }, { 40, 0 }, { 40, 100 }, { 60, 100 }, { 60, 0 }, { 80, 0 }, { 80, 100 },
+};
+static const float squareRoute[][2] = { { 0, 100 }, { 100, 100 }, { 100, 0 }, { 0, 0 } };
+
+TEST_F(FlightPlanNavPathTest, SurveyPatternFlownFasterThanCarrot)
+{
+    const Flight smooth = flyFresh(lawnmower, ARRAYLEN(lawnmower), AP_NAV_PATH_SMOOTH);
+    const Flight carrot = flyFresh(lawnmower, ARRAYLEN(lawnmower), AP_NAV_PATH_CARROT);
+
+    ASSERT_TRUE(smooth.completed);
+    ASSERT_TRUE(carrot.completed);
+    EXPECT_LT(smooth.timeS, carrot.timeS);
+    // ap_nav_lateral_accel is 3 m/s^2; sampling the tangent adds a little
+    EXPECT_LT(smooth.maxPathLateralAccelMps2, 3.3f);
+    // 20 m cross legs leave no room to cut far inside the corners
+    EXPECT_LT(smooth.maxCrossTrackM, 3.0f);
+    EXPECT_LT(smooth.rmsCrossTrackM, 1.0f);
+}
+
+TEST_F(FlightPlanNavPathTest, SquarePatternFlownFasterThanCarrot)
+{
+    const Flight smooth = flyFresh(squareRoute, ARRAYLEN(squareRoute), AP_NAV_PATH_SMOOTH);
+    const Flight carrot = flyFresh(squareRoute, ARRAYLEN(squareRoute), AP_NAV_PATH_CARROT);
+
+    ASSERT_TRUE(smooth.completed);
+    ASSERT_TRUE(carrot.completed);
+    EXPECT_LT(smooth.timeS, carrot.timeS);
+    EXPECT_LT(smooth.maxPathLateralAccelMps2, 3.3f);
+    // 100 m legs leave the fillets room to cut the corners by design
+    EXPECT_LT(smooth.rmsCrossTrackM, 3.5f);
+}
+
+// Repeated waypoints are zero length legs, each passed as soon as it starts
+TEST_F(FlightPlanNavPathTest, RepeatedWaypointsAreFlownThrough)
+{
+    static const float route[][2] = {
+        { 0, 100 }, { 0, 100 }, { 0, 100 }, { 0, 100 }, { 0, 100 }, { 0, 100 }, { 100, 100 }, { 100, 100 }, { 100, 0 },
+    };
+    const Flight smooth = fly(route, ARRAYLEN(route), AP_NAV_PATH_SMOOTH);
+
+    ASSERT_TRUE(smooth.completed);
+    EXPECT_LT(smooth.maxCrossTrackM, 3.0f);
+    EXPECT_LT(smooth.rmsCrossTrackM, 1.0f);
+}
+
 // MAVLink MISSION_SET_CURRENT — flightPlanNavSetCurrentIndex().
 TEST_F(FlightPlanNavTest, SetCurrentIndexRejectsOutOfRange)
 {
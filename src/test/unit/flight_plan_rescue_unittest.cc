@@ -136,6 +136,11 @@ void positionNavMoveTargetEf(const vector3_t *targetPosEfM)
     g_lastTarget.targetEfM = *targetPosEfM;
 }
 
+void positionNavSetPathVelocityEf(const vector3_t *velEfMps)
+{
+    (void)velEfMps;
+}
+
 void positionNavClearTarget(void)
 {
     g_clearTargetCalls++;
@@ -0,0 +1,287 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Betaflight. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/axis.h"
+    #include "common/vector.h"
+
+    #include "flight/geofence.h"
+
+    #include "io/gps.h"
+
+    #include "pg/geofence.h"
+    #include "pg/pg.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// 1e-7 degree units per metre, flat earth at the equator
+static constexpr float UNITS_PER_M = 1.0e7f / 111319.49f;
+
+// --- Stubs ---
+
+namespace {
+gpsLocation_t g_origin;
+bool g_originSet;
+} // namespace
+
+extern "C" {
+
+bool positionEstimatorGetGpsOrigin(gpsLocation_t *out)
+{
+    if (!g_originSet) {
+        return false;
+    }
+    *out = g_origin;
+    return true;
+}
+
+void GPS_distance2d(const gpsLocation_t *from, const gpsLocation_t *to, vector2_t *distance)
+{
+    distance->v[EF_EAST] = (to->lon - from->lon) / UNITS_PER_M * 100.0f;
+    distance->v[EF_NORTH] = (to->lat - from->lat) / UNITS_PER_M * 100.0f;
+}
+
+} // extern "C"
+
+class GeofenceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        memset(geofenceConfigMutable(), 0, sizeof(geofenceConfig_t));
+        geofenceConfigMutable()->lookaheadDs = 30;
+        memset(&g_origin, 0, sizeof(g_origin));
+        g_originSet = true;
+        geofenceInit();
+    }
+
+    // vertices in metres East/North of the origin
+    void addPolygon(geofenceItemType_e type, const float (*vertices)[2], int count) {
+        geofenceConfig_t *cfg = geofenceConfigMutable();
+        for (int i = 0; i < count; i++) {
+            geofenceItem_t *item = &cfg->items[cfg->itemCount++];
+            item->type = type;
+            item->longitude = lrintf(vertices[i][0] * UNITS_PER_M);
+            item->latitude = lrintf(vertices[i][1] * UNITS_PER_M);
+            item->param = count;
+        }
+        geofenceInvalidate();
+    }
+
+    void addCircle(geofenceItemType_e type, float eastM, float northM, uint16_t radiusM) {
+        geofenceConfig_t *cfg = geofenceConfigMutable();
+        geofenceItem_t *item = &cfg->items[cfg->itemCount++];
+        item->type = type;
+        item->longitude = lrintf(eastM * UNITS_PER_M);
+        item->latitude = lrintf(northM * UNITS_PER_M);
+        item->param = radiusM;
+        geofenceInvalidate();
+    }
+
+    geofenceStatus_e check(float eastM, float northM, float velEastMs = 0.0f, float velNorthMs = 0.0f) {
+        const vector3_t position = {{ eastM * 100.0f, northM * 100.0f, 0.0f }};
+        const vector3_t velocity = {{ velEastMs * 100.0f, velNorthMs * 100.0f, 0.0f }};
+        return geofenceCheck(&position, &velocity);
+    }
+
+    float distanceM(float eastM, float northM) {
+        const vector3_t position = {{ eastM * 100.0f, northM * 100.0f, 0.0f }};
+        return geofenceDistanceToBoundaryCm(&position) * 0.01f;
+    }
+};
+
+static const float square[4][2] = { { -100, -100 }, { 100, -100 }, { 100, 100 }, { -100, 100 } };
+
+// A U shape open to the north: the notch between the arms is outside.
+static const float uShape[8][2] = {
+    { -100, -100 }, { 100, -100 }, { 100, 100 }, { 50, 100 },
+    { 50, -50 }, { -50, -50 }, { -50, 100 }, { -100, 100 },
+};
+
+// Plain ray casting over every edge, the reference for the banded index
+static bool referenceInside(const float (*vertices)[2], int count, float e, float n)
+{
+    bool inside = false;
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+        const float ei = vertices[i][0], ni = vertices[i][1];
+        const float ej = vertices[j][0], nj = vertices[j][1];
+        if ((ni > n) != (nj > n) && e < ei + (n - ni) * (ej - ei) / (nj - ni)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+TEST_F(GeofenceTest, ValidatesItemStructure)
+{
+    geofenceItem_t items[4] = {};
+    for (int i = 0; i < 3; i++) {
+        items[i].type = GEOFENCE_POLYGON_INCLUSION;
+        items[i].param = 3;
+    }
+    EXPECT_TRUE(geofenceItemsValid(items, 3));
+    EXPECT_FALSE(geofenceItemsValid(items, 2));         // vertices missing
+
+    items[1].type = GEOFENCE_POLYGON_EXCLUSION;
+    EXPECT_FALSE(geofenceItemsValid(items, 3));         // mixed polygon
+    items[1].type = GEOFENCE_POLYGON_INCLUSION;
+
+    for (int i = 0; i < 3; i++) {
+        items[i].param = 2;
+    }
+    EXPECT_FALSE(geofenceItemsValid(items, 2));         // not a polygon
+
+    items[0].type = GEOFENCE_CIRCLE_EXCLUSION;
+    items[0].param = 0;
+    EXPECT_FALSE(geofenceItemsValid(items, 1));         // circle without radius
+    items[0].type = GEOFENCE_RETURN_POINT;
+    EXPECT_TRUE(geofenceItemsValid(items, 1));
+    items[0].type = GEOFENCE_ITEM_TYPE_COUNT;
+    EXPECT_FALSE(geofenceItemsValid(items, 1));
+}
+
+TEST_F(GeofenceTest, ConcavePolygonMatchesPlainRayCasting)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, uShape, 8);
+
+    int mismatches = 0;
+    for (float n = -120.0f; n <= 120.0f; n += 2.5f) {
+        for (float e = -120.0f; e <= 120.0f; e += 2.5f) {
+            const bool inside = check(e, n) != GEOFENCE_BREACH;
+            // stay clear of the boundary itself, where rounding decides
+            bool nearEdge = false;
+            for (float de = -0.5f; de <= 0.5f; de += 0.5f) {
+                for (float dn = -0.5f; dn <= 0.5f; dn += 0.5f) {
+                    nearEdge |= referenceInside(uShape, 8, e + de, n + dn) != referenceInside(uShape, 8, e, n);
+                }
+            }
+            if (!nearEdge && inside != referenceInside(uShape, 8, e, n)) {
+                mismatches++;
+            }
+        }
+    }
+    EXPECT_EQ(0, mismatches);
+    EXPECT_EQ(GEOFENCE_BREACH, check(0, 50));       // in the notch
+    EXPECT_EQ(GEOFENCE_OK, check(75, 50));          // in an arm
+}
+
+TEST_F(GeofenceTest, ExclusionZoneInsideAnInclusionZone)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    const float building[4][2] = { { 10, 10 }, { 30, 10 }, { 30, 30 }, { 10, 30 } };
+    addPolygon(GEOFENCE_POLYGON_EXCLUSION, building, 4);
+
+    EXPECT_EQ(GEOFENCE_OK, check(0, 0));
+    EXPECT_EQ(GEOFENCE_BREACH, check(20, 20));
+    EXPECT_EQ(GEOFENCE_BREACH, check(150, 0));
+}
+
+TEST_F(GeofenceTest, CircleZones)
+{
+    addCircle(GEOFENCE_CIRCLE_INCLUSION, 0, 0, 200);
+    addCircle(GEOFENCE_CIRCLE_EXCLUSION, 100, 0, 20);
+
+    EXPECT_EQ(GEOFENCE_OK, check(0, 150));
+    EXPECT_EQ(GEOFENCE_BREACH, check(0, 250));
+    EXPECT_EQ(GEOFENCE_BREACH, check(110, 5));
+}
+
+TEST_F(GeofenceTest, DistanceToBoundary)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    addCircle(GEOFENCE_CIRCLE_EXCLUSION, 0, 0, 30);
+
+    EXPECT_NEAR(10.0f, distanceM(0, 90), 0.1f);     // north edge
+    EXPECT_NEAR(20.0f, distanceM(0, -50), 0.1f);    // circle rim
+    EXPECT_NEAR(5.0f, distanceM(-95, 0), 0.1f);     // west edge
+}
+
+TEST_F(GeofenceTest, PredictsBreachAlongVelocity)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+
+    EXPECT_EQ(GEOFENCE_BREACH_PREDICTED, check(0, 80, 0, 10));     // boundary 2 s ahead
+    EXPECT_EQ(GEOFENCE_OK, check(0, 80, 0, 5));                    // 15 m of travel, 20 m to go
+    EXPECT_EQ(GEOFENCE_OK, check(0, 80, 0, -10));                  // flying away from it
+    EXPECT_EQ(GEOFENCE_OK, check(0, 80, 10, 0));                   // parallel to it
+}
+
+TEST_F(GeofenceTest, PredictsCrossingAThinExclusionZone)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    const float wall[4][2] = { { -50, 40 }, { 50, 40 }, { 50, 42 }, { -50, 42 } };
+    addPolygon(GEOFENCE_POLYGON_EXCLUSION, wall, 4);
+
+    // both ends of the 3 s path are legal, the path is not
+    EXPECT_EQ(GEOFENCE_OK, check(0, 60));
+    EXPECT_EQ(GEOFENCE_BREACH_PREDICTED, check(0, 20, 0, 15));
+}
+
+TEST_F(GeofenceTest, PredictsEnteringAnExclusionCircle)
+{
+    addCircle(GEOFENCE_CIRCLE_EXCLUSION, 0, 50, 10);
+
+    EXPECT_EQ(GEOFENCE_BREACH_PREDICTED, check(0, 0, 0, 20));
+    EXPECT_EQ(GEOFENCE_OK, check(30, 0, 0, 20));
+}
+
+TEST_F(GeofenceTest, ZeroLookaheadOnlyReportsActualBreach)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    geofenceConfigMutable()->lookaheadDs = 0;
+
+    EXPECT_EQ(GEOFENCE_OK, check(0, 99, 0, 50));
+    EXPECT_EQ(GEOFENCE_BREACH, check(0, 101, 0, 50));
+}
+
+TEST_F(GeofenceTest, IndexFollowsTheEstimatorOrigin)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    ASSERT_EQ(GEOFENCE_OK, check(0, 0));
+
+    // re-armed 150 m further north: the fence stays put on the ground
+    g_origin.lat = lrintf(150.0f * UNITS_PER_M);
+
+    EXPECT_EQ(GEOFENCE_BREACH, check(0, 0));
+    EXPECT_EQ(GEOFENCE_OK, check(0, -150));
+}
+
+TEST_F(GeofenceTest, MalformedFenceIsNotEnforced)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    geofenceConfigMutable()->itemCount = 3;
+    geofenceInvalidate();
+
+    EXPECT_EQ(GEOFENCE_OK, check(500, 500));
+    EXPECT_LT(distanceM(0, 0), 0.0f);
+}
+
+TEST_F(GeofenceTest, NothingEnforcedWithoutOrigin)
+{
+    addPolygon(GEOFENCE_POLYGON_INCLUSION, square, 4);
+    g_originSet = false;
+
+    EXPECT_EQ(GEOFENCE_OK, check(500, 500));
+    EXPECT_LT(distanceM(0, 0), 0.0f);
+}
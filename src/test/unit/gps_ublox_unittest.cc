@@ -0,0 +1,328 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/debug.h"
+
+    #include "drivers/serial.h"
+
+    #include "io/gps.h"
+    #include "io/serial.h"
+
+    #include "pg/pg.h"
+    #include "pg/pg_ids.h"
+    #include "pg/gps.h"
+    #include "pg/gps_rescue.h"
+
+    #include "io/beeper.h"
+
+    #include "scheduler/scheduler.h"
+
+    #include "sensors/sensors.h"
+
+    PG_REGISTER(gpsConfig_t, gpsConfig, PG_GPS_CONFIG, 0);
+    PG_REGISTER(gpsRescueConfig_t, gpsRescueConfig, PG_GPS_RESCUE, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define UBX_NAV_PVT_PAYLOAD_SIZE 92
+
+static std::vector<uint8_t> rxStream;
+static size_t rxStreamPos;
+static size_t rxChunkSize;
+static serialPort_t stubGpsPort;
+static uint32_t navSolutionCount;
+
+static void appendUbxFrame(std::vector<uint8_t> &stream, uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length)
+{
+    const size_t start = stream.size();
+    stream.push_back(0xB5);
+    stream.push_back(0x62);
+    stream.push_back(msgClass);
+    stream.push_back(msgId);
+    stream.push_back(length & 0xff);
+    stream.push_back(length >> 8);
+    stream.insert(stream.end(), payload, payload + length);
+
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+    for (size_t i = start + 2; i < stream.size(); i++) {
+        checksumB += (checksumA += stream[i]);
+    }
+    stream.push_back(checksumA);
+    stream.push_back(checksumB);
+}
+
+static void put32(uint8_t *payload, int offset, int32_t value)
+{
+    memcpy(&payload[offset], &value, sizeof(value));
+}
+
+static void appendNavPvt(std::vector<uint8_t> &stream, uint32_t iTow, int32_t lat, int32_t lon, uint8_t numSv)
+{
+    uint8_t payload[UBX_NAV_PVT_PAYLOAD_SIZE] = { 0 };
+    put32(payload, 0, iTow);
+    payload[20] = 3;            // fixType: 3D
+    payload[21] = 0x01;         // flags: gnssFixOK
+    payload[23] = numSv;
+    put32(payload, 24, lon);
+    put32(payload, 28, lat);
+    put32(payload, 36, 123450); // hMSL, mm
+    put32(payload, 60, 5000);   // gSpeed, mm/s
+    payload[76] = 150;          // pDOP
+    appendUbxFrame(stream, 0x01, 0x07, payload, sizeof(payload));
+}
+
+static void appendNavSat(std::vector<uint8_t> &stream, uint8_t numSvs)
+{
+    uint8_t payload[8 + 12 * 32] = { 0 };
+    payload[5] = numSvs;
+    for (int i = 0; i < numSvs; i++) {
+        payload[8 + 12 * i + 1] = i + 1;    // svId
+        payload[8 + 12 * i + 2] = 40;       // cno
+    }
+    appendUbxFrame(stream, 0x01, 0x35, payload, 8 + 12 * numSvs);
+}
+
+static void replay(const std::vector<uint8_t> &stream, size_t chunkSize)
+{
+    rxStream = stream;
+    rxStreamPos = 0;
+    rxChunkSize = chunkSize;
+    while (rxStreamPos < rxStream.size()) {
+        gpsUpdate(0);
+    }
+    // parse whatever was left behind by the cycle budget
+    gpsUpdate(0);
+}
+
+class GpsUbloxTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        gpsConfigMutable()->provider = GPS_UBLOX;
+        gpsConfigMutable()->autoConfig = GPS_AUTOCONFIG_OFF;
+        gpsInit();
+        gpsData.state = GPS_STATE_RECEIVING_DATA;
+        memset(&gpsSol, 0, sizeof(gpsSol));
+        navSolutionCount = 0;
+    }
+};
+
+TEST_F(GpsUbloxTest, TestNavPvtDecodedFromBlock)
+{
+    std::vector<uint8_t> stream;
+    appendNavPvt(stream, 1000, 473977418, 85455939, 14);
+
+    replay(stream, stream.size());
+
+    EXPECT_EQ(1u, navSolutionCount);
+    EXPECT_EQ(473977418, gpsSol.llh.lat);
+    EXPECT_EQ(85455939, gpsSol.llh.lon);
+    EXPECT_EQ(12345, gpsSol.llh.altCm);
+    EXPECT_EQ(14, gpsSol.numSat);
+    EXPECT_EQ(500, gpsSol.groundSpeed);
+    EXPECT_EQ(150, gpsSol.dop.pdop);
+}
+
+TEST_F(GpsUbloxTest, TestFramesSplitAcrossReads)
+{
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 20; i++) {
+        appendNavSat(stream, 18);
+        appendNavPvt(stream, 1000 + 100 * i, 473977418 + i, 85455939 - i, 12);
+    }
+
+    // odd sized reads split every frame at a different place, and misalign every other payload
+    replay(stream, 37);
+
+    EXPECT_EQ(20u, navSolutionCount);
+    EXPECT_EQ(473977418 + 19, gpsSol.llh.lat);
+    EXPECT_EQ(85455939 - 19, gpsSol.llh.lon);
+    EXPECT_EQ(18, GPS_svinfo[17].svid);
+    EXPECT_EQ(40, GPS_svinfo[17].cno);
+    EXPECT_EQ(0, GPS_svinfo[18].cno);
+}
+
+TEST_F(GpsUbloxTest, TestResyncAfterGarbageAndBadChecksum)
+{
+    std::vector<uint8_t> stream = { 0x00, 0xB5, 0x00, 0xB5, 0xB5, 0x17 };
+    // a header with an unreasonable payload length
+    const uint8_t badLength[] = { 0xB5, 0x62, 0x01, 0x07, 0xff, 0xff };
+    stream.insert(stream.end(), badLength, badLength + sizeof(badLength));
+    appendNavPvt(stream, 1000, 100, 200, 5);
+    // corrupt a payload byte
+    stream[stream.size() - 40] ^= 0x55;
+    stream.push_back(0x17);
+    appendNavPvt(stream, 1100, 300, 400, 6);
+
+    replay(stream, 16);
+
+    EXPECT_EQ(1u, navSolutionCount);
+    EXPECT_EQ(300, gpsSol.llh.lat);
+    EXPECT_EQ(400, gpsSol.llh.lon);
+    EXPECT_EQ(6, gpsSol.numSat);
+}
+
+TEST_F(GpsUbloxTest, TestFramesInsideFalseHeaderAreRecovered)
+{
+    // a false preamble with a plausible 354 byte length swallows the frames that follow it
+    std::vector<uint8_t> stream = { 0xB5, 0x62, 0x01, 0xB5, 0x62, 0x01 };
+    for (int i = 0; i < 5; i++) {
+        appendNavPvt(stream, 1000 + 100 * i, 100 + i, 200 + i, 7);
+    }
+
+    replay(stream, 50);
+
+    // once the false frame fails its checksum the buffered frames are parsed again
+    EXPECT_EQ(5u, navSolutionCount);
+    EXPECT_EQ(104, gpsSol.llh.lat);
+    EXPECT_EQ(204, gpsSol.llh.lon);
+}
+
+TEST_F(GpsUbloxTest, TestBlockParserMatchesByteParser)
+{
+    // replay a 10Hz NAV-PVT + 1Hz NAV-SAT capture through both parsers
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 200; i++) {
+        if (i % 10 == 0) {
+            appendNavSat(stream, 24);
+        }
+        appendNavPvt(stream, 100 * i, 473977418 + 7 * i, 85455939 + 3 * i, 10 + i % 8);
+    }
+
+    const int iterations = 50;
+    const double bytes = (double)stream.size() * iterations;
+
+    // best of a few runs, so a preempted run doesn't decide the comparison
+    double byteParserNsPerByte = 0;
+    double blockParserNsPerByte = 0;
+    gpsSolutionData_t byteParserSol;
+    for (int run = 0; run < 3; run++) {
+        memset(&gpsSol, 0, sizeof(gpsSol));
+        navSolutionCount = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (uint8_t c : stream) {
+                gpsNewFrame(c);
+            }
+        }
+        const double byteNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / bytes;
+        byteParserSol = gpsSol;
+
+        memset(&gpsSol, 0, sizeof(gpsSol));
+        navSolutionCount = 0;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            replay(stream, 64);
+        }
+        const double blockNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / bytes;
+
+        byteParserNsPerByte = run ? MIN(byteParserNsPerByte, byteNs) : byteNs;
+        blockParserNsPerByte = run ? MIN(blockParserNsPerByte, blockNs) : blockNs;
+    }
+
+    EXPECT_EQ(200u * iterations, navSolutionCount);
+    EXPECT_EQ(byteParserSol.llh.lat, gpsSol.llh.lat);
+    EXPECT_EQ(byteParserSol.llh.lon, gpsSol.llh.lon);
+    EXPECT_EQ(byteParserSol.numSat, gpsSol.numSat);
+
+    RecordProperty("byte_parser_ns_per_byte", std::to_string(byteParserNsPerByte));
+    RecordProperty("block_parser_ns_per_byte", std::to_string(blockParserNsPerByte));
+    EXPECT_LE(blockParserNsPerByte, byteParserNsPerByte);
+}
+
+// STUBS
+
+extern "C" {
+    int16_t debug[DEBUG16_VALUE_COUNT];
+    uint8_t debugMode;
+    uint8_t armingFlags;
+    uint16_t flightModeFlags;
+    uint8_t stateFlags;
+
+    uint32_t millis(void) { return 0; }
+    uint32_t micros(void) { return 0; }
+    uint32_t getCycleCounter(void) { return 0; }
+    uint32_t clockMicrosToCycles(uint32_t micros) { return micros; }
+
+    const uint32_t baudRates[] = { 0, 9600, 19200, 38400, 57600, 115200, 230400, 250000, 400000 };
+    baudRate_e lookupBaudRateIndex(uint32_t) { return BAUD_115200; }
+
+    static const serialPortConfig_t stubGpsPortConfig = { .functionMask = FUNCTION_GPS, .identifier = SERIAL_PORT_USART1 };
+    const serialPortConfig_t *findSerialPortConfig(serialPortFunction_e) { return &stubGpsPortConfig; }
+    serialType_e serialType(serialPortIdentifier_e) { return SERIALTYPE_UART; }
+
+    bool featureIsEnabled(uint32_t) { return false; }
+    void beeper(beeperMode_e) {}
+    bool sensors(uint32_t) { return false; }
+    // called by gpsHandleFrameComplete() for every new navigation solution
+    void sensorsSet(uint32_t) { navSolutionCount++; }
+    void sensorsClear(uint32_t) {}
+    void rescheduleTask(taskId_e, timeDelta_t) {}
+    void schedulerSetNextStateTime(timeDelta_t) {}
+    uint32_t fnv_update(uint32_t hash, const void *, unsigned) { return hash; }
+
+    typedef enum {
+        DUMMY
+    } pageId_e;
+
+    void dashboardShowFixedPage(pageId_e) {}
+    void dashboardUpdate(timeUs_t) {}
+
+    serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, void *, uint32_t, portMode_e, portOptions_e)
+    {
+        return &stubGpsPort;
+    }
+
+    uint32_t serialRxBytesWaiting(const serialPort_t *)
+    {
+        return MIN(rxChunkSize, rxStream.size() - rxStreamPos);
+    }
+
+    uint8_t serialRead(serialPort_t *)
+    {
+        return rxStream[rxStreamPos++];
+    }
+
+    void serialWrite(serialPort_t *, uint8_t) {}
+    void serialWriteBuf(serialPort_t *, const uint8_t *, int) {}
+    void serialPrint(serialPort_t *, const char *) {}
+    void serialSetBaudRate(serialPort_t *, uint32_t) {}
+    uint32_t serialGetBaudRate(serialPort_t *) { return 115200; }
+    void serialSetMode(serialPort_t *, portMode_e) {}
+    bool isSerialTransmitBufferEmpty(const serialPort_t *) { return true; }
+    void waitForSerialPortToFinishTransmitting(serialPort_t *) {}
+    void serialPassthrough(serialPort_t *, serialPort_t *, serialConsumer *, serialConsumer *) {}
+}
@@ -16,6 +16,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 extern "C" {
     #include "common/huffman.h"
@@ -28,7 +29,8 @@ extern "C" {
 static uint8_t outBuf[OUTBUF_LEN];
 
 /*
- * Huffman Tree, used to decompress a bytestream.
+ * Huffman Tree, used to decompress a bytestream bit by bit. Kept as a
+ * reference for the table-driven huffmanDecodeBuf().
  *
  * The leaf nodes of the Huffman tree are stored in an array.
  */
@@ -319,7 +321,7 @@ void huffmanInitDecodeLenIndex(void)
     }
 }
 
-int huffmanDecodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inBufLen, int inBufCharacterCount, const huffmanTree_t *huffmanTree)
+int huffmanTreeDecodeBuf(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inBufLen, int inBufCharacterCount, const huffmanTree_t *huffmanTree)
 {
     static bool initialized = false;
     if (!initialized) {
@@ -510,7 +512,7 @@ TEST(HuffmanUnittest, TestHuffmanDecode)
     #define HUFF_BUF_LEN1 1
     #define HUFF_BUF_COUNT1 1
     const uint8_t inBuf1[HUFF_BUF_LEN1] = {0xc0}; // 11
-    len = huffmanDecodeBuf(outBuf, OUTBUF_LEN, inBuf1, HUFF_BUF_LEN1, HUFF_BUF_COUNT1, huffmanTree);
+    len = huffmanTreeDecodeBuf(outBuf, OUTBUF_LEN, inBuf1, HUFF_BUF_LEN1, HUFF_BUF_COUNT1, huffmanTree);
     EXPECT_EQ(1, len);
     EXPECT_EQ(0x00, (int)outBuf[0]);
     EXPECT_EQ(-1, huffManLenIndex[0]);
@@ -525,7 +527,7 @@ TEST(HuffmanUnittest, TestHuffmanDecode)
     #define HUFF_BUF_LEN2 1
     #define HUFF_BUF_COUNT2 3
     const uint8_t inBuf2[HUFF_BUF_LEN2] = {0xed}; // 11 101 101
-    len = huffmanDecodeBuf(outBuf, OUTBUF_LEN, inBuf2, HUFF_BUF_LEN2, HUFF_BUF_COUNT2, huffmanTree);
+    len = huffmanTreeDecodeBuf(outBuf, OUTBUF_LEN, inBuf2, HUFF_BUF_LEN2, HUFF_BUF_COUNT2, huffmanTree);
     EXPECT_EQ(3, len);
     EXPECT_EQ(0x00, (int)outBuf[0]);
     EXPECT_EQ(0x01, (int)outBuf[1]);
@@ -534,7 +536,7 @@ TEST(HuffmanUnittest, TestHuffmanDecode)
     #define HUFF_BUF_LEN3 5
     #define HUFF_BUF_COUNT3 8
     const uint8_t inBuf3[HUFF_BUF_LEN3] = {0xec, 0xc6, 0x0e, 0xb8, 0xd8};
-    len = huffmanDecodeBuf(outBuf, OUTBUF_LEN, inBuf3, HUFF_BUF_LEN3, HUFF_BUF_COUNT3, huffmanTree);
+    len = huffmanTreeDecodeBuf(outBuf, OUTBUF_LEN, inBuf3, HUFF_BUF_LEN3, HUFF_BUF_COUNT3, huffmanTree);
     EXPECT_EQ(8, len);
     EXPECT_EQ(0x00, (int)outBuf[0]);
     EXPECT_EQ(0x01, (int)outBuf[1]);
@@ -546,6 +548,147 @@ TEST(HuffmanUnittest, TestHuffmanDecode)
     EXPECT_EQ(0x07, (int)outBuf[7]);
 }
 
+TEST(HuffmanUnittest, TestHuffmanDecodeTable)
+{
+    static huffmanDecodeTable_t decodeTable;
+    EXPECT_TRUE(huffmanBuildDecodeTable(&decodeTable, huffmanTable));
+
+    // every code in the tree decodes to its character, from the first bits
+    for (int ii = 0; ii < HUFFMAN_TREE_SIZE; ++ii) {
+        const int shift = HUFFMAN_CODE_LEN_MAX - huffmanTree[ii].codeLen;
+        const huffmanDecodeEntry_t *entry = &decodeTable.entries[huffmanTree[ii].code << shift];
+        EXPECT_EQ(huffmanTree[ii].codeLen, entry->codeLen);
+        EXPECT_EQ(huffmanTree[ii].value == HUFFMAN_EOF ? HUFFMAN_EOF_SYMBOL : huffmanTree[ii].value, entry->symbol);
+    }
+
+    const uint8_t inBuf[] = {0xec, 0xc6, 0x0e, 0xb8, 0xd8};
+    int len = huffmanDecodeBuf(outBuf, OUTBUF_LEN, inBuf, sizeof(inBuf), 8, &decodeTable);
+    EXPECT_EQ(8, len);
+    for (int ii = 0; ii < 8; ++ii) {
+        EXPECT_EQ(ii, (int)outBuf[ii]);
+    }
+
+    // input ends inside a code
+    len = huffmanDecodeBuf(outBuf, OUTBUF_LEN, inBuf, 2, 8, &decodeTable);
+    EXPECT_EQ(-1, len);
+
+    // output too small
+    len = huffmanDecodeBuf(outBuf, 4, inBuf, sizeof(inBuf), 8, &decodeTable);
+    EXPECT_EQ(-1, len);
+
+    // EOF is 000000000000
+    const uint8_t eofBuf[] = {0xc0, 0x00, 0x00};
+    len = huffmanDecodeBuf(outBuf, OUTBUF_LEN, eofBuf, sizeof(eofBuf), 3, &decodeTable);
+    EXPECT_EQ(1, len);
+    EXPECT_EQ(0x00, (int)outBuf[0]);
+
+    // two characters with the same code
+    huffmanTable_t badTable[HUFFMAN_TABLE_SIZE];
+    memcpy(badTable, huffmanTable, sizeof(badTable));
+    badTable[1] = badTable[0];
+    EXPECT_FALSE(huffmanBuildDecodeTable(&decodeTable, badTable));
+}
+
+// Every character, then bytes from a simple generator that favours small
+// values the way blackbox logs do
+static void fillTestData(uint8_t *data, int len)
+{
+    uint32_t seed = 12345;
+    for (int ii = 0; ii < len; ++ii) {
+        if (ii < 256) {
+            data[ii] = ii;
+        } else {
+            seed = seed * 1103515245 + 12345;
+            const uint8_t value = seed >> 16;
+            data[ii] = (seed & 0x80000000) ? value : value & 0x0f;
+        }
+    }
+}
+
+TEST(HuffmanUnittest, TestHuffmanRoundTrip)
+{
+    static huffmanDecodeTable_t decodeTable;
+    ASSERT_TRUE(huffmanBuildDecodeTable(&decodeTable, huffmanTable));
+
+    #define ROUND_TRIP_LEN 4096
+    static uint8_t inBuf[ROUND_TRIP_LEN];
+    static uint8_t encoded[ROUND_TRIP_LEN * 2];
+    static uint8_t decoded[ROUND_TRIP_LEN];
+    static uint8_t treeDecoded[ROUND_TRIP_LEN];
+    fillTestData(inBuf, ROUND_TRIP_LEN);
+
+    for (int len = 0; len <= ROUND_TRIP_LEN; len += (len < 300 ? 1 : 509)) {
+        const int encodedLen = huffmanEncodeBuf(encoded, sizeof(encoded), inBuf, len, huffmanTable);
+        ASSERT_GE(encodedLen, 0);
+
+        memset(decoded, 0, sizeof(decoded));
+        ASSERT_EQ(len, huffmanDecodeBuf(decoded, sizeof(decoded), encoded, encodedLen, len, &decodeTable)) << "len " << len;
+        ASSERT_EQ(0, memcmp(inBuf, decoded, len)) << "len " << len;
+
+        // the bit by bit decoder agrees
+        if (len > 0) {
+            ASSERT_EQ(len, huffmanTreeDecodeBuf(treeDecoded, sizeof(treeDecoded), encoded, encodedLen, len, huffmanTree));
+            ASSERT_EQ(0, memcmp(inBuf, treeDecoded, len)) << "len " << len;
+        }
+    }
+}
+
+TEST(HuffmanUnittest, TestHuffmanStreamingMatchesOneShot)
+{
+    #define STREAMING_LEN 1000
+    static uint8_t inBuf[STREAMING_LEN];
+    static uint8_t oneShot[STREAMING_LEN * 2];
+    static uint8_t streamed[STREAMING_LEN * 2];
+    fillTestData(inBuf, STREAMING_LEN);
+
+    const int oneShotLen = huffmanEncodeBuf(oneShot, sizeof(oneShot), inBuf, STREAMING_LEN, huffmanTable);
+    ASSERT_GT(oneShotLen, 0);
+
+    for (int chunk = 1; chunk <= 257; chunk += 16) {
+        memset(streamed, 0xff, sizeof(streamed));
+        huffmanState_t state = {
+            .outByte = streamed,
+            .bytesWritten = 0,
+            .outBufLen = sizeof(streamed),
+            .outBit = 0x80,
+        };
+        *state.outByte = 0;
+        for (int pos = 0; pos < STREAMING_LEN; pos += chunk) {
+            const int len = pos + chunk > STREAMING_LEN ? STREAMING_LEN - pos : chunk;
+            ASSERT_EQ(0, huffmanEncodeBufStreaming(&state, inBuf + pos, len, huffmanTable));
+        }
+        if (state.outBit != 0x80) {
+            ++state.bytesWritten;
+        }
+        EXPECT_EQ(oneShotLen, state.bytesWritten) << "chunk " << chunk;
+        EXPECT_EQ(0, memcmp(oneShot, streamed, oneShotLen)) << "chunk " << chunk;
+    }
+}
+
+TEST(HuffmanUnittest, TestHuffmanEncodeOverflow)
+{
+    // 11 101 1001 10001 needs 2 bytes
+    const uint8_t inBuf[] = {0,1,2,3};
+    EXPECT_EQ(-1, huffmanEncodeBuf(outBuf, 1, inBuf, sizeof(inBuf), huffmanTable));
+    EXPECT_EQ(2, huffmanEncodeBuf(outBuf, 2, inBuf, sizeof(inBuf), huffmanTable));
+
+    // a chunk that doesn't fit leaves the stream as it was, so the reply
+    // holds whole chunks only
+    huffmanState_t state = {
+        .outByte = outBuf,
+        .bytesWritten = 0,
+        .outBufLen = 2,
+        .outBit = 0x80,
+    };
+    *state.outByte = 0;
+    EXPECT_EQ(0, huffmanEncodeBufStreaming(&state, inBuf, 2, huffmanTable)); // 11 101
+    EXPECT_EQ(-1, huffmanEncodeBufStreaming(&state, inBuf, sizeof(inBuf), huffmanTable));
+    EXPECT_EQ(outBuf, state.outByte);
+    EXPECT_EQ(0, state.bytesWritten);
+    EXPECT_EQ(0x04, state.outBit);
+    EXPECT_EQ(0xe8, (int)outBuf[0]);
+}
+
 // STUBS
 
 extern "C" {
@@ -39,6 +39,7 @@ extern "C" {
     #include "flight/flight_plan_nav.h"
     #include "io/gps.h"
     #include "pg/flight_plan.h"
+    #include "pg/geofence.h"
     #include "telemetry/mavlink.h"
     #include "telemetry/mavlink_mission.h"
 
@@ -55,16 +56,20 @@ extern "C" {
     static int saveCount;
     void saveConfigAndNotify(void) { saveCount++; }
 
+    // --- geofence index: no estimator origin, the fence is stored but not built ---
+    bool positionEstimatorGetGpsOrigin(gpsLocation_t *) { return false; }
+    void GPS_distance2d(const gpsLocation_t *, const gpsLocation_t *, vector2_t *) {}
+
     // --- flight-plan nav stubs ---
     static bool     navActive;
-    static uint8_t  navCurrentIndex;
+    static uint16_t navCurrentIndex;
     static bool     navSetResult;          // value returned by SetCurrentIndex
     static int      navSetIndexArg;        // arg captured (-1 if not called)
     bool flightPlanNavIsActive(void) { return navActive; }
-    uint8_t flightPlanNavGetCurrentIndex(void) { return navCurrentIndex; }
+    uint16_t flightPlanNavGetCurrentIndex(void) { return navCurrentIndex; }
     flightPlanNavState_e flightPlanNavGetState(void) { return FP_NAV_TARGETING; }
     void flightPlanNavSetReachedListener(flightPlanWaypointReachedFn) {}
-    bool flightPlanNavSetCurrentIndex(uint8_t index) {
+    bool flightPlanNavSetCurrentIndex(uint16_t index) {
         navSetIndexArg = index;
         return navSetResult;
     }
@@ -103,6 +108,7 @@ protected:
         navSetIndexArg = -1;
 
         memset(flightPlanConfigMutable(), 0, sizeof(flightPlanConfig_t));
+        memset(geofenceConfigMutable(), 0, sizeof(geofenceConfig_t));
 
         mavMissionInit();
     }
@@ -157,7 +163,7 @@ protected:
 // --- Geofence upload + download round-trip ---
 TEST_F(MavMissionTest, FenceUploadThenDownloadRoundTrips)
 {
-    sendCount(2, MAV_MISSION_TYPE_FENCE);
+    sendCount(4, MAV_MISSION_TYPE_FENCE);
     // FC should request item 0 of the fence.
     const mavlink_message_t *req = lastOf(MAVLINK_MSG_ID_MISSION_REQUEST_INT);
     ASSERT_NE(req, nullptr);
@@ -166,11 +172,19 @@ TEST_F(MavMissionTest, FenceUploadThenDownloadRoundTrips)
     EXPECT_EQ(r.seq, 0);
     EXPECT_EQ(r.mission_type, MAV_MISSION_TYPE_FENCE);
 
-    sendItem(0, MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION, MAV_MISSION_TYPE_FENCE, 100, 200, 4.0f);
-    sendItem(1, MAV_CMD_NAV_FENCE_CIRCLE_INCLUSION, MAV_MISSION_TYPE_FENCE, 300, 400, 25.0f);
+    sendItem(0, MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION, MAV_MISSION_TYPE_FENCE, 100, 200, 3.0f);
+    EXPECT_EQ(geofenceConfig()->itemCount, 0); // staged until the upload completes
+    sendItem(1, MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION, MAV_MISSION_TYPE_FENCE, 100, 900, 3.0f);
+    sendItem(2, MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION, MAV_MISSION_TYPE_FENCE, 700, 500, 3.0f);
+    sendItem(3, MAV_CMD_NAV_FENCE_CIRCLE_INCLUSION, MAV_MISSION_TYPE_FENCE, 300, 400, 25.0f);
 
     EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
-    EXPECT_EQ(saveCount, 0); // fence is RAM-only; must not thrash flash
+    EXPECT_EQ(saveCount, 1); // the fence is enforced, so it is persisted once
+    ASSERT_EQ(geofenceConfig()->itemCount, 4);
+    EXPECT_EQ(geofenceConfig()->items[2].type, GEOFENCE_POLYGON_INCLUSION);
+    EXPECT_EQ(geofenceConfig()->items[2].param, 3);
+    EXPECT_EQ(geofenceConfig()->items[3].type, GEOFENCE_CIRCLE_INCLUSION);
+    EXPECT_EQ(geofenceConfig()->items[3].param, 25);
 
     // Download: request the fence back.
     sent.clear();
@@ -179,12 +193,13 @@ TEST_F(MavMissionTest, FenceUploadThenDownloadRoundTrips)
     ASSERT_NE(cm, nullptr);
     mavlink_mission_count_t mc;
     mavlink_msg_mission_count_decode(cm, &mc);
-    EXPECT_EQ(mc.count, 2);
+    EXPECT_EQ(mc.count, 4);
     EXPECT_EQ(mc.mission_type, MAV_MISSION_TYPE_FENCE);
 
-    // Download requests are sequential: ask for seq 0 first, then seq 1.
-    sendRequestInt(0, MAV_MISSION_TYPE_FENCE);
-    sendRequestInt(1, MAV_MISSION_TYPE_FENCE);
+    // Download requests are sequential.
+    for (uint16_t seq = 0; seq < 4; seq++) {
+        sendRequestInt(seq, MAV_MISSION_TYPE_FENCE);
+    }
     const mavlink_message_t *im = lastOf(MAVLINK_MSG_ID_MISSION_ITEM_INT);
     ASSERT_NE(im, nullptr);
     mavlink_mission_item_int_t it;
@@ -205,10 +220,36 @@ TEST_F(MavMissionTest, FenceUploadRejectsNonFenceCommand)
 
 TEST_F(MavMissionTest, FenceUploadRejectsOverCapacity)
 {
-    sendCount(100, MAV_MISSION_TYPE_FENCE); // exceeds MAX_FENCE_POINTS
+    sendCount(100, MAV_MISSION_TYPE_FENCE); // exceeds MAX_GEOFENCE_ITEMS
     EXPECT_EQ(lastAckResult(), MAV_MISSION_NO_SPACE);
 }
 
+TEST_F(MavMissionTest, MalformedPolygonKeepsPreviousFence)
+{
+    sendCount(1, MAV_MISSION_TYPE_FENCE);
+    sendItem(0, MAV_CMD_NAV_FENCE_CIRCLE_EXCLUSION, MAV_MISSION_TYPE_FENCE, 10, 20, 50.0f);
+    ASSERT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+
+    // claims four vertices but only sends two
+    sendCount(2, MAV_MISSION_TYPE_FENCE);
+    sendItem(0, MAV_CMD_NAV_FENCE_POLYGON_VERTEX_EXCLUSION, MAV_MISSION_TYPE_FENCE, 100, 200, 4.0f);
+    sendItem(1, MAV_CMD_NAV_FENCE_POLYGON_VERTEX_EXCLUSION, MAV_MISSION_TYPE_FENCE, 300, 400, 4.0f);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_INVALID);
+    ASSERT_EQ(geofenceConfig()->itemCount, 1);
+    EXPECT_EQ(geofenceConfig()->items[0].type, GEOFENCE_CIRCLE_EXCLUSION);
+}
+
+TEST_F(MavMissionTest, FenceNotReplacedWhileFlyingPlan)
+{
+    flightModeFlags = AUTOPILOT_MODE;
+
+    sendCount(1, MAV_MISSION_TYPE_FENCE);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_DENIED);
+    EXPECT_EQ(lastOf(MAVLINK_MSG_ID_MISSION_REQUEST_INT), nullptr);
+}
+
 // --- MISSION_SET_CURRENT ---
 TEST_F(MavMissionTest, SetCurrentValidEmitsMissionCurrent)
 {
@@ -0,0 +1,228 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "platform.h"
+
+#include "telemetry/mavlink_scheduler.h"
+}
+
+static const uint32_t tickUs = 1000;
+
+// Run the schedule like handleMAVLinkTelemetry does, once a millisecond,
+// with every message going out at the size it was planned at. Returns the
+// total bytes sent and counts the messages per stream.
+static uint32_t runFor(mavlinkScheduler_t *scheduler, timeUs_t *nowUs, uint32_t durationUs, uint32_t *sent)
+{
+    uint32_t bytes = 0;
+    for (uint32_t elapsed = 0; elapsed < durationUs; elapsed += tickUs) {
+        int index;
+        while ((index = mavlinkSchedulerNext(scheduler, *nowUs, 1024)) >= 0) {
+            const uint16_t size = scheduler->streams[index].bytes;
+            mavlinkSchedulerSent(scheduler, index, size, *nowUs);
+            if (sent) {
+                sent[index]++;
+            }
+            bytes += size;
+        }
+        *nowUs += tickUs;
+    }
+    return bytes;
+}
+
+// Three streams, one per priority, each 50 bytes every intervalUs
+static void addThreeStreams(mavlinkScheduler_t *scheduler, uint32_t intervalUs, timeUs_t nowUs)
+{
+    mavlinkSchedulerAddStream(scheduler, 50, MAVLINK_PRIORITY_HIGH);
+    mavlinkSchedulerAddStream(scheduler, 50, MAVLINK_PRIORITY_NORMAL);
+    mavlinkSchedulerAddStream(scheduler, 50, MAVLINK_PRIORITY_LOW);
+    for (int i = 0; i < 3; i++) {
+        mavlinkSchedulerSetInterval(scheduler, i, intervalUs, nowUs);
+    }
+}
+
+TEST(MavlinkSchedulerTest, WithinBudgetEveryStreamGetsItsRate)
+{
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 115200, nowUs);
+    addThreeStreams(&scheduler, 20000, nowUs);
+
+    uint32_t sent[3] = { 0 };
+    runFor(&scheduler, &nowUs, 2000000, sent);
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(20000u, scheduler.streams[i].grantedIntervalUs);
+        EXPECT_NEAR(100, (int)sent[i], 1);
+        EXPECT_EQ(500, mavlinkSchedulerRequestedRate(&scheduler, i));
+        EXPECT_NEAR(500, mavlinkSchedulerAchievedRate(&scheduler, i), 10);
+    }
+}
+
+TEST(MavlinkSchedulerTest, LowPriorityGivesWayFirst)
+{
+    // 12572 baud leaves 1100 B/s for streams asking for 3 x 500 B/s: high
+    // and normal keep their rate, low gets the remaining 100 B/s
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 12572, nowUs);
+    addThreeStreams(&scheduler, 100000, nowUs);
+
+    uint32_t sent[3] = { 0 };
+    runFor(&scheduler, &nowUs, 10000000, sent);
+
+    EXPECT_EQ(100000u, scheduler.streams[0].grantedIntervalUs);
+    EXPECT_EQ(100000u, scheduler.streams[1].grantedIntervalUs);
+    EXPECT_NEAR(500000, (int)scheduler.streams[2].grantedIntervalUs, 1000);
+    EXPECT_NEAR(100, (int)sent[0], 1);
+    EXPECT_NEAR(100, (int)sent[1], 1);
+    EXPECT_NEAR(20, (int)sent[2], 1);
+}
+
+TEST(MavlinkSchedulerTest, HighPriorityGivesWayLast)
+{
+    // 700 B/s for streams: high keeps its rate, normal gets what is left
+    // after low's floor, low sits at its floor
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 8000, nowUs);
+    addThreeStreams(&scheduler, 100000, nowUs);
+
+    uint32_t sent[3] = { 0 };
+    const uint32_t bytes = runFor(&scheduler, &nowUs, 10000000, sent);
+
+    EXPECT_LE(bytes, 800u * 10 + 280);
+    EXPECT_EQ(100000u, scheduler.streams[0].grantedIntervalUs);
+    EXPECT_NEAR(363636, (int)scheduler.streams[1].grantedIntervalUs, 1000);
+    EXPECT_EQ(800000u, scheduler.streams[2].grantedIntervalUs);
+    EXPECT_GT(sent[0], sent[1]);
+    EXPECT_GT(sent[1], sent[2]);
+}
+
+TEST(MavlinkSchedulerTest, RadioBackPressureBacksOffAndRecovers)
+{
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 57600, nowUs);
+    EXPECT_EQ(5760u, scheduler.budgetBytesPerSec);
+
+    // Radio buffer filling up: multiplicative decrease, down to a floor
+    mavlinkSchedulerRadioStatus(&scheduler, 20, 35);
+    EXPECT_EQ(4320u, scheduler.budgetBytesPerSec);
+    for (int i = 0; i < 50; i++) {
+        mavlinkSchedulerRadioStatus(&scheduler, 20, 35);
+    }
+    EXPECT_EQ(360u, scheduler.budgetBytesPerSec);
+
+    // Between the threshold and the midpoint to full: hold
+    mavlinkSchedulerRadioStatus(&scheduler, 50, 35);
+    EXPECT_EQ(360u, scheduler.budgetBytesPerSec);
+
+    // Plenty of room: additive increase, capped at the serial rate
+    mavlinkSchedulerRadioStatus(&scheduler, 90, 35);
+    EXPECT_EQ(360u + 180u, scheduler.budgetBytesPerSec);
+    for (int i = 0; i < 50; i++) {
+        mavlinkSchedulerRadioStatus(&scheduler, 90, 35);
+    }
+    EXPECT_EQ(5760u, scheduler.budgetBytesPerSec);
+}
+
+TEST(MavlinkSchedulerTest, BackOffSlowsTheStreams)
+{
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 57600, nowUs);
+    addThreeStreams(&scheduler, 100000, nowUs);
+    runFor(&scheduler, &nowUs, 100000, NULL);
+    EXPECT_EQ(100000u, scheduler.streams[2].grantedIntervalUs);
+
+    for (int i = 0; i < 10; i++) {
+        mavlinkSchedulerRadioStatus(&scheduler, 0, 35);
+    }
+    uint32_t sent[3] = { 0 };
+    const uint32_t bytes = runFor(&scheduler, &nowUs, 5000000, sent);
+
+    EXPECT_GT(scheduler.streams[2].grantedIntervalUs, 100000u);
+    EXPECT_LE(bytes, scheduler.budgetBytesPerSec * 5 + 280);
+}
+
+TEST(MavlinkSchedulerTest, OffScheduleTrafficIsCharged)
+{
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 9600, nowUs);
+    mavlinkSchedulerAddStream(&scheduler, 50, MAVLINK_PRIORITY_HIGH);
+    mavlinkSchedulerSetInterval(&scheduler, 0, 100000, nowUs);
+
+    // A parameter download eats the burst and then some: the stream waits
+    // for the budget to refill
+    mavlinkSchedulerCharge(&scheduler, 600);
+    nowUs += 200000;
+    EXPECT_EQ(-1, mavlinkSchedulerNext(&scheduler, nowUs, 1024));
+    nowUs += 400000;
+    EXPECT_EQ(0, mavlinkSchedulerNext(&scheduler, nowUs, 1024));
+
+    // Nor does it go out when the serial buffer has no room for it
+    EXPECT_EQ(-1, mavlinkSchedulerNext(&scheduler, nowUs, 49));
+}
+
+TEST(MavlinkSchedulerTest, LearnsMessageSizeFromWhatWasSent)
+{
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 9600, nowUs);
+    mavlinkSchedulerAddStream(&scheduler, 20, MAVLINK_PRIORITY_HIGH);
+    mavlinkSchedulerSetInterval(&scheduler, 0, 40000, nowUs);
+
+    // 20 B at 25 Hz fits in 840 B/s; the real 60 B does not
+    runFor(&scheduler, &nowUs, 100000, NULL);
+    EXPECT_EQ(40000u, scheduler.streams[0].grantedIntervalUs);
+
+    const int index = mavlinkSchedulerNext(&scheduler, nowUs + 40000, 1024);
+    ASSERT_EQ(0, index);
+    mavlinkSchedulerSent(&scheduler, index, 60, nowUs + 40000);
+    nowUs += 40000;
+    runFor(&scheduler, &nowUs, 1000, NULL);
+
+    EXPECT_EQ(60, scheduler.streams[0].bytes);
+    EXPECT_NEAR(60.0 * 1e6 / 840, scheduler.streams[0].grantedIntervalUs, 100);
+}
+
+TEST(MavlinkSchedulerTest, DisabledStreamIsNeverSent)
+{
+    mavlinkScheduler_t scheduler;
+    timeUs_t nowUs = 1000000;
+    mavlinkSchedulerInit(&scheduler, 115200, nowUs);
+    addThreeStreams(&scheduler, 20000, nowUs);
+    mavlinkSchedulerSetInterval(&scheduler, 1, 0, nowUs);
+
+    uint32_t sent[3] = { 0 };
+    runFor(&scheduler, &nowUs, 1000000, sent);
+
+    EXPECT_EQ(0u, sent[1]);
+    EXPECT_EQ(0, mavlinkSchedulerRequestedRate(&scheduler, 1));
+    EXPECT_NEAR(50, (int)sent[0], 1);
+}
@@ -0,0 +1,329 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Betaflight. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "drivers/flash/flash.h"
+
+    #include "flight/mission_store.h"
+
+    #include "pg/flight_plan.h"
+    #include "pg/pg.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// --- Fake flash: 4 KiB sectors, 256 byte pages, mission partition in sectors 16..31 ---
+
+namespace {
+constexpr uint32_t SECTOR_SIZE = 4096;
+constexpr uint16_t PAGE_SIZE = 256;
+constexpr uint32_t SECTOR_COUNT = 32;
+constexpr uint32_t PARTITION_START = 16;
+
+uint8_t g_flash[SECTOR_SIZE * SECTOR_COUNT];
+flashGeometry_t g_geometry;
+flashPartition_t g_partition;
+bool g_partitionPresent;
+int g_readCalls;
+int g_eraseCalls;
+int g_busyPolls;    // flashIsReady() polls left before an erase completes
+} // namespace
+
+extern "C" {
+
+flashPartition_t *flashPartitionFindByType(flashPartitionType_e type)
+{
+    return (g_partitionPresent && type == FLASH_PARTITION_TYPE_MISSION) ? &g_partition : NULL;
+}
+
+const flashGeometry_t *flashGetGeometry(void)
+{
+    return &g_geometry;
+}
+
+void flashEraseSector(uint32_t address)
+{
+    g_eraseCalls++;
+    g_busyPolls = 3;
+    memset(&g_flash[address - address % SECTOR_SIZE], 0xff, SECTOR_SIZE);
+}
+
+bool flashIsReady(void)
+{
+    if (g_busyPolls > 0) {
+        g_busyPolls--;
+        return false;
+    }
+    return true;
+}
+
+// NOR semantics: programming can only clear bits
+void flashPageProgram(uint32_t address, const uint8_t *data, uint32_t length, void (*callback)(uintptr_t arg))
+{
+    UNUSED(callback);
+    for (uint32_t i = 0; i < length; i++) {
+        g_flash[address + i] &= data[i];
+    }
+}
+
+int flashReadBytes(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    g_readCalls++;
+    if (address + length > sizeof(g_flash)) {
+        return 0;
+    }
+    memcpy(buffer, &g_flash[address], length);
+    return length;
+}
+
+void flashFlush(void) {}
+
+} // extern "C"
+
+static waypoint_t makeWaypoint(uint16_t i)
+{
+    waypoint_t wp;
+    wp.latitude = 473977000 + i * 13;
+    wp.longitude = -85455000 - i * 7;
+    wp.altitude = (i % 3 == 0) ? -2500 - i : 10000 + i;     // negative altitudes must survive the 24 bit encoding
+    wp.speed = 500 + i;
+    wp.duration = i % 600;
+    wp.type = i % WAYPOINT_TYPE_COUNT;
+    wp.pattern = i % WAYPOINT_PATTERN_COUNT;
+    return wp;
+}
+
+static void expectWaypointEq(const waypoint_t &expected, const waypoint_t *actual)
+{
+    ASSERT_NE(nullptr, actual);
+    EXPECT_EQ(expected.latitude, actual->latitude);
+    EXPECT_EQ(expected.longitude, actual->longitude);
+    EXPECT_EQ(expected.altitude, actual->altitude);
+    EXPECT_EQ(expected.speed, actual->speed);
+    EXPECT_EQ(expected.duration, actual->duration);
+    EXPECT_EQ(expected.type, actual->type);
+    EXPECT_EQ(expected.pattern, actual->pattern);
+}
+
+class MissionStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        memset(g_flash, 0xff, sizeof(g_flash));
+        memset(&g_geometry, 0, sizeof(g_geometry));
+        g_geometry.sectors = SECTOR_COUNT;
+        g_geometry.pageSize = PAGE_SIZE;
+        g_geometry.sectorSize = SECTOR_SIZE;
+        g_geometry.totalSize = SECTOR_SIZE * SECTOR_COUNT;
+        g_partition.type = FLASH_PARTITION_TYPE_MISSION;
+        g_partition.startSector = PARTITION_START;
+        g_partition.endSector = SECTOR_COUNT - 1;
+        g_partitionPresent = true;
+        g_readCalls = 0;
+        g_eraseCalls = 0;
+        g_busyPolls = 0;
+
+        flightPlanConfigMutable()->waypointCount = 0;
+        flightPlanConfigMutable()->missionStorage = MISSION_STORAGE_FLASH;
+        missionStoreInit();
+    }
+
+    static void finishErase(void) {
+        while (!missionStoreIsReady()) {
+            missionStoreEraseAsync();
+        }
+    }
+
+    void upload(uint16_t count) {
+        ASSERT_TRUE(missionStoreBeginWrite(count));
+        finishErase();
+        for (uint16_t i = 0; i < count; i++) {
+            const waypoint_t wp = makeWaypoint(i);
+            ASSERT_TRUE(missionStoreWriteWaypoint(i, &wp));
+        }
+        ASSERT_TRUE(missionStoreCommit(count));
+    }
+};
+
+TEST_F(MissionStoreTest, CapacityComesFromThePartition)
+{
+    EXPECT_TRUE(missionStoreIsFlash());
+    EXPECT_EQ(0, missionStoreGetCount());
+    // 64 KiB less the header page, 16 bytes per waypoint
+    EXPECT_EQ((16 * SECTOR_SIZE - PAGE_SIZE) / MISSION_STORE_RECORD_SIZE, missionStoreGetCapacity());
+}
+
+TEST_F(MissionStoreTest, LargeMissionSurvivesReboot)
+{
+    const uint16_t count = 2000;
+    upload(count);
+    EXPECT_EQ(count, missionStoreGetCount());
+
+    missionStoreInit();
+
+    ASSERT_EQ(count, missionStoreGetCount());
+    for (uint16_t i = 0; i < count; i++) {
+        expectWaypointEq(makeWaypoint(i), missionStoreGetWaypoint(i));
+    }
+    EXPECT_EQ(nullptr, missionStoreGetWaypoint(count));
+}
+
+TEST_F(MissionStoreTest, UploadOnlyErasesTheSectorsItNeeds)
+{
+    upload(300);    // 256 + 300 * 16 bytes, two sectors
+
+    EXPECT_EQ(2, g_eraseCalls);
+}
+
+TEST_F(MissionStoreTest, EraseRunsOneSectorAtATimeWhenFlashIsIdle)
+{
+    ASSERT_TRUE(missionStoreBeginWrite(300));
+    EXPECT_EQ(0, g_eraseCalls);
+    EXPECT_FALSE(missionStoreIsReady());
+    const waypoint_t wp = makeWaypoint(0);
+    EXPECT_FALSE(missionStoreWriteWaypoint(0, &wp));
+
+    missionStoreEraseAsync();
+    EXPECT_EQ(1, g_eraseCalls);
+    missionStoreEraseAsync();      // still busy with the first sector
+    EXPECT_EQ(1, g_eraseCalls);
+
+    finishErase();
+    EXPECT_EQ(2, g_eraseCalls);
+    EXPECT_TRUE(missionStoreWriteWaypoint(0, &wp));
+    EXPECT_TRUE(missionStoreCommit(1));
+}
+
+TEST_F(MissionStoreTest, InterruptedUploadLeavesStoreEmpty)
+{
+    upload(10);
+    ASSERT_TRUE(missionStoreBeginWrite(100));
+    finishErase();
+    for (uint16_t i = 0; i < 50; i++) {
+        const waypoint_t wp = makeWaypoint(i);
+        ASSERT_TRUE(missionStoreWriteWaypoint(i, &wp));
+    }
+
+    // power loss before the commit
+    missionStoreInit();
+
+    EXPECT_EQ(0, missionStoreGetCount());
+}
+
+TEST_F(MissionStoreTest, RejectsOverCapacityAndOutOfOrderWrites)
+{
+    EXPECT_FALSE(missionStoreBeginWrite(missionStoreGetCapacity() + 1));
+
+    ASSERT_TRUE(missionStoreBeginWrite(4));
+    finishErase();
+    const waypoint_t wp = makeWaypoint(0);
+    EXPECT_FALSE(missionStoreWriteWaypoint(1, &wp));
+    EXPECT_TRUE(missionStoreWriteWaypoint(0, &wp));
+    EXPECT_FALSE(missionStoreWriteWaypoint(0, &wp));
+    EXPECT_FALSE(missionStoreCommit(2));    // more than were written
+}
+
+TEST_F(MissionStoreTest, CommitWithFewerWaypointsThanWritten)
+{
+    ASSERT_TRUE(missionStoreBeginWrite(40));
+    finishErase();
+    for (uint16_t i = 0; i < 40; i++) {
+        const waypoint_t wp = makeWaypoint(i);
+        ASSERT_TRUE(missionStoreWriteWaypoint(i, &wp));
+    }
+    ASSERT_TRUE(missionStoreCommit(25));
+
+    missionStoreInit();
+
+    ASSERT_EQ(25, missionStoreGetCount());
+    expectWaypointEq(makeWaypoint(24), missionStoreGetWaypoint(24));
+}
+
+TEST_F(MissionStoreTest, CorruptedRecordFailsCrcAtBoot)
+{
+    upload(100);
+
+    g_flash[PARTITION_START * SECTOR_SIZE + PAGE_SIZE + 50 * MISSION_STORE_RECORD_SIZE] ^= 0x01;
+    missionStoreInit();
+
+    EXPECT_EQ(0, missionStoreGetCount());
+}
+
+TEST_F(MissionStoreTest, ActiveLegStaysPagedWhileOthersAreRead)
+{
+    upload(1000);
+    missionStorePrefetch(500);
+    const waypoint_t *active = missionStoreGetWaypoint(500);
+    ASSERT_NE(nullptr, active);
+
+    // an OSD or MAVLink reader sweeping the whole mission must not evict the active leg
+    for (uint16_t i = 0; i < 1000; i++) {
+        expectWaypointEq(makeWaypoint(i), missionStoreGetWaypoint(i));
+    }
+
+    g_readCalls = 0;
+    EXPECT_EQ(active, missionStoreGetWaypoint(500));
+    expectWaypointEq(makeWaypoint(500), active);
+    EXPECT_EQ(0, g_readCalls);
+}
+
+TEST_F(MissionStoreTest, PagingCostDoesNotDependOnMissionSize)
+{
+    upload(2000);
+
+    // flying leg by leg reads each waypoint once, and only the lookahead window is resident
+    g_readCalls = 0;
+    for (uint16_t i = 0; i < 2000; i++) {
+        missionStorePrefetch(i);
+        for (uint16_t k = i; k < i + MISSION_STORE_WINDOW_SIZE && k < 2000; k++) {
+            ASSERT_NE(nullptr, missionStoreGetWaypoint(k));
+        }
+    }
+    EXPECT_EQ(2000, g_readCalls);
+}
+
+TEST_F(MissionStoreTest, ClearInvalidatesStoredMission)
+{
+    upload(20);
+
+    missionStoreClear();
+    EXPECT_EQ(0, missionStoreGetCount());
+    finishErase();
+
+    missionStoreInit();
+    EXPECT_EQ(0, missionStoreGetCount());
+}
+
+TEST_F(MissionStoreTest, FallsBackToPgWithoutPartition)
+{
+    g_partitionPresent = false;
+    flightPlanConfigMutable()->waypointCount = 2;
+    flightPlanConfigMutable()->waypoints[1] = makeWaypoint(7);
+    missionStoreInit();
+
+    EXPECT_FALSE(missionStoreIsFlash());
+    EXPECT_EQ(MAX_WAYPOINTS, missionStoreGetCapacity());
+    ASSERT_EQ(2, missionStoreGetCount());
+    expectWaypointEq(makeWaypoint(7), missionStoreGetWaypoint(1));
+    EXPECT_FALSE(missionStoreBeginWrite(MAX_WAYPOINTS + 1));
+}
@@ -19,11 +19,15 @@
  * If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <float.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
+#include <utility>
+#include <vector>
+
 extern "C" {
 
     #include "platform.h"
@@ -48,11 +52,12 @@ extern "C" {
     #include "pg/osd_nav_map.h"
 
     void navTrailIngestPosition(const vector2_t *posCm);
+    void navTrailCompactStep(void);
     void navTrailResetStateForTest(void);
 
     // test control knobs consumed by the stubs at the bottom of this file
     extern bool testFlightPlanNavActive;
-    extern uint8_t testFlightPlanNavIndex;
+    extern uint16_t testFlightPlanNavIndex;
 }
 
 #include "unittest_macros.h"
@@ -100,6 +105,23 @@ protected:
 // trail recorder
 //
 
+// The RX task calls navTrailUpdate() at least five times per 10 Hz trail poll,
+// each call running one bounded step of compaction
+static void recordTrailPosition(const vector2_t *posCm)
+{
+    navTrailIngestPosition(posCm);
+    for (int i = 0; i < 5; i++) {
+        navTrailCompactStep();
+    }
+}
+
+static void finishTrailCompaction(void)
+{
+    for (int i = 0; i < 10000; i++) {
+        navTrailCompactStep();
+    }
+}
+
 TEST_F(OsdNavMapTest, TrailRecorderGatesAppendsByDistance)
 {
     vector2_t pos = { .x = 0.0f, .y = 0.0f };
@@ -116,27 +138,154 @@ TEST_F(OsdNavMapTest, TrailRecorderGatesAppendsByDistance)
     EXPECT_EQ(6, navTrailPointAt(1)->eastM);
 }
 
-TEST_F(OsdNavMapTest, TrailCompactionDoublesSpacingWhenFull)
+TEST_F(OsdNavMapTest, TrailCompactionCollapsesStraightRunsWhenFull)
 {
-    // fill the ring: every point 5 m apart is exactly at the spacing gate
+    // fill the buffer: every point 5 m apart is exactly at the spacing gate
+    vector2_t pos = { .x = 0.0f, .y = 0.0f };
     for (int i = 0; i < NAV_TRAIL_CAPACITY; i++) {
-        const vector2_t pos = { .x = i * 500.0f, .y = 0.0f };
+        pos.x = i * 500.0f;
+        recordTrailPosition(&pos);
+    }
+
+    // a straight line needs only its end points, plus the few recorded while
+    // the pass ran
+    EXPECT_LT(navTrailCount(), (unsigned)NAV_TRAIL_CAPACITY / 4);
+    EXPECT_EQ(0, navTrailPointAt(0)->eastM);
+    EXPECT_EQ((NAV_TRAIL_CAPACITY - 1) * 5, navTrailPointAt(navTrailCount() - 1)->eastM);
+
+    // the spacing gate is unchanged by compaction
+    const unsigned count = navTrailCount();
+    pos.x += 300.0f;
+    recordTrailPosition(&pos);
+    EXPECT_EQ(count, navTrailCount());
+    pos.x += 300.0f;
+    recordTrailPosition(&pos);
+    EXPECT_EQ(count + 1, navTrailCount());
+}
+
+TEST_F(OsdNavMapTest, TrailCompactionIsSpreadOverCalls)
+{
+    // a circle has no straight runs, so a pass has to measure every vertex
+    vector2_t pos = { .x = 0.0f, .y = 0.0f };
+    for (int i = 0; navTrailCount() < (unsigned)NAV_TRAIL_CAPACITY * 4 / 5; i++) {
+        pos.x = 20000.0f * sinf(i * 0.05f);
+        pos.y = 20000.0f * cosf(i * 0.05f);
         navTrailIngestPosition(&pos);
     }
-    ASSERT_EQ((unsigned)NAV_TRAIL_CAPACITY, navTrailCount());
+    const unsigned count = navTrailCount();
 
-    // one more point: the trail halves and the spacing doubles to 10 m
-    vector2_t pos = { .x = NAV_TRAIL_CAPACITY * 500.0f, .y = 0.0f };
+    // one call does a bounded share of the pass, recording carries on meanwhile
+    const uint16_t revision = navTrailRevision();
+    navTrailCompactStep();
+    EXPECT_EQ(revision, navTrailRevision());
+    pos.x += 1000.0f;
     navTrailIngestPosition(&pos);
-    EXPECT_EQ((unsigned)(NAV_TRAIL_CAPACITY / 2 + 1), navTrailCount());
+    EXPECT_EQ(count + 1, navTrailCount());
 
-    const unsigned countBefore = navTrailCount();
-    pos.x += 500.0f;   // 5 m: below the doubled spacing, ignored
-    navTrailIngestPosition(&pos);
-    EXPECT_EQ(countBefore, navTrailCount());
-    pos.x += 500.0f;   // 10 m from the last stored point: recorded
-    navTrailIngestPosition(&pos);
-    EXPECT_EQ(countBefore + 1, navTrailCount());
+    finishTrailCompaction();
+    EXPECT_NE(revision, navTrailRevision());
+    EXPECT_LE(navTrailCount(), (unsigned)NAV_TRAIL_CAPACITY * 3 / 5 + 1);
+    EXPECT_EQ(lrintf(pos.x / 100.0f), navTrailPointAt(navTrailCount() - 1)->eastM);
+}
+
+TEST_F(OsdNavMapTest, TrailEndFollowsTheCraftWhenCompactionFallsBehind)
+{
+    vector2_t pos = { .x = 0.0f, .y = 0.0f };
+    for (int i = 0; i < NAV_TRAIL_CAPACITY + 20; i++) {
+        pos.x = 20000.0f * sinf(i * 0.05f);
+        pos.y = 20000.0f * cosf(i * 0.05f);
+        navTrailIngestPosition(&pos);
+    }
+
+    EXPECT_EQ((unsigned)NAV_TRAIL_CAPACITY, navTrailCount());
+    EXPECT_EQ(lrintf(pos.x / 100.0f), navTrailPointAt(navTrailCount() - 1)->eastM);
+    EXPECT_EQ(lrintf(pos.y / 100.0f), navTrailPointAt(navTrailCount() - 1)->northM);
+}
+
+// Distance from (e, n) to the stored trail polyline, metres
+static float distanceToTrailM(float e, float n)
+{
+    float best = FLT_MAX;
+    for (unsigned i = 0; i + 1 < navTrailCount(); i++) {
+        const navTrailPoint_t *a = navTrailPointAt(i);
+        const navTrailPoint_t *b = navTrailPointAt(i + 1);
+        const float abE = b->eastM - a->eastM, abN = b->northM - a->northM;
+        const float lenSq = abE * abE + abN * abN;
+        float t = lenSq > 0.0f ? ((e - a->eastM) * abE + (n - a->northM) * abN) / lenSq : 0.0f;
+        t = fminf(fmaxf(t, 0.0f), 1.0f);
+        best = fminf(best, hypotf(e - (a->eastM + t * abE), n - (a->northM + t * abN)));
+    }
+    return best;
+}
+
+TEST_F(OsdNavMapTest, TrailCompactionKeepsTheCornersOfALongSurvey)
+{
+    // 16 passes of 300 m, 30 m apart, sampled every 5 m: about 1000 points,
+    // four times the buffer. Halving would have left one point per 80 m and
+    // rounded every turn off; the corners have to survive here.
+    std::vector<std::pair<float, float>> flown;
+    std::vector<std::pair<float, float>> corners;
+    float e = 0.0f, n = 0.0f;
+    for (int pass = 0; pass < 16; pass++) {
+        const float dir = (pass % 2 == 0) ? 1.0f : -1.0f;
+        corners.emplace_back(e, n);
+        for (int step = 0; step < 60; step++) {
+            n += dir * 5.0f;
+            flown.emplace_back(e, n);
+        }
+        corners.emplace_back(e, n);
+        for (int step = 0; step < 6; step++) {
+            e += 5.0f;
+            flown.emplace_back(e, n);
+        }
+    }
+    const vector2_t origin = { .x = 0.0f, .y = 0.0f };
+    recordTrailPosition(&origin);
+    for (const auto &p : flown) {
+        const vector2_t pos = { .x = p.first * 100.0f, .y = p.second * 100.0f };
+        recordTrailPosition(&pos);
+    }
+
+    ASSERT_LE(navTrailCount(), (unsigned)NAV_TRAIL_CAPACITY);
+    EXPECT_EQ(0, navTrailPointAt(0)->northM);
+    EXPECT_EQ(lrintf(flown.back().first), navTrailPointAt(navTrailCount() - 1)->eastM);
+
+    for (const auto &c : corners) {
+        bool found = false;
+        for (unsigned i = 0; i < navTrailCount(); i++) {
+            const navTrailPoint_t *pt = navTrailPointAt(i);
+            found |= pt->eastM == lrintf(c.first) && pt->northM == lrintf(c.second);
+        }
+        EXPECT_TRUE(found) << "corner " << c.first << "," << c.second;
+    }
+    for (const auto &p : flown) {
+        EXPECT_LT(distanceToTrailM(p.first, p.second), 1.0f);
+    }
+}
+
+TEST_F(OsdNavMapTest, TrailCompactionBoundsTheErrorOfACurvedFlight)
+{
+    // a slow outward spiral has no straight runs to collapse, so the
+    // tolerance has to grow; the stored line must still follow the flight
+    std::vector<std::pair<float, float>> flown;
+    float angle = 0.0f;
+    for (int i = 0; i < 2000; i++) {
+        const float radiusM = 50.0f + angle * 10.0f;
+        angle += 5.0f / radiusM;   // 5 m along the arc
+        flown.emplace_back(radiusM * sinf(angle), radiusM * cosf(angle));
+    }
+    for (const auto &p : flown) {
+        const vector2_t pos = { .x = p.first * 100.0f, .y = p.second * 100.0f };
+        recordTrailPosition(&pos);
+    }
+
+    ASSERT_LE(navTrailCount(), (unsigned)NAV_TRAIL_CAPACITY);
+    EXPECT_GT(navTrailCount(), (unsigned)NAV_TRAIL_CAPACITY / 2);
+    float worstM = 0.0f;
+    for (const auto &p : flown) {
+        worstM = fmaxf(worstM, distanceToTrailM(p.first, p.second));
+    }
+    EXPECT_LT(worstM, 10.0f);
 }
 
 TEST_F(OsdNavMapTest, TrailUpdateRecordsWhileArmedAndResetsOnArmEdge)
@@ -230,12 +379,13 @@ protected:
         displayPort.rows = SCREEN_ROWS;
     }
 
-    // mimic osdDrawSingleElement/osdDisplayActiveElement for one element
-    void renderElement(uint8_t posX = 1, uint8_t posY = 1)
+    // mimic osdDrawSingleElement/osdDisplayActiveElement for one element;
+    // returns the number of OSD passes the frame took
+    int renderElement(uint8_t posX = 1, uint8_t posY = 1)
     {
         memset(screen, ' ', sizeof(screen));
         osdElementParms_t element;
-        int guard = 16;
+        int guard = 64;   // eight rows plus the passes a layer rebuild takes
         do {
             memset(&element, 0, sizeof(element));
             element.item = OSD_NAV_MAP;
@@ -261,7 +411,8 @@ protected:
                 }
             }
         } while (!element.rendered && --guard > 0);
-        ASSERT_GT(guard, 0) << "element never finished rendering";
+        EXPECT_GT(guard, 0) << "element never finished rendering";
+        return 64 - guard + 1;
     }
 
     int countGlyph(uint8_t glyph)
@@ -493,6 +644,89 @@ TEST_F(OsdNavMapRenderTest, TrailSwitchbackKeepsBothCrossingsOfAColumn)
     EXPECT_GT(columnsWithTwoRows, 0);
 }
 
+TEST_F(OsdNavMapRenderTest, CachedLayersMatchAFullRedraw)
+{
+    stateFlags |= GPS_FIX | GPS_FIX_HOME;
+    armingFlags |= ARMED;
+    setWaypoint(0, WAYPOINT_TYPE_FLYBY, 40, 40);
+    setWaypoint(1, WAYPOINT_TYPE_FLYBY, -40, 40);
+
+    // draw the trail in stages: each frame extends the cached layer
+    for (int i = 0; i <= 40; i++) {
+        const float angle = i * 0.15f;
+        const vector2_t pos = { .x = 3000.0f * sinf(angle), .y = 3000.0f * cosf(angle) - 1000.0f };
+        navTrailIngestPosition(&pos);
+        setCraftEnuM(pos.x / 100.0f, pos.y / 100.0f);
+        renderElement();
+    }
+    uint8_t incremental[SCREEN_ROWS][SCREEN_COLS];
+    memcpy(incremental, screen, sizeof(screen));
+    int strokes = 0;
+    for (int g = 0; g < 9; g++) {
+        strokes += countGlyph(SYM_AH_BAR9_0 + g);
+    }
+    ASSERT_GT(strokes, 5);
+
+    // same state drawn from scratch
+    osdNavMapResetRenderStateForTest();
+    renderElement();
+
+    // the bottom border carries the zoom label, which only a fresh map flashes
+    for (int y = 0; y < 1 + 7; y++) {
+        for (int x = 0; x < SCREEN_COLS; x++) {
+            EXPECT_EQ(screen[y][x], incremental[y][x]) << "row " << y << " col " << x;
+        }
+    }
+}
+
+TEST_F(OsdNavMapRenderTest, SteadyFramesOnlyEmitRows)
+{
+    stateFlags |= GPS_FIX | GPS_FIX_HOME;
+    armingFlags |= ARMED;
+    osdNavMapConfigMutable()->minScaleM = 1200;
+
+    // a long trail, more than one pass can rasterize
+    for (int i = 0; i < 200; i++) {
+        const vector2_t pos = { .x = (i % 2 ? 20000.0f : -20000.0f), .y = i * 200.0f - 20000.0f };
+        navTrailIngestPosition(&pos);
+    }
+    setCraftEnuM(0, 0);
+
+    // the first frame rasterizes the layer over extra passes
+    EXPECT_GT(renderElement(), 8 + 1);
+
+    // then each frame is one pass per row
+    EXPECT_EQ(8, renderElement());
+    attitude.values.yaw = 450;   // north-up: heading does not touch the layer
+    EXPECT_EQ(8, renderElement());
+
+    // a new trail point is drawn into the layer without a rebuild
+    const vector2_t pos = { .x = 0.0f, .y = 30000.0f };
+    navTrailIngestPosition(&pos);
+    EXPECT_EQ(8, renderElement());
+}
+
+TEST_F(OsdNavMapRenderTest, HeadingUpRebuildsOnlyOnARealTurn)
+{
+    stateFlags |= GPS_FIX | GPS_FIX_HOME;
+    armingFlags |= ARMED;
+    osdNavMapConfigMutable()->mode = OSD_NAV_MAP_MODE_HEADING_UP;
+    for (int i = 0; i < 100; i++) {
+        const vector2_t pos = { .x = i * 600.0f, .y = (i % 2) * 600.0f };
+        navTrailIngestPosition(&pos);
+    }
+    setCraftEnuM(0, 50);
+
+    renderElement();
+    EXPECT_EQ(8, renderElement());
+
+    attitude.values.yaw = 20;    // 2 degrees: the view holds
+    EXPECT_EQ(8, renderElement());
+
+    attitude.values.yaw = 100;   // 10 degrees: the layer is redrawn
+    EXPECT_GT(renderElement(), 8);
+}
+
 // STUBS
 
 extern "C" {
@@ -505,10 +739,10 @@ extern "C" {
     gpsLocation_t GPS_home_llh;
 
     bool testFlightPlanNavActive = false;
-    uint8_t testFlightPlanNavIndex = 0;
+    uint16_t testFlightPlanNavIndex = 0;
 
     bool flightPlanNavIsActive(void) { return testFlightPlanNavActive; }
-    uint8_t flightPlanNavGetCurrentIndex(void) { return testFlightPlanNavIndex; }
+    uint16_t flightPlanNavGetCurrentIndex(void) { return testFlightPlanNavIndex; }
 
     // matches the firmware conversion: 1e-7 degree steps to cm
     void GPS_distance2d(const gpsLocation_t *from, const gpsLocation_t *to, vector2_t *distance)
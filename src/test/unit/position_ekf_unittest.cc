@@ -0,0 +1,273 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Betaflight. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/maths.h"
+    #include "common/vector.h"
+
+    #include "flight/position_ekf.h"
+}
+
+#include "gtest/gtest.h"
+
+static constexpr float GRAVITY_CMSS = 980.665f;
+static constexpr float DT = 0.01f;  // 100 Hz, the position estimator rate
+
+static const positionEkfConfig_t testConfig = {
+    .qAccelXY = 2500.0f,
+    .qAccelZ = 2500.0f,
+    .qAccelBias = 1.0f,
+    .qBaroOffset = 25.0f,
+};
+
+// Deterministic Gaussian noise so failures are reproducible
+static uint32_t noiseSeed;
+
+static float gaussianNoise(float sigma)
+{
+    float u1, u2;
+    do {
+        noiseSeed = noiseSeed * 1664525u + 1013904223u;
+        u1 = (noiseSeed >> 8) / 16777216.0f;
+    } while (u1 <= 0.0f);
+    noiseSeed = noiseSeed * 1664525u + 1013904223u;
+    u2 = (noiseSeed >> 8) / 16777216.0f;
+    return sigma * sqrtf(-2.0f * logf(u1)) * cosf(2.0f * M_PIf * u2);
+}
+
+static void rotationFromEuler(matrix33_t *r, float roll, float pitch, float yaw)
+{
+    const float cr = cosf(roll), sr = sinf(roll);
+    const float cp = cosf(pitch), sp = sinf(pitch);
+    const float cy = cosf(yaw), sy = sinf(yaw);
+
+    // Rz(yaw) * Ry(pitch) * Rx(roll), body -> ENU
+    r->m[0][0] = cy * cp;
+    r->m[0][1] = cy * sp * sr - sy * cr;
+    r->m[0][2] = cy * sp * cr + sy * sr;
+    r->m[1][0] = sy * cp;
+    r->m[1][1] = sy * sp * sr + cy * cr;
+    r->m[1][2] = sy * sp * cr - cy * sr;
+    r->m[2][0] = -sp;
+    r->m[2][1] = cp * sr;
+    r->m[2][2] = cp * cr;
+}
+
+// Synthetic flight: slow horizontal figure eights and climbs with changing tilt and
+// heading, the kind of profile a SITL hover-and-cruise log contains.
+struct flightSim_t {
+    vector3_t biasBody;         // true accelerometer bias, cm/s^2
+    float baroDriftCmPerS;      // true barometer drift
+    float t;
+    vector3_t pos;
+    vector3_t vel;
+    float baroDrift;
+
+    matrix33_t bodyToEnu;
+    vector3_t accelBody;
+
+    void step(void)
+    {
+        t += DT;
+        const float w[3] = { 0.21f, 0.13f, 0.17f };
+        const float amp[3] = { 2000.0f, 1500.0f, 300.0f };
+        vector3_t accel;
+        for (int axis = 0; axis < 3; axis++) {
+            pos.v[axis] = amp[axis] * sinf(w[axis] * t);
+            vel.v[axis] = amp[axis] * w[axis] * cosf(w[axis] * t);
+            accel.v[axis] = -amp[axis] * w[axis] * w[axis] * sinf(w[axis] * t);
+        }
+        accel.v[2] += GRAVITY_CMSS;
+        baroDrift += baroDriftCmPerS * DT;
+
+        rotationFromEuler(&bodyToEnu, 0.25f * sinf(0.3f * t), 0.25f * cosf(0.2f * t), 0.15f * t);
+        // specific force in body = R' * (a + g) + bias
+        for (int i = 0; i < 3; i++) {
+            accelBody.v[i] = biasBody.v[i] + gaussianNoise(30.0f);
+            for (int k = 0; k < 3; k++) {
+                accelBody.v[i] += bodyToEnu.m[k][i] * accel.v[k];
+            }
+        }
+    }
+};
+
+class PositionEkfTest : public ::testing::Test {
+protected:
+    positionEkf_t ekf;
+    flightSim_t sim;
+    int step;
+
+    void SetUp() override
+    {
+        noiseSeed = 12345;
+        memset(&sim, 0, sizeof(sim));
+        // the simulated vehicle is already moving, start uncertain enough for the gate to accept it
+        positionEkfInit(&ekf, &testConfig, 1e6f, 1e6f, 2500.0f);
+        step = 0;
+    }
+
+    // 100 Hz prediction, 10 Hz GPS position and velocity, 25 Hz baro
+    void fly(float seconds, bool useGps = true, bool useBaro = true)
+    {
+        const int steps = lrintf(seconds / DT);
+        for (int i = 0; i < steps; i++, step++) {
+            sim.step();
+            positionEkfPredict(&ekf, DT, &sim.bodyToEnu, &sim.accelBody);
+            if (useGps && step % 10 == 0) {
+                for (int axis = 0; axis < 3; axis++) {
+                    positionEkfUpdateState(&ekf, (positionEkfState_e)(EKF_POS_E + axis), sim.pos.v[axis] + gaussianNoise(100.0f), sq(100.0f));
+                }
+                positionEkfUpdateState(&ekf, EKF_VEL_E, sim.vel.v[0] + gaussianNoise(20.0f), sq(20.0f));
+                positionEkfUpdateState(&ekf, EKF_VEL_N, sim.vel.v[1] + gaussianNoise(20.0f), sq(20.0f));
+            }
+            if (useBaro && step % 4 == 0) {
+                positionEkfUpdateStateSum(&ekf, EKF_POS_U, EKF_BARO_OFFSET, sim.pos.v[2] + sim.baroDrift + gaussianNoise(30.0f), sq(30.0f));
+            }
+        }
+    }
+};
+
+TEST_F(PositionEkfTest, EstimatesAccelerometerBiasOnAllAxes)
+{
+    sim.biasBody = {{ 25.0f, -20.0f, 35.0f }};
+
+    fly(180.0f);
+
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_ACC_BIAS_X), 25.0f, 5.0f);
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_ACC_BIAS_Y), -20.0f, 5.0f);
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_ACC_BIAS_Z), 35.0f, 5.0f);
+}
+
+// Once the bias is known, losing GPS must not make the altitude sag the way an
+// uncompensated accelerometer bias does: a 35 cm/s^2 bias integrates to 4 m in 15 s.
+TEST_F(PositionEkfTest, AltitudeDoesNotSagAfterGpsLoss)
+{
+    sim.biasBody = {{ 0.0f, 0.0f, 35.0f }};
+    fly(120.0f);
+
+    fly(15.0f, false, false);
+
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_POS_U), sim.pos.v[2], 100.0f);
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_VEL_U), sim.vel.v[2], 15.0f);
+}
+
+TEST_F(PositionEkfTest, BarometerDriftGoesIntoOffsetNotAltitude)
+{
+    sim.baroDriftCmPerS = 2.0f;
+
+    fly(120.0f);
+
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_BARO_OFFSET), sim.baroDrift, 50.0f);
+    EXPECT_NEAR(positionEkfGetState(&ekf, EKF_POS_U), sim.pos.v[2], 50.0f);
+}
+
+TEST_F(PositionEkfTest, CovarianceStaysSymmetricPositiveDefinite)
+{
+    sim.biasBody = {{ 10.0f, 10.0f, -10.0f }};
+    sim.baroDriftCmPerS = 1.0f;
+
+    fly(60.0f);
+
+    double L[EKF_STATE_COUNT][EKF_STATE_COUNT] = {};
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        for (int j = 0; j < EKF_STATE_COUNT; j++) {
+            EXPECT_FLOAT_EQ(ekf.P[i][j], ekf.P[j][i]);
+        }
+        // Cholesky factorisation succeeds only for a positive definite matrix
+        for (int j = 0; j <= i; j++) {
+            double sum = ekf.P[i][j];
+            for (int k = 0; k < j; k++) {
+                sum -= L[i][k] * L[j][k];
+            }
+            if (i == j) {
+                ASSERT_GT(sum, 0.0);
+                L[i][i] = sqrt(sum);
+            } else {
+                L[i][j] = sum / L[j][j];
+            }
+        }
+    }
+}
+
+TEST_F(PositionEkfTest, InnovationGateRejectsGpsGlitch)
+{
+    fly(30.0f);
+    const float east = positionEkfGetState(&ekf, EKF_POS_E);
+
+    EXPECT_FALSE(positionEkfUpdateState(&ekf, EKF_POS_E, east + 100000.0f, sq(100.0f)));
+    EXPECT_EQ(1u, ekf.rejectedUpdates);
+    EXPECT_FLOAT_EQ(east, positionEkfGetState(&ekf, EKF_POS_E));
+
+    EXPECT_TRUE(positionEkfUpdateState(&ekf, EKF_POS_E, east + 50.0f, sq(100.0f)));
+}
+
+// The block-wise prediction must produce the same covariance as the dense F * P * F' + Q.
+TEST_F(PositionEkfTest, PredictMatchesDenseCovariancePropagation)
+{
+    sim.biasBody = {{ 10.0f, -5.0f, 20.0f }};
+    fly(5.0f);
+    sim.step();
+
+    float F[EKF_STATE_COUNT][EKF_STATE_COUNT] = {};
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        F[i][i] = 1.0f;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        F[EKF_POS_E + axis][EKF_VEL_E + axis] = DT;
+        for (int k = 0; k < 3; k++) {
+            F[EKF_POS_E + axis][EKF_ACC_BIAS_X + k] = -0.5f * DT * DT * sim.bodyToEnu.m[axis][k];
+            F[EKF_VEL_E + axis][EKF_ACC_BIAS_X + k] = -DT * sim.bodyToEnu.m[axis][k];
+        }
+    }
+    double expected[EKF_STATE_COUNT][EKF_STATE_COUNT];
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        for (int j = 0; j < EKF_STATE_COUNT; j++) {
+            double sum = 0.0;
+            for (int a = 0; a < EKF_STATE_COUNT; a++) {
+                for (int b = 0; b < EKF_STATE_COUNT; b++) {
+                    sum += (double)F[i][a] * ekf.P[a][b] * F[j][b];
+                }
+            }
+            expected[i][j] = sum;
+        }
+    }
+    const float halfDt2 = 0.5f * DT * DT;
+    for (int axis = 0; axis < 3; axis++) {
+        const float q = axis == 2 ? testConfig.qAccelZ : testConfig.qAccelXY;
+        expected[EKF_POS_E + axis][EKF_POS_E + axis] += halfDt2 * halfDt2 * q;
+        expected[EKF_POS_E + axis][EKF_VEL_E + axis] += halfDt2 * DT * q;
+        expected[EKF_VEL_E + axis][EKF_POS_E + axis] += halfDt2 * DT * q;
+        expected[EKF_VEL_E + axis][EKF_VEL_E + axis] += DT * DT * q;
+        expected[EKF_ACC_BIAS_X + axis][EKF_ACC_BIAS_X + axis] += DT * testConfig.qAccelBias;
+    }
+    expected[EKF_BARO_OFFSET][EKF_BARO_OFFSET] += DT * testConfig.qBaroOffset;
+
+    positionEkfPredict(&ekf, DT, &sim.bodyToEnu, &sim.accelBody);
+
+    for (int i = 0; i < EKF_STATE_COUNT; i++) {
+        for (int j = 0; j < EKF_STATE_COUNT; j++) {
+            EXPECT_NEAR(expected[i][j], ekf.P[i][j], 1e-4 * (1.0 + fabs(expected[i][j])));
+        }
+    }
+}
@@ -18,6 +18,7 @@ extern "C" {
 #include "flight/imu.h"
 #include "flight/position.h"
 #include "flight/position_estimator.h"
+#include "flight/position_filter.h"
 
 // STATIC_UNIT_TESTED in position_estimator.c — gravity-removed earth-frame
 // linear acceleration in ENU (cm/s^2).
@@ -51,6 +52,7 @@ static bool rfHealthy = false;
 static float rfAltCm = 0.0f;
 static float baroAltCm = 0.0f;
 static timeUs_t fakeMicros = 0;
+static bool gpsNewDataAvailable = true;
 
 bool sensors(uint32_t mask) { return (enabledSensors & mask) != 0; }
 bool rangefinderIsHealthy(void) { return rfHealthy; }
@@ -61,6 +63,9 @@ timeUs_t micros(void) { return fakeMicros; }
 
 bool gpsHasNewData(uint16_t *gpsStamp)
 {
+    if (!gpsNewDataAvailable) {
+        return false;
+    }
     (*gpsStamp)++;
     return true;
 }
@@ -107,10 +112,14 @@ protected:
         stateFlags = GPS_FIX;
         armingFlags = ARMED;
         fakeMicros = 0;
+        gpsNewDataAvailable = true;
 
         positionConfigMutable()->altitude_source = ALTITUDE_SOURCE_RANGEFINDER_PREFER;
         positionConfigMutable()->altitude_prefer_baro = 100;
         positionConfigMutable()->rangefinder_max_range_cm = 400;
+        positionConfigMutable()->gps_delay_ms = 0;
+        positionConfigMutable()->opticalflow_delay_ms = 0;
+        positionConfigMutable()->position_ekf = false;
 
         positionEstimatorInit();
     }
@@ -245,3 +254,121 @@ TEST_F(PositionEstimatorTest, EastThrustProducesPositiveEastVelocity)
     EXPECT_GT(positionEstimatorGetEstimate()->velocity.v[ENU_E], 0.0f);
 }
 
+// Without intermediate updates, fusing into a past snapshot and carrying the
+// correction forward must match having fused the measurement at that time.
+TEST(PositionFilterTest, DelayedCorrectionMatchesUpdateAtMeasurementTime)
+{
+    const float dt = 0.01f;
+    const float accel[] = { 50.0f, -20.0f, 0.0f, 10.0f, 30.0f, -5.0f, 0.0f, 80.0f };
+
+    positionKalman_t snapshot;
+    kalmanInit(&snapshot, 10.0f, 5.0f, 10000.0f, 10000.0f, 50000.0f);
+    kalmanPredict(&snapshot, dt, 0.0f);
+
+    // reference: update at the measurement time, then predict to now
+    positionKalman_t reference = snapshot;
+    kalmanUpdatePosition(&reference, 40.0f, 500.0f);
+    kalmanUpdateVelocity(&reference, 12.0f, 100.0f);
+    for (float a : accel) {
+        kalmanPredict(&reference, dt, a);
+    }
+
+    // delayed: predict to now without the measurement, then apply it to the snapshot
+    positionKalman_t live = snapshot;
+    for (float a : accel) {
+        kalmanPredict(&live, dt, a);
+    }
+    positionKalman_t updated = snapshot;
+    kalmanUpdatePosition(&updated, 40.0f, 500.0f);
+    kalmanUpdateVelocity(&updated, 12.0f, 100.0f);
+    positionKalmanCorrection_t correction;
+    kalmanCorrectionInit(&correction, &snapshot, &updated);
+    for (unsigned i = 0; i < ARRAYLEN(accel); i++) {
+        kalmanCorrectionPredict(&correction, dt);
+    }
+    kalmanApplyCorrection(&live, &correction);
+
+    EXPECT_NEAR(kalmanGetPosition(&reference), kalmanGetPosition(&live), 1e-3f);
+    EXPECT_NEAR(kalmanGetVelocity(&reference), kalmanGetVelocity(&live), 1e-3f);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            EXPECT_NEAR(reference.P[i][j], live.P[i][j], 1e-2f);
+        }
+    }
+}
+
+// A craft cruising East, seen by a GPS whose solutions are 100ms old: with the delay
+// configured the estimate tracks the true current position instead of lagging behind.
+// With resetZ the vertical filter is reset just before every GPS solution arrives.
+static float cruiseEastPositionError(uint8_t gpsDelayMs, bool resetZ = false)
+{
+    const float speedCmS = 500.0f;
+    const float gpsDelayS = 0.1f;
+
+    positionConfigMutable()->gps_delay_ms = gpsDelayMs;
+    gpsSol.llh.lon = 0;
+    gpsSol.velned.velE = 0;
+    positionEstimatorInit();
+    stepEstimator(2);   // capture the arm point at the origin
+
+    gpsSol.velned.velE = speedCmS;
+    float timeS = 0.0f;
+    for (int i = 0; i < 300; i++) {
+        timeS += 0.01f;
+        // 10Hz GPS
+        gpsNewDataAvailable = (i % 10 == 0);
+        if (gpsNewDataAvailable) {
+            gpsSol.llh.lon = lrintf(MAX(timeS - gpsDelayS, 0.0f) * speedCmS);
+            if (resetZ) {
+                positionEstimatorResetZ();
+            }
+        }
+        stepEstimator();
+    }
+    gpsNewDataAvailable = true;
+
+    return positionEstimatorGetEstimate()->position.v[ENU_E] - timeS * speedCmS;
+}
+
+TEST_F(PositionEstimatorTest, GpsDelayCompensationRemovesLag)
+{
+    const float uncompensatedError = cruiseEastPositionError(0);
+    const float compensatedError = cruiseEastPositionError(100);
+
+    // uncompensated the estimate trails by about speed * delay = 50cm
+    EXPECT_LT(uncompensatedError, -30.0f);
+    EXPECT_LT(fabsf(compensatedError), 5.0f);
+}
+
+TEST_F(PositionEstimatorTest, ResetZKeepsHorizontalHistory)
+{
+    // the delayed GPS solutions still find the XY snapshots they belong to
+    EXPECT_LT(fabsf(cruiseEastPositionError(100, true)), 5.0f);
+}
+
+// A hover with an accelerometer reading 3% high. Returns the vertical velocity estimate
+// after a minute on the ground and 20 seconds of hovering at constant sensor altitudes.
+static float biasedHoverVelocityUp(bool useEkf)
+{
+    positionConfigMutable()->position_ekf = useEkf;
+    acc.accADC.z = 1.03f;
+    armingFlags = 0;
+    positionEstimatorInit();
+
+    stepEstimator(6000);
+    armingFlags = ARMED;
+    stepEstimator(2000);
+
+    return positionEstimatorGetEstimate()->velocity.v[ENU_U];
+}
+
+TEST_F(PositionEstimatorTest, EkfLearnsAccelBiasOnTheGround)
+{
+    const float filterVelocityUp = biasedHoverVelocityUp(false);
+    const float ekfVelocityUp = biasedHoverVelocityUp(true);
+
+    // the per-axis filter carries a standing climb rate from the uncorrected bias
+    EXPECT_GT(filterVelocityUp, 3.0f);
+    EXPECT_NEAR(ekfVelocityUp, 0.0f, 1.0f);
+    EXPECT_NEAR(positionEstimatorGetEstimate()->position.v[ENU_U], 0.0f, 5.0f);
+}
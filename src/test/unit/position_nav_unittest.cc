@@ -376,6 +376,48 @@ TEST_F(PositionNavTest, MoveTargetWithoutActiveCommandIsNoOp)
     EXPECT_FALSE(positionNavHasActiveTarget());
 }
 
+// --- Path velocity ---
+
+TEST_F(PositionNavTest, PathVelocityReplacesApproachSpeed)
+{
+    const vector3_t target = {{ 1.0f, 0.0f, 0.0f }};
+    positionNavSetTargetEf(&target, 5.0f, 1.0f, 0.5f, false, NULL, NULL);
+
+    // 1 m out the approach law alone would be slowing down; a path passing
+    // through the target at 4 m/s keeps its own speed and direction.
+    const vector3_t pathVel = {{ 0.0f, 4.0f, 0.0f }};
+    positionNavSetPathVelocityEf(&pathVel);
+    positionEstimate3d_t est = makeEstimate(0.0f, 0.0f, 0.0f, 400.0f);
+    positionNavUpdate(0.01f, &est);
+
+    const vector3_t vel = positionNavGetTargetVelocityCmS();
+    EXPECT_NEAR(vel.x, 0.0f, 1.0f);
+    EXPECT_NEAR(vel.y, 400.0f, 1.0f);
+}
+
+TEST_F(PositionNavTest, NewTargetClearsPathVelocity)
+{
+    const vector3_t target = {{ 10.0f, 0.0f, 0.0f }};
+    positionNavSetTargetEf(&target, 5.0f, 1.0f, 0.5f, false, NULL, NULL);
+    const vector3_t pathVel = {{ 0.0f, 4.0f, 0.0f }};
+    positionNavSetPathVelocityEf(&pathVel);
+
+    positionNavSetTargetEf(&target, 5.0f, 1.0f, 0.5f, false, NULL, NULL);
+    positionEstimate3d_t est = makeEstimate(0.0f, 0.0f, 0.0f, 0.0f);
+    positionNavUpdate(0.01f, &est);
+
+    const vector3_t vel = positionNavGetTargetVelocityCmS();
+    EXPECT_GT(vel.x, 0.0f);
+    EXPECT_NEAR(vel.y, 0.0f, 1.0f);
+}
+
+TEST_F(PositionNavTest, PathVelocityWithoutActiveCommandIsNoOp)
+{
+    const vector3_t pathVel = {{ 0.0f, 4.0f, 0.0f }};
+    positionNavSetPathVelocityEf(&pathVel);
+    EXPECT_FALSE(positionNavGetActiveCommand()->pathVelocityValid);
+}
+
 // --- Clear target ---
 
 TEST_F(PositionNavTest, ClearTargetDeactivates)
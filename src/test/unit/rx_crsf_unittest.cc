@@ -45,6 +45,7 @@ extern "C" {
     rssiSource_e rssiSource;
 
     void crsfDataReceive(uint16_t c, void *data);
+    void crsfDataReceiveFrame(const uint8_t *data, uint16_t len, void *callbackData);
     uint8_t crsfFrameCRC(void);
     uint8_t crsfFrameCmdCRC(void);
     uint8_t crsfFrameStatus(void);
@@ -507,11 +508,74 @@ TEST(CrossFireTest, TestInvalidFrameLengthBoundsAreRejectedAndRecover)
     }
 }
 
+TEST(CrossFireTest, TestFrameCallbackReceivesBackToBackFrames)
+{
+    uint8_t block[2 * CRSF_FRAME_SIZE_MAX];
+    rxRuntimeState_t rxRuntimeState = {};
+
+    memset(&crsfFrame, 0, sizeof(crsfFrame));
+    crsfFrameDone = false;
+    dummyTimeUs += 10000;
+
+    // two complete frames arriving in one idle line burst, only the second is addressed to us
+    size_t blockSize = 0;
+    const size_t firstFrameSize = buildCrsfFrame(&block[blockSize], CRSF_FRAME_LENGTH_TYPE_CRC + 4, CRSF_ADDRESS_BROADCAST);
+    blockSize += firstFrameSize;
+    const size_t secondFrameSize = buildCrsfFrame(&block[blockSize], CRSF_FRAME_LENGTH_TYPE_CRC + 8, CRSF_ADDRESS_FLIGHT_CONTROLLER);
+    blockSize += secondFrameSize;
+
+    crsfDataReceiveFrame(block, blockSize, &rxRuntimeState);
+
+    EXPECT_TRUE(crsfFrameDone);
+    EXPECT_EQ(dummyTimeUs, rxRuntimeState.lastRcFrameTimeUs);
+    EXPECT_EQ(CRSF_ADDRESS_FLIGHT_CONTROLLER, crsfChannelDataFrame.frame.deviceAddress);
+    EXPECT_EQ(CRSF_FRAME_LENGTH_TYPE_CRC + 8, crsfChannelDataFrame.frame.frameLength);
+    EXPECT_EQ(0, memcmp(crsfChannelDataFrame.bytes, &block[firstFrameSize], secondFrameSize));
+}
+
+TEST(CrossFireTest, TestFrameCallbackReassemblesWrappedFrame)
+{
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    rxRuntimeState_t rxRuntimeState = {};
+
+    memset(&crsfFrame, 0, sizeof(crsfFrame));
+    crsfFrameDone = false;
+    dummyTimeUs += 10000;
+
+    // a frame split at the end of the DMA ring arrives as two consecutive blocks
+    const size_t frameSize = buildCrsfFrame(frame, CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC, CRSF_ADDRESS_FLIGHT_CONTROLLER);
+    const size_t split = 7;
+    crsfDataReceiveFrame(frame, split, &rxRuntimeState);
+    EXPECT_FALSE(crsfFrameDone);
+    crsfDataReceiveFrame(&frame[split], frameSize - split, &rxRuntimeState);
+
+    EXPECT_TRUE(crsfFrameDone);
+    EXPECT_EQ(0, memcmp(crsfChannelDataFrame.bytes, frame, frameSize));
+}
+
+TEST(CrossFireTest, TestFrameCallbackRejectsBadCrc)
+{
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    rxRuntimeState_t rxRuntimeState = {};
+
+    memset(&crsfFrame, 0, sizeof(crsfFrame));
+    crsfFrameDone = false;
+    dummyTimeUs += 10000;
+
+    const size_t frameSize = buildCrsfFrame(frame, CRSF_FRAME_LENGTH_TYPE_CRC + 4, CRSF_ADDRESS_FLIGHT_CONTROLLER);
+    frame[frameSize - 1] ^= 0xff;
+    crsfDataReceiveFrame(frame, frameSize, &rxRuntimeState);
+
+    EXPECT_FALSE(crsfFrameDone);
+    EXPECT_EQ(0, rxRuntimeState.lastRcFrameTimeUs);
+}
+
 // STUBS
 
 extern "C" {
 
 int16_t debug[DEBUG16_VALUE_COUNT];
+uint8_t debugMode;
 uint32_t micros(void) {return dummyTimeUs;}
 uint32_t microsISR(void) {return micros();}
 serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, void *, uint32_t, portMode_e, portOptions_e) {return NULL;}
@@ -0,0 +1,142 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/debug.h"
+
+    #include "rx/rc_latency.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static timeUs_t stubFrameTimeUs;
+static timeDelta_t stubSmoothingDelayUs;
+
+// drive one frame through the pipeline: driver timestamp, rxFrameCheck(), processRcCommand(), writeMotors()
+static void passFrame(timeUs_t frameTimeUs, timeUs_t detectedUs, timeUs_t consumedUs, timeUs_t motorsUs)
+{
+    rcLatencyFrameReceived(frameTimeUs, detectedUs);
+    stubFrameTimeUs = frameTimeUs;
+    rcLatencyRcDataConsumed(consumedUs);
+    rcLatencyMotorsWritten(motorsUs);
+}
+
+TEST(RcLatencyUnittest, TestStagesOfSingleFrame)
+{
+    rcLatencyReset();
+    stubSmoothingDelayUs = 1500;
+
+    passFrame(10000, 10100, 10350, 10400);
+
+    EXPECT_EQ(100u, rcLatencyGetStats(RC_LATENCY_RX_PARSE)->lastUs);
+    EXPECT_EQ(250u, rcLatencyGetStats(RC_LATENCY_SCHEDULER_WAIT)->lastUs);
+    EXPECT_EQ(1500u, rcLatencyGetStats(RC_LATENCY_SMOOTHING)->lastUs);
+    EXPECT_EQ(50u, rcLatencyGetStats(RC_LATENCY_MOTOR_OUTPUT)->lastUs);
+    EXPECT_EQ(1900u, rcLatencyGetStats(RC_LATENCY_TOTAL)->lastUs);
+    for (int stage = 0; stage < RC_LATENCY_STAGE_COUNT; stage++) {
+        EXPECT_EQ(1u, rcLatencyGetStats((rcLatencyStage_e)stage)->count);
+    }
+}
+
+TEST(RcLatencyUnittest, TestFrameIsCountedOnce)
+{
+    rcLatencyReset();
+    stubSmoothingDelayUs = 0;
+
+    passFrame(20000, 20050, 20100, 20150);
+
+    // later PID loops reuse the same rcData and must not add samples
+    rcLatencyRcDataConsumed(20225);
+    rcLatencyMotorsWritten(20250);
+    rcLatencyRcDataConsumed(20350);
+    rcLatencyMotorsWritten(20375);
+
+    EXPECT_EQ(1u, rcLatencyGetStats(RC_LATENCY_SCHEDULER_WAIT)->count);
+    EXPECT_EQ(1u, rcLatencyGetStats(RC_LATENCY_TOTAL)->count);
+    EXPECT_EQ(150u, rcLatencyGetStats(RC_LATENCY_TOTAL)->lastUs);
+}
+
+TEST(RcLatencyUnittest, TestNoSampleWithoutFrameTimestamp)
+{
+    rcLatencyReset();
+
+    // rcData refreshed by signal loss handling carries no frame
+    stubFrameTimeUs = 0;
+    rcLatencyRcDataConsumed(30000);
+    rcLatencyMotorsWritten(30100);
+
+    EXPECT_EQ(0u, rcLatencyGetStats(RC_LATENCY_SCHEDULER_WAIT)->count);
+    EXPECT_EQ(0u, rcLatencyGetStats(RC_LATENCY_TOTAL)->count);
+}
+
+TEST(RcLatencyUnittest, TestHistogramAndAverage)
+{
+    rcLatencyReset();
+    stubSmoothingDelayUs = 0;
+
+    const timeUs_t totals[] = { 10, 63, 64, 127, 128, 1000, 200000 };
+    timeUs_t frameTimeUs = 100000;
+    for (unsigned i = 0; i < ARRAYLEN(totals); i++) {
+        frameTimeUs += 1000000;
+        passFrame(frameTimeUs, frameTimeUs, frameTimeUs, frameTimeUs + totals[i]);
+    }
+
+    const rcLatencyStats_t *stats = rcLatencyGetStats(RC_LATENCY_TOTAL);
+    EXPECT_EQ(ARRAYLEN(totals), stats->count);
+    EXPECT_EQ(10u, stats->minUs);
+    EXPECT_EQ(200000u, stats->maxUs);
+    EXPECT_EQ((10u + 63 + 64 + 127 + 128 + 1000 + 200000) / 7, rcLatencyGetAverageUs(RC_LATENCY_TOTAL));
+
+    EXPECT_EQ(2u, stats->bucket[0]);   // below 64us
+    EXPECT_EQ(2u, stats->bucket[1]);   // below 128us
+    EXPECT_EQ(1u, stats->bucket[2]);   // below 256us
+    EXPECT_EQ(1u, stats->bucket[4]);   // below 1024us
+    EXPECT_EQ(1u, stats->bucket[RC_LATENCY_BUCKET_COUNT - 1]);
+}
+
+TEST(RcLatencyUnittest, TestReset)
+{
+    stubSmoothingDelayUs = 0;
+    passFrame(40000, 40010, 40020, 40030);
+    EXPECT_NE(0u, rcLatencyGetStats(RC_LATENCY_TOTAL)->count);
+
+    rcLatencyReset();
+
+    for (int stage = 0; stage < RC_LATENCY_STAGE_COUNT; stage++) {
+        EXPECT_EQ(0u, rcLatencyGetStats((rcLatencyStage_e)stage)->count);
+        EXPECT_EQ(0u, rcLatencyGetAverageUs((rcLatencyStage_e)stage));
+    }
+}
+
+// STUBS
+
+extern "C" {
+    int16_t debug[DEBUG16_VALUE_COUNT];
+    uint8_t debugMode;
+
+    timeUs_t rxFrameTimeUs(void) { return stubFrameTimeUs; }
+    timeDelta_t rcSmoothingGetSetpointDelayUs(void) { return stubSmoothingDelayUs; }
+}
@@ -0,0 +1,398 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "blackbox/blackbox.h"
+    #include "blackbox/blackbox_encoding.h"
+    #include "blackbox/blackbox_fielddefs.h"
+    #include "blackbox/blackbox_io.h"
+
+    #include "common/maths.h"
+    #include "common/utils.h"
+
+    #include "sitl_blackbox_decode.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// The firmware's own encoders write into this
+static std::vector<uint8_t> logData;
+
+static void writeText(const char *text)
+{
+    logData.insert(logData.end(), text, text + strlen(text));
+}
+
+// Minimal header in the shape blackbox.c writes, with the given field lines
+static void writeHeader(const char *fieldLines)
+{
+    writeText("H Product:Blackbox flight data recorder by Nicholas Sherlock\n"
+              "H Data version:2\n"
+              "H I interval:32\n"
+              "H P interval:1\n"
+              "H vbatref:420\n"
+              "H motorOutput:1000,2000\n");
+    writeText(fieldLines);
+}
+
+// Main frame fields exercising every encoding and predictor a main frame uses
+#define MAIN_FIELDS \
+    "H Field I name:loopIteration,time,axisI[0],axisI[1],axisI[2],rcCommand[0],rcCommand[1],rcCommand[2],rcCommand[3],vbatLatest,baroAlt,gyroADC[0],motor[0],motor[1]\n" \
+    "H Field I signed:0,0,1,1,1,1,1,1,0,0,1,1,0,0\n" \
+    "H Field I predictor:0,0,0,0,0,0,0,0,0,9,0,0,11,5\n" \
+    "H Field I encoding:1,1,0,0,0,0,0,0,1,3,0,0,1,0\n" \
+    "H Field P predictor:6,2,1,1,1,1,1,1,1,1,1,3,3,3\n" \
+    "H Field P encoding:9,0,7,7,7,8,8,8,8,6,6,0,0,0\n"
+
+typedef struct {
+    uint32_t iteration;
+    uint32_t time;
+    int32_t axisI[3];
+    int16_t rcCommand[4];
+    uint16_t vbat;
+    int32_t baroAlt;
+    int16_t gyro;
+    int16_t motor[2];
+} mainState_t;
+
+// As writeIntraframe() does it
+static void writeIFrame(const mainState_t *s)
+{
+    blackboxWrite('I');
+    blackboxWriteUnsignedVB(s->iteration);
+    blackboxWriteUnsignedVB(s->time);
+    blackboxWriteSignedVBArray((int32_t *)s->axisI, 3);
+    blackboxWriteSigned16VBArray((int16_t *)s->rcCommand, 3);
+    blackboxWriteUnsignedVB(s->rcCommand[3]);
+    blackboxWriteUnsignedVB((420 - s->vbat) & 0x3FFF);
+    blackboxWriteSignedVB(s->baroAlt);
+    blackboxWriteSignedVB(s->gyro);
+    blackboxWriteUnsignedVB(s->motor[0] - 1000);
+    blackboxWriteSignedVB(s->motor[1] - s->motor[0]);
+}
+
+// As writeInterframe() does it
+static void writePFrame(const mainState_t *s, const mainState_t *prev, const mainState_t *prev2)
+{
+    int32_t deltas[4];
+
+    blackboxWrite('P');
+    blackboxWriteSignedVB((int32_t)(s->time - (2 * prev->time - prev2->time)));
+    for (int i = 0; i < 3; i++) {
+        deltas[i] = s->axisI[i] - prev->axisI[i];
+    }
+    blackboxWriteTag2_3S32(deltas);
+    for (int i = 0; i < 4; i++) {
+        deltas[i] = s->rcCommand[i] - prev->rcCommand[i];
+    }
+    blackboxWriteTag8_4S16(deltas);
+    deltas[0] = (int32_t)s->vbat - prev->vbat;
+    deltas[1] = s->baroAlt - prev->baroAlt;
+    blackboxWriteTag8_8SVB(deltas, 2);
+    blackboxWriteSignedVB(s->gyro - (prev->gyro + prev2->gyro) / 2);
+    for (int i = 0; i < 2; i++) {
+        blackboxWriteSignedVB(s->motor[i] - (prev->motor[i] + prev2->motor[i]) / 2);
+    }
+}
+
+static void expectMainFrame(const blackboxDecoder_t *decoder, const mainState_t *s)
+{
+    const int32_t *f = decoder->main[0];
+
+    EXPECT_EQ(s->iteration, (uint32_t)f[0]);
+    EXPECT_EQ(s->time, (uint32_t)f[1]);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(s->axisI[i], f[2 + i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(s->rcCommand[i], f[5 + i]);
+    }
+    EXPECT_EQ(s->vbat, f[9]);
+    EXPECT_EQ(s->baroAlt, f[10]);
+    EXPECT_EQ(s->gyro, f[11]);
+    EXPECT_EQ(s->motor[0], f[12]);
+    EXPECT_EQ(s->motor[1], f[13]);
+}
+
+class SitlBlackboxDecodeTest : public ::testing::Test {
+protected:
+    blackboxDecoder_t decoder;
+    uint32_t seed = 12345;
+
+    void SetUp() override
+    {
+        logData.clear();
+    }
+
+    bool init()
+    {
+        return blackboxDecodeInit(&decoder, logData.data(), logData.size());
+    }
+
+    int32_t random(int32_t range)
+    {
+        seed = seed * 1103515245 + 12345;
+        return (int32_t)((seed >> 8) % (2 * range + 1)) - range;
+    }
+};
+
+TEST_F(SitlBlackboxDecodeTest, ParsesTheHeader)
+{
+    writeHeader(MAIN_FIELDS);
+    writeText("H looptime:125\nH acc_1G:2048\nH blackbox_high_resolution:1\n");
+
+    ASSERT_TRUE(init());
+    EXPECT_EQ(14, decoder.iDefs.count);
+    EXPECT_EQ(14, decoder.pDefs.count);
+    EXPECT_EQ(32, decoder.iInterval);
+    EXPECT_EQ(1, decoder.pInterval);
+    EXPECT_EQ(420, decoder.vbatref);
+    EXPECT_EQ(1000, decoder.motorOutputLow);
+    EXPECT_EQ(2000, decoder.motorOutputHigh);
+    EXPECT_EQ(125, decoder.looptimeUs);
+    EXPECT_EQ(2048, decoder.acc1G);
+    EXPECT_TRUE(decoder.highResolution);
+    EXPECT_EQ(11, blackboxDecodeFieldIndex(&decoder.iDefs, "gyroADC[0]"));
+    EXPECT_STREQ("gyroADC[0]", decoder.pDefs.name[11]);
+    EXPECT_EQ(-1, blackboxDecodeFieldIndex(&decoder.iDefs, "gyroADC[1]"));
+    EXPECT_EQ(FLIGHT_LOG_FIELD_ENCODING_TAG2_3S32, decoder.pDefs.encoding[2]);
+
+    // End of the header, no frames
+    EXPECT_EQ(0, blackboxDecodeNextFrame(&decoder));
+}
+
+TEST_F(SitlBlackboxDecodeTest, NoHeaderIsNotALog)
+{
+    writeText("garbage");
+    EXPECT_FALSE(init());
+}
+
+TEST_F(SitlBlackboxDecodeTest, RoundTripsMainFramesWrittenWithTheFirmwareEncoders)
+{
+    writeHeader(MAIN_FIELDS);
+
+    // Values swing across every size class of the packed encodings
+    std::vector<mainState_t> states;
+    mainState_t s = {};
+    for (int n = 0; n < 300; n++) {
+        const int32_t scale = (n % 7 == 0) ? 40000 : (n % 3 == 0) ? 200 : 5;
+        s.iteration = n;
+        s.time = 1000000 + 125 * n + random(n % 5 == 0 ? 3000 : 2);
+        for (int i = 0; i < 3; i++) {
+            s.axisI[i] += random(scale);
+        }
+        for (int i = 0; i < 3; i++) {
+            s.rcCommand[i] = constrain(s.rcCommand[i] + random(scale), -500, 500);
+        }
+        s.rcCommand[3] = constrain(s.rcCommand[3] + random(scale), 1000, 2000);
+        s.vbat = 400 + random(n % 11 == 0 ? 20 : 0);
+        s.baroAlt += random(n % 13 == 0 ? 500 : 0);
+        s.gyro = random(scale > 2000 ? 2000 : scale);
+        s.motor[0] = 1000 + abs(random(1000));
+        s.motor[1] = 1000 + abs(random(1000));
+        states.push_back(s);
+
+        if (n % 32 == 0) {
+            writeIFrame(&states[n]);
+        } else {
+            writePFrame(&states[n], &states[n - 1], &states[n > 1 && (n - 1) % 32 != 0 ? n - 2 : n - 1]);
+        }
+    }
+
+    ASSERT_TRUE(init());
+    for (int n = 0; n < 300; n++) {
+        const char type = blackboxDecodeNextFrame(&decoder);
+        ASSERT_EQ(n % 32 == 0 ? 'I' : 'P', type) << "frame " << n;
+        expectMainFrame(&decoder, &states[n]);
+    }
+    EXPECT_EQ(0, blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(0U, decoder.corruptFrames);
+}
+
+TEST_F(SitlBlackboxDecodeTest, DecodesTheVariableWidthTriple)
+{
+    writeHeader("H Field I name:loopIteration,a,b,c\n"
+                "H Field I signed:0,1,1,1\n"
+                "H Field I predictor:0,0,0,0\n"
+                "H Field I encoding:1,10,10,10\n");
+
+    // Values from each of the 2, 554, 877 and 32 bit classes, at the edges the
+    // packed fields can hold
+    const int32_t samples[][3] = {
+        { 0, 1, -2 }, { 15, -16, 7 }, { -16, 15, -8 }, { 127, -64, 63 },
+        { -128, 63, -64 }, { 256, 40000, -9000000 }, { INT32_MIN, INT32_MAX, -1 },
+    };
+    for (unsigned n = 0; n < ARRAYLEN(samples); n++) {
+        blackboxWrite('I');
+        blackboxWriteUnsignedVB(n);
+        blackboxWriteTag2_3SVariable((int32_t *)samples[n]);
+    }
+
+    ASSERT_TRUE(init());
+    for (unsigned n = 0; n < ARRAYLEN(samples); n++) {
+        ASSERT_EQ('I', blackboxDecodeNextFrame(&decoder));
+        EXPECT_EQ(samples[n][0], decoder.main[0][1]);
+        EXPECT_EQ(samples[n][1], decoder.main[0][2]);
+        EXPECT_EQ(samples[n][2], decoder.main[0][3]);
+    }
+}
+
+TEST_F(SitlBlackboxDecodeTest, GpsFramesPredictFromHomeAndTheLastMainFrame)
+{
+    writeHeader("H Field I name:loopIteration,time\n"
+                "H Field I signed:0,0\n"
+                "H Field I predictor:0,0\n"
+                "H Field I encoding:1,1\n"
+                "H Field G name:time,GPS_numSat,GPS_coord[0],GPS_coord[1],GPS_altitude\n"
+                "H Field G signed:0,0,1,1,1\n"
+                "H Field G predictor:10,0,7,7,0\n"
+                "H Field G encoding:1,1,0,0,0\n"
+                "H Field H name:GPS_home[0],GPS_home[1]\n"
+                "H Field H signed:1,1\n"
+                "H Field H predictor:0,0\n"
+                "H Field H encoding:0,0\n");
+
+    // As writeIntraframe(), writeGPSHomeFrame() and writeGPSFrame() do it
+    blackboxWrite('I');
+    blackboxWriteUnsignedVB(0);
+    blackboxWriteUnsignedVB(5000000);
+    blackboxWrite('H');
+    blackboxWriteSignedVB(-275000000);
+    blackboxWriteSignedVB(1530000000);
+    blackboxWrite('G');
+    blackboxWriteUnsignedVB(5000350 - 5000000);
+    blackboxWriteUnsignedVB(12);
+    blackboxWriteSignedVB(-275000123 - -275000000);
+    blackboxWriteSignedVB(1530000456 - 1530000000);
+    blackboxWriteSignedVB(305);
+
+    ASSERT_TRUE(init());
+    EXPECT_EQ('I', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ('H', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(-275000000, decoder.gpsHome[0]);
+    ASSERT_EQ('G', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(5000350, decoder.gps[0]);
+    EXPECT_EQ(12, decoder.gps[1]);
+    EXPECT_EQ(-275000123, decoder.gps[2]);
+    EXPECT_EQ(1530000456, decoder.gps[3]);
+    EXPECT_EQ(305, decoder.gps[4]);
+}
+
+TEST_F(SitlBlackboxDecodeTest, StopsAtTheLogEndEvent)
+{
+    writeHeader("H Field I name:loopIteration,time\n"
+                "H Field I signed:0,0\n"
+                "H Field I predictor:0,0\n"
+                "H Field I encoding:1,1\n");
+    blackboxWrite('I');
+    blackboxWriteUnsignedVB(0);
+    blackboxWriteUnsignedVB(1000);
+    // As blackboxLogEvent() does it
+    blackboxWrite('E');
+    blackboxWrite(FLIGHT_LOG_EVENT_FLIGHTMODE);
+    blackboxWriteUnsignedVB(0x5);
+    blackboxWriteUnsignedVB(0x1);
+    blackboxWrite('E');
+    blackboxWrite(FLIGHT_LOG_EVENT_LOG_END);
+    writeText("End of log");
+    blackboxWrite(0);
+    // The next log in the same file
+    writeHeader("");
+
+    ASSERT_TRUE(init());
+    EXPECT_EQ('I', blackboxDecodeNextFrame(&decoder));
+    ASSERT_EQ('E', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(FLIGHT_LOG_EVENT_FLIGHTMODE, decoder.event);
+    EXPECT_EQ(0x5U, decoder.eventValue[0]);
+    EXPECT_EQ(0x1U, decoder.eventValue[1]);
+    ASSERT_EQ('E', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(FLIGHT_LOG_EVENT_LOG_END, decoder.event);
+    EXPECT_EQ(0, blackboxDecodeNextFrame(&decoder));
+    EXPECT_TRUE(decoder.ended);
+}
+
+TEST_F(SitlBlackboxDecodeTest, ResynchronisesOnTheNextIntraframe)
+{
+    writeHeader("H Field I name:loopIteration,time\n"
+                "H Field I signed:0,0\n"
+                "H Field I predictor:0,0\n"
+                "H Field I encoding:1,1\n"
+                "H Field P predictor:6,2\n"
+                "H Field P encoding:9,0\n");
+
+    uint32_t time = 1000;
+    for (int n = 0; n < 64; n++, time += 1000) {
+        if (n % 32 == 0) {
+            blackboxWrite('I');
+            blackboxWriteUnsignedVB(n);
+            blackboxWriteUnsignedVB(time);
+        } else {
+            // The straight line prediction only has a slope from the second P frame on
+            blackboxWrite('P');
+            blackboxWriteSignedVB(n % 32 == 1 ? 1000 : 0);
+        }
+        if (n == 10) {
+            // A dropped byte run on the serial link
+            blackboxWrite(0xFF);
+            blackboxWrite(0x13);
+        }
+    }
+
+    ASSERT_TRUE(init());
+    // Frames 0..9 decode, frame 10 is not followed by a frame and the deltas
+    // after it have no base
+    for (int n = 0; n < 10; n++) {
+        ASSERT_EQ(n == 0 ? 'I' : 'P', blackboxDecodeNextFrame(&decoder));
+        EXPECT_EQ(n, decoder.main[0][0]);
+    }
+    ASSERT_EQ('I', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(32, decoder.main[0][0]);
+    EXPECT_EQ(33000, decoder.main[0][1]);
+    ASSERT_EQ('P', blackboxDecodeNextFrame(&decoder));
+    EXPECT_EQ(33, decoder.main[0][0]);
+    EXPECT_EQ(34000, decoder.main[0][1]);
+    EXPECT_EQ(1U, decoder.corruptFrames);
+}
+
+// STUBS
+
+extern "C" {
+int32_t blackboxHeaderBudget;
+
+void blackboxWrite(uint8_t value)
+{
+    logData.push_back(value);
+}
+
+int blackboxWriteString(const char *s)
+{
+    writeText(s);
+    return strlen(s);
+}
+}
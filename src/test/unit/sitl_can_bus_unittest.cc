@@ -0,0 +1,162 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "sitl_can_bus.h"
+}
+
+static const uint32_t bitrate = 1000000;    // one bit per microsecond
+
+static sitlCanWireFrame_t makeFrame(uint32_t id, bool isExtended, uint8_t length, uint64_t startNs)
+{
+    sitlCanWireFrame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.magic = SITL_CAN_MAGIC;
+    frame.startNs = startNs;
+    frame.bitrate = bitrate;
+    frame.id = id;
+    frame.flags = isExtended ? SITL_CAN_FLAG_EXTENDED : 0;
+    frame.length = length;
+    memset(frame.data, 0xa5, length);
+    frame.bits = sitlCanFrameBits(id, isExtended, frame.data, length);
+    return frame;
+}
+
+TEST(SitlCanBusTest, CountsStuffBits)
+{
+    // SOF, identifier, control field and CRC all dominant: 34 bits stuffed
+    // after every fifth, then the 13 bit tail
+    EXPECT_EQ(34 + 6 + 13, sitlCanFrameBits(0, false, NULL, 0));
+
+    // an extended frame of eight bytes is 131 bits before stuffing, and
+    // stuffing adds at most one bit in four after the first
+    const uint8_t ones[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    const uint16_t bits = sitlCanFrameBits(0x1fffffff, true, ones, 8);
+    EXPECT_GT(bits, 131);
+    EXPECT_LE(bits, 131 + (118 - 1) / 4);
+
+    // alternating levels need no stuffing
+    const uint8_t alternating[8] = { 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55 };
+    EXPECT_GE(sitlCanFrameBits(0x555, false, alternating, 8), 111);
+}
+
+TEST(SitlCanBusTest, LowerIdentifiersWinArbitration)
+{
+    EXPECT_LT(sitlCanArbitrationKey(0x100, false), sitlCanArbitrationKey(0x101, false));
+    // same base identifier: the standard frame's dominant RTR wins over SRR
+    EXPECT_LT(sitlCanArbitrationKey(0x100, false), sitlCanArbitrationKey(0x100 << 18, true));
+    EXPECT_LT(sitlCanArbitrationKey(0x0ffffff, true), sitlCanArbitrationKey(0x1000000, true));
+    EXPECT_LT(sitlCanArbitrationKey(0x0ff, false), sitlCanArbitrationKey(0x100 << 18, true));
+}
+
+TEST(SitlCanBusTest, FramesReadyTogetherGoInPriorityOrder)
+{
+    sitlCanBus_t bus;
+    sitlCanBusInit(&bus, bitrate);
+
+    const sitlCanWireFrame_t low = makeFrame(0x18000000, true, 8, 1000);
+    const sitlCanWireFrame_t high = makeFrame(0x08000000, true, 8, 1000);
+    EXPECT_TRUE(sitlCanBusAnnounce(&bus, &low, true, 0));
+    EXPECT_TRUE(sitlCanBusAnnounce(&bus, &high, false, 0));
+
+    const uint64_t highEnd = 1000 + sitlCanBusFrameNs(&bus, high.bits);
+    const uint64_t lowEnd = highEnd + sitlCanBusFrameNs(&bus, low.bits);
+    EXPECT_EQ(highEnd, sitlCanBusDeadline(&bus));
+    EXPECT_EQ(lowEnd, sitlCanBusIdleFrom(&bus));
+
+    sitlCanPending_t done;
+    EXPECT_FALSE(sitlCanBusComplete(&bus, highEnd - 1, &done));
+    ASSERT_TRUE(sitlCanBusComplete(&bus, highEnd, &done));
+    EXPECT_EQ(high.id, done.frame.id);
+    EXPECT_FALSE(done.own);
+
+    ASSERT_TRUE(sitlCanBusComplete(&bus, lowEnd, &done));
+    EXPECT_EQ(low.id, done.frame.id);
+    EXPECT_TRUE(done.own);
+    EXPECT_EQ(highEnd, done.startNs);
+
+    EXPECT_EQ(1u, bus.ownFrames);
+    EXPECT_EQ(highEnd - 1000, bus.ownWaitMaxNs);
+    EXPECT_EQ(lowEnd - 1000, bus.busyNs);
+    EXPECT_EQ(UINT64_MAX, sitlCanBusDeadline(&bus));
+}
+
+TEST(SitlCanBusTest, FrameOnTheBusKeepsIt)
+{
+    sitlCanBus_t bus;
+    sitlCanBusInit(&bus, bitrate);
+
+    const sitlCanWireFrame_t first = makeFrame(0x7ff, false, 8, 0);
+    EXPECT_TRUE(sitlCanBusAnnounce(&bus, &first, false, 0));
+
+    // a higher priority frame that became ready earlier, announced late
+    const sitlCanWireFrame_t urgent = makeFrame(0x001, false, 1, 0);
+    EXPECT_TRUE(sitlCanBusAnnounce(&bus, &urgent, false, 10000));
+    EXPECT_EQ(0u, bus.lateFrames);
+
+    sitlCanPending_t done;
+    ASSERT_TRUE(sitlCanBusComplete(&bus, UINT64_MAX, &done));
+    EXPECT_EQ(first.id, done.frame.id);
+    ASSERT_TRUE(sitlCanBusComplete(&bus, UINT64_MAX, &done));
+    EXPECT_EQ(urgent.id, done.frame.id);
+    EXPECT_EQ(sitlCanBusFrameNs(&bus, first.bits), done.startNs);
+}
+
+TEST(SitlCanBusTest, CountsFramesStartedBeforeTheOneOnTheBus)
+{
+    sitlCanBus_t bus;
+    sitlCanBusInit(&bus, bitrate);
+
+    const sitlCanWireFrame_t first = makeFrame(0x100, false, 8, 5000);
+    EXPECT_TRUE(sitlCanBusAnnounce(&bus, &first, false, 5000));
+    const sitlCanWireFrame_t early = makeFrame(0x200, false, 8, 4000);
+    EXPECT_TRUE(sitlCanBusAnnounce(&bus, &early, false, 6000));
+    EXPECT_EQ(1u, bus.lateFrames);
+
+    sitlCanPending_t done;
+    ASSERT_TRUE(sitlCanBusComplete(&bus, UINT64_MAX, &done));
+    EXPECT_EQ(first.id, done.frame.id);
+}
+
+TEST(SitlCanBusTest, RejectsOtherBitRatesAndOverflow)
+{
+    sitlCanBus_t bus;
+    sitlCanBusInit(&bus, bitrate);
+
+    sitlCanWireFrame_t frame = makeFrame(0x123, false, 2, 0);
+    frame.bitrate = 500000;
+    EXPECT_FALSE(sitlCanBusAnnounce(&bus, &frame, false, 0));
+    EXPECT_EQ(1u, bus.bitrateErrors);
+
+    frame.bitrate = bitrate;
+    for (int i = 0; i < SITL_CAN_PENDING_LENGTH; i++) {
+        EXPECT_TRUE(sitlCanBusAnnounce(&bus, &frame, false, 0));
+    }
+    EXPECT_FALSE(sitlCanBusAnnounce(&bus, &frame, false, 0));
+    EXPECT_EQ(1u, bus.overflows);
+    EXPECT_EQ((uint64_t)SITL_CAN_PENDING_LENGTH * sitlCanBusFrameNs(&bus, frame.bits), sitlCanBusIdleFrom(&bus));
+}
@@ -0,0 +1,232 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "sitl_physics.h"
+}
+
+#define STEP_S  0.001
+
+class SitlPhysicsTest : public ::testing::Test {
+protected:
+    sitlPhysicsConfig_t config;
+    sitlPhysicsState_t state;
+
+    void SetUp() override
+    {
+        sitlPhysicsConfigDefaults(&config);
+        sitlPhysicsInit(&state, &config);
+    }
+
+    // Command that holds the whole craft's weight, all motors equal
+    double hoverCommand() const
+    {
+        const double fraction = config.massKg * 9.80665 / SITL_PHYSICS_MOTOR_COUNT / config.maxThrustN;
+        const double a = config.thrustExpo;
+        const double b = 1.0 - config.thrustExpo;
+        return (-b + sqrt(b * b + 4.0 * a * fraction)) / (2.0 * a);
+    }
+
+    void run(const double command[SITL_PHYSICS_MOTOR_COUNT], double seconds)
+    {
+        for (int i = 0; i < lrint(seconds / STEP_S); i++) {
+            sitlPhysicsStep(&state, &config, command, STEP_S);
+        }
+    }
+
+    // Airborne and level at 10 m with the motors spun up to hover
+    void hoverAt10m()
+    {
+        state.now.posNwuM[2] = 10.0;
+        state.onGround = false;
+        for (int i = 0; i < SITL_PHYSICS_MOTOR_COUNT; i++) {
+            state.motorThrustN[i] = config.massKg * 9.80665 / SITL_PHYSICS_MOTOR_COUNT;
+        }
+    }
+};
+
+TEST_F(SitlPhysicsTest, RestsOnTheGroundFeelingOneG)
+{
+    const double idle[SITL_PHYSICS_MOTOR_COUNT] = { 0.05, 0.05, 0.05, 0.05 };
+    run(idle, 2.0);
+
+    EXPECT_TRUE(state.onGround);
+    EXPECT_DOUBLE_EQ(0.0, state.now.posNwuM[2]);
+    EXPECT_NEAR(0.0, state.now.specificForceMps2[0], 1e-9);
+    EXPECT_NEAR(0.0, state.now.specificForceMps2[1], 1e-9);
+    EXPECT_NEAR(9.80665, state.now.specificForceMps2[2], 1e-9);
+}
+
+TEST_F(SitlPhysicsTest, HoverCommandHoldsAltitude)
+{
+    hoverAt10m();
+    const double u = hoverCommand();
+    const double command[SITL_PHYSICS_MOTOR_COUNT] = { u, u, u, u };
+    run(command, 5.0);
+
+    EXPECT_NEAR(10.0, state.now.posNwuM[2], 0.01);
+    EXPECT_NEAR(0.0, state.now.velNwuMps[2], 0.01);
+    EXPECT_NEAR(9.80665, state.now.specificForceMps2[2], 0.01);
+    // a craft fitted with the default airframe hovers in the mid-throttle range
+    EXPECT_GT(u, 0.25);
+    EXPECT_LT(u, 0.5);
+}
+
+TEST_F(SitlPhysicsTest, MotorsLagTheCommand)
+{
+    const double full[SITL_PHYSICS_MOTOR_COUNT] = { 1.0, 1.0, 1.0, 1.0 };
+    run(full, config.motorTauS);
+
+    // one time constant reaches 1 - 1/e of the step
+    EXPECT_NEAR(config.maxThrustN * (1.0 - exp(-1.0)), state.motorThrustN[0], 0.01);
+    EXPECT_FALSE(state.onGround);
+}
+
+// Motor layout and spin follow the BF quad-X mixer: M1 RR, M2 FR, M3 RL, M4 FL
+TEST_F(SitlPhysicsTest, LeftMotorsRollRight)
+{
+    hoverAt10m();
+    const double u = hoverCommand();
+    const double command[SITL_PHYSICS_MOTOR_COUNT] = { u - 0.02, u - 0.02, u + 0.02, u + 0.02 };
+    run(command, 0.1);
+
+    EXPECT_GT(state.now.rateRadS[0], 0.5);
+    EXPECT_NEAR(0.0, state.now.rateRadS[1], 1e-6);
+    EXPECT_NEAR(0.0, state.now.rateRadS[2], 1e-6);
+}
+
+TEST_F(SitlPhysicsTest, RearMotorsPitchNoseDown)
+{
+    hoverAt10m();
+    const double u = hoverCommand();
+    const double command[SITL_PHYSICS_MOTOR_COUNT] = { u + 0.02, u - 0.02, u + 0.02, u - 0.02 };
+    run(command, 0.5);
+
+    EXPECT_GT(state.now.rateRadS[1], 0.5);
+    // nose down tips the thrust forward: the craft accelerates north
+    EXPECT_GT(state.now.velNwuMps[0], 0.0);
+}
+
+TEST_F(SitlPhysicsTest, ClockwisePropsYawCounterClockwise)
+{
+    hoverAt10m();
+    const double u = hoverCommand();
+    const double command[SITL_PHYSICS_MOTOR_COUNT] = { u + 0.02, u - 0.02, u - 0.02, u + 0.02 };
+    run(command, 0.5);
+
+    EXPECT_GT(state.now.rateRadS[2], 0.1);
+    EXPECT_NEAR(0.0, state.now.rateRadS[0], 1e-6);
+    EXPECT_NEAR(0.0, state.now.rateRadS[1], 1e-6);
+    // yaw about up turns north toward west (+y)
+    const double yaw = atan2(2.0 * state.now.quat[0] * state.now.quat[3], 1.0 - 2.0 * state.now.quat[3] * state.now.quat[3]);
+    EXPECT_GT(yaw, 0.0);
+}
+
+TEST_F(SitlPhysicsTest, TouchdownShowsAsAnAccelerationSpike)
+{
+    state.now.posNwuM[2] = 2.0;
+    state.onGround = false;
+    const double off[SITL_PHYSICS_MOTOR_COUNT] = { 0.0, 0.0, 0.0, 0.0 };
+
+    double peak = 0.0;
+    for (int i = 0; i < 1000; i++) {
+        sitlPhysicsStep(&state, &config, off, STEP_S);
+        peak = fmax(peak, state.now.specificForceMps2[2]);
+    }
+
+    EXPECT_TRUE(state.onGround);
+    EXPECT_GT(peak, 10.0 * 9.80665);
+    EXPECT_NEAR(9.80665, state.now.specificForceMps2[2], 1e-9);
+}
+
+TEST_F(SitlPhysicsTest, SensedSampleLagsByTheLatency)
+{
+    config.gyroNoiseRadS = 0.0;
+    config.accNoiseMps2 = 0.0;
+    hoverAt10m();
+    const double climb[SITL_PHYSICS_MOTOR_COUNT] = { 0.6, 0.6, 0.6, 0.6 };
+    run(climb, 1.0);
+
+    sitlPhysicsSample_t current, delayed;
+    sitlPhysicsSense(&state, &config, 0.0, &current);
+    sitlPhysicsSense(&state, &config, 0.1, &delayed);
+
+    EXPECT_DOUBLE_EQ(state.now.posNwuM[2], current.posNwuM[2]);
+    EXPECT_NEAR(0.1, current.timeS - delayed.timeS, SITL_PHYSICS_DELAY_STEP_S + 1e-9);
+    EXPECT_LT(delayed.posNwuM[2], current.posNwuM[2]);
+}
+
+TEST_F(SitlPhysicsTest, NoiseIsRepeatableWithUnitVariance)
+{
+    sitlPhysicsState_t other;
+    sitlPhysicsInit(&other, &config);
+
+    double sum = 0.0;
+    double sumSq = 0.0;
+    const int count = 20000;
+    for (int i = 0; i < count; i++) {
+        const double n = sitlPhysicsNoise(&state);
+        EXPECT_DOUBLE_EQ(n, sitlPhysicsNoise(&other));
+        sum += n;
+        sumSq += n * n;
+    }
+
+    EXPECT_NEAR(0.0, sum / count, 0.03);
+    EXPECT_NEAR(1.0, sumSq / count, 0.05);
+}
+
+TEST_F(SitlPhysicsTest, ConfigFileOverridesDefaults)
+{
+    const char *path = "sitl_physics_unittest.cfg";
+    FILE *fp = fopen(path, "w");
+    ASSERT_NE(nullptr, fp);
+    fputs("# 7 inch\n"
+          "mass = 1.1\n"
+          "\n"
+          "inertia_z = 0.012   # heavier props\n"
+          "origin_lat = 47.5\n", fp);
+    fclose(fp);
+
+    EXPECT_TRUE(sitlPhysicsConfigLoad(&config, path));
+    EXPECT_DOUBLE_EQ(1.1, config.massKg);
+    EXPECT_DOUBLE_EQ(0.012, config.inertiaKgM2[2]);
+    EXPECT_DOUBLE_EQ(47.5, config.originLatDeg);
+    EXPECT_DOUBLE_EQ(0.0025, config.inertiaKgM2[0]);
+
+    fp = fopen(path, "w");
+    fputs("mass = 1.1\nwingspan = 2\n", fp);
+    fclose(fp);
+    EXPECT_FALSE(sitlPhysicsConfigLoad(&config, path));
+
+    fp = fopen(path, "w");
+    fputs("mass = -1\n", fp);
+    fclose(fp);
+    sitlPhysicsConfigDefaults(&config);
+    EXPECT_FALSE(sitlPhysicsConfigLoad(&config, path));
+
+    remove(path);
+}
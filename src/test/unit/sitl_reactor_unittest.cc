@@ -0,0 +1,232 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "sitl_reactor.h"
+#include "sitl_spsc.h"
+}
+
+TEST(SitlSpscTest, KeepsOrderAcrossTheWrap)
+{
+    uint32_t storage[4];
+    sitlSpsc_t q;
+    sitlSpscInit(&q, storage, sizeof(uint32_t), 4);
+
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 3; i++) {
+            EXPECT_TRUE(sitlSpscPush(&q, &next));
+            next++;
+        }
+        EXPECT_EQ(3u, sitlSpscCount(&q));
+        uint32_t value;
+        while (sitlSpscPop(&q, &value)) {
+            EXPECT_EQ(expected++, value);
+        }
+    }
+    EXPECT_EQ(next, expected);
+}
+
+TEST(SitlSpscTest, RefusesPushesWhenFull)
+{
+    uint32_t storage[4];
+    sitlSpsc_t q;
+    sitlSpscInit(&q, storage, sizeof(uint32_t), 4);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(sitlSpscPush(&q, &i));
+    }
+    const uint32_t extra = 99;
+    EXPECT_FALSE(sitlSpscPush(&q, &extra));
+    EXPECT_EQ(1u, q.dropped);
+
+    // the oldest records survive
+    uint32_t value;
+    EXPECT_TRUE(sitlSpscPop(&q, &value));
+    EXPECT_EQ(0u, value);
+}
+
+TEST(SitlSpscTest, SpansStopAtTheEndOfStorage)
+{
+    uint8_t storage[8];
+    sitlSpsc_t q;
+    sitlSpscInit(&q, storage, 1, 8);
+
+    void *span;
+    EXPECT_EQ(8u, sitlSpscWritable(&q, &span));
+    sitlSpscCommit(&q, 6);
+    EXPECT_EQ(6u, sitlSpscReadable(&q, &span));
+    sitlSpscRelease(&q, 6);
+
+    // 2 bytes to the end, then the other 6 from the start
+    EXPECT_EQ(2u, sitlSpscWritable(&q, &span));
+    EXPECT_EQ(&storage[6], span);
+    sitlSpscCommit(&q, 2);
+    EXPECT_EQ(6u, sitlSpscWritable(&q, &span));
+    EXPECT_EQ(&storage[0], span);
+}
+
+TEST(SitlSpscTest, HandsOffBetweenThreads)
+{
+    static uint64_t storage[64];
+    sitlSpsc_t q;
+    sitlSpscInit(&q, storage, sizeof(uint64_t), 64);
+    const uint64_t count = 20000;
+
+    std::thread producer([&q, count]() {
+        for (uint64_t i = 0; i < count; i++) {
+            while (!sitlSpscPush(&q, &i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint64_t expected = 0;
+    while (expected < count) {
+        uint64_t value;
+        if (sitlSpscPop(&q, &value)) {
+            ASSERT_EQ(expected, value);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+static int readableCalls;
+static uint8_t lastEvents;
+
+static void onReadable(int fd, uint8_t events, void *context)
+{
+    UNUSED(context);
+    char buffer[16];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+    }
+    if (n == 0) {
+        // level triggered: end of stream would be reported for ever
+        sitlReactorRemove(fd);
+    }
+    lastEvents = events;
+    readableCalls++;
+    sitlReactorNotifyMain();
+}
+
+// The hook runs on the I/O thread; the test holds it there while it raises more wakes
+static std::mutex wakeHookMutex;
+static std::condition_variable wakeHookChanged;
+static std::atomic<int> wakeHookCalls;
+static std::atomic<bool> wakeHookHeld;
+
+static void onWakeHook(void *context)
+{
+    UNUSED(context);
+    std::unique_lock<std::mutex> lock(wakeHookMutex);
+    wakeHookCalls++;
+    wakeHookChanged.notify_all();
+    wakeHookChanged.wait_for(lock, std::chrono::seconds(1), [] { return !wakeHookHeld.load(); });
+    lock.unlock();
+    sitlReactorNotifyMain();
+}
+
+static int timerCalls;
+
+static void onTimer(void *context)
+{
+    UNUSED(context);
+    timerCalls++;
+}
+
+// One reactor per process, so the cases run in sequence on it
+TEST(SitlReactorTest, DispatchesSocketsWakesAndTimers)
+{
+    ASSERT_TRUE(sitlReactorInit());
+    ASSERT_TRUE(sitlReactorAddWakeHook(onWakeHook, NULL));
+    ASSERT_TRUE(sitlReactorStart());
+
+    // Nothing happening: the main loop wait times out
+    EXPECT_FALSE(sitlReactorWaitMain(20000));
+
+    // Data on a socket runs its handler on the I/O thread, which wakes the main loop
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    ASSERT_TRUE(sitlReactorAdd(fds[0], SITL_REACTOR_READ, onReadable, NULL));
+    ASSERT_EQ(1, write(fds[1], "x", 1));
+    EXPECT_TRUE(sitlReactorWaitMain(1000000));
+    EXPECT_EQ(1, readableCalls);
+    EXPECT_TRUE(lastEvents & SITL_REACTOR_READ);
+
+    // Wakes raised while the hooks run are merged into one more run
+    wakeHookHeld = true;
+    sitlReactorWake();
+    {
+        std::unique_lock<std::mutex> lock(wakeHookMutex);
+        ASSERT_TRUE(wakeHookChanged.wait_for(lock, std::chrono::seconds(1), [] { return wakeHookCalls == 1; }));
+    }
+    for (int i = 0; i < 9; i++) {
+        sitlReactorWake();
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeHookMutex);
+        wakeHookHeld = false;
+    }
+    wakeHookChanged.notify_all();
+    {
+        std::unique_lock<std::mutex> lock(wakeHookMutex);
+        EXPECT_TRUE(wakeHookChanged.wait_for(lock, std::chrono::seconds(1), [] { return wakeHookCalls == 2; }));
+    }
+    // and no further run follows
+    usleep(20000);
+    EXPECT_EQ(2, wakeHookCalls);
+    EXPECT_TRUE(sitlReactorWaitMain(1000000));
+
+    // Timers run on their period
+    ASSERT_TRUE(sitlReactorAddTimer(10, onTimer, NULL));
+    usleep(120000);
+    EXPECT_GE(timerCalls, 5);
+    EXPECT_LE(timerCalls, 13);
+
+    // End of stream is reported as readable
+    while (sitlReactorWaitMain(0)) {
+    }
+    close(fds[1]);
+    EXPECT_TRUE(sitlReactorWaitMain(1000000));
+    EXPECT_EQ(2, readableCalls);
+
+    sitlReactorStop();
+    close(fds[0]);
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+
+#include <unistd.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "sitl_shm.h"
+}
+
+typedef struct {
+    double timestamp;
+    double values[17];
+} testFdm_t;
+
+typedef struct {
+    float motors[4];
+} testMotors_t;
+
+class SitlShmTest : public ::testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        snprintf(name, sizeof(name), "/bf_sitl_shm_test_%d", (int)getpid());
+        sitl = sitlShmCreate(name, sizeof(testFdm_t), sizeof(testMotors_t));
+        ASSERT_NE(nullptr, sitl);
+        simulator = sitlShmAttach(name);
+        ASSERT_NE(nullptr, simulator);
+    }
+
+    virtual void TearDown()
+    {
+        sitlShmDetach(simulator);
+        sitlShmDetach(sitl);
+        sitlShmUnlink(name);
+    }
+
+    char name[64];
+    sitlShmRegion_t *sitl;
+    sitlShmRegion_t *simulator;
+};
+
+TEST_F(SitlShmTest, CarriesRecordsBothWays)
+{
+    // separate mappings of the same object, as in two processes
+    ASSERT_NE(sitl, simulator);
+
+    for (int step = 0; step < 3 * SITL_SHM_RING_LENGTH; step++) {
+        testFdm_t fdm = {};
+        fdm.timestamp = step;
+        fdm.values[16] = -step;
+        EXPECT_TRUE(sitlShmPush(&simulator->down, &fdm));
+
+        testFdm_t received;
+        ASSERT_TRUE(sitlShmPop(&sitl->down, &received, NULL));
+        EXPECT_EQ(step, received.timestamp);
+        EXPECT_EQ(-step, received.values[16]);
+        EXPECT_FALSE(sitlShmPop(&sitl->down, &received, NULL));
+
+        testMotors_t motors = { { 0.25f, 0.5f, 0.75f, (float)step } };
+        EXPECT_TRUE(sitlShmPush(&sitl->up, &motors));
+
+        testMotors_t sent;
+        ASSERT_TRUE(sitlShmPop(&simulator->up, &sent, NULL));
+        EXPECT_EQ(0, memcmp(&motors, &sent, sizeof(sent)));
+    }
+}
+
+TEST_F(SitlShmTest, RefusesPushesWhenFull)
+{
+    testMotors_t motors = {};
+    for (int i = 0; i < SITL_SHM_RING_LENGTH; i++) {
+        motors.motors[0] = i;
+        EXPECT_TRUE(sitlShmPush(&sitl->up, &motors));
+    }
+    EXPECT_FALSE(sitlShmPush(&sitl->up, &motors));
+    EXPECT_EQ(1u, simulator->up.dropped);
+
+    // oldest first, nothing overwritten
+    testMotors_t sent;
+    ASSERT_TRUE(sitlShmPop(&simulator->up, &sent, NULL));
+    EXPECT_EQ(0, sent.motors[0]);
+}
+
+TEST_F(SitlShmTest, WaitTimesOutWhenEmpty)
+{
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(sitlShmWait(&sitl->down, 2000));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::microseconds(2000));
+}
+
+TEST_F(SitlShmTest, PushWakesWaiter)
+{
+    std::thread producer([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        testFdm_t fdm = {};
+        fdm.timestamp = 1.5;
+        sitlShmPush(&simulator->down, &fdm);
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(sitlShmWait(&sitl->down, 5000000));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    producer.join();
+
+    testFdm_t received;
+    ASSERT_TRUE(sitlShmPop(&sitl->down, &received, NULL));
+    EXPECT_EQ(1.5, received.timestamp);
+}
+
+TEST_F(SitlShmTest, PopReportsWhenTheRecordWasPushed)
+{
+    testFdm_t fdm = {};
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const uint64_t beforeUs = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    ASSERT_TRUE(sitlShmPush(&simulator->down, &fdm));
+
+    // consumed late: the stamp is still the arrival
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t pushedUs = 0;
+    ASSERT_TRUE(sitlShmPop(&sitl->down, &fdm, &pushedUs));
+    EXPECT_GE(pushedUs, beforeUs);
+    EXPECT_LT(pushedUs, beforeUs + 10000);
+}
+
+TEST_F(SitlShmTest, AttachNeedsALiveRegion)
+{
+    EXPECT_EQ(nullptr, sitlShmAttach("/bf_sitl_shm_test_missing"));
+
+    sitl->magic = 0;
+    EXPECT_EQ(nullptr, sitlShmAttach(name));
+}
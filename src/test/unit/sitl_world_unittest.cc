@@ -0,0 +1,106 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "sitl_world.h"
+}
+
+typedef struct {
+    double timestamp;
+    double position[3];
+} testRecord_t;
+
+// World datagram carrying count records for instances first..first+count-1,
+// record i stamped with its instance number
+static size_t buildState(uint8_t *datagram, uint16_t first, uint16_t count)
+{
+    sitlWorldStateHeader_t header;
+    header.magic = SITL_WORLD_MAGIC;
+    header.firstInstance = first;
+    header.count = count;
+    memcpy(datagram, &header, sizeof(header));
+    for (uint16_t i = 0; i < count; i++) {
+        testRecord_t record;
+        memset(&record, 0, sizeof(record));
+        record.timestamp = first + i;
+        memcpy(datagram + sizeof(header) + i * sizeof(record), &record, sizeof(record));
+    }
+    return sizeof(header) + count * sizeof(testRecord_t);
+}
+
+TEST(SitlWorldTest, PicksOwnRecord)
+{
+    uint8_t datagram[sizeof(sitlWorldStateHeader_t) + 4 * sizeof(testRecord_t)];
+    const size_t length = buildState(datagram, 2, 4);
+
+    for (uint16_t instance = 2; instance < 6; instance++) {
+        const void *found = sitlWorldStateRecord(datagram, length, instance, sizeof(testRecord_t));
+        ASSERT_NE(nullptr, found);
+        testRecord_t record;
+        memcpy(&record, found, sizeof(record));
+        EXPECT_EQ(instance, record.timestamp);
+    }
+}
+
+TEST(SitlWorldTest, IgnoresOtherInstancesRanges)
+{
+    uint8_t datagram[sizeof(sitlWorldStateHeader_t) + 4 * sizeof(testRecord_t)];
+    const size_t length = buildState(datagram, 2, 4);
+
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, length, 0, sizeof(testRecord_t)));
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, length, 1, sizeof(testRecord_t)));
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, length, 6, sizeof(testRecord_t)));
+}
+
+TEST(SitlWorldTest, RejectsMalformedDatagrams)
+{
+    uint8_t datagram[sizeof(sitlWorldStateHeader_t) + 4 * sizeof(testRecord_t)];
+    const size_t length = buildState(datagram, 0, 4);
+
+    // truncated, wrong record size, too short for a header
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, length - 1, 0, sizeof(testRecord_t)));
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, length, 0, sizeof(testRecord_t) + 8));
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, 4, 0, sizeof(testRecord_t)));
+
+    // a plain single-vehicle fdm_packet arriving on the world port
+    datagram[0] ^= 0xff;
+    EXPECT_EQ(nullptr, sitlWorldStateRecord(datagram, length, 0, sizeof(testRecord_t)));
+}
+
+TEST(SitlWorldTest, FramesMotorsWithSender)
+{
+    const float motors[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    uint8_t datagram[sizeof(sitlWorldMotorHeader_t) + sizeof(motors)];
+
+    const size_t length = sitlWorldMotorFrame(datagram, 7, motors, sizeof(motors));
+    ASSERT_EQ(sizeof(datagram), length);
+
+    sitlWorldMotorHeader_t header;
+    memcpy(&header, datagram, sizeof(header));
+    EXPECT_EQ(SITL_WORLD_MAGIC, header.magic);
+    EXPECT_EQ(7, header.instance);
+    EXPECT_EQ(0, memcmp(datagram + sizeof(header), motors, sizeof(motors)));
+}
@@ -260,6 +260,8 @@ TEST(CrossFireMSPTest, SendMspReply)
 
 extern "C" {
 
+    int16_t debug[DEBUG16_VALUE_COUNT];
+    uint8_t debugMode;
     gpsSolutionData_t gpsSol;
     attitudeEulerAngles_t attitude = { { 0, 0, 0 } };
     extern uint8_t responseBuffer[MSP_TLM_OUTBUF_SIZE];
@@ -311,6 +311,7 @@ TEST(TelemetryCrsfTest, TestFlightMode)
 extern "C" {
 
 int16_t debug[DEBUG16_VALUE_COUNT];
+uint8_t debugMode;
 
 const uint32_t baudRates[] = {0, 9600, 19200, 38400, 57600, 115200, 230400, 250000, 400000}; // see baudRate_e
 
@@ -19,17 +19,22 @@
  * If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <set>
 #include <vector>
 
 extern "C" {
     #include "platform.h"
 
+    #include "drivers/flash/flash.h"
     #include "fc/runtime_config.h"
+    #include "flight/mission_store.h"
     #include "io/gps.h"
     #include "pg/autopilot.h"
     #include "pg/flight_plan.h"
+    #include "pg/geofence.h"
     #include "flight/flight_plan_nav.h"
     #include "telemetry/mavlink_mission.h"
 
@@ -42,7 +47,7 @@ extern "C" {
     static bool s_navActive = false;
     static bool s_navInjected = false;
     static flightPlanNavState_e s_navState = FP_NAV_IDLE;
-    static uint8_t s_navIndex = 0;
+    static uint16_t s_navIndex = 0;
     static int s_setCurrentArg = -1;
     static int s_saveCalls = 0;
     static uint32_t s_millis = 0;
@@ -51,16 +56,39 @@ extern "C" {
     bool flightPlanNavIsActive(void) { return s_navActive; }
     bool flightPlanNavIsInjectedPlanActive(void) { return s_navInjected; }
     flightPlanNavState_e flightPlanNavGetState(void) { return s_navState; }
-    uint8_t flightPlanNavGetCurrentIndex(void) { return s_navIndex; }
-    bool flightPlanNavSetCurrentIndex(uint8_t index) { s_setCurrentArg = index; return true; }
+    uint16_t flightPlanNavGetCurrentIndex(void) { return s_navIndex; }
+    bool flightPlanNavSetCurrentIndex(uint16_t index) { s_setCurrentArg = index; return true; }
     void flightPlanNavSetReachedListener(flightPlanWaypointReachedFn fn) { s_reachedListener = fn; }
 
     // Fixed orbit period so LOITER_TURNS <-> ORBIT conversion is deterministic.
     uint16_t flightPlanNavOrbitPeriodDs(uint16_t) { return 250; }
 
     void saveConfigAndNotify(void) { s_saveCalls++; }
+
+    // The geofence index is never built here: there is no estimator origin.
+    bool positionEstimatorGetGpsOrigin(gpsLocation_t *) { return false; }
+    void GPS_distance2d(const gpsLocation_t *, const gpsLocation_t *, vector2_t *) {}
     uint32_t millis(void) { return s_millis; }
 
+    // Fake flash for missions past MAX_WAYPOINTS: 4 KiB sectors, partition in 16..31.
+    static uint8_t s_flash[4096 * 32];
+    static flashGeometry_t s_flashGeometry = { .sectors = 32, .pageSize = 256, .sectorSize = 4096, .totalSize = sizeof(s_flash) };
+    static flashPartition_t s_missionPartition = { .type = FLASH_PARTITION_TYPE_MISSION, .startSector = 16, .endSector = 31 };
+    flashPartition_t *flashPartitionFindByType(flashPartitionType_e type) { return type == FLASH_PARTITION_TYPE_MISSION ? &s_missionPartition : NULL; }
+    const flashGeometry_t *flashGetGeometry(void) { return &s_flashGeometry; }
+    // a sector erase keeps the flash busy for 40ms
+    static uint32_t s_flashBusyUntilMs;
+    void flashEraseSector(uint32_t address) { memset(&s_flash[address - address % 4096], 0xff, 4096); s_flashBusyUntilMs = s_millis + 40; }
+    bool flashIsReady(void) { return s_millis >= s_flashBusyUntilMs; }
+    void flashPageProgram(uint32_t address, const uint8_t *data, uint32_t length, void (*)(uintptr_t))
+    {
+        for (uint32_t i = 0; i < length; i++) {
+            s_flash[address + i] &= data[i];
+        }
+    }
+    int flashReadBytes(uint32_t address, uint8_t *buffer, uint32_t length) { memcpy(buffer, &s_flash[address], length); return length; }
+    void flashFlush(void) {}
+
     // Capture every message the module transmits.
     static std::vector<mavlink_message_t> *s_sent = nullptr;
     void mavlinkSendMessage(mavlink_message_t *msg) { if (s_sent) { s_sent->push_back(*msg); } }
@@ -91,6 +119,10 @@ protected:
 
         flightPlanConfig_t *plan = flightPlanConfigMutable();
         memset(plan, 0, sizeof(*plan));
+        memset(geofenceConfigMutable(), 0, sizeof(geofenceConfig_t));
+        memset(s_flash, 0xff, sizeof(s_flash));
+        s_flashBusyUntilMs = 0;
+        missionStoreInit();
 
         s_navActive = false;
         s_navInjected = false;
@@ -142,12 +174,93 @@ protected:
         feed(msg);
     }
 
-    void sendCount(uint16_t count) {
+    void sendCount(uint16_t count, uint8_t missionType = MAV_MISSION_TYPE_MISSION) {
         mavlink_message_t msg;
         mavlink_msg_mission_count_pack(GCS_SYS, GCS_COMP, &msg,
-            1, 0, count, MAV_MISSION_TYPE_MISSION, 0);
+            1, 0, count, missionType, 0);
         feed(msg);
     }
+
+    // Upload `count` items over a link with rttMs round trip time, the GCS
+    // answering every MISSION_REQUEST_INT as it arrives. Items in dropOnce
+    // are lost the first time they are sent; reverse answers each batch of
+    // requests back to front. Returns how long the GCS waited from sending
+    // MISSION_COUNT to seeing the final MISSION_ACK, 0 if none came.
+    uint32_t uploadOverLink(uint16_t count, uint8_t missionType, uint32_t rttMs,
+                            std::set<uint16_t> dropOnce = {}, bool reverse = false) {
+        struct inFlight { uint32_t arriveMs; mavlink_message_t msg; };
+        std::vector<inFlight> toFc;
+        const uint32_t oneWayMs = rttMs / 2;
+
+        mavlink_message_t countMsg;
+        mavlink_msg_mission_count_pack(GCS_SYS, GCS_COMP, &countMsg, 1, 0, count, missionType, 0);
+        toFc.push_back({ oneWayMs, countMsg });
+
+        size_t handled = sent.size();
+        for (s_millis = 0; s_millis < 60000; s_millis++) {
+            for (size_t i = 0; i < toFc.size(); ) {
+                if (toFc[i].arriveMs <= s_millis) {
+                    const mavlink_message_t msg = toFc[i].msg;
+                    toFc.erase(toFc.begin() + i);
+                    feed(msg);
+                } else {
+                    i++;
+                }
+            }
+            mavMissionUpdate(s_millis);
+
+            std::vector<uint16_t> requests;
+            for (; handled < sent.size(); handled++) {
+                const mavlink_message_t &out = sent[handled];
+                if (out.msgid == MAVLINK_MSG_ID_MISSION_ACK) {
+                    return s_millis + oneWayMs;
+                }
+                if (out.msgid == MAVLINK_MSG_ID_MISSION_REQUEST_INT) {
+                    mavlink_mission_request_int_t r;
+                    mavlink_msg_mission_request_int_decode(&out, &r);
+                    requests.push_back(r.seq);
+                }
+            }
+            if (reverse) {
+                std::reverse(requests.begin(), requests.end());
+            }
+            for (const uint16_t seq : requests) {
+                if (dropOnce.erase(seq)) {
+                    continue;
+                }
+                mavlink_message_t item;
+                if (missionType == MAV_MISSION_TYPE_FENCE) {
+                    mavlink_msg_mission_item_int_pack(GCS_SYS, GCS_COMP, &item,
+                        1, 0, seq, MAV_FRAME_GLOBAL_INT, MAV_CMD_NAV_FENCE_CIRCLE_EXCLUSION, 0, 1,
+                        10.0f + seq, 0.0f, 0.0f, 0.0f, 1000 * seq, 2000 * seq, 0.0f, MAV_MISSION_TYPE_FENCE);
+                } else {
+                    mavlink_msg_mission_item_int_pack(GCS_SYS, GCS_COMP, &item,
+                        1, 0, seq, MAV_FRAME_GLOBAL_INT, MAV_CMD_NAV_WAYPOINT, 0, 1,
+                        0.0f, 0.0f, 0.0f, 0.0f, 1000 * seq, 2000 * seq, 20.0f, MAV_MISSION_TYPE_MISSION);
+                }
+                toFc.push_back({ s_millis + rttMs, item });
+            }
+        }
+        return 0;
+    }
+
+    uint8_t lastAckResult() const {
+        const mavlink_message_t *ack = lastOfType(MAVLINK_MSG_ID_MISSION_ACK);
+        EXPECT_NE(ack, nullptr);
+        mavlink_mission_ack_t a;
+        mavlink_msg_mission_ack_decode(ack, &a);
+        return a.type;
+    }
+
+    void expectUploadedMission(uint16_t count) {
+        ASSERT_EQ(missionStoreGetCount(), count);
+        for (uint16_t seq = 0; seq < count; seq++) {
+            const waypoint_t *wp = missionStoreGetWaypoint(seq);
+            ASSERT_NE(wp, nullptr);
+            EXPECT_EQ(wp->latitude, 1000 * seq);
+            EXPECT_EQ(wp->longitude, 2000 * seq);
+        }
+    }
 };
 
 TEST_F(MavlinkMissionTest, UploadWritesWaypointsToConfig)
@@ -318,3 +431,137 @@ TEST_F(MavlinkMissionTest, SetCurrentDispatchesAndEchoesCursor)
     EXPECT_EQ(s_setCurrentArg, 2);
     EXPECT_NE(lastOfType(MAVLINK_MSG_ID_MISSION_CURRENT), nullptr);
 }
+
+// --- Pipelined upload over a slow link ---
+// One request at a time costs a round trip per item: 3 s for 30 items and
+// 30 s for 300 at 100 ms. The request window opens to MISSION_UPLOAD_WINDOW
+// within a few round trips.
+
+TEST_F(MavlinkMissionTest, Upload30ItemsOver100msRtt)
+{
+    const uint32_t uploadMs = uploadOverLink(30, MAV_MISSION_TYPE_MISSION, 100);
+    RecordProperty("upload_ms", uploadMs);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+    EXPECT_GT(uploadMs, 0u);
+    EXPECT_LE(uploadMs, 800u);      // 7 round trips plus COUNT's and ACK's one-way legs
+    EXPECT_EQ(s_saveCalls, 1);      // persisted once, at the end
+    expectUploadedMission(30);
+}
+
+TEST_F(MavlinkMissionTest, Upload300ItemsOver100msRtt)
+{
+    flightPlanConfigMutable()->missionStorage = MISSION_STORAGE_FLASH;
+    missionStoreInit();
+    ASSERT_TRUE(missionStoreIsFlash());
+
+    const uint32_t uploadMs = uploadOverLink(300, MAV_MISSION_TYPE_MISSION, 100);
+    RecordProperty("upload_ms", uploadMs);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+    EXPECT_GT(uploadMs, 0u);
+    EXPECT_LE(uploadMs, 4300u);     // about 8 items a round trip once the window is open
+    EXPECT_EQ(s_saveCalls, 0);      // the flash commit is the only write
+    expectUploadedMission(300);
+}
+
+TEST_F(MavlinkMissionTest, FlashUploadRequestsItemsOnceErased)
+{
+    flightPlanConfigMutable()->missionStorage = MISSION_STORAGE_FLASH;
+    missionStoreInit();
+
+    // 256 + 600 * 16 bytes: three sectors, erased from the update, not the handler
+    sendCount(600);
+    EXPECT_EQ(countOfType(MAVLINK_MSG_ID_MISSION_REQUEST_INT), 0);
+
+    for (s_millis = 0; s_millis < 120; s_millis++) {
+        mavMissionUpdate(s_millis);
+    }
+    EXPECT_EQ(countOfType(MAVLINK_MSG_ID_MISSION_REQUEST_INT), 0);
+
+    // then the upload starts as usual, with the first item
+    for (; s_millis < 300; s_millis++) {
+        mavMissionUpdate(s_millis);
+    }
+    ASSERT_EQ(countOfType(MAVLINK_MSG_ID_MISSION_REQUEST_INT), 1);
+    mavlink_mission_request_int_t r;
+    mavlink_msg_mission_request_int_decode(lastOfType(MAVLINK_MSG_ID_MISSION_REQUEST_INT), &r);
+    EXPECT_EQ(r.seq, 0);
+}
+
+TEST_F(MavlinkMissionTest, UploadBuffersItemsArrivingOutOfOrder)
+{
+    EXPECT_GT(uploadOverLink(30, MAV_MISSION_TYPE_MISSION, 100, {}, true), 0u);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+    expectUploadedMission(30);
+}
+
+TEST_F(MavlinkMissionTest, UploadRecoversLostItems)
+{
+    const uint32_t uploadMs = uploadOverLink(30, MAV_MISSION_TYPE_MISSION, 100, { 5, 6, 20 });
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+    // each loss stalls the window until the retry timeout asks again
+    EXPECT_GT(uploadMs, 1500u);
+    EXPECT_LT(uploadMs, 5000u);
+    EXPECT_EQ(s_saveCalls, 1);
+    expectUploadedMission(30);
+}
+
+TEST_F(MavlinkMissionTest, UploadIgnoresDuplicateItems)
+{
+    sendCount(3);
+    sendItem(0, MAV_CMD_NAV_WAYPOINT, 3, 0.0f, 100, 200, 20.0f);
+    sendItem(0, MAV_CMD_NAV_WAYPOINT, 3, 0.0f, 100, 200, 20.0f);
+    sendItem(1, MAV_CMD_NAV_WAYPOINT, 3, 0.0f, 300, 400, 20.0f);
+    EXPECT_EQ(countOfType(MAVLINK_MSG_ID_MISSION_ACK), 0);
+    sendItem(2, MAV_CMD_NAV_WAYPOINT, 3, 0.0f, 500, 600, 20.0f);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+    EXPECT_EQ(flightPlanConfig()->waypointCount, 3);
+}
+
+TEST_F(MavlinkMissionTest, UploadRejectsItemBeyondWindow)
+{
+    sendCount(20);
+    sendItem(12, MAV_CMD_NAV_WAYPOINT, 20, 0.0f, 100, 200, 20.0f);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_INVALID_SEQUENCE);
+}
+
+TEST_F(MavlinkMissionTest, FenceUploadIsPipelined)
+{
+    const uint32_t uploadMs = uploadOverLink(MAX_GEOFENCE_ITEMS, MAV_MISSION_TYPE_FENCE, 100);
+
+    EXPECT_EQ(lastAckResult(), MAV_MISSION_ACCEPTED);
+    EXPECT_LE(uploadMs, 800u);
+    EXPECT_EQ(s_saveCalls, 1);
+    ASSERT_EQ(geofenceConfig()->itemCount, MAX_GEOFENCE_ITEMS);
+    EXPECT_EQ(geofenceConfig()->items[31].type, GEOFENCE_CIRCLE_EXCLUSION);
+    EXPECT_EQ(geofenceConfig()->items[31].param, 41);
+    EXPECT_EQ(geofenceConfig()->items[31].latitude, 31000);
+}
+
+TEST_F(MavlinkMissionTest, DownloadServesPipelinedRequests)
+{
+    flightPlanConfig_t *plan = flightPlanConfigMutable();
+    plan->waypointCount = 3;
+    plan->waypoints[0] = { 100, 200, 1200, 0, 0, WAYPOINT_TYPE_TAKEOFF, WAYPOINT_PATTERN_NONE };
+    plan->waypoints[1] = { 300, 400, 2000, 0, 0, WAYPOINT_TYPE_FLYBY, WAYPOINT_PATTERN_NONE };
+    plan->waypoints[2] = { 500, 600, 0, 0, 0, WAYPOINT_TYPE_LAND, WAYPOINT_PATTERN_NONE };
+
+    mavlink_message_t list;
+    mavlink_msg_mission_request_list_pack(GCS_SYS, GCS_COMP, &list, 1, 0, MAV_MISSION_TYPE_MISSION);
+    feed(list);
+
+    // all three asked for at once, answered out of order
+    for (const uint16_t seq : { 2, 0, 1 }) {
+        mavlink_message_t req;
+        mavlink_msg_mission_request_int_pack(GCS_SYS, GCS_COMP, &req, 1, 0, seq, MAV_MISSION_TYPE_MISSION);
+        feed(req);
+    }
+
+    EXPECT_EQ(countOfType(MAVLINK_MSG_ID_MISSION_ITEM_INT), 3);
+    EXPECT_EQ(countOfType(MAVLINK_MSG_ID_MISSION_ACK), 0);
+}
@@ -0,0 +1,580 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/maths.h"
+    #include "common/vector.h"
+    #include "drivers/serial.h"
+    #include "fc/runtime_config.h"
+    #include "flight/flight_plan_nav.h"
+    #include "flight/imu.h"
+    #include "flight/position_estimator.h"
+    #include "io/serial.h"
+    #include "pg/mavlink_offboard.h"
+    #include "sensors/acceleration.h"
+    #include "sensors/gyro.h"
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+    #include "common/mavlink.h"
+    #pragma GCC diagnostic pop
+
+    #include "telemetry/mavlink_offboard.h"
+
+    void captureBodyState(float q[4], float rateRadS[XYZ_AXIS_COUNT]);
+    void rotateNedToBody(const float q[4], const float v[3], float out[3]);
+    uint16_t packPendingSamples(uint8_t *buf, uint16_t room);
+    void timesyncSample(int64_t tc1Ns, int64_t ts1Ns, int64_t receivedNs);
+    bool setpointIsFresh(uint32_t stampMs, timeMs_t nowMs);
+    bool setpointToEnu(const mavlink_set_position_target_local_ned_t *sp,
+                       const positionEstimate3d_t *est,
+                       vector3_t *posEnuM, vector3_t *velEnuMps, bool *velValid, float *headingDeg);
+
+    uint8_t armingFlags = 0;
+    acc_t acc;
+    gyro_t gyro;
+    const uint32_t baudRates[BAUD_COUNT] = {
+        0, 9600, 19200, 38400, 57600, 115200, 230400, 250000,
+        400000, 460800, 500000, 921600, 1000000, 1500000, 2000000, 2470000
+    };
+
+    static uint32_t s_micros = 0;
+    static uint32_t s_millis = 0;
+    uint32_t micros(void) { return s_micros; }
+    uint32_t millis(void) { return s_millis; }
+
+    static quaternion_t s_attitude = { .w = 1, .x = 0, .y = 0, .z = 0 };
+    void getQuaternion(quaternion_t *q) { *q = s_attitude; }
+
+    static positionEstimate3d_t s_estimate;
+    const positionEstimate3d_t *positionEstimatorGetEstimate(void) { return &s_estimate; }
+    bool positionEstimatorIsValidXY(void) { return s_estimate.isValidXY; }
+
+    // Executor mock: records the last target handed over.
+    static bool s_targetAccepted = true;
+    static int s_targetCalls = 0;
+    static vector3_t s_targetPos;
+    static bool s_targetHasVel;
+    static vector3_t s_targetVel;
+    static float s_targetHeading;
+    bool flightPlanNavSetExternalTarget(const vector3_t *posEnuM, const vector3_t *velEnuMps, float headingDeg, timeUs_t)
+    {
+        s_targetCalls++;
+        s_targetPos = *posEnuM;
+        s_targetHasVel = velEnuMps != NULL;
+        if (velEnuMps) {
+            s_targetVel = *velEnuMps;
+        }
+        s_targetHeading = headingDeg;
+        return s_targetAccepted;
+    }
+    bool flightPlanNavIsExternalTargetActive(void) { return s_targetCalls > 0; }
+
+    // Fake port: a byte queue in, everything written captured out.
+    static serialPort_t s_port;
+    static serialPortConfig_t s_portConfig;
+    static uint32_t s_openedBaud = 0;
+    static uint32_t s_txFree = 4096;
+    static int s_writes = 0;
+    static std::vector<uint8_t> *s_tx = nullptr;
+    static std::deque<uint8_t> *s_rx = nullptr;
+
+    const serialPortConfig_t *findSerialPortConfig(serialPortFunction_e) { return &s_portConfig; }
+    serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, void *,
+                                 uint32_t baudrate, portMode_e, portOptions_e)
+    {
+        s_openedBaud = baudrate;
+        return &s_port;
+    }
+    uint32_t serialTxBytesFree(const serialPort_t *) { return s_txFree; }
+    void serialWriteBuf(serialPort_t *, const uint8_t *data, int count)
+    {
+        s_writes++;
+        s_tx->insert(s_tx->end(), data, data + count);
+    }
+    uint32_t serialRxBytesWaiting(const serialPort_t *) { return s_rx->size(); }
+    uint8_t serialRead(serialPort_t *)
+    {
+        const uint8_t c = s_rx->front();
+        s_rx->pop_front();
+        return c;
+    }
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static const float HALF_SQRT2 = 0.70710678f;
+
+class MavlinkOffboardTest : public ::testing::Test {
+protected:
+    std::vector<uint8_t> tx;
+    std::deque<uint8_t> rx;
+
+    void SetUp() override {
+        s_tx = &tx;
+        s_rx = &rx;
+        s_micros = 1000;
+        s_millis = 1;
+        s_txFree = 4096;
+        s_writes = 0;
+        s_targetAccepted = true;
+        s_targetCalls = 0;
+        s_attitude = { .w = 1, .x = 0, .y = 0, .z = 0 };
+        memset(&s_estimate, 0, sizeof(s_estimate));
+        memset(&acc, 0, sizeof(acc));
+        memset(&gyro, 0, sizeof(gyro));
+        armingFlags = 0;
+
+        memset(&s_portConfig, 0, sizeof(s_portConfig));
+        s_portConfig.telemetry_baudrateIndex = BAUD_115200;
+        mavlinkOffboardConfigMutable()->offboard_attitude_rate_hz = 100;
+        mavlinkOffboardConfigMutable()->offboard_position_rate_hz = 50;
+        mavlinkOffboardInit();
+    }
+
+    // Decode everything written so far, in order.
+    std::vector<mavlink_message_t> sent() {
+        std::vector<mavlink_message_t> msgs;
+        mavlink_message_t msg;
+        mavlink_status_t status;
+        memset(&status, 0, sizeof(status));
+        mavlink_reset_channel_status(MAVLINK_COMM_1);
+        for (uint8_t c : tx) {
+            if (mavlink_parse_char(MAVLINK_COMM_1, c, &msg, &status) == MAVLINK_FRAMING_OK) {
+                msgs.push_back(msg);
+            }
+        }
+        tx.clear();
+        return msgs;
+    }
+
+    std::vector<mavlink_message_t> sentWithId(uint32_t msgid) {
+        std::vector<mavlink_message_t> matching;
+        for (const auto &msg : sent()) {
+            if (msg.msgid == msgid) {
+                matching.push_back(msg);
+            }
+        }
+        return matching;
+    }
+
+    void feed(const mavlink_message_t &msg) {
+        uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+        const uint16_t length = mavlink_msg_to_send_buffer(buf, &msg);
+        rx.insert(rx.end(), buf, buf + length);
+    }
+
+    mavlink_set_position_target_local_ned_t setpoint(uint8_t frame, uint16_t mask) {
+        mavlink_set_position_target_local_ned_t sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.coordinate_frame = frame;
+        sp.type_mask = mask;
+        return sp;
+    }
+
+    mavlinkOffboardStatus_t status() {
+        mavlinkOffboardStatus_t s;
+        mavlinkOffboardGetStatus(&s);
+        return s;
+    }
+};
+
+TEST_F(MavlinkOffboardTest, OpensPortAtStreamingBaud)
+{
+    EXPECT_TRUE(mavlinkOffboardIsEnabled());
+    EXPECT_EQ(921600u, s_openedBaud);
+    EXPECT_EQ(100, mavlinkOffboardAttitudeRateHz());
+}
+
+TEST_F(MavlinkOffboardTest, AttitudeIsDecimatedAndConvertedToFrdNed)
+{
+    // yawed 90 degrees left in NWU, so -90 (west) as a NED heading
+    s_attitude = { .w = HALF_SQRT2, .x = 0, .y = 0, .z = HALF_SQRT2 };
+    gyro.gyroADCf[X] = 0;
+    gyro.gyroADCf[Y] = 0;
+    gyro.gyroADCf[Z] = 90;
+    acc.dev.acc_1G_rec = 1.0f / 2048;
+    acc.accADC.z = 2048;
+
+    // 100 Hz: a capture up to a quarter interval early counts, earlier not
+    mavlinkOffboardCaptureAttitude(1000);
+    mavlinkOffboardCaptureAttitude(3000);
+    mavlinkOffboardCaptureAttitude(8000);
+    mavlinkOffboardCaptureAttitude(9000);
+    mavlinkOffboardUpdate(10000);
+
+    const auto quats = sentWithId(MAVLINK_MSG_ID_ATTITUDE_QUATERNION);
+    ASSERT_EQ(2u, quats.size());
+    mavlink_attitude_quaternion_t q;
+    mavlink_msg_attitude_quaternion_decode(&quats[0], &q);
+    EXPECT_NEAR(HALF_SQRT2, q.q1, 1e-6f);
+    EXPECT_NEAR(0, q.q2, 1e-6f);
+    EXPECT_NEAR(0, q.q3, 1e-6f);
+    EXPECT_NEAR(-HALF_SQRT2, q.q4, 1e-6f);
+    EXPECT_NEAR(-M_PIf / 2, q.yawspeed, 1e-5f);
+
+    float yaw = atan2f(2 * (q.q1 * q.q4 + q.q2 * q.q3), 1 - 2 * (q.q3 * q.q3 + q.q4 * q.q4));
+    EXPECT_NEAR(-90.0f, RADIANS_TO_DEGREES(yaw), 1e-3f);
+
+    // Level and at rest: specific force points up, which is -z in FRD
+    mavlinkOffboardCaptureAttitude(20000);
+    mavlinkOffboardUpdate(20000);
+    const auto imus = sentWithId(MAVLINK_MSG_ID_HIGHRES_IMU);
+    ASSERT_EQ(1u, imus.size());
+    mavlink_highres_imu_t imu;
+    mavlink_msg_highres_imu_decode(&imus[0], &imu);
+    EXPECT_NEAR(-9.80665f, imu.zacc, 1e-3f);
+    EXPECT_EQ(20000u, imu.time_usec);
+}
+
+TEST_F(MavlinkOffboardTest, FullRingDropsOldestSample)
+{
+    const uint32_t droppedBefore = status().droppedSamples;
+    for (int i = 0; i < 10; i++) {
+        mavlinkOffboardCaptureAttitude(1000 + i * 10000);
+    }
+    EXPECT_EQ(droppedBefore + 2, status().droppedSamples);
+
+    // a few samples fit each batch; the rest wait for the next update
+    for (int i = 0; i < 4; i++) {
+        mavlinkOffboardUpdate(100000 + i * 2000);
+    }
+    const auto imus = sentWithId(MAVLINK_MSG_ID_HIGHRES_IMU);
+    ASSERT_EQ(8u, imus.size());
+    mavlink_highres_imu_t imu;
+    mavlink_msg_highres_imu_decode(&imus[0], &imu);
+    EXPECT_EQ(21000u, imu.time_usec);
+}
+
+TEST_F(MavlinkOffboardTest, SamplesArePackedOldestFirstInOneWrite)
+{
+    s_estimate.isValidXY = true;
+    s_estimate.position.v[ENU_N] = 100;
+    s_estimate.position.v[ENU_E] = 200;
+    s_estimate.position.v[ENU_U] = 300;
+    s_estimate.velocity.v[ENU_N] = 50;
+
+    mavlinkOffboardCaptureAttitude(1000);
+    mavlinkOffboardCapturePosition(2000);
+    mavlinkOffboardCaptureAttitude(11000);
+
+    // heartbeat and timesync request go out first, then the batch; the
+    // last attitude sample does not fit it and waits for the next update
+    mavlinkOffboardUpdate(12000);
+    EXPECT_EQ(3, s_writes);
+    mavlinkOffboardUpdate(14000);
+    EXPECT_EQ(4, s_writes);
+
+    std::vector<uint32_t> order;
+    mavlink_local_position_ned_t local;
+    mavlink_odometry_t odometry;
+    for (const auto &msg : sent()) {
+        order.push_back(msg.msgid);
+        if (msg.msgid == MAVLINK_MSG_ID_LOCAL_POSITION_NED) {
+            mavlink_msg_local_position_ned_decode(&msg, &local);
+        } else if (msg.msgid == MAVLINK_MSG_ID_ODOMETRY) {
+            mavlink_msg_odometry_decode(&msg, &odometry);
+        }
+    }
+    const std::vector<uint32_t> expected = {
+        MAVLINK_MSG_ID_HEARTBEAT, MAVLINK_MSG_ID_TIMESYNC,
+        MAVLINK_MSG_ID_ATTITUDE_QUATERNION, MAVLINK_MSG_ID_HIGHRES_IMU,
+        MAVLINK_MSG_ID_LOCAL_POSITION_NED, MAVLINK_MSG_ID_ODOMETRY,
+        MAVLINK_MSG_ID_ATTITUDE_QUATERNION, MAVLINK_MSG_ID_HIGHRES_IMU,
+    };
+    EXPECT_EQ(expected, order);
+
+    EXPECT_FLOAT_EQ(1.0f, local.x);
+    EXPECT_FLOAT_EQ(2.0f, local.y);
+    EXPECT_FLOAT_EQ(-3.0f, local.z);
+    EXPECT_FLOAT_EQ(0.5f, local.vx);
+    EXPECT_EQ(MAV_FRAME_LOCAL_NED, odometry.frame_id);
+    EXPECT_EQ(MAV_FRAME_BODY_FRD, odometry.child_frame_id);
+    EXPECT_FLOAT_EQ(0.5f, odometry.vx);
+    EXPECT_TRUE(std::isnan(odometry.pose_covariance[0]));
+}
+
+TEST_F(MavlinkOffboardTest, PackingStopsWhenOutOfRoom)
+{
+    mavlinkOffboardCaptureAttitude(1000);
+    mavlinkOffboardCaptureAttitude(11000);
+
+    uint8_t buf[512];
+    const uint16_t first = packPendingSamples(buf, 150);
+    EXPECT_GT(first, 0);
+    EXPECT_LE(first, 150);
+    EXPECT_EQ(0, packPendingSamples(buf, 10));
+    EXPECT_GT(packPendingSamples(buf, sizeof(buf)), 0);
+    EXPECT_EQ(0, packPendingSamples(buf, sizeof(buf)));
+}
+
+TEST_F(MavlinkOffboardTest, AttitudeIsPackedPastAPositionThatDoesNotFit)
+{
+    s_estimate.isValidXY = true;
+    mavlinkOffboardCapturePosition(1000);
+    mavlinkOffboardCaptureAttitude(2000);
+
+    // room for an attitude pair but not a position pair
+    uint8_t buf[512];
+    const uint16_t first = packPendingSamples(buf, 150);
+    EXPECT_GT(first, 0);
+    tx.assign(buf, buf + first);
+    const auto msgs = sent();
+    ASSERT_EQ(2u, msgs.size());
+    EXPECT_EQ(MAVLINK_MSG_ID_ATTITUDE_QUATERNION, msgs[0].msgid);
+
+    // the position waited and goes out once there is room
+    const uint16_t second = packPendingSamples(buf, sizeof(buf));
+    tx.assign(buf, buf + second);
+    EXPECT_EQ(1u, sentWithId(MAVLINK_MSG_ID_LOCAL_POSITION_NED).size());
+}
+
+TEST_F(MavlinkOffboardTest, PositionStreamIsOffWhenTheTxBufferCannotHoldIt)
+{
+    s_txFree = 256;
+    mavlinkOffboardInit();
+    s_estimate.isValidXY = true;
+    const uint32_t droppedBefore = status().droppedSamples;
+
+    for (timeUs_t t = 1000; t < 101000; t += 4000) {
+        mavlinkOffboardCaptureAttitude(t);
+        mavlinkOffboardCapturePosition(t);
+        mavlinkOffboardUpdate(t);
+    }
+
+    int attitudes = 0;
+    int positions = 0;
+    for (const auto &msg : sent()) {
+        attitudes += msg.msgid == MAVLINK_MSG_ID_ATTITUDE_QUATERNION;
+        positions += msg.msgid == MAVLINK_MSG_ID_LOCAL_POSITION_NED;
+    }
+    EXPECT_GE(attitudes, 9);
+    EXPECT_EQ(0, positions);
+    EXPECT_EQ(droppedBefore, status().droppedSamples);
+}
+
+TEST_F(MavlinkOffboardTest, TimesyncTracksOffsetAndRejectsSlowReplies)
+{
+    const int64_t offsetNs = 5000000000LL;
+
+    // request at 1 s, reply stamped by the companion mid-way, back 2 ms later
+    timesyncSample(1000000000LL + 1000000 + offsetNs, 1000000000LL, 1002000000LL);
+    EXPECT_TRUE(status().timesyncValid);
+    EXPECT_EQ(offsetNs, status().timesyncOffsetNs);
+    EXPECT_EQ(2000u, status().timesyncRttUs);
+
+    // slower than the best: ignored, yet the best round trip ages
+    timesyncSample(2000000000LL + 9000000 + offsetNs + 4000000, 2000000000LL, 2018000000LL);
+    EXPECT_EQ(offsetNs, status().timesyncOffsetNs);
+    EXPECT_EQ(2250u, status().timesyncRttUs);
+
+    // as fast: the offset moves a quarter of the way
+    timesyncSample(3000000000LL + 1000000 + offsetNs + 400000, 3000000000LL, 3002000000LL);
+    EXPECT_EQ(offsetNs + 100000, status().timesyncOffsetNs);
+
+    // round trips past 100 ms say nothing
+    timesyncSample(4000000000LL + offsetNs * 2, 4000000000LL, 4200000000LL);
+    EXPECT_EQ(offsetNs + 100000, status().timesyncOffsetNs);
+
+    // a companion clock reset is taken as is
+    timesyncSample(5000000000LL + 1000000 - offsetNs, 5000000000LL, 5002000000LL);
+    EXPECT_EQ(-offsetNs, status().timesyncOffsetNs);
+}
+
+TEST_F(MavlinkOffboardTest, TimesyncRequestsAndRepliesOverTheLink)
+{
+    mavlinkOffboardUpdate(1000);
+    const auto requests = sentWithId(MAVLINK_MSG_ID_TIMESYNC);
+    ASSERT_EQ(1u, requests.size());
+    mavlink_timesync_t request;
+    mavlink_msg_timesync_decode(&requests[0], &request);
+    EXPECT_EQ(0, request.tc1);
+    EXPECT_EQ(1000000, request.ts1);
+
+    mavlink_message_t reply;
+    mavlink_msg_timesync_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &reply, request.ts1 + 2000000 + 3000000000LL, request.ts1, 1, 1);
+    feed(reply);
+    s_micros = 5000;
+    mavlinkOffboardUpdate(5000);
+    EXPECT_TRUE(status().timesyncValid);
+    EXPECT_EQ(3000000000LL, status().timesyncOffsetNs);
+
+    // the companion asking us: ts1 echoed, our time in tc1
+    mavlink_message_t ask;
+    mavlink_msg_timesync_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &ask, 0, 777, 1, 1);
+    feed(ask);
+    mavlinkOffboardUpdate(6000);
+    const auto answers = sentWithId(MAVLINK_MSG_ID_TIMESYNC);
+    ASSERT_EQ(1u, answers.size());
+    mavlink_timesync_t answer;
+    mavlink_msg_timesync_decode(&answers[0], &answer);
+    EXPECT_EQ(777, answer.ts1);
+    EXPECT_EQ(5000000, answer.tc1);
+}
+
+TEST_F(MavlinkOffboardTest, SetpointFreshness)
+{
+    EXPECT_TRUE(setpointIsFresh(0, 100000));
+    EXPECT_TRUE(setpointIsFresh(99600, 100000));
+    EXPECT_TRUE(setpointIsFresh(100400, 100000));
+    EXPECT_FALSE(setpointIsFresh(99000, 100000));
+
+    // stamped in the companion's clock, 3 s ahead of ours
+    timesyncSample(3000000000LL + 1000000, 0, 2000000);
+    EXPECT_TRUE(setpointIsFresh(103000, 100000));
+    EXPECT_FALSE(setpointIsFresh(104000, 100000));
+}
+
+TEST_F(MavlinkOffboardTest, SetpointConvertsNedToEnu)
+{
+    s_estimate.position.v[ENU_E] = 1000;
+    s_estimate.position.v[ENU_N] = 2000;
+    s_estimate.position.v[ENU_U] = 500;
+
+    vector3_t pos, vel;
+    bool velValid;
+    float heading;
+
+    auto sp = setpoint(MAV_FRAME_LOCAL_NED, POSITION_TARGET_TYPEMASK_VX_IGNORE | POSITION_TARGET_TYPEMASK_VY_IGNORE
+        | POSITION_TARGET_TYPEMASK_VZ_IGNORE);
+    sp.x = 8;
+    sp.y = -3;
+    sp.z = -10;
+    sp.yaw = -M_PIf / 2;
+    ASSERT_TRUE(setpointToEnu(&sp, &s_estimate, &pos, &vel, &velValid, &heading));
+    EXPECT_FLOAT_EQ(-3.0f, pos.v[ENU_E]);
+    EXPECT_FLOAT_EQ(8.0f, pos.v[ENU_N]);
+    EXPECT_FLOAT_EQ(10.0f, pos.v[ENU_U]);
+    EXPECT_FALSE(velValid);
+    EXPECT_NEAR(270.0f, heading, 1e-3f);
+
+    // offset from where the craft is, heading left alone
+    sp = setpoint(MAV_FRAME_LOCAL_OFFSET_NED, POSITION_TARGET_TYPEMASK_YAW_IGNORE);
+    sp.x = 1;
+    sp.z = 2;
+    sp.vx = 0.5f;
+    sp.vz = -1;
+    ASSERT_TRUE(setpointToEnu(&sp, &s_estimate, &pos, &vel, &velValid, &heading));
+    EXPECT_FLOAT_EQ(10.0f, pos.v[ENU_E]);
+    EXPECT_FLOAT_EQ(21.0f, pos.v[ENU_N]);
+    EXPECT_FLOAT_EQ(3.0f, pos.v[ENU_U]);
+    EXPECT_TRUE(velValid);
+    EXPECT_FLOAT_EQ(0.5f, vel.v[ENU_N]);
+    EXPECT_FLOAT_EQ(1.0f, vel.v[ENU_U]);
+    EXPECT_FLOAT_EQ(-1.0f, heading);
+
+    // velocity only: anchored on the craft, altitude held
+    sp = setpoint(MAV_FRAME_LOCAL_NED, POSITION_TARGET_TYPEMASK_X_IGNORE | POSITION_TARGET_TYPEMASK_Y_IGNORE
+        | POSITION_TARGET_TYPEMASK_Z_IGNORE | POSITION_TARGET_TYPEMASK_YAW_IGNORE);
+    sp.vy = 2;
+    ASSERT_TRUE(setpointToEnu(&sp, &s_estimate, &pos, &vel, &velValid, &heading));
+    EXPECT_FLOAT_EQ(10.0f, pos.v[ENU_E]);
+    EXPECT_FLOAT_EQ(20.0f, pos.v[ENU_N]);
+    EXPECT_FLOAT_EQ(5.0f, pos.v[ENU_U]);
+    EXPECT_FLOAT_EQ(2.0f, vel.v[ENU_E]);
+
+    // nothing to fly, or a frame not handled
+    sp = setpoint(MAV_FRAME_LOCAL_NED, POSITION_TARGET_TYPEMASK_X_IGNORE | POSITION_TARGET_TYPEMASK_VX_IGNORE);
+    EXPECT_FALSE(setpointToEnu(&sp, &s_estimate, &pos, &vel, &velValid, &heading));
+    sp = setpoint(MAV_FRAME_BODY_NED, 0);
+    EXPECT_FALSE(setpointToEnu(&sp, &s_estimate, &pos, &vel, &velValid, &heading));
+}
+
+TEST_F(MavlinkOffboardTest, SetpointMessageReachesExecutor)
+{
+    const mavlinkOffboardStatus_t before = status();
+
+    mavlink_message_t msg;
+    mavlink_msg_set_position_target_local_ned_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &msg,
+        0, 1, 1, MAV_FRAME_LOCAL_NED,
+        POSITION_TARGET_TYPEMASK_VX_IGNORE | POSITION_TARGET_TYPEMASK_VY_IGNORE | POSITION_TARGET_TYPEMASK_VZ_IGNORE
+            | POSITION_TARGET_TYPEMASK_YAW_IGNORE,
+        8, 0, -5, 0, 0, 0, 0, 0, 0, 0, 0);
+    feed(msg);
+    mavlinkOffboardUpdate(2000);
+    EXPECT_EQ(1, s_targetCalls);
+    EXPECT_FLOAT_EQ(8.0f, s_targetPos.v[ENU_N]);
+    EXPECT_FLOAT_EQ(5.0f, s_targetPos.v[ENU_U]);
+    EXPECT_FALSE(s_targetHasVel);
+    EXPECT_EQ(before.setpointsAccepted + 1, status().setpointsAccepted);
+
+    // Z left out holds the previous setpoint's altitude
+    mavlink_msg_set_position_target_local_ned_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &msg,
+        0, 1, 1, MAV_FRAME_LOCAL_NED,
+        POSITION_TARGET_TYPEMASK_Z_IGNORE | POSITION_TARGET_TYPEMASK_VX_IGNORE | POSITION_TARGET_TYPEMASK_VY_IGNORE
+            | POSITION_TARGET_TYPEMASK_VZ_IGNORE | POSITION_TARGET_TYPEMASK_YAW_IGNORE,
+        0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    feed(msg);
+    mavlinkOffboardUpdate(3000);
+    EXPECT_EQ(2, s_targetCalls);
+    EXPECT_FLOAT_EQ(4.0f, s_targetPos.v[ENU_E]);
+    EXPECT_FLOAT_EQ(5.0f, s_targetPos.v[ENU_U]);
+
+    // addressed elsewhere: ignored; stale: rejected
+    mavlink_msg_set_position_target_local_ned_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &msg,
+        0, 7, 1, MAV_FRAME_LOCAL_NED, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    feed(msg);
+    mavlinkOffboardUpdate(3500);
+    s_millis = 10000;
+    mavlink_msg_set_position_target_local_ned_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &msg,
+        2000, 1, 1, MAV_FRAME_LOCAL_NED, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    feed(msg);
+    mavlinkOffboardUpdate(4000);
+    EXPECT_EQ(2, s_targetCalls);
+    EXPECT_EQ(before.setpointsRejected + 1, status().setpointsRejected);
+
+    // refused by the executor (not in AUTOPILOT mode)
+    s_targetAccepted = false;
+    mavlink_msg_set_position_target_local_ned_pack(200, MAV_COMP_ID_ONBOARD_COMPUTER, &msg,
+        0, 1, 1, MAV_FRAME_LOCAL_NED, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    feed(msg);
+    mavlinkOffboardUpdate(5000);
+    EXPECT_EQ(before.setpointsRejected + 2, status().setpointsRejected);
+}
+
+TEST_F(MavlinkOffboardTest, RotateNedToBody)
+{
+    // heading east: north is to the left, which is -y in FRD
+    const float q[4] = { HALF_SQRT2, 0, 0, HALF_SQRT2 };
+    const float north[3] = { 1, 0, 0 };
+    float body[3];
+    rotateNedToBody(q, north, body);
+    EXPECT_NEAR(0, body[0], 1e-6f);
+    EXPECT_NEAR(-1, body[1], 1e-6f);
+    EXPECT_NEAR(0, body[2], 1e-6f);
+
+    // rolled right 90 degrees: down is to the right
+    const float qRoll[4] = { HALF_SQRT2, HALF_SQRT2, 0, 0 };
+    const float down[3] = { 0, 0, 1 };
+    rotateNedToBody(qRoll, down, body);
+    EXPECT_NEAR(0, body[0], 1e-6f);
+    EXPECT_NEAR(1, body[1], 1e-6f);
+    EXPECT_NEAR(0, body[2], 1e-6f);
+}
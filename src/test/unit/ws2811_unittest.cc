@@ -0,0 +1,254 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "platform.h"
+
+#include "common/color.h"
+#include "common/colorconversion.h"
+#include "common/time.h"
+
+#include "drivers/light_ws2811strip.h"
+}
+
+static const hsvColor_t red = { 0, 0, 255 };
+static const hsvColor_t green = { 120, 0, 255 };
+static const hsvColor_t blue = { 240, 0, 255 };
+static const hsvColor_t black = { 0, 0, 0 };
+
+// What the driver wrote to the transfer buffer
+static rgbColor24bpp_t transferBuffer[WS2811_DATA_BUFFER_SIZE];
+static bool written[WS2811_DATA_BUFFER_SIZE];
+static int pixelsWritten;
+static int transfers;
+static int refusedTransfers;    // starts to refuse, as PICO does inside its reset gap
+static bool blockingTransfers;  // send the frame before returning, as ESP32 does
+
+// The previous transfer has finished and nothing has been written since
+static void clearWrites(void)
+{
+    memset(written, 0, sizeof(written));
+    pixelsWritten = 0;
+    transfers = 0;
+    ws2811LedDataTransferInProgress = false;
+}
+
+// Bring the strip to a known state: `count` LEDs of one colour, all sent
+static void setUpStrip(unsigned count, const hsvColor_t *color)
+{
+    ws2811LedDataTransferInProgress = false;
+    ws2811LedStripEnable();
+    setUsedLedCount(count);
+    setStripColor(color);
+    while (!ws2811UpdateStrip(100));
+    clearWrites();
+}
+
+static bool sameRgb(const hsvColor_t *hsv, const rgbColor24bpp_t *rgb)
+{
+    const rgbColor24bpp_t *expected = hsvToRgb24(hsv);
+    return memcmp(expected, rgb, sizeof(*rgb)) == 0;
+}
+
+TEST(WS2811Test, EnableClearsWholeStrip)
+{
+    ws2811LedStripEnable();
+
+    EXPECT_EQ(1, transfers);
+    EXPECT_EQ(WS2811_DATA_BUFFER_SIZE, pixelsWritten);
+    for (int i = 0; i < WS2811_DATA_BUFFER_SIZE; i++) {
+        EXPECT_TRUE(sameRgb(&black, &transferBuffer[i]));
+    }
+}
+
+TEST(WS2811Test, UnchangedFrameIsNotSent)
+{
+    setUpStrip(10, &red);
+
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(0, transfers);
+    EXPECT_EQ(0, pixelsWritten);
+
+    // setting a LED to the colour it already shows is no change either
+    setLedHsv(4, &red);
+    setStripColor(&red);
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(0, transfers);
+
+    ws2811UpdateStats_t stats;
+    ws2811GetUpdateStats(&stats);
+    EXPECT_EQ(0, stats.pixelsWritten);
+    EXPECT_GE(stats.framesSkipped, 2u);
+}
+
+TEST(WS2811Test, OnlyChangedLedsAreWritten)
+{
+    setUpStrip(20, &red);
+
+    setLedHsv(3, &green);
+    setLedHsv(17, &blue);
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+
+    EXPECT_EQ(1, transfers);
+    EXPECT_EQ(2, pixelsWritten);
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(i == 3 || i == 17, written[i]);
+    }
+    EXPECT_TRUE(sameRgb(&green, &transferBuffer[3]));
+    EXPECT_TRUE(sameRgb(&blue, &transferBuffer[17]));
+    EXPECT_TRUE(sameRgb(&red, &transferBuffer[4]));
+
+    ws2811UpdateStats_t stats;
+    ws2811GetUpdateStats(&stats);
+    EXPECT_EQ(2, stats.pixelsWritten);
+}
+
+TEST(WS2811Test, RevertedLedIsNotWritten)
+{
+    setUpStrip(10, &red);
+
+    // changed and changed back between updates
+    setLedHsv(2, &green);
+    setLedValue(5, 10);
+    setLedHsv(2, &red);
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+
+    EXPECT_EQ(1, pixelsWritten);
+    EXPECT_TRUE(written[5]);
+    hsvColor_t dimmed = red;
+    dimmed.v = 10;
+    EXPECT_TRUE(sameRgb(&dimmed, &transferBuffer[5]));
+}
+
+TEST(WS2811Test, BrightnessChangeRewritesStrip)
+{
+    setUpStrip(10, &green);
+
+    EXPECT_TRUE(ws2811UpdateStrip(50));
+    EXPECT_EQ(1, transfers);
+    EXPECT_EQ(WS2811_DATA_BUFFER_SIZE, pixelsWritten);
+
+    hsvColor_t scaled = green;
+    scaled.v = green.v * 50 / 100;
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(sameRgb(&scaled, &transferBuffer[i]));
+    }
+
+    // and stays put at the new brightness
+    clearWrites();
+    EXPECT_TRUE(ws2811UpdateStrip(50));
+    EXPECT_EQ(0, transfers);
+}
+
+TEST(WS2811Test, ShorterStripClearsDroppedLeds)
+{
+    setUpStrip(20, &blue);
+
+    setUsedLedCount(5);
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(1, transfers);
+    for (int i = 5; i < 20; i++) {
+        EXPECT_TRUE(sameRgb(&black, &transferBuffer[i]));
+    }
+    EXPECT_TRUE(sameRgb(&blue, &transferBuffer[0]));
+}
+
+TEST(WS2811Test, RefusedTransferIsSentAgain)
+{
+    setUpStrip(10, &red);
+
+    refusedTransfers = 1;
+    setLedHsv(6, &green);
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(0, transfers);
+    EXPECT_FALSE(ws2811LedDataTransferInProgress);
+
+    // nothing changed since, but the LEDs have not seen the frame yet
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(1, transfers);
+    EXPECT_TRUE(sameRgb(&green, &transferBuffer[6]));
+
+    clearWrites();
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(0, transfers);
+}
+
+TEST(WS2811Test, CompletedBlockingTransferIsNotSentAgain)
+{
+    setUpStrip(10, &red);
+    blockingTransfers = true;
+
+    setLedHsv(2, &blue);
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(1, transfers);
+    EXPECT_FALSE(ws2811LedDataTransferInProgress);
+
+    // the frame went out before the start returned: nothing left to send
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_TRUE(ws2811UpdateStrip(100));
+    EXPECT_EQ(1, transfers);
+
+    blockingTransfers = false;
+}
+
+// STUBS
+
+extern "C" {
+
+timeUs_t micros(void)
+{
+    return 0;
+}
+
+void schedulerIgnoreTaskStateTime(void) {}
+
+bool ws2811LedStripHardwareInit(void)
+{
+    return true;
+}
+
+void ws2811LedStripUpdateTransferBuffer(const rgbColor24bpp_t *color, unsigned ledIndex)
+{
+    transferBuffer[ledIndex] = *color;
+    written[ledIndex] = true;
+    pixelsWritten++;
+}
+
+bool ws2811LedStripStartTransfer(void)
+{
+    if (refusedTransfers > 0) {
+        refusedTransfers--;
+        ws2811LedDataTransferInProgress = false;
+        return false;
+    }
+    transfers++;
+    if (blockingTransfers) {
+        ws2811LedDataTransferInProgress = false;
+    }
+    return true;
+}
+
+}